@@ -0,0 +1,134 @@
+//***************************************************************************************
+// AssetDependencies.cpp
+//***************************************************************************************
+
+#include "AssetDependencies.h"
+#include "FileWatcher.h"
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+	// Per-asset state while ordering the affected assets.
+	enum : std::uint8_t
+	{
+		Unaffected = 0,
+		Marked,
+		Visiting,
+		Ordered
+	};
+}
+
+AssetDependencies::Asset AssetDependencies::AddAsset(const std::string& name, std::uint32_t kind)
+{
+	assert(mNames.count(name) == 0);
+
+	AssetState asset;
+	asset.Name = name;
+	asset.Kind = kind;
+	mAssets.push_back(asset);
+
+	const Asset id = (Asset)mAssets.size() - 1;
+	mNames[name] = id;
+	return id;
+}
+
+void AssetDependencies::SetFiles(Asset asset, const std::vector<std::string>& files)
+{
+	AssetState& state = mAssets[asset];
+	for(const std::string& file : state.Files)
+	{
+		std::vector<Asset>& assets = mFileAssets[file];
+		assets.erase(std::remove(assets.begin(), assets.end(), asset), assets.end());
+		if(assets.empty())
+			mFileAssets.erase(file);
+	}
+
+	state.Files.clear();
+	for(const std::string& file : files)
+	{
+		const std::string key = FileWatcher::NormalizePath(file);
+		if(std::find(state.Files.begin(), state.Files.end(), key) != state.Files.end())
+			continue;
+
+		state.Files.push_back(key);
+		mFileAssets[key].push_back(asset);
+	}
+}
+
+void AssetDependencies::AddDependency(Asset dependent, Asset dependency)
+{
+	assert(dependent != dependency);
+
+	std::vector<Asset>& dependencies = mAssets[dependent].Dependencies;
+	if(std::find(dependencies.begin(), dependencies.end(), dependency) != dependencies.end())
+		return;
+
+	dependencies.push_back(dependency);
+	mAssets[dependency].Dependents.push_back(dependent);
+}
+
+std::vector<AssetDependencies::Asset> AssetDependencies::Affected(const std::vector<std::string>& files)const
+{
+	std::vector<std::uint8_t> state(mAssets.size(), Unaffected);
+
+	// Everything built from the files, then everything built from those.
+	std::vector<Asset> pending;
+	for(const std::string& file : files)
+	{
+		auto it = mFileAssets.find(FileWatcher::NormalizePath(file));
+		if(it != mFileAssets.end())
+			pending.insert(pending.end(), it->second.begin(), it->second.end());
+	}
+
+	while(!pending.empty())
+	{
+		const Asset asset = pending.back();
+		pending.pop_back();
+		if(state[asset] != Unaffected)
+			continue;
+
+		state[asset] = Marked;
+		pending.insert(pending.end(), mAssets[asset].Dependents.begin(), mAssets[asset].Dependents.end());
+	}
+
+	std::vector<Asset> ordered;
+	for(Asset asset = 0; asset < AssetCount(); ++asset)
+	{
+		if(state[asset] == Marked)
+			Order(asset, state, ordered);
+	}
+	return ordered;
+}
+
+void AssetDependencies::Order(Asset asset, std::vector<std::uint8_t>& state, std::vector<Asset>& ordered)const
+{
+	// Dependencies first.  A cycle is broken where it is found.
+	state[asset] = Visiting;
+	for(Asset dependency : mAssets[asset].Dependencies)
+	{
+		if(state[dependency] == Marked)
+			Order(dependency, state, ordered);
+	}
+	state[asset] = Ordered;
+	ordered.push_back(asset);
+}
+
+std::vector<std::string> AssetDependencies::Files()const
+{
+	std::vector<std::string> files;
+	files.reserve(mFileAssets.size());
+	for(auto& e : mFileAssets)
+		files.push_back(e.first);
+
+	std::sort(files.begin(), files.end());
+	return files;
+}
+
+AssetDependencies::Asset AssetDependencies::Find(const std::string& name)const
+{
+	auto it = mNames.find(name);
+	if(it == mNames.end())
+		return InvalidAsset;
+	return it->second;
+}
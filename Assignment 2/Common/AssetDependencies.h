@@ -0,0 +1,68 @@
+//***************************************************************************************
+// AssetDependencies.h
+//
+// Which assets are built from which files, and from which other assets, so that a
+// change to some files rebuilds only what is downstream of them.  Assets are opaque
+// ids with a name and a caller-defined kind (texture, shader, PSO, ...); files are
+// matched by FileWatcher::NormalizePath.
+//
+// Device independent.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class AssetDependencies
+{
+public:
+	typedef std::uint32_t Asset;
+	static const Asset InvalidAsset = ~0u;
+
+	AssetDependencies() = default;
+	AssetDependencies(const AssetDependencies& rhs) = delete;
+	AssetDependencies& operator=(const AssetDependencies& rhs) = delete;
+
+	Asset AddAsset(const std::string& name, std::uint32_t kind);
+
+	// Replaces the files asset is built from, e.g. a shader's includes after an edit.
+	void SetFiles(Asset asset, const std::vector<std::string>& files);
+
+	// dependent is rebuilt whenever dependency is.
+	void AddDependency(Asset dependent, Asset dependency);
+
+	// The assets built from any of files and everything downstream of them, each one
+	// after the assets it depends on.
+	std::vector<Asset> Affected(const std::vector<std::string>& files)const;
+
+	// Every file some asset is built from, for watching.
+	std::vector<std::string> Files()const;
+
+	Asset Find(const std::string& name)const;
+	const std::string& Name(Asset asset)const { return mAssets[asset].Name; }
+	std::uint32_t Kind(Asset asset)const { return mAssets[asset].Kind; }
+	const std::vector<Asset>& Dependencies(Asset asset)const { return mAssets[asset].Dependencies; }
+	std::uint32_t AssetCount()const { return (std::uint32_t)mAssets.size(); }
+
+private:
+	struct AssetState
+	{
+		std::string Name;
+		std::uint32_t Kind = 0;
+		std::vector<std::string> Files;
+		std::vector<Asset> Dependencies;
+		std::vector<Asset> Dependents;
+	};
+
+	void Order(Asset asset, std::vector<std::uint8_t>& state, std::vector<Asset>& ordered)const;
+
+private:
+	std::vector<AssetState> mAssets;
+	std::unordered_map<std::string, Asset> mNames;
+
+	// Normalized file path to the assets built from it.
+	std::unordered_map<std::string, std::vector<Asset>> mFileAssets;
+};
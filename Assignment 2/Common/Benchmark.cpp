@@ -0,0 +1,131 @@
+//***************************************************************************************
+// Benchmark.cpp
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+const void* volatile gBenchmarkSink = nullptr;
+
+namespace
+{
+	std::int64_t SteadyNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Nanoseconds for iterations calls of body.
+	double TimeBatch(const std::function<void()>& body, std::uint64_t iterations)
+	{
+		const std::int64_t start = SteadyNs();
+		for(std::uint64_t i = 0; i < iterations; ++i)
+			body();
+		return (double)(SteadyNs() - start);
+	}
+
+	void WriteJsonString(std::ostream& out, const std::string& s)
+	{
+		out << '"';
+		for(char c : s)
+		{
+			if(c == '"' || c == '\\')
+				out << '\\' << c;
+			else if((unsigned char)c >= 0x20)
+				out << c;
+		}
+		out << '"';
+	}
+}
+
+BenchmarkRunner::BenchmarkRunner(double minBatchMs, std::uint32_t samples) :
+	mMinBatchNs(minBatchMs * 1.0e6),
+	mSamples(std::max<std::uint32_t>(samples, 1))
+{
+}
+
+void BenchmarkRunner::Run(const std::string& name, std::uint64_t size, const std::function<void()>& body)
+{
+	if(!mFilter.empty() && name.find(mFilter) == std::string::npos)
+		return;
+
+	// Warm caches and any lazily built state, then grow the batch until it is long
+	// enough that the clock's resolution does not matter.
+	body();
+
+	std::uint64_t iterations = 1;
+	double ns = TimeBatch(body, iterations);
+	while(ns < mMinBatchNs && iterations < (1ull << 40))
+	{
+		// Aim a little past the target from the last measurement, at most 10x at a time.
+		const double scale = ns > 0.0 ? std::min(10.0, 1.2 * mMinBatchNs / ns) : 10.0;
+		iterations = std::max(iterations + 1, (std::uint64_t)(iterations * scale));
+		ns = TimeBatch(body, iterations);
+	}
+
+	std::vector<double> perCall(mSamples);
+	perCall[0] = ns / iterations;
+	for(std::uint32_t i = 1; i < mSamples; ++i)
+		perCall[i] = TimeBatch(body, iterations) / iterations;
+	std::sort(perCall.begin(), perCall.end());
+
+	Result result;
+	result.Name = name;
+	result.Size = size;
+	result.Iterations = iterations;
+	result.MinNs = perCall.front();
+	result.MedianNs = perCall[perCall.size() / 2];
+	result.MaxNs = perCall.back();
+	result.ItemsPerSecond = (size > 0 && result.MedianNs > 0.0) ? size * 1.0e9 / result.MedianNs : 0.0;
+	mResults.push_back(result);
+}
+
+std::string BenchmarkRunner::Report()const
+{
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(1);
+	for(const Result& r : mResults)
+	{
+		out << r.Name << "/" << r.Size
+			<< "  median " << r.MedianNs << " ns"
+			<< "  min " << r.MinNs
+			<< "  max " << r.MaxNs << "\n";
+	}
+	return out.str();
+}
+
+void BenchmarkRunner::WriteJson(std::ostream& out)const
+{
+	out << std::fixed << std::setprecision(3);
+	out << "{\"schema\":1,\"samples\":" << mSamples << ",\"results\":[\n";
+
+	bool first = true;
+	for(const Result& r : mResults)
+	{
+		out << (first ? "" : ",\n") << "{\"name\":";
+		WriteJsonString(out, r.Name);
+		out << ",\"size\":" << r.Size
+			<< ",\"iterations\":" << r.Iterations
+			<< ",\"min_ns\":" << r.MinNs
+			<< ",\"median_ns\":" << r.MedianNs
+			<< ",\"max_ns\":" << r.MaxNs
+			<< ",\"items_per_second\":" << r.ItemsPerSecond << "}";
+		first = false;
+	}
+
+	out << "\n]}\n";
+}
+
+bool BenchmarkRunner::ExportJson(const std::string& path)const
+{
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+	if(!file)
+		return false;
+
+	WriteJson(file);
+	return (bool)file;
+}
@@ -0,0 +1,67 @@
+//***************************************************************************************
+// Benchmark.h
+//
+// Microbenchmark runner.  Run(name, size, body) calls body in batches long enough to
+// time reliably, takes several batches and keeps min/median/max time per call, so a
+// run can be compared with a run of another build.  WriteJson writes every result;
+// entries are keyed by (name, size).
+//
+// Device independent: only the standard library.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class BenchmarkRunner
+{
+public:
+	struct Result
+	{
+		std::string Name;
+		std::uint64_t Size = 0;          // the input size the case was run at
+		std::uint64_t Iterations = 0;    // calls per timed batch
+		double MinNs = 0.0;              // per call, over the batches
+		double MedianNs = 0.0;
+		double MaxNs = 0.0;
+		double ItemsPerSecond = 0.0;     // Size / MedianNs; 0 when Size is 0
+	};
+
+	// Batches last at least minBatchMs each; samples batches are timed per case.
+	explicit BenchmarkRunner(double minBatchMs = 5.0, std::uint32_t samples = 7);
+
+	// Cases whose name does not contain filter are skipped.  Empty runs everything.
+	void SetFilter(const std::string& filter) { mFilter = filter; }
+
+	void Run(const std::string& name, std::uint64_t size, const std::function<void()>& body);
+
+	const std::vector<Result>& Results()const { return mResults; }
+
+	// One line per case.
+	std::string Report()const;
+
+	void WriteJson(std::ostream& out)const;
+	bool ExportJson(const std::string& path)const;
+
+private:
+	double mMinBatchNs;
+	std::uint32_t mSamples;
+	std::string mFilter;
+	std::vector<Result> mResults;
+};
+
+// Written by DoNotOptimize; never read.
+extern const void* volatile gBenchmarkSink;
+
+// Keeps the compiler from discarding a result the benchmark does not otherwise use.
+template<typename T>
+inline void DoNotOptimize(const T& value)
+{
+	gBenchmarkSink = &value;
+	std::atomic_signal_fence(std::memory_order_seq_cst);
+}
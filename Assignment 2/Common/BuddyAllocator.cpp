@@ -0,0 +1,187 @@
+//***************************************************************************************
+// BuddyAllocator.cpp
+//***************************************************************************************
+
+#include "BuddyAllocator.h"
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+	std::uint64_t NextPow2(std::uint64_t x)
+	{
+		std::uint64_t p = 1;
+		while(p < x)
+			p <<= 1;
+		return p;
+	}
+}
+
+BuddyAllocator::BuddyAllocator(std::uint64_t capacity, std::uint64_t minBlockSize)
+{
+	assert(capacity > 0 && minBlockSize > 0);
+
+	mMinBlockSize = NextPow2(minBlockSize);
+	mCapacity = NextPow2(std::max(capacity, mMinBlockSize));
+
+	while(OrderSize(mMaxOrder) < mCapacity)
+		++mMaxOrder;
+
+	// The whole range starts out as one free block of the largest order.
+	mFreeLists.resize(mMaxOrder + 1);
+	mFreeLists[mMaxOrder].insert(0);
+}
+
+std::uint32_t BuddyAllocator::OrderForSize(std::uint64_t size)const
+{
+	std::uint32_t order = 0;
+	while(OrderSize(order) < size)
+		++order;
+	return order;
+}
+
+std::uint64_t BuddyAllocator::TakeBlock(std::uint32_t order, std::uint64_t limit)
+{
+	// Find the lowest-addressed free block at this order or above.
+	std::uint32_t foundOrder = order;
+	std::uint64_t foundOffset = InvalidOffset;
+	for(std::uint32_t k = order; k <= mMaxOrder; ++k)
+	{
+		if(mFreeLists[k].empty())
+			continue;
+
+		std::uint64_t offset = *mFreeLists[k].begin();
+		if(offset < limit && offset < foundOffset)
+		{
+			foundOffset = offset;
+			foundOrder = k;
+		}
+	}
+
+	if(foundOffset == InvalidOffset)
+		return InvalidOffset;
+
+	mFreeLists[foundOrder].erase(foundOffset);
+
+	// Split down, returning the upper halves to the free lists.
+	while(foundOrder > order)
+	{
+		--foundOrder;
+		mFreeLists[foundOrder].insert(foundOffset + OrderSize(foundOrder));
+	}
+
+	return foundOffset;
+}
+
+std::uint64_t BuddyAllocator::Allocate(std::uint64_t size, std::uint64_t alignment)
+{
+	if(size == 0)
+		size = 1;
+
+	std::uint32_t order = OrderForSize(std::max(size, NextPow2(alignment)));
+	if(order > mMaxOrder)
+		return InvalidOffset;
+
+	std::uint64_t offset = TakeBlock(order, InvalidOffset);
+	if(offset == InvalidOffset)
+		return InvalidOffset;
+
+	Block block;
+	block.Order = order;
+	block.RequestedSize = size;
+	mAllocations[offset] = block;
+
+	mAllocatedBytes += OrderSize(order);
+	mRequestedBytes += size;
+
+	return offset;
+}
+
+void BuddyAllocator::Free(std::uint64_t offset)
+{
+	auto it = mAllocations.find(offset);
+	assert(it != mAllocations.end() && "Freeing an offset that was not allocated.");
+	if(it == mAllocations.end())
+		return;
+
+	std::uint32_t order = it->second.Order;
+	mAllocatedBytes -= OrderSize(order);
+	mRequestedBytes -= it->second.RequestedSize;
+	mAllocations.erase(it);
+
+	// Merge with the buddy for as long as the buddy is free too.
+	while(order < mMaxOrder)
+	{
+		std::uint64_t buddy = offset ^ OrderSize(order);
+		auto buddyIt = mFreeLists[order].find(buddy);
+		if(buddyIt == mFreeLists[order].end())
+			break;
+
+		mFreeLists[order].erase(buddyIt);
+		offset = std::min(offset, buddy);
+		++order;
+	}
+
+	mFreeLists[order].insert(offset);
+}
+
+std::uint64_t BuddyAllocator::BlockSize(std::uint64_t offset)const
+{
+	auto it = mAllocations.find(offset);
+	return it == mAllocations.end() ? 0 : OrderSize(it->second.Order);
+}
+
+BuddyAllocator::Stats BuddyAllocator::GetStats()const
+{
+	Stats stats;
+	stats.Capacity = mCapacity;
+	stats.AllocatedBytes = mAllocatedBytes;
+	stats.RequestedBytes = mRequestedBytes;
+	stats.FreeBytes = mCapacity - mAllocatedBytes;
+	stats.AllocationCount = (std::uint32_t)mAllocations.size();
+
+	for(std::uint32_t k = 0; k <= mMaxOrder; ++k)
+	{
+		stats.FreeBlockCount += (std::uint32_t)mFreeLists[k].size();
+		if(!mFreeLists[k].empty())
+			stats.LargestFreeBlock = OrderSize(k);
+	}
+
+	return stats;
+}
+
+std::uint32_t BuddyAllocator::Defragment(const MoveCallback& move, std::uint32_t maxMoves)
+{
+	// Visit live blocks from the top of the range down and try to drop each one
+	// into a lower free block.  Freeing the old block then lets buddies coalesce
+	// at the top, growing the largest free block.
+	std::vector<std::uint64_t> offsets;
+	offsets.reserve(mAllocations.size());
+	for(auto& e : mAllocations)
+		offsets.push_back(e.first);
+	std::sort(offsets.begin(), offsets.end(), std::greater<std::uint64_t>());
+
+	std::uint32_t moves = 0;
+	for(std::uint64_t oldOffset : offsets)
+	{
+		if(moves >= maxMoves)
+			break;
+
+		Block block = mAllocations[oldOffset];
+		std::uint64_t newOffset = TakeBlock(block.Order, oldOffset);
+		if(newOffset == InvalidOffset)
+			continue;
+
+		mAllocations[newOffset] = block;
+		mAllocatedBytes += OrderSize(block.Order);
+		mRequestedBytes += block.RequestedSize;
+
+		if(move)
+			move(oldOffset, newOffset, block.RequestedSize);
+
+		Free(oldOffset);
+		++moves;
+	}
+
+	return moves;
+}
@@ -0,0 +1,96 @@
+//***************************************************************************************
+// BuddyAllocator.h
+//
+// Power-of-two buddy allocator that hands out offsets into a linear range.  It does
+// not own any memory; the range is usually a GPU heap or a big shared buffer.  It has
+// no Windows/D3D dependencies so it can be built and exercised on any platform.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+class BuddyAllocator
+{
+public:
+	static const std::uint64_t InvalidOffset = ~0ull;
+
+	struct Stats
+	{
+		std::uint64_t Capacity = 0;
+
+		// Bytes handed out in whole blocks vs. bytes the callers actually asked for.
+		// The difference is internal fragmentation (round up to a power of two).
+		std::uint64_t AllocatedBytes = 0;
+		std::uint64_t RequestedBytes = 0;
+		std::uint64_t FreeBytes = 0;
+		std::uint64_t LargestFreeBlock = 0;
+		std::uint32_t AllocationCount = 0;
+		std::uint32_t FreeBlockCount = 0;
+
+		// 0 when all free memory is one block, approaching 1 as it gets shredded.
+		float ExternalFragmentation()const
+		{
+			return FreeBytes == 0 ? 0.0f : 1.0f - (float)LargestFreeBlock / (float)FreeBytes;
+		}
+	};
+
+	// Called for every block the defragmenter relocates.  The callee must copy
+	// size bytes from oldOffset to newOffset and patch anything that points at it.
+	using MoveCallback = std::function<void(std::uint64_t oldOffset, std::uint64_t newOffset, std::uint64_t size)>;
+
+	// capacity and minBlockSize are rounded up to powers of two.
+	BuddyAllocator(std::uint64_t capacity, std::uint64_t minBlockSize);
+	BuddyAllocator(const BuddyAllocator& rhs) = delete;
+	BuddyAllocator& operator=(const BuddyAllocator& rhs) = delete;
+
+	// Returns InvalidOffset if there is no free block large enough.  Blocks are
+	// naturally aligned to their size, so any power-of-two alignment up to the
+	// block size is honoured.
+	std::uint64_t Allocate(std::uint64_t size, std::uint64_t alignment = 1);
+	void Free(std::uint64_t offset);
+
+	// Size of the block backing an allocation (0 if offset is not allocated).
+	std::uint64_t BlockSize(std::uint64_t offset)const;
+
+	std::uint64_t Capacity()const { return mCapacity; }
+	std::uint64_t MinBlockSize()const { return mMinBlockSize; }
+	bool Empty()const { return mAllocations.empty(); }
+
+	Stats GetStats()const;
+
+	// Compacts allocations towards offset 0 by moving blocks into lower free blocks of
+	// the same size.  Stops after maxMoves relocations and returns the number made.
+	std::uint32_t Defragment(const MoveCallback& move, std::uint32_t maxMoves = ~0u);
+
+private:
+	struct Block
+	{
+		std::uint32_t Order = 0;
+		std::uint64_t RequestedSize = 0;
+	};
+
+	std::uint32_t OrderForSize(std::uint64_t size)const;
+	std::uint64_t OrderSize(std::uint32_t order)const { return mMinBlockSize << order; }
+
+	// Takes the lowest free block of at least the given order whose offset is below
+	// limit, splitting larger blocks as needed.  Returns InvalidOffset on failure.
+	std::uint64_t TakeBlock(std::uint32_t order, std::uint64_t limit);
+
+private:
+	std::uint64_t mCapacity = 0;
+	std::uint64_t mMinBlockSize = 0;
+	std::uint32_t mMaxOrder = 0;
+
+	// Free block offsets per order.  Ordered so we always hand out the lowest
+	// address first, which keeps live data packed at the front of the range.
+	std::vector<std::set<std::uint64_t>> mFreeLists;
+	std::unordered_map<std::uint64_t, Block> mAllocations;
+
+	std::uint64_t mAllocatedBytes = 0;
+	std::uint64_t mRequestedBytes = 0;
+};
@@ -0,0 +1,574 @@
+//***************************************************************************************
+// ClothSystem.cpp
+//***************************************************************************************
+
+#include "ClothSystem.h"
+#include "GameTimer.h"
+#include "TaskPool.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+
+using namespace DirectX;
+
+namespace
+{
+	// Four floats at p; the particle and constraint arrays are padded to multiples of four.
+	XMVECTOR Load4(const float* p)
+	{
+		return XMLoadFloat4((const XMFLOAT4*)p);
+	}
+
+	void Store4(float* p, FXMVECTOR v)
+	{
+		XMStoreFloat4((XMFLOAT4*)p, v);
+	}
+
+	// values[index[0..3]] as one vector.
+	XMVECTOR Gather(const float* values, const std::uint32_t* index)
+	{
+		return XMVectorSet(values[index[0]], values[index[1]], values[index[2]], values[index[3]]);
+	}
+
+	void Scatter(float* values, const std::uint32_t* index, FXMVECTOR v)
+	{
+		XMFLOAT4A lanes;
+		XMStoreFloat4A(&lanes, v);
+		values[index[0]] = lanes.x;
+		values[index[1]] = lanes.y;
+		values[index[2]] = lanes.z;
+		values[index[3]] = lanes.w;
+	}
+
+	double WrapPhase(double phase)
+	{
+		phase = std::fmod(phase, XM_2PI);
+		return phase < 0.0 ? phase + XM_2PI : phase;
+	}
+}
+
+ClothSystem::ClothSystem()
+	: ClothSystem(Config())
+{
+}
+
+ClothSystem::ClothSystem(const Config& config)
+	: mConfig(config)
+{
+	mConfig.Iterations = std::max<std::uint32_t>(mConfig.Iterations, 1);
+}
+
+ClothSystem::Cloth ClothSystem::AddCloth(const ClothDesc& desc)
+{
+	assert(desc.Columns >= 2 && desc.Rows >= 2);
+
+	mCloths.emplace_back();
+	ClothState& cloth = mCloths.back();
+	cloth.Columns = desc.Columns;
+	cloth.Rows = desc.Rows;
+	cloth.VertexOffset = mVertexCount;
+	cloth.ParticleCount = desc.Columns * desc.Rows;
+	cloth.PaddedCount = (cloth.ParticleCount + 4) & ~3u;
+	mVertexCount += cloth.ParticleCount;
+
+	const std::uint32_t n = cloth.PaddedCount;
+	for(std::vector<float>* v : { &cloth.X, &cloth.Y, &cloth.Z, &cloth.PrevX, &cloth.PrevY, &cloth.PrevZ,
+		&cloth.RestX, &cloth.RestY, &cloth.RestZ, &cloth.NormalX, &cloth.NormalY, &cloth.NormalZ, &cloth.InvMass })
+		v->assign(n, 0.0f);
+
+	XMVECTOR right = XMVector3Normalize(XMLoadFloat3(&desc.Right));
+	XMVECTOR down = XMVectorSet(0.0f, -1.0f, 0.0f, 0.0f);
+	XMVECTOR normal = XMVector3Normalize(XMVector3Cross(right, down));
+	XMVECTOR origin = XMLoadFloat3(&desc.Origin);
+
+	const float invMass = cloth.ParticleCount / desc.Mass;
+	for(std::uint32_t r = 0; r < desc.Rows; ++r)
+	{
+		for(std::uint32_t c = 0; c < desc.Columns; ++c)
+		{
+			const std::uint32_t i = r * desc.Columns + c;
+			XMFLOAT3 p;
+			XMStoreFloat3(&p, XMVectorAdd(origin, XMVectorAdd(
+				XMVectorScale(right, desc.Width * c / (desc.Columns - 1)),
+				XMVectorScale(down, desc.Height * r / (desc.Rows - 1)))));
+			cloth.RestX[i] = p.x;
+			cloth.RestY[i] = p.y;
+			cloth.RestZ[i] = p.z;
+
+			XMFLOAT3 nf;
+			XMStoreFloat3(&nf, normal);
+			cloth.NormalX[i] = nf.x;
+			cloth.NormalY[i] = nf.y;
+			cloth.NormalZ[i] = nf.z;
+
+			// The first column is tied to the pole.
+			cloth.InvMass[i] = c == 0 ? 0.0f : invMass;
+		}
+	}
+	cloth.DragScale = mConfig.Drag * desc.Width * desc.Height / desc.Mass;
+
+	cloth.X = cloth.PrevX = cloth.RestX;
+	cloth.Y = cloth.PrevY = cloth.RestY;
+	cloth.Z = cloth.PrevZ = cloth.RestZ;
+
+	BuildConstraints(cloth);
+	UpdateStiffness(cloth);
+	return (Cloth)mCloths.size() - 1;
+}
+
+void ClothSystem::Reset()
+{
+	for(ClothState& cloth : mCloths)
+	{
+		std::copy(cloth.RestX.begin(), cloth.RestX.end(), cloth.X.begin());
+		std::copy(cloth.RestY.begin(), cloth.RestY.end(), cloth.Y.begin());
+		std::copy(cloth.RestZ.begin(), cloth.RestZ.end(), cloth.Z.begin());
+		std::copy(cloth.RestX.begin(), cloth.RestX.end(), cloth.PrevX.begin());
+		std::copy(cloth.RestY.begin(), cloth.RestY.end(), cloth.PrevY.begin());
+		std::copy(cloth.RestZ.begin(), cloth.RestZ.end(), cloth.PrevZ.begin());
+	}
+	mAccumulator = 0.0;
+}
+
+void ClothSystem::SetIterations(std::uint32_t iterations)
+{
+	iterations = std::max<std::uint32_t>(iterations, 1);
+	if(iterations == mConfig.Iterations)
+		return;
+
+	mConfig.Iterations = iterations;
+	for(ClothState& cloth : mCloths)
+		UpdateStiffness(cloth);
+}
+
+void ClothSystem::SetWind(const Wind& wind)
+{
+	mConfig.WindField = wind;
+}
+
+void ClothSystem::BuildConstraints(ClothState& cloth)
+{
+	struct Constraint
+	{
+		std::uint32_t A;
+		std::uint32_t B;
+		ConstraintKind Kind;
+	};
+
+	const std::uint32_t columns = cloth.Columns;
+	const std::uint32_t rows = cloth.Rows;
+	std::vector<Constraint> constraints;
+	auto add = [&](std::uint32_t a, std::uint32_t b, ConstraintKind kind)
+	{
+		// Nothing moves two pinned particles.
+		if(cloth.InvMass[a] > 0.0f || cloth.InvMass[b] > 0.0f)
+			constraints.push_back({ a, b, kind });
+	};
+
+	for(std::uint32_t r = 0; r < rows; ++r)
+	{
+		for(std::uint32_t c = 0; c < columns; ++c)
+		{
+			const std::uint32_t i = r * columns + c;
+			if(c + 1 < columns)
+				add(i, i + 1, Stretch);
+			if(r + 1 < rows)
+				add(i, i + columns, Stretch);
+			if(c + 1 < columns && r + 1 < rows)
+			{
+				add(i, i + columns + 1, Shear);
+				add(i + 1, i + columns, Shear);
+			}
+			if(c + 2 < columns)
+				add(i, i + 2, Bend);
+			if(r + 2 < rows)
+				add(i, i + 2 * columns, Bend);
+		}
+	}
+
+	// Greedy colouring: each constraint takes the lowest colour neither of its
+	// particles has yet.  A particle has at most 12 constraints, so 23 colours do.
+	std::vector<std::uint64_t> used(cloth.ParticleCount, 0);
+	std::vector<std::uint32_t> colors(constraints.size());
+	std::vector<std::uint32_t> colorSizes;
+	for(std::size_t i = 0; i < constraints.size(); ++i)
+	{
+		const std::uint64_t taken = used[constraints[i].A] | used[constraints[i].B];
+		std::uint32_t color = 0;
+		while(taken & (1ull << color))
+			color++;
+		assert(color < 64);
+
+		used[constraints[i].A] |= 1ull << color;
+		used[constraints[i].B] |= 1ull << color;
+		colors[i] = color;
+		if(color >= colorSizes.size())
+			colorSizes.resize(color + 1, 0);
+		colorSizes[color]++;
+	}
+
+	// Lay the colours out one after another, each padded to whole vectors with
+	// constraints between the pinned padding particle and itself.
+	std::vector<std::uint32_t> starts(colorSizes.size());
+	std::uint32_t total = 0;
+	cloth.BatchEnds.clear();
+	for(std::size_t color = 0; color < colorSizes.size(); ++color)
+	{
+		starts[color] = total;
+		total += (colorSizes[color] + 3) & ~3u;
+		cloth.BatchEnds.push_back(total);
+	}
+
+	const std::uint32_t pad = cloth.ParticleCount;
+	cloth.A.assign(total, pad);
+	cloth.B.assign(total, pad);
+	cloth.Rest.assign(total, 0.0f);
+	cloth.Stiffness.assign(total, 0.0f);
+	cloth.Kinds.assign(total, Stretch);
+
+	for(std::size_t i = 0; i < constraints.size(); ++i)
+	{
+		const Constraint& constraint = constraints[i];
+		const std::uint32_t slot = starts[colors[i]]++;
+		cloth.A[slot] = constraint.A;
+		cloth.B[slot] = constraint.B;
+		cloth.Kinds[slot] = constraint.Kind;
+
+		const float dx = cloth.RestX[constraint.B] - cloth.RestX[constraint.A];
+		const float dy = cloth.RestY[constraint.B] - cloth.RestY[constraint.A];
+		const float dz = cloth.RestZ[constraint.B] - cloth.RestZ[constraint.A];
+		cloth.Rest[slot] = std::sqrt(dx * dx + dy * dy + dz * dz);
+	}
+}
+
+void ClothSystem::UpdateStiffness(ClothState& cloth)const
+{
+	// k per projection such that Iterations projections remove the fraction k of the
+	// error: 1 - (1 - k')^n = k.
+	const float stiffness[] = { mConfig.StretchStiffness, mConfig.ShearStiffness, mConfig.BendStiffness };
+	float corrected[3];
+	for(int kind = 0; kind < 3; ++kind)
+	{
+		const float k = std::min(std::max(stiffness[kind], 0.0f), 1.0f);
+		corrected[kind] = 1.0f - std::pow(1.0f - k, 1.0f / mConfig.Iterations);
+	}
+
+	const std::uint32_t pad = cloth.ParticleCount;
+	for(std::size_t i = 0; i < cloth.Stiffness.size(); ++i)
+		cloth.Stiffness[i] = cloth.A[i] == pad ? 0.0f : corrected[cloth.Kinds[i]];
+}
+
+void ClothSystem::Update(float dt, TaskPool* pool, Vertex* out)
+{
+	const std::int64_t start = GameTimer::SteadyClockNow();
+
+	// Whole steps owed, capped; the rest of an over-long frame is dropped.
+	mAccumulator += std::max(dt, 0.0f);
+	const double owed = std::floor(mAccumulator / mConfig.StepSeconds);
+	mAccumulator -= owed * mConfig.StepSeconds;
+	mFrameSteps = (std::uint32_t)std::min<double>(owed, mConfig.MaxStepsPerFrame);
+	mStats.DroppedSteps += (std::uint64_t)owed - mFrameSteps;
+	mFrameOutput = out;
+
+	auto runCloth = [this](std::uint32_t index, std::uint32_t)
+	{
+		ClothState& cloth = mCloths[index];
+		for(std::uint32_t step = 0; step < mFrameSteps; ++step)
+			Step(cloth, step);
+		WriteVertices(cloth, mFrameOutput + cloth.VertexOffset);
+	};
+
+	if(pool != nullptr)
+		pool->ParallelFor(ClothCount(), runCloth);
+	else
+	{
+		for(std::uint32_t cloth = 0; cloth < ClothCount(); ++cloth)
+			runCloth(cloth, 0);
+	}
+
+	const Wind& wind = mConfig.WindField;
+	const double seconds = (double)mFrameSteps * mConfig.StepSeconds;
+	mGustPhase = WrapPhase(mGustPhase + XM_2PI * wind.GustFrequency * seconds);
+	mTurbulencePhase = WrapPhase(mTurbulencePhase + XM_2PI * 1.7 * wind.GustFrequency * seconds);
+	mFrameOutput = nullptr;
+
+	mStats.Frames++;
+	mStats.Steps += mFrameSteps;
+	mStats.LastUpdateMs = (GameTimer::SteadyClockNow() - start) * 1.0e-6;
+	mStats.TotalUpdateMs += mStats.LastUpdateMs;
+}
+
+void ClothSystem::Step(ClothState& cloth, std::uint32_t step)const
+{
+	Integrate(cloth, step);
+
+	for(std::uint32_t iteration = 0; iteration < mConfig.Iterations; ++iteration)
+	{
+		std::uint32_t begin = 0;
+		for(std::uint32_t end : cloth.BatchEnds)
+		{
+			SolveBatch(cloth, begin, end);
+			begin = end;
+		}
+	}
+}
+
+void ClothSystem::Integrate(ClothState& cloth, std::uint32_t step)const
+{
+	const Wind& wind = mConfig.WindField;
+	const float h = mConfig.StepSeconds;
+
+	// Horizontal wind direction and the crosswind direction beside it.
+	float dirX = wind.Direction.x;
+	float dirZ = wind.Direction.z;
+	const float dirLength = std::sqrt(dirX * dirX + dirZ * dirZ);
+	if(dirLength > 1.0e-6f)
+	{
+		dirX /= dirLength;
+		dirZ /= dirLength;
+	}
+	else
+	{
+		dirX = 1.0f;
+		dirZ = 0.0f;
+	}
+
+	// Phases at this step of the frame.
+	const double stepSeconds = (double)step * h;
+	const float gustPhase = (float)WrapPhase(mGustPhase + XM_2PI * wind.GustFrequency * stepSeconds);
+	const float turbulencePhase = (float)WrapPhase(mTurbulencePhase + XM_2PI * 1.7 * wind.GustFrequency * stepSeconds);
+
+	const XMVECTOR windX = XMVectorReplicate(dirX);
+	const XMVECTOR windZ = XMVectorReplicate(dirZ);
+	const XMVECTOR waveNumber = XMVectorReplicate(XM_2PI / std::max(wind.WaveLength, 1.0e-3f));
+	const XMVECTOR gustOffset = XMVectorReplicate(gustPhase);
+	const XMVECTOR turbulenceOffset = XMVectorReplicate(turbulencePhase);
+	const XMVECTOR turbulenceScale = XMVectorReplicate(1.7f);
+	const XMVECTOR speed = XMVectorReplicate(wind.Speed);
+	const XMVECTOR gust = XMVectorReplicate(wind.Gust * wind.Speed);
+	const XMVECTOR crosswind = XMVectorReplicate(wind.Turbulence * wind.Speed);
+	const XMVECTOR updraft = XMVectorReplicate(0.25f * wind.Turbulence * wind.Speed);
+
+	const XMVECTOR keep = XMVectorReplicate(1.0f - mConfig.Damping);
+	const XMVECTOR invH = XMVectorReplicate(1.0f / h);
+	const XMVECTOR h2 = XMVectorReplicate(h * h);
+	const XMVECTOR gravityX = XMVectorReplicate(mConfig.Gravity.x);
+	const XMVECTOR gravityY = XMVectorReplicate(mConfig.Gravity.y);
+	const XMVECTOR gravityZ = XMVectorReplicate(mConfig.Gravity.z);
+	const XMVECTOR dragScale = XMVectorReplicate(cloth.DragScale);
+	const XMVECTOR zero = XMVectorZero();
+
+	for(std::uint32_t i = 0; i < cloth.PaddedCount; i += 4)
+	{
+		const XMVECTOR x = Load4(&cloth.X[i]);
+		const XMVECTOR y = Load4(&cloth.Y[i]);
+		const XMVECTOR z = Load4(&cloth.Z[i]);
+
+		// Velocity over the last step, damped.
+		const XMVECTOR vx = XMVectorMultiply(XMVectorSubtract(x, Load4(&cloth.PrevX[i])), keep);
+		const XMVECTOR vy = XMVectorMultiply(XMVectorSubtract(y, Load4(&cloth.PrevY[i])), keep);
+		const XMVECTOR vz = XMVectorMultiply(XMVectorSubtract(z, Load4(&cloth.PrevZ[i])), keep);
+
+		// The wind here: gusts travel downwind, the crosswind varies with height too.
+		const XMVECTOR along = XMVectorMultiply(XMVectorMultiplyAdd(x, windX, XMVectorMultiply(z, windZ)), waveNumber);
+		const XMVECTOR gustWave = XMVectorSin(XMVectorSubtract(along, gustOffset));
+		const XMVECTOR turbulenceWave = XMVectorSin(XMVectorSubtract(
+			XMVectorMultiplyAdd(along, turbulenceScale, XMVectorMultiply(y, waveNumber)), turbulenceOffset));
+		const XMVECTOR strength = XMVectorMultiplyAdd(gustWave, gust, speed);
+		const XMVECTOR cross = XMVectorMultiply(turbulenceWave, crosswind);
+		const XMVECTOR wx = XMVectorNegativeMultiplySubtract(cross, windZ, XMVectorMultiply(strength, windX));
+		const XMVECTOR wy = XMVectorMultiply(turbulenceWave, updraft);
+		const XMVECTOR wz = XMVectorMultiplyAdd(cross, windX, XMVectorMultiply(strength, windZ));
+
+		// Drag pushes along the normal by the wind across the cloth.
+		const XMVECTOR nx = Load4(&cloth.NormalX[i]);
+		const XMVECTOR ny = Load4(&cloth.NormalY[i]);
+		const XMVECTOR nz = Load4(&cloth.NormalZ[i]);
+		const XMVECTOR rx = XMVectorNegativeMultiplySubtract(vx, invH, wx);
+		const XMVECTOR ry = XMVectorNegativeMultiplySubtract(vy, invH, wy);
+		const XMVECTOR rz = XMVectorNegativeMultiplySubtract(vz, invH, wz);
+		const XMVECTOR push = XMVectorMultiply(dragScale,
+			XMVectorMultiplyAdd(nx, rx, XMVectorMultiplyAdd(ny, ry, XMVectorMultiply(nz, rz))));
+
+		const XMVECTOR ax = XMVectorMultiplyAdd(push, nx, gravityX);
+		const XMVECTOR ay = XMVectorMultiplyAdd(push, ny, gravityY);
+		const XMVECTOR az = XMVectorMultiplyAdd(push, nz, gravityZ);
+
+		// Pinned and padding particles stay put.
+		const XMVECTOR movable = XMVectorGreater(Load4(&cloth.InvMass[i]), zero);
+		Store4(&cloth.PrevX[i], x);
+		Store4(&cloth.PrevY[i], y);
+		Store4(&cloth.PrevZ[i], z);
+		Store4(&cloth.X[i], XMVectorSelect(x, XMVectorMultiplyAdd(ax, h2, XMVectorAdd(x, vx)), movable));
+		Store4(&cloth.Y[i], XMVectorSelect(y, XMVectorMultiplyAdd(ay, h2, XMVectorAdd(y, vy)), movable));
+		Store4(&cloth.Z[i], XMVectorSelect(z, XMVectorMultiplyAdd(az, h2, XMVectorAdd(z, vz)), movable));
+	}
+}
+
+void ClothSystem::SolveBatch(ClothState& cloth, std::uint32_t begin, std::uint32_t end)const
+{
+	// No two constraints of a batch share a particle, so the four lanes are
+	// independent.  Padding constraints have no mass and write back what they read.
+	const XMVECTOR epsilon = XMVectorReplicate(1.0e-12f);
+
+	for(std::uint32_t i = begin; i < end; i += 4)
+	{
+		const std::uint32_t* a = &cloth.A[i];
+		const std::uint32_t* b = &cloth.B[i];
+
+		XMVECTOR ax = Gather(cloth.X.data(), a);
+		XMVECTOR ay = Gather(cloth.Y.data(), a);
+		XMVECTOR az = Gather(cloth.Z.data(), a);
+		XMVECTOR bx = Gather(cloth.X.data(), b);
+		XMVECTOR by = Gather(cloth.Y.data(), b);
+		XMVECTOR bz = Gather(cloth.Z.data(), b);
+		const XMVECTOR wa = Gather(cloth.InvMass.data(), a);
+		const XMVECTOR wb = Gather(cloth.InvMass.data(), b);
+
+		const XMVECTOR dx = XMVectorSubtract(bx, ax);
+		const XMVECTOR dy = XMVectorSubtract(by, ay);
+		const XMVECTOR dz = XMVectorSubtract(bz, az);
+		const XMVECTOR length = XMVectorSqrt(XMVectorMultiplyAdd(dx, dx, XMVectorMultiplyAdd(dy, dy, XMVectorMultiply(dz, dz))));
+
+		// s * d moves the pair to the rest length, shared by inverse mass.
+		const XMVECTOR error = XMVectorSubtract(length, Load4(&cloth.Rest[i]));
+		const XMVECTOR s = XMVectorDivide(XMVectorMultiply(Load4(&cloth.Stiffness[i]), error),
+			XMVectorMax(XMVectorMultiply(XMVectorAdd(wa, wb), length), epsilon));
+		const XMVECTOR sa = XMVectorMultiply(s, wa);
+		const XMVECTOR sb = XMVectorMultiply(s, wb);
+
+		ax = XMVectorMultiplyAdd(dx, sa, ax);
+		ay = XMVectorMultiplyAdd(dy, sa, ay);
+		az = XMVectorMultiplyAdd(dz, sa, az);
+		bx = XMVectorNegativeMultiplySubtract(dx, sb, bx);
+		by = XMVectorNegativeMultiplySubtract(dy, sb, by);
+		bz = XMVectorNegativeMultiplySubtract(dz, sb, bz);
+
+		Scatter(cloth.X.data(), a, ax);
+		Scatter(cloth.Y.data(), a, ay);
+		Scatter(cloth.Z.data(), a, az);
+		Scatter(cloth.X.data(), b, bx);
+		Scatter(cloth.Y.data(), b, by);
+		Scatter(cloth.Z.data(), b, bz);
+	}
+}
+
+void ClothSystem::WriteVertices(ClothState& cloth, Vertex* out)const
+{
+	// Normals from central differences, clamped at the edges.  They also steer the
+	// next frame's drag.
+	const std::uint32_t columns = cloth.Columns;
+	const std::uint32_t rows = cloth.Rows;
+	const float du = 1.0f / (columns - 1);
+	const float dv = 1.0f / (rows - 1);
+
+	for(std::uint32_t r = 0; r < rows; ++r)
+	{
+		const std::uint32_t up = r > 0 ? r - 1 : r;
+		const std::uint32_t down = r + 1 < rows ? r + 1 : r;
+		for(std::uint32_t c = 0; c < columns; ++c)
+		{
+			const std::uint32_t left = r * columns + (c > 0 ? c - 1 : c);
+			const std::uint32_t right = r * columns + (c + 1 < columns ? c + 1 : c);
+			const std::uint32_t above = up * columns + c;
+			const std::uint32_t below = down * columns + c;
+
+			const float ux = cloth.X[right] - cloth.X[left];
+			const float uy = cloth.Y[right] - cloth.Y[left];
+			const float uz = cloth.Z[right] - cloth.Z[left];
+			const float vx = cloth.X[below] - cloth.X[above];
+			const float vy = cloth.Y[below] - cloth.Y[above];
+			const float vz = cloth.Z[below] - cloth.Z[above];
+
+			float nx = uy * vz - uz * vy;
+			float ny = uz * vx - ux * vz;
+			float nz = ux * vy - uy * vx;
+			const float length = std::sqrt(nx * nx + ny * ny + nz * nz);
+
+			const std::uint32_t i = r * columns + c;
+			if(length > 1.0e-12f)
+			{
+				nx /= length;
+				ny /= length;
+				nz /= length;
+				cloth.NormalX[i] = nx;
+				cloth.NormalY[i] = ny;
+				cloth.NormalZ[i] = nz;
+			}
+			else
+			{
+				nx = cloth.NormalX[i];
+				ny = cloth.NormalY[i];
+				nz = cloth.NormalZ[i];
+			}
+
+			Vertex v;
+			v.Pos = XMFLOAT3(cloth.X[i], cloth.Y[i], cloth.Z[i]);
+			v.Normal = XMFLOAT3(nx, ny, nz);
+			v.TexC = XMFLOAT2(c * du, r * dv);
+			out[i] = v;
+		}
+	}
+}
+
+void ClothSystem::BuildIndices(std::vector<std::uint32_t>& indices)const
+{
+	indices.clear();
+	indices.reserve(IndexCount());
+	for(const ClothState& cloth : mCloths)
+	{
+		const std::uint32_t n = cloth.Columns;
+		const std::uint32_t base = cloth.VertexOffset;
+		for(std::uint32_t i = 0; i + 1 < cloth.Rows; ++i)
+		{
+			for(std::uint32_t j = 0; j + 1 < n; ++j)
+			{
+				indices.push_back(base + i * n + j);
+				indices.push_back(base + i * n + j + 1);
+				indices.push_back(base + (i + 1) * n + j);
+
+				indices.push_back(base + (i + 1) * n + j);
+				indices.push_back(base + i * n + j + 1);
+				indices.push_back(base + (i + 1) * n + j + 1);
+			}
+		}
+	}
+}
+
+std::uint32_t ClothSystem::IndexCount()const
+{
+	std::uint32_t count = 0;
+	for(const ClothState& cloth : mCloths)
+		count += 6 * (cloth.Columns - 1) * (cloth.Rows - 1);
+	return count;
+}
+
+std::uint32_t ClothSystem::ConstraintCount()const
+{
+	std::uint32_t count = 0;
+	for(const ClothState& cloth : mCloths)
+		count += (std::uint32_t)cloth.A.size();
+	return count;
+}
+
+std::uint32_t ClothSystem::BatchCount()const
+{
+	std::uint32_t count = 0;
+	for(const ClothState& cloth : mCloths)
+		count += (std::uint32_t)cloth.BatchEnds.size();
+	return count;
+}
+
+std::string ClothSystem::StatsString()const
+{
+	char text[320];
+	std::snprintf(text, sizeof(text),
+		"Cloth: %u cloths, %u particles, %u constraints in %u batches, %u iterations; "
+		"%llu frames, %llu steps (%llu dropped), update avg %.3f ms last %.3f ms\n",
+		ClothCount(), VertexCount(), ConstraintCount(), BatchCount(), mConfig.Iterations,
+		(unsigned long long)mStats.Frames, (unsigned long long)mStats.Steps,
+		(unsigned long long)mStats.DroppedSteps,
+		mStats.Frames > 0 ? mStats.TotalUpdateMs / mStats.Frames : 0.0, mStats.LastUpdateMs);
+	return text;
+}
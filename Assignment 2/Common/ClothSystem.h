@@ -0,0 +1,200 @@
+//***************************************************************************************
+// ClothSystem.h
+//
+// Position-based cloth for flags and banners.  Each cloth is a grid of particles
+// hanging from its first column, held together by distance constraints: structural
+// (neighbours), shear (diagonals) and bend (every other particle).  A step predicts
+// positions from gravity, damping and aerodynamic drag against a wind field shared by
+// all the cloths, then projects the constraints Iterations times.
+//
+// Particles are stored as arrays of x, y and z and processed four at a time.  The
+// constraints of a cloth are greedily coloured so that no two in a colour share a
+// particle, which lets a colour be solved four constraints per instruction with no
+// ordering between the lanes.  The cloths are independent, so Update runs one task
+// per cloth on a TaskPool.
+//
+// Time advances in fixed steps of StepSeconds, at most MaxStepsPerFrame of them per
+// Update; time beyond that is dropped, so a slow frame costs the same as any other.
+// Update writes every cloth's vertices, in the demo's Vertex layout, straight into
+// the caller's vertex buffer.
+//
+// Device independent.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class TaskPool;
+
+class ClothSystem
+{
+public:
+	typedef std::uint32_t Cloth;
+
+	// Same layout as the demo's Vertex.
+	struct Vertex
+	{
+		DirectX::XMFLOAT3 Pos;
+		DirectX::XMFLOAT3 Normal;
+		DirectX::XMFLOAT2 TexC;
+	};
+
+	// Wind blowing along Direction (horizontal, normalized by the system) at Speed,
+	// with gusts of +-Gust * Speed travelling downwind every WaveLength metres at
+	// GustFrequency, and a crosswind of up to Turbulence * Speed.
+	struct Wind
+	{
+		DirectX::XMFLOAT3 Direction = { 1.0f, 0.0f, 0.3f };
+		float Speed = 6.0f;
+		float Gust = 0.5f;
+		float GustFrequency = 0.4f;
+		float Turbulence = 0.3f;
+		float WaveLength = 12.0f;
+	};
+
+	struct Config
+	{
+		float StepSeconds = 1.0f / 60.0f;
+		std::uint32_t MaxStepsPerFrame = 2;
+
+		// Constraint projections per step.  Stiffnesses are corrected for the count, so
+		// changing it trades accuracy for time without making the cloth softer.
+		std::uint32_t Iterations = 6;
+
+		DirectX::XMFLOAT3 Gravity = { 0.0f, -9.8f, 0.0f };
+
+		// Fraction of the velocity lost per step.
+		float Damping = 0.01f;
+
+		// Acceleration per m/s of wind across the cloth, per square metre per kilogram.
+		float Drag = 0.3f;
+
+		// Fraction of a constraint's error removed per step, in [0, 1].
+		float StretchStiffness = 1.0f;
+		float ShearStiffness = 0.8f;
+		float BendStiffness = 0.15f;
+
+		Wind WindField;
+	};
+
+	// A rectangle of Columns x Rows particles hanging from the pole at Origin: columns
+	// run Width metres along Right and rows Height metres down.  Column 0 is pinned.
+	struct ClothDesc
+	{
+		std::uint32_t Columns = 16;
+		std::uint32_t Rows = 10;
+		float Width = 4.0f;
+		float Height = 2.5f;
+		DirectX::XMFLOAT3 Origin = { 0.0f, 0.0f, 0.0f };
+		DirectX::XMFLOAT3 Right = { 1.0f, 0.0f, 0.0f };
+		float Mass = 1.0f;
+	};
+
+	struct Stats
+	{
+		std::uint64_t Frames = 0;
+		std::uint64_t Steps = 0;
+		std::uint64_t DroppedSteps = 0;
+		double LastUpdateMs = 0.0;
+		double TotalUpdateMs = 0.0;
+	};
+
+	ClothSystem();
+	explicit ClothSystem(const Config& config);
+	ClothSystem(const ClothSystem& rhs) = delete;
+	ClothSystem& operator=(const ClothSystem& rhs) = delete;
+
+	Cloth AddCloth(const ClothDesc& desc);
+
+	// Puts every cloth back in its rest pose, at rest.
+	void Reset();
+
+	void SetIterations(std::uint32_t iterations);
+	void SetWind(const Wind& wind);
+
+	// Advances the cloths by dt seconds and writes VertexCount() vertices to out.  Each
+	// cloth runs as one task on pool, or all on this thread if pool is null.  Writes
+	// out in order and never reads it, so it may be write-combined memory.  Does not
+	// allocate.
+	void Update(float dt, TaskPool* pool, Vertex* out);
+
+	// Triangle list over the vertices Update writes, two triangles per grid cell.
+	void BuildIndices(std::vector<std::uint32_t>& indices)const;
+
+	std::uint32_t ClothCount()const { return (std::uint32_t)mCloths.size(); }
+	std::uint32_t VertexCount()const { return mVertexCount; }
+	std::uint32_t IndexCount()const;
+	std::uint32_t VertexOffset(Cloth cloth)const { return mCloths[cloth].VertexOffset; }
+	std::uint32_t Iterations()const { return mConfig.Iterations; }
+
+	// Constraints and colours summed over the cloths, padding included.
+	std::uint32_t ConstraintCount()const;
+	std::uint32_t BatchCount()const;
+
+	const Stats& GetStats()const { return mStats; }
+	std::string StatsString()const;
+
+private:
+	enum ConstraintKind : std::uint8_t
+	{
+		Stretch = 0,
+		Shear,
+		Bend
+	};
+
+	struct ClothState
+	{
+		std::uint32_t Columns = 0;
+		std::uint32_t Rows = 0;
+		std::uint32_t VertexOffset = 0;
+
+		// Particles, padded to a multiple of four with at least one pinned particle at
+		// the origin for padding constraints to refer to.
+		std::uint32_t ParticleCount = 0;
+		std::uint32_t PaddedCount = 0;
+		std::vector<float> X, Y, Z;
+		std::vector<float> PrevX, PrevY, PrevZ;
+		std::vector<float> RestX, RestY, RestZ;
+		std::vector<float> NormalX, NormalY, NormalZ;
+		std::vector<float> InvMass;
+
+		// Drag acceleration scale: Drag * area / mass.
+		float DragScale = 0.0f;
+
+		// Constraints grouped by colour; colour i is [BatchEnds[i-1], BatchEnds[i]),
+		// each a multiple of four long.
+		std::vector<std::uint32_t> A, B;
+		std::vector<float> Rest;
+		std::vector<float> Stiffness;
+		std::vector<ConstraintKind> Kinds;
+		std::vector<std::uint32_t> BatchEnds;
+	};
+
+	void BuildConstraints(ClothState& cloth);
+	void UpdateStiffness(ClothState& cloth)const;
+
+	void Step(ClothState& cloth, std::uint32_t step)const;
+	void Integrate(ClothState& cloth, std::uint32_t step)const;
+	void SolveBatch(ClothState& cloth, std::uint32_t begin, std::uint32_t end)const;
+	void WriteVertices(ClothState& cloth, Vertex* out)const;
+
+private:
+	Config mConfig;
+	std::vector<ClothState> mCloths;
+	std::uint32_t mVertexCount = 0;
+
+	// Wind phases at the start of the frame, kept in [0, 2pi) so they stay precise.
+	double mGustPhase = 0.0;
+	double mTurbulencePhase = 0.0;
+	double mAccumulator = 0.0;
+
+	// This frame's work, read by the per-cloth tasks.
+	std::uint32_t mFrameSteps = 0;
+	Vertex* mFrameOutput = nullptr;
+
+	Stats mStats;
+};
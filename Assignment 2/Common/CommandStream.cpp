@@ -0,0 +1,264 @@
+//***************************************************************************************
+// CommandStream.cpp
+//***************************************************************************************
+
+#include "CommandStream.h"
+#include <cassert>
+#include <sstream>
+
+namespace
+{
+	const char* CommandName(std::uint16_t type)
+	{
+		static const char* names[CommandStream::CmdCount] =
+		{
+			"SetPipeline", "SetRootSignature", "SetPrimitiveTopology", "SetVertexBuffer",
+			"SetIndexBuffer", "SetRootConstant", "SetRootTable", "SetRootCbv", "SetRootSrv",
+			"DrawIndexed"
+		};
+
+		return type < CommandStream::CmdCount ? names[type] : "Unknown";
+	}
+}
+
+CommandStream::CommandStream()
+{
+	Reset();
+}
+
+void CommandStream::Reset()
+{
+	mWords.clear();
+	mCommandCount = 0;
+	mSkipped = 0;
+
+	mBound = BoundState();
+	for(auto& address : mBound.RootAddresses)
+		address = ~0ull;
+}
+
+template<typename T>
+T* CommandStream::Push(CommandType type)
+{
+	const std::size_t words = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+	const std::size_t offset = mWords.size();
+	mWords.resize(offset + words, 0);
+
+	T* cmd = reinterpret_cast<T*>(&mWords[offset]);
+	cmd->H.Type = (std::uint16_t)type;
+	cmd->H.Size = (std::uint16_t)(words * sizeof(std::uint64_t));
+
+	mCommandCount++;
+	return cmd;
+}
+
+void CommandStream::SetPipeline(std::uint32_t pipeline)
+{
+	if(mBound.Pipeline == pipeline)
+	{
+		mSkipped++;
+		return;
+	}
+	mBound.Pipeline = pipeline;
+
+	Push<SetPipelineCmd>(CmdSetPipeline)->Pipeline = pipeline;
+}
+
+void CommandStream::SetRootSignature(std::uint32_t rootSignature)
+{
+	if(mBound.RootSignature == rootSignature)
+	{
+		mSkipped++;
+		return;
+	}
+	mBound.RootSignature = rootSignature;
+
+	// Changing the root signature invalidates every root argument.
+	for(auto& address : mBound.RootAddresses)
+		address = ~0ull;
+
+	Push<SetRootSignatureCmd>(CmdSetRootSignature)->RootSignature = rootSignature;
+}
+
+void CommandStream::SetPrimitiveTopology(std::uint32_t topology)
+{
+	if(mBound.Topology == topology)
+	{
+		mSkipped++;
+		return;
+	}
+	mBound.Topology = topology;
+
+	Push<SetPrimitiveTopologyCmd>(CmdSetPrimitiveTopology)->Topology = topology;
+}
+
+void CommandStream::SetVertexBuffer(std::uint64_t address, std::uint32_t sizeInBytes, std::uint32_t stride)
+{
+	if(mBound.VertexBuffer == address && mBound.VertexBufferSize == sizeInBytes)
+	{
+		mSkipped++;
+		return;
+	}
+	mBound.VertexBuffer = address;
+	mBound.VertexBufferSize = sizeInBytes;
+
+	auto cmd = Push<SetVertexBufferCmd>(CmdSetVertexBuffer);
+	cmd->Address = address;
+	cmd->SizeInBytes = sizeInBytes;
+	cmd->Stride = stride;
+}
+
+void CommandStream::SetIndexBuffer(std::uint64_t address, std::uint32_t sizeInBytes, std::uint32_t format)
+{
+	if(mBound.IndexBuffer == address && mBound.IndexBufferSize == sizeInBytes)
+	{
+		mSkipped++;
+		return;
+	}
+	mBound.IndexBuffer = address;
+	mBound.IndexBufferSize = sizeInBytes;
+
+	auto cmd = Push<SetIndexBufferCmd>(CmdSetIndexBuffer);
+	cmd->Address = address;
+	cmd->SizeInBytes = sizeInBytes;
+	cmd->Format = format;
+}
+
+void CommandStream::SetRootConstant(std::uint32_t param, std::uint32_t value, std::uint32_t offset)
+{
+	assert(param < MaxRootParameters);
+
+	auto cmd = Push<SetRootConstantCmd>(CmdSetRootConstant);
+	cmd->Param = param;
+	cmd->Value = value;
+	cmd->Offset = offset;
+}
+
+void CommandStream::SetRootAddress(CommandType type, std::uint32_t param, std::uint64_t address)
+{
+	assert(param < MaxRootParameters);
+
+	if(mBound.RootAddresses[param] == address)
+	{
+		mSkipped++;
+		return;
+	}
+	mBound.RootAddresses[param] = address;
+
+	auto cmd = Push<SetRootAddressCmd>(type);
+	cmd->Param = param;
+	cmd->Address = address;
+}
+
+void CommandStream::SetRootTable(std::uint32_t param, std::uint64_t gpuDescriptor)
+{
+	SetRootAddress(CmdSetRootTable, param, gpuDescriptor);
+}
+
+void CommandStream::SetRootCbv(std::uint32_t param, std::uint64_t address)
+{
+	SetRootAddress(CmdSetRootCbv, param, address);
+}
+
+void CommandStream::SetRootSrv(std::uint32_t param, std::uint64_t address)
+{
+	SetRootAddress(CmdSetRootSrv, param, address);
+}
+
+void CommandStream::DrawIndexed(std::uint32_t indexCount, std::uint32_t instanceCount,
+	std::uint32_t startIndex, std::int32_t baseVertex, std::uint32_t startInstance)
+{
+	auto cmd = Push<DrawIndexedCmd>(CmdDrawIndexed);
+	cmd->IndexCount = indexCount;
+	cmd->InstanceCount = instanceCount;
+	cmd->StartIndex = startIndex;
+	cmd->BaseVertex = baseVertex;
+	cmd->StartInstance = startInstance;
+}
+
+const CommandStream::Header* CommandStream::First()const
+{
+	return mWords.empty() ? nullptr : reinterpret_cast<const Header*>(mWords.data());
+}
+
+const CommandStream::Header* CommandStream::Next(const Header* header)const
+{
+	const std::uint8_t* next = reinterpret_cast<const std::uint8_t*>(header) + header->Size;
+	const std::uint8_t* end = reinterpret_cast<const std::uint8_t*>(mWords.data() + mWords.size());
+
+	return next < end ? reinterpret_cast<const Header*>(next) : nullptr;
+}
+
+std::uint64_t CommandStream::Hash()const
+{
+	std::uint64_t hash = 14695981039346656037ull;
+
+	const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(mWords.data());
+	for(std::size_t i = 0; i < ByteSize(); ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+std::string CommandStream::Dump()const
+{
+	std::ostringstream out;
+
+	for(const Header* h = First(); h != nullptr; h = Next(h))
+	{
+		out << CommandName(h->Type);
+
+		switch(h->Type)
+		{
+		case CmdSetPipeline:
+			out << " " << reinterpret_cast<const SetPipelineCmd*>(h)->Pipeline;
+			break;
+		case CmdSetRootSignature:
+			out << " " << reinterpret_cast<const SetRootSignatureCmd*>(h)->RootSignature;
+			break;
+		case CmdSetPrimitiveTopology:
+			out << " " << reinterpret_cast<const SetPrimitiveTopologyCmd*>(h)->Topology;
+			break;
+		case CmdSetVertexBuffer:
+		{
+			auto cmd = reinterpret_cast<const SetVertexBufferCmd*>(h);
+			out << " 0x" << std::hex << cmd->Address << std::dec << " " << cmd->SizeInBytes << " " << cmd->Stride;
+			break;
+		}
+		case CmdSetIndexBuffer:
+		{
+			auto cmd = reinterpret_cast<const SetIndexBufferCmd*>(h);
+			out << " 0x" << std::hex << cmd->Address << std::dec << " " << cmd->SizeInBytes << " " << cmd->Format;
+			break;
+		}
+		case CmdSetRootConstant:
+		{
+			auto cmd = reinterpret_cast<const SetRootConstantCmd*>(h);
+			out << " " << cmd->Param << " " << cmd->Value << " " << cmd->Offset;
+			break;
+		}
+		case CmdSetRootTable:
+		case CmdSetRootCbv:
+		case CmdSetRootSrv:
+		{
+			auto cmd = reinterpret_cast<const SetRootAddressCmd*>(h);
+			out << " " << cmd->Param << " 0x" << std::hex << cmd->Address << std::dec;
+			break;
+		}
+		case CmdDrawIndexed:
+		{
+			auto cmd = reinterpret_cast<const DrawIndexedCmd*>(h);
+			out << " " << cmd->IndexCount << " " << cmd->InstanceCount << " " << cmd->StartIndex
+				<< " " << cmd->BaseVertex << " " << cmd->StartInstance;
+			break;
+		}
+		}
+
+		out << "\n";
+	}
+
+	return out.str();
+}
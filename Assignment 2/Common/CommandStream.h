@@ -0,0 +1,124 @@
+//***************************************************************************************
+// CommandStream.h
+//
+// API-neutral list of draw commands.  Commands are small POD records packed into one
+// linear byte buffer; a backend replays them (CommandStreamD3D12) or just checks and
+// counts them (NullCommandBackend).  GPU addresses and descriptor handles are stored
+// as plain integers and pipelines/root signatures as ids handed out by the backend,
+// so recording needs no device and two recordings can be compared byte for byte.
+//
+// Binding commands that would not change the current state are dropped at record time.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CommandStream
+{
+public:
+	enum CommandType : std::uint16_t
+	{
+		CmdSetPipeline = 0,
+		CmdSetRootSignature,
+		CmdSetPrimitiveTopology,
+		CmdSetVertexBuffer,
+		CmdSetIndexBuffer,
+		CmdSetRootConstant,
+		CmdSetRootTable,
+		CmdSetRootCbv,
+		CmdSetRootSrv,
+		CmdDrawIndexed,
+		CmdCount
+	};
+
+	// Every command starts with a header; Size includes the header and padding.
+	struct Header
+	{
+		std::uint16_t Type;
+		std::uint16_t Size;
+	};
+
+	struct SetPipelineCmd { Header H; std::uint32_t Pipeline; };
+	struct SetRootSignatureCmd { Header H; std::uint32_t RootSignature; };
+	struct SetPrimitiveTopologyCmd { Header H; std::uint32_t Topology; };
+	struct SetVertexBufferCmd { Header H; std::uint32_t SizeInBytes; std::uint64_t Address; std::uint32_t Stride; };
+	struct SetIndexBufferCmd { Header H; std::uint32_t SizeInBytes; std::uint64_t Address; std::uint32_t Format; };
+	struct SetRootConstantCmd { Header H; std::uint32_t Param; std::uint32_t Value; std::uint32_t Offset; };
+	struct SetRootAddressCmd { Header H; std::uint32_t Param; std::uint64_t Address; };
+	struct DrawIndexedCmd
+	{
+		Header H;
+		std::uint32_t IndexCount;
+		std::uint32_t InstanceCount;
+		std::uint32_t StartIndex;
+		std::int32_t BaseVertex;
+		std::uint32_t StartInstance;
+	};
+
+	static const std::uint32_t MaxRootParameters = 16;
+
+	CommandStream();
+	CommandStream(const CommandStream& rhs) = delete;
+	CommandStream& operator=(const CommandStream& rhs) = delete;
+
+	// Empties the stream and forgets the tracked state.  Capacity is kept.
+	void Reset();
+
+	void SetPipeline(std::uint32_t pipeline);
+	void SetRootSignature(std::uint32_t rootSignature);
+	void SetPrimitiveTopology(std::uint32_t topology);
+	void SetVertexBuffer(std::uint64_t address, std::uint32_t sizeInBytes, std::uint32_t stride);
+	void SetIndexBuffer(std::uint64_t address, std::uint32_t sizeInBytes, std::uint32_t format);
+	void SetRootConstant(std::uint32_t param, std::uint32_t value, std::uint32_t offset = 0);
+	void SetRootTable(std::uint32_t param, std::uint64_t gpuDescriptor);
+	void SetRootCbv(std::uint32_t param, std::uint64_t address);
+	void SetRootSrv(std::uint32_t param, std::uint64_t address);
+	void DrawIndexed(std::uint32_t indexCount, std::uint32_t instanceCount,
+		std::uint32_t startIndex, std::int32_t baseVertex, std::uint32_t startInstance);
+
+	// Iteration: for(auto h = stream.First(); h != nullptr; h = stream.Next(h)).
+	const Header* First()const;
+	const Header* Next(const Header* header)const;
+
+	std::size_t ByteSize()const { return mWords.size() * sizeof(std::uint64_t); }
+	std::uint32_t CommandCount()const { return mCommandCount; }
+	std::uint32_t RedundantCommandsSkipped()const { return mSkipped; }
+
+	// FNV-1a over the encoded commands.
+	std::uint64_t Hash()const;
+
+	// One line per command, for diffing recordings.
+	std::string Dump()const;
+
+private:
+	template<typename T>
+	T* Push(CommandType type);
+
+	void SetRootAddress(CommandType type, std::uint32_t param, std::uint64_t address);
+
+private:
+	// Stored as zero-filled 64-bit words so every command is 8-byte aligned and
+	// padding bytes are deterministic.
+	std::vector<std::uint64_t> mWords;
+
+	std::uint32_t mCommandCount = 0;
+	std::uint32_t mSkipped = 0;
+
+	// Last recorded bindings, used to drop redundant commands.
+	struct BoundState
+	{
+		std::uint32_t Pipeline = ~0u;
+		std::uint32_t RootSignature = ~0u;
+		std::uint32_t Topology = ~0u;
+		std::uint64_t VertexBuffer = ~0ull;
+		std::uint32_t VertexBufferSize = 0;
+		std::uint64_t IndexBuffer = ~0ull;
+		std::uint32_t IndexBufferSize = 0;
+		std::uint64_t RootAddresses[MaxRootParameters];
+	};
+
+	BoundState mBound;
+};
@@ -0,0 +1,107 @@
+//***************************************************************************************
+// CommandStreamD3D12.cpp
+//***************************************************************************************
+
+#include "CommandStreamD3D12.h"
+
+std::uint32_t CommandStreamD3D12::RegisterPipeline(ID3D12PipelineState* pso)
+{
+	mPipelines.push_back(pso);
+	return (std::uint32_t)mPipelines.size() - 1;
+}
+
+void CommandStreamD3D12::ReplacePipeline(std::uint32_t id, ID3D12PipelineState* pso)
+{
+	assert(id < mPipelines.size());
+	mPipelines[id] = pso;
+}
+
+std::uint32_t CommandStreamD3D12::RegisterRootSignature(ID3D12RootSignature* rootSignature)
+{
+	mRootSignatures.push_back(rootSignature);
+	return (std::uint32_t)mRootSignatures.size() - 1;
+}
+
+void CommandStreamD3D12::Execute(const CommandStream& stream, ID3D12GraphicsCommandList* cmdList)const
+{
+	for(const CommandStream::Header* h = stream.First(); h != nullptr; h = stream.Next(h))
+	{
+		switch(h->Type)
+		{
+		case CommandStream::CmdSetPipeline:
+		{
+			auto cmd = reinterpret_cast<const CommandStream::SetPipelineCmd*>(h);
+			cmdList->SetPipelineState(mPipelines[cmd->Pipeline]);
+			break;
+		}
+		case CommandStream::CmdSetRootSignature:
+		{
+			auto cmd = reinterpret_cast<const CommandStream::SetRootSignatureCmd*>(h);
+			cmdList->SetGraphicsRootSignature(mRootSignatures[cmd->RootSignature]);
+			break;
+		}
+		case CommandStream::CmdSetPrimitiveTopology:
+		{
+			auto cmd = reinterpret_cast<const CommandStream::SetPrimitiveTopologyCmd*>(h);
+			cmdList->IASetPrimitiveTopology((D3D12_PRIMITIVE_TOPOLOGY)cmd->Topology);
+			break;
+		}
+		case CommandStream::CmdSetVertexBuffer:
+		{
+			auto cmd = reinterpret_cast<const CommandStream::SetVertexBufferCmd*>(h);
+			D3D12_VERTEX_BUFFER_VIEW vbv;
+			vbv.BufferLocation = cmd->Address;
+			vbv.SizeInBytes = cmd->SizeInBytes;
+			vbv.StrideInBytes = cmd->Stride;
+			cmdList->IASetVertexBuffers(0, 1, &vbv);
+			break;
+		}
+		case CommandStream::CmdSetIndexBuffer:
+		{
+			auto cmd = reinterpret_cast<const CommandStream::SetIndexBufferCmd*>(h);
+			D3D12_INDEX_BUFFER_VIEW ibv;
+			ibv.BufferLocation = cmd->Address;
+			ibv.SizeInBytes = cmd->SizeInBytes;
+			ibv.Format = (DXGI_FORMAT)cmd->Format;
+			cmdList->IASetIndexBuffer(&ibv);
+			break;
+		}
+		case CommandStream::CmdSetRootConstant:
+		{
+			auto cmd = reinterpret_cast<const CommandStream::SetRootConstantCmd*>(h);
+			cmdList->SetGraphicsRoot32BitConstant(cmd->Param, cmd->Value, cmd->Offset);
+			break;
+		}
+		case CommandStream::CmdSetRootTable:
+		{
+			auto cmd = reinterpret_cast<const CommandStream::SetRootAddressCmd*>(h);
+			D3D12_GPU_DESCRIPTOR_HANDLE handle;
+			handle.ptr = cmd->Address;
+			cmdList->SetGraphicsRootDescriptorTable(cmd->Param, handle);
+			break;
+		}
+		case CommandStream::CmdSetRootCbv:
+		{
+			auto cmd = reinterpret_cast<const CommandStream::SetRootAddressCmd*>(h);
+			cmdList->SetGraphicsRootConstantBufferView(cmd->Param, cmd->Address);
+			break;
+		}
+		case CommandStream::CmdSetRootSrv:
+		{
+			auto cmd = reinterpret_cast<const CommandStream::SetRootAddressCmd*>(h);
+			cmdList->SetGraphicsRootShaderResourceView(cmd->Param, cmd->Address);
+			break;
+		}
+		case CommandStream::CmdDrawIndexed:
+		{
+			auto cmd = reinterpret_cast<const CommandStream::DrawIndexedCmd*>(h);
+			cmdList->DrawIndexedInstanced(cmd->IndexCount, cmd->InstanceCount, cmd->StartIndex,
+				cmd->BaseVertex, cmd->StartInstance);
+			break;
+		}
+		default:
+			assert(false && "Corrupt command stream.");
+			return;
+		}
+	}
+}
@@ -0,0 +1,32 @@
+//***************************************************************************************
+// CommandStreamD3D12.h
+//
+// Replays a CommandStream on a D3D12 graphics command list.  Pipelines and root
+// signatures are registered once and referred to by id in the stream.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "CommandStream.h"
+
+class CommandStreamD3D12
+{
+public:
+	CommandStreamD3D12() = default;
+	CommandStreamD3D12(const CommandStreamD3D12& rhs) = delete;
+	CommandStreamD3D12& operator=(const CommandStreamD3D12& rhs) = delete;
+
+	// The objects are not AddRef'd; the caller keeps them alive while registered.
+	std::uint32_t RegisterPipeline(ID3D12PipelineState* pso);
+	std::uint32_t RegisterRootSignature(ID3D12RootSignature* rootSignature);
+
+	// Points a registered id at a rebuilt PSO.  Not while a stream is executing.
+	void ReplacePipeline(std::uint32_t id, ID3D12PipelineState* pso);
+
+	void Execute(const CommandStream& stream, ID3D12GraphicsCommandList* cmdList)const;
+
+private:
+	std::vector<ID3D12PipelineState*> mPipelines;
+	std::vector<ID3D12RootSignature*> mRootSignatures;
+};
@@ -0,0 +1,532 @@
+//***************************************************************************************
+// CommonBenchmarks.cpp
+//***************************************************************************************
+
+#include "CommonBenchmarks.h"
+#include "BuddyAllocator.h"
+#include "ClothSystem.h"
+#include "GeometryGenerator.h"
+#include "LinearArena.h"
+#include "MathHelper.h"
+#include "QualityGovernor.h"
+#include "Random.h"
+#include "StressScene.h"
+#include "TaskPool.h"
+#include <algorithm>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Element counts for the array kernels: in L1, in L2, and well past it.
+	const std::uint64_t ArraySizes[] = { 256, 4096, 65536 };
+
+	void GeometryBenchmarks(BenchmarkRunner& runner)
+	{
+		GeometryGenerator geoGen;
+
+		for(std::uint32_t subdivisions : { 0u, 2u, 4u })
+		{
+			runner.Run("GeometryGenerator::CreateBox", subdivisions, [&]()
+			{
+				DoNotOptimize(geoGen.CreateBox(1.0f, 1.0f, 1.0f, subdivisions));
+			});
+
+			runner.Run("GeometryGenerator::CreateGeosphere", subdivisions, [&]()
+			{
+				DoNotOptimize(geoGen.CreateGeosphere(1.0f, subdivisions));
+			});
+		}
+
+		for(std::uint32_t slices : { 20u, 80u, 320u })
+		{
+			runner.Run("GeometryGenerator::CreateSphere", slices, [&]()
+			{
+				DoNotOptimize(geoGen.CreateSphere(1.0f, slices, slices));
+			});
+
+			runner.Run("GeometryGenerator::CreateCylinder", slices, [&]()
+			{
+				DoNotOptimize(geoGen.CreateCylinder(1.0f, 1.0f, 2.0f, slices, slices));
+			});
+		}
+
+		for(std::uint32_t n : { 16u, 128u, 512u })
+		{
+			runner.Run("GeometryGenerator::CreateGrid", n, [&]()
+			{
+				DoNotOptimize(geoGen.CreateGrid(100.0f, 100.0f, n, n));
+			});
+		}
+
+		// Subdivide works in place, so each call starts from a copy.
+		for(std::uint32_t subdivisions : { 0u, 2u, 4u })
+		{
+			const GeometryGenerator::MeshData source = geoGen.CreateBox(1.0f, 1.0f, 1.0f, subdivisions);
+			runner.Run("GeometryGenerator::Subdivide", source.Indices32.size() / 3, [&]()
+			{
+				GeometryGenerator::MeshData mesh = source;
+				geoGen.Subdivide(mesh);
+				DoNotOptimize(mesh);
+			});
+		}
+	}
+
+	void ScalarMathBenchmarks(BenchmarkRunner& runner)
+	{
+		const std::uint64_t calls = 1024;
+
+		runner.Run("MathHelper::RandF", calls, [&]()
+		{
+			float sum = 0.0f;
+			for(std::uint64_t i = 0; i < calls; ++i)
+				sum += MathHelper::RandF();
+			DoNotOptimize(sum);
+		});
+
+		runner.Run("MathHelper::RandUnitVec3", calls, [&]()
+		{
+			XMVECTOR sum = XMVectorZero();
+			for(std::uint64_t i = 0; i < calls; ++i)
+				sum = XMVectorAdd(sum, MathHelper::RandUnitVec3());
+			DoNotOptimize(sum);
+		});
+
+		runner.Run("MathHelper::AngleFromXY", calls, [&]()
+		{
+			float sum = 0.0f;
+			for(std::uint64_t i = 0; i < calls; ++i)
+				sum += MathHelper::AngleFromXY((float)i - 512.0f, 100.0f);
+			DoNotOptimize(sum);
+		});
+
+		const XMMATRIX world = XMMatrixScaling(2.0f, 3.0f, 4.0f) *
+			XMMatrixRotationRollPitchYaw(0.3f, 0.5f, 0.7f) * XMMatrixTranslation(1.0f, 2.0f, 3.0f);
+		runner.Run("MathHelper::InverseTranspose", calls, [&]()
+		{
+			XMMATRIX m = world;
+			for(std::uint64_t i = 0; i < calls; ++i)
+				m = MathHelper::InverseTranspose(m);
+			DoNotOptimize(m);
+		});
+	}
+
+	void BatchMathBenchmarks(BenchmarkRunner& runner)
+	{
+		const XMMATRIX world = XMMatrixScaling(2.0f, 3.0f, 4.0f) *
+			XMMatrixRotationRollPitchYaw(0.3f, 0.5f, 0.7f) * XMMatrixTranslation(1.0f, 2.0f, 3.0f);
+
+		for(std::uint64_t size : ArraySizes)
+		{
+			const std::size_t n = (std::size_t)size;
+			Xoshiro128x4 rng(size);
+
+			std::vector<float> floats(n * 12);
+			rng.FillRange(floats.data(), floats.size(), -10.0f, 10.0f);
+			float* f = floats.data();
+
+			std::vector<XMFLOAT3> points(n);
+			for(std::size_t i = 0; i < n; ++i)
+				points[i] = XMFLOAT3(f[i], f[n + i], f[2 * n + i]);
+			std::vector<XMFLOAT3> transformed(n);
+
+			runner.Run("MathHelper::TransformPoints/aos", size, [&]()
+			{
+				MathHelper::TransformPoints(points.data(), transformed.data(), n, world);
+				DoNotOptimize(transformed);
+			});
+
+			MathHelper::Float3Arrays in;
+			in.X = f; in.Y = f + n; in.Z = f + 2 * n;
+			MathHelper::Float3Arrays out;
+			out.X = f + 3 * n; out.Y = f + 4 * n; out.Z = f + 5 * n;
+
+			runner.Run("MathHelper::TransformPoints/soa", size, [&]()
+			{
+				MathHelper::TransformPoints(in, out, n, world);
+				DoNotOptimize(floats);
+			});
+
+			runner.Run("MathHelper::TransformNormals/soa", size, [&]()
+			{
+				MathHelper::TransformNormals(in, out, n, world);
+				DoNotOptimize(floats);
+			});
+
+			std::vector<BoundingBox> boxes(n);
+			for(std::size_t i = 0; i < n; ++i)
+				boxes[i] = BoundingBox(points[i], XMFLOAT3(1.0f, 2.0f, 3.0f));
+			std::vector<BoundingBox> worldBoxes(n);
+
+			runner.Run("MathHelper::TransformAabbs", size, [&]()
+			{
+				MathHelper::TransformAabbs(boxes.data(), worldBoxes.data(), n, world);
+				DoNotOptimize(worldBoxes);
+			});
+
+			// The same work through DirectXMath's corner-based BoundingBox::Transform.
+			runner.Run("BoundingBox::Transform", size, [&]()
+			{
+				for(std::size_t i = 0; i < n; ++i)
+					boxes[i].Transform(worldBoxes[i], world);
+				DoNotOptimize(worldBoxes);
+			});
+
+			std::vector<XMFLOAT4X4> matrices(n);
+			std::vector<XMFLOAT4X4> products(n);
+			for(std::size_t i = 0; i < n; ++i)
+				XMStoreFloat4x4(&matrices[i], XMMatrixTranslation(f[i], f[n + i], f[2 * n + i]) * world);
+
+			runner.Run("MathHelper::MultiplyMatrices", size, [&]()
+			{
+				MathHelper::MultiplyMatrices(matrices.data(), world, products.data(), n);
+				DoNotOptimize(products);
+			});
+
+			runner.Run("MathHelper::TransposeMatrices", size, [&]()
+			{
+				MathHelper::TransposeMatrices(matrices.data(), products.data(), n);
+				DoNotOptimize(products);
+			});
+
+			std::vector<XMFLOAT3> scales(n, XMFLOAT3(1.0f, 2.0f, 3.0f));
+			std::vector<XMFLOAT4> rotations(n);
+			MathHelper::Float4Arrays rotationArrays;
+			rotationArrays.X = f + 6 * n; rotationArrays.Y = f + 7 * n;
+			rotationArrays.Z = f + 8 * n; rotationArrays.W = f + 9 * n;
+			for(std::size_t i = 0; i < n; ++i)
+			{
+				XMVECTOR q = XMQuaternionNormalize(XMVectorSet(
+					rotationArrays.X[i], rotationArrays.Y[i], rotationArrays.Z[i], rotationArrays.W[i]));
+				XMStoreFloat4(&rotations[i], q);
+				rotationArrays.X[i] = rotations[i].x;
+				rotationArrays.Y[i] = rotations[i].y;
+				rotationArrays.Z[i] = rotations[i].z;
+				rotationArrays.W[i] = rotations[i].w;
+			}
+
+			runner.Run("MathHelper::BuildTrsMatrices/aos", size, [&]()
+			{
+				MathHelper::BuildTrsMatrices(scales.data(), rotations.data(), points.data(), products.data(), n);
+				DoNotOptimize(products);
+			});
+
+			// Scale and translation share the position arrays; only the cost matters here.
+			runner.Run("MathHelper::BuildTrsMatrices/soa", size, [&]()
+			{
+				MathHelper::BuildTrsMatrices(in, rotationArrays, in, products.data(), n);
+				DoNotOptimize(products);
+			});
+
+			std::vector<XMFLOAT3> directions(n);
+			runner.Run("MathHelper::FillUnitVec3/xoshiro", size, [&]()
+			{
+				MathHelper::FillUnitVec3(rng, directions.data(), n);
+				DoNotOptimize(directions);
+			});
+
+			runner.Run("MathHelper::FillUnitVec3/philox", size, [&]()
+			{
+				MathHelper::FillUnitVec3(size, 0, directions.data(), n);
+				DoNotOptimize(directions);
+			});
+		}
+	}
+
+	void RandomBenchmarks(BenchmarkRunner& runner)
+	{
+		for(std::uint64_t size : ArraySizes)
+		{
+			std::vector<float> out((std::size_t)size);
+
+			Pcg32 pcg(size);
+			runner.Run("Pcg32::NextFloat", size, [&]()
+			{
+				for(float& x : out)
+					x = pcg.NextFloat();
+				DoNotOptimize(out);
+			});
+
+			Xoshiro128x4 xoshiro(size);
+			runner.Run("Xoshiro128x4::FillFloats", size, [&]()
+			{
+				xoshiro.FillFloats(out.data(), out.size());
+				DoNotOptimize(out);
+			});
+
+			runner.Run("Philox4x32::FillFloats", size, [&]()
+			{
+				Philox4x32::FillFloats(size, 0, out.data(), out.size());
+				DoNotOptimize(out);
+			});
+		}
+	}
+
+	// The per-frame CPU stages over generated scenes, to show how each scales with the
+	// item count.
+	void StressSceneBenchmarks(BenchmarkRunner& runner)
+	{
+		GeometryGenerator geoGen;
+		const GeometryGenerator::MeshData meshes[] =
+		{
+			geoGen.CreateBox(1.0f, 1.0f, 1.0f, 0),
+			geoGen.CreateCylinder(0.5f, 0.5f, 3.0f, 20, 20),
+			geoGen.CreateSphere(0.5f, 20, 20),
+			geoGen.CreateGeosphere(0.5f, 2),
+		};
+
+		StressSceneDesc desc;
+		desc.MaterialCount = 32;
+		for(const GeometryGenerator::MeshData& mesh : meshes)
+		{
+			BoundingBox bounds;
+			BoundingBox::CreateFromPoints(bounds, mesh.Vertices.size(), &mesh.Vertices[0].Position, sizeof(GeometryGenerator::Vertex));
+			desc.MeshBounds.push_back(bounds);
+		}
+
+		// A camera at the edge of the world looking across it.
+		BoundingFrustum frustum;
+		BoundingFrustum::CreateFromMatrix(frustum, XMMatrixPerspectiveFovLH(0.25f * MathHelper::Pi, 1.5f, 1.0f, 1000.0f));
+		frustum.Origin = XMFLOAT3(0.0f, 10.0f, -0.5f * desc.WorldSize);
+		const XMVECTOR rayOrigin = XMLoadFloat3(&frustum.Origin);
+		const XMVECTOR rayDirection = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+
+		for(std::uint32_t count : { 10000u, 100000u, 1000000u })
+		{
+			desc.ItemCount = count;
+			StressScene scene;
+
+			runner.Run("StressScene::Generate", count, [&]()
+			{
+				GenerateStressScene(desc, scene);
+			});
+			if(scene.ItemCount() != count)
+				GenerateStressScene(desc, scene);
+
+			std::vector<XMFLOAT4X4> constants(count);
+			runner.Run("StressScene::UpdateConstants", count, [&]()
+			{
+				StressSceneUpdateConstants(scene, constants.data());
+				DoNotOptimize(constants);
+			});
+
+			std::vector<std::uint32_t> visible(count);
+			std::uint32_t visibleCount = 0;
+			runner.Run("StressScene::Cull", count, [&]()
+			{
+				visibleCount = StressSceneCull(scene, frustum, visible.data());
+				DoNotOptimize(visible);
+			});
+
+			// Sorts a fresh copy of the visible list each time; the copy is part of the cost.
+			std::vector<std::uint32_t> sorted(visibleCount);
+			runner.Run("StressScene::Sort", count, [&]()
+			{
+				std::copy(visible.begin(), visible.begin() + visibleCount, sorted.begin());
+				StressSceneSort(scene, sorted.data(), visibleCount);
+				DoNotOptimize(sorted);
+			});
+
+			runner.Run("StressScene::Collide", count, [&]()
+			{
+				DoNotOptimize(StressSceneCollide(scene, rayOrigin, rayDirection, 10.0f));
+			});
+		}
+	}
+
+	// Mesh-sized requests (256 B to 64 KB) into a 256 MB heap: fill to size allocations,
+	// then free them in a shuffled order so the frees do real merging.
+	void BuddyAllocatorBenchmarks(BenchmarkRunner& runner)
+	{
+		for(std::uint64_t size : ArraySizes)
+		{
+			Pcg32 rng(76);
+			std::vector<std::uint64_t> requests((std::size_t)size);
+			for(std::uint64_t& request : requests)
+				request = 256ull << rng.NextBounded(9);
+
+			std::vector<std::uint32_t> order((std::size_t)size);
+			for(std::uint32_t i = 0; i < order.size(); ++i)
+				order[i] = i;
+			for(std::uint32_t i = (std::uint32_t)order.size() - 1; i > 0; --i)
+				std::swap(order[i], order[rng.NextBounded(i + 1)]);
+
+			BuddyAllocator allocator(256ull << 20, 256);
+			std::vector<std::uint64_t> offsets((std::size_t)size);
+			runner.Run("BuddyAllocator::Allocate+Free", size, [&]()
+			{
+				for(std::size_t i = 0; i < requests.size(); ++i)
+					offsets[i] = allocator.Allocate(requests[i]);
+				for(std::uint32_t i : order)
+				{
+					if(offsets[i] != BuddyAllocator::InvalidOffset)
+						allocator.Free(offsets[i]);
+				}
+			});
+		}
+	}
+
+	// Each arena case has a std::allocator twin over the same sizes, so the two can be
+	// compared in one report.  The +grow cases push without reserve: the arena cannot
+	// reuse outgrown storage, so there the heap is expected to win.
+	void ArenaBenchmarks(BenchmarkRunner& runner)
+	{
+		for(std::uint64_t size : ArraySizes)
+		{
+			LinearArena arena;
+			runner.Run("LinearArena::Allocate", size, [&]()
+			{
+				arena.Reset();
+				for(std::uint64_t i = 0; i < size; ++i)
+					DoNotOptimize(arena.Allocate(32, 16));
+			});
+
+			std::vector<void*> blocks((std::size_t)size);
+			runner.Run("operator new+delete", size, [&]()
+			{
+				for(void*& block : blocks)
+					block = ::operator new(32);
+				DoNotOptimize(blocks);
+				for(void* block : blocks)
+					::operator delete(block);
+			});
+
+			runner.Run("ArenaVector::push_back", size, [&]()
+			{
+				ScratchScope scope;
+				ArenaVector<std::uint32_t> v{ ArenaAllocator<std::uint32_t>(scope.Arena()) };
+				v.reserve((std::size_t)size);
+				for(std::uint64_t i = 0; i < size; ++i)
+					v.push_back((std::uint32_t)i);
+				DoNotOptimize(v);
+			});
+
+			runner.Run("std::vector::push_back", size, [&]()
+			{
+				std::vector<std::uint32_t> v;
+				v.reserve((std::size_t)size);
+				for(std::uint64_t i = 0; i < size; ++i)
+					v.push_back((std::uint32_t)i);
+				DoNotOptimize(v);
+			});
+
+			runner.Run("ArenaVector::push_back+grow", size, [&]()
+			{
+				ScratchScope scope;
+				ArenaVector<std::uint32_t> v{ ArenaAllocator<std::uint32_t>(scope.Arena()) };
+				for(std::uint64_t i = 0; i < size; ++i)
+					v.push_back((std::uint32_t)i);
+				DoNotOptimize(v);
+			});
+
+			runner.Run("std::vector::push_back+grow", size, [&]()
+			{
+				std::vector<std::uint32_t> v;
+				for(std::uint64_t i = 0; i < size; ++i)
+					v.push_back((std::uint32_t)i);
+				DoNotOptimize(v);
+			});
+
+			// Many short-lived 16-element vectors, as in per-item temporaries.
+			runner.Run("ArenaVector(16)", size, [&]()
+			{
+				for(std::uint64_t i = 0; i < size; ++i)
+				{
+					ScratchScope scope;
+					ArenaVector<std::uint32_t> v{ ArenaAllocator<std::uint32_t>(scope.Arena()) };
+					v.assign(16, (std::uint32_t)i);
+					DoNotOptimize(v);
+				}
+			});
+
+			runner.Run("std::vector(16)", size, [&]()
+			{
+				for(std::uint64_t i = 0; i < size; ++i)
+				{
+					std::vector<std::uint32_t> v(16, (std::uint32_t)i);
+					DoNotOptimize(v);
+				}
+			});
+		}
+	}
+
+	// The governor driven by a synthetic load: a base time that steps every 500 frames
+	// plus a fixed cost per level of each knob, with a little noise.
+	void QualityGovernorBenchmarks(BenchmarkRunner& runner)
+	{
+		const double knobCostMs[4] = { 0.3, 2.0, 0.05, 1.0 };
+		const double baseMs[4] = { 6.0, 14.0, 9.0, 11.0 };
+
+		for(std::uint64_t frames : { 1000ull, 10000ull })
+		{
+			runner.Run("QualityGovernor::Update", frames, [&]()
+			{
+				QualityGovernor governor;
+				for(int k = 0; k < 4; ++k)
+				{
+					QualityGovernor::KnobDesc desc;
+					desc.MaxLevel = 4;
+					desc.Level = 4;
+					governor.AddKnob(desc);
+				}
+
+				Pcg32 rng(7);
+				for(std::uint64_t f = 0; f < frames; ++f)
+				{
+					double frameMs = baseMs[(f / 500) % 4] + rng.NextFloat(-0.5f, 0.5f);
+					for(QualityGovernor::Knob k = 0; k < governor.KnobCount(); ++k)
+						frameMs += knobCostMs[k] * governor.Level(k);
+					governor.Update(frameMs);
+				}
+				DoNotOptimize(governor.Changes());
+			});
+		}
+	}
+
+	// One 60 Hz frame of flags laid out in rows like the demo's, on this thread and on
+	// a pool.  Each run is one fixed step plus the vertex write.
+	void ClothBenchmarks(BenchmarkRunner& runner)
+	{
+		TaskPool pool(TaskPool::DefaultWorkerCount());
+
+		for(std::uint32_t flags : { 16u, 64u, 256u })
+		{
+			ClothSystem cloth;
+			for(std::uint32_t i = 0; i < flags; ++i)
+			{
+				ClothSystem::ClothDesc desc;
+				desc.Origin = XMFLOAT3(10.0f * (i % 16), 12.0f, -6.0f * (i / 16));
+				cloth.AddCloth(desc);
+			}
+
+			std::vector<ClothSystem::Vertex> vertices(cloth.VertexCount());
+			runner.Run("ClothSystem::Update", flags, [&]()
+			{
+				cloth.Update(1.0f / 60.0f, nullptr, vertices.data());
+				DoNotOptimize(vertices);
+			});
+
+			runner.Run("ClothSystem::Update (pool)", flags, [&]()
+			{
+				cloth.Update(1.0f / 60.0f, &pool, vertices.data());
+				DoNotOptimize(vertices);
+			});
+		}
+	}
+}
+
+void RunCommonBenchmarks(BenchmarkRunner& runner)
+{
+	GeometryBenchmarks(runner);
+	ScalarMathBenchmarks(runner);
+	BatchMathBenchmarks(runner);
+	RandomBenchmarks(runner);
+	BuddyAllocatorBenchmarks(runner);
+	ArenaBenchmarks(runner);
+	StressSceneBenchmarks(runner);
+	QualityGovernorBenchmarks(runner);
+	ClothBenchmarks(runner);
+}
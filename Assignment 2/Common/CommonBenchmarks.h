@@ -0,0 +1,17 @@
+//***************************************************************************************
+// CommonBenchmarks.h
+//
+// Benchmark cases for the device-independent parts of Common: GeometryGenerator,
+// MathHelper's scalar helpers and batch kernels, the random generators, the buddy
+// allocator, the arenas, the per-frame stages over generated stress scenes of 10k to
+// 1M items, the quality governor under a synthetic load, and cloth frames for 16 to
+// 256 flags.  Each case runs at several input sizes.
+// These sources and Benchmark.cpp need only the standard library and the DirectXMath
+// headers, so they build outside Windows too.
+//***************************************************************************************
+
+#pragma once
+
+#include "Benchmark.h"
+
+void RunCommonBenchmarks(BenchmarkRunner& runner);
@@ -0,0 +1,158 @@
+//***************************************************************************************
+// DescriptorAllocator.cpp
+//***************************************************************************************
+
+#include "DescriptorAllocator.h"
+#include <cassert>
+#include <iterator>
+
+DescriptorAllocator::DescriptorAllocator(std::uint32_t persistentCount, std::uint32_t transientCountPerFrame, std::uint32_t frameCount) :
+	mPersistentCount(persistentCount),
+	mTransientCountPerFrame(transientCountPerFrame),
+	mFrameCount(frameCount)
+{
+	assert(frameCount > 0);
+
+	mCapacity = persistentCount + transientCountPerFrame * frameCount;
+	mFrameCursors.resize(frameCount, 0);
+
+	if(persistentCount > 0)
+		mFreeRanges[0] = persistentCount;
+}
+
+void DescriptorAllocator::InsertFree(std::uint32_t start, std::uint32_t count)
+{
+	auto next = mFreeRanges.lower_bound(start);
+
+	// Merge with the run that ends right where this one starts.
+	if(next != mFreeRanges.begin())
+	{
+		auto prev = std::prev(next);
+		assert(prev->first + prev->second <= start && "Range freed twice.");
+		if(prev->first + prev->second == start)
+		{
+			start = prev->first;
+			count += prev->second;
+			mFreeRanges.erase(prev);
+		}
+	}
+
+	// Merge with the run that starts right where this one ends.
+	if(next != mFreeRanges.end())
+	{
+		assert(start + count <= next->first && "Range freed twice.");
+		if(start + count == next->first)
+		{
+			count += next->second;
+			mFreeRanges.erase(next);
+		}
+	}
+
+	mFreeRanges[start] = count;
+}
+
+DescriptorAllocator::Range DescriptorAllocator::AllocatePersistent(std::uint32_t count)
+{
+	Range range;
+	if(count == 0)
+		return range;
+
+	for(auto it = mFreeRanges.begin(); it != mFreeRanges.end(); ++it)
+	{
+		if(it->second < count)
+			continue;
+
+		range.Start = it->first;
+		range.Count = count;
+
+		std::uint32_t remaining = it->second - count;
+		mFreeRanges.erase(it);
+		if(remaining > 0)
+			mFreeRanges[range.Start + count] = remaining;
+
+		mPersistentAllocated += count;
+		if(mPersistentAllocated > mPeakPersistentAllocated)
+			mPeakPersistentAllocated = mPersistentAllocated;
+
+		break;
+	}
+
+	return range;
+}
+
+void DescriptorAllocator::Free(const Range& range, std::uint64_t fenceValue)
+{
+	if(!range.IsValid())
+		return;
+
+	assert(range.Start + range.Count <= mPersistentCount);
+	assert(mPendingFrees.empty() || mPendingFrees.back().Fence <= fenceValue);
+
+	PendingFree pending;
+	pending.FreedRange = range;
+	pending.Fence = fenceValue;
+	mPendingFrees.push_back(pending);
+
+	mPersistentAllocated -= range.Count;
+	mPendingFreeCount += range.Count;
+}
+
+void DescriptorAllocator::Retire(std::uint64_t completedFenceValue)
+{
+	while(!mPendingFrees.empty() && mPendingFrees.front().Fence <= completedFenceValue)
+	{
+		const Range& range = mPendingFrees.front().FreedRange;
+		InsertFree(range.Start, range.Count);
+		mPendingFreeCount -= range.Count;
+		mPendingFrees.pop_front();
+	}
+}
+
+void DescriptorAllocator::BeginFrame(std::uint32_t frameIndex)
+{
+	assert(frameIndex < mFrameCount);
+
+	mCurrentFrame = frameIndex;
+	mFrameCursors[frameIndex] = 0;
+}
+
+DescriptorAllocator::Range DescriptorAllocator::AllocateTransient(std::uint32_t count)
+{
+	Range range;
+
+	std::uint32_t& cursor = mFrameCursors[mCurrentFrame];
+	if(count == 0 || cursor + count > mTransientCountPerFrame)
+		return range;
+
+	range.Start = mPersistentCount + mCurrentFrame * mTransientCountPerFrame + cursor;
+	range.Count = count;
+
+	cursor += count;
+	if(cursor > mPeakTransientUsed)
+		mPeakTransientUsed = cursor;
+
+	return range;
+}
+
+DescriptorAllocator::Stats DescriptorAllocator::GetStats()const
+{
+	Stats stats;
+	stats.Capacity = mCapacity;
+	stats.PersistentCapacity = mPersistentCount;
+	stats.PersistentAllocated = mPersistentAllocated;
+	stats.PeakPersistentAllocated = mPeakPersistentAllocated;
+	stats.PendingFree = mPendingFreeCount;
+	stats.FreeRangeCount = (std::uint32_t)mFreeRanges.size();
+
+	for(auto& r : mFreeRanges)
+	{
+		if(r.second > stats.LargestFreeRange)
+			stats.LargestFreeRange = r.second;
+	}
+
+	stats.TransientCapacityPerFrame = mTransientCountPerFrame;
+	stats.TransientUsed = mFrameCursors[mCurrentFrame];
+	stats.PeakTransientUsed = mPeakTransientUsed;
+
+	return stats;
+}
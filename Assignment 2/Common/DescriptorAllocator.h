@@ -0,0 +1,107 @@
+//***************************************************************************************
+// DescriptorAllocator.h
+//
+// Hands out index ranges in a descriptor heap.  The heap is split in two:
+//
+//   [0, persistentCount)            long-lived ranges (texture SRVs etc.) managed by a
+//                                   coalescing free list.  Freed ranges are held back
+//                                   until the GPU fence they were freed with completes.
+//   [persistentCount, capacity)     one linear region per frame resource for
+//                                   descriptors that only live for a single frame.
+//
+// Only indices and fence values are handled here, so it is device-independent.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+
+class DescriptorAllocator
+{
+public:
+	static const std::uint32_t InvalidIndex = ~0u;
+
+	struct Range
+	{
+		std::uint32_t Start = InvalidIndex;
+		std::uint32_t Count = 0;
+
+		bool IsValid()const { return Start != InvalidIndex; }
+	};
+
+	struct Stats
+	{
+		std::uint32_t Capacity = 0;
+
+		std::uint32_t PersistentCapacity = 0;
+		std::uint32_t PersistentAllocated = 0;
+		std::uint32_t PeakPersistentAllocated = 0;
+
+		// Freed but still waiting for their fence.
+		std::uint32_t PendingFree = 0;
+
+		std::uint32_t FreeRangeCount = 0;
+		std::uint32_t LargestFreeRange = 0;
+
+		std::uint32_t TransientCapacityPerFrame = 0;
+		std::uint32_t TransientUsed = 0;
+		std::uint32_t PeakTransientUsed = 0;
+	};
+
+	DescriptorAllocator(std::uint32_t persistentCount, std::uint32_t transientCountPerFrame, std::uint32_t frameCount);
+	DescriptorAllocator(const DescriptorAllocator& rhs) = delete;
+	DescriptorAllocator& operator=(const DescriptorAllocator& rhs) = delete;
+
+	// First fit over the persistent free list.  Returns an invalid range when no free
+	// run is long enough.
+	Range AllocatePersistent(std::uint32_t count);
+
+	// The range goes back on the free list once completedFenceValue passed to
+	// Retire() reaches fenceValue.
+	void Free(const Range& range, std::uint64_t fenceValue);
+	void Retire(std::uint64_t completedFenceValue);
+
+	// Starts recording frame frameIndex.  The caller must already have waited for the
+	// GPU to finish the last frame that used this index, since its linear region is
+	// reused from the start.
+	void BeginFrame(std::uint32_t frameIndex);
+
+	// Linear allocation from the current frame's region.  Returns an invalid range
+	// when the region is exhausted.
+	Range AllocateTransient(std::uint32_t count);
+
+	std::uint32_t Capacity()const { return mCapacity; }
+	std::uint32_t PersistentCount()const { return mPersistentCount; }
+
+	Stats GetStats()const;
+
+private:
+	void InsertFree(std::uint32_t start, std::uint32_t count);
+
+private:
+	struct PendingFree
+	{
+		Range FreedRange;
+		std::uint64_t Fence = 0;
+	};
+
+	std::uint32_t mCapacity = 0;
+	std::uint32_t mPersistentCount = 0;
+	std::uint32_t mTransientCountPerFrame = 0;
+	std::uint32_t mFrameCount = 0;
+
+	// Free persistent runs keyed by start index.  Neighbouring runs are always merged.
+	std::map<std::uint32_t, std::uint32_t> mFreeRanges;
+	std::deque<PendingFree> mPendingFrees;
+
+	std::uint32_t mPersistentAllocated = 0;
+	std::uint32_t mPeakPersistentAllocated = 0;
+	std::uint32_t mPendingFreeCount = 0;
+
+	std::uint32_t mCurrentFrame = 0;
+	std::vector<std::uint32_t> mFrameCursors;
+	std::uint32_t mPeakTransientUsed = 0;
+};
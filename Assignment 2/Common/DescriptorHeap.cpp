@@ -0,0 +1,105 @@
+//***************************************************************************************
+// DescriptorHeap.cpp
+//***************************************************************************************
+
+#include "DescriptorHeap.h"
+
+using Microsoft::WRL::ComPtr;
+
+DescriptorHeap::DescriptorHeap(ID3D12Device* device, UINT persistentCount, UINT transientCountPerFrame, UINT frameCount) :
+	md3dDevice(device),
+	mAllocator(persistentCount, transientCountPerFrame, frameCount)
+{
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+	heapDesc.NumDescriptors = mAllocator.Capacity();
+	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(mHeap.GetAddressOf())));
+
+	mDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+	for(UINT i = 0; i < mAllocator.PersistentCount(); ++i)
+		CreateNullSrv(i);
+}
+
+DescriptorHeap::~DescriptorHeap()
+{
+}
+
+CD3DX12_CPU_DESCRIPTOR_HANDLE DescriptorHeap::CpuHandle(UINT index)const
+{
+	return CD3DX12_CPU_DESCRIPTOR_HANDLE(mHeap->GetCPUDescriptorHandleForHeapStart(), index, mDescriptorSize);
+}
+
+CD3DX12_GPU_DESCRIPTOR_HANDLE DescriptorHeap::GpuHandle(UINT index)const
+{
+	return CD3DX12_GPU_DESCRIPTOR_HANDLE(mHeap->GetGPUDescriptorHandleForHeapStart(), index, mDescriptorSize);
+}
+
+DescriptorHeap::Range DescriptorHeap::AllocatePersistent(UINT count)
+{
+	Range range = mAllocator.AllocatePersistent(count);
+	if(!range.IsValid())
+		ThrowIfFailed(E_OUTOFMEMORY);
+
+	return range;
+}
+
+DescriptorHeap::Range DescriptorHeap::AllocateTransient(UINT count)
+{
+	Range range = mAllocator.AllocateTransient(count);
+	if(!range.IsValid())
+		ThrowIfFailed(E_OUTOFMEMORY);
+
+	return range;
+}
+
+void DescriptorHeap::CreateTextureSrv(ID3D12Resource* texture, UINT index)
+{
+	auto desc = texture->GetDesc();
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = desc.Format;
+
+	if(desc.DepthOrArraySize > 1)
+	{
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MostDetailedMip = 0;
+		srvDesc.Texture2DArray.MipLevels = -1;
+		srvDesc.Texture2DArray.FirstArraySlice = 0;
+		srvDesc.Texture2DArray.ArraySize = desc.DepthOrArraySize;
+	}
+	else
+	{
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MostDetailedMip = 0;
+		srvDesc.Texture2D.MipLevels = desc.MipLevels;
+		srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
+	}
+
+	md3dDevice->CreateShaderResourceView(texture, &srvDesc, CpuHandle(index));
+}
+
+void DescriptorHeap::CreateNullSrv(UINT index)
+{
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MipLevels = 1;
+
+	md3dDevice->CreateShaderResourceView(nullptr, &srvDesc, CpuHandle(index));
+}
+
+std::wstring DescriptorHeap::StatsString()const
+{
+	auto stats = GetStats();
+
+	return L"DescriptorHeap: " + std::to_wstring(stats.Capacity) + L" descriptors; persistent " +
+		std::to_wstring(stats.PersistentAllocated) + L"/" + std::to_wstring(stats.PersistentCapacity) +
+		L" (peak " + std::to_wstring(stats.PeakPersistentAllocated) + L", pending free " +
+		std::to_wstring(stats.PendingFree) + L"); transient peak " +
+		std::to_wstring(stats.PeakTransientUsed) + L"/" + std::to_wstring(stats.TransientCapacityPerFrame) +
+		L" per frame\n";
+}
@@ -0,0 +1,57 @@
+//***************************************************************************************
+// DescriptorHeap.h
+//
+// A shader-visible CBV/SRV/UAV heap whose slots are managed by a DescriptorAllocator.
+// Persistent ranges hold descriptors that live as long as their resource; each frame
+// resource also gets a linear region that is recycled by BeginFrame().  The persistent
+// region is filled with null SRVs up front, so a descriptor table spanning all of it
+// never reads an uninitialized descriptor.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "DescriptorAllocator.h"
+
+class DescriptorHeap
+{
+public:
+	using Range = DescriptorAllocator::Range;
+
+	DescriptorHeap(ID3D12Device* device, UINT persistentCount, UINT transientCountPerFrame, UINT frameCount);
+	DescriptorHeap(const DescriptorHeap& rhs) = delete;
+	DescriptorHeap& operator=(const DescriptorHeap& rhs) = delete;
+	~DescriptorHeap();
+
+	ID3D12DescriptorHeap* Heap()const { return mHeap.Get(); }
+	UINT DescriptorSize()const { return mDescriptorSize; }
+
+	// Handles to the index-th descriptor of the heap.
+	CD3DX12_CPU_DESCRIPTOR_HANDLE CpuHandle(UINT index)const;
+	CD3DX12_GPU_DESCRIPTOR_HANDLE GpuHandle(UINT index)const;
+
+	// Throws if the heap is full; size the heap for the scene up front.
+	Range AllocatePersistent(UINT count);
+	void Free(const Range& range, UINT64 fenceValue) { mAllocator.Free(range, fenceValue); }
+	void Retire(UINT64 completedFenceValue) { mAllocator.Retire(completedFenceValue); }
+
+	void BeginFrame(UINT frameIndex) { mAllocator.BeginFrame(frameIndex); }
+	Range AllocateTransient(UINT count);
+
+	// Creates a 2D or 2D-array SRV covering every mip of the texture in the given slot.
+	void CreateTextureSrv(ID3D12Resource* texture, UINT index);
+
+	// Writes a null 2D texture SRV, which reads as zero, to the given slot.
+	void CreateNullSrv(UINT index);
+
+	DescriptorAllocator::Stats GetStats()const { return mAllocator.GetStats(); }
+	std::wstring StatsString()const;
+
+private:
+	ID3D12Device* md3dDevice = nullptr;
+
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mHeap;
+	UINT mDescriptorSize = 0;
+
+	DescriptorAllocator mAllocator;
+};
@@ -0,0 +1,70 @@
+//***************************************************************************************
+// DrawTables.h
+//
+// The per-object and per-material tables the demo's shaders read, and the 32-bit root
+// constant that selects a row of each for a draw.  Kept free of D3D so the layouts and
+// the packing can be checked headless against the shader source.
+//***************************************************************************************
+
+#pragma once
+
+#include "MathHelper.h"
+#include <DirectXMath.h>
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+// Per-object and per-material records.  All of them are packed densely into one
+// StructuredBuffer each, so the layouts must match ObjectData/MaterialData in the shaders.
+struct ObjectData
+{
+	DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4();
+	DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
+};
+
+struct MaterialData
+{
+	DirectX::XMFLOAT4 DiffuseAlbedo = { 1.0f, 1.0f, 1.0f, 1.0f };
+	DirectX::XMFLOAT3 FresnelR0 = { 0.01f, 0.01f, 0.01f };
+	float Roughness = 0.25f;
+
+	// Used in texture mapping.
+	DirectX::XMFLOAT4X4 MatTransform = MathHelper::Identity4x4();
+
+	// Descriptor index of the diffuse texture when textures are bound bindless.
+	std::uint32_t DiffuseMapIndex = 0;
+	std::uint32_t MaterialPad0;
+	std::uint32_t MaterialPad1;
+	std::uint32_t MaterialPad2;
+};
+
+static_assert(sizeof(ObjectData) == 128, "ObjectData no longer matches the shader layout.");
+static_assert(sizeof(MaterialData) == 112, "MaterialData no longer matches the shader layout.");
+
+// A draw identifies its object and material with a single 32-bit root constant:
+// the object index in the low 20 bits and the material index in the high 12 bits.
+// A scene can therefore index at most MaxDrawObjectIndex + 1 objects (enough for a
+// million-item stress scene plus the demo) and MaxDrawMaterialIndex + 1 materials.
+// The shaders and SoftwareShading.cpp unpack the same layout.
+const std::uint32_t DrawMaterialShift = 20;
+const std::uint32_t MaxDrawObjectIndex = (1u << DrawMaterialShift) - 1;
+const std::uint32_t MaxDrawMaterialIndex = (1u << (32 - DrawMaterialShift)) - 1;
+
+// Throws if an object or material index does not fit in the packed root constant.
+// Checked once when the scene is built; PackDrawIndices only asserts.
+inline void CheckDrawIndices(std::uint32_t objectIndex, std::uint32_t materialIndex)
+{
+	if(objectIndex > MaxDrawObjectIndex)
+		throw std::out_of_range("Object index " + std::to_string(objectIndex) +
+			" exceeds the draw table limit of " + std::to_string(MaxDrawObjectIndex) + ".");
+	if(materialIndex > MaxDrawMaterialIndex)
+		throw std::out_of_range("Material index " + std::to_string(materialIndex) +
+			" exceeds the draw table limit of " + std::to_string(MaxDrawMaterialIndex) + ".");
+}
+
+inline std::uint32_t PackDrawIndices(std::uint32_t objectIndex, std::uint32_t materialIndex)
+{
+	assert(objectIndex <= MaxDrawObjectIndex && materialIndex <= MaxDrawMaterialIndex);
+	return (materialIndex << DrawMaterialShift) | objectIndex;
+}
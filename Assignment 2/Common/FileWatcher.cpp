@@ -0,0 +1,202 @@
+//***************************************************************************************
+// FileWatcher.cpp
+//***************************************************************************************
+
+#include "FileWatcher.h"
+#include "GameTimer.h"
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace
+{
+	// "dir/" for "dir/file", "" for a file in the working directory.
+	std::string DirectoryOf(const std::string& path)
+	{
+		std::size_t slash = path.find_last_of('/');
+		return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+	}
+}
+
+FileWatcher::FileWatcher()
+	: FileWatcher(Config())
+{
+}
+
+FileWatcher::FileWatcher(const Config& config, ClockFunction clock)
+	: mConfig(config), mClock(std::move(clock))
+{
+#ifdef __linux__
+	if(!mConfig.ForcePolling)
+		mNotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+	if(mNotifyFd >= 0)
+		close(mNotifyFd);
+#endif
+}
+
+bool FileWatcher::Watch(const std::string& path)
+{
+	const std::string key = NormalizePath(path);
+	if(mFiles.count(key) != 0)
+		return true;
+
+#ifdef __linux__
+	if(mNotifyFd >= 0)
+	{
+		// Watching the same directory again returns its existing descriptor.
+		const std::string directory = DirectoryOf(key);
+		const int wd = inotify_add_watch(mNotifyFd, directory.empty() ? "." : directory.c_str(),
+			IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE);
+		if(wd < 0)
+			return false;
+		mWatchDirectories[wd] = directory;
+	}
+#endif
+
+	FileState& state = mFiles[key];
+	Stat(key, state.ModifiedTime, state.Size);
+	return true;
+}
+
+void FileWatcher::Poll(std::vector<std::string>& changed)
+{
+	const std::int64_t now = Now();
+	if(mNotifyFd >= 0)
+		ReadNotifications(now);
+	else
+		PollTimestamps(now);
+
+	if(mPending == 0)
+		return;
+
+	for(auto& e : mFiles)
+	{
+		FileState& state = e.second;
+		if(state.LastEventNs == 0 || now - state.LastEventNs < mConfig.SettleNs)
+			continue;
+
+		changed.push_back(e.first);
+		state.LastEventNs = 0;
+		mPending--;
+	}
+}
+
+std::string FileWatcher::NormalizePath(const std::string& path)
+{
+	std::string normalized = path;
+	for(char& c : normalized)
+	{
+		if(c == '\\')
+			c = '/';
+	}
+
+	while(normalized.compare(0, 2, "./") == 0)
+		normalized.erase(0, 2);
+	return normalized;
+}
+
+std::int64_t FileWatcher::Now()const
+{
+	return mClock ? mClock() : GameTimer::SteadyClockNow();
+}
+
+void FileWatcher::ReadNotifications(std::int64_t now)
+{
+#ifdef __linux__
+	alignas(inotify_event) char buffer[4096];
+	for(;;)
+	{
+		const ssize_t bytes = read(mNotifyFd, buffer, sizeof(buffer));
+		if(bytes <= 0)
+			break;
+
+		for(ssize_t offset = 0; offset < bytes; )
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+			offset += sizeof(inotify_event) + event->len;
+
+			// Events were dropped; any file may have changed.
+			if(event->mask & IN_Q_OVERFLOW)
+			{
+				for(auto& e : mFiles)
+				{
+					if(e.second.LastEventNs == 0)
+						mPending++;
+					e.second.LastEventNs = now;
+				}
+				continue;
+			}
+
+			auto directory = mWatchDirectories.find(event->wd);
+			if(event->len == 0 || directory == mWatchDirectories.end())
+				continue;
+
+			auto file = mFiles.find(directory->second + event->name);
+			if(file == mFiles.end())
+				continue;
+
+			if(file->second.LastEventNs == 0)
+				mPending++;
+			file->second.LastEventNs = now;
+		}
+	}
+#else
+	(void)now;
+#endif
+}
+
+void FileWatcher::PollTimestamps(std::int64_t now)
+{
+	if(now < mNextPollNs)
+		return;
+	mNextPollNs = now + mConfig.PollIntervalNs;
+
+	for(auto& e : mFiles)
+	{
+		// A file that is missing mid-save keeps its old state and is compared again
+		// on the next poll.
+		std::int64_t modifiedTime = 0;
+		std::int64_t size = 0;
+		FileState& state = e.second;
+		if(!Stat(e.first, modifiedTime, size) || (modifiedTime == state.ModifiedTime && size == state.Size))
+			continue;
+
+		state.ModifiedTime = modifiedTime;
+		state.Size = size;
+		if(state.LastEventNs == 0)
+			mPending++;
+		state.LastEventNs = now;
+	}
+}
+
+bool FileWatcher::Stat(const std::string& path, std::int64_t& modifiedTime, std::int64_t& size)
+{
+#ifdef _WIN32
+	struct _stat64 st;
+	if(_stat64(path.c_str(), &st) != 0)
+		return false;
+	modifiedTime = (std::int64_t)st.st_mtime * GameTimer::TicksPerSecond;
+#else
+	struct stat st;
+	if(stat(path.c_str(), &st) != 0)
+		return false;
+#ifdef __linux__
+	modifiedTime = (std::int64_t)st.st_mtim.tv_sec * GameTimer::TicksPerSecond + st.st_mtim.tv_nsec;
+#else
+	modifiedTime = (std::int64_t)st.st_mtime * GameTimer::TicksPerSecond;
+#endif
+#endif
+
+	size = (std::int64_t)st.st_size;
+	return true;
+}
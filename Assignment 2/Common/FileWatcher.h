@@ -0,0 +1,84 @@
+//***************************************************************************************
+// FileWatcher.h
+//
+// Reports files that changed on disk, for reloading assets while running.  On Linux
+// the directories holding the watched files are watched with inotify, so files that
+// editors save by writing a copy and renaming it over the original are still seen.
+// Elsewhere the files' modification times and sizes are compared every
+// PollIntervalNs instead.
+//
+// Saves usually arrive as several writes, so a file is reported once it has had no
+// events for SettleNs, and only once for the whole burst.
+//
+// Device independent; the clock is injectable like FramePacer's.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class FileWatcher
+{
+public:
+	typedef std::function<std::int64_t()> ClockFunction;
+
+	struct Config
+	{
+		std::int64_t SettleNs = 100000000;
+		std::int64_t PollIntervalNs = 250000000;
+
+		// Compare timestamps even where notifications are available.
+		bool ForcePolling = false;
+	};
+
+	FileWatcher();
+	explicit FileWatcher(const Config& config, ClockFunction clock = ClockFunction());
+	FileWatcher(const FileWatcher& rhs) = delete;
+	FileWatcher& operator=(const FileWatcher& rhs) = delete;
+	~FileWatcher();
+
+	// Starts watching path.  Watching a file twice is harmless.  Returns false if its
+	// directory cannot be watched.
+	bool Watch(const std::string& path);
+
+	// Files whose changes have settled since the last call, as normalized paths.
+	// Never blocks; does not allocate unless something changed.
+	void Poll(std::vector<std::string>& changed);
+
+	bool UsesNotifications()const { return mNotifyFd >= 0; }
+	std::size_t WatchedCount()const { return mFiles.size(); }
+
+	// Forward slashes, without "./" prefixes, so both sides of a lookup agree.
+	static std::string NormalizePath(const std::string& path);
+
+private:
+	struct FileState
+	{
+		std::int64_t ModifiedTime = 0;
+		std::int64_t Size = -1;
+		std::int64_t LastEventNs = 0;    // 0 while nothing is pending
+	};
+
+	std::int64_t Now()const;
+	void ReadNotifications(std::int64_t now);
+	void PollTimestamps(std::int64_t now);
+
+	// Modification time and size, or false if the file cannot be read right now.
+	static bool Stat(const std::string& path, std::int64_t& modifiedTime, std::int64_t& size);
+
+private:
+	Config mConfig;
+	ClockFunction mClock;
+
+	std::unordered_map<std::string, FileState> mFiles;
+	std::uint32_t mPending = 0;
+	std::int64_t mNextPollNs = 0;
+
+	// inotify descriptor and the directory of each watch, -1 and empty when polling.
+	int mNotifyFd = -1;
+	std::unordered_map<int, std::string> mWatchDirectories;
+};
@@ -0,0 +1,22 @@
+//***************************************************************************************
+// FrameFence.h
+//
+// The part of a GPU fence the frame loop needs: how far the GPU has got, and a way to
+// block until it gets further.  FrameFenceD3D12 wraps an ID3D12Fence; SimulatedGpu
+// implements it on a simulated timeline so frame pacing code runs headless.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+
+class FrameFence
+{
+public:
+	virtual ~FrameFence() = default;
+
+	virtual std::uint64_t CompletedValue()const = 0;
+
+	// Blocks until the fence reaches value; returns the milliseconds spent waiting.
+	virtual double WaitForValue(std::uint64_t value)const = 0;
+};
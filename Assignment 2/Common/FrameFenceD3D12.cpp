@@ -0,0 +1,40 @@
+//***************************************************************************************
+// FrameFenceD3D12.cpp
+//***************************************************************************************
+
+#include "FrameFenceD3D12.h"
+#include <chrono>
+
+FrameFenceD3D12::FrameFenceD3D12(ID3D12Fence* fence) :
+	mFence(fence)
+{
+	mEvent = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+	if(mEvent == nullptr)
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+}
+
+FrameFenceD3D12::~FrameFenceD3D12()
+{
+	if(mEvent != nullptr)
+		CloseHandle(mEvent);
+}
+
+std::uint64_t FrameFenceD3D12::CompletedValue()const
+{
+	return mFence->GetCompletedValue();
+}
+
+double FrameFenceD3D12::WaitForValue(std::uint64_t value)const
+{
+	if(mFence->GetCompletedValue() >= value)
+		return 0.0;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	// Every SetEventOnCompletion is paired with a wait, so the auto-reset event never
+	// carries a stale signal into the next call.
+	ThrowIfFailed(mFence->SetEventOnCompletion(value, mEvent));
+	WaitForSingleObject(mEvent, INFINITE);
+
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
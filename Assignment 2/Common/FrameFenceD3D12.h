@@ -0,0 +1,27 @@
+//***************************************************************************************
+// FrameFenceD3D12.h
+//
+// FrameFence over an ID3D12Fence.  One auto-reset event is created up front and reused
+// for every wait instead of creating and closing one per wait.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "FrameFence.h"
+
+class FrameFenceD3D12 : public FrameFence
+{
+public:
+	explicit FrameFenceD3D12(ID3D12Fence* fence);
+	FrameFenceD3D12(const FrameFenceD3D12& rhs) = delete;
+	FrameFenceD3D12& operator=(const FrameFenceD3D12& rhs) = delete;
+	~FrameFenceD3D12();
+
+	std::uint64_t CompletedValue()const override;
+	double WaitForValue(std::uint64_t value)const override;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12Fence> mFence;
+	HANDLE mEvent = nullptr;
+};
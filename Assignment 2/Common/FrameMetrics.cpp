@@ -0,0 +1,254 @@
+//***************************************************************************************
+// FrameMetrics.cpp
+//***************************************************************************************
+
+#include "FrameMetrics.h"
+#include "FrameFence.h"
+#include "GameTimer.h"
+#include "SimulatedGpu.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+	const char* gMetricNames[FrameMetrics::MetricCount] =
+	{
+		"frame_ms", "cpu_ms", "fence_wait_ms", "present_ms", "input_to_present_ms"
+	};
+
+	std::uint64_t MsToUs(double ms)
+	{
+		return ms > 0.0 ? (std::uint64_t)(ms * 1000.0 + 0.5) : 0;
+	}
+
+	double NsToMs(std::int64_t ns)
+	{
+		return (double)ns * 1.0e-6;
+	}
+
+	// Keeps the thread busy the way real frame work would.
+	void BusyWork(double ms)
+	{
+		const std::int64_t end = GameTimer::SteadyClockNow() + (std::int64_t)(ms * 1.0e6);
+		while(GameTimer::SteadyClockNow() < end)
+		{
+		}
+	}
+
+	bool HasValue(const FrameMetrics::Sample& sample, std::uint32_t metric)
+	{
+		if(metric == FrameMetrics::FrameTime)
+			return sample.HasFrameTime;
+		if(metric == FrameMetrics::InputToPresent)
+			return sample.HasInput;
+		return true;
+	}
+}
+
+const char* FrameMetrics::MetricName(Metric metric)
+{
+	return metric < MetricCount ? gMetricNames[metric] : "unknown";
+}
+
+void FrameMetrics::BeginFrame(std::int64_t nowNs)
+{
+	mBeginNs = nowNs;
+	mInputNs = 0;
+	mFenceWaitMs = 0.0;
+	mPresentMs = 0.0;
+}
+
+void FrameMetrics::AddFenceWait(double ms)
+{
+	mFenceWaitMs += ms;
+}
+
+void FrameMetrics::AddPresent(double ms)
+{
+	mPresentMs += ms;
+}
+
+void FrameMetrics::NoteInput(std::int64_t inputNs)
+{
+	if(inputNs != 0 && (mInputNs == 0 || inputNs < mInputNs))
+		mInputNs = inputNs;
+}
+
+void FrameMetrics::EndFrame(std::int64_t nowNs)
+{
+	Sample sample;
+	sample.Frame = mFrame;
+	sample.Ms[FenceWait] = mFenceWaitMs;
+	sample.Ms[Present] = mPresentMs;
+	sample.Ms[CpuWork] = std::max(0.0, NsToMs(nowNs - mBeginNs) - mFenceWaitMs - mPresentMs);
+
+	if(mFrame > 0)
+	{
+		sample.HasFrameTime = true;
+		sample.Ms[FrameTime] = NsToMs(nowNs - mLastEndNs);
+	}
+
+	if(mInputNs != 0)
+	{
+		sample.HasInput = true;
+		sample.Ms[InputToPresent] = NsToMs(nowNs - mInputNs);
+	}
+
+	for(std::uint32_t m = 0; m < MetricCount; ++m)
+	{
+		if(HasValue(sample, m))
+			mHistograms[m].Record(MsToUs(sample.Ms[m]));
+	}
+
+	if(mSink != nullptr)
+		mSink->Write(sample);
+
+	mLast = sample;
+	mLastEndNs = nowNs;
+	mFrame++;
+}
+
+void FrameMetrics::Reset()
+{
+	for(auto& h : mHistograms)
+		h.Reset();
+
+	mFrame = 0;
+	mLast = Sample();
+}
+
+double FrameMetrics::PercentileMs(Metric metric, double percent)const
+{
+	return (double)mHistograms[metric].ValueAtPercentile(percent) / 1000.0;
+}
+
+std::string FrameMetrics::Report()const
+{
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(3);
+	out << "Frame metrics over " << mFrame << " frames (ms):\n";
+
+	for(std::uint32_t m = 0; m < MetricCount; ++m)
+	{
+		const HdrHistogram& h = mHistograms[m];
+		const Metric metric = (Metric)m;
+
+		out << "  " << std::left << std::setw(20) << MetricName(metric) << std::right
+			<< "  count " << h.TotalCount()
+			<< "  mean " << h.Mean() / 1000.0
+			<< "  p50 " << PercentileMs(metric, 50.0)
+			<< "  p90 " << PercentileMs(metric, 90.0)
+			<< "  p99 " << PercentileMs(metric, 99.0)
+			<< "  p99.9 " << PercentileMs(metric, 99.9)
+			<< "  max " << (double)h.Max() / 1000.0 << "\n";
+	}
+
+	return out.str();
+}
+
+std::string FrameMetrics::MeasureHeadless(double cpuMs, double gpuMs,
+	std::uint32_t frameResourceCount, std::uint32_t frames, FrameMetricsSink* sink)
+{
+	SimulatedGpu gpu;
+	const FrameFence& fence = gpu;
+	std::vector<std::uint64_t> fences(frameResourceCount, 0);
+
+	FrameMetrics metrics;
+	metrics.SetSink(sink);
+
+	for(std::uint32_t frame = 0; frame < frames; ++frame)
+	{
+		metrics.BeginFrame(GameTimer::SteadyClockNow());
+
+		// Pretend every fourth frame picks up input that arrived as the frame began.
+		if(frame % 4 == 0)
+			metrics.NoteInput(GameTimer::SteadyClockNow());
+
+		std::uint64_t& frameFence = fences[frame % frameResourceCount];
+		if(fence.CompletedValue() < frameFence)
+			metrics.AddFenceWait(fence.WaitForValue(frameFence));
+
+		BusyWork(cpuMs);
+		frameFence = gpu.Submit(gpuMs);
+
+		// No swap chain here, so Present costs nothing.
+		metrics.AddPresent(0.0);
+		metrics.EndFrame(GameTimer::SteadyClockNow());
+	}
+
+	if(sink != nullptr)
+		sink->Flush();
+
+	std::ostringstream out;
+	out << "Headless frame metrics: cpu " << cpuMs << " ms, gpu " << gpuMs << " ms, "
+		<< frameResourceCount << " frame resources\n" << metrics.Report();
+	return out.str();
+}
+
+FrameMetricsSink::FrameMetricsSink(std::ostream& out) :
+	mOut(&out)
+{
+}
+
+FrameMetricsSink::FrameMetricsSink(const std::string& path) :
+	mFile(new std::ofstream(path, std::ios::out | std::ios::trunc))
+{
+	mOut = mFile.get();
+}
+
+void FrameMetricsSink::Flush()
+{
+	if(mOut != nullptr)
+		mOut->flush();
+}
+
+std::unique_ptr<FrameMetricsSink> FrameMetricsSink::Open(const std::string& path)
+{
+	const std::string csv = ".csv";
+	if(path.size() >= csv.size() && path.compare(path.size() - csv.size(), csv.size(), csv) == 0)
+		return std::unique_ptr<FrameMetricsSink>(new CsvFrameMetricsSink(path));
+
+	return std::unique_ptr<FrameMetricsSink>(new JsonLinesFrameMetricsSink(path));
+}
+
+void CsvFrameMetricsSink::Write(const FrameMetrics::Sample& sample)
+{
+	std::ostream& out = Out();
+
+	if(!mWroteHeader)
+	{
+		out << "frame";
+		for(std::uint32_t m = 0; m < FrameMetrics::MetricCount; ++m)
+			out << "," << FrameMetrics::MetricName((FrameMetrics::Metric)m);
+		out << "\n";
+		mWroteHeader = true;
+	}
+
+	out << sample.Frame << std::fixed << std::setprecision(4);
+	for(std::uint32_t m = 0; m < FrameMetrics::MetricCount; ++m)
+	{
+		out << ",";
+		if(HasValue(sample, m))
+			out << sample.Ms[m];
+	}
+	out << "\n";
+}
+
+void JsonLinesFrameMetricsSink::Write(const FrameMetrics::Sample& sample)
+{
+	std::ostream& out = Out();
+
+	out << "{\"frame\":" << sample.Frame << std::fixed << std::setprecision(4);
+	for(std::uint32_t m = 0; m < FrameMetrics::MetricCount; ++m)
+	{
+		out << ",\"" << FrameMetrics::MetricName((FrameMetrics::Metric)m) << "\":";
+		if(HasValue(sample, m))
+			out << sample.Ms[m];
+		else
+			out << "null";
+	}
+	out << "}\n";
+}
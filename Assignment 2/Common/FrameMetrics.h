@@ -0,0 +1,138 @@
+//***************************************************************************************
+// FrameMetrics.h
+//
+// Per-frame timing broken down by where the time went: CPU work, blocking on the GPU
+// fence for a frame resource, Present, and the latency from the oldest input a frame
+// consumed to that frame's Present.  Each metric feeds an HdrHistogram (microseconds)
+// for percentile queries, and every frame can also be handed to a FrameMetricsSink
+// (CSV or JSON lines) for offline analysis.
+//
+// Times are passed in as nanoseconds from a monotonic clock (GameTimer::SteadyClockNow)
+// so the same code runs against a simulated GPU in MeasureHeadless.
+//***************************************************************************************
+
+#pragma once
+
+#include "HdrHistogram.h"
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <string>
+
+class FrameMetricsSink;
+
+class FrameMetrics
+{
+public:
+	enum Metric : std::uint32_t
+	{
+		FrameTime = 0,       // Present to Present
+		CpuWork,             // BeginFrame to EndFrame, less fence waits and Present
+		FenceWait,
+		Present,
+		InputToPresent,      // only for frames that consumed input
+		MetricCount
+	};
+
+	struct Sample
+	{
+		std::uint64_t Frame = 0;
+		double Ms[MetricCount] = {};
+		bool HasFrameTime = false;
+		bool HasInput = false;
+	};
+
+	static const char* MetricName(Metric metric);
+
+	FrameMetrics() = default;
+	FrameMetrics(const FrameMetrics& rhs) = delete;
+	FrameMetrics& operator=(const FrameMetrics& rhs) = delete;
+
+	void BeginFrame(std::int64_t nowNs);
+	void AddFenceWait(double ms);
+	void AddPresent(double ms);
+
+	// Time the oldest input this frame reflects was received; the earliest call wins.
+	void NoteInput(std::int64_t inputNs);
+
+	// Call right after Present; records the frame's sample.
+	void EndFrame(std::int64_t nowNs);
+
+	// Not owned; nullptr stops writing samples.
+	void SetSink(FrameMetricsSink* sink) { mSink = sink; }
+
+	void Reset();
+
+	std::uint64_t FrameCount()const { return mFrame; }
+	const Sample& LastSample()const { return mLast; }
+	const HdrHistogram& Histogram(Metric metric)const { return mHistograms[metric]; }
+	double PercentileMs(Metric metric, double percent)const;
+
+	// One line per metric: count, mean, p50, p90, p99, p99.9 and max in milliseconds.
+	std::string Report()const;
+
+	// Runs frames through a CPU/GPU loop on a SimulatedGpu, waiting on frame resource
+	// fences through the FrameFence interface, and returns the report.
+	static std::string MeasureHeadless(double cpuMs, double gpuMs,
+		std::uint32_t frameResourceCount, std::uint32_t frames, FrameMetricsSink* sink = nullptr);
+
+private:
+	HdrHistogram mHistograms[MetricCount];
+	FrameMetricsSink* mSink = nullptr;
+
+	std::uint64_t mFrame = 0;
+	std::int64_t mBeginNs = 0;
+	std::int64_t mLastEndNs = 0;
+	std::int64_t mInputNs = 0;
+	double mFenceWaitMs = 0.0;
+	double mPresentMs = 0.0;
+	Sample mLast;
+};
+
+// Receives every frame's sample.  Writes to a stream, or to a file it opens itself.
+class FrameMetricsSink
+{
+public:
+	explicit FrameMetricsSink(std::ostream& out);
+	explicit FrameMetricsSink(const std::string& path);
+	FrameMetricsSink(const FrameMetricsSink& rhs) = delete;
+	FrameMetricsSink& operator=(const FrameMetricsSink& rhs) = delete;
+	virtual ~FrameMetricsSink() = default;
+
+	bool IsOpen()const { return mOut != nullptr && (bool)*mOut; }
+
+	virtual void Write(const FrameMetrics::Sample& sample) = 0;
+	void Flush();
+
+	// CsvFrameMetricsSink for a ".csv" path, JsonLinesFrameMetricsSink otherwise.
+	static std::unique_ptr<FrameMetricsSink> Open(const std::string& path);
+
+protected:
+	std::ostream& Out() { return *mOut; }
+
+private:
+	std::unique_ptr<std::ofstream> mFile;
+	std::ostream* mOut = nullptr;
+};
+
+// A header row, then one row per frame; an empty field where a metric has no value.
+class CsvFrameMetricsSink : public FrameMetricsSink
+{
+public:
+	using FrameMetricsSink::FrameMetricsSink;
+
+	void Write(const FrameMetrics::Sample& sample) override;
+
+private:
+	bool mWroteHeader = false;
+};
+
+// One JSON object per line; null where a metric has no value.
+class JsonLinesFrameMetricsSink : public FrameMetricsSink
+{
+public:
+	using FrameMetricsSink::FrameMetricsSink;
+
+	void Write(const FrameMetrics::Sample& sample) override;
+};
@@ -0,0 +1,192 @@
+//***************************************************************************************
+// FramePacer.cpp
+//***************************************************************************************
+
+#include "FramePacer.h"
+#include "GameTimer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+FramePacer::FramePacer(ClockFunction clock, SleepFunction sleep)
+	: mClock(std::move(clock)), mSleep(std::move(sleep))
+{
+}
+
+void FramePacer::SetConfig(const Config& config)
+{
+	mConfig = config;
+	mNextDeadline = 0;
+	mSettleFramesLeft = 0;
+	Invalidate();
+}
+
+bool FramePacer::ParseMode(const char* text, Config& config)
+{
+	if(std::strcmp(text, "unlimited") == 0)
+	{
+		config.PacingMode = Mode::Unlimited;
+		return true;
+	}
+	if(std::strcmp(text, "ondemand") == 0)
+	{
+		config.PacingMode = Mode::OnDemand;
+		return true;
+	}
+
+	char* end = nullptr;
+	const double hz = std::strtod(text, &end);
+	if(end == text || *end != '\0' || !(hz > 0.0))
+		return false;
+
+	config.PacingMode = Mode::TargetRate;
+	config.TargetHz = hz;
+	return true;
+}
+
+bool FramePacer::ShouldRender()const
+{
+	if(mConfig.PacingMode != Mode::OnDemand)
+		return true;
+
+	if(mInvalidated.load(std::memory_order_acquire) || mSettleFramesLeft > 0 || mLastFrameEnd == 0)
+		return true;
+
+	return mConfig.IdleIntervalNs > 0 && Now() - mLastFrameEnd >= mConfig.IdleIntervalNs;
+}
+
+std::int64_t FramePacer::IdleTimeoutNs()const
+{
+	if(mConfig.PacingMode != Mode::OnDemand)
+		return 0;
+	if(mConfig.IdleIntervalNs <= 0)
+		return -1;
+
+	return std::max<std::int64_t>(mLastFrameEnd + mConfig.IdleIntervalNs - Now(), 0);
+}
+
+void FramePacer::WaitForNextFrame()
+{
+	if(mConfig.PacingMode != Mode::TargetRate)
+		return;
+
+	const std::int64_t period = PeriodNs();
+	std::int64_t now = Now();
+
+	// The first frame starts the schedule.
+	if(mNextDeadline == 0)
+	{
+		mNextDeadline = now + period;
+		return;
+	}
+
+	const std::int64_t deadline = mNextDeadline;
+	if(now > deadline)
+	{
+		mStats.MissedDeadlines++;
+	}
+	else
+	{
+		if(deadline - now > mConfig.SpinNs)
+		{
+			const std::int64_t sleepStart = now;
+			if(mSleep)
+				mSleep(deadline - now - mConfig.SpinNs);
+			else
+				std::this_thread::sleep_for(std::chrono::nanoseconds(deadline - now - mConfig.SpinNs));
+			now = Now();
+			mStats.SleptNs += now - sleepStart;
+		}
+
+		const std::int64_t spinStart = now;
+		while(now < deadline)
+		{
+			std::this_thread::yield();
+			now = Now();
+		}
+		mStats.SpunNs += now - spinStart;
+	}
+
+	// Keep the cadence after a slightly late frame; start over after a long stall
+	// rather than rendering a burst of frames to catch up.
+	mNextDeadline = deadline + period;
+	if(mNextDeadline <= now)
+		mNextDeadline = now + period;
+}
+
+void FramePacer::FrameRendered()
+{
+	const std::int64_t now = Now();
+	if(mLastFrameEnd != 0)
+	{
+		const std::int64_t interval = now - mLastFrameEnd;
+		mStats.IntervalUs.Record((std::uint64_t)std::max<std::int64_t>(interval, 0) / 1000);
+		if(mConfig.PacingMode == Mode::TargetRate)
+			mStats.JitterUs.Record((std::uint64_t)std::llabs(interval - PeriodNs()) / 1000);
+	}
+	mLastFrameEnd = now;
+	mStats.Frames++;
+
+	// An Invalidate during this frame may not be reflected in it, so it restarts the
+	// settle count.
+	if(mInvalidated.exchange(false, std::memory_order_acq_rel))
+		mSettleFramesLeft = mConfig.SettleFrames;
+	else if(mSettleFramesLeft > 0)
+		mSettleFramesLeft--;
+}
+
+void FramePacer::ResetStats()
+{
+	mStats = Stats();
+}
+
+std::string FramePacer::Report()const
+{
+	const char* modes[] = { "unlimited", "target rate", "on demand" };
+
+	char line[320];
+	std::snprintf(line, sizeof(line),
+		"Frame pacing (%s", modes[(int)mConfig.PacingMode]);
+	std::string report = line;
+	if(mConfig.PacingMode == Mode::TargetRate)
+	{
+		std::snprintf(line, sizeof(line), ", %.1f Hz", mConfig.TargetHz);
+		report += line;
+	}
+
+	std::snprintf(line, sizeof(line),
+		"): %llu frames, interval p50 %.3f p99 %.3f max %.3f ms",
+		(unsigned long long)mStats.Frames,
+		mStats.IntervalUs.ValueAtPercentile(50.0) * 1.0e-3,
+		mStats.IntervalUs.ValueAtPercentile(99.0) * 1.0e-3,
+		mStats.IntervalUs.Max() * 1.0e-3);
+	report += line;
+
+	if(mConfig.PacingMode == Mode::TargetRate)
+	{
+		std::snprintf(line, sizeof(line),
+			", jitter p50 %.3f p99 %.3f max %.3f ms, %llu missed deadlines, slept %.1f s, spun %.1f s",
+			mStats.JitterUs.ValueAtPercentile(50.0) * 1.0e-3,
+			mStats.JitterUs.ValueAtPercentile(99.0) * 1.0e-3,
+			mStats.JitterUs.Max() * 1.0e-3,
+			(unsigned long long)mStats.MissedDeadlines,
+			mStats.SleptNs * 1.0e-9,
+			mStats.SpunNs * 1.0e-9);
+		report += line;
+	}
+
+	return report + "\n";
+}
+
+std::int64_t FramePacer::Now()const
+{
+	return mClock ? mClock() : GameTimer::SteadyClockNow();
+}
+
+std::int64_t FramePacer::PeriodNs()const
+{
+	return (std::int64_t)(GameTimer::TicksPerSecond / mConfig.TargetHz);
+}
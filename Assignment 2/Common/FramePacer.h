@@ -0,0 +1,119 @@
+//***************************************************************************************
+// FramePacer.h
+//
+// Decides when the main loop renders its next frame.
+//
+//   Unlimited    renders back to back, as fast as Update/Draw/Present allow.
+//   TargetRate   renders at a fixed rate.  WaitForNextFrame sleeps until SpinNs before
+//                the frame's deadline and spins the rest, since OS sleeps wake late by
+//                up to a timer period.  Deadlines advance by whole periods, so one
+//                late frame does not shift the ones after it.
+//   OnDemand     renders only after Invalidate (input, camera or simulation changes),
+//                plus SettleFrames more so pipelined frames catch up, and otherwise at
+//                most every IdleIntervalNs.  The loop blocks for messages in between.
+//
+// Every rendered frame's Present-to-Present interval is recorded, and in TargetRate
+// mode its distance from the period (jitter), both in microsecond HdrHistograms.
+//
+// Device independent: the clock and the sleep are injectable, so the pacing can be
+// run against a fake clock.
+//***************************************************************************************
+
+#pragma once
+
+#include "HdrHistogram.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+class FramePacer
+{
+public:
+	// Nanoseconds from a monotonic origin, and a sleep of about the given nanoseconds.
+	typedef std::function<std::int64_t()> ClockFunction;
+	typedef std::function<void(std::int64_t)> SleepFunction;
+
+	enum class Mode
+	{
+		Unlimited,
+		TargetRate,
+		OnDemand
+	};
+
+	struct Config
+	{
+		Mode PacingMode = Mode::Unlimited;
+		double TargetHz = 60.0;
+
+		// TargetRate: the part of each wait spent spinning instead of sleeping.
+		std::int64_t SpinNs = 2000000;
+
+		// OnDemand: frames rendered after the last Invalidate, and the longest time
+		// between frames (0 waits for an Invalidate however long it takes).
+		std::uint32_t SettleFrames = 3;
+		std::int64_t IdleIntervalNs = 0;
+	};
+
+	struct Stats
+	{
+		std::uint64_t Frames = 0;
+		std::uint64_t MissedDeadlines = 0;    // TargetRate frames that started late
+		std::int64_t SleptNs = 0;
+		std::int64_t SpunNs = 0;
+		HdrHistogram IntervalUs;
+		HdrHistogram JitterUs;                // TargetRate only
+	};
+
+	// Empty functions use GameTimer::SteadyClockNow and std::this_thread::sleep_for.
+	explicit FramePacer(ClockFunction clock = ClockFunction(), SleepFunction sleep = SleepFunction());
+	FramePacer(const FramePacer& rhs) = delete;
+	FramePacer& operator=(const FramePacer& rhs) = delete;
+
+	// Restarts the schedule; the stats are kept.
+	void SetConfig(const Config& config);
+	const Config& GetConfig()const { return mConfig; }
+
+	// Parses "unlimited", "ondemand" or a rate in Hz into config.  Returns false and
+	// leaves config alone if text is none of those.
+	static bool ParseMode(const char* text, Config& config);
+
+	// Something visible changed.  May be called from any thread.
+	void Invalidate() { mInvalidated.store(true, std::memory_order_release); }
+
+	// Whether the loop should render now.  Always true outside OnDemand.
+	bool ShouldRender()const;
+
+	// How long the loop may block waiting for messages before ShouldRender can turn
+	// true on its own, or -1 for indefinitely.  0 outside OnDemand.
+	std::int64_t IdleTimeoutNs()const;
+
+	// TargetRate: waits for the next frame's deadline.  Otherwise returns at once.
+	void WaitForNextFrame();
+
+	// Call after each frame is presented.
+	void FrameRendered();
+
+	const Stats& GetStats()const { return mStats; }
+	void ResetStats();
+
+	// Frames, interval and jitter percentiles, missed deadlines and sleep/spin split.
+	std::string Report()const;
+
+private:
+	std::int64_t Now()const;
+	std::int64_t PeriodNs()const;
+
+private:
+	ClockFunction mClock;
+	SleepFunction mSleep;
+	Config mConfig;
+
+	std::atomic<bool> mInvalidated{ true };
+	std::uint32_t mSettleFramesLeft = 0;
+
+	std::int64_t mNextDeadline = 0;      // 0 until the first frame
+	std::int64_t mLastFrameEnd = 0;      // 0 until the first frame
+
+	Stats mStats;
+};
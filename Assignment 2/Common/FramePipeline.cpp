@@ -0,0 +1,216 @@
+//***************************************************************************************
+// FramePipeline.cpp
+//***************************************************************************************
+
+#include "FramePipeline.h"
+#include "SimulatedGpu.h"
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	double MsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	// Keeps the thread busy the way real simulation or recording work would.
+	void BusyWork(double ms)
+	{
+		const Clock::time_point start = Clock::now();
+		while(MsSince(start) < ms)
+		{
+		}
+	}
+}
+
+FramePipeline::~FramePipeline()
+{
+	Stop();
+}
+
+void FramePipeline::Start(const ProduceCallback& produce)
+{
+	assert(!IsRunning());
+
+	mProduce = produce;
+	mProduced.store(0);
+	mConsumed.store(0);
+	mStop.store(false);
+	mAcquired = false;
+	mProducerWaitUs.store(0);
+	mConsumerWaitUs.store(0);
+
+	mThread = std::thread(&FramePipeline::ProducerMain, this);
+}
+
+void FramePipeline::Stop()
+{
+	if(!IsRunning())
+		return;
+
+	mStop.store(true);
+	mThread.join();
+	mAcquired = false;
+}
+
+template<typename Predicate>
+double FramePipeline::WaitFor(Predicate done)
+{
+	if(done())
+		return 0.0;
+
+	const Clock::time_point start = Clock::now();
+	for(std::uint32_t spin = 0; !done() && !mStop.load(std::memory_order_relaxed); ++spin)
+	{
+		if(spin < 64)
+			continue;
+		else if(spin < 256)
+			std::this_thread::yield();
+		else
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+
+	return MsSince(start);
+}
+
+void FramePipeline::ProducerMain()
+{
+	for(std::uint64_t frame = 0; ; ++frame)
+	{
+		// Wait for a free slot: the consumer must have finished frame - PacketCount.
+		double waitMs = WaitFor([&]()
+		{
+			return frame - mConsumed.load(std::memory_order_acquire) < PacketCount;
+		});
+		mProducerWaitUs.fetch_add((std::uint64_t)(waitMs * 1000.0), std::memory_order_relaxed);
+
+		if(mStop.load(std::memory_order_relaxed))
+			return;
+
+		mProduce((std::uint32_t)(frame % PacketCount), frame);
+
+		mProduced.store(frame + 1, std::memory_order_release);
+	}
+}
+
+bool FramePipeline::Acquire(std::uint32_t& slot, std::uint64_t& frame)
+{
+	assert(!mAcquired);
+
+	if(!IsRunning())
+		return false;
+
+	const std::uint64_t next = mConsumed.load(std::memory_order_relaxed);
+	double waitMs = WaitFor([&]()
+	{
+		return mProduced.load(std::memory_order_acquire) > next;
+	});
+	mConsumerWaitUs.fetch_add((std::uint64_t)(waitMs * 1000.0), std::memory_order_relaxed);
+
+	if(mProduced.load(std::memory_order_acquire) <= next)
+		return false;
+
+	slot = (std::uint32_t)(next % PacketCount);
+	frame = next;
+	mAcquired = true;
+	return true;
+}
+
+void FramePipeline::Release()
+{
+	if(!mAcquired)
+		return;
+
+	mAcquired = false;
+	mConsumed.fetch_add(1, std::memory_order_release);
+}
+
+FramePipeline::Stats FramePipeline::GetStats()const
+{
+	Stats stats;
+	stats.Frames = mConsumed.load(std::memory_order_relaxed);
+	stats.ProducerWaitMs = mProducerWaitUs.load(std::memory_order_relaxed) / 1000.0;
+	stats.ConsumerWaitMs = mConsumerWaitUs.load(std::memory_order_relaxed) / 1000.0;
+	return stats;
+}
+
+std::string FramePipeline::StatsString()const
+{
+	Stats stats = GetStats();
+
+	char text[160];
+	std::snprintf(text, sizeof(text), "Frame pipeline: %llu frames, sim waited %.1f ms, render waited %.1f ms\n",
+		(unsigned long long)stats.Frames, stats.ProducerWaitMs, stats.ConsumerWaitMs);
+	return text;
+}
+
+std::string FramePipeline::MeasureHeadless(double simMs, double renderMs, double gpuMs,
+	std::uint32_t frameResourceCount, std::uint32_t frames)
+{
+	// Render stage: wait for the frame resource to come back from the GPU, record, submit.
+	auto renderFrame = [&](SimulatedGpu& gpu, std::vector<std::uint64_t>& fences, std::uint64_t frame)
+	{
+		std::uint64_t& fence = fences[frame % frameResourceCount];
+		gpu.WaitForValue(fence);
+		BusyWork(renderMs);
+		fence = gpu.Submit(gpuMs);
+	};
+
+	double serialMs = 0.0;
+	{
+		SimulatedGpu gpu;
+		std::vector<std::uint64_t> fences(frameResourceCount, 0);
+
+		const Clock::time_point start = Clock::now();
+		for(std::uint64_t frame = 0; frame < frames; ++frame)
+		{
+			BusyWork(simMs);
+			renderFrame(gpu, fences, frame);
+		}
+		serialMs = MsSince(start);
+	}
+
+	double pipelinedMs = 0.0;
+	Stats stats;
+	{
+		SimulatedGpu gpu;
+		std::vector<std::uint64_t> fences(frameResourceCount, 0);
+		FramePipeline pipeline;
+
+		const Clock::time_point start = Clock::now();
+		pipeline.Start([&](std::uint32_t, std::uint64_t) { BusyWork(simMs); });
+
+		std::uint32_t slot = 0;
+		std::uint64_t frame = 0;
+		for(std::uint32_t i = 0; i < frames && pipeline.Acquire(slot, frame); ++i)
+		{
+			renderFrame(gpu, fences, frame);
+			pipeline.Release();
+		}
+		pipelinedMs = MsSince(start);
+
+		stats = pipeline.GetStats();
+		pipeline.Stop();
+	}
+
+	auto fps = [&](double ms) { return ms > 0.0 ? frames * 1000.0 / ms : 0.0; };
+
+	double boundMs = simMs > renderMs ? simMs : renderMs;
+	if(gpuMs > boundMs)
+		boundMs = gpuMs;
+
+	char text[320];
+	std::snprintf(text, sizeof(text),
+		"Frame pipeline (sim %.2f ms, render %.2f ms, gpu %.2f ms, %u frames):\n"
+		"  serial    %7.1f fps\n"
+		"  pipelined %7.1f fps  (sim waited %.1f ms, render waited %.1f ms)\n"
+		"  bound     %7.1f fps\n",
+		simMs, renderMs, gpuMs, frames, fps(serialMs), fps(pipelinedMs),
+		stats.ProducerWaitMs, stats.ConsumerWaitMs, boundMs > 0.0 ? 1000.0 / boundMs : 0.0);
+	return text;
+}
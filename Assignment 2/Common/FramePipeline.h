@@ -0,0 +1,85 @@
+//***************************************************************************************
+// FramePipeline.h
+//
+// Two-stage frame pipeline.  A producer thread simulates frame N+1 into one of
+// PacketCount packet slots while the render thread consumes frame N, so a frame costs
+// about max(simulate, render) instead of their sum.  The packets themselves belong to
+// the caller; this class only hands out slot indices in order.
+//
+// The hand-off is a single-producer/single-consumer ring of two counters.  Neither side
+// takes a lock: a slot is owned by the producer until the produced counter passes it
+// and by the consumer until the consumed counter passes it.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+class FramePipeline
+{
+public:
+	// One packet being simulated, one ready, one being rendered.
+	static const std::uint32_t PacketCount = 3;
+
+	// Fills packet slot for the given frame on the producer thread.
+	using ProduceCallback = std::function<void(std::uint32_t slot, std::uint64_t frame)>;
+
+	struct Stats
+	{
+		std::uint64_t Frames = 0;
+		double ProducerWaitMs = 0.0;	// Simulation ahead by PacketCount frames.
+		double ConsumerWaitMs = 0.0;	// Render thread starved for a packet.
+	};
+
+	FramePipeline() = default;
+	FramePipeline(const FramePipeline& rhs) = delete;
+	FramePipeline& operator=(const FramePipeline& rhs) = delete;
+	~FramePipeline();
+
+	void Start(const ProduceCallback& produce);
+
+	// Stops the producer after the packet it is working on.  Packets not yet consumed
+	// are dropped.
+	void Stop();
+
+	bool IsRunning()const { return mThread.joinable(); }
+
+	// Render thread: waits for the next packet in frame order.  The slot stays valid
+	// until Release.  Returns false if the pipeline is not running.
+	bool Acquire(std::uint32_t& slot, std::uint64_t& frame);
+	void Release();
+
+	Stats GetStats()const;
+	std::string StatsString()const;
+
+	// Runs frames with busy-wait sim and render stages against a SimulatedGpu, first
+	// serially and then pipelined, and reports the frame rate of both.
+	static std::string MeasureHeadless(double simMs, double renderMs, double gpuMs,
+		std::uint32_t frameResourceCount, std::uint32_t frames);
+
+private:
+	void ProducerMain();
+
+	// Spins, then yields, then sleeps briefly, until done() holds or the pipeline stops.
+	// Returns the milliseconds waited.
+	template<typename Predicate>
+	double WaitFor(Predicate done);
+
+private:
+	std::thread mThread;
+	ProduceCallback mProduce;
+
+	std::atomic<std::uint64_t> mProduced{ 0 };
+	std::atomic<std::uint64_t> mConsumed{ 0 };
+	std::atomic<bool> mStop{ false };
+
+	bool mAcquired = false;
+
+	// Each written by one side only; read by GetStats.
+	std::atomic<std::uint64_t> mProducerWaitUs{ 0 };
+	std::atomic<std::uint64_t> mConsumerWaitUs{ 0 };
+};
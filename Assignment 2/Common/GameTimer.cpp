@@ -2,26 +2,37 @@
 // GameTimer.cpp by Frank Luna (C) 2011 All Rights Reserved.
 //***************************************************************************************
 
-#include <windows.h>
 #include "GameTimer.h"
+#include <chrono>
+#include <cmath>
 
-GameTimer::GameTimer()
-: mSecondsPerCount(0.0), mDeltaTime(-1.0), mBaseTime(0), 
-  mPausedTime(0), mPrevTime(0), mCurrTime(0), mStopped(false)
+const std::int64_t GameTimer::TicksPerSecond;
+
+GameTimer::GameTimer(ClockFunction clock)
+: mClock(clock), mDeltaTime(-1), mBaseTime(0),
+  mPausedTime(0), mStopTime(0), mPrevTime(0), mCurrTime(0), mStopped(false)
+{
+}
+
+std::int64_t GameTimer::SteadyClockNow()
 {
-	__int64 countsPerSec;
-	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
-	mSecondsPerCount = 1.0 / (double)countsPerSec;
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::int64_t GameTimer::Now()const
+{
+	return mClock ? mClock() : SteadyClockNow();
 }
 
 // Returns the total time elapsed since Reset() was called, NOT counting any
 // time when the clock is stopped.
-float GameTimer::TotalTime()const
+std::int64_t GameTimer::TotalTicks()const
 {
 	// If we are stopped, do not count the time that has passed since we stopped.
-	// Moreover, if we previously already had a pause, the distance 
+	// Moreover, if we previously already had a pause, the distance
 	// mStopTime - mBaseTime includes paused time, which we do not want to count.
-	// To correct this, we can subtract the paused time from mStopTime:  
+	// To correct this, we can subtract the paused time from mStopTime:
 	//
 	//                     |<--paused time-->|
 	// ----*---------------*-----------------*------------*------------*------> time
@@ -29,56 +40,109 @@ float GameTimer::TotalTime()const
 
 	if( mStopped )
 	{
-		return (float)(((mStopTime - mPausedTime)-mBaseTime)*mSecondsPerCount);
+		return (mStopTime - mPausedTime)-mBaseTime;
 	}
 
 	// The distance mCurrTime - mBaseTime includes paused time,
-	// which we do not want to count.  To correct this, we can subtract 
-	// the paused time from mCurrTime:  
+	// which we do not want to count.  To correct this, we can subtract
+	// the paused time from mCurrTime:
 	//
-	//  (mCurrTime - mPausedTime) - mBaseTime 
+	//  (mCurrTime - mPausedTime) - mBaseTime
 	//
 	//                     |<--paused time-->|
 	// ----*---------------*-----------------*------------*------> time
 	//  mBaseTime       mStopTime        startTime     mCurrTime
-	
+
 	else
 	{
-		return (float)(((mCurrTime-mPausedTime)-mBaseTime)*mSecondsPerCount);
+		return (mCurrTime-mPausedTime)-mBaseTime;
 	}
 }
 
+std::int64_t GameTimer::DeltaTicks()const
+{
+	return mDeltaTime;
+}
+
+double GameTimer::TotalSeconds()const
+{
+	// Split so the whole seconds convert exactly and only the fraction rounds.
+	const std::int64_t ticks = TotalTicks();
+	return (double)(ticks / TicksPerSecond) + (double)(ticks % TicksPerSecond) / TicksPerSecond;
+}
+
+double GameTimer::DeltaSeconds()const
+{
+	return (double)mDeltaTime / TicksPerSecond;
+}
+
+float GameTimer::TotalTime()const
+{
+	return (float)TotalSeconds();
+}
+
 float GameTimer::DeltaTime()const
 {
-	return (float)mDeltaTime;
+	return (float)DeltaSeconds();
+}
+
+std::int64_t GameTimer::TicksToFixed(std::int64_t ticks)
+{
+	// ticks * 2^32 overflows after ~2 seconds, so shift the whole seconds and the
+	// sub-second remainder separately.  The remainder is below 2^30, so it fits.
+	std::int64_t seconds = ticks / TicksPerSecond;
+	std::int64_t remainder = ticks % TicksPerSecond;
+	if(remainder < 0)
+	{
+		seconds -= 1;
+		remainder += TicksPerSecond;
+	}
+
+	return (std::int64_t)((std::uint64_t)seconds << 32) + (remainder << 32) / TicksPerSecond;
+}
+
+std::int64_t GameTimer::TotalTimeFixed()const
+{
+	return TicksToFixed(TotalTicks());
+}
+
+double GameTimer::WrappedTime(double period)const
+{
+	// Wrap the integer ticks first so the result keeps full resolution however long
+	// the timer has been running.
+	const std::int64_t periodTicks = (std::int64_t)(period * TicksPerSecond);
+	if(periodTicks <= 0)
+		return 0.0;
+
+	return (double)(TotalTicks() % periodTicks) / TicksPerSecond;
 }
 
 void GameTimer::Reset()
 {
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+	std::int64_t currTime = Now();
 
 	mBaseTime = currTime;
 	mPrevTime = currTime;
+	mCurrTime = currTime;
+	mPausedTime = 0;
 	mStopTime = 0;
 	mStopped  = false;
 }
 
 void GameTimer::Start()
 {
-	__int64 startTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&startTime);
+	std::int64_t startTime = Now();
 
 
 	// Accumulate the time elapsed between stop and start pairs.
 	//
 	//                     |<-------d------->|
 	// ----*---------------*-----------------*------------> time
-	//  mBaseTime       mStopTime        startTime     
+	//  mBaseTime       mStopTime        startTime
 
 	if( mStopped )
 	{
-		mPausedTime += (startTime - mStopTime);	
+		mPausedTime += (startTime - mStopTime);
 
 		mPrevTime = startTime;
 		mStopTime = 0;
@@ -90,10 +154,7 @@ void GameTimer::Stop()
 {
 	if( !mStopped )
 	{
-		__int64 currTime;
-		QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
-
-		mStopTime = currTime;
+		mStopTime = Now();
 		mStopped  = true;
 	}
 }
@@ -102,31 +163,23 @@ void GameTimer::Tick()
 {
 	if( mStopped )
 	{
-		mDeltaTime = 0.0;
+		mDeltaTime = 0;
 		return;
 	}
 
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
-	mCurrTime = currTime;
+	mCurrTime = Now();
 
 	// Time difference between this frame and the previous.
-	mDeltaTime = (mCurrTime - mPrevTime)*mSecondsPerCount;
+	mDeltaTime = mCurrTime - mPrevTime;
 
 	// Prepare for next frame.
 	mPrevTime = mCurrTime;
 
-	// Force nonnegative.  The DXSDK's CDXUTTimer mentions that if the 
+	// Force nonnegative.  The DXSDK's CDXUTTimer mentions that if the
 	// processor goes into a power save mode or we get shuffled to another
 	// processor, then mDeltaTime can be negative.
-	if(mDeltaTime < 0.0)
+	if(mDeltaTime < 0)
 	{
-		mDeltaTime = 0.0;
+		mDeltaTime = 0;
 	}
 }
-
-
-
-
-
-
@@ -1,34 +1,73 @@
 //***************************************************************************************
 // GameTimer.h by Frank Luna (C) 2011 All Rights Reserved.
+//
+// Time is kept as 64-bit integer nanosecond ticks from std::chrono::steady_clock
+// (QueryPerformanceCounter on Windows, clock_gettime(CLOCK_MONOTONIC) elsewhere), so
+// it stays exact for centuries of uptime.  The float accessors are kept for per-frame
+// values; anything measured from Reset() should use the tick, double or fixed-point
+// accessors, since a float total loses millisecond resolution after a few hours.
 //***************************************************************************************
 
 #ifndef GAMETIMER_H
 #define GAMETIMER_H
 
+#include <cstdint>
+#include <functional>
+
 class GameTimer
 {
 public:
-	GameTimer();
+	// Returns the current time in nanoseconds from an arbitrary, monotonic origin.
+	typedef std::function<std::int64_t()> ClockFunction;
+
+	static const std::int64_t TicksPerSecond = 1000000000;
+
+	// An empty clock uses std::chrono::steady_clock.  Passing a fake clock lets long
+	// sessions be simulated without waiting for them.
+	explicit GameTimer(ClockFunction clock = ClockFunction());
 
 	float TotalTime()const; // in seconds
 	float DeltaTime()const; // in seconds
 
+	std::int64_t TotalTicks()const; // in nanoseconds
+	std::int64_t DeltaTicks()const; // in nanoseconds
+
+	double TotalSeconds()const;
+	double DeltaSeconds()const;
+
+	// Seconds in signed 32.32 fixed point.
+	std::int64_t TotalTimeFixed()const;
+
+	// TotalSeconds() wrapped into [0, period), for phases handed to float consumers.
+	double WrappedTime(double period)const;
+
+	bool Stopped()const { return mStopped; }
+
 	void Reset(); // Call before message loop.
 	void Start(); // Call when unpaused.
 	void Stop();  // Call when paused.
 	void Tick();  // Call every frame.
 
+	static std::int64_t SteadyClockNow();
+
+	// Converts nanosecond ticks to signed 32.32 fixed-point seconds without overflow.
+	static std::int64_t TicksToFixed(std::int64_t ticks);
+
 private:
-	double mSecondsPerCount;
-	double mDeltaTime;
+	std::int64_t Now()const;
+
+private:
+	ClockFunction mClock;
+
+	std::int64_t mDeltaTime;
 
-	__int64 mBaseTime;
-	__int64 mPausedTime;
-	__int64 mStopTime;
-	__int64 mPrevTime;
-	__int64 mCurrTime;
+	std::int64_t mBaseTime;
+	std::int64_t mPausedTime;
+	std::int64_t mStopTime;
+	std::int64_t mPrevTime;
+	std::int64_t mCurrTime;
 
 	bool mStopped;
 };
 
-#endif // GAMETIMER_H
\ No newline at end of file
+#endif // GAMETIMER_H
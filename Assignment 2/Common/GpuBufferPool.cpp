@@ -0,0 +1,164 @@
+//***************************************************************************************
+// GpuBufferPool.cpp
+//***************************************************************************************
+
+#include "GpuBufferPool.h"
+
+using Microsoft::WRL::ComPtr;
+
+GpuBufferPool::GpuBufferPool(ID3D12Device* device, UINT64 pageSize, UINT64 minBlockSize) :
+	md3dDevice(device),
+	mPageSize(pageSize),
+	mMinBlockSize(minBlockSize)
+{
+	// Placed resources must start on a 64KB boundary, so pages are whole multiples of that.
+	const UINT64 heapAlignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	mPageSize = (mPageSize + heapAlignment - 1) & ~(heapAlignment - 1);
+}
+
+GpuBufferPool::~GpuBufferPool()
+{
+}
+
+UINT GpuBufferPool::CreatePage(UINT64 byteSize)
+{
+	Page page;
+	page.Allocator = std::make_unique<BuddyAllocator>(byteSize, mMinBlockSize);
+
+	// The buddy allocator rounds the capacity up to a power of two; size the heap to match.
+	const UINT64 capacity = page.Allocator->Capacity();
+
+	D3D12_HEAP_DESC heapDesc = {};
+	heapDesc.SizeInBytes = capacity;
+	heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+	heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+	ThrowIfFailed(md3dDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(page.Heap.GetAddressOf())));
+
+	// One buffer spans the whole page; suballocations are offsets into it.
+	ThrowIfFailed(md3dDevice->CreatePlacedResource(
+		page.Heap.Get(),
+		0,
+		&CD3DX12_RESOURCE_DESC::Buffer(capacity),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(page.Buffer.GetAddressOf())));
+
+	mDeviceAllocationCalls += 2;
+
+	mPages.push_back(std::move(page));
+	return (UINT)mPages.size() - 1;
+}
+
+GpuBufferPool::Allocation GpuBufferPool::Allocate(UINT64 byteSize, UINT64 alignment)
+{
+	Allocation allocation;
+
+	// First fit over the existing pages.
+	UINT pageIndex = UINT_MAX;
+	UINT64 offset = BuddyAllocator::InvalidOffset;
+	for(UINT i = 0; i < (UINT)mPages.size(); ++i)
+	{
+		offset = mPages[i].Allocator->Allocate(byteSize, alignment);
+		if(offset != BuddyAllocator::InvalidOffset)
+		{
+			pageIndex = i;
+			break;
+		}
+	}
+
+	// Out of room: open a new page.  Buffers bigger than a page get a page of their own.
+	if(pageIndex == UINT_MAX)
+	{
+		pageIndex = CreatePage(byteSize > mPageSize ? byteSize : mPageSize);
+		offset = mPages[pageIndex].Allocator->Allocate(byteSize, alignment);
+		assert(offset != BuddyAllocator::InvalidOffset);
+	}
+
+	allocation.Resource = mPages[pageIndex].Buffer.Get();
+	allocation.Offset = offset;
+	allocation.Size = byteSize;
+	allocation.PageIndex = pageIndex;
+
+	return allocation;
+}
+
+void GpuBufferPool::Free(const Allocation& allocation)
+{
+	if(!allocation.IsValid())
+		return;
+
+	assert(allocation.PageIndex < mPages.size());
+	mPages[allocation.PageIndex].Allocator->Free(allocation.Offset);
+}
+
+GpuBufferPool::Allocation GpuBufferPool::CreateBuffer(StagingManager& staging, const void* initData, UINT64 byteSize)
+{
+	Allocation allocation = Allocate(byteSize);
+
+	// Pool buffers live in GENERIC_READ; the staging manager brackets its batched
+	// copies with transitions out of and back into that state.
+	staging.UploadBuffer(allocation.Resource, allocation.Offset, initData, byteSize,
+		D3D12_RESOURCE_STATE_GENERIC_READ);
+
+	return allocation;
+}
+
+UINT GpuBufferPool::Defragment(const RelocationCallback& relocate, UINT maxMovesPerPage)
+{
+	UINT moves = 0;
+	for(UINT i = 0; i < (UINT)mPages.size(); ++i)
+	{
+		ID3D12Resource* buffer = mPages[i].Buffer.Get();
+		moves += mPages[i].Allocator->Defragment(
+			[&](UINT64 oldOffset, UINT64 newOffset, UINT64 size)
+			{
+				Allocation from;
+				from.Resource = buffer;
+				from.Offset = oldOffset;
+				from.Size = size;
+				from.PageIndex = i;
+
+				Allocation to = from;
+				to.Offset = newOffset;
+
+				if(relocate)
+					relocate(from, to);
+			},
+			maxMovesPerPage);
+	}
+
+	return moves;
+}
+
+GpuBufferPool::Stats GpuBufferPool::GetStats()const
+{
+	Stats stats;
+	stats.PageCount = (UINT)mPages.size();
+	stats.DeviceAllocationCalls = mDeviceAllocationCalls;
+
+	for(auto& page : mPages)
+	{
+		BuddyAllocator::Stats pageStats = page.Allocator->GetStats();
+		stats.ReservedBytes += pageStats.Capacity;
+		stats.AllocatedBytes += pageStats.AllocatedBytes;
+		stats.RequestedBytes += pageStats.RequestedBytes;
+		stats.AllocationCount += pageStats.AllocationCount;
+		stats.MaxFragmentation = MathHelper::Max(stats.MaxFragmentation, pageStats.ExternalFragmentation());
+	}
+
+	return stats;
+}
+
+std::wstring GpuBufferPool::StatsString()const
+{
+	Stats stats = GetStats();
+
+	return L"GpuBufferPool: " + std::to_wstring(stats.AllocationCount) + L" buffers in " +
+		std::to_wstring(stats.PageCount) + L" pages; requested " +
+		std::to_wstring(stats.RequestedBytes / 1024) + L" KB, allocated " +
+		std::to_wstring(stats.AllocatedBytes / 1024) + L" KB, reserved " +
+		std::to_wstring(stats.ReservedBytes / 1024) + L" KB; " +
+		std::to_wstring(stats.DeviceAllocationCalls) + L" device allocations; fragmentation " +
+		std::to_wstring(stats.MaxFragmentation) + L"\n";
+}
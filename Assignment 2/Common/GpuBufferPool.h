@@ -0,0 +1,84 @@
+//***************************************************************************************
+// GpuBufferPool.h
+//
+// Suballocates default-heap buffer memory.  Instead of one committed resource per
+// vertex/index buffer, the pool reserves large ID3D12Heap pages, places a single
+// buffer over each page and carves it up with a BuddyAllocator.  Small meshes end up
+// packed side by side in the same buffer and are addressed by offset.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "BuddyAllocator.h"
+#include "StagingManager.h"
+
+class GpuBufferPool
+{
+public:
+	struct Allocation
+	{
+		ID3D12Resource* Resource = nullptr;
+		UINT64 Offset = 0;
+		UINT64 Size = 0;
+		UINT PageIndex = UINT_MAX;
+
+		bool IsValid()const { return Resource != nullptr; }
+		D3D12_GPU_VIRTUAL_ADDRESS GpuAddress()const { return Resource->GetGPUVirtualAddress() + Offset; }
+	};
+
+	struct Stats
+	{
+		UINT PageCount = 0;
+		UINT64 ReservedBytes = 0;
+		UINT64 AllocatedBytes = 0;
+		UINT64 RequestedBytes = 0;
+		UINT AllocationCount = 0;
+
+		// Number of ID3D12Device heap/resource creations made by the pool.
+		UINT DeviceAllocationCalls = 0;
+
+		// Worst external fragmentation over all pages.
+		float MaxFragmentation = 0.0f;
+	};
+
+	// Called when Defragment relocates an allocation.  The callee must re-upload or
+	// copy the data into 'to' and repoint any views that referenced 'from'.
+	using RelocationCallback = std::function<void(const Allocation& from, const Allocation& to)>;
+
+	GpuBufferPool(ID3D12Device* device, UINT64 pageSize = 16 * 1024 * 1024, UINT64 minBlockSize = 256);
+	GpuBufferPool(const GpuBufferPool& rhs) = delete;
+	GpuBufferPool& operator=(const GpuBufferPool& rhs) = delete;
+	~GpuBufferPool();
+
+	Allocation Allocate(UINT64 byteSize, UINT64 alignment = 256);
+	void Free(const Allocation& allocation);
+
+	// Allocates byteSize bytes and queues the initial data on the staging manager.
+	// The copy is recorded by the next StagingManager::Flush.
+	Allocation CreateBuffer(StagingManager& staging, const void* initData, UINT64 byteSize);
+
+	// Compacts every page.  Returns the number of relocations reported to the callback.
+	UINT Defragment(const RelocationCallback& relocate, UINT maxMovesPerPage = UINT_MAX);
+
+	Stats GetStats()const;
+	std::wstring StatsString()const;
+
+private:
+	struct Page
+	{
+		Microsoft::WRL::ComPtr<ID3D12Heap> Heap;
+		Microsoft::WRL::ComPtr<ID3D12Resource> Buffer;
+		std::unique_ptr<BuddyAllocator> Allocator;
+	};
+
+	UINT CreatePage(UINT64 byteSize);
+
+private:
+	ID3D12Device* md3dDevice = nullptr;
+	UINT64 mPageSize = 0;
+	UINT64 mMinBlockSize = 0;
+	UINT mDeviceAllocationCalls = 0;
+
+	std::vector<Page> mPages;
+};
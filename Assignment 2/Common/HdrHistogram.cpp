@@ -0,0 +1,117 @@
+//***************************************************************************************
+// HdrHistogram.cpp
+//***************************************************************************************
+
+#include "HdrHistogram.h"
+#include <algorithm>
+#include <cmath>
+
+const std::uint32_t HdrHistogram::SubBucketBits;
+const std::uint32_t HdrHistogram::SubBucketCount;
+const std::uint32_t HdrHistogram::SubBucketHalf;
+const std::uint32_t HdrHistogram::BucketCount;
+
+namespace
+{
+	std::uint32_t FloorLog2(std::uint64_t v)
+	{
+		std::uint32_t log = 0;
+		for(std::uint32_t step = 32; step > 0; step >>= 1)
+		{
+			if(v >> step)
+			{
+				v >>= step;
+				log += step;
+			}
+		}
+		return log;
+	}
+}
+
+HdrHistogram::HdrHistogram()
+	: mCounts(BucketCount, 0)
+{
+}
+
+std::uint32_t HdrHistogram::BucketIndex(std::uint64_t value)
+{
+	if(value < SubBucketCount)
+		return (std::uint32_t)value;
+
+	// Keep the top SubBucketBits - 1 bits below the leading one.
+	const std::uint32_t shift = FloorLog2(value) - (SubBucketBits - 1);
+	const std::uint32_t sub = (std::uint32_t)(value >> shift);
+	return SubBucketCount + (shift - 1) * SubBucketHalf + (sub - SubBucketHalf);
+}
+
+std::uint64_t HdrHistogram::BucketHighestValue(std::uint32_t index)
+{
+	if(index < SubBucketCount)
+		return index;
+
+	const std::uint32_t k = index - SubBucketCount;
+	const std::uint32_t shift = k / SubBucketHalf + 1;
+	const std::uint64_t sub = k % SubBucketHalf + SubBucketHalf;
+
+	// Wraps to the largest 64-bit value for the very last bucket, which is correct.
+	return ((sub + 1) << shift) - 1;
+}
+
+void HdrHistogram::Record(std::uint64_t value, std::uint64_t count)
+{
+	if(count == 0)
+		return;
+
+	mCounts[BucketIndex(value)] += count;
+	mTotalCount += count;
+	mMin = std::min(mMin, value);
+	mMax = std::max(mMax, value);
+	mSum += (double)value * (double)count;
+}
+
+void HdrHistogram::Merge(const HdrHistogram& other)
+{
+	for(std::uint32_t i = 0; i < BucketCount; ++i)
+		mCounts[i] += other.mCounts[i];
+
+	mTotalCount += other.mTotalCount;
+	mMin = std::min(mMin, other.mMin);
+	mMax = std::max(mMax, other.mMax);
+	mSum += other.mSum;
+}
+
+void HdrHistogram::Reset()
+{
+	std::fill(mCounts.begin(), mCounts.end(), 0);
+	mTotalCount = 0;
+	mMin = ~0ull;
+	mMax = 0;
+	mSum = 0.0;
+}
+
+double HdrHistogram::Mean()const
+{
+	return mTotalCount > 0 ? mSum / (double)mTotalCount : 0.0;
+}
+
+std::uint64_t HdrHistogram::ValueAtPercentile(double percent)const
+{
+	if(mTotalCount == 0)
+		return 0;
+
+	percent = std::min(std::max(percent, 0.0), 100.0);
+
+	// Rank of the value asked for, counting from 1.
+	std::uint64_t rank = (std::uint64_t)std::ceil(percent / 100.0 * (double)mTotalCount);
+	rank = std::max<std::uint64_t>(rank, 1);
+
+	std::uint64_t seen = 0;
+	for(std::uint32_t i = 0; i < BucketCount; ++i)
+	{
+		seen += mCounts[i];
+		if(seen >= rank)
+			return std::min(BucketHighestValue(i), mMax);
+	}
+
+	return mMax;
+}
@@ -0,0 +1,48 @@
+//***************************************************************************************
+// HdrHistogram.h
+//
+// Fixed-precision histogram of non-negative integer values (e.g. microseconds) over the
+// whole 64-bit range.  Values below 128 are counted exactly; above that each power of
+// two is split into 64 linear buckets, so any recorded value is reported to within
+// 1/64 (about 1.6%) however large it is.  Recording is a few shifts and an increment;
+// memory is fixed at about 30 KB.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class HdrHistogram
+{
+public:
+	HdrHistogram();
+
+	void Record(std::uint64_t value, std::uint64_t count = 1);
+	void Merge(const HdrHistogram& other);
+	void Reset();
+
+	std::uint64_t TotalCount()const { return mTotalCount; }
+	std::uint64_t Min()const { return mTotalCount > 0 ? mMin : 0; }
+	std::uint64_t Max()const { return mMax; }
+	double Mean()const;
+
+	// Smallest recorded value v such that percent% of values are <= v, reported as the
+	// highest value of its bucket (clamped to Max()).  percent is in [0, 100].
+	std::uint64_t ValueAtPercentile(double percent)const;
+
+	static std::uint32_t BucketIndex(std::uint64_t value);
+	static std::uint64_t BucketHighestValue(std::uint32_t index);
+
+private:
+	static const std::uint32_t SubBucketBits = 7;
+	static const std::uint32_t SubBucketCount = 1u << SubBucketBits;
+	static const std::uint32_t SubBucketHalf = SubBucketCount / 2;
+	static const std::uint32_t BucketCount = SubBucketCount + (64 - SubBucketBits) * SubBucketHalf;
+
+	std::vector<std::uint64_t> mCounts;
+	std::uint64_t mTotalCount = 0;
+	std::uint64_t mMin = ~0ull;
+	std::uint64_t mMax = 0;
+	double mSum = 0.0;
+};
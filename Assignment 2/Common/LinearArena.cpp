@@ -0,0 +1,122 @@
+//***************************************************************************************
+// LinearArena.cpp
+//***************************************************************************************
+
+#include "LinearArena.h"
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+	std::size_t AlignUp(std::size_t value, std::size_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	// Offset from base of the first address at or after base + offset with the alignment.
+	std::size_t AlignOffset(const char* base, std::size_t offset, std::size_t alignment)
+	{
+		const std::size_t address = (std::size_t)(std::uintptr_t)base;
+		return AlignUp(address + offset, alignment) - address;
+	}
+
+	// Blocks come from operator new, which aligns to at least this much.
+	const std::size_t BlockAlignment = alignof(std::max_align_t);
+}
+
+LinearArena::LinearArena(std::size_t blockSize) :
+	mBlockSize(std::max<std::size_t>(blockSize, 256))
+{
+	Block block;
+	block.Data = static_cast<char*>(::operator new(mBlockSize));
+	block.Size = mBlockSize;
+	mBlocks.push_back(block);
+}
+
+LinearArena::~LinearArena()
+{
+	for(Block& block : mBlocks)
+		::operator delete(block.Data);
+}
+
+void* LinearArena::Allocate(std::size_t size, std::size_t alignment)
+{
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+	std::size_t offset = AlignOffset(mBlocks[mCurrent].Data, mOffset, alignment);
+	if(offset + size > mBlocks[mCurrent].Size)
+	{
+		NextBlock(size, alignment);
+		offset = AlignOffset(mBlocks[mCurrent].Data, 0, alignment);
+	}
+
+	mOffset = offset + size;
+	mPeakBytes = std::max(mPeakBytes, BytesUsed());
+	return mBlocks[mCurrent].Data + offset;
+}
+
+void LinearArena::NextBlock(std::size_t size, std::size_t alignment)
+{
+	// Block starts are aligned to BlockAlignment; over-aligned requests may need to
+	// skip ahead that far.
+	const std::size_t needed = size + (alignment > BlockAlignment ? alignment : 0);
+
+	mBytesBefore += mBlocks[mCurrent].Size;
+	mCurrent++;
+
+	// Reuse the blocks kept from before the last Reset or Rewind while they fit; a
+	// block too small for this request is skipped for now, not freed.
+	while(mCurrent < mBlocks.size() && mBlocks[mCurrent].Size < needed)
+	{
+		mBytesBefore += mBlocks[mCurrent].Size;
+		mCurrent++;
+	}
+
+	if(mCurrent == mBlocks.size())
+	{
+		Block block;
+		block.Size = std::max(mBlockSize, needed);
+		block.Data = static_cast<char*>(::operator new(block.Size));
+		mBlocks.push_back(block);
+	}
+
+	mOffset = 0;
+}
+
+LinearArena::Marker LinearArena::GetMarker()const
+{
+	Marker marker;
+	marker.Block = mCurrent;
+	marker.Offset = mOffset;
+	marker.BytesBefore = mBytesBefore;
+	return marker;
+}
+
+void LinearArena::Rewind(const Marker& marker)
+{
+	assert(marker.Block < mCurrent || (marker.Block == mCurrent && marker.Offset <= mOffset));
+
+	mCurrent = marker.Block;
+	mOffset = marker.Offset;
+	mBytesBefore = marker.BytesBefore;
+}
+
+void LinearArena::Reset()
+{
+	Rewind(Marker());
+}
+
+std::size_t LinearArena::Capacity()const
+{
+	std::size_t capacity = 0;
+	for(const Block& block : mBlocks)
+		capacity += block.Size;
+	return capacity;
+}
+
+LinearArena& ScratchArena()
+{
+	// Large enough for the temporaries of building a mesh without a second block.
+	static thread_local LinearArena arena(1024 * 1024);
+	return arena;
+}
@@ -0,0 +1,170 @@
+//***************************************************************************************
+// LinearArena.h
+//
+// Bump allocator for short-lived CPU data.  Allocation moves a pointer; nothing is
+// freed individually.  Rewind(marker) drops everything allocated after the marker and
+// Reset drops everything.  Blocks are kept, so once an arena has grown to a workload's
+// size it stops touching the heap.
+//
+// Two uses:
+//   - a frame arena per FrameResource, reset when that frame resource's fence has been
+//     reached, for data built and consumed within one frame;
+//   - ScratchArena(), one per thread, for temporaries inside a function.  Open a
+//     ScratchScope first so they are released when the scope ends.
+//
+// ArenaAllocator<T> puts STL containers in an arena.  Its deallocate does nothing, so a
+// container that keeps growing leaves its old storage behind until the arena is reset;
+// reserve up front where the size is known.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+class LinearArena
+{
+public:
+	// The first block is allocated here so it is charged to the constructing scope.
+	explicit LinearArena(std::size_t blockSize = 64 * 1024);
+	LinearArena(const LinearArena& rhs) = delete;
+	LinearArena& operator=(const LinearArena& rhs) = delete;
+	~LinearArena();
+
+	struct Marker
+	{
+		std::uint32_t Block = 0;
+		std::size_t Offset = 0;
+		std::size_t BytesBefore = 0;
+	};
+
+	// Never returns null.  Requests larger than the block size get a block of their own.
+	void* Allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+
+	template<typename T>
+	T* AllocateArray(std::size_t count)
+	{
+		return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+	}
+
+	Marker GetMarker()const;
+
+	// Releases everything allocated since marker, which must come from this arena and
+	// not be older than the last Reset.
+	void Rewind(const Marker& marker);
+
+	void Reset();
+
+	// Bytes handed out since the last Reset, counting any tail a block could not use.
+	std::size_t BytesUsed()const { return mBytesBefore + mOffset; }
+	std::size_t PeakBytes()const { return mPeakBytes; }
+	std::size_t Capacity()const;
+	std::uint32_t BlockCount()const { return (std::uint32_t)mBlocks.size(); }
+
+private:
+	void NextBlock(std::size_t size, std::size_t alignment);
+
+private:
+	struct Block
+	{
+		char* Data = nullptr;
+		std::size_t Size = 0;
+	};
+
+	std::size_t mBlockSize;
+	std::vector<Block> mBlocks;
+
+	std::uint32_t mCurrent = 0;
+	std::size_t mOffset = 0;
+
+	// Sizes of the blocks before mCurrent.
+	std::size_t mBytesBefore = 0;
+	std::size_t mPeakBytes = 0;
+};
+
+// This thread's scratch arena, created on first use.
+LinearArena& ScratchArena();
+
+// Rewinds an arena (the thread's scratch arena by default) to where it was when the
+// scope was entered.  Scopes nest.
+class ScratchScope
+{
+public:
+	ScratchScope() : ScratchScope(ScratchArena())
+	{
+	}
+
+	explicit ScratchScope(LinearArena& arena) : mArena(arena), mMarker(arena.GetMarker())
+	{
+	}
+
+	~ScratchScope()
+	{
+		mArena.Rewind(mMarker);
+	}
+
+	ScratchScope(const ScratchScope& rhs) = delete;
+	ScratchScope& operator=(const ScratchScope& rhs) = delete;
+
+	LinearArena& Arena()const { return mArena; }
+
+private:
+	LinearArena& mArena;
+	LinearArena::Marker mMarker;
+};
+
+template<typename T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+
+	// Containers take the arena along when assigned or swapped, so a container can be
+	// pointed at this frame's arena by assigning it an empty one.
+	typedef std::true_type propagate_on_container_copy_assignment;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	// Unbound; only for containers that are bound to an arena before first use.
+	ArenaAllocator() = default;
+
+	explicit ArenaAllocator(LinearArena& arena) : mArena(&arena)
+	{
+	}
+
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& rhs) : mArena(rhs.Arena())
+	{
+	}
+
+	T* allocate(std::size_t count)
+	{
+		return mArena->AllocateArray<T>(count);
+	}
+
+	void deallocate(T*, std::size_t)
+	{
+	}
+
+	LinearArena* Arena()const { return mArena; }
+
+private:
+	LinearArena* mArena = nullptr;
+};
+
+template<typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+	return a.Arena() == b.Arena();
+}
+
+template<typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+	return a.Arena() != b.Arena();
+}
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
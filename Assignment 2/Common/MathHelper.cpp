@@ -4,10 +4,123 @@
 
 #include "MathHelper.h"
 #include <float.h>
+#include <atomic>
 #include <cmath>
 
 using namespace DirectX;
 
+namespace
+{
+	std::atomic<std::uint64_t> gNextRandomStream(0);
+
+	// Vectors from pairs of uniforms: z uniform in [-1, 1] and an angle about z give an
+	// even spread over the sphere, without the rejection loop.  pairs holds 2 * count
+	// floats.
+	void UnitVec3FromPairs(const float* pairs, XMFLOAT3* out, std::size_t count)
+	{
+		const XMVECTOR one = XMVectorSplatOne();
+
+		for(std::size_t i = 0; i < count; i += 4)
+		{
+			XMVECTOR a = XMLoadFloat4((const XMFLOAT4*)(pairs + 2 * i));
+			XMVECTOR b = XMLoadFloat4((const XMFLOAT4*)(pairs + 2 * i + 4));
+			XMVECTOR z = XMVectorPermute<0, 2, 4, 6>(a, b);
+			XMVECTOR angle = XMVectorPermute<1, 3, 5, 7>(a, b);
+
+			z = XMVectorMultiplyAdd(z, XMVectorReplicate(2.0f), XMVectorNegate(one));
+			angle = XMVectorScale(angle, XM_2PI);
+
+			XMVECTOR sine, cosine;
+			XMVectorSinCos(&sine, &cosine, angle);
+			XMVECTOR r = XMVectorSqrt(XMVectorMax(XMVectorZero(), XMVectorNegativeMultiplySubtract(z, z, one)));
+
+			XMFLOAT4A x, y, zs;
+			XMStoreFloat4A(&x, XMVectorMultiply(r, cosine));
+			XMStoreFloat4A(&y, XMVectorMultiply(r, sine));
+			XMStoreFloat4A(&zs, z);
+
+			const float* xs[3] = { &x.x, &y.x, &zs.x };
+			for(std::size_t j = 0; j < 4 && i + j < count; ++j)
+				out[i + j] = XMFLOAT3(xs[0][j], xs[1][j], xs[2][j]);
+		}
+	}
+
+	// Vectors per batch; the uniforms live on the stack.
+	const std::size_t UnitVecBatch = 64;
+
+	// Every element of a matrix in its own register, for the SoA kernels.
+	struct SplatMatrix
+	{
+		explicit SplatMatrix(CXMMATRIX matrix)
+		{
+			XMFLOAT4X4 f;
+			XMStoreFloat4x4(&f, matrix);
+			for(int r = 0; r < 4; ++r)
+			{
+				for(int c = 0; c < 4; ++c)
+					M[r][c] = XMVectorReplicate(f.m[r][c]);
+			}
+		}
+
+		XMVECTOR M[4][4];
+	};
+
+	// The first n (at most 4) floats at p; missing lanes are 0.
+	XMVECTOR LoadLanes(const float* p, std::size_t n)
+	{
+		if(n >= 4)
+			return XMLoadFloat4((const XMFLOAT4*)p);
+
+		XMFLOAT4 lanes(0.0f, 0.0f, 0.0f, 0.0f);
+		for(std::size_t j = 0; j < n; ++j)
+			(&lanes.x)[j] = p[j];
+		return XMLoadFloat4(&lanes);
+	}
+
+	void StoreLanes(float* p, FXMVECTOR v, std::size_t n)
+	{
+		if(n >= 4)
+		{
+			XMStoreFloat4((XMFLOAT4*)p, v);
+			return;
+		}
+
+		XMFLOAT4 lanes;
+		XMStoreFloat4(&lanes, v);
+		for(std::size_t j = 0; j < n; ++j)
+			p[j] = (&lanes.x)[j];
+	}
+
+	// Column c of v * M for four vectors, in the same operation order as
+	// XMVector3Transform so results match it exactly.
+	XMVECTOR TransformColumn(const SplatMatrix& m, int c, FXMVECTOR x, FXMVECTOR y, FXMVECTOR z)
+	{
+		XMVECTOR result = XMVectorMultiplyAdd(z, m.M[2][c], m.M[3][c]);
+		result = XMVectorMultiplyAdd(y, m.M[1][c], result);
+		return XMVectorMultiplyAdd(x, m.M[0][c], result);
+	}
+
+	XMVECTOR TransformNormalColumn(const SplatMatrix& m, int c, FXMVECTOR x, FXMVECTOR y, FXMVECTOR z)
+	{
+		XMVECTOR result = XMVectorMultiply(z, m.M[2][c]);
+		result = XMVectorMultiplyAdd(y, m.M[1][c], result);
+		return XMVectorMultiplyAdd(x, m.M[0][c], result);
+	}
+
+	void TransformAabb(const BoundingBox& in, BoundingBox& out, CXMMATRIX m)
+	{
+		XMVECTOR center = XMVector3Transform(XMLoadFloat3(&in.Center), m);
+
+		XMVECTOR e = XMLoadFloat3(&in.Extents);
+		XMVECTOR extents = XMVectorMultiply(XMVectorSplatZ(e), XMVectorAbs(m.r[2]));
+		extents = XMVectorMultiplyAdd(XMVectorSplatY(e), XMVectorAbs(m.r[1]), extents);
+		extents = XMVectorMultiplyAdd(XMVectorSplatX(e), XMVectorAbs(m.r[0]), extents);
+
+		XMStoreFloat3(&out.Center, center);
+		XMStoreFloat3(&out.Extents, extents);
+	}
+}
+
 const float MathHelper::Infinity = FLT_MAX;
 const float MathHelper::Pi       = 3.1415926535f;
 
@@ -35,48 +148,219 @@ float MathHelper::AngleFromXY(float x, float y)
 
 XMVECTOR MathHelper::RandUnitVec3()
 {
-	XMVECTOR One  = XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f);
-	XMVECTOR Zero = XMVectorZero();
+	float z = RandF(-1.0f, 1.0f);
+	float angle = RandF(0.0f, 2.0f*Pi);
+	float r = sqrtf(Max(0.0f, 1.0f - z*z));
+
+	return XMVectorSet(r*cosf(angle), r*sinf(angle), z, 0.0f);
+}
+
+XMVECTOR MathHelper::RandHemisphereUnitVec3(XMVECTOR n)
+{
+	XMVECTOR v = RandUnitVec3();
 
-	// Keep trying until we get a point on/in the hemisphere.
-	while(true)
+	// Mirror points in the bottom hemisphere to the top one.
+	if( XMVector3Less( XMVector3Dot(n, v), XMVectorZero() ) )
+		v = XMVectorNegate(v);
+
+	return v;
+}
+
+Pcg32& MathHelper::ThreadRandom()
+{
+	static thread_local Pcg32 rng(0x853c49e6748fea9bull, gNextRandomStream.fetch_add(1));
+	return rng;
+}
+
+void MathHelper::SeedThreadRandom(std::uint64_t seed, std::uint64_t stream)
+{
+	ThreadRandom() = Pcg32(seed, stream);
+}
+
+void MathHelper::FillUnitVec3(Xoshiro128x4& rng, XMFLOAT3* out, std::size_t count)
+{
+	float pairs[2 * UnitVecBatch + 8];
+	for(std::size_t i = 0; i < count; i += UnitVecBatch)
 	{
-		// Generate random point in the cube [-1,1]^3.
-		XMVECTOR v = XMVectorSet(MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), 0.0f);
+		const std::size_t batch = Min(count - i, UnitVecBatch);
+		rng.FillFloats(pairs, 2 * ((batch + 3) & ~std::size_t(3)));
+		UnitVec3FromPairs(pairs, out + i, batch);
+	}
+}
 
-		// Ignore points outside the unit sphere in order to get an even distribution 
-		// over the unit sphere.  Otherwise points will clump more on the sphere near 
-		// the corners of the cube.
+void MathHelper::FillUnitVec3(std::uint64_t seed, std::uint64_t firstIndex, XMFLOAT3* out, std::size_t count)
+{
+	float pairs[2 * UnitVecBatch + 8];
+	for(std::size_t i = 0; i < count; i += UnitVecBatch)
+	{
+		const std::size_t batch = Min(count - i, UnitVecBatch);
+		Philox4x32::FillFloats(seed, 2 * (firstIndex + i), pairs, 2 * ((batch + 3) & ~std::size_t(3)));
+		UnitVec3FromPairs(pairs, out + i, batch);
+	}
+}
 
-		if( XMVector3Greater( XMVector3LengthSq(v), One) )
-			continue;
+void MathHelper::TransformPoints(const XMFLOAT3* in, XMFLOAT3* out, std::size_t count, CXMMATRIX m)
+{
+	XMVector3TransformCoordStream(out, sizeof(XMFLOAT3), in, sizeof(XMFLOAT3), count, m);
+}
 
-		return XMVector3Normalize(v);
+void MathHelper::TransformNormals(const XMFLOAT3* in, XMFLOAT3* out, std::size_t count, CXMMATRIX m)
+{
+	XMVector3TransformNormalStream(out, sizeof(XMFLOAT3), in, sizeof(XMFLOAT3), count, m);
+}
+
+void MathHelper::TransformPoints(const Float3Arrays& in, const Float3Arrays& out, std::size_t count, CXMMATRIX m)
+{
+	const SplatMatrix s(m);
+
+	for(std::size_t i = 0; i < count; i += 4)
+	{
+		const std::size_t n = count - i;
+		XMVECTOR x = LoadLanes(in.X + i, n);
+		XMVECTOR y = LoadLanes(in.Y + i, n);
+		XMVECTOR z = LoadLanes(in.Z + i, n);
+
+		XMVECTOR w = TransformColumn(s, 3, x, y, z);
+		StoreLanes(out.X + i, XMVectorDivide(TransformColumn(s, 0, x, y, z), w), n);
+		StoreLanes(out.Y + i, XMVectorDivide(TransformColumn(s, 1, x, y, z), w), n);
+		StoreLanes(out.Z + i, XMVectorDivide(TransformColumn(s, 2, x, y, z), w), n);
 	}
 }
 
-XMVECTOR MathHelper::RandHemisphereUnitVec3(XMVECTOR n)
+void MathHelper::TransformNormals(const Float3Arrays& in, const Float3Arrays& out, std::size_t count, CXMMATRIX m)
 {
-	XMVECTOR One  = XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f);
-	XMVECTOR Zero = XMVectorZero();
+	const SplatMatrix s(m);
 
-	// Keep trying until we get a point on/in the hemisphere.
-	while(true)
+	for(std::size_t i = 0; i < count; i += 4)
 	{
-		// Generate random point in the cube [-1,1]^3.
-		XMVECTOR v = XMVectorSet(MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), 0.0f);
+		const std::size_t n = count - i;
+		XMVECTOR x = LoadLanes(in.X + i, n);
+		XMVECTOR y = LoadLanes(in.Y + i, n);
+		XMVECTOR z = LoadLanes(in.Z + i, n);
 
-		// Ignore points outside the unit sphere in order to get an even distribution 
-		// over the unit sphere.  Otherwise points will clump more on the sphere near 
-		// the corners of the cube.
-		
-		if( XMVector3Greater( XMVector3LengthSq(v), One) )
-			continue;
+		StoreLanes(out.X + i, TransformNormalColumn(s, 0, x, y, z), n);
+		StoreLanes(out.Y + i, TransformNormalColumn(s, 1, x, y, z), n);
+		StoreLanes(out.Z + i, TransformNormalColumn(s, 2, x, y, z), n);
+	}
+}
 
-		// Ignore points in the bottom hemisphere.
-		if( XMVector3Less( XMVector3Dot(n, v), Zero ) )
-			continue;
+void MathHelper::TransformAabbs(const BoundingBox* in, BoundingBox* out, std::size_t count, CXMMATRIX m)
+{
+	for(std::size_t i = 0; i < count; ++i)
+		TransformAabb(in[i], out[i], m);
+}
+
+void MathHelper::TransformAabbs(const BoundingBox* in, const XMFLOAT4X4* worlds, BoundingBox* out, std::size_t count)
+{
+	for(std::size_t i = 0; i < count; ++i)
+		TransformAabb(in[i], out[i], XMLoadFloat4x4(&worlds[i]));
+}
 
-		return XMVector3Normalize(v);
+void MathHelper::TransformAabbs(const Float3Arrays& centers, const Float3Arrays& extents,
+	const Float3Arrays& outCenters, const Float3Arrays& outExtents, std::size_t count, CXMMATRIX m)
+{
+	const SplatMatrix s(m);
+
+	XMMATRIX absolute = m;
+	for(int r = 0; r < 3; ++r)
+		absolute.r[r] = XMVectorAbs(m.r[r]);
+	const SplatMatrix a(absolute);
+
+	for(std::size_t i = 0; i < count; i += 4)
+	{
+		const std::size_t n = count - i;
+		XMVECTOR cx = LoadLanes(centers.X + i, n);
+		XMVECTOR cy = LoadLanes(centers.Y + i, n);
+		XMVECTOR cz = LoadLanes(centers.Z + i, n);
+		XMVECTOR ex = LoadLanes(extents.X + i, n);
+		XMVECTOR ey = LoadLanes(extents.Y + i, n);
+		XMVECTOR ez = LoadLanes(extents.Z + i, n);
+
+		StoreLanes(outCenters.X + i, TransformColumn(s, 0, cx, cy, cz), n);
+		StoreLanes(outCenters.Y + i, TransformColumn(s, 1, cx, cy, cz), n);
+		StoreLanes(outCenters.Z + i, TransformColumn(s, 2, cx, cy, cz), n);
+		StoreLanes(outExtents.X + i, TransformNormalColumn(a, 0, ex, ey, ez), n);
+		StoreLanes(outExtents.Y + i, TransformNormalColumn(a, 1, ex, ey, ez), n);
+		StoreLanes(outExtents.Z + i, TransformNormalColumn(a, 2, ex, ey, ez), n);
 	}
-}
\ No newline at end of file
+}
+
+void MathHelper::MultiplyMatrices(const XMFLOAT4X4* a, const XMFLOAT4X4* b, XMFLOAT4X4* out, std::size_t count)
+{
+	for(std::size_t i = 0; i < count; ++i)
+		XMStoreFloat4x4(&out[i], XMMatrixMultiply(XMLoadFloat4x4(&a[i]), XMLoadFloat4x4(&b[i])));
+}
+
+void MathHelper::MultiplyMatrices(const XMFLOAT4X4* a, CXMMATRIX b, XMFLOAT4X4* out, std::size_t count)
+{
+	const XMMATRIX right = b;
+	for(std::size_t i = 0; i < count; ++i)
+		XMStoreFloat4x4(&out[i], XMMatrixMultiply(XMLoadFloat4x4(&a[i]), right));
+}
+
+void MathHelper::TransposeMatrices(const XMFLOAT4X4* in, XMFLOAT4X4* out, std::size_t count)
+{
+	for(std::size_t i = 0; i < count; ++i)
+		XMStoreFloat4x4(&out[i], XMMatrixTranspose(XMLoadFloat4x4(&in[i])));
+}
+
+void MathHelper::BuildTrsMatrices(const XMFLOAT3* scale, const XMFLOAT4* rotation,
+	const XMFLOAT3* translation, XMFLOAT4X4* out, std::size_t count)
+{
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		// Scaling first only scales the rotation's rows.
+		XMMATRIX m = XMMatrixRotationQuaternion(XMLoadFloat4(&rotation[i]));
+		XMVECTOR s = XMLoadFloat3(&scale[i]);
+		m.r[0] = XMVectorMultiply(m.r[0], XMVectorSplatX(s));
+		m.r[1] = XMVectorMultiply(m.r[1], XMVectorSplatY(s));
+		m.r[2] = XMVectorMultiply(m.r[2], XMVectorSplatZ(s));
+		m.r[3] = XMVectorSetW(XMLoadFloat3(&translation[i]), 1.0f);
+
+		XMStoreFloat4x4(&out[i], m);
+	}
+}
+
+void MathHelper::BuildTrsMatrices(const Float3Arrays& scale, const Float4Arrays& rotation,
+	const Float3Arrays& translation, XMFLOAT4X4* out, std::size_t count)
+{
+	const XMVECTOR one = XMVectorSplatOne();
+	const XMVECTOR two = XMVectorReplicate(2.0f);
+
+	for(std::size_t i = 0; i < count; i += 4)
+	{
+		const std::size_t n = count - i;
+		XMVECTOR qx = LoadLanes(rotation.X + i, n);
+		XMVECTOR qy = LoadLanes(rotation.Y + i, n);
+		XMVECTOR qz = LoadLanes(rotation.Z + i, n);
+		XMVECTOR qw = LoadLanes(rotation.W + i, n);
+		XMVECTOR sx = LoadLanes(scale.X + i, n);
+		XMVECTOR sy = LoadLanes(scale.Y + i, n);
+		XMVECTOR sz = LoadLanes(scale.Z + i, n);
+
+		XMVECTOR xx = XMVectorMultiply(qx, qx), yy = XMVectorMultiply(qy, qy), zz = XMVectorMultiply(qz, qz);
+		XMVECTOR xy = XMVectorMultiply(qx, qy), xz = XMVectorMultiply(qx, qz), yz = XMVectorMultiply(qy, qz);
+		XMVECTOR wx = XMVectorMultiply(qw, qx), wy = XMVectorMultiply(qw, qy), wz = XMVectorMultiply(qw, qz);
+
+		// Rotation rows for the row-vector convention, one matrix per lane, scaled.
+		XMVECTOR e00 = XMVectorMultiply(XMVectorNegativeMultiplySubtract(two, XMVectorAdd(yy, zz), one), sx);
+		XMVECTOR e01 = XMVectorMultiply(XMVectorMultiply(two, XMVectorAdd(xy, wz)), sx);
+		XMVECTOR e02 = XMVectorMultiply(XMVectorMultiply(two, XMVectorSubtract(xz, wy)), sx);
+		XMVECTOR e10 = XMVectorMultiply(XMVectorMultiply(two, XMVectorSubtract(xy, wz)), sy);
+		XMVECTOR e11 = XMVectorMultiply(XMVectorNegativeMultiplySubtract(two, XMVectorAdd(xx, zz), one), sy);
+		XMVECTOR e12 = XMVectorMultiply(XMVectorMultiply(two, XMVectorAdd(yz, wx)), sy);
+		XMVECTOR e20 = XMVectorMultiply(XMVectorMultiply(two, XMVectorAdd(xz, wy)), sz);
+		XMVECTOR e21 = XMVectorMultiply(XMVectorMultiply(two, XMVectorSubtract(yz, wx)), sz);
+		XMVECTOR e22 = XMVectorMultiply(XMVectorNegativeMultiplySubtract(two, XMVectorAdd(xx, yy), one), sz);
+
+		// Transposing a block of four lanes gives one row for each of the four matrices.
+		XMMATRIX row0 = XMMatrixTranspose(XMMATRIX(e00, e01, e02, XMVectorZero()));
+		XMMATRIX row1 = XMMatrixTranspose(XMMATRIX(e10, e11, e12, XMVectorZero()));
+		XMMATRIX row2 = XMMatrixTranspose(XMMATRIX(e20, e21, e22, XMVectorZero()));
+		XMMATRIX row3 = XMMatrixTranspose(XMMATRIX(LoadLanes(translation.X + i, n),
+			LoadLanes(translation.Y + i, n), LoadLanes(translation.Z + i, n), one));
+
+		for(std::size_t j = 0; j < 4 && j < n; ++j)
+			XMStoreFloat4x4(&out[i + j], XMMATRIX(row0.r[j], row1.r[j], row2.r[j], row3.r[j]));
+	}
+}
@@ -6,29 +6,41 @@
 
 #pragma once
 
-#include <Windows.h>
 #include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <cmath>
 #include <cstdint>
+#include "Random.h"
 
 class MathHelper
 {
 public:
+	// The Rand functions draw from ThreadRandom, so they are safe to call from any
+	// thread and each thread's sequence does not depend on the others.
+
 	// Returns random float in [0, 1).
 	static float RandF()
 	{
-		return (float)(rand()) / (float)RAND_MAX;
+		return ThreadRandom().NextFloat();
 	}
 
 	// Returns random float in [a, b).
 	static float RandF(float a, float b)
 	{
-		return a + RandF()*(b-a);
+		return ThreadRandom().NextFloat(a, b);
 	}
 
-    static int Rand(int a, int b)
-    {
-        return a + rand() % ((b - a) + 1);
-    }
+	// Returns random int in [a, b].
+	static int Rand(int a, int b)
+	{
+		return ThreadRandom().NextInt(a, b);
+	}
+
+	// The calling thread's generator.  Threads get consecutive streams of one fixed seed
+	// in the order they first use it; SeedThreadRandom makes a thread's sequence
+	// independent of that order.
+	static Pcg32& ThreadRandom();
+	static void SeedThreadRandom(std::uint64_t seed, std::uint64_t stream);
 
 	template<typename T>
 	static T Min(const T& a, const T& b)
@@ -92,6 +104,62 @@ public:
     static DirectX::XMVECTOR RandUnitVec3();
     static DirectX::XMVECTOR RandHemisphereUnitVec3(DirectX::XMVECTOR n);
 
+	// count unit vectors spread evenly over the sphere, four at a time.  The Philox
+	// version gives vector i of stream seed as vector firstIndex + i, so workers can fill
+	// parts of one array independently.
+	static void FillUnitVec3(Xoshiro128x4& rng, DirectX::XMFLOAT3* out, std::size_t count);
+	static void FillUnitVec3(std::uint64_t seed, std::uint64_t firstIndex, DirectX::XMFLOAT3* out, std::size_t count);
+
+	//
+	// Batch kernels.  AoS versions take arrays of DirectXMath types; SoA versions take one
+	// float array per component and do four elements per step.  Matrices use the
+	// row-vector convention of DirectXMath (v * M).  in and out may be the same array.
+	//
+
+	struct Float3Arrays
+	{
+		float* X = nullptr;
+		float* Y = nullptr;
+		float* Z = nullptr;
+	};
+
+	struct Float4Arrays
+	{
+		float* X = nullptr;
+		float* Y = nullptr;
+		float* Z = nullptr;
+		float* W = nullptr;
+	};
+
+	// Same results as XMVector3TransformCoord / XMVector3TransformNormal per element.
+	static void TransformPoints(const DirectX::XMFLOAT3* in, DirectX::XMFLOAT3* out, std::size_t count, DirectX::CXMMATRIX m);
+	static void TransformNormals(const DirectX::XMFLOAT3* in, DirectX::XMFLOAT3* out, std::size_t count, DirectX::CXMMATRIX m);
+	static void TransformPoints(const Float3Arrays& in, const Float3Arrays& out, std::size_t count, DirectX::CXMMATRIX m);
+	static void TransformNormals(const Float3Arrays& in, const Float3Arrays& out, std::size_t count, DirectX::CXMMATRIX m);
+
+	// World AABBs of local AABBs under affine matrices (Arvo): the center is transformed
+	// and the extents go through the absolute 3x3 part.  As tight as transforming the
+	// eight corners, without the corners.
+	static void TransformAabbs(const DirectX::BoundingBox* in, DirectX::BoundingBox* out, std::size_t count, DirectX::CXMMATRIX m);
+	static void TransformAabbs(const DirectX::BoundingBox* in, const DirectX::XMFLOAT4X4* worlds, DirectX::BoundingBox* out, std::size_t count);
+	static void TransformAabbs(const Float3Arrays& centers, const Float3Arrays& extents,
+		const Float3Arrays& outCenters, const Float3Arrays& outExtents, std::size_t count, DirectX::CXMMATRIX m);
+
+	// out[i] = a[i] * b[i], or a[i] * b.
+	static void MultiplyMatrices(const DirectX::XMFLOAT4X4* a, const DirectX::XMFLOAT4X4* b, DirectX::XMFLOAT4X4* out, std::size_t count);
+	static void MultiplyMatrices(const DirectX::XMFLOAT4X4* a, DirectX::CXMMATRIX b, DirectX::XMFLOAT4X4* out, std::size_t count);
+
+	// out[i] = transpose(in[i]), the layout HLSL constant buffers expect.
+	static void TransposeMatrices(const DirectX::XMFLOAT4X4* in, DirectX::XMFLOAT4X4* out, std::size_t count);
+
+	// out[i] = scale * rotation (unit quaternion) * translation.  The AoS version matches
+	// XMMatrixScalingFromVector * XMMatrixRotationQuaternion * XMMatrixTranslationFromVector;
+	// the SoA version builds four matrices per step and agrees to float rounding.
+	static void BuildTrsMatrices(const DirectX::XMFLOAT3* scale, const DirectX::XMFLOAT4* rotation,
+		const DirectX::XMFLOAT3* translation, DirectX::XMFLOAT4X4* out, std::size_t count);
+	static void BuildTrsMatrices(const Float3Arrays& scale, const Float4Arrays& rotation,
+		const Float3Arrays& translation, DirectX::XMFLOAT4X4* out, std::size_t count);
+
 	static const float Infinity;
 	static const float Pi;
 
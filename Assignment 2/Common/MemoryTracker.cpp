@@ -0,0 +1,416 @@
+//***************************************************************************************
+// MemoryTracker.cpp
+//***************************************************************************************
+
+#include "MemoryTracker.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <dbghelp.h>
+#pragma comment(lib, "dbghelp.lib")
+#else
+#include <execinfo.h>
+#endif
+
+// The tracker's own frames are skipped by count, so they must not be inlined away.
+#if defined(_MSC_VER)
+#define TRACKER_NOINLINE __declspec(noinline)
+#else
+#define TRACKER_NOINLINE __attribute__((noinline))
+#endif
+
+namespace
+{
+	const std::uint32_t TagCount = (std::uint32_t)MemoryTag::Count;
+
+	// Prepended to every block; 16 bytes keeps the user pointer as aligned as malloc's.
+	struct BlockHeader
+	{
+		std::uint64_t Size;
+		std::uint32_t Tag;
+		std::uint32_t Magic;
+	};
+	static_assert(sizeof(BlockHeader) == 16, "BlockHeader must preserve malloc alignment");
+
+	const std::uint32_t BlockMagic = 0x4d454d54;
+
+	// All constant-initialized, so they work for allocations made before main.
+	std::atomic<std::int64_t> gCpuBytes[TagCount];
+	std::atomic<std::int64_t> gCpuPeakBytes[TagCount];
+	std::atomic<std::int64_t> gCpuBlocks[TagCount];
+	std::atomic<std::int64_t> gGpuBytes[TagCount];
+	std::atomic<std::uint64_t> gAllocations(0);
+	std::atomic<bool> gCaptureSites(false);
+
+	thread_local MemoryTag tTag = MemoryTag::Untagged;
+
+	// Set while the tracker itself is busy, so its own allocations are not captured.
+	thread_local bool tInTracker = false;
+
+	const std::uint32_t MaxSites = 256;
+	const std::uint32_t MaxFrames = 16;
+	const std::uint32_t SkipFrames = 3;    // CaptureSite, TrackedAlloc and OperatorNew
+
+	struct Site
+	{
+		std::uint64_t Hash;
+		std::uint64_t Count;
+		std::uint32_t Depth;
+		void* Frames[MaxFrames];
+	};
+
+	std::mutex gSiteMutex;
+	Site gSites[MaxSites];
+	std::uint32_t gSiteCount = 0;
+	std::uint64_t gUnattributed = 0;
+
+	TRACKER_NOINLINE void CaptureSite()
+	{
+		void* frames[MaxFrames + SkipFrames];
+#if defined(_WIN32)
+		const std::uint32_t captured = RtlCaptureStackBackTrace(0, MaxFrames + SkipFrames, frames, nullptr);
+#else
+		const std::uint32_t captured = (std::uint32_t)backtrace(frames, MaxFrames + SkipFrames);
+#endif
+		const std::uint32_t skip = std::min(captured, SkipFrames);
+		const std::uint32_t depth = captured - skip;
+
+		std::uint64_t hash = 14695981039346656037ull;
+		for(std::uint32_t i = 0; i < depth; ++i)
+		{
+			hash ^= (std::uint64_t)(std::uintptr_t)frames[skip + i];
+			hash *= 1099511628211ull;
+		}
+
+		std::lock_guard<std::mutex> lock(gSiteMutex);
+
+		// Open addressing; Hash 0 marks a free slot.
+		if(hash == 0)
+			hash = 1;
+		for(std::uint32_t probe = 0; probe < MaxSites; ++probe)
+		{
+			Site& site = gSites[(hash + probe) % MaxSites];
+			if(site.Hash == hash)
+			{
+				site.Count++;
+				return;
+			}
+			if(site.Hash == 0)
+			{
+				site.Hash = hash;
+				site.Count = 1;
+				site.Depth = depth;
+				std::copy(frames + skip, frames + skip + depth, site.Frames);
+				gSiteCount++;
+				return;
+			}
+		}
+
+		gUnattributed++;
+	}
+
+	TRACKER_NOINLINE void* TrackedAlloc(std::size_t size)
+	{
+		BlockHeader* header = (BlockHeader*)std::malloc(size + sizeof(BlockHeader));
+		if(header == nullptr)
+			return nullptr;
+
+		const std::uint32_t tag = (std::uint32_t)tTag;
+		header->Size = size;
+		header->Tag = tag;
+		header->Magic = BlockMagic;
+
+		gAllocations.fetch_add(1, std::memory_order_relaxed);
+		gCpuBlocks[tag].fetch_add(1, std::memory_order_relaxed);
+		const std::int64_t bytes = gCpuBytes[tag].fetch_add((std::int64_t)size, std::memory_order_relaxed) + (std::int64_t)size;
+
+		std::int64_t peak = gCpuPeakBytes[tag].load(std::memory_order_relaxed);
+		while(bytes > peak && !gCpuPeakBytes[tag].compare_exchange_weak(peak, bytes, std::memory_order_relaxed))
+		{
+		}
+
+		if(gCaptureSites.load(std::memory_order_relaxed) && !tInTracker)
+		{
+			tInTracker = true;
+			CaptureSite();
+			tInTracker = false;
+		}
+
+		return header + 1;
+	}
+
+	void TrackedFree(void* p)
+	{
+		if(p == nullptr)
+			return;
+
+		BlockHeader* header = (BlockHeader*)p - 1;
+		assert(header->Magic == BlockMagic);
+
+		gCpuBlocks[header->Tag].fetch_sub(1, std::memory_order_relaxed);
+		gCpuBytes[header->Tag].fetch_sub((std::int64_t)header->Size, std::memory_order_relaxed);
+
+		header->Magic = 0;
+		std::free(header);
+	}
+
+	TRACKER_NOINLINE void* OperatorNew(std::size_t size)
+	{
+		if(size == 0)
+			size = 1;
+
+		for(;;)
+		{
+			void* p = TrackedAlloc(size);
+			if(p != nullptr)
+				return p;
+
+			std::new_handler handler = std::get_new_handler();
+			if(handler == nullptr)
+				throw std::bad_alloc();
+			handler();
+		}
+	}
+
+	void* OperatorNewNoThrow(std::size_t size)
+	{
+		try
+		{
+			return OperatorNew(size);
+		}
+		catch(...)
+		{
+			return nullptr;
+		}
+	}
+
+	std::string DescribeFrame(void* address)
+	{
+		std::ostringstream out;
+#if defined(_WIN32)
+		static bool symbolsReady = false;
+		if(!symbolsReady)
+		{
+			SymSetOptions(SYMOPT_DEFERRED_LOADS | SYMOPT_LOAD_LINES | SYMOPT_UNDNAME);
+			SymInitialize(GetCurrentProcess(), nullptr, TRUE);
+			symbolsReady = true;
+		}
+
+		char buffer[sizeof(SYMBOL_INFO) + 256];
+		SYMBOL_INFO* symbol = (SYMBOL_INFO*)buffer;
+		symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+		symbol->MaxNameLen = 255;
+
+		DWORD64 displacement = 0;
+		if(SymFromAddr(GetCurrentProcess(), (DWORD64)address, &displacement, symbol))
+			out << symbol->Name;
+		else
+			out << address;
+
+		IMAGEHLP_LINE64 line = {};
+		line.SizeOfStruct = sizeof(line);
+		DWORD lineDisplacement = 0;
+		if(SymGetLineFromAddr64(GetCurrentProcess(), (DWORD64)address, &lineDisplacement, &line))
+			out << " (" << line.FileName << ":" << line.LineNumber << ")";
+#else
+		char** symbols = backtrace_symbols(&address, 1);
+		if(symbols != nullptr)
+		{
+			out << symbols[0];
+			std::free(symbols);
+		}
+		else
+		{
+			out << address;
+		}
+#endif
+		return out.str();
+	}
+}
+
+void* operator new(std::size_t size) { return OperatorNew(size); }
+void* operator new[](std::size_t size) { return OperatorNew(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return OperatorNewNoThrow(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return OperatorNewNoThrow(size); }
+void operator delete(void* p) noexcept { TrackedFree(p); }
+void operator delete[](void* p) noexcept { TrackedFree(p); }
+void operator delete(void* p, std::size_t) noexcept { TrackedFree(p); }
+void operator delete[](void* p, std::size_t) noexcept { TrackedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { TrackedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { TrackedFree(p); }
+
+const char* MemoryTracker::TagName(MemoryTag tag)
+{
+	static const char* names[TagCount] =
+	{
+		"untagged", "geometry", "textures", "upload_heaps", "waves", "cloth", "render_items", "frame_resources", "shaders"
+	};
+
+	return (std::uint32_t)tag < TagCount ? names[(std::uint32_t)tag] : "unknown";
+}
+
+MemoryTracker::TagStats MemoryTracker::GetStats(MemoryTag tag)
+{
+	const std::uint32_t i = (std::uint32_t)tag;
+
+	TagStats stats;
+	stats.CpuBytes = gCpuBytes[i].load(std::memory_order_relaxed);
+	stats.CpuPeakBytes = gCpuPeakBytes[i].load(std::memory_order_relaxed);
+	stats.CpuBlocks = gCpuBlocks[i].load(std::memory_order_relaxed);
+	stats.GpuBytes = gGpuBytes[i].load(std::memory_order_relaxed);
+	return stats;
+}
+
+void MemoryTracker::SetGpuBytes(MemoryTag tag, std::int64_t bytes)
+{
+	gGpuBytes[(std::uint32_t)tag].store(bytes, std::memory_order_relaxed);
+}
+
+void MemoryTracker::AddGpuBytes(MemoryTag tag, std::int64_t bytes)
+{
+	gGpuBytes[(std::uint32_t)tag].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+std::uint64_t MemoryTracker::AllocationCount()
+{
+	return gAllocations.load(std::memory_order_relaxed);
+}
+
+MemoryTag MemoryTracker::CurrentTag()
+{
+	return tTag;
+}
+
+void MemoryTracker::SetCurrentTag(MemoryTag tag)
+{
+	tTag = tag;
+}
+
+void MemoryTracker::SetSiteCapture(bool enabled)
+{
+	gCaptureSites.store(enabled, std::memory_order_relaxed);
+}
+
+void MemoryTracker::ClearSites()
+{
+	std::lock_guard<std::mutex> lock(gSiteMutex);
+	std::fill(std::begin(gSites), std::end(gSites), Site());
+	gSiteCount = 0;
+	gUnattributed = 0;
+}
+
+std::string MemoryTracker::SiteReport(std::uint32_t maxSites)
+{
+	const bool wasInTracker = tInTracker;
+	tInTracker = true;
+
+	std::vector<Site> sites;
+	std::uint64_t unattributed = 0;
+	{
+		std::lock_guard<std::mutex> lock(gSiteMutex);
+		for(const Site& site : gSites)
+		{
+			if(site.Hash != 0)
+				sites.push_back(site);
+		}
+		unattributed = gUnattributed;
+	}
+
+	std::sort(sites.begin(), sites.end(), [](const Site& a, const Site& b) { return a.Count > b.Count; });
+
+	std::ostringstream out;
+	out << sites.size() << " allocation sites";
+	if(unattributed > 0)
+		out << " (+" << unattributed << " allocations past the site table)";
+	out << "\n";
+
+	for(std::size_t i = 0; i < sites.size() && i < maxSites; ++i)
+	{
+		out << "  " << sites[i].Count << " allocations at:\n";
+		for(std::uint32_t f = 0; f < sites[i].Depth; ++f)
+			out << "    " << DescribeFrame(sites[i].Frames[f]) << "\n";
+	}
+
+	tInTracker = wasInTracker;
+	return out.str();
+}
+
+std::string MemoryTracker::Report()
+{
+	std::ostringstream out;
+	out << "Memory by subsystem (KB):\n";
+
+	for(std::uint32_t i = 0; i < TagCount; ++i)
+	{
+		const TagStats stats = GetStats((MemoryTag)i);
+		out << "  " << TagName((MemoryTag)i)
+			<< "  cpu " << stats.CpuBytes / 1024
+			<< " (peak " << stats.CpuPeakBytes / 1024 << ", " << stats.CpuBlocks << " blocks)"
+			<< "  gpu " << stats.GpuBytes / 1024 << "\n";
+	}
+
+	return out.str();
+}
+
+FrameAllocationCheck::FrameAllocationCheck(std::uint32_t warmupFrames) :
+	mWarmupFrames(warmupFrames)
+{
+}
+
+FrameAllocationCheck::~FrameAllocationCheck()
+{
+	MemoryTracker::SetSiteCapture(false);
+}
+
+void FrameAllocationCheck::BeginFrame()
+{
+	mFrame++;
+	mChecking = mFrame > mWarmupFrames;
+	if(!mChecking)
+		return;
+
+	MemoryTracker::SetSiteCapture(true);
+	mFrameStartCount = MemoryTracker::AllocationCount();
+}
+
+std::uint64_t FrameAllocationCheck::EndFrame()
+{
+	if(!mChecking)
+		return 0;
+
+	const std::uint64_t allocations = MemoryTracker::AllocationCount() - mFrameStartCount;
+	MemoryTracker::SetSiteCapture(false);
+	mChecking = false;
+
+	mFramesChecked++;
+	if(allocations > 0)
+	{
+		mFramesWithAllocations++;
+		mAllocations += allocations;
+	}
+
+	return allocations;
+}
+
+std::string FrameAllocationCheck::Report()const
+{
+	std::ostringstream out;
+	out << "Frame allocation check: " << mFramesChecked << " frames after " << mWarmupFrames
+		<< " warm-up frames, " << mFramesWithAllocations << " allocated (" << mAllocations << " allocations)\n";
+
+	if(mFramesWithAllocations > 0)
+		out << MemoryTracker::SiteReport();
+
+	return out.str();
+}
@@ -0,0 +1,127 @@
+//***************************************************************************************
+// MemoryTracker.h
+//
+// Memory use by subsystem, and a check that the steady-state frame does not allocate.
+//
+// MemoryTracker.cpp replaces the global operator new/delete.  Every C++ heap block
+// carries a small header recording its size and the tag that was current on the
+// allocating thread (set with MemoryScope), so the block is charged to that tag until
+// it is freed, whichever thread frees it.  Allocations made straight through malloc
+// or by the OS/driver are not seen.  GPU memory is reported by whoever creates the
+// resources, with SetGpuBytes/AddGpuBytes.
+//
+// While call site capture is on, each allocation's call stack is recorded so a
+// frame that allocates can be traced back to the code responsible.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+enum class MemoryTag : std::uint8_t
+{
+	Untagged = 0,
+	Geometry,
+	Textures,
+	UploadHeaps,
+	Waves,
+	Cloth,
+	RenderItems,
+	FrameResources,
+	Shaders,
+	Count
+};
+
+class MemoryTracker
+{
+public:
+	struct TagStats
+	{
+		std::int64_t CpuBytes = 0;
+		std::int64_t CpuPeakBytes = 0;
+		std::int64_t CpuBlocks = 0;
+		std::int64_t GpuBytes = 0;
+	};
+
+	static const char* TagName(MemoryTag tag);
+
+	static TagStats GetStats(MemoryTag tag);
+
+	static void SetGpuBytes(MemoryTag tag, std::int64_t bytes);
+	static void AddGpuBytes(MemoryTag tag, std::int64_t bytes);
+
+	// operator new calls so far, from all threads.
+	static std::uint64_t AllocationCount();
+
+	// Records the call stack of every allocation while on.  Sites are kept in a fixed
+	// table; allocations from sites that do not fit are counted but not attributed.
+	static void SetSiteCapture(bool enabled);
+	static void ClearSites();
+
+	// The busiest captured sites with their symbolized stacks.
+	static std::string SiteReport(std::uint32_t maxSites = 8);
+
+	// One line per tag with CPU and GPU bytes.
+	static std::string Report();
+
+	// Used by operator new.
+	static MemoryTag CurrentTag();
+	static void SetCurrentTag(MemoryTag tag);
+};
+
+// Charges the calling thread's allocations to tag until the scope ends.
+class MemoryScope
+{
+public:
+	explicit MemoryScope(MemoryTag tag) : mPrevious(MemoryTracker::CurrentTag())
+	{
+		MemoryTracker::SetCurrentTag(tag);
+	}
+
+	~MemoryScope()
+	{
+		MemoryTracker::SetCurrentTag(mPrevious);
+	}
+
+	MemoryScope(const MemoryScope& rhs) = delete;
+	MemoryScope& operator=(const MemoryScope& rhs) = delete;
+
+private:
+	MemoryTag mPrevious;
+};
+
+// Counts allocations between BeginFrame and EndFrame once warmupFrames frames have
+// passed, capturing call sites for those frames.  Allocations on any thread count,
+// since the simulation stage runs alongside the frame.
+class FrameAllocationCheck
+{
+public:
+	explicit FrameAllocationCheck(std::uint32_t warmupFrames);
+	~FrameAllocationCheck();
+	FrameAllocationCheck(const FrameAllocationCheck& rhs) = delete;
+	FrameAllocationCheck& operator=(const FrameAllocationCheck& rhs) = delete;
+
+	void BeginFrame();
+
+	// Returns the allocations made since BeginFrame, or 0 while warming up.
+	std::uint64_t EndFrame();
+
+	std::uint64_t FramesChecked()const { return mFramesChecked; }
+	std::uint64_t FramesWithAllocations()const { return mFramesWithAllocations; }
+	std::uint64_t Allocations()const { return mAllocations; }
+	bool Passed()const { return mFramesWithAllocations == 0; }
+
+	// Totals plus the call sites of the allocations seen.
+	std::string Report()const;
+
+private:
+	std::uint32_t mWarmupFrames;
+	std::uint64_t mFrame = 0;
+	std::uint64_t mFrameStartCount = 0;
+	bool mChecking = false;
+
+	std::uint64_t mFramesChecked = 0;
+	std::uint64_t mFramesWithAllocations = 0;
+	std::uint64_t mAllocations = 0;
+};
@@ -0,0 +1,145 @@
+//***************************************************************************************
+// MetricsRegistry.cpp
+//***************************************************************************************
+
+#include "MetricsRegistry.h"
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+	std::uint64_t ToBits(double value)
+	{
+		std::uint64_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	double FromBits(std::uint64_t bits)
+	{
+		double value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	void WriteValue(std::ostream& out, double value)
+	{
+		if(std::isnan(value))
+			out << "NaN";
+		else if(std::isinf(value))
+			out << (value > 0.0 ? "+Inf" : "-Inf");
+		else
+			out << std::setprecision(15) << value;
+	}
+
+	void WriteSeries(std::ostream& out, const MetricsRegistry::Metric& metric)
+	{
+		out << metric.Name();
+		if(!metric.Labels().empty())
+			out << "{" << metric.Labels() << "}";
+		out << " ";
+		WriteValue(out, metric.Value());
+		out << "\n";
+	}
+}
+
+void MetricsRegistry::Metric::Set(double value)
+{
+	mBits.store(ToBits(value), std::memory_order_relaxed);
+}
+
+void MetricsRegistry::Metric::Add(double delta)
+{
+	std::uint64_t expected = mBits.load(std::memory_order_relaxed);
+	while(!mBits.compare_exchange_weak(expected, ToBits(FromBits(expected) + delta), std::memory_order_relaxed))
+	{
+	}
+}
+
+double MetricsRegistry::Metric::Value()const
+{
+	return FromBits(mBits.load(std::memory_order_relaxed));
+}
+
+MetricsRegistry::Metric* MetricsRegistry::AddCounter(const std::string& name, const std::string& help, const std::string& labels)
+{
+	return Add(Counter, name, help, labels);
+}
+
+MetricsRegistry::Metric* MetricsRegistry::AddGauge(const std::string& name, const std::string& help, const std::string& labels)
+{
+	return Add(Gauge, name, help, labels);
+}
+
+MetricsRegistry::Metric* MetricsRegistry::Add(MetricType type, const std::string& name, const std::string& help, const std::string& labels)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	for(Metric& m : mMetrics)
+	{
+		if(m.mName == name && m.mLabels == labels)
+			return &m;
+	}
+
+	mMetrics.emplace_back();
+	Metric& m = mMetrics.back();
+	m.mName = name;
+	m.mLabels = labels;
+	m.mHelp = help;
+	m.mType = type;
+	m.Set(0.0);
+	return &m;
+}
+
+std::string MetricsRegistry::PrometheusText()const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	std::ostringstream out;
+	std::vector<bool> written(mMetrics.size(), false);
+
+	// Series of one name must be contiguous, so gather them after the first.
+	for(std::size_t i = 0; i < mMetrics.size(); ++i)
+	{
+		if(written[i])
+			continue;
+
+		const Metric& first = mMetrics[i];
+		if(!first.mHelp.empty())
+			out << "# HELP " << first.mName << " " << first.mHelp << "\n";
+		out << "# TYPE " << first.mName << " " << (first.mType == Counter ? "counter" : "gauge") << "\n";
+
+		for(std::size_t j = i; j < mMetrics.size(); ++j)
+		{
+			if(!written[j] && mMetrics[j].mName == first.mName)
+			{
+				WriteSeries(out, mMetrics[j]);
+				written[j] = true;
+			}
+		}
+	}
+
+	return out.str();
+}
+
+std::string MetricsRegistry::LineText(const std::string& name)const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	std::ostringstream out;
+	for(const Metric& m : mMetrics)
+	{
+		if(name.empty() || m.mName == name)
+			WriteSeries(out, m);
+	}
+
+	return out.str();
+}
+
+std::size_t MetricsRegistry::SeriesCount()const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mMetrics.size();
+}
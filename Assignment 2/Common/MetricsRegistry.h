@@ -0,0 +1,77 @@
+//***************************************************************************************
+// MetricsRegistry.h
+//
+// Named counters and gauges that the frame loop updates and a reader (MetricsServer)
+// scrapes.  Values are atomics, so updating one never takes a lock and never waits on
+// a reader; only registering a new series takes the registry's mutex, which is meant
+// to happen at startup.  Series are rendered in the Prometheus text exposition format
+// or as plain "name{labels} value" lines.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class MetricsRegistry
+{
+public:
+	enum MetricType
+	{
+		Counter,    // only goes up
+		Gauge
+	};
+
+	// One series.  Handles stay valid for the registry's lifetime.
+	class Metric
+	{
+	public:
+		void Set(double value);
+		void Add(double delta);
+		double Value()const;
+
+		const std::string& Name()const { return mName; }
+		const std::string& Labels()const { return mLabels; }
+		MetricType Type()const { return mType; }
+
+	private:
+		friend class MetricsRegistry;
+
+		std::string mName;
+		std::string mLabels;    // e.g. quantile="0.99",metric="cpu"; may be empty
+		std::string mHelp;
+		MetricType mType = Gauge;
+
+		// The value's bit pattern, so doubles can be stored and updated atomically.
+		std::atomic<std::uint64_t> mBits{ 0 };
+	};
+
+	MetricsRegistry() = default;
+	MetricsRegistry(const MetricsRegistry& rhs) = delete;
+	MetricsRegistry& operator=(const MetricsRegistry& rhs) = delete;
+
+	// Returns the existing series if name and labels were registered before.
+	Metric* AddCounter(const std::string& name, const std::string& help, const std::string& labels = "");
+	Metric* AddGauge(const std::string& name, const std::string& help, const std::string& labels = "");
+
+	// Prometheus text format 0.0.4: HELP and TYPE once per name, then every series.
+	std::string PrometheusText()const;
+
+	// "name{labels} value" per series; only series called name if it is not empty.
+	std::string LineText(const std::string& name = "")const;
+
+	std::size_t SeriesCount()const;
+
+private:
+	Metric* Add(MetricType type, const std::string& name, const std::string& help, const std::string& labels);
+
+private:
+	mutable std::mutex mMutex;
+
+	// A deque so handles do not move as series are added.
+	std::deque<Metric> mMetrics;
+};
@@ -0,0 +1,314 @@
+//***************************************************************************************
+// MetricsServer.cpp
+//***************************************************************************************
+
+#include "MetricsServer.h"
+#include <cstring>
+#include <sstream>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#if defined(_WIN32)
+	typedef SOCKET SocketType;
+	const int SendFlags = 0;
+
+	void CloseSocket(SocketType s) { closesocket(s); }
+	bool IsValid(SocketType s) { return s != INVALID_SOCKET; }
+#else
+	typedef int SocketType;
+	const int SendFlags = MSG_NOSIGNAL;
+
+	void CloseSocket(SocketType s) { close(s); }
+	bool IsValid(SocketType s) { return s >= 0; }
+#endif
+
+	SocketType ToSocket(std::intptr_t s) { return (SocketType)s; }
+
+	const std::size_t MaxRequestLine = 1024;
+
+	void SetReceiveTimeout(SocketType s, int ms)
+	{
+#if defined(_WIN32)
+		DWORD timeout = (DWORD)ms;
+		setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+#else
+		timeval timeout;
+		timeout.tv_sec = ms / 1000;
+		timeout.tv_usec = (ms % 1000) * 1000;
+		setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#endif
+	}
+
+	// Reads one '\n'-terminated line without the line ending.  False on timeout, close
+	// or an over-long line.
+	bool ReadLine(SocketType s, std::string& line)
+	{
+		line.clear();
+		char c = 0;
+		while(line.size() < MaxRequestLine)
+		{
+			if(recv(s, &c, 1, 0) != 1)
+				return false;
+			if(c == '\n')
+			{
+				if(!line.empty() && line.back() == '\r')
+					line.pop_back();
+				return true;
+			}
+			line.push_back(c);
+		}
+		return false;
+	}
+
+	void SendAll(SocketType s, const std::string& data)
+	{
+		std::size_t sent = 0;
+		while(sent < data.size())
+		{
+			int n = send(s, data.data() + sent, (int)(data.size() - sent), SendFlags);
+			if(n <= 0)
+				return;
+			sent += (std::size_t)n;
+		}
+	}
+
+	std::string HttpResponse(const char* status, const std::string& body)
+	{
+		std::ostringstream out;
+		out << "HTTP/1.0 " << status << "\r\n"
+			<< "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+			<< "Content-Length: " << body.size() << "\r\n"
+			<< "Connection: close\r\n\r\n"
+			<< body;
+		return out.str();
+	}
+}
+
+MetricsServer::MetricsServer(const MetricsRegistry& registry) :
+	mRegistry(registry)
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+	Stop();
+}
+
+std::string MetricsServer::Respond(const MetricsRegistry& registry, const std::string& request)
+{
+	if(request.compare(0, 4, "GET ") == 0)
+	{
+		std::istringstream in(request.substr(4));
+		std::string path;
+		in >> path;
+
+		if(path == "/metrics" || path == "/")
+			return HttpResponse("200 OK", registry.PrometheusText());
+		return HttpResponse("404 Not Found", "not found\n");
+	}
+
+	if(request == "metrics")
+		return registry.PrometheusText();
+
+	if(request == "list")
+		return registry.LineText();
+
+	if(request.compare(0, 4, "get ") == 0)
+	{
+		const std::string name = request.substr(4);
+		std::string lines = name.empty() ? std::string() : registry.LineText(name);
+		return lines.empty() ? "error: no series named '" + name + "'\n" : lines;
+	}
+
+	return "error: unknown request (try metrics, list, get <name> or GET /metrics)\n";
+}
+
+bool MetricsServer::StartTcp(std::uint16_t port)
+{
+	if(IsRunning())
+		return false;
+
+#if defined(_WIN32)
+	WSADATA wsaData;
+	if(WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+		return false;
+	mNetworkStarted = true;
+#endif
+
+	SocketType s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if(!IsValid(s))
+	{
+		Stop();
+		return false;
+	}
+	mListen = (std::intptr_t)s;
+
+#if !defined(_WIN32)
+	// Lets a restarted instance take the port back while old connections time out.
+	int reuse = 1;
+	setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+
+	// Loopback only; this is not meant to be reachable from other machines.
+	sockaddr_in address;
+	std::memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons(port);
+
+	if(bind(s, (const sockaddr*)&address, sizeof(address)) != 0)
+	{
+		Stop();
+		return false;
+	}
+
+	sockaddr_in bound;
+	socklen_t boundSize = sizeof(bound);
+	if(getsockname(s, (sockaddr*)&bound, &boundSize) == 0)
+		mPort = ntohs(bound.sin_port);
+
+	return Listen();
+}
+
+bool MetricsServer::StartUnix(const std::string& path)
+{
+#if defined(_WIN32)
+	(void)path;
+	return false;
+#else
+	if(IsRunning())
+		return false;
+
+	sockaddr_un address;
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if(path.empty() || path.size() >= sizeof(address.sun_path))
+		return false;
+	std::memcpy(address.sun_path, path.c_str(), path.size());
+
+	SocketType s = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(!IsValid(s))
+		return false;
+	mListen = (std::intptr_t)s;
+
+	// A socket file left by an instance that did not shut down cleanly blocks bind.
+	unlink(path.c_str());
+	if(bind(s, (const sockaddr*)&address, sizeof(address)) != 0)
+	{
+		Stop();
+		return false;
+	}
+	mUnixPath = path;
+
+	return Listen();
+#endif
+}
+
+bool MetricsServer::Listen()
+{
+	if(listen(ToSocket(mListen), 8) != 0)
+	{
+		Stop();
+		return false;
+	}
+
+	mStop.store(false);
+	mThread = std::thread(&MetricsServer::ServerMain, this);
+	return true;
+}
+
+void MetricsServer::Stop()
+{
+	mStop.store(true);
+	if(mThread.joinable())
+		mThread.join();
+
+	if(mListen != -1)
+	{
+		CloseSocket(ToSocket(mListen));
+		mListen = -1;
+	}
+
+#if !defined(_WIN32)
+	if(!mUnixPath.empty())
+	{
+		unlink(mUnixPath.c_str());
+		mUnixPath.clear();
+	}
+#else
+	if(mNetworkStarted)
+	{
+		WSACleanup();
+		mNetworkStarted = false;
+	}
+#endif
+
+	mPort = 0;
+}
+
+void MetricsServer::ServerMain()
+{
+	const SocketType listener = ToSocket(mListen);
+
+	while(!mStop.load())
+	{
+		// Wake up regularly to notice Stop.
+		fd_set readable;
+		FD_ZERO(&readable);
+		FD_SET(listener, &readable);
+		timeval timeout;
+		timeout.tv_sec = 0;
+		timeout.tv_usec = 100 * 1000;
+
+		if(select((int)listener + 1, &readable, nullptr, nullptr, &timeout) <= 0)
+			continue;
+
+		SocketType client = accept(listener, nullptr, nullptr);
+		if(!IsValid(client))
+			continue;
+
+		Serve((std::intptr_t)client);
+		CloseSocket(client);
+	}
+}
+
+void MetricsServer::Serve(std::intptr_t client)
+{
+	const SocketType s = ToSocket(client);
+
+	// Clients are local and should send their line at once; do not let a stuck one hold
+	// up the next scrape for long.
+	SetReceiveTimeout(s, 1000);
+
+	std::string request;
+	if(!ReadLine(s, request))
+		return;
+
+	// Read the rest of an HTTP request's headers so closing does not reset the
+	// connection before the client has read the response.
+	if(request.compare(0, 4, "GET ") == 0)
+	{
+		std::string header;
+		while(ReadLine(s, header) && !header.empty())
+		{
+		}
+	}
+
+	SendAll(s, Respond(mRegistry, request));
+	mRequests.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,66 @@
+//***************************************************************************************
+// MetricsServer.h
+//
+// Serves a MetricsRegistry to local clients from a background thread, on 127.0.0.1 TCP
+// or (POSIX only) a Unix domain socket.  Each connection sends one request line and
+// gets one response before the server closes it:
+//
+//   GET /metrics HTTP/1.x   HTTP response with the Prometheus text (for scrapers)
+//   metrics                 the Prometheus text
+//   list                    every series as "name{labels} value"
+//   get <name>              the series called <name>, same format
+//
+// Anything else gets "error: ..." back.  The server only reads the registry's atomics,
+// so the frame loop is never blocked by a scrape.
+//***************************************************************************************
+
+#pragma once
+
+#include "MetricsRegistry.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+class MetricsServer
+{
+public:
+	explicit MetricsServer(const MetricsRegistry& registry);
+	MetricsServer(const MetricsServer& rhs) = delete;
+	MetricsServer& operator=(const MetricsServer& rhs) = delete;
+	~MetricsServer();
+
+	// Listens on 127.0.0.1:port; port 0 picks a free one (see Port()).  Returns false
+	// if the socket could not be set up.
+	bool StartTcp(std::uint16_t port);
+
+	// Listens on a Unix domain socket at path, replacing a stale one.  Not available on
+	// Windows, where it returns false.
+	bool StartUnix(const std::string& path);
+
+	void Stop();
+
+	bool IsRunning()const { return mThread.joinable(); }
+	std::uint16_t Port()const { return mPort; }
+	std::uint64_t RequestsServed()const { return mRequests.load(std::memory_order_relaxed); }
+
+	// The response to one request line, without any socket.
+	static std::string Respond(const MetricsRegistry& registry, const std::string& request);
+
+private:
+	bool Listen();
+	void ServerMain();
+	void Serve(std::intptr_t client);
+
+private:
+	const MetricsRegistry& mRegistry;
+
+	std::intptr_t mListen = -1;
+	std::uint16_t mPort = 0;
+	std::string mUnixPath;
+	bool mNetworkStarted = false;
+
+	std::thread mThread;
+	std::atomic<bool> mStop{ false };
+	std::atomic<std::uint64_t> mRequests{ 0 };
+};
@@ -0,0 +1,131 @@
+//***************************************************************************************
+// NullCommandBackend.cpp
+//***************************************************************************************
+
+#include "NullCommandBackend.h"
+#include <sstream>
+
+bool NullCommandBackend::Execute(const CommandStream& stream)
+{
+	const std::uint32_t invalidBefore = mStats.InvalidDraws;
+
+	// Nothing carries over between streams, just like a fresh command list.
+	bool hasPipeline = false;
+	bool hasRootSignature = false;
+	bool hasTopology = false;
+	bool hasVertexBuffer = false;
+	bool hasIndexBuffer = false;
+	std::uint32_t indexBufferSize = 0;
+	std::uint32_t indexSize = 2;
+	bool corrupt = false;
+
+	for(const CommandStream::Header* h = stream.First(); h != nullptr; h = stream.Next(h))
+	{
+		mStats.Commands++;
+
+		switch(h->Type)
+		{
+		case CommandStream::CmdSetPipeline:
+			hasPipeline = true;
+			mStats.PipelineChanges++;
+			break;
+		case CommandStream::CmdSetRootSignature:
+			hasRootSignature = true;
+			mStats.RootSignatureChanges++;
+			break;
+		case CommandStream::CmdSetPrimitiveTopology:
+			hasTopology = true;
+			break;
+		case CommandStream::CmdSetVertexBuffer:
+			hasVertexBuffer = true;
+			mStats.BufferBinds++;
+			break;
+		case CommandStream::CmdSetIndexBuffer:
+		{
+			auto cmd = reinterpret_cast<const CommandStream::SetIndexBufferCmd*>(h);
+			hasIndexBuffer = true;
+			indexBufferSize = cmd->SizeInBytes;
+			// DXGI_FORMAT_R32_UINT is 42; everything else used for indices is 16-bit.
+			indexSize = cmd->Format == 42 ? 4 : 2;
+			mStats.BufferBinds++;
+			break;
+		}
+		case CommandStream::CmdSetRootConstant:
+			mStats.RootConstants++;
+			break;
+		case CommandStream::CmdSetRootTable:
+		case CommandStream::CmdSetRootCbv:
+		case CommandStream::CmdSetRootSrv:
+			mStats.RootArguments++;
+			break;
+		case CommandStream::CmdDrawIndexed:
+		{
+			auto cmd = reinterpret_cast<const CommandStream::DrawIndexedCmd*>(h);
+
+			std::string error;
+			if(!hasPipeline)
+				error = "draw without a pipeline";
+			else if(!hasRootSignature)
+				error = "draw without a root signature";
+			else if(!hasTopology)
+				error = "draw without a primitive topology";
+			else if(!hasVertexBuffer)
+				error = "draw without a vertex buffer";
+			else if(!hasIndexBuffer)
+				error = "draw without an index buffer";
+			else if((std::uint64_t)(cmd->StartIndex + cmd->IndexCount) * indexSize > indexBufferSize)
+				error = "draw reads past the end of the index buffer";
+
+			if(!error.empty())
+			{
+				mStats.InvalidDraws++;
+				Fail("command " + std::to_string(mStats.Commands - 1) + ": " + error);
+				break;
+			}
+
+			mStats.Draws++;
+			mStats.Indices += (std::uint64_t)cmd->IndexCount * cmd->InstanceCount;
+			mStats.Triangles += (std::uint64_t)(cmd->IndexCount / 3) * cmd->InstanceCount;
+			break;
+		}
+		default:
+			corrupt = true;
+			Fail("command " + std::to_string(mStats.Commands - 1) + ": unknown type " + std::to_string(h->Type));
+			break;
+		}
+
+		if(corrupt)
+			break;
+	}
+
+	return !corrupt && mStats.InvalidDraws == invalidBefore;
+}
+
+void NullCommandBackend::ResetStats()
+{
+	mStats = Stats();
+	mFirstError.clear();
+}
+
+void NullCommandBackend::Fail(const std::string& error)
+{
+	if(mFirstError.empty())
+		mFirstError = error;
+}
+
+std::string NullCommandBackend::StatsString()const
+{
+	std::ostringstream out;
+	out << "Commands: " << mStats.Commands
+		<< "  Draws: " << mStats.Draws
+		<< "  Triangles: " << mStats.Triangles
+		<< "  PSO changes: " << mStats.PipelineChanges
+		<< "  Buffer binds: " << mStats.BufferBinds
+		<< "  Root args: " << mStats.RootArguments
+		<< "  Root constants: " << mStats.RootConstants;
+
+	if(mStats.InvalidDraws > 0)
+		out << "  Invalid draws: " << mStats.InvalidDraws << " (" << mFirstError << ")";
+
+	return out.str();
+}
@@ -0,0 +1,53 @@
+//***************************************************************************************
+// NullCommandBackend.h
+//
+// Walks a CommandStream without a device.  Every draw is checked against the bound
+// state (pipeline, root signature, vertex and index buffers) and the work is counted,
+// so recording code can be exercised and measured headless.
+//***************************************************************************************
+
+#pragma once
+
+#include "CommandStream.h"
+
+class NullCommandBackend
+{
+public:
+	struct Stats
+	{
+		std::uint32_t Commands = 0;
+		std::uint32_t Draws = 0;
+		std::uint64_t Indices = 0;
+		std::uint64_t Triangles = 0;
+		std::uint32_t PipelineChanges = 0;
+		std::uint32_t RootSignatureChanges = 0;
+		std::uint32_t BufferBinds = 0;
+		std::uint32_t RootArguments = 0;
+		std::uint32_t RootConstants = 0;
+		std::uint32_t InvalidDraws = 0;
+	};
+
+	NullCommandBackend() = default;
+	NullCommandBackend(const NullCommandBackend& rhs) = delete;
+	NullCommandBackend& operator=(const NullCommandBackend& rhs) = delete;
+
+	// Replays the stream; returns false if any command was invalid.  Stats accumulate
+	// across calls until ResetStats.
+	bool Execute(const CommandStream& stream);
+
+	void ResetStats();
+
+	const Stats& GetStats()const { return mStats; }
+
+	// Description of the first invalid command seen, or empty.
+	const std::string& FirstError()const { return mFirstError; }
+
+	std::string StatsString()const;
+
+private:
+	void Fail(const std::string& error);
+
+private:
+	Stats mStats;
+	std::string mFirstError;
+};
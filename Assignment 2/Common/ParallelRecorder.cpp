@@ -0,0 +1,172 @@
+//***************************************************************************************
+// ParallelRecorder.cpp
+//***************************************************************************************
+
+#include "ParallelRecorder.h"
+#include "NullCommandBackend.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace
+{
+	double MsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+ParallelRecorder::ParallelRecorder(TaskPool& pool) :
+	mPool(pool)
+{
+}
+
+void ParallelRecorder::Partition(const std::vector<std::uint32_t>& costs, std::uint32_t maxRanges,
+	std::uint32_t minItemsPerRange, std::vector<Range>& ranges)
+{
+	ranges.clear();
+
+	const std::uint32_t count = (std::uint32_t)costs.size();
+	if(count == 0)
+		return;
+
+	std::uint32_t rangeCount = std::max(1u, std::min(maxRanges, count / std::max(1u, minItemsPerRange)));
+
+	std::uint64_t totalCost = 0;
+	for(std::uint32_t c : costs)
+		totalCost += c;
+
+	// Cut whenever the running cost passes the next multiple of total/rangeCount, but
+	// leave enough items for the ranges still to come.
+	Range range;
+	std::uint64_t runningCost = 0;
+	for(std::uint32_t i = 0; i < count; ++i)
+	{
+		runningCost += costs[i];
+
+		const std::uint32_t rangesLeft = rangeCount - (std::uint32_t)ranges.size() - 1;
+		const std::uint64_t cutCost = totalCost * (ranges.size() + 1) / rangeCount;
+		const std::uint32_t itemsInRange = i + 1 - range.Begin;
+		const std::uint32_t itemsLeft = count - (i + 1);
+
+		if(rangesLeft > 0 && runningCost >= cutCost &&
+			itemsInRange >= minItemsPerRange && itemsLeft >= rangesLeft * minItemsPerRange)
+		{
+			range.End = i + 1;
+			ranges.push_back(range);
+			range.Begin = i + 1;
+		}
+	}
+
+	range.End = count;
+	ranges.push_back(range);
+}
+
+void ParallelRecorder::Record(const std::vector<Range>& ranges, const RecordCallback& record,
+	const ReplayCallback& replay)
+{
+	const std::uint32_t rangeCount = (std::uint32_t)ranges.size();
+
+	while(mStreams.size() < rangeCount)
+		mStreams.push_back(std::make_unique<CommandStream>());
+	mStreamCount = rangeCount;
+	mRangeMs.assign(rangeCount, 0.0);
+
+	auto wallStart = std::chrono::steady_clock::now();
+
+	// Captured by a single reference so the callback fits in std::function's inline
+	// storage and recording does not allocate every frame.
+	struct Job
+	{
+		ParallelRecorder* Recorder;
+		const std::vector<Range>* Ranges;
+		const RecordCallback* Record;
+		const ReplayCallback* Replay;
+	};
+	const Job job = { this, &ranges, &record, &replay };
+
+	mPool.ParallelFor(rangeCount, [&job](std::uint32_t index, std::uint32_t)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		const Range& range = (*job.Ranges)[index];
+		CommandStream& stream = *job.Recorder->mStreams[index];
+		(*job.Record)(stream, range.Begin, range.End);
+		if(*job.Replay)
+			(*job.Replay)(stream, index);
+
+		job.Recorder->mRangeMs[index] = MsSince(start);
+	});
+
+	mStats.Ranges = rangeCount;
+	mStats.WallMs = MsSince(wallStart);
+	mStats.LongestRangeMs = 0.0;
+	mStats.TotalRangeMs = 0.0;
+	for(double ms : mRangeMs)
+	{
+		mStats.LongestRangeMs = std::max(mStats.LongestRangeMs, ms);
+		mStats.TotalRangeMs += ms;
+	}
+}
+
+std::string ParallelRecorder::MeasureScaling(const std::vector<std::uint32_t>& costs,
+	const RecordCallback& record, std::uint32_t repeats)
+{
+	std::string report = "Parallel recording of " + std::to_string(costs.size()) + " draws:\n";
+
+	std::vector<Range> ranges;
+	std::vector<NullCommandBackend> backends(mPool.ThreadCount());
+	std::uint32_t serialDraws = 0;
+	double serialMs = 0.0;
+
+	for(std::uint32_t rangeCount = 1; rangeCount <= mPool.ThreadCount(); rangeCount *= 2)
+	{
+		Partition(costs, rangeCount, 1, ranges);
+
+		double bestMs = 0.0;
+		double bestImbalance = 0.0;
+		std::uint32_t draws = 0;
+		bool valid = true;
+
+		for(std::uint32_t r = 0; r < std::max(1u, repeats); ++r)
+		{
+			for(auto& backend : backends)
+				backend.ResetStats();
+
+			// Each range replays on its own null backend, in parallel like a real one.
+			Record(ranges, record, [&](const CommandStream& stream, std::uint32_t range)
+			{
+				backends[range].Execute(stream);
+			});
+
+			draws = 0;
+			for(std::uint32_t i = 0; i < mStreamCount; ++i)
+			{
+				draws += backends[i].GetStats().Draws;
+				valid = valid && backends[i].GetStats().InvalidDraws == 0;
+			}
+
+			if(r == 0 || mStats.WallMs < bestMs)
+			{
+				bestMs = mStats.WallMs;
+				bestImbalance = mStats.TotalRangeMs > 0.0 ?
+					mStats.LongestRangeMs * mStats.Ranges / mStats.TotalRangeMs : 1.0;
+			}
+		}
+
+		if(rangeCount == 1)
+		{
+			serialDraws = draws;
+			serialMs = bestMs;
+		}
+		valid = valid && draws == serialDraws;
+
+		char line[160];
+		std::snprintf(line, sizeof(line), "  %2u ranges: %8.3f ms  speedup %5.2fx  imbalance %4.2f  %s\n",
+			(unsigned)ranges.size(), bestMs, bestMs > 0.0 ? serialMs / bestMs : 1.0, bestImbalance,
+			valid ? "ok" : "MISMATCH");
+		report += line;
+	}
+
+	return report;
+}
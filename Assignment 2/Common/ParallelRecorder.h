@@ -0,0 +1,72 @@
+//***************************************************************************************
+// ParallelRecorder.h
+//
+// Splits a draw list into contiguous ranges of similar cost and records each range into
+// its own CommandStream on a TaskPool.  An optional replay callback runs on the same
+// thread right after a range is recorded (e.g. to translate it into a per-thread D3D12
+// command list), so the whole range stays on one core.  Ranges are numbered in draw
+// order; submitting them in that order reproduces the serial result.
+//
+// MeasureScaling records the same list with 1, 2, 4, ... ranges and replays the
+// streams on NullCommandBackend, so partitioning and scaling can be measured headless.
+//***************************************************************************************
+
+#pragma once
+
+#include "CommandStream.h"
+#include "TaskPool.h"
+#include <memory>
+#include <string>
+
+class ParallelRecorder
+{
+public:
+	struct Range
+	{
+		std::uint32_t Begin = 0;
+		std::uint32_t End = 0;
+	};
+
+	using RecordCallback = std::function<void(CommandStream& stream, std::uint32_t begin, std::uint32_t end)>;
+	using ReplayCallback = std::function<void(const CommandStream& stream, std::uint32_t range)>;
+
+	struct Stats
+	{
+		std::uint32_t Ranges = 0;
+		double WallMs = 0.0;
+		double LongestRangeMs = 0.0;
+		double TotalRangeMs = 0.0;
+	};
+
+	explicit ParallelRecorder(TaskPool& pool);
+	ParallelRecorder(const ParallelRecorder& rhs) = delete;
+	ParallelRecorder& operator=(const ParallelRecorder& rhs) = delete;
+
+	// Cuts costs.size() items into at most maxRanges ranges of roughly equal total cost.
+	// Each range gets at least minItemsPerRange items, so short lists stay serial.
+	static void Partition(const std::vector<std::uint32_t>& costs, std::uint32_t maxRanges,
+		std::uint32_t minItemsPerRange, std::vector<Range>& ranges);
+
+	// Records every range in parallel and blocks until all are done (and replayed).
+	void Record(const std::vector<Range>& ranges, const RecordCallback& record,
+		const ReplayCallback& replay = nullptr);
+
+	std::uint32_t StreamCount()const { return mStreamCount; }
+	const CommandStream& GetStream(std::uint32_t range)const { return *mStreams[range]; }
+	const Stats& GetStats()const { return mStats; }
+
+	// Headless scaling table: best of 'repeats' runs for each range count up to the pool's
+	// thread count.  Every run is validated and must produce the serial draw count.
+	std::string MeasureScaling(const std::vector<std::uint32_t>& costs, const RecordCallback& record,
+		std::uint32_t repeats);
+
+private:
+	TaskPool& mPool;
+
+	// Grown on demand, never shrunk, so the streams keep their capacity between frames.
+	std::vector<std::unique_ptr<CommandStream>> mStreams;
+	std::uint32_t mStreamCount = 0;
+
+	std::vector<double> mRangeMs;
+	Stats mStats;
+};
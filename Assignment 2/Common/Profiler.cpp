@@ -0,0 +1,388 @@
+//***************************************************************************************
+// Profiler.cpp
+//***************************************************************************************
+
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define PROFILER_USE_TSC 1
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define PROFILER_USE_TSC 1
+#endif
+
+std::atomic<bool> Profiler::sEnabled(false);
+
+const std::uint32_t Profiler::RingCapacity;
+const std::uint32_t Profiler::WindowSize;
+const std::size_t Profiler::DefaultTraceCapacity;
+
+namespace
+{
+	thread_local Profiler::ThreadBuffer* tThread = nullptr;
+
+	std::int64_t SteadyNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void WriteJsonString(std::ostream& out, const std::string& s)
+	{
+		out << '"';
+		for(char c : s)
+		{
+			if(c == '"' || c == '\\')
+				out << '\\' << c;
+			else if((unsigned char)c < 0x20)
+				out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec << std::setfill(' ');
+			else
+				out << c;
+		}
+		out << '"';
+	}
+
+	double Percentile(std::vector<std::uint64_t>& samples, double p)
+	{
+		if(samples.empty())
+			return 0.0;
+
+		std::size_t n = (std::size_t)(p * (samples.size() - 1) + 0.5);
+		std::nth_element(samples.begin(), samples.begin() + n, samples.end());
+		return (double)samples[n];
+	}
+}
+
+Profiler& Profiler::Get()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+Profiler::Profiler()
+{
+	mTickOrigin = Now();
+	mNsOrigin = SteadyNs();
+}
+
+std::uint64_t Profiler::Now()
+{
+#if PROFILER_USE_TSC
+	return __rdtsc();
+#else
+	return (std::uint64_t)SteadyNs();
+#endif
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+	sEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+Profiler::ThreadBuffer* Profiler::CurrentThread()
+{
+	if(tThread == nullptr)
+		tThread = Get().RegisterThread();
+	return tThread;
+}
+
+Profiler::ThreadBuffer* Profiler::RegisterThread()
+{
+	std::unique_ptr<ThreadBuffer> thread(new ThreadBuffer());
+	thread->Ring.resize(RingCapacity);
+
+	std::lock_guard<std::mutex> lock(mThreadsMutex);
+	thread->Id = (std::uint32_t)mThreads.size();
+	thread->Name = "Thread " + std::to_string(thread->Id);
+	mThreads.push_back(std::move(thread));
+
+	// Buffers live as long as the profiler, so this stays valid after the thread exits.
+	return mThreads.back().get();
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+	ThreadBuffer* thread = CurrentThread();
+
+	std::lock_guard<std::mutex> lock(mThreadsMutex);
+	thread->Name = name;
+}
+
+void ProfileZone::Begin(const char* name)
+{
+	mThread = Profiler::CurrentThread();
+	mName = name;
+	mDepth = mThread->Depth++;
+	mBegin = Profiler::Now();
+}
+
+void Profiler::Record(ThreadBuffer* thread, const char* name, std::uint64_t begin, std::uint32_t depth)
+{
+	const std::uint64_t end = Now();
+	thread->Depth = depth;
+
+	const std::uint64_t head = thread->Head.load(std::memory_order_relaxed);
+	if(head - thread->Tail.load(std::memory_order_acquire) >= RingCapacity)
+	{
+		thread->Dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	Event& e = thread->Ring[head & (RingCapacity - 1)];
+	e.Name = name;
+	e.Begin = begin;
+	e.End = end;
+	e.Depth = depth;
+
+	thread->Head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::Calibrate()
+{
+#if PROFILER_USE_TSC
+	// Measure over everything since the profiler was created; the longer the baseline
+	// the better the rate.  The first call waits for at least a millisecond of it.
+	std::int64_t ns = SteadyNs();
+	while(ns - mNsOrigin < 1000000)
+		ns = SteadyNs();
+
+	mTicksPerNs = (double)(Now() - mTickOrigin) / (double)(ns - mNsOrigin);
+#else
+	mTicksPerNs = 1.0;
+#endif
+}
+
+double Profiler::TicksToMs(std::uint64_t ticks)const
+{
+	return (double)ticks / mTicksPerNs * 1.0e-6;
+}
+
+double Profiler::TicksToUs(std::uint64_t ticks)const
+{
+	return (double)ticks / mTicksPerNs * 1.0e-3;
+}
+
+std::uint32_t Profiler::ZoneIndex(const char* name)
+{
+	auto it = mZoneByPointer.find(name);
+	if(it != mZoneByPointer.end())
+		return it->second;
+
+	// The same literal may have different addresses in different translation units.
+	std::uint32_t index = 0;
+	auto named = mZoneByName.find(name);
+	if(named != mZoneByName.end())
+	{
+		index = named->second;
+	}
+	else
+	{
+		index = (std::uint32_t)mZones.size();
+		mZones.push_back(Zone());
+		mZones.back().Name = name;
+		mZoneByName[name] = index;
+	}
+
+	mZoneByPointer[name] = index;
+	return index;
+}
+
+void Profiler::Collect()
+{
+	std::vector<ThreadBuffer*> threads;
+	{
+		std::lock_guard<std::mutex> lock(mThreadsMutex);
+		for(auto& t : mThreads)
+			threads.push_back(t.get());
+	}
+
+	std::lock_guard<std::mutex> lock(mCollectMutex);
+
+	Calibrate();
+
+	for(ThreadBuffer* thread : threads)
+	{
+		const std::uint64_t head = thread->Head.load(std::memory_order_acquire);
+		std::uint64_t tail = thread->Tail.load(std::memory_order_relaxed);
+
+		for(; tail != head; ++tail)
+		{
+			const Event& e = thread->Ring[tail & (RingCapacity - 1)];
+			const std::uint64_t ticks = e.End - e.Begin;
+
+			const std::uint32_t index = ZoneIndex(e.Name);
+			Zone& zone = mZones[index];
+			zone.Depth = std::min(zone.Depth, e.Depth);
+			zone.Count++;
+			zone.TotalTicks += ticks;
+			zone.MaxTicks = std::max(zone.MaxTicks, ticks);
+			zone.LastTicks = ticks;
+			zone.FirstBegin = std::min(zone.FirstBegin, e.Begin);
+
+			if(zone.Window.size() < WindowSize)
+				zone.Window.push_back(ticks);
+			else
+				zone.Window[zone.WindowNext] = ticks;
+			zone.WindowNext = (zone.WindowNext + 1) % WindowSize;
+
+			TraceEvent trace;
+			trace.Zone = index;
+			trace.Thread = thread->Id;
+			trace.Begin = e.Begin;
+			trace.End = e.End;
+			mTrace.push_back(trace);
+		}
+
+		thread->Tail.store(head, std::memory_order_release);
+	}
+
+	while(mTrace.size() > mTraceCapacity)
+		mTrace.pop_front();
+}
+
+void Profiler::Clear()
+{
+	std::lock_guard<std::mutex> lock(mCollectMutex);
+	mZones.clear();
+	mZoneByPointer.clear();
+	mZoneByName.clear();
+	mTrace.clear();
+}
+
+void Profiler::SetTraceCapacity(std::size_t events)
+{
+	std::lock_guard<std::mutex> lock(mCollectMutex);
+	mTraceCapacity = events;
+	while(mTrace.size() > mTraceCapacity)
+		mTrace.pop_front();
+}
+
+std::uint64_t Profiler::DroppedEvents()const
+{
+	std::lock_guard<std::mutex> lock(mThreadsMutex);
+
+	std::uint64_t dropped = 0;
+	for(auto& t : mThreads)
+		dropped += t->Dropped.load(std::memory_order_relaxed);
+	return dropped;
+}
+
+std::vector<Profiler::ZoneStats> Profiler::Zones()const
+{
+	std::lock_guard<std::mutex> lock(mCollectMutex);
+
+	std::vector<ZoneStats> zones;
+	std::vector<std::uint64_t> samples;
+	std::vector<std::uint64_t> firstBegin;
+	for(const Zone& zone : mZones)
+	{
+		ZoneStats stats;
+		stats.Name = zone.Name;
+		stats.Depth = zone.Depth;
+		stats.Count = zone.Count;
+		stats.LastMs = TicksToMs(zone.LastTicks);
+		stats.MeanMs = zone.Count > 0 ? TicksToMs(zone.TotalTicks) / zone.Count : 0.0;
+		stats.MaxMs = TicksToMs(zone.MaxTicks);
+
+		samples = zone.Window;
+		stats.P50Ms = TicksToMs((std::uint64_t)Percentile(samples, 0.50));
+		stats.P95Ms = TicksToMs((std::uint64_t)Percentile(samples, 0.95));
+		stats.P99Ms = TicksToMs((std::uint64_t)Percentile(samples, 0.99));
+
+		zones.push_back(stats);
+		firstBegin.push_back(zone.FirstBegin);
+	}
+
+	std::vector<std::size_t> order(zones.size());
+	for(std::size_t i = 0; i < order.size(); ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b)
+	{
+		return firstBegin[a] < firstBegin[b];
+	});
+
+	std::vector<ZoneStats> sorted;
+	for(std::size_t i : order)
+		sorted.push_back(zones[i]);
+
+	return sorted;
+}
+
+std::string Profiler::Report()const
+{
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(3);
+	out << "Profiler zones (ms, percentiles over the last " << WindowSize << " samples):\n";
+
+	for(const ZoneStats& zone : Zones())
+	{
+		out << "  " << std::string(2 * zone.Depth, ' ') << zone.Name
+			<< "  count " << zone.Count
+			<< "  mean " << zone.MeanMs
+			<< "  p50 " << zone.P50Ms
+			<< "  p95 " << zone.P95Ms
+			<< "  p99 " << zone.P99Ms
+			<< "  max " << zone.MaxMs << "\n";
+	}
+
+	const std::uint64_t dropped = DroppedEvents();
+	if(dropped > 0)
+		out << "  " << dropped << " events dropped (ring full)\n";
+
+	return out.str();
+}
+
+void Profiler::WriteChromeTrace(std::ostream& out)const
+{
+	std::vector<std::pair<std::uint32_t, std::string>> threadNames;
+	{
+		std::lock_guard<std::mutex> lock(mThreadsMutex);
+		for(auto& t : mThreads)
+			threadNames.push_back(std::make_pair(t->Id, t->Name));
+	}
+
+	std::lock_guard<std::mutex> lock(mCollectMutex);
+
+	out << std::fixed << std::setprecision(3);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	bool first = true;
+	for(auto& thread : threadNames)
+	{
+		out << (first ? "" : ",\n")
+			<< "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.first
+			<< ",\"args\":{\"name\":";
+		WriteJsonString(out, thread.second);
+		out << "}}";
+		first = false;
+	}
+
+	for(const TraceEvent& e : mTrace)
+	{
+		// Complete ("X") events; timestamps are microseconds from profiler creation.
+		out << (first ? "" : ",\n") << "{\"name\":";
+		WriteJsonString(out, mZones[e.Zone].Name);
+		out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.Thread
+			<< ",\"ts\":" << TicksToUs(e.Begin - mTickOrigin)
+			<< ",\"dur\":" << TicksToUs(e.End - e.Begin) << "}";
+		first = false;
+	}
+
+	out << "\n]}\n";
+}
+
+bool Profiler::ExportChromeTrace(const std::string& path)const
+{
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+	if(!file)
+		return false;
+
+	WriteChromeTrace(file);
+	return (bool)file;
+}
@@ -0,0 +1,191 @@
+//***************************************************************************************
+// Profiler.h
+//
+// Hierarchical CPU zone profiler.  PROFILE_ZONE("Name") times the rest of the enclosing
+// scope; zones nest per thread.  Each thread writes finished zones into its own
+// single-producer ring, so recording takes no locks.  Collect() (once a frame, on one
+// thread) drains the rings into rolling per-zone percentiles and a bounded history
+// that can be written out as Chrome trace-event JSON (chrome://tracing, Perfetto).
+//
+// Timestamps come from the TSC on x86 and steady_clock elsewhere; TSC ticks are
+// converted with a rate calibrated against steady_clock, which assumes an invariant
+// TSC as on every x86 CPU this is likely to run on.
+//
+// While disabled a zone costs one load and one predictable branch.  Zone names must be
+// string literals (or otherwise outlive the profiler); they are kept by pointer.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Profiler
+{
+public:
+	struct ZoneStats
+	{
+		std::string Name;
+		std::uint32_t Depth = 0;    // shallowest nesting level the zone was seen at
+		std::uint64_t Count = 0;
+		double LastMs = 0.0;
+		double MeanMs = 0.0;
+		double MaxMs = 0.0;
+		// Over the last WindowSize samples.
+		double P50Ms = 0.0;
+		double P95Ms = 0.0;
+		double P99Ms = 0.0;
+	};
+
+	// One finished zone as written by the recording thread.
+	struct Event
+	{
+		const char* Name;
+		std::uint64_t Begin;
+		std::uint64_t End;
+		std::uint32_t Depth;
+	};
+
+	// Per-thread recording state.  Only the owning thread writes Head and Depth; only
+	// Collect writes Tail.
+	struct ThreadBuffer
+	{
+		std::uint32_t Id = 0;
+		std::string Name;
+		std::uint32_t Depth = 0;
+		std::vector<Event> Ring;
+		std::atomic<std::uint64_t> Head{ 0 };
+		std::atomic<std::uint64_t> Tail{ 0 };
+		std::atomic<std::uint64_t> Dropped{ 0 };
+	};
+
+	static const std::uint32_t RingCapacity = 16384;      // events per thread, power of two
+	static const std::uint32_t WindowSize = 1024;         // samples per zone for percentiles
+	static const std::size_t DefaultTraceCapacity = 1 << 18;
+
+	static Profiler& Get();
+
+	static bool IsEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+	void SetEnabled(bool enabled);
+
+	// Labels the calling thread in reports and traces.
+	void SetThreadName(const char* name);
+
+	// Drains every thread's ring.  Call from one thread, e.g. once per frame.
+	void Collect();
+
+	// Forgets all statistics and trace history.
+	void Clear();
+
+	// Zones in the order they first started, so children follow their parents.
+	std::vector<ZoneStats> Zones()const;
+	std::string Report()const;
+
+	// Writes the retained history (the last TraceCapacity() zones) as trace-event JSON.
+	void WriteChromeTrace(std::ostream& out)const;
+	bool ExportChromeTrace(const std::string& path)const;
+
+	void SetTraceCapacity(std::size_t events);
+	std::size_t TraceCapacity()const { return mTraceCapacity; }
+
+	// Events lost because a thread's ring was full when it finished a zone.
+	std::uint64_t DroppedEvents()const;
+
+	// Raw timestamp, and its conversion using the current calibration.
+	static std::uint64_t Now();
+	double TicksToMs(std::uint64_t ticks)const;
+
+	// Used by ProfileZone.
+	static ThreadBuffer* CurrentThread();
+	static void Record(ThreadBuffer* thread, const char* name, std::uint64_t begin, std::uint32_t depth);
+
+private:
+	Profiler();
+	Profiler(const Profiler& rhs) = delete;
+	Profiler& operator=(const Profiler& rhs) = delete;
+
+	ThreadBuffer* RegisterThread();
+	void Calibrate();
+	std::uint32_t ZoneIndex(const char* name);
+	double TicksToUs(std::uint64_t ticks)const;
+
+private:
+	static std::atomic<bool> sEnabled;
+
+	mutable std::mutex mThreadsMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> mThreads;
+
+	struct Zone
+	{
+		std::string Name;
+		std::uint32_t Depth = ~0u;
+		std::uint64_t Count = 0;
+		std::uint64_t TotalTicks = 0;
+		std::uint64_t MaxTicks = 0;
+		std::uint64_t LastTicks = 0;
+		std::uint64_t FirstBegin = ~0ull;
+		std::vector<std::uint64_t> Window;
+		std::uint32_t WindowNext = 0;
+	};
+
+	struct TraceEvent
+	{
+		std::uint32_t Zone;
+		std::uint32_t Thread;
+		std::uint64_t Begin;
+		std::uint64_t End;
+	};
+
+	mutable std::mutex mCollectMutex;
+	std::vector<Zone> mZones;
+	std::unordered_map<const char*, std::uint32_t> mZoneByPointer;
+	std::unordered_map<std::string, std::uint32_t> mZoneByName;
+	std::deque<TraceEvent> mTrace;
+	std::size_t mTraceCapacity = DefaultTraceCapacity;
+
+	// Calibration: TSC ticks per nanosecond, measured from a fixed origin.
+	std::uint64_t mTickOrigin = 0;
+	std::int64_t mNsOrigin = 0;
+	double mTicksPerNs = 1.0;
+};
+
+// Times the enclosing scope.  The destructor's test is on a value the compiler already
+// knows on the disabled path, so it folds into the constructor's branch.
+class ProfileZone
+{
+public:
+	explicit ProfileZone(const char* name)
+	{
+		if(Profiler::IsEnabled())
+			Begin(name);
+	}
+
+	~ProfileZone()
+	{
+		if(mThread != nullptr)
+			Profiler::Record(mThread, mName, mBegin, mDepth);
+	}
+
+	ProfileZone(const ProfileZone& rhs) = delete;
+	ProfileZone& operator=(const ProfileZone& rhs) = delete;
+
+private:
+	void Begin(const char* name);
+
+private:
+	Profiler::ThreadBuffer* mThread = nullptr;
+	const char* mName = nullptr;
+	std::uint64_t mBegin = 0;
+	std::uint32_t mDepth = 0;
+};
+
+#define PROFILE_ZONE_CONCAT2(a, b) a##b
+#define PROFILE_ZONE_CONCAT(a, b) PROFILE_ZONE_CONCAT2(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_ZONE_CONCAT(profileZone_, __LINE__)(name)
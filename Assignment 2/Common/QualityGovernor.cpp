@@ -0,0 +1,195 @@
+//***************************************************************************************
+// QualityGovernor.cpp
+//***************************************************************************************
+
+#include "QualityGovernor.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+	// Costs below this count as free when comparing knobs.
+	const double MinCostMs = 0.01;
+}
+
+QualityGovernor::QualityGovernor()
+	: QualityGovernor(Config())
+{
+}
+
+QualityGovernor::QualityGovernor(const Config& config)
+	: mConfig(config)
+{
+	mConfig.WindowFrames = std::max<std::uint32_t>(mConfig.WindowFrames, 1);
+	mWindow.resize(mConfig.WindowFrames);
+	mSorted.reserve(mConfig.WindowFrames);
+}
+
+QualityGovernor::Knob QualityGovernor::AddKnob(const KnobDesc& desc)
+{
+	assert(desc.MinLevel <= desc.MaxLevel);
+
+	KnobState knob;
+	knob.Name = desc.Name;
+	knob.MinLevel = desc.MinLevel;
+	knob.MaxLevel = desc.MaxLevel;
+	knob.Level = std::min(std::max(desc.Level, desc.MinLevel), desc.MaxLevel);
+	knob.CostMs = std::max(desc.CostMsPerLevel, 0.0);
+	knob.Priority = desc.Priority;
+	mKnobs.push_back(knob);
+
+	return (Knob)mKnobs.size() - 1;
+}
+
+bool QualityGovernor::Update(double frameMs)
+{
+	mWindow[mWindowNext] = frameMs;
+	mWindowNext = (mWindowNext + 1) % mConfig.WindowFrames;
+	mWindowCount = std::min(mWindowCount + 1, mConfig.WindowFrames);
+	mFramesSinceChange++;
+
+	// Decide only on a window of frames that all ran at the current levels.
+	if(mFramesSinceChange < std::max(mConfig.SettleFrames, mConfig.WindowFrames))
+		return false;
+
+	if(mLastKnob != ~0u)
+	{
+		LearnFromLastChange();
+		mLastKnob = ~0u;
+	}
+
+	const double percentileMs = WindowPercentileMs();
+	if(percentileMs > mConfig.BudgetMs * (1.0 + mConfig.OverBudget))
+	{
+		const Knob knob = PickLower();
+		if(knob < KnobCount())
+		{
+			Change(knob, -1);
+			return true;
+		}
+	}
+	else if(percentileMs < mConfig.BudgetMs * (1.0 - mConfig.UnderBudget))
+	{
+		const Knob knob = PickRaise(mConfig.BudgetMs - percentileMs);
+		if(knob < KnobCount())
+		{
+			Change(knob, +1);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void QualityGovernor::SetLevel(Knob knob, std::int32_t level)
+{
+	KnobState& k = mKnobs[knob];
+	level = std::min(std::max(level, k.MinLevel), k.MaxLevel);
+	if(level == k.Level)
+		return;
+
+	// Not ours to learn from, but the window no longer reflects the levels.
+	k.Level = level;
+	mLastKnob = ~0u;
+	mFramesSinceChange = 0;
+}
+
+double QualityGovernor::WindowPercentileMs()const
+{
+	if(mWindowCount == 0)
+		return 0.0;
+
+	mSorted.assign(mWindow.begin(), mWindow.begin() + mWindowCount);
+	const double rank = std::ceil(mConfig.Percentile / 100.0 * mWindowCount);
+	const std::uint32_t index = (std::uint32_t)std::min(std::max(rank, 1.0), (double)mWindowCount) - 1;
+	std::nth_element(mSorted.begin(), mSorted.begin() + index, mSorted.end());
+	return mSorted[index];
+}
+
+double QualityGovernor::WindowMeanMs()const
+{
+	if(mWindowCount == 0)
+		return 0.0;
+
+	double sum = 0.0;
+	for(std::uint32_t i = 0; i < mWindowCount; ++i)
+		sum += mWindow[i];
+	return sum / mWindowCount;
+}
+
+QualityGovernor::Knob QualityGovernor::PickLower()const
+{
+	Knob best = KnobCount();
+	double bestScore = 0.0;
+	for(Knob i = 0; i < KnobCount(); ++i)
+	{
+		const KnobState& k = mKnobs[i];
+		if(k.Level <= k.MinLevel)
+			continue;
+
+		const double score = k.Priority / std::max(k.CostMs, MinCostMs);
+		if(best == KnobCount() || score < bestScore)
+		{
+			best = i;
+			bestScore = score;
+		}
+	}
+	return best;
+}
+
+QualityGovernor::Knob QualityGovernor::PickRaise(double headroomMs)const
+{
+	Knob best = KnobCount();
+	double bestScore = 0.0;
+	for(Knob i = 0; i < KnobCount(); ++i)
+	{
+		const KnobState& k = mKnobs[i];
+		if(k.Level >= k.MaxLevel || k.CostMs > headroomMs)
+			continue;
+
+		const double score = k.Priority / std::max(k.CostMs, MinCostMs);
+		if(best == KnobCount() || score > bestScore)
+		{
+			best = i;
+			bestScore = score;
+		}
+	}
+	return best;
+}
+
+void QualityGovernor::Change(Knob knob, std::int32_t step)
+{
+	mMeanBeforeChange = WindowMeanMs();
+	mKnobs[knob].Level += step;
+	mLastKnob = knob;
+	mLastStep = step;
+	mFramesSinceChange = 0;
+	mChanges++;
+}
+
+void QualityGovernor::LearnFromLastChange()
+{
+	// Raising a knob should have cost time and lowering it saved time; a change that
+	// went the other way was swamped by the load changing and counts as free.
+	KnobState& k = mKnobs[mLastKnob];
+	const double observed = std::max((WindowMeanMs() - mMeanBeforeChange) / mLastStep, 0.0);
+	k.CostMs += mConfig.LearningRate * (observed - k.CostMs);
+}
+
+std::string QualityGovernor::Report()const
+{
+	char line[160];
+	std::snprintf(line, sizeof(line), "Quality governor: budget %.2f ms, p%.0f %.2f ms, %llu changes\n",
+		mConfig.BudgetMs, mConfig.Percentile, WindowPercentileMs(), (unsigned long long)mChanges);
+	std::string report = line;
+
+	for(const KnobState& k : mKnobs)
+	{
+		std::snprintf(line, sizeof(line), "  %-16s level %d [%d, %d], %.3f ms/level\n",
+			k.Name.c_str(), k.Level, k.MinLevel, k.MaxLevel, k.CostMs);
+		report += line;
+	}
+	return report;
+}
@@ -0,0 +1,130 @@
+//***************************************************************************************
+// QualityGovernor.h
+//
+// Closed-loop control of scalable workloads against a frame-time budget.  Each frame's
+// time goes into a window; when a percentile of the window leaves the band around the
+// budget, one knob is moved one level.  Knobs are integer levels between configured
+// bounds, higher meaning better quality and more cost.
+//
+// Which knob moves is decided by a cost model learned while running: after a change
+// has settled, the difference in mean frame time before and after updates that knob's
+// cost per level.  Going down, the knob giving up the least quality per millisecond
+// saved goes first; going up, the one giving the most quality per millisecond, and only
+// if its predicted cost still fits under the budget.  The two thresholds of the band
+// and the settle time keep it from oscillating between levels.
+//
+// Device independent and clock free: frame times are passed in, so the controller can
+// be driven by synthetic cost curves.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class QualityGovernor
+{
+public:
+	typedef std::uint32_t Knob;
+
+	struct Config
+	{
+		double BudgetMs = 1000.0 / 60.0;
+		double Percentile = 90.0;
+
+		// Lower a knob above BudgetMs * (1 + OverBudget), raise one below
+		// BudgetMs * (1 - UnderBudget).
+		double OverBudget = 0.0;
+		double UnderBudget = 0.15;
+
+		// Frames in the percentile window, and the frames after a change before the
+		// next decision.  The window is refilled with post-change frames either way.
+		std::uint32_t WindowFrames = 60;
+		std::uint32_t SettleFrames = 30;
+
+		// Weight of a new cost observation in the per-knob moving average.
+		double LearningRate = 0.3;
+	};
+
+	struct KnobDesc
+	{
+		std::string Name;
+		std::int32_t MinLevel = 0;
+		std::int32_t MaxLevel = 0;
+		std::int32_t Level = 0;
+
+		// Starting guess for the frame time one level costs, in milliseconds.
+		double CostMsPerLevel = 0.5;
+
+		// Quality one level is worth relative to the other knobs.
+		double Priority = 1.0;
+	};
+
+	QualityGovernor();
+	explicit QualityGovernor(const Config& config);
+	QualityGovernor(const QualityGovernor& rhs) = delete;
+	QualityGovernor& operator=(const QualityGovernor& rhs) = delete;
+
+	Knob AddKnob(const KnobDesc& desc);
+
+	// Records a frame and moves at most one knob.  Returns true if a level changed.
+	bool Update(double frameMs);
+
+	// Forces a level (clamped to the bounds), e.g. from a user setting.
+	void SetLevel(Knob knob, std::int32_t level);
+
+	std::int32_t Level(Knob knob)const { return mKnobs[knob].Level; }
+	double CostMs(Knob knob)const { return mKnobs[knob].CostMs; }
+	const std::string& Name(Knob knob)const { return mKnobs[knob].Name; }
+	std::uint32_t KnobCount()const { return (std::uint32_t)mKnobs.size(); }
+
+	const Config& GetConfig()const { return mConfig; }
+	void SetBudgetMs(double budgetMs) { mConfig.BudgetMs = budgetMs; }
+
+	// Percentile and mean of the current window, 0 while it is empty.
+	double WindowPercentileMs()const;
+	double WindowMeanMs()const;
+
+	std::uint64_t Changes()const { return mChanges; }
+
+	// One line per knob: level, bounds and learned cost.
+	std::string Report()const;
+
+private:
+	struct KnobState
+	{
+		std::string Name;
+		std::int32_t MinLevel;
+		std::int32_t MaxLevel;
+		std::int32_t Level;
+		double CostMs;
+		double Priority;
+	};
+
+	// Lowest quality lost per millisecond saved, or the most gained per millisecond
+	// spent that fits in headroomMs.  Returns KnobCount() if no knob qualifies.
+	Knob PickLower()const;
+	Knob PickRaise(double headroomMs)const;
+
+	void Change(Knob knob, std::int32_t step);
+	void LearnFromLastChange();
+
+private:
+	Config mConfig;
+	std::vector<KnobState> mKnobs;
+
+	// Ring of the last WindowFrames frame times, plus scratch for the percentile.
+	std::vector<double> mWindow;
+	mutable std::vector<double> mSorted;
+	std::uint32_t mWindowNext = 0;
+	std::uint32_t mWindowCount = 0;
+
+	// The last change, judged once the window holds only frames after it.
+	Knob mLastKnob = ~0u;
+	std::int32_t mLastStep = 0;
+	double mMeanBeforeChange = 0.0;
+	std::uint32_t mFramesSinceChange = 0;
+
+	std::uint64_t mChanges = 0;
+};
@@ -0,0 +1,335 @@
+//***************************************************************************************
+// Random.cpp
+//***************************************************************************************
+
+#include "Random.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RANDOM_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	const float FloatScale = 1.0f / 16777216.0f;    // 2^-24
+
+	float ToFloat(std::uint32_t bits)
+	{
+		return (float)(bits >> 8) * FloatScale;
+	}
+
+	void MapRange(float* out, std::size_t count, float a, float b)
+	{
+		const float scale = b - a;
+		for(std::size_t i = 0; i < count; ++i)
+			out[i] = a + out[i] * scale;
+	}
+
+	const std::uint32_t PhiloxM0 = 0xd2511f53;
+	const std::uint32_t PhiloxM1 = 0xcd9e8d57;
+	const std::uint32_t PhiloxW0 = 0x9e3779b9;
+	const std::uint32_t PhiloxW1 = 0xbb67ae85;
+	const int PhiloxRounds = 10;
+
+#if !defined(RANDOM_SSE2)
+	std::uint32_t RotateLeft(std::uint32_t x, int k)
+	{
+		return (x << k) | (x >> (32 - k));
+	}
+#else
+	__m128i ToFloatBits(__m128i bits)
+	{
+		return _mm_castps_si128(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(bits, 8)), _mm_set1_ps(FloatScale)));
+	}
+
+	// 32x32 -> 64-bit products of each lane of a with m, split into high and low words.
+	void MulHiLo(__m128i a, __m128i m, __m128i& hi, __m128i& lo)
+	{
+		__m128i even = _mm_mul_epu32(a, m);                          // lo0 hi0 lo2 hi2
+		__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), m);       // lo1 hi1 lo3 hi3
+		__m128i low = _mm_unpacklo_epi32(even, odd);                 // lo0 lo1 hi0 hi1
+		__m128i high = _mm_unpackhi_epi32(even, odd);                // lo2 lo3 hi2 hi3
+		lo = _mm_unpacklo_epi64(low, high);
+		hi = _mm_unpackhi_epi64(low, high);
+	}
+#endif
+}
+
+std::uint64_t SplitMix64(std::uint64_t& state)
+{
+	std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+//
+// Pcg32
+//
+
+Pcg32::Pcg32(std::uint64_t seed, std::uint64_t stream) :
+	mState(0),
+	mIncrement((stream << 1) | 1)
+{
+	Next();
+	mState += seed;
+	Next();
+}
+
+std::uint32_t Pcg32::NextBounded(std::uint32_t bound)
+{
+	// Lemire's multiply-shift; the rare low products that would bias the result are
+	// rejected.
+	std::uint64_t m = (std::uint64_t)Next() * bound;
+	std::uint32_t low = (std::uint32_t)m;
+	if(low < bound)
+	{
+		const std::uint32_t threshold = (0u - bound) % bound;
+		while(low < threshold)
+		{
+			m = (std::uint64_t)Next() * bound;
+			low = (std::uint32_t)m;
+		}
+	}
+	return (std::uint32_t)(m >> 32);
+}
+
+int Pcg32::NextInt(int a, int b)
+{
+	const std::uint64_t range = (std::uint64_t)((std::int64_t)b - (std::int64_t)a) + 1;
+	if(range > 0xffffffffull)
+		return (int)Next();
+	return (int)((std::int64_t)a + NextBounded((std::uint32_t)range));
+}
+
+float Pcg32::NextFloat()
+{
+	return ToFloat(Next());
+}
+
+float Pcg32::NextFloat(float a, float b)
+{
+	return a + NextFloat() * (b - a);
+}
+
+//
+// Xoshiro128x4
+//
+
+Xoshiro128x4::Xoshiro128x4(std::uint64_t seed)
+{
+	std::uint64_t state = seed;
+	for(int lane = 0; lane < 4; ++lane)
+	{
+		std::uint64_t a = SplitMix64(state);
+		std::uint64_t b = SplitMix64(state);
+		mState[0][lane] = (std::uint32_t)a;
+		mState[1][lane] = (std::uint32_t)(a >> 32);
+		mState[2][lane] = (std::uint32_t)b;
+		mState[3][lane] = (std::uint32_t)(b >> 32);
+	}
+}
+
+void Xoshiro128x4::FillUint32(std::uint32_t* out, std::size_t count)
+{
+#if defined(RANDOM_SSE2)
+	__m128i s0 = _mm_load_si128((const __m128i*)mState[0]);
+	__m128i s1 = _mm_load_si128((const __m128i*)mState[1]);
+	__m128i s2 = _mm_load_si128((const __m128i*)mState[2]);
+	__m128i s3 = _mm_load_si128((const __m128i*)mState[3]);
+
+	for(std::size_t i = 0; i < count; i += 4)
+	{
+		__m128i result = _mm_add_epi32(s0, s3);
+		__m128i t = _mm_slli_epi32(s1, 9);
+		s2 = _mm_xor_si128(s2, s0);
+		s3 = _mm_xor_si128(s3, s1);
+		s1 = _mm_xor_si128(s1, s2);
+		s0 = _mm_xor_si128(s0, s3);
+		s2 = _mm_xor_si128(s2, t);
+		s3 = _mm_or_si128(_mm_slli_epi32(s3, 11), _mm_srli_epi32(s3, 21));
+
+		if(count - i >= 4)
+		{
+			_mm_storeu_si128((__m128i*)(out + i), result);
+		}
+		else
+		{
+			alignas(16) std::uint32_t last[4];
+			_mm_store_si128((__m128i*)last, result);
+			for(std::size_t j = 0; i + j < count; ++j)
+				out[i + j] = last[j];
+		}
+	}
+
+	_mm_store_si128((__m128i*)mState[0], s0);
+	_mm_store_si128((__m128i*)mState[1], s1);
+	_mm_store_si128((__m128i*)mState[2], s2);
+	_mm_store_si128((__m128i*)mState[3], s3);
+#else
+	for(std::size_t i = 0; i < count; i += 4)
+	{
+		for(int lane = 0; lane < 4; ++lane)
+		{
+			std::uint32_t& s0 = mState[0][lane];
+			std::uint32_t& s1 = mState[1][lane];
+			std::uint32_t& s2 = mState[2][lane];
+			std::uint32_t& s3 = mState[3][lane];
+
+			const std::uint32_t result = s0 + s3;
+			const std::uint32_t t = s1 << 9;
+			s2 ^= s0;
+			s3 ^= s1;
+			s1 ^= s2;
+			s0 ^= s3;
+			s2 ^= t;
+			s3 = RotateLeft(s3, 11);
+
+			if(i + lane < count)
+				out[i + lane] = result;
+		}
+	}
+#endif
+}
+
+void Xoshiro128x4::FillFloats(float* out, std::size_t count)
+{
+	// In chunks, so the integers need only a small buffer.
+	alignas(16) std::uint32_t bits[64];
+
+	for(std::size_t i = 0; i < count; i += 64)
+	{
+		const std::size_t chunk = count - i < 64 ? count - i : 64;
+		FillUint32(bits, chunk);
+
+		std::size_t j = 0;
+#if defined(RANDOM_SSE2)
+		for(; j + 4 <= chunk; j += 4)
+			_mm_storeu_ps(out + i + j, _mm_castsi128_ps(ToFloatBits(_mm_load_si128((const __m128i*)(bits + j)))));
+#endif
+		for(; j < chunk; ++j)
+			out[i + j] = ToFloat(bits[j]);
+	}
+}
+
+void Xoshiro128x4::FillRange(float* out, std::size_t count, float a, float b)
+{
+	FillFloats(out, count);
+	MapRange(out, count, a, b);
+}
+
+//
+// Philox4x32
+//
+
+Philox4x32::Block Philox4x32::Generate(std::uint64_t counter, std::uint64_t key)
+{
+	const std::uint32_t c[4] = { (std::uint32_t)counter, (std::uint32_t)(counter >> 32), 0, 0 };
+	const std::uint32_t k[2] = { (std::uint32_t)key, (std::uint32_t)(key >> 32) };
+	return Generate(c, k);
+}
+
+Philox4x32::Block Philox4x32::Generate(const std::uint32_t counter[4], const std::uint32_t key[2])
+{
+	std::uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+	std::uint32_t k0 = key[0], k1 = key[1];
+
+	for(int round = 0; round < PhiloxRounds; ++round)
+	{
+		if(round > 0)
+		{
+			k0 += PhiloxW0;
+			k1 += PhiloxW1;
+		}
+
+		const std::uint64_t p0 = (std::uint64_t)PhiloxM0 * c0;
+		const std::uint64_t p1 = (std::uint64_t)PhiloxM1 * c2;
+		c0 = (std::uint32_t)(p1 >> 32) ^ c1 ^ k0;
+		c1 = (std::uint32_t)p1;
+		c2 = (std::uint32_t)(p0 >> 32) ^ c3 ^ k1;
+		c3 = (std::uint32_t)p0;
+	}
+
+	Block block = { { c0, c1, c2, c3 } };
+	return block;
+}
+
+std::uint32_t Philox4x32::Uint32(std::uint64_t seed, std::uint64_t index)
+{
+	return Generate(index >> 2, seed).Word[index & 3];
+}
+
+float Philox4x32::Float(std::uint64_t seed, std::uint64_t index)
+{
+	return ToFloat(Uint32(seed, index));
+}
+
+void Philox4x32::FillFloats(std::uint64_t seed, std::uint64_t firstIndex, float* out, std::size_t count)
+{
+	std::size_t i = 0;
+
+	// Up to the first block boundary.
+	for(; i < count && ((firstIndex + i) & 3) != 0; ++i)
+		out[i] = Float(seed, firstIndex + i);
+
+#if defined(RANDOM_SSE2)
+	// Four whole blocks per pass, one block per lane.
+	const __m128i m0 = _mm_set1_epi32((int)PhiloxM0);
+	const __m128i m1 = _mm_set1_epi32((int)PhiloxM1);
+	for(; i + 16 <= count; i += 16)
+	{
+		const std::uint64_t block = (firstIndex + i) >> 2;
+		__m128i c0 = _mm_set_epi32((int)(std::uint32_t)(block + 3), (int)(std::uint32_t)(block + 2),
+			(int)(std::uint32_t)(block + 1), (int)(std::uint32_t)block);
+		__m128i c1 = _mm_set_epi32((int)(std::uint32_t)((block + 3) >> 32), (int)(std::uint32_t)((block + 2) >> 32),
+			(int)(std::uint32_t)((block + 1) >> 32), (int)(std::uint32_t)(block >> 32));
+		__m128i c2 = _mm_setzero_si128();
+		__m128i c3 = _mm_setzero_si128();
+		std::uint32_t k0 = (std::uint32_t)seed;
+		std::uint32_t k1 = (std::uint32_t)(seed >> 32);
+
+		for(int round = 0; round < PhiloxRounds; ++round)
+		{
+			if(round > 0)
+			{
+				k0 += PhiloxW0;
+				k1 += PhiloxW1;
+			}
+
+			__m128i hi0, lo0, hi1, lo1;
+			MulHiLo(c0, m0, hi0, lo0);
+			MulHiLo(c2, m1, hi1, lo1);
+			c0 = _mm_xor_si128(_mm_xor_si128(hi1, c1), _mm_set1_epi32((int)k0));
+			c1 = lo1;
+			c2 = _mm_xor_si128(_mm_xor_si128(hi0, c3), _mm_set1_epi32((int)k1));
+			c3 = lo0;
+		}
+
+		// Lanes hold blocks; transpose so each register holds one block's four words.
+		__m128i t0 = _mm_unpacklo_epi32(c0, c1);
+		__m128i t1 = _mm_unpacklo_epi32(c2, c3);
+		__m128i t2 = _mm_unpackhi_epi32(c0, c1);
+		__m128i t3 = _mm_unpackhi_epi32(c2, c3);
+		_mm_storeu_ps(out + i + 0, _mm_castsi128_ps(ToFloatBits(_mm_unpacklo_epi64(t0, t1))));
+		_mm_storeu_ps(out + i + 4, _mm_castsi128_ps(ToFloatBits(_mm_unpackhi_epi64(t0, t1))));
+		_mm_storeu_ps(out + i + 8, _mm_castsi128_ps(ToFloatBits(_mm_unpacklo_epi64(t2, t3))));
+		_mm_storeu_ps(out + i + 12, _mm_castsi128_ps(ToFloatBits(_mm_unpackhi_epi64(t2, t3))));
+	}
+#endif
+
+	// Remaining whole blocks, then the tail.
+	for(; i + 4 <= count; i += 4)
+	{
+		const Block block = Generate((firstIndex + i) >> 2, seed);
+		for(int w = 0; w < 4; ++w)
+			out[i + w] = ToFloat(block.Word[w]);
+	}
+	for(; i < count; ++i)
+		out[i] = Float(seed, firstIndex + i);
+}
+
+void Philox4x32::FillRange(std::uint64_t seed, std::uint64_t firstIndex, float* out, std::size_t count, float a, float b)
+{
+	FillFloats(seed, firstIndex, out, count);
+	MapRange(out, count, a, b);
+}
@@ -0,0 +1,93 @@
+//***************************************************************************************
+// Random.h
+//
+// Random number generators.  None of them share state, so each thread or task uses its
+// own and results do not depend on scheduling.
+//
+//   Pcg32         PCG-XSH-RR, 64-bit state.  Small and fast; one per thread or object.
+//                 Bounded integers are unbiased.
+//   Xoshiro128x4  Four xoshiro128+ streams run side by side in SSE2 lanes, for filling
+//                 arrays.  SSE2 and scalar builds give the same numbers.
+//   Philox4x32    Counter-based (Philox4x32-10): the value at (seed, index) is a pure
+//                 function, so parallel workers can generate any part of a sequence
+//                 independently and the result matches a serial run.
+//
+// Floats are the top 24 bits of a 32-bit output scaled to [0, 1).  Ranges map that to
+// [a, b), which rounding can turn into [a, b] for some a and b.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class Pcg32
+{
+public:
+	// Generators with the same seed and different streams are independent.
+	explicit Pcg32(std::uint64_t seed = 0x853c49e6748fea9bull, std::uint64_t stream = 0xda3e39cb94b95bdbull);
+
+	std::uint32_t Next()
+	{
+		std::uint64_t old = mState;
+		mState = old * 6364136223846793005ull + mIncrement;
+		std::uint32_t xorShifted = (std::uint32_t)(((old >> 18) ^ old) >> 27);
+		std::uint32_t rot = (std::uint32_t)(old >> 59);
+		return (xorShifted >> rot) | (xorShifted << ((0u - rot) & 31));
+	}
+
+	// Uniform in [0, bound), without modulo bias.  bound must not be 0.
+	std::uint32_t NextBounded(std::uint32_t bound);
+
+	// Uniform in [a, b], a <= b.
+	int NextInt(int a, int b);
+
+	float NextFloat();
+	float NextFloat(float a, float b);
+
+private:
+	std::uint64_t mState = 0;
+	std::uint64_t mIncrement = 0;
+};
+
+class Xoshiro128x4
+{
+public:
+	// The four lanes are seeded from seed with SplitMix64.
+	explicit Xoshiro128x4(std::uint64_t seed);
+
+	// Outputs go round the lanes: out[4i + lane] is the ith value of that lane.  A count
+	// that is not a multiple of 4 discards the rest of the last group.
+	void FillUint32(std::uint32_t* out, std::size_t count);
+	void FillFloats(float* out, std::size_t count);
+	void FillRange(float* out, std::size_t count, float a, float b);
+
+private:
+	// [word][lane], so each word is one SSE register.
+	alignas(16) std::uint32_t mState[4][4];
+};
+
+class Philox4x32
+{
+public:
+	struct Block
+	{
+		std::uint32_t Word[4];
+	};
+
+	// The 128-bit block for counter under key.
+	static Block Generate(std::uint64_t counter, std::uint64_t key);
+	static Block Generate(const std::uint32_t counter[4], const std::uint32_t key[2]);
+
+	// Value index of the stream seed: word index % 4 of the block at counter index / 4.
+	static std::uint32_t Uint32(std::uint64_t seed, std::uint64_t index);
+	static float Float(std::uint64_t seed, std::uint64_t index);
+
+	// Values [firstIndex, firstIndex + count) of the stream seed, the same as calling
+	// Float for each index.  Four blocks at a time with SSE2.
+	static void FillFloats(std::uint64_t seed, std::uint64_t firstIndex, float* out, std::size_t count);
+	static void FillRange(std::uint64_t seed, std::uint64_t firstIndex, float* out, std::size_t count, float a, float b);
+};
+
+// SplitMix64 step; also handy for deriving per-task seeds from one seed.
+std::uint64_t SplitMix64(std::uint64_t& state);
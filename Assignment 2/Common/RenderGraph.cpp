@@ -0,0 +1,498 @@
+//***************************************************************************************
+// RenderGraph.cpp
+//***************************************************************************************
+
+#include "RenderGraph.h"
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+
+namespace
+{
+	bool IsReadOnlyState(std::uint32_t state)
+	{
+		return (state & ~RenderGraph::ReadOnlyStates) == 0;
+	}
+
+	std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+RenderGraph::Resource RenderGraph::ImportResource(const std::string& name, std::uint32_t initialState, std::uint32_t finalState)
+{
+	ResourceNode node;
+	node.Name = name;
+	node.InitialState = initialState;
+	node.FinalState = finalState;
+
+	mResources.push_back(node);
+	mCompiled = false;
+	return (Resource)mResources.size() - 1;
+}
+
+RenderGraph::Resource RenderGraph::CreateTransient(const std::string& name, std::uint64_t byteSize, std::uint64_t alignment)
+{
+	ResourceNode node;
+	node.Name = name;
+	node.Transient = true;
+	node.ByteSize = byteSize;
+	node.Alignment = alignment == 0 ? 1 : alignment;
+
+	mResources.push_back(node);
+	mCompiled = false;
+	return (Resource)mResources.size() - 1;
+}
+
+RenderGraph::Pass RenderGraph::AddPass(const std::string& name, ExecuteCallback execute, bool hasSideEffects)
+{
+	PassNode node;
+	node.Name = name;
+	node.Execute = std::move(execute);
+	node.HasSideEffects = hasSideEffects;
+
+	mPasses.push_back(std::move(node));
+	mCompiled = false;
+	return (Pass)mPasses.size() - 1;
+}
+
+void RenderGraph::Read(Pass pass, Resource resource, std::uint32_t state)
+{
+	assert(pass < mPasses.size() && resource < mResources.size());
+	assert(IsReadOnlyState(state) && "Read() needs a read-only state.");
+
+	// Several reads of one resource in a pass collapse into one combined state.
+	for(auto& access : mPasses[pass].Accesses)
+	{
+		if(access.Target == resource)
+		{
+			assert(!access.IsWrite && "A pass cannot read a resource it also writes.");
+			access.State |= state;
+			return;
+		}
+	}
+
+	Access access;
+	access.Target = resource;
+	access.State = state;
+	mPasses[pass].Accesses.push_back(access);
+	mCompiled = false;
+}
+
+void RenderGraph::Write(Pass pass, Resource resource, std::uint32_t state)
+{
+	assert(pass < mPasses.size() && resource < mResources.size());
+
+	for(auto& access : mPasses[pass].Accesses)
+	{
+		if(access.Target == resource)
+		{
+			assert(access.IsWrite && access.State == state && "Conflicting accesses in one pass.");
+			return;
+		}
+	}
+
+	Access access;
+	access.Target = resource;
+	access.State = state;
+	access.IsWrite = true;
+	mPasses[pass].Accesses.push_back(access);
+	mCompiled = false;
+}
+
+void RenderGraph::Reset()
+{
+	mResources.clear();
+	mPasses.clear();
+	mBarriers.clear();
+	mFinalBarrierStart = 0;
+	mFinalBarrierCount = 0;
+	mTransientHeapSize = 0;
+	mCompiled = false;
+	mStats = Stats();
+}
+
+std::uint32_t RenderGraph::StateInPass(const PassNode& pass, Resource resource, bool* isWrite)const
+{
+	for(auto& access : pass.Accesses)
+	{
+		if(access.Target == resource)
+		{
+			if(isWrite != nullptr)
+				*isWrite = access.IsWrite;
+			return access.State;
+		}
+	}
+
+	return StateUndefined;
+}
+
+void RenderGraph::CullPasses()
+{
+	for(auto& r : mResources)
+		r.RefCount = (!r.Transient && r.FinalState != StateUndefined) ? 1 : 0;
+
+	for(auto& p : mPasses)
+	{
+		p.Culled = false;
+		p.RefCount = 0;
+		for(auto& access : p.Accesses)
+		{
+			if(access.IsWrite)
+				p.RefCount++;
+			else
+				mResources[access.Target].RefCount++;
+		}
+	}
+
+	std::vector<Resource> unused;
+
+	auto cull = [&](PassNode& p)
+	{
+		p.Culled = true;
+		for(auto& access : p.Accesses)
+		{
+			if(!access.IsWrite && --mResources[access.Target].RefCount == 0)
+				unused.push_back(access.Target);
+		}
+	};
+
+	// Passes that produce nothing at all.
+	for(auto& p : mPasses)
+	{
+		if(p.RefCount == 0 && !p.HasSideEffects)
+			cull(p);
+	}
+
+	for(Resource r = 0; r < (Resource)mResources.size(); ++r)
+	{
+		if(mResources[r].RefCount == 0)
+			unused.push_back(r);
+	}
+
+	// Nobody consumes r, so its producers lose a reason to run.
+	while(!unused.empty())
+	{
+		Resource r = unused.back();
+		unused.pop_back();
+
+		for(auto& p : mPasses)
+		{
+			if(p.Culled || p.HasSideEffects)
+				continue;
+
+			bool isWrite = false;
+			if(StateInPass(p, r, &isWrite) == StateUndefined || !isWrite)
+				continue;
+
+			if(--p.RefCount == 0)
+				cull(p);
+		}
+	}
+}
+
+void RenderGraph::ComputeLifetimes()
+{
+	for(auto& r : mResources)
+	{
+		r.FirstPass = ~0u;
+		r.LastPass = 0;
+		r.AliasBefore = InvalidResource;
+		r.HeapOffset = 0;
+
+		// Transients get their initial state from their last use in BuildBarriers.
+		if(r.Transient)
+			r.InitialState = StateUndefined;
+	}
+
+	for(std::uint32_t i = 0; i < (std::uint32_t)mPasses.size(); ++i)
+	{
+		if(mPasses[i].Culled)
+			continue;
+
+		for(auto& access : mPasses[i].Accesses)
+		{
+			ResourceNode& r = mResources[access.Target];
+			r.FirstPass = std::min(r.FirstPass, i);
+			r.LastPass = std::max(r.LastPass, i);
+		}
+	}
+}
+
+void RenderGraph::PlaceTransients()
+{
+	std::vector<Resource> transients;
+	for(Resource r = 0; r < (Resource)mResources.size(); ++r)
+	{
+		if(mResources[r].Transient && mResources[r].FirstPass != ~0u)
+			transients.push_back(r);
+	}
+
+	// Biggest first: large resources get the low offsets and small ones fill the gaps.
+	std::stable_sort(transients.begin(), transients.end(), [&](Resource a, Resource b)
+	{
+		return mResources[a].ByteSize > mResources[b].ByteSize;
+	});
+
+	auto livesOverlap = [&](const ResourceNode& a, const ResourceNode& b)
+	{
+		return a.FirstPass <= b.LastPass && b.FirstPass <= a.LastPass;
+	};
+
+	auto memoryOverlaps = [](const ResourceNode& a, const ResourceNode& b)
+	{
+		return a.HeapOffset < b.HeapOffset + b.ByteSize && b.HeapOffset < a.HeapOffset + a.ByteSize;
+	};
+
+	mTransientHeapSize = 0;
+	std::vector<Resource> placed;
+	for(Resource r : transients)
+	{
+		ResourceNode& node = mResources[r];
+		mStats.TransientBytes += AlignUp(node.ByteSize, node.Alignment);
+
+		// Candidate offsets: the start of the heap and the end of every resource that is
+		// alive at the same time.
+		std::vector<std::uint64_t> candidates(1, 0);
+		for(Resource other : placed)
+		{
+			const ResourceNode& o = mResources[other];
+			if(livesOverlap(node, o))
+				candidates.push_back(AlignUp(o.HeapOffset + o.ByteSize, node.Alignment));
+		}
+		std::sort(candidates.begin(), candidates.end());
+
+		for(std::uint64_t offset : candidates)
+		{
+			node.HeapOffset = offset;
+
+			bool fits = true;
+			for(Resource other : placed)
+			{
+				const ResourceNode& o = mResources[other];
+				if(livesOverlap(node, o) && memoryOverlaps(node, o))
+				{
+					fits = false;
+					break;
+				}
+			}
+
+			if(fits)
+				break;
+		}
+
+		mTransientHeapSize = std::max(mTransientHeapSize, node.HeapOffset + node.ByteSize);
+		placed.push_back(r);
+	}
+
+	// Within a frame, each transient takes its memory over from the latest resource
+	// that used any of it before.
+	for(Resource r : transients)
+	{
+		ResourceNode& node = mResources[r];
+		std::uint32_t latest = 0;
+		for(Resource other : transients)
+		{
+			const ResourceNode& o = mResources[other];
+			if(other == r || o.LastPass >= node.FirstPass || !memoryOverlaps(node, o))
+				continue;
+
+			if(node.AliasBefore == InvalidResource || o.LastPass >= latest)
+			{
+				node.AliasBefore = other;
+				latest = o.LastPass;
+			}
+		}
+	}
+
+	mStats.TransientCount = (std::uint32_t)transients.size();
+	mStats.AliasedTransientBytes = mTransientHeapSize;
+}
+
+void RenderGraph::BuildPassBarriers(std::vector<std::uint32_t>& current)
+{
+	mBarriers.clear();
+
+	current.resize(mResources.size());
+	for(Resource r = 0; r < (Resource)mResources.size(); ++r)
+		current[r] = mResources[r].InitialState;
+
+	for(std::uint32_t i = 0; i < (std::uint32_t)mPasses.size(); ++i)
+	{
+		PassNode& pass = mPasses[i];
+		pass.BarrierStart = (std::uint32_t)mBarriers.size();
+		pass.BarrierCount = 0;
+
+		if(pass.Culled)
+			continue;
+
+		for(auto& access : pass.Accesses)
+		{
+			Resource r = access.Target;
+			const ResourceNode& node = mResources[r];
+
+			if(node.Transient && node.FirstPass == i)
+			{
+				Barrier barrier;
+				barrier.BarrierType = Barrier::Aliasing;
+				barrier.Target = r;
+				barrier.AliasBefore = node.AliasBefore;
+				mBarriers.push_back(barrier);
+			}
+
+			std::uint32_t required = access.State;
+			if(!access.IsWrite)
+			{
+				// Already readable in this state: nothing to do.
+				if(IsReadOnlyState(current[r]) && (current[r] & required) == required)
+					continue;
+
+				// Fold in the states of the following read-only passes so one
+				// transition covers the whole run of reads.
+				for(std::uint32_t j = i + 1; j < (std::uint32_t)mPasses.size(); ++j)
+				{
+					if(mPasses[j].Culled)
+						continue;
+
+					bool isWrite = false;
+					std::uint32_t state = StateInPass(mPasses[j], r, &isWrite);
+					if(isWrite)
+						break;
+					required |= state;
+				}
+			}
+
+			if(current[r] != required)
+			{
+				Barrier barrier;
+				barrier.Target = r;
+				barrier.StateBefore = current[r];
+				barrier.StateAfter = required;
+				mBarriers.push_back(barrier);
+
+				current[r] = required;
+			}
+		}
+
+		pass.BarrierCount = (std::uint32_t)mBarriers.size() - pass.BarrierStart;
+	}
+}
+
+void RenderGraph::BuildBarriers()
+{
+	// Imported resources start in their declared state.  Transients start each frame
+	// in the state the previous frame left them in, first guessed as that of their
+	// last use.
+	for(Resource r = 0; r < (Resource)mResources.size(); ++r)
+	{
+		ResourceNode& node = mResources[r];
+		if(node.Transient && node.FirstPass != ~0u)
+			node.InitialState = StateInPass(mPasses[node.LastPass], r, nullptr);
+	}
+
+	std::vector<std::uint32_t> current;
+	BuildPassBarriers(current);
+
+	// A run of reads at the end of the frame leaves a transient in the merged state
+	// of the whole run, not just that of the last pass.  Start there instead; the
+	// second build ends every transient where it started.
+	bool guessedWrong = false;
+	for(Resource r = 0; r < (Resource)mResources.size(); ++r)
+	{
+		ResourceNode& node = mResources[r];
+		if(node.Transient && node.FirstPass != ~0u && node.InitialState != current[r])
+		{
+			node.InitialState = current[r];
+			guessedWrong = true;
+		}
+	}
+	if(guessedWrong)
+		BuildPassBarriers(current);
+
+	mFinalBarrierStart = (std::uint32_t)mBarriers.size();
+	for(Resource r = 0; r < (Resource)mResources.size(); ++r)
+	{
+		const ResourceNode& node = mResources[r];
+		if(node.Transient || node.FinalState == StateUndefined || current[r] == node.FinalState)
+			continue;
+
+		Barrier barrier;
+		barrier.Target = r;
+		barrier.StateBefore = current[r];
+		barrier.StateAfter = node.FinalState;
+		mBarriers.push_back(barrier);
+	}
+	mFinalBarrierCount = (std::uint32_t)mBarriers.size() - mFinalBarrierStart;
+}
+
+void RenderGraph::Compile()
+{
+	mStats = Stats();
+
+	CullPasses();
+	ComputeLifetimes();
+	PlaceTransients();
+	BuildBarriers();
+
+	mStats.PassCount = (std::uint32_t)mPasses.size();
+	for(auto& p : mPasses)
+	{
+		if(p.Culled)
+			mStats.CulledPassCount++;
+		else if(p.BarrierCount > 0)
+			mStats.BarrierBatchCount++;
+	}
+	if(mFinalBarrierCount > 0)
+		mStats.BarrierBatchCount++;
+	mStats.BarrierCount = (std::uint32_t)mBarriers.size();
+
+	mCompiled = true;
+}
+
+void RenderGraph::Execute(const BarrierCallback& recordBarriers)const
+{
+	assert(mCompiled && "Compile the graph before executing it.");
+
+	for(auto& pass : mPasses)
+	{
+		if(pass.Culled)
+			continue;
+
+		if(pass.BarrierCount > 0 && recordBarriers)
+			recordBarriers(&mBarriers[pass.BarrierStart], pass.BarrierCount);
+
+		if(pass.Execute)
+			pass.Execute();
+	}
+
+	if(mFinalBarrierCount > 0 && recordBarriers)
+		recordBarriers(&mBarriers[mFinalBarrierStart], mFinalBarrierCount);
+}
+
+std::string RenderGraph::Report()const
+{
+	std::ostringstream out;
+
+	out << "RenderGraph: " << mStats.PassCount - mStats.CulledPassCount << "/" << mStats.PassCount
+		<< " passes, " << mStats.BarrierCount << " barriers in " << mStats.BarrierBatchCount << " batches\n";
+
+	for(auto& p : mPasses)
+		out << "  pass " << p.Name << (p.Culled ? " (culled)" : "") << ": " << p.BarrierCount << " barriers\n";
+
+	for(Resource r = 0; r < (Resource)mResources.size(); ++r)
+	{
+		const ResourceNode& node = mResources[r];
+		if(!node.Transient || node.FirstPass == ~0u)
+			continue;
+
+		out << "  transient " << node.Name << ": " << node.ByteSize / 1024 << " KB at offset "
+			<< node.HeapOffset / 1024 << " KB, passes " << node.FirstPass << "-" << node.LastPass << "\n";
+	}
+
+	out << "  transient memory: " << mStats.TransientBytes / 1024 << " KB unaliased, "
+		<< mStats.AliasedTransientBytes / 1024 << " KB aliased ("
+		<< (int)(mStats.AliasingSavings() * 100.0f + 0.5f) << "% saved)\n";
+
+	return out.str();
+}
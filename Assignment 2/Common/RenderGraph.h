@@ -0,0 +1,194 @@
+//***************************************************************************************
+// RenderGraph.h
+//
+// Declarative frame description.  Passes declare which resources they read and write
+// and in which state; Compile() then
+//
+//   - culls passes whose results are never consumed,
+//   - derives the state transitions between passes, merging consecutive read states
+//     into one transition and batching all transitions a pass needs into one call,
+//   - gives every transient resource an offset in a shared heap, letting resources
+//     whose lifetimes do not overlap alias the same memory.
+//
+// The graph only knows handles, abstract states and byte sizes.  Execute() hands the
+// compiled barriers to a callback, so any backend (or a test) can consume them.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class RenderGraph
+{
+public:
+	typedef std::uint32_t Resource;
+	typedef std::uint32_t Pass;
+
+	static const Resource InvalidResource = ~0u;
+
+	// Backend-neutral resource states.  Read-only states may be combined.
+	enum ResourceState : std::uint32_t
+	{
+		StateUndefined      = 0,
+		StatePresent        = 1 << 0,
+		StateRenderTarget   = 1 << 1,
+		StateDepthWrite     = 1 << 2,
+		StateDepthRead      = 1 << 3,
+		StateShaderResource = 1 << 4,
+		StateUnorderedAccess = 1 << 5,
+		StateCopySource     = 1 << 6,
+		StateCopyDest       = 1 << 7,
+		StateVertexBuffer   = 1 << 8,
+		StateIndexBuffer    = 1 << 9,
+
+		ReadOnlyStates = StatePresent | StateDepthRead | StateShaderResource |
+			StateCopySource | StateVertexBuffer | StateIndexBuffer
+	};
+
+	struct Barrier
+	{
+		enum Type { Transition, Aliasing };
+
+		Type BarrierType = Transition;
+		Resource Target = InvalidResource;
+
+		// Transition only.
+		std::uint32_t StateBefore = StateUndefined;
+		std::uint32_t StateAfter = StateUndefined;
+
+		// Aliasing only: the transient that last occupied the memory in this frame,
+		// or InvalidResource if any resource may have.
+		Resource AliasBefore = InvalidResource;
+	};
+
+	struct Stats
+	{
+		std::uint32_t PassCount = 0;
+		std::uint32_t CulledPassCount = 0;
+		std::uint32_t BarrierCount = 0;
+		std::uint32_t BarrierBatchCount = 0;
+
+		std::uint32_t TransientCount = 0;
+
+		// Transient memory with one allocation per resource vs. with aliasing.
+		std::uint64_t TransientBytes = 0;
+		std::uint64_t AliasedTransientBytes = 0;
+
+		float AliasingSavings()const
+		{
+			return TransientBytes == 0 ? 0.0f : 1.0f - (float)AliasedTransientBytes / (float)TransientBytes;
+		}
+	};
+
+	using ExecuteCallback = std::function<void()>;
+	using BarrierCallback = std::function<void(const Barrier* barriers, std::uint32_t count)>;
+
+	RenderGraph() = default;
+	RenderGraph(const RenderGraph& rhs) = delete;
+	RenderGraph& operator=(const RenderGraph& rhs) = delete;
+
+	// An externally owned resource.  It is in initialState when the frame starts and is
+	// returned to finalState at the end; a final state other than StateUndefined also
+	// marks it as a graph output, which keeps the passes producing it alive.
+	Resource ImportResource(const std::string& name, std::uint32_t initialState, std::uint32_t finalState);
+
+	// A resource that only lives within the frame.  Its memory comes from the shared
+	// transient heap.
+	Resource CreateTransient(const std::string& name, std::uint64_t byteSize, std::uint64_t alignment);
+
+	// Passes run in the order they are added.  Side-effect passes are never culled.
+	Pass AddPass(const std::string& name, ExecuteCallback execute, bool hasSideEffects = false);
+	void Read(Pass pass, Resource resource, std::uint32_t state);
+	void Write(Pass pass, Resource resource, std::uint32_t state);
+
+	void Compile();
+
+	// Runs every surviving pass, calling recordBarriers once per non-empty batch.
+	void Execute(const BarrierCallback& recordBarriers)const;
+
+	// Removes all passes and resources.
+	void Reset();
+
+	bool IsCulled(Pass pass)const { return mPasses[pass].Culled; }
+	bool IsTransient(Resource resource)const { return mResources[resource].Transient; }
+	const std::string& ResourceName(Resource resource)const { return mResources[resource].Name; }
+	std::uint32_t ResourceCount()const { return (std::uint32_t)mResources.size(); }
+
+	// Compiled transient placement.  A transient is in InitialState() at the start of
+	// every frame, so backends should create it in that state.
+	std::uint64_t TransientOffset(Resource resource)const { return mResources[resource].HeapOffset; }
+	std::uint64_t TransientHeapSize()const { return mTransientHeapSize; }
+	std::uint32_t InitialState(Resource resource)const { return mResources[resource].InitialState; }
+
+	Stats GetStats()const { return mStats; }
+	std::string Report()const;
+
+private:
+	struct ResourceNode
+	{
+		std::string Name;
+		bool Transient = false;
+
+		std::uint32_t InitialState = StateUndefined;
+		std::uint32_t FinalState = StateUndefined;
+
+		std::uint64_t ByteSize = 0;
+		std::uint64_t Alignment = 1;
+
+		// Filled in by Compile().
+		std::uint32_t RefCount = 0;
+		std::uint32_t FirstPass = ~0u;
+		std::uint32_t LastPass = 0;
+		std::uint64_t HeapOffset = 0;
+		Resource AliasBefore = InvalidResource;
+	};
+
+	struct Access
+	{
+		Resource Target = InvalidResource;
+		std::uint32_t State = StateUndefined;
+		bool IsWrite = false;
+	};
+
+	struct PassNode
+	{
+		std::string Name;
+		ExecuteCallback Execute;
+		bool HasSideEffects = false;
+		std::vector<Access> Accesses;
+
+		// Filled in by Compile().
+		std::uint32_t RefCount = 0;
+		bool Culled = false;
+		std::uint32_t BarrierStart = 0;
+		std::uint32_t BarrierCount = 0;
+	};
+
+	void CullPasses();
+	void ComputeLifetimes();
+	void PlaceTransients();
+	void BuildBarriers();
+
+	// The transitions of every pass from the resources' initial states; leaves current
+	// holding the states at the end of the last pass.
+	void BuildPassBarriers(std::vector<std::uint32_t>& current);
+
+	// Combined state of resource in pass, or StateUndefined if the pass doesn't use it.
+	std::uint32_t StateInPass(const PassNode& pass, Resource resource, bool* isWrite)const;
+
+private:
+	std::vector<ResourceNode> mResources;
+	std::vector<PassNode> mPasses;
+
+	std::vector<Barrier> mBarriers;
+	std::uint32_t mFinalBarrierStart = 0;
+	std::uint32_t mFinalBarrierCount = 0;
+
+	std::uint64_t mTransientHeapSize = 0;
+	bool mCompiled = false;
+
+	Stats mStats;
+};
@@ -0,0 +1,132 @@
+//***************************************************************************************
+// RenderGraphD3D12.cpp
+//***************************************************************************************
+
+#include "RenderGraphD3D12.h"
+
+using Microsoft::WRL::ComPtr;
+
+RenderGraphD3D12::RenderGraphD3D12(ID3D12Device* device) :
+	md3dDevice(device)
+{
+}
+
+RenderGraphD3D12::~RenderGraphD3D12()
+{
+}
+
+D3D12_RESOURCE_STATES RenderGraphD3D12::ToD3D12States(std::uint32_t state)
+{
+	D3D12_RESOURCE_STATES states = D3D12_RESOURCE_STATE_COMMON;
+
+	// PRESENT is COMMON (0), so it never needs a bit of its own.
+	if(state & RenderGraph::StateRenderTarget)    states |= D3D12_RESOURCE_STATE_RENDER_TARGET;
+	if(state & RenderGraph::StateDepthWrite)      states |= D3D12_RESOURCE_STATE_DEPTH_WRITE;
+	if(state & RenderGraph::StateDepthRead)       states |= D3D12_RESOURCE_STATE_DEPTH_READ;
+	if(state & RenderGraph::StateShaderResource)
+		states |= D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+	if(state & RenderGraph::StateUnorderedAccess) states |= D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+	if(state & RenderGraph::StateCopySource)      states |= D3D12_RESOURCE_STATE_COPY_SOURCE;
+	if(state & RenderGraph::StateCopyDest)        states |= D3D12_RESOURCE_STATE_COPY_DEST;
+	if(state & RenderGraph::StateVertexBuffer)    states |= D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER;
+	if(state & RenderGraph::StateIndexBuffer)     states |= D3D12_RESOURCE_STATE_INDEX_BUFFER;
+
+	return states;
+}
+
+RenderGraph::Resource RenderGraphD3D12::CreateTransient(RenderGraph& graph, const std::string& name,
+	const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* optClear)
+{
+	assert(desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL));
+
+	D3D12_RESOURCE_ALLOCATION_INFO info = md3dDevice->GetResourceAllocationInfo(0, 1, &desc);
+	RenderGraph::Resource resource = graph.CreateTransient(name, info.SizeInBytes, info.Alignment);
+
+	TransientDesc transient;
+	transient.Desc = desc;
+	if(optClear != nullptr)
+	{
+		transient.ClearValue = *optClear;
+		transient.HasClearValue = true;
+	}
+	mTransientDescs[resource] = transient;
+
+	return resource;
+}
+
+void RenderGraphD3D12::SetResource(RenderGraph::Resource resource, ID3D12Resource* d3dResource)
+{
+	if(resource >= mResources.size())
+		mResources.resize(resource + 1, nullptr);
+
+	mResources[resource] = d3dResource;
+}
+
+ID3D12Resource* RenderGraphD3D12::GetResource(RenderGraph::Resource resource)const
+{
+	return resource < mResources.size() ? mResources[resource] : nullptr;
+}
+
+void RenderGraphD3D12::Realize(const RenderGraph& graph)
+{
+	mTransients.clear();
+	mTransientHeap = nullptr;
+	mResources.resize(graph.ResourceCount(), nullptr);
+
+	if(graph.TransientHeapSize() == 0)
+		return;
+
+	D3D12_HEAP_DESC heapDesc = {};
+	heapDesc.SizeInBytes = graph.TransientHeapSize();
+	heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+	heapDesc.Alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+	heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+	ThrowIfFailed(md3dDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(mTransientHeap.GetAddressOf())));
+
+	for(auto& e : mTransientDescs)
+	{
+		RenderGraph::Resource resource = e.first;
+
+		// Culled away entirely: no memory was assigned.
+		if(graph.InitialState(resource) == RenderGraph::StateUndefined)
+			continue;
+
+		ComPtr<ID3D12Resource> placed;
+		ThrowIfFailed(md3dDevice->CreatePlacedResource(
+			mTransientHeap.Get(),
+			graph.TransientOffset(resource),
+			&e.second.Desc,
+			ToD3D12States(graph.InitialState(resource)),
+			e.second.HasClearValue ? &e.second.ClearValue : nullptr,
+			IID_PPV_ARGS(placed.GetAddressOf())));
+
+		mResources[resource] = placed.Get();
+		mTransients.push_back(placed);
+	}
+}
+
+void RenderGraphD3D12::Execute(const RenderGraph& graph, ID3D12GraphicsCommandList* cmdList)
+{
+	mCmdList = cmdList;
+
+	graph.Execute([&](const RenderGraph::Barrier* barriers, std::uint32_t count)
+	{
+		mBarrierScratch.clear();
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			const RenderGraph::Barrier& b = barriers[i];
+			if(b.BarrierType == RenderGraph::Barrier::Aliasing)
+			{
+				mBarrierScratch.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(
+					GetResource(b.AliasBefore), GetResource(b.Target)));
+			}
+			else
+			{
+				mBarrierScratch.push_back(CD3DX12_RESOURCE_BARRIER::Transition(GetResource(b.Target),
+					ToD3D12States(b.StateBefore), ToD3D12States(b.StateAfter)));
+			}
+		}
+
+		mCmdList->ResourceBarrier((UINT)mBarrierScratch.size(), mBarrierScratch.data());
+	});
+}
@@ -0,0 +1,64 @@
+//***************************************************************************************
+// RenderGraphD3D12.h
+//
+// Runs a compiled RenderGraph on a D3D12 command list.  Imported resources are bound
+// to their ID3D12Resource each frame; transients are placed resources in one heap
+// laid out by the graph's aliasing pass.  Each barrier batch becomes a single
+// ResourceBarrier call.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "RenderGraph.h"
+
+class RenderGraphD3D12
+{
+public:
+	explicit RenderGraphD3D12(ID3D12Device* device);
+	RenderGraphD3D12(const RenderGraphD3D12& rhs) = delete;
+	RenderGraphD3D12& operator=(const RenderGraphD3D12& rhs) = delete;
+	~RenderGraphD3D12();
+
+	static D3D12_RESOURCE_STATES ToD3D12States(std::uint32_t state);
+
+	// Declares a transient render target or depth texture.  Only RT/DS textures can be
+	// transient, so they can all share one heap on every resource heap tier.
+	RenderGraph::Resource CreateTransient(RenderGraph& graph, const std::string& name,
+		const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* optClear);
+
+	// Binds an imported resource, e.g. the current back buffer.
+	void SetResource(RenderGraph::Resource resource, ID3D12Resource* d3dResource);
+	ID3D12Resource* GetResource(RenderGraph::Resource resource)const;
+
+	// Creates the transient heap and placed resources for a compiled graph.  Must be
+	// called again whenever the graph is recompiled.
+	void Realize(const RenderGraph& graph);
+
+	void Execute(const RenderGraph& graph, ID3D12GraphicsCommandList* cmdList);
+
+	// The list barriers are currently recorded into.  A pass that closes the list and
+	// splits its work over other lists hands over the list that continues after it.
+	ID3D12GraphicsCommandList* CommandList()const { return mCmdList; }
+	void SetCommandList(ID3D12GraphicsCommandList* cmdList) { mCmdList = cmdList; }
+
+private:
+	struct TransientDesc
+	{
+		D3D12_RESOURCE_DESC Desc = {};
+		D3D12_CLEAR_VALUE ClearValue = {};
+		bool HasClearValue = false;
+	};
+
+	ID3D12Device* md3dDevice = nullptr;
+
+	// Indexed by RenderGraph::Resource.
+	std::vector<ID3D12Resource*> mResources;
+	std::unordered_map<RenderGraph::Resource, TransientDesc> mTransientDescs;
+
+	Microsoft::WRL::ComPtr<ID3D12Heap> mTransientHeap;
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> mTransients;
+
+	std::vector<D3D12_RESOURCE_BARRIER> mBarrierScratch;
+	ID3D12GraphicsCommandList* mCmdList = nullptr;
+};
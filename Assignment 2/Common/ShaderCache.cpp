@@ -0,0 +1,272 @@
+//***************************************************************************************
+// ShaderCache.cpp
+//***************************************************************************************
+
+#include "ShaderCache.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+	// Bump when the key layout or entry format changes.
+	const char* const CacheVersion = "ShaderCache1";
+
+	const std::uint64_t FnvOffset = 14695981039346656037ull;
+	const std::uint64_t FnvPrime = 1099511628211ull;
+
+	std::uint64_t HashBytes(std::uint64_t hash, const void* data, std::size_t size)
+	{
+		const std::uint8_t* bytes = (const std::uint8_t*)data;
+		for(std::size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= FnvPrime;
+		}
+		return hash;
+	}
+
+	// Strings are hashed with their length so "ab"+"c" differs from "a"+"bc".
+	std::uint64_t HashString(std::uint64_t hash, const std::string& s)
+	{
+		std::uint64_t size = s.size();
+		hash = HashBytes(hash, &size, sizeof(size));
+		return HashBytes(hash, s.data(), s.size());
+	}
+
+	bool ReadFile(const std::string& path, std::string& contents)
+	{
+		std::ifstream fin(path, std::ios::binary);
+		if(!fin)
+			return false;
+
+		contents.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+		return true;
+	}
+
+	std::string DirectoryOf(const std::string& path)
+	{
+		std::size_t slash = path.find_last_of("/\\");
+		return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+	}
+
+	// Quoted includes in source order.  Angle-bracket includes are not resolved by the
+	// standard include handler either, so they are left out.
+	std::vector<std::string> ParseIncludes(const std::string& source)
+	{
+		std::vector<std::string> includes;
+
+		std::istringstream lines(source);
+		std::string line;
+		while(std::getline(lines, line))
+		{
+			std::size_t i = line.find_first_not_of(" \t");
+			if(i == std::string::npos || line[i] != '#')
+				continue;
+
+			i = line.find_first_not_of(" \t", i + 1);
+			if(i == std::string::npos || line.compare(i, 7, "include") != 0)
+				continue;
+
+			std::size_t open = line.find('"', i + 7);
+			std::size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+			if(close != std::string::npos)
+				includes.push_back(line.substr(open + 1, close - open - 1));
+		}
+
+		return includes;
+	}
+}
+
+ShaderCache::ShaderCache(const std::string& directory, const CompileCallback& compile) :
+	mDirectory(directory),
+	mCompile(compile)
+{
+	if(!mDirectory.empty() && mDirectory.back() != '/' && mDirectory.back() != '\\')
+		mDirectory += '/';
+
+	// Fails harmlessly if the directory already exists.
+#ifdef _WIN32
+	_mkdir(mDirectory.c_str());
+#else
+	mkdir(mDirectory.c_str(), 0755);
+#endif
+}
+
+std::uint64_t ShaderCache::SourceHash(const std::string& path, std::unordered_set<std::string>& visiting)
+{
+	auto it = mSourceHashes.find(path);
+	if(it != mSourceHashes.end())
+		return it->second;
+
+	// A file including itself, directly or not, adds nothing the first visit has not.
+	if(!visiting.insert(path).second)
+		return 0;
+
+	std::string source;
+	if(!ReadFile(path, source))
+		throw std::runtime_error("ShaderCache: cannot read " + path);
+
+	std::uint64_t hash = HashString(FnvOffset, source);
+
+	const std::string directory = DirectoryOf(path);
+	std::vector<std::string> includePaths;
+	for(const std::string& include : ParseIncludes(source))
+	{
+		includePaths.push_back(directory + include);
+		std::uint64_t includeHash = SourceHash(includePaths.back(), visiting);
+		hash = HashString(hash, include);
+		hash = HashBytes(hash, &includeHash, sizeof(includeHash));
+	}
+
+	visiting.erase(path);
+	mSourceHashes[path] = hash;
+	mSourceIncludes[path] = std::move(includePaths);
+	return hash;
+}
+
+std::uint64_t ShaderCache::Key(const Request& request)
+{
+	std::uint64_t sourceHash = 0;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		std::unordered_set<std::string> visiting;
+		sourceHash = SourceHash(request.File, visiting);
+	}
+
+	std::uint64_t key = HashString(FnvOffset, CacheVersion);
+	key = HashBytes(key, &sourceHash, sizeof(sourceHash));
+	key = HashString(key, request.File);
+	for(const Define& define : request.Defines)
+	{
+		key = HashString(key, define.Name);
+		key = HashString(key, define.Value);
+	}
+	key = HashString(key, request.EntryPoint);
+	key = HashString(key, request.Target);
+	key = HashBytes(key, &request.Flags, sizeof(request.Flags));
+
+	return key;
+}
+
+std::string ShaderCache::EntryPath(std::uint64_t key)const
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.cso", (unsigned long long)key);
+	return mDirectory + name;
+}
+
+bool ShaderCache::StoreEntry(const std::string& path, const std::vector<std::uint8_t>& bytecode)const
+{
+	// Write aside and rename, so a crash never leaves a truncated entry behind.
+	const std::string temp = path + ".tmp";
+	{
+		std::ofstream fout(temp, std::ios::binary | std::ios::trunc);
+		if(!fout)
+			return false;
+
+		fout.write((const char*)bytecode.data(), bytecode.size());
+		if(!fout)
+			return false;
+	}
+
+	std::remove(path.c_str());
+	return std::rename(temp.c_str(), path.c_str()) == 0;
+}
+
+std::string ShaderCache::Resolve(const Request& request)
+{
+	const std::string path = EntryPath(Key(request));
+
+	if(std::ifstream(path, std::ios::binary))
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStats.Hits++;
+		return path;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::uint8_t> bytecode;
+	std::string errors;
+	if(!mCompile(request, bytecode, errors))
+		throw std::runtime_error("ShaderCache: " + request.File + " " + request.EntryPoint + " failed to compile:\n" + errors);
+
+	if(!StoreEntry(path, bytecode))
+		throw std::runtime_error("ShaderCache: cannot write " + path);
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	mStats.Misses++;
+	mStats.CompileMs += ms;
+	return path;
+}
+
+std::vector<std::string> ShaderCache::ResolveAll(const std::vector<Request>& requests, TaskPool& pool)
+{
+	std::vector<std::string> paths(requests.size());
+
+	pool.ParallelFor((std::uint32_t)requests.size(), [&](std::uint32_t i, std::uint32_t)
+	{
+		paths[i] = Resolve(requests[i]);
+	});
+
+	return paths;
+}
+
+std::vector<std::string> ShaderCache::SourceFiles(const Request& request)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	std::unordered_set<std::string> visiting;
+	SourceHash(request.File, visiting);
+
+	// Walk the includes recorded while hashing; each file is listed once.
+	std::vector<std::string> files(1, request.File);
+	std::unordered_set<std::string> seen(files.begin(), files.end());
+	for(std::size_t i = 0; i < files.size(); ++i)
+	{
+		auto it = mSourceIncludes.find(files[i]);
+		if(it == mSourceIncludes.end())
+			continue;
+
+		for(const std::string& include : it->second)
+		{
+			if(seen.insert(include).second)
+				files.push_back(include);
+		}
+	}
+	return files;
+}
+
+void ShaderCache::InvalidateSources()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mSourceHashes.clear();
+	mSourceIncludes.clear();
+}
+
+ShaderCache::Stats ShaderCache::GetStats()const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStats;
+}
+
+std::string ShaderCache::StatsString()const
+{
+	Stats stats = GetStats();
+
+	char text[128];
+	std::snprintf(text, sizeof(text), "Shader cache: %u hits, %u misses, %.1f ms compiling\n",
+		stats.Hits, stats.Misses, stats.CompileMs);
+	return text;
+}
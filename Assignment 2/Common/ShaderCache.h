@@ -0,0 +1,93 @@
+//***************************************************************************************
+// ShaderCache.h
+//
+// On-disk cache of compiled shader bytecode.  An entry is keyed by a hash of the shader
+// source, every file it pulls in through #include "..." (transitively), the defines,
+// entry point, target and compile flags, so editing any of them is a miss and stale
+// entries are simply never looked up again.  Entries are files named after their key.
+//
+// The compiler is passed in, which keeps this file free of D3D: ShaderCacheD3D12 plugs
+// in D3DCompileFromFile, and anything else (a stand-in on Linux, for one) works too.
+//***************************************************************************************
+
+#pragma once
+
+#include "TaskPool.h"
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+class ShaderCache
+{
+public:
+	struct Define
+	{
+		std::string Name;
+		std::string Value;
+	};
+
+	struct Request
+	{
+		std::string File;
+		std::vector<Define> Defines;
+		std::string EntryPoint;
+		std::string Target;
+		std::uint32_t Flags = 0;
+	};
+
+	// Returns false and fills errors if the shader does not compile.
+	using CompileCallback = std::function<bool(const Request& request,
+		std::vector<std::uint8_t>& bytecode, std::string& errors)>;
+
+	struct Stats
+	{
+		std::uint32_t Hits = 0;
+		std::uint32_t Misses = 0;
+		double CompileMs = 0.0;
+	};
+
+	// The directory is created if needed.
+	ShaderCache(const std::string& directory, const CompileCallback& compile);
+	ShaderCache(const ShaderCache& rhs) = delete;
+	ShaderCache& operator=(const ShaderCache& rhs) = delete;
+
+	// Hash of everything that affects the bytecode.  Throws std::runtime_error if the
+	// source file cannot be read.
+	std::uint64_t Key(const Request& request);
+
+	std::string EntryPath(std::uint64_t key)const;
+
+	// Path of the entry for request, compiling and storing it first on a miss.
+	// Thread-safe; throws std::runtime_error with the compiler output on failure.
+	std::string Resolve(const Request& request);
+
+	// Resolves every request, compiling the misses in parallel on pool.  Paths are
+	// returned in request order.
+	std::vector<std::string> ResolveAll(const std::vector<Request>& requests, TaskPool& pool);
+
+	// The source file and everything it includes, transitively, as last read.  Throws
+	// std::runtime_error like Key.
+	std::vector<std::string> SourceFiles(const Request& request);
+
+	// Forgets the source hashes remembered so far, so edited files are read again.
+	void InvalidateSources();
+
+	Stats GetStats()const;
+	std::string StatsString()const;
+
+private:
+	// Hash of a file and everything it includes.  mMutex must be held.
+	std::uint64_t SourceHash(const std::string& path, std::unordered_set<std::string>& visiting);
+
+	bool StoreEntry(const std::string& path, const std::vector<std::uint8_t>& bytecode)const;
+
+private:
+	std::string mDirectory;
+	CompileCallback mCompile;
+
+	mutable std::mutex mMutex;
+	std::unordered_map<std::string, std::uint64_t> mSourceHashes;
+	std::unordered_map<std::string, std::vector<std::string>> mSourceIncludes;
+	Stats mStats;
+};
@@ -0,0 +1,68 @@
+//***************************************************************************************
+// ShaderCacheD3D12.cpp
+//***************************************************************************************
+
+#include "ShaderCacheD3D12.h"
+
+using Microsoft::WRL::ComPtr;
+
+ShaderCacheD3D12::ShaderCacheD3D12(const std::string& directory) :
+	mCache(directory, &ShaderCacheD3D12::Compile)
+{
+}
+
+ShaderCache::Request ShaderCacheD3D12::MakeRequest(
+	const std::wstring& filename,
+	const D3D_SHADER_MACRO* defines,
+	const std::string& entrypoint,
+	const std::string& target)
+{
+	ShaderCache::Request request;
+
+	char file[MAX_PATH];
+	WideCharToMultiByte(CP_ACP, 0, filename.c_str(), -1, file, MAX_PATH, nullptr, nullptr);
+	request.File = file;
+
+	for(const D3D_SHADER_MACRO* d = defines; d != nullptr && d->Name != nullptr; ++d)
+		request.Defines.push_back({ d->Name, d->Definition != nullptr ? d->Definition : "" });
+
+	request.EntryPoint = entrypoint;
+	request.Target = target;
+
+#if defined(DEBUG) || defined(_DEBUG)  
+	request.Flags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+
+	return request;
+}
+
+bool ShaderCacheD3D12::Compile(const ShaderCache::Request& request, std::vector<std::uint8_t>& bytecode, std::string& errors)
+{
+	std::vector<D3D_SHADER_MACRO> defines;
+	for(auto& define : request.Defines)
+		defines.push_back({ define.Name.c_str(), define.Value.c_str() });
+	defines.push_back({ nullptr, nullptr });
+
+	ComPtr<ID3DBlob> byteCode = nullptr;
+	ComPtr<ID3DBlob> errorBlob;
+	HRESULT hr = D3DCompileFromFile(AnsiToWString(request.File).c_str(), defines.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE,
+		request.EntryPoint.c_str(), request.Target.c_str(), request.Flags, 0, &byteCode, &errorBlob);
+
+	if(errorBlob != nullptr)
+	{
+		errors.assign((const char*)errorBlob->GetBufferPointer(), errorBlob->GetBufferSize());
+		OutputDebugStringA(errors.c_str());
+	}
+
+	if(FAILED(hr))
+		return false;
+
+	const std::uint8_t* bytes = (const std::uint8_t*)byteCode->GetBufferPointer();
+	bytecode.assign(bytes, bytes + byteCode->GetBufferSize());
+	return true;
+}
+
+ComPtr<ID3DBlob> ShaderCacheD3D12::Load(const ShaderCache::Request& request)
+{
+	return d3dUtil::LoadBinary(AnsiToWString(mCache.Resolve(request)));
+}
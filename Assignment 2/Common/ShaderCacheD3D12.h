@@ -0,0 +1,37 @@
+//***************************************************************************************
+// ShaderCacheD3D12.h
+//
+// ShaderCache with D3DCompileFromFile as the compiler.  Hits are read back with
+// d3dUtil::LoadBinary.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "ShaderCache.h"
+
+class ShaderCacheD3D12
+{
+public:
+	explicit ShaderCacheD3D12(const std::string& directory);
+	ShaderCacheD3D12(const ShaderCacheD3D12& rhs) = delete;
+	ShaderCacheD3D12& operator=(const ShaderCacheD3D12& rhs) = delete;
+
+	// Same arguments as d3dUtil::CompileShader; the flags match it too.
+	static ShaderCache::Request MakeRequest(
+		const std::wstring& filename,
+		const D3D_SHADER_MACRO* defines,
+		const std::string& entrypoint,
+		const std::string& target);
+
+	// Thread-safe.  Compiles and stores the shader first on a miss.
+	Microsoft::WRL::ComPtr<ID3DBlob> Load(const ShaderCache::Request& request);
+
+	ShaderCache& Cache() { return mCache; }
+
+private:
+	static bool Compile(const ShaderCache::Request& request, std::vector<std::uint8_t>& bytecode, std::string& errors);
+
+private:
+	ShaderCache mCache;
+};
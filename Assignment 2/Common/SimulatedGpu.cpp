@@ -0,0 +1,52 @@
+//***************************************************************************************
+// SimulatedGpu.cpp
+//***************************************************************************************
+
+#include "SimulatedGpu.h"
+#include <algorithm>
+#include <thread>
+
+std::uint64_t SimulatedGpu::Submit(double workMs)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	// Starts when submitted or when the previous batch finishes, whichever is later.
+	Clock::time_point start = Clock::now();
+	if(!mCompletions.empty())
+		start = std::max(start, mCompletions.back());
+
+	mCompletions.push_back(start + std::chrono::duration_cast<Clock::duration>(
+		std::chrono::duration<double, std::milli>(workMs)));
+
+	return mCompletions.size();
+}
+
+std::uint64_t SimulatedGpu::CompletedValue()const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	const Clock::time_point now = Clock::now();
+	auto firstPending = std::upper_bound(mCompletions.begin(), mCompletions.end(), now);
+	return (std::uint64_t)(firstPending - mCompletions.begin());
+}
+
+double SimulatedGpu::WaitForValue(std::uint64_t value)const
+{
+	if(value == 0)
+		return 0.0;
+
+	Clock::time_point completion;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if(value > mCompletions.size())
+			return 0.0;
+		completion = mCompletions[value - 1];
+	}
+
+	const Clock::time_point start = Clock::now();
+	if(completion <= start)
+		return 0.0;
+
+	std::this_thread::sleep_until(completion);
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
@@ -0,0 +1,39 @@
+//***************************************************************************************
+// SimulatedGpu.h
+//
+// Stand-in for a command queue and its fence when running headless.  Submitted work
+// executes in order, each batch taking a fixed time once the previous one is done,
+// and the fence value of a batch counts as reached when its time has passed.
+//***************************************************************************************
+
+#pragma once
+
+#include "FrameFence.h"
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+class SimulatedGpu : public FrameFence
+{
+public:
+	SimulatedGpu() = default;
+	SimulatedGpu(const SimulatedGpu& rhs) = delete;
+	SimulatedGpu& operator=(const SimulatedGpu& rhs) = delete;
+
+	// Queues workMs of GPU time and returns the fence value that signals its completion.
+	std::uint64_t Submit(double workMs);
+
+	std::uint64_t CompletedValue()const override;
+
+	// Blocks until the fence reaches value; returns the milliseconds spent waiting.
+	double WaitForValue(std::uint64_t value)const override;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	mutable std::mutex mMutex;
+
+	// Completion time of every submission; index i is fence value i + 1.
+	std::vector<Clock::time_point> mCompletions;
+};
@@ -0,0 +1,181 @@
+//***************************************************************************************
+// SoftwareCommandBackend.cpp
+//***************************************************************************************
+
+#include "SoftwareCommandBackend.h"
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+
+SoftwareCommandBackend::SoftwareCommandBackend(SoftwareRasterizer& rasterizer)
+	: mRasterizer(rasterizer)
+{
+}
+
+void SoftwareCommandBackend::MapMemory(std::uint64_t address, const void* data, std::uint64_t size)
+{
+	Range range = { address, size, static_cast<const std::uint8_t*>(data) };
+	auto it = std::upper_bound(mRanges.begin(), mRanges.end(), address,
+		[](std::uint64_t a, const Range& r) { return a < r.Address; });
+
+	assert(it == mRanges.end() || address + size <= it->Address);
+	assert(it == mRanges.begin() || (it - 1)->Address + (it - 1)->Size <= address);
+
+	mRanges.insert(it, range);
+}
+
+void SoftwareCommandBackend::UnmapAll()
+{
+	mRanges.clear();
+}
+
+const void* SoftwareCommandBackend::Resolve(std::uint64_t address, std::uint64_t size, std::uint64_t* available)const
+{
+	if(available != nullptr)
+		*available = 0;
+
+	// Last range starting at or before the address.
+	auto it = std::upper_bound(mRanges.begin(), mRanges.end(), address,
+		[](std::uint64_t a, const Range& r) { return a < r.Address; });
+	if(it == mRanges.begin())
+		return nullptr;
+	--it;
+
+	const std::uint64_t offset = address - it->Address;
+	if(offset >= it->Size || size > it->Size - offset)
+		return nullptr;
+
+	if(available != nullptr)
+		*available = it->Size - offset;
+	return it->Data + offset;
+}
+
+bool SoftwareCommandBackend::Execute(const CommandStream& stream, DrawProgram& program)
+{
+	// Nothing carries over between streams, just like a fresh command list.
+	DrawState state;
+	std::uint32_t topology = ~0u;
+	std::uint32_t indexBufferSize = 0;
+
+	for(const CommandStream::Header* h = stream.First(); h != nullptr; h = stream.Next(h))
+	{
+		mStats.Commands++;
+
+		switch(h->Type)
+		{
+		case CommandStream::CmdSetPipeline:
+			state.Pipeline = reinterpret_cast<const CommandStream::SetPipelineCmd*>(h)->Pipeline;
+			break;
+		case CommandStream::CmdSetRootSignature:
+			state.RootSignature = reinterpret_cast<const CommandStream::SetRootSignatureCmd*>(h)->RootSignature;
+			break;
+		case CommandStream::CmdSetPrimitiveTopology:
+			topology = reinterpret_cast<const CommandStream::SetPrimitiveTopologyCmd*>(h)->Topology;
+			break;
+		case CommandStream::CmdSetVertexBuffer:
+		{
+			auto cmd = reinterpret_cast<const CommandStream::SetVertexBufferCmd*>(h);
+			state.Vertices = static_cast<const std::uint8_t*>(Resolve(cmd->Address, cmd->SizeInBytes));
+			state.VertexStride = cmd->Stride;
+			state.VertexCount = cmd->Stride > 0 ? cmd->SizeInBytes / cmd->Stride : 0;
+			break;
+		}
+		case CommandStream::CmdSetIndexBuffer:
+		{
+			auto cmd = reinterpret_cast<const CommandStream::SetIndexBufferCmd*>(h);
+			state.Indices = Resolve(cmd->Address, cmd->SizeInBytes);
+			// DXGI_FORMAT_R32_UINT is 42; everything else used for indices is 16-bit.
+			state.Indices32 = cmd->Format == 42;
+			indexBufferSize = cmd->SizeInBytes;
+			break;
+		}
+		case CommandStream::CmdSetRootConstant:
+		{
+			auto cmd = reinterpret_cast<const CommandStream::SetRootConstantCmd*>(h);
+			if(cmd->Param < CommandStream::MaxRootParameters && cmd->Offset < MaxRootConstants)
+				state.RootConstants[cmd->Param][cmd->Offset] = cmd->Value;
+			break;
+		}
+		case CommandStream::CmdSetRootTable:
+		{
+			auto cmd = reinterpret_cast<const CommandStream::SetRootAddressCmd*>(h);
+			if(cmd->Param < CommandStream::MaxRootParameters)
+				state.RootTables[cmd->Param] = cmd->Address;
+			break;
+		}
+		case CommandStream::CmdSetRootCbv:
+		case CommandStream::CmdSetRootSrv:
+		{
+			auto cmd = reinterpret_cast<const CommandStream::SetRootAddressCmd*>(h);
+			if(cmd->Param < CommandStream::MaxRootParameters)
+				state.RootAddresses[cmd->Param] = Resolve(cmd->Address, 1, &state.RootSizes[cmd->Param]);
+			break;
+		}
+		case CommandStream::CmdDrawIndexed:
+		{
+			auto cmd = reinterpret_cast<const CommandStream::DrawIndexedCmd*>(h);
+
+			if(topology != TriangleListTopology)
+			{
+				mStats.SkippedTopology++;
+				break;
+			}
+
+			const std::uint64_t indexSize = state.Indices32 ? 4 : 2;
+			if(state.Vertices == nullptr || state.Indices == nullptr ||
+				((std::uint64_t)cmd->StartIndex + cmd->IndexCount) * indexSize > indexBufferSize)
+			{
+				mStats.SkippedUnmapped++;
+				break;
+			}
+
+			state.IndexCount = cmd->IndexCount - cmd->IndexCount % 3;
+			state.StartIndex = cmd->StartIndex;
+			state.BaseVertex = cmd->BaseVertex;
+
+			// Bad indices would read outside the vertex buffer; the GPU would return
+			// zeros, here the whole draw is dropped.
+			bool inRange = true;
+			for(std::uint32_t i = 0; i < state.IndexCount && inRange; ++i)
+				inRange = state.Index(i) < state.VertexCount;
+			if(!inRange)
+			{
+				mStats.SkippedUnmapped++;
+				break;
+			}
+
+			if(!program.Draw(state, mRasterizer))
+			{
+				mStats.SkippedByProgram++;
+				break;
+			}
+
+			// Instancing is not used by the scene streams; each draw is one instance.
+			mStats.Draws++;
+			mStats.Triangles += state.IndexCount / 3;
+			break;
+		}
+		default:
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void SoftwareCommandBackend::ResetStats()
+{
+	mStats = Stats();
+}
+
+std::string SoftwareCommandBackend::StatsString()const
+{
+	std::ostringstream out;
+	out << "Commands: " << mStats.Commands
+		<< "  Draws: " << mStats.Draws
+		<< "  Triangles: " << mStats.Triangles
+		<< "  Skipped (topology/unmapped/program): " << mStats.SkippedTopology
+		<< "/" << mStats.SkippedUnmapped
+		<< "/" << mStats.SkippedByProgram;
+	return out.str();
+}
@@ -0,0 +1,117 @@
+//***************************************************************************************
+// SoftwareCommandBackend.h
+//
+// Replays a CommandStream on the CPU into a SoftwareRasterizer.  GPU addresses in the
+// stream are looked up in ranges registered with MapMemory (the CPU copy of a mesh, a
+// mapped upload buffer), and the bound state is tracked the way NullCommandBackend
+// tracks it.  Each triangle-list draw is handed to a DrawProgram, the CPU stand-in for
+// the pipeline's shaders, which shades the vertices and submits the triangles.
+//
+// Draws with another topology, with unmapped buffers or that the program declines are
+// counted and skipped, so a frame with a few unsupported passes still renders.
+//***************************************************************************************
+
+#pragma once
+
+#include "CommandStream.h"
+#include "SoftwareRasterizer.h"
+
+class SoftwareCommandBackend
+{
+public:
+	// D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST, the only topology drawn.
+	static const std::uint32_t TriangleListTopology = 4;
+
+	static const std::uint32_t MaxRootConstants = 16;
+
+	// Everything a draw sees.  Addresses are resolved to CPU pointers, which are null
+	// when nothing is bound or the address is not mapped.
+	struct DrawState
+	{
+		std::uint32_t Pipeline = ~0u;
+		std::uint32_t RootSignature = ~0u;
+
+		const std::uint8_t* Vertices = nullptr;
+		std::uint32_t VertexStride = 0;
+		std::uint32_t VertexCount = 0;
+
+		const void* Indices = nullptr;
+		bool Indices32 = false;
+
+		std::uint32_t RootConstants[CommandStream::MaxRootParameters][MaxRootConstants] = {};
+		const void* RootAddresses[CommandStream::MaxRootParameters] = {};
+		std::uint64_t RootSizes[CommandStream::MaxRootParameters] = {};    // bytes mapped past the address
+		std::uint64_t RootTables[CommandStream::MaxRootParameters] = {};
+
+		std::uint32_t IndexCount = 0;
+		std::uint32_t StartIndex = 0;
+		std::int32_t BaseVertex = 0;
+
+		// Index i of the draw, 0 <= i < IndexCount, with the base vertex applied.
+		std::uint32_t Index(std::uint32_t i)const
+		{
+			const std::uint32_t index = Indices32 ?
+				static_cast<const std::uint32_t*>(Indices)[StartIndex + i] :
+				static_cast<const std::uint16_t*>(Indices)[StartIndex + i];
+			return (std::uint32_t)((std::int32_t)index + BaseVertex);
+		}
+	};
+
+	class DrawProgram
+	{
+	public:
+		virtual ~DrawProgram() = default;
+
+		// Shades the draw and submits its triangles.  Vertex indices are checked
+		// against VertexCount before the call.  Returns false to skip the draw.
+		virtual bool Draw(const DrawState& draw, SoftwareRasterizer& rasterizer) = 0;
+	};
+
+	struct Stats
+	{
+		std::uint32_t Commands = 0;
+		std::uint32_t Draws = 0;
+		std::uint64_t Triangles = 0;
+		std::uint32_t SkippedTopology = 0;   // not a triangle list
+		std::uint32_t SkippedUnmapped = 0;   // buffers not mapped or out of range
+		std::uint32_t SkippedByProgram = 0;
+	};
+
+	explicit SoftwareCommandBackend(SoftwareRasterizer& rasterizer);
+	SoftwareCommandBackend(const SoftwareCommandBackend& rhs) = delete;
+	SoftwareCommandBackend& operator=(const SoftwareCommandBackend& rhs) = delete;
+
+	// Makes [address, address + size) readable at data.  Ranges must not overlap.
+	void MapMemory(std::uint64_t address, const void* data, std::uint64_t size);
+	void UnmapAll();
+
+	// Replays the stream into the rasterizer; the caller brackets one or more calls
+	// with BeginFrame and Resolve.  Returns false on a corrupt stream.
+	bool Execute(const CommandStream& stream, DrawProgram& program);
+
+	void ResetStats();
+
+	const Stats& GetStats()const { return mStats; }
+
+	std::string StatsString()const;
+
+private:
+	// CPU pointer for [address, address + size), or null if it is not in one range.
+	// available receives the bytes mapped from address to the end of its range.
+	const void* Resolve(std::uint64_t address, std::uint64_t size, std::uint64_t* available = nullptr)const;
+
+private:
+	struct Range
+	{
+		std::uint64_t Address;
+		std::uint64_t Size;
+		const std::uint8_t* Data;
+	};
+
+	SoftwareRasterizer& mRasterizer;
+
+	// Sorted by address.
+	std::vector<Range> mRanges;
+
+	Stats mStats;
+};
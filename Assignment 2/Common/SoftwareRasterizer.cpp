@@ -0,0 +1,405 @@
+//***************************************************************************************
+// SoftwareRasterizer.cpp
+//***************************************************************************************
+
+#include "SoftwareRasterizer.h"
+#include "TaskPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+using namespace DirectX;
+
+const std::uint32_t SoftwareRasterizer::TileSize;
+const std::uint32_t SoftwareRasterizer::MaxVaryings;
+
+namespace
+{
+	std::int64_t SteadyNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	std::uint32_t PackColor(const float rgba[4])
+	{
+		std::uint32_t packed = 0;
+		for(int i = 0; i < 4; ++i)
+		{
+			const float c = std::min(std::max(rgba[i], 0.0f), 1.0f);
+			packed |= (std::uint32_t)(c * 255.0f + 0.5f) << (8 * i);
+		}
+		return packed;
+	}
+
+	// Point where the edge from a to b crosses z = 0 in clip space.
+	SoftwareRasterizer::ShadedVertex ClipNear(const SoftwareRasterizer::ShadedVertex& a,
+		const SoftwareRasterizer::ShadedVertex& b, std::uint32_t varyingCount)
+	{
+		const float t = a.PosH.z / (a.PosH.z - b.PosH.z);
+
+		SoftwareRasterizer::ShadedVertex v;
+		v.PosH.x = a.PosH.x + t * (b.PosH.x - a.PosH.x);
+		v.PosH.y = a.PosH.y + t * (b.PosH.y - a.PosH.y);
+		v.PosH.z = 0.0f;
+		v.PosH.w = a.PosH.w + t * (b.PosH.w - a.PosH.w);
+		for(std::uint32_t i = 0; i < varyingCount; ++i)
+			v.Varyings[i] = a.Varyings[i] + t * (b.Varyings[i] - a.Varyings[i]);
+		return v;
+	}
+}
+
+void SoftwareRasterizer::BeginFrame(std::uint32_t width, std::uint32_t height, const float clearColor[4])
+{
+	mFrameStart = SteadyNs();
+
+	mWidth = width;
+	mHeight = height;
+	mPitch = (width + 3) & ~3u;
+	mTilesX = (width + TileSize - 1) / TileSize;
+	mTilesY = (height + TileSize - 1) / TileSize;
+
+	mColor.assign((std::size_t)mPitch * height, PackColor(clearColor));
+	mDepth.assign((std::size_t)mPitch * height, 1.0f);
+
+	// Bins keep their capacity from frame to frame.
+	mTriangles.clear();
+	mBins.resize((std::size_t)mTilesX * mTilesY);
+	for(auto& bin : mBins)
+		bin.clear();
+
+	mStats = Stats();
+	mPixelsShaded = 0;
+}
+
+void SoftwareRasterizer::SubmitTriangle(const ShadedVertex& v0, const ShadedVertex& v1, const ShadedVertex& v2,
+	std::uint32_t varyingCount, const PixelShader* shader, CullMode cull)
+{
+	mStats.TrianglesSubmitted++;
+
+	const ShadedVertex* in[3] = { &v0, &v1, &v2 };
+	std::uint32_t outside = 0;
+	for(int i = 0; i < 3; ++i)
+		outside += in[i]->PosH.z < 0.0f ? 1 : 0;
+
+	if(outside == 3)
+	{
+		mStats.TrianglesCulled++;
+		return;
+	}
+
+	if(outside == 0)
+	{
+		SetupTriangle(in, varyingCount, shader, cull);
+		return;
+	}
+
+	// Clip against the near plane, keeping the winding: the polygon has three or four
+	// vertices and is drawn as a fan.
+	ShadedVertex clipped[4];
+	std::uint32_t count = 0;
+	for(int i = 0; i < 3; ++i)
+	{
+		const ShadedVertex& a = *in[i];
+		const ShadedVertex& b = *in[(i + 1) % 3];
+		const bool aInside = a.PosH.z >= 0.0f;
+		const bool bInside = b.PosH.z >= 0.0f;
+
+		if(aInside)
+			clipped[count++] = a;
+		if(aInside != bInside)
+			clipped[count++] = ClipNear(a, b, varyingCount);
+	}
+
+	for(std::uint32_t i = 1; i + 1 < count; ++i)
+	{
+		const ShadedVertex* fan[3] = { &clipped[0], &clipped[i], &clipped[i + 1] };
+		SetupTriangle(fan, varyingCount, shader, cull);
+	}
+}
+
+void SoftwareRasterizer::SetupTriangle(const ShadedVertex* v[3], std::uint32_t varyingCount,
+	const PixelShader* shader, CullMode cull)
+{
+	float sx[3], sy[3], sz[3], invW[3];
+	for(int i = 0; i < 3; ++i)
+	{
+		const XMFLOAT4& p = v[i]->PosH;
+		if(p.w <= 1.0e-6f)
+		{
+			mStats.TrianglesCulled++;
+			return;
+		}
+
+		invW[i] = 1.0f / p.w;
+		sx[i] = (0.5f + 0.5f * p.x * invW[i]) * mWidth;
+		sy[i] = (0.5f - 0.5f * p.y * invW[i]) * mHeight;
+		sz[i] = p.z * invW[i];
+	}
+
+	// Positive for clockwise on screen (y down), which faces the viewer.
+	float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sy[1] - sy[0]) * (sx[2] - sx[0]);
+	if(area == 0.0f || (area < 0.0f && cull == CullMode::Back))
+	{
+		mStats.TrianglesCulled++;
+		return;
+	}
+
+	int order[3] = { 0, 1, 2 };
+	if(area < 0.0f)
+	{
+		std::swap(order[1], order[2]);
+		area = -area;
+	}
+
+	const float minX = std::min(std::min(sx[0], sx[1]), sx[2]);
+	const float maxX = std::max(std::max(sx[0], sx[1]), sx[2]);
+	const float minY = std::min(std::min(sy[0], sy[1]), sy[2]);
+	const float maxY = std::max(std::max(sy[0], sy[1]), sy[2]);
+
+	Triangle tri;
+	tri.MinX = std::max(0, (int)std::floor(minX));
+	tri.MinY = std::max(0, (int)std::floor(minY));
+	tri.MaxX = std::min((int)mWidth - 1, (int)std::ceil(maxX));
+	tri.MaxY = std::min((int)mHeight - 1, (int)std::ceil(maxY));
+	if(tri.MinX > tri.MaxX || tri.MinY > tri.MaxY)
+	{
+		mStats.TrianglesCulled++;
+		return;
+	}
+
+	for(int k = 0; k < 3; ++k)
+	{
+		// Edge k runs between the two vertices other than k, in winding order.
+		const int a = order[(k + 1) % 3];
+		const int b = order[(k + 2) % 3];
+		tri.EdgeA[k] = sy[a] - sy[b];
+		tri.EdgeB[k] = sx[b] - sx[a];
+		tri.EdgeC[k] = -(tri.EdgeA[k] * sx[a] + tri.EdgeB[k] * sy[a]);
+		tri.TopLeft[k] = tri.EdgeA[k] > 0.0f || (tri.EdgeA[k] == 0.0f && tri.EdgeB[k] > 0.0f);
+	}
+
+	// value(x, y) = sum over k of value_k * E_k(x, y) / area.
+	const float invArea = 1.0f / area;
+	auto plane = [&](const float values[3], float out[3])
+	{
+		const float f0 = values[order[0]] * invArea;
+		const float f1 = values[order[1]] * invArea;
+		const float f2 = values[order[2]] * invArea;
+		out[0] = f0 * tri.EdgeA[0] + f1 * tri.EdgeA[1] + f2 * tri.EdgeA[2];
+		out[1] = f0 * tri.EdgeB[0] + f1 * tri.EdgeB[1] + f2 * tri.EdgeB[2];
+		out[2] = f0 * tri.EdgeC[0] + f1 * tri.EdgeC[1] + f2 * tri.EdgeC[2];
+	};
+
+	plane(sz, tri.Z);
+	plane(invW, tri.InvW);
+	for(std::uint32_t i = 0; i < varyingCount; ++i)
+	{
+		const float values[3] =
+		{
+			v[0]->Varyings[i] * invW[0],
+			v[1]->Varyings[i] * invW[1],
+			v[2]->Varyings[i] * invW[2],
+		};
+		plane(values, tri.Varyings[i]);
+	}
+	tri.VaryingCount = varyingCount;
+	tri.Shader = shader;
+
+	const std::uint32_t index = (std::uint32_t)mTriangles.size();
+	mTriangles.push_back(tri);
+	mStats.TrianglesRasterized++;
+
+	// A tile the bounding box overlaps is skipped when it lies wholly outside one of the
+	// edges: each edge is largest at the corner its normal (A, B) points toward.
+	for(std::uint32_t ty = tri.MinY / TileSize; ty <= (std::uint32_t)tri.MaxY / TileSize; ++ty)
+	{
+		for(std::uint32_t tx = tri.MinX / TileSize; tx <= (std::uint32_t)tri.MaxX / TileSize; ++tx)
+		{
+			const float x0 = (float)(tx * TileSize), x1 = x0 + TileSize;
+			const float y0 = (float)(ty * TileSize), y1 = y0 + TileSize;
+
+			bool overlaps = true;
+			for(int k = 0; k < 3 && overlaps; ++k)
+			{
+				const float x = tri.EdgeA[k] > 0.0f ? x1 : x0;
+				const float y = tri.EdgeB[k] > 0.0f ? y1 : y0;
+				overlaps = tri.EdgeA[k] * x + tri.EdgeB[k] * y + tri.EdgeC[k] >= 0.0f;
+			}
+
+			if(overlaps)
+				mBins[ty * mTilesX + tx].push_back(index);
+		}
+	}
+}
+
+void SoftwareRasterizer::Resolve(TaskPool* pool)
+{
+	const std::int64_t start = SteadyNs();
+	const std::uint32_t tileCount = mTilesX * mTilesY;
+
+	if(pool != nullptr)
+		pool->ParallelFor(tileCount, [this](std::uint32_t tile, std::uint32_t) { RasterizeTile(tile); });
+	else
+	{
+		for(std::uint32_t tile = 0; tile < tileCount; ++tile)
+			RasterizeTile(tile);
+	}
+
+	const std::int64_t end = SteadyNs();
+	mStats.PixelsShaded = mPixelsShaded.load();
+	mStats.ResolveSeconds = (end - start) * 1.0e-9;
+	mStats.FrameSeconds = (end - mFrameStart) * 1.0e-9;
+}
+
+void SoftwareRasterizer::RasterizeTile(std::uint32_t tile)
+{
+	const int tileX0 = (int)((tile % mTilesX) * TileSize);
+	const int tileY0 = (int)((tile / mTilesX) * TileSize);
+	const int tileX1 = std::min(tileX0 + (int)TileSize, (int)mWidth) - 1;
+	const int tileY1 = std::min(tileY0 + (int)TileSize, (int)mHeight) - 1;
+
+	const XMVECTOR laneOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+	const XMVECTOR columnEnd = XMVectorReplicate((float)(tileX1 + 1));
+
+	std::uint64_t shaded = 0;
+	float varyings[MaxVaryings];
+	float rgba[4];
+
+	for(std::uint32_t index : mBins[tile])
+	{
+		const Triangle& tri = mTriangles[index];
+
+		// Tiles start on a multiple of 4, so aligning down keeps x inside the tile.
+		const int x0 = std::max(tileX0, tri.MinX) & ~3;
+		const int x1 = std::min(tileX1, tri.MaxX);
+		const int y0 = std::max(tileY0, tri.MinY);
+		const int y1 = std::min(tileY1, tri.MaxY);
+
+		XMVECTOR edgeA[3];
+		for(int k = 0; k < 3; ++k)
+			edgeA[k] = XMVectorReplicate(tri.EdgeA[k]);
+		const XMVECTOR zA = XMVectorReplicate(tri.Z[0]);
+
+		for(int y = y0; y <= y1; ++y)
+		{
+			const float py = y + 0.5f;
+			float* depthRow = &mDepth[(std::size_t)y * mPitch];
+			std::uint32_t* colorRow = &mColor[(std::size_t)y * mPitch];
+
+			// Narrow the row to the span the edges allow; the masks below make the exact
+			// per-pixel decision, so the span only needs to be conservative.
+			float edgeRow[3];
+			float left = (float)x0;
+			float right = (float)x1;
+			for(int k = 0; k < 3; ++k)
+			{
+				edgeRow[k] = tri.EdgeB[k] * py + tri.EdgeC[k];
+
+				// Pixel centers where A*(x + 0.5) + edgeRow >= 0.
+				if(tri.EdgeA[k] > 0.0f)
+					left = std::max(left, -edgeRow[k] / tri.EdgeA[k] - 1.5f);
+				else if(tri.EdgeA[k] < 0.0f)
+					right = std::min(right, -edgeRow[k] / tri.EdgeA[k] + 0.5f);
+				else if(edgeRow[k] < 0.0f)
+					right = -1.0f;
+			}
+			if(left > right)
+				continue;
+
+			const int rowX0 = (int)left & ~3;
+			const int rowX1 = (int)right;
+			const float zRow = tri.Z[1] * py + tri.Z[2];
+
+			for(int x = rowX0; x <= rowX1; x += 4)
+			{
+				const XMVECTOR px = XMVectorAdd(XMVectorReplicate((float)x), laneOffsets);
+
+				XMVECTOR mask = XMVectorLess(px, columnEnd);
+				for(int k = 0; k < 3; ++k)
+				{
+					const XMVECTOR e = XMVectorMultiplyAdd(edgeA[k], px, XMVectorReplicate(edgeRow[k]));
+					mask = XMVectorAndInt(mask, tri.TopLeft[k] ?
+						XMVectorGreaterOrEqual(e, XMVectorZero()) : XMVectorGreater(e, XMVectorZero()));
+				}
+				if(XMComparisonAllFalse(XMVector4EqualIntR(mask, XMVectorTrueInt())))
+					continue;
+
+				const XMVECTOR z = XMVectorMultiplyAdd(zA, px, XMVectorReplicate(zRow));
+				const XMVECTOR depth = XMLoadFloat4((const XMFLOAT4*)&depthRow[x]);
+				mask = XMVectorAndInt(mask, XMVectorLess(z, depth));
+				if(XMComparisonAllFalse(XMVector4EqualIntR(mask, XMVectorTrueInt())))
+					continue;
+
+				XMStoreFloat4((XMFLOAT4*)&depthRow[x], XMVectorSelect(depth, z, mask));
+
+				std::uint32_t lanes[4];
+				XMStoreInt4(lanes, mask);
+				for(int i = 0; i < 4; ++i)
+				{
+					if(lanes[i] == 0)
+						continue;
+
+					const float cx = x + i + 0.5f;
+					const float w = 1.0f / (tri.InvW[0] * cx + tri.InvW[1] * py + tri.InvW[2]);
+					for(std::uint32_t v = 0; v < tri.VaryingCount; ++v)
+						varyings[v] = (tri.Varyings[v][0] * cx + tri.Varyings[v][1] * py + tri.Varyings[v][2]) * w;
+
+					tri.Shader->Shade(varyings, rgba);
+					colorRow[x + i] = PackColor(rgba);
+					shaded++;
+				}
+			}
+		}
+	}
+
+	mPixelsShaded += shaded;
+}
+
+bool SoftwareRasterizer::WritePpm(const std::string& path)const
+{
+	std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if(!file)
+		return false;
+
+	file << "P6\n" << mWidth << " " << mHeight << "\n255\n";
+
+	std::vector<char> row((std::size_t)mWidth * 3);
+	for(std::uint32_t y = 0; y < mHeight; ++y)
+	{
+		const std::uint32_t* pixels = &mColor[(std::size_t)y * mPitch];
+		for(std::uint32_t x = 0; x < mWidth; ++x)
+		{
+			row[3 * x + 0] = (char)(pixels[x] & 0xff);
+			row[3 * x + 1] = (char)((pixels[x] >> 8) & 0xff);
+			row[3 * x + 2] = (char)((pixels[x] >> 16) & 0xff);
+		}
+		file.write(row.data(), row.size());
+	}
+
+	return (bool)file;
+}
+
+std::string SoftwareRasterizer::StatsString()const
+{
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(2);
+	out << "Software rasterizer: " << mWidth << "x" << mHeight
+		<< ", " << mStats.TrianglesSubmitted << " triangles submitted"
+		<< ", " << mStats.TrianglesRasterized << " rasterized"
+		<< ", " << mStats.TrianglesCulled << " culled"
+		<< ", " << mStats.PixelsShaded << " pixels shaded\n";
+
+	if(mStats.FrameSeconds > 0.0 && mStats.ResolveSeconds > 0.0)
+	{
+		out << "  frame " << mStats.FrameSeconds * 1000.0 << " ms ("
+			<< mStats.TrianglesSubmitted / mStats.FrameSeconds / 1.0e6 << " Mtri/s)"
+			<< ", resolve " << mStats.ResolveSeconds * 1000.0 << " ms ("
+			<< mStats.TrianglesRasterized / mStats.ResolveSeconds / 1.0e6 << " Mtri/s)\n";
+	}
+
+	return out.str();
+}
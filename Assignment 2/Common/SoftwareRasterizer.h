@@ -0,0 +1,139 @@
+//***************************************************************************************
+// SoftwareRasterizer.h
+//
+// Tiled CPU rasterizer for rendering without a GPU.  Triangles arrive vertex shaded: a
+// clip-space position and up to MaxVaryings floats each.  SubmitTriangle clips them
+// against the near plane, culls them, sets up their edge and interpolation planes and
+// bins them into TileSize x TileSize screen tiles.  Resolve rasterizes the tiles in
+// parallel.  The edge functions and the depth test run on four pixels at a time in
+// SIMD registers.  Each covered pixel is shaded by its triangle's PixelShader, with
+// perspective-correct varyings.
+//
+// Each tile draws its triangles in submission order, so the image does not depend on
+// the thread count.  Coverage follows the top-left rule: a pixel on an edge shared by
+// two triangles is drawn once.
+//
+// Conventions are Direct3D's: clip z in [0, w], a LESS depth test against a buffer
+// cleared to 1, and clockwise triangles on screen face the viewer.
+//
+// Device independent: only the standard library, DirectXMath and TaskPool.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class TaskPool;
+
+class SoftwareRasterizer
+{
+public:
+	static const std::uint32_t TileSize = 64;
+	static const std::uint32_t MaxVaryings = 8;
+
+	struct ShadedVertex
+	{
+		DirectX::XMFLOAT4 PosH;
+		float Varyings[MaxVaryings];
+	};
+
+	// Called from the tile threads, so Shade must not modify shared state.
+	class PixelShader
+	{
+	public:
+		virtual ~PixelShader() = default;
+
+		// rgba is written in [0, 1]; values outside are clamped.
+		virtual void Shade(const float* varyings, float rgba[4])const = 0;
+	};
+
+	enum class CullMode
+	{
+		None,
+		Back
+	};
+
+	struct Stats
+	{
+		std::uint64_t TrianglesSubmitted = 0;
+		std::uint64_t TrianglesRasterized = 0;    // binned after clipping and culling
+		std::uint64_t TrianglesCulled = 0;        // back-facing, degenerate or off screen
+		std::uint64_t PixelsShaded = 0;
+		double ResolveSeconds = 0.0;
+		double FrameSeconds = 0.0;                // BeginFrame to the end of Resolve
+	};
+
+	SoftwareRasterizer() = default;
+	SoftwareRasterizer(const SoftwareRasterizer& rhs) = delete;
+	SoftwareRasterizer& operator=(const SoftwareRasterizer& rhs) = delete;
+
+	// Sizes and clears the targets and drops the binned triangles and the stats.
+	void BeginFrame(std::uint32_t width, std::uint32_t height, const float clearColor[4]);
+
+	// varyingCount <= MaxVaryings.  shader must live until Resolve returns.
+	void SubmitTriangle(const ShadedVertex& v0, const ShadedVertex& v1, const ShadedVertex& v2,
+		std::uint32_t varyingCount, const PixelShader* shader, CullMode cull);
+
+	// Draws every binned triangle.  Tiles are spread over pool when one is given.
+	void Resolve(TaskPool* pool);
+
+	std::uint32_t Width()const { return mWidth; }
+	std::uint32_t Height()const { return mHeight; }
+
+	// RGBA8 with red in the lowest byte, Pitch() pixels per row.
+	const std::uint32_t* Pixels()const { return mColor.data(); }
+	std::uint32_t Pitch()const { return mPitch; }
+
+	// Binary PPM (P6); alpha is dropped.
+	bool WritePpm(const std::string& path)const;
+
+	const Stats& GetStats()const { return mStats; }
+
+	// Includes triangles per second over the frame and over Resolve.
+	std::string StatsString()const;
+
+private:
+	struct Triangle
+	{
+		// Edge k is opposite vertex k: E(x, y) = A*x + B*y + C, positive inside.
+		float EdgeA[3];
+		float EdgeB[3];
+		float EdgeC[3];
+		bool TopLeft[3];
+
+		// Screen-space planes (a, b, c): value = a*x + b*y + c at a pixel center.
+		float Z[3];
+		float InvW[3];
+		float Varyings[MaxVaryings][3];    // varying / w
+		std::uint32_t VaryingCount;
+
+		const PixelShader* Shader;
+
+		// Pixel bounds, inclusive and inside the target.
+		std::int32_t MinX, MinY, MaxX, MaxY;
+	};
+
+	void SetupTriangle(const ShadedVertex* v[3], std::uint32_t varyingCount, const PixelShader* shader, CullMode cull);
+	void RasterizeTile(std::uint32_t tile);
+
+private:
+	std::uint32_t mWidth = 0;
+	std::uint32_t mHeight = 0;
+	std::uint32_t mPitch = 0;     // width rounded up to 4, so 4-wide loads stay in the row
+	std::uint32_t mTilesX = 0;
+	std::uint32_t mTilesY = 0;
+
+	std::vector<std::uint32_t> mColor;
+	std::vector<float> mDepth;
+
+	std::vector<Triangle> mTriangles;
+	std::vector<std::vector<std::uint32_t>> mBins;
+
+	Stats mStats;
+	std::atomic<std::uint64_t> mPixelsShaded{ 0 };
+	std::int64_t mFrameStart = 0;
+};
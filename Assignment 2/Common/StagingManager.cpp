@@ -0,0 +1,183 @@
+//***************************************************************************************
+// StagingManager.cpp
+//***************************************************************************************
+
+#include "StagingManager.h"
+#include "LinearArena.h"
+
+using Microsoft::WRL::ComPtr;
+
+StagingManager::StagingManager(ID3D12Device* device, UINT64 ringByteSize) :
+	md3dDevice(device),
+	mRing(ringByteSize)
+{
+	ThrowIfFailed(md3dDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(ringByteSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(mRingBuffer.GetAddressOf())));
+
+	// Upload heaps may stay mapped for their whole lifetime.
+	ThrowIfFailed(mRingBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mMappedRing)));
+}
+
+StagingManager::~StagingManager()
+{
+	if(mRingBuffer != nullptr)
+		mRingBuffer->Unmap(0, nullptr);
+
+	mMappedRing = nullptr;
+}
+
+void StagingManager::UploadBuffer(
+	ID3D12Resource* dest,
+	UINT64 destOffset,
+	const void* data,
+	UINT64 byteSize,
+	D3D12_RESOURCE_STATES destState)
+{
+	PendingCopy copy;
+	copy.Dest = dest;
+	copy.DestOffset = destOffset;
+	copy.ByteSize = byteSize;
+	copy.DestState = destState;
+
+	// Buffer copies only need 4-byte alignment, but keep it at 16 so the memcpy
+	// stays friendly.
+	UINT64 offset = mRing.Allocate(byteSize, 16);
+	if(offset != StagingRing::InvalidOffset)
+	{
+		memcpy(mMappedRing + offset, data, (size_t)byteSize);
+		copy.Src = mRingBuffer.Get();
+		copy.SrcOffset = offset;
+	}
+	else
+	{
+		// The ring is full (or the upload is bigger than the whole ring).  Fall back
+		// to a dedicated upload buffer that is released with the same fence.
+		ComPtr<ID3D12Resource> uploadBuffer;
+		ThrowIfFailed(md3dDevice->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(uploadBuffer.GetAddressOf())));
+
+		BYTE* mapped = nullptr;
+		ThrowIfFailed(uploadBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mapped)));
+		memcpy(mapped, data, (size_t)byteSize);
+		uploadBuffer->Unmap(0, nullptr);
+
+		copy.Src = uploadBuffer.Get();
+		copy.SrcOffset = 0;
+		DeferRelease(uploadBuffer);
+	}
+
+	mPendingCopies.push_back(copy);
+}
+
+void StagingManager::DeferRelease(ComPtr<ID3D12Resource> resource)
+{
+	if(resource == nullptr)
+		return;
+
+	// Upload heap resources are always buffers, so Width is the size in bytes.
+	DeferredResource deferred;
+	deferred.ByteSize = resource->GetDesc().Width;
+	deferred.Resource = std::move(resource);
+
+	mDeferredBytes += deferred.ByteSize;
+	mPeakDeferredBytes = MathHelper::Max(mPeakDeferredBytes, mDeferredBytes);
+
+	mUnsubmitted.push_back(std::move(deferred));
+}
+
+void StagingManager::Flush(ID3D12GraphicsCommandList* cmdList)
+{
+	if(mPendingCopies.empty())
+		return;
+
+	// One transition per destination resource, all submitted in a single call.
+	ScratchScope scratch;
+	ArenaVector<D3D12_RESOURCE_BARRIER> toCopyDest(ArenaAllocator<D3D12_RESOURCE_BARRIER>(scratch.Arena()));
+	ArenaVector<D3D12_RESOURCE_BARRIER> toDestState(ArenaAllocator<D3D12_RESOURCE_BARRIER>(scratch.Arena()));
+	toCopyDest.reserve(mPendingCopies.size());
+	toDestState.reserve(mPendingCopies.size());
+	for(auto& copy : mPendingCopies)
+	{
+		bool seen = false;
+		for(auto& b : toCopyDest)
+			seen = seen || b.Transition.pResource == copy.Dest;
+		if(seen)
+			continue;
+
+		toCopyDest.push_back(CD3DX12_RESOURCE_BARRIER::Transition(copy.Dest,
+			copy.DestState, D3D12_RESOURCE_STATE_COPY_DEST));
+		toDestState.push_back(CD3DX12_RESOURCE_BARRIER::Transition(copy.Dest,
+			D3D12_RESOURCE_STATE_COPY_DEST, copy.DestState));
+	}
+
+	cmdList->ResourceBarrier((UINT)toCopyDest.size(), toCopyDest.data());
+
+	for(auto& copy : mPendingCopies)
+		cmdList->CopyBufferRegion(copy.Dest, copy.DestOffset, copy.Src, copy.SrcOffset, copy.ByteSize);
+
+	cmdList->ResourceBarrier((UINT)toDestState.size(), toDestState.data());
+
+	mCopiesRecorded += mPendingCopies.size();
+	mBatchesRecorded++;
+	mPendingCopies.clear();
+}
+
+void StagingManager::Submit(UINT64 fenceValue)
+{
+	assert(mPendingCopies.empty() && "Flush the staged copies before submitting them.");
+
+	mRing.Submit(fenceValue);
+
+	for(auto& deferred : mUnsubmitted)
+	{
+		deferred.Fence = fenceValue;
+		mDeferred.push_back(std::move(deferred));
+	}
+	mUnsubmitted.clear();
+}
+
+void StagingManager::Retire(UINT64 completedFenceValue)
+{
+	mRing.Retire(completedFenceValue);
+
+	while(!mDeferred.empty() && mDeferred.front().Fence <= completedFenceValue)
+	{
+		mDeferredBytes -= mDeferred.front().ByteSize;
+		mDeferred.pop_front();
+	}
+}
+
+StagingManager::Stats StagingManager::GetStats()const
+{
+	Stats stats;
+	stats.Ring = mRing.GetStats();
+	stats.DeferredBytes = mDeferredBytes;
+	stats.PeakDeferredBytes = mPeakDeferredBytes;
+	stats.CopiesRecorded = mCopiesRecorded;
+	stats.BatchesRecorded = mBatchesRecorded;
+
+	return stats;
+}
+
+std::wstring StagingManager::StatsString()const
+{
+	Stats stats = GetStats();
+
+	return L"StagingManager: ring " + std::to_wstring(stats.Ring.Capacity / 1024) + L" KB, peak " +
+		std::to_wstring(stats.Ring.PeakUsedBytes / 1024) + L" KB, in use " +
+		std::to_wstring(stats.Ring.UsedBytes / 1024) + L" KB; deferred peak " +
+		std::to_wstring(stats.PeakDeferredBytes / 1024) + L" KB, in use " +
+		std::to_wstring(stats.DeferredBytes / 1024) + L" KB; " +
+		std::to_wstring(stats.CopiesRecorded) + L" copies in " +
+		std::to_wstring(stats.BatchesRecorded) + L" batches\n";
+}
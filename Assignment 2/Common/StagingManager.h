@@ -0,0 +1,98 @@
+//***************************************************************************************
+// StagingManager.h
+//
+// Owns one persistently mapped upload buffer carved up by a StagingRing.  Uploads are
+// queued with UploadBuffer() and recorded in one batch by Flush(), with a single
+// barrier call on each side of the copies.  Once the fence passed to Submit() has
+// completed, Retire() recycles the ring space and drops any transient upload
+// resources handed over with DeferRelease() (e.g. texture upload heaps).
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "StagingRing.h"
+#include <deque>
+
+class StagingManager
+{
+public:
+	struct Stats
+	{
+		StagingRing::Stats Ring;
+
+		// Upload resources outside the ring (oversized uploads and DeferRelease'd
+		// heaps) that are still waiting for their fence.
+		UINT64 DeferredBytes = 0;
+		UINT64 PeakDeferredBytes = 0;
+
+		UINT64 CopiesRecorded = 0;
+		UINT64 BatchesRecorded = 0;
+	};
+
+	StagingManager(ID3D12Device* device, UINT64 ringByteSize = 32 * 1024 * 1024);
+	StagingManager(const StagingManager& rhs) = delete;
+	StagingManager& operator=(const StagingManager& rhs) = delete;
+	~StagingManager();
+
+	// Copies the data into staging memory now and queues a GPU copy into dest.
+	// dest must be in destState; it is returned to destState after the copy.
+	void UploadBuffer(
+		ID3D12Resource* dest,
+		UINT64 destOffset,
+		const void* data,
+		UINT64 byteSize,
+		D3D12_RESOURCE_STATES destState = D3D12_RESOURCE_STATE_GENERIC_READ);
+
+	// Keeps a transient upload resource alive until the next Submit()'s fence completes.
+	void DeferRelease(Microsoft::WRL::ComPtr<ID3D12Resource> resource);
+
+	// Records every queued copy into cmdList.
+	void Flush(ID3D12GraphicsCommandList* cmdList);
+
+	// Associates everything flushed since the last Submit with fenceValue.  Call
+	// after the command list has been executed and the fence signal queued.
+	void Submit(UINT64 fenceValue);
+
+	// Recycles staging space and releases deferred resources up to completedFenceValue.
+	void Retire(UINT64 completedFenceValue);
+
+	Stats GetStats()const;
+	std::wstring StatsString()const;
+
+private:
+	struct PendingCopy
+	{
+		ID3D12Resource* Dest = nullptr;
+		UINT64 DestOffset = 0;
+		ID3D12Resource* Src = nullptr;
+		UINT64 SrcOffset = 0;
+		UINT64 ByteSize = 0;
+		D3D12_RESOURCE_STATES DestState = D3D12_RESOURCE_STATE_COMMON;
+	};
+
+	struct DeferredResource
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		UINT64 ByteSize = 0;
+		UINT64 Fence = 0;
+	};
+
+private:
+	ID3D12Device* md3dDevice = nullptr;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> mRingBuffer;
+	BYTE* mMappedRing = nullptr;
+	StagingRing mRing;
+
+	std::vector<PendingCopy> mPendingCopies;
+
+	// Deferred resources not yet tagged with a fence, then the ones in flight.
+	std::vector<DeferredResource> mUnsubmitted;
+	std::deque<DeferredResource> mDeferred;
+
+	UINT64 mDeferredBytes = 0;
+	UINT64 mPeakDeferredBytes = 0;
+	UINT64 mCopiesRecorded = 0;
+	UINT64 mBatchesRecorded = 0;
+};
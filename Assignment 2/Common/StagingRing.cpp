@@ -0,0 +1,116 @@
+//***************************************************************************************
+// StagingRing.cpp
+//***************************************************************************************
+
+#include "StagingRing.h"
+#include <cassert>
+
+StagingRing::StagingRing(std::uint64_t capacity) :
+	mCapacity(capacity)
+{
+	assert(capacity > 0);
+}
+
+void StagingRing::Reserve(std::uint64_t bytes)
+{
+	mUsedBytes += bytes;
+	mPendingBytes += bytes;
+
+	if(mUsedBytes > mPeakUsedBytes)
+		mPeakUsedBytes = mUsedBytes;
+}
+
+std::uint64_t StagingRing::Allocate(std::uint64_t size, std::uint64_t alignment)
+{
+	if(alignment == 0)
+		alignment = 1;
+
+	if(size == 0 || size > mCapacity)
+		return InvalidOffset;
+
+	// Head caught up with tail while holding data: the ring is full.
+	if(mUsedBytes == mCapacity)
+		return InvalidOffset;
+
+	// Nothing live, so start again from the front to get the largest contiguous run.
+	if(mUsedBytes == 0)
+		mHead = mTail = 0;
+
+	std::uint64_t offset = (mHead + alignment - 1) / alignment * alignment;
+
+	if(mHead >= mTail)
+	{
+		// Free space is [mHead, mCapacity) followed by [0, mTail).
+		if(offset + size <= mCapacity)
+		{
+			Reserve(offset - mHead + size);
+		}
+		else
+		{
+			// Skip the rest of the buffer and wrap to the front; the skipped bytes
+			// belong to this span and are returned when it retires.
+			if(size > mTail)
+				return InvalidOffset;
+
+			Reserve(mCapacity - mHead + size);
+			offset = 0;
+		}
+	}
+	else
+	{
+		// Free space is [mHead, mTail).
+		if(offset + size > mTail)
+			return InvalidOffset;
+
+		Reserve(offset - mHead + size);
+	}
+
+	mHead = offset + size;
+	if(mHead == mCapacity)
+		mHead = 0;
+
+	mTotalAllocatedBytes += size;
+
+	return offset;
+}
+
+void StagingRing::Submit(std::uint64_t fenceValue)
+{
+	if(mPendingBytes == 0)
+		return;
+
+	assert(mInFlight.empty() || mInFlight.back().Fence <= fenceValue);
+
+	Span span;
+	span.End = mHead;
+	span.Bytes = mPendingBytes;
+	span.Fence = fenceValue;
+	mInFlight.push_back(span);
+
+	mPendingBytes = 0;
+}
+
+void StagingRing::Retire(std::uint64_t completedFenceValue)
+{
+	while(!mInFlight.empty() && mInFlight.front().Fence <= completedFenceValue)
+	{
+		const Span& span = mInFlight.front();
+		mTail = span.End;
+		mUsedBytes -= span.Bytes;
+		mLastRetiredFence = span.Fence;
+		mInFlight.pop_front();
+	}
+}
+
+StagingRing::Stats StagingRing::GetStats()const
+{
+	Stats stats;
+	stats.Capacity = mCapacity;
+	stats.UsedBytes = mUsedBytes;
+	stats.PeakUsedBytes = mPeakUsedBytes;
+	stats.TotalAllocatedBytes = mTotalAllocatedBytes;
+	stats.SpansInFlight = (std::uint32_t)mInFlight.size();
+	stats.LastRetiredFence = mLastRetiredFence;
+
+	return stats;
+}
@@ -0,0 +1,82 @@
+//***************************************************************************************
+// StagingRing.h
+//
+// Ring allocator for upload (staging) memory whose lifetime is tied to GPU fences.
+// Allocations made between two Submit() calls form one span tagged with the fence
+// value passed to Submit; Retire() frees every span whose fence has completed.
+// Only offsets and fence values are handled here, so it is device-independent and
+// can be driven by a fake fence.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+class StagingRing
+{
+public:
+	static const std::uint64_t InvalidOffset = ~0ull;
+
+	struct Stats
+	{
+		std::uint64_t Capacity = 0;
+
+		// Bytes currently reserved (pending + in flight), including alignment padding
+		// and the tail skipped when an allocation wraps.
+		std::uint64_t UsedBytes = 0;
+		std::uint64_t PeakUsedBytes = 0;
+
+		// Bytes handed out since construction.
+		std::uint64_t TotalAllocatedBytes = 0;
+
+		std::uint32_t SpansInFlight = 0;
+		std::uint64_t LastRetiredFence = 0;
+	};
+
+	explicit StagingRing(std::uint64_t capacity);
+	StagingRing(const StagingRing& rhs) = delete;
+	StagingRing& operator=(const StagingRing& rhs) = delete;
+
+	// Returns InvalidOffset if the ring cannot currently fit the request.  The
+	// caller can Retire() with a newer fence value and try again.
+	std::uint64_t Allocate(std::uint64_t size, std::uint64_t alignment = 1);
+
+	// Tags everything allocated since the last Submit with fenceValue.  Fence values
+	// must not decrease between calls.
+	void Submit(std::uint64_t fenceValue);
+
+	// Frees all submitted spans whose fence value is <= completedFenceValue.
+	void Retire(std::uint64_t completedFenceValue);
+
+	bool HasPending()const { return mPendingBytes > 0; }
+	std::uint64_t Capacity()const { return mCapacity; }
+
+	Stats GetStats()const;
+
+private:
+	void Reserve(std::uint64_t bytes);
+
+private:
+	struct Span
+	{
+		std::uint64_t End = 0;
+		std::uint64_t Bytes = 0;
+		std::uint64_t Fence = 0;
+	};
+
+	std::uint64_t mCapacity = 0;
+
+	// Allocations are made at mHead; mTail is the start of the oldest live span.
+	// Both are kept in [0, mCapacity), with mUsedBytes telling empty from full.
+	std::uint64_t mHead = 0;
+	std::uint64_t mTail = 0;
+	std::uint64_t mUsedBytes = 0;
+	std::uint64_t mPendingBytes = 0;
+
+	std::deque<Span> mInFlight;
+
+	std::uint64_t mPeakUsedBytes = 0;
+	std::uint64_t mTotalAllocatedBytes = 0;
+	std::uint64_t mLastRetiredFence = 0;
+};
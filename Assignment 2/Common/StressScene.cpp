@@ -0,0 +1,237 @@
+//***************************************************************************************
+// StressScene.cpp
+//***************************************************************************************
+
+#include "StressScene.h"
+#include "LinearArena.h"
+#include "MathHelper.h"
+#include "Random.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	// Maze walls are one cell long; Instanced copies sit one spacing apart.
+	const float MazeCell = 10.0f;
+	const float MazeWallHeight = 8.0f;
+	const float InstanceSpacing = 4.0f;
+	const std::uint32_t PrototypeCount = 16;
+
+	// Scale that gives a mesh of the given half-extent the size along one axis.
+	float Fit(float size, float extent)
+	{
+		return extent > 0.0f ? size / (2.0f * extent) : size;
+	}
+
+	struct Prototype
+	{
+		std::uint32_t Mesh = 0;
+		std::uint32_t Material = 0;
+		float Yaw = 0.0f;
+		float Scale = 1.0f;
+	};
+
+	// Item i's scale, rotation (about y) and translation into the SoA arrays.
+	struct ItemArrays
+	{
+		MathHelper::Float3Arrays Scale;
+		MathHelper::Float4Arrays Rotation;
+		MathHelper::Float3Arrays Translation;
+
+		void Set(std::uint32_t i, float sx, float sy, float sz, float yaw, float tx, float ty, float tz)
+		{
+			Scale.X[i] = sx;
+			Scale.Y[i] = sy;
+			Scale.Z[i] = sz;
+			Rotation.X[i] = 0.0f;
+			Rotation.Y[i] = std::sin(0.5f * yaw);
+			Rotation.Z[i] = 0.0f;
+			Rotation.W[i] = std::cos(0.5f * yaw);
+			Translation.X[i] = tx;
+			Translation.Y[i] = ty;
+			Translation.Z[i] = tz;
+		}
+	};
+}
+
+void GenerateStressScene(const StressSceneDesc& desc, StressScene& scene)
+{
+	assert(!desc.MeshBounds.empty() && desc.MaterialCount > 0);
+
+	const std::uint32_t count = desc.ItemCount;
+	const std::uint32_t meshCount = (std::uint32_t)desc.MeshBounds.size();
+	const std::uint32_t clusterCount = std::max<std::uint32_t>(desc.ClusterCount, 1);
+
+	scene.Worlds.resize(count);
+	scene.WorldBounds.resize(count);
+	scene.Meshes.resize(count);
+	scene.Materials.resize(count);
+
+	Pcg32 rng(desc.Seed);
+
+	// Clusters roughly tile the world; centers stay a radius away from its edges.
+	const float half = 0.5f * desc.WorldSize;
+	const float radius = half / std::sqrt((float)clusterCount);
+	std::vector<XMFLOAT2> clusters(clusterCount);
+	for(XMFLOAT2& c : clusters)
+		c = XMFLOAT2(rng.NextFloat(radius - half, half - radius), rng.NextFloat(radius - half, half - radius));
+
+	Prototype prototypes[PrototypeCount];
+	for(Prototype& p : prototypes)
+	{
+		p.Mesh = rng.NextBounded(meshCount);
+		p.Material = rng.NextBounded(desc.MaterialCount);
+		p.Yaw = rng.NextFloat(0.0f, 2.0f * MathHelper::Pi);
+		p.Scale = rng.NextFloat(0.5f, 2.0f);
+	}
+
+	const int mazeCells = std::max(1, (int)(radius / MazeCell));
+	const int instanceCells = std::max(1, (int)(radius / InstanceSpacing));
+	const XMFLOAT3& wallExtents = desc.MeshBounds[0].Extents;
+
+	std::vector<float> soa((std::size_t)count * 10);
+	ItemArrays items;
+	float* p = soa.data();
+	items.Scale.X = p; p += count;
+	items.Scale.Y = p; p += count;
+	items.Scale.Z = p; p += count;
+	items.Rotation.X = p; p += count;
+	items.Rotation.Y = p; p += count;
+	items.Rotation.Z = p; p += count;
+	items.Rotation.W = p; p += count;
+	items.Translation.X = p; p += count;
+	items.Translation.Y = p; p += count;
+	items.Translation.Z = p;
+
+	for(std::uint32_t i = 0; i < count; ++i)
+	{
+		const StressLayout layout = desc.Layout == StressLayout::Mixed ? (StressLayout)(i % 3) : desc.Layout;
+		const std::uint32_t cluster = rng.NextBounded(clusterCount);
+		const XMFLOAT2& center = clusters[cluster];
+
+		switch(layout)
+		{
+		case StressLayout::Maze:
+		{
+			// One material per block, so a block's walls batch together.
+			scene.Meshes[i] = 0;
+			scene.Materials[i] = cluster % desc.MaterialCount;
+
+			const float x = center.x + MazeCell * rng.NextInt(-mazeCells, mazeCells);
+			const float z = center.y + MazeCell * rng.NextInt(-mazeCells, mazeCells);
+			const bool alongX = (rng.Next() & 1) != 0;
+			items.Set(i,
+				Fit(alongX ? MazeCell : 1.0f, wallExtents.x),
+				Fit(MazeWallHeight, wallExtents.y),
+				Fit(alongX ? 1.0f : MazeCell, wallExtents.z),
+				0.0f, x, 0.5f * MazeWallHeight, z);
+			break;
+		}
+		case StressLayout::Forest:
+		{
+			scene.Meshes[i] = rng.NextBounded(meshCount);
+			scene.Materials[i] = rng.NextBounded(desc.MaterialCount);
+
+			// Summing two uniforms bunches items toward the middle of the clump.
+			const float x = center.x + radius * (rng.NextFloat() + rng.NextFloat() - 1.0f);
+			const float z = center.y + radius * (rng.NextFloat() + rng.NextFloat() - 1.0f);
+			const float scale = rng.NextFloat(0.5f, 3.0f);
+			const BoundingBox& local = desc.MeshBounds[scene.Meshes[i]];
+			items.Set(i, scale, scale, scale, rng.NextFloat(0.0f, 2.0f * MathHelper::Pi),
+				x, scale * (local.Extents.y - local.Center.y), z);
+			break;
+		}
+		default:
+		{
+			const Prototype& proto = prototypes[i % PrototypeCount];
+			scene.Meshes[i] = proto.Mesh;
+			scene.Materials[i] = proto.Material;
+
+			const float x = center.x + InstanceSpacing * rng.NextInt(-instanceCells, instanceCells);
+			const float z = center.y + InstanceSpacing * rng.NextInt(-instanceCells, instanceCells);
+			const BoundingBox& local = desc.MeshBounds[proto.Mesh];
+			items.Set(i, proto.Scale, proto.Scale, proto.Scale, proto.Yaw,
+				x, proto.Scale * (local.Extents.y - local.Center.y), z);
+			break;
+		}
+		}
+	}
+
+	MathHelper::BuildTrsMatrices(items.Scale, items.Rotation, items.Translation, scene.Worlds.data(), count);
+
+	std::vector<BoundingBox> localBounds(count);
+	for(std::uint32_t i = 0; i < count; ++i)
+		localBounds[i] = desc.MeshBounds[scene.Meshes[i]];
+	MathHelper::TransformAabbs(localBounds.data(), scene.Worlds.data(), scene.WorldBounds.data(), count);
+}
+
+bool ParseStressLayout(const char* name, StressLayout& layout)
+{
+	const struct { const char* Name; StressLayout Layout; } layouts[] =
+	{
+		{ "maze", StressLayout::Maze },
+		{ "forest", StressLayout::Forest },
+		{ "instanced", StressLayout::Instanced },
+		{ "mixed", StressLayout::Mixed },
+	};
+
+	for(const auto& e : layouts)
+	{
+		if(std::strcmp(name, e.Name) == 0)
+		{
+			layout = e.Layout;
+			return true;
+		}
+	}
+	return false;
+}
+
+void StressSceneUpdateConstants(const StressScene& scene, XMFLOAT4X4* out)
+{
+	MathHelper::TransposeMatrices(scene.Worlds.data(), out, scene.Worlds.size());
+}
+
+std::uint32_t StressSceneCull(const StressScene& scene, const BoundingFrustum& frustum, std::uint32_t* visible)
+{
+	std::uint32_t visibleCount = 0;
+	for(std::uint32_t i = 0; i < scene.ItemCount(); ++i)
+	{
+		if(frustum.Intersects(scene.WorldBounds[i]))
+			visible[visibleCount++] = i;
+	}
+	return visibleCount;
+}
+
+void StressSceneSort(const StressScene& scene, std::uint32_t* items, std::uint32_t count)
+{
+	// Material in the top 24 bits, mesh in the next 8, item index in the low 32.
+	ScratchScope scratch;
+	std::uint64_t* keys = scratch.Arena().AllocateArray<std::uint64_t>(count);
+	for(std::uint32_t i = 0; i < count; ++i)
+	{
+		const std::uint32_t item = items[i];
+		assert(scene.Materials[item] < (1u << 24) && scene.Meshes[item] < (1u << 8));
+		keys[i] = ((std::uint64_t)scene.Materials[item] << 40) | ((std::uint64_t)scene.Meshes[item] << 32) | item;
+	}
+
+	std::sort(keys, keys + count);
+
+	for(std::uint32_t i = 0; i < count; ++i)
+		items[i] = (std::uint32_t)keys[i];
+}
+
+std::uint32_t StressSceneCollide(const StressScene& scene, FXMVECTOR origin, FXMVECTOR direction, float maxDistance)
+{
+	std::uint32_t hits = 0;
+	for(const BoundingBox& bounds : scene.WorldBounds)
+	{
+		float distance = 0.0f;
+		if(bounds.Intersects(origin, direction, distance) && distance <= maxDistance)
+			hits++;
+	}
+	return hits;
+}
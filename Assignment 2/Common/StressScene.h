@@ -0,0 +1,82 @@
+//***************************************************************************************
+// StressScene.h
+//
+// Synthetic scenes for scaling tests.  GenerateStressScene places any number of items
+// in one of these layouts:
+//
+//   Maze       axis-aligned walls on a grid, in clustered blocks like the demo's maze;
+//   Forest     items in clumps with random yaw and scale, any mesh and material;
+//   Instanced  a few prototypes repeated over a grid, so most items share their mesh,
+//              material, rotation and scale;
+//   Mixed      the three layouts interleaved.
+//
+// Items refer to meshes and materials by index.  The caller gives each mesh's local
+// bounds (Maze uses mesh 0, so put a box first) and the number of materials.  The
+// scene is a pure function of the description.
+//
+// The StressScene* stage functions do a frame's per-item CPU work over the whole
+// scene the way the renderer does it, so each stage can be timed against item count
+// without a device.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <cstdint>
+#include <vector>
+
+enum class StressLayout
+{
+	Maze,
+	Forest,
+	Instanced,
+	Mixed
+};
+
+struct StressSceneDesc
+{
+	std::uint32_t ItemCount = 10000;
+	StressLayout Layout = StressLayout::Mixed;
+
+	// Local bounds of each mesh; at least one.
+	std::vector<DirectX::BoundingBox> MeshBounds;
+	std::uint32_t MaterialCount = 1;
+
+	// Items lie in [-WorldSize/2, WorldSize/2] on x and z, around ClusterCount centers.
+	float WorldSize = 2000.0f;
+	std::uint32_t ClusterCount = 64;
+
+	std::uint64_t Seed = 1;
+};
+
+struct StressScene
+{
+	std::vector<DirectX::XMFLOAT4X4> Worlds;
+	std::vector<DirectX::BoundingBox> WorldBounds;
+	std::vector<std::uint32_t> Meshes;
+	std::vector<std::uint32_t> Materials;
+
+	std::uint32_t ItemCount()const { return (std::uint32_t)Worlds.size(); }
+};
+
+void GenerateStressScene(const StressSceneDesc& desc, StressScene& scene);
+
+// Whether name is "maze", "forest", "instanced" or "mixed"; sets layout if so.
+bool ParseStressLayout(const char* name, StressLayout& layout);
+
+// Every item's transposed world matrix into out, as UpdateObjectBuffer does for dirty
+// items.
+void StressSceneUpdateConstants(const StressScene& scene, DirectX::XMFLOAT4X4* out);
+
+// Writes the indices of the items whose world bounds intersect frustum to visible and
+// returns how many there are.
+std::uint32_t StressSceneCull(const StressScene& scene, const DirectX::BoundingFrustum& frustum, std::uint32_t* visible);
+
+// Sorts item indices by material, then mesh, then index: the order that keeps state
+// changes between draws to a minimum.
+void StressSceneSort(const StressScene& scene, std::uint32_t* items, std::uint32_t count);
+
+// Number of items whose world bounds a ray hits within maxDistance, as SimpleCollision
+// tests the camera's look ray against every item.
+std::uint32_t StressSceneCollide(const StressScene& scene, DirectX::FXMVECTOR origin, DirectX::FXMVECTOR direction, float maxDistance);
@@ -0,0 +1,239 @@
+//***************************************************************************************
+// TaskGraph.cpp
+//***************************************************************************************
+
+#include "TaskGraph.h"
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <stdexcept>
+
+namespace
+{
+	// Kahn's algorithm over the dependents lists; false if the graph has a cycle.
+	template<typename TaskInfo>
+	bool TopologicalOrder(const std::vector<TaskInfo>& tasks, std::vector<std::uint32_t>& order)
+	{
+		std::vector<std::uint32_t> pending(tasks.size());
+		order.clear();
+		for(std::uint32_t i = 0; i < tasks.size(); ++i)
+		{
+			pending[i] = tasks[i].DependencyCount;
+			if(pending[i] == 0)
+				order.push_back(i);
+		}
+
+		for(std::size_t i = 0; i < order.size(); ++i)
+		{
+			for(std::uint32_t dependent : tasks[order[i]].Dependents)
+			{
+				if(--pending[dependent] == 0)
+					order.push_back(dependent);
+			}
+		}
+
+		return order.size() == tasks.size();
+	}
+}
+
+TaskGraph::Task TaskGraph::AddTask(const std::string& name, const TaskCallback& fn, Affinity affinity)
+{
+	TaskInfo info;
+	info.Name = name;
+	info.Fn = fn;
+	info.TaskAffinity = affinity;
+	mTasks.push_back(info);
+
+	return (Task)mTasks.size() - 1;
+}
+
+void TaskGraph::AddDependency(Task task, Task dependency)
+{
+	assert(task < mTasks.size() && dependency < mTasks.size() && task != dependency);
+
+	mTasks[dependency].Dependents.push_back(task);
+	mTasks[task].DependencyCount++;
+}
+
+void TaskGraph::Run(TaskPool& pool)
+{
+	std::vector<Task> order;
+	if(!TopologicalOrder(mTasks, order))
+		throw std::logic_error("TaskGraph has a dependency cycle.");
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<Task> anyReady;
+	std::deque<Task> mainReady;
+	std::uint32_t remaining = (std::uint32_t)mTasks.size();
+	std::exception_ptr error;
+
+	for(Task t = 0; t < mTasks.size(); ++t)
+	{
+		mTasks[t].PendingDependencies = mTasks[t].DependencyCount;
+		if(mTasks[t].DependencyCount == 0)
+			(mTasks[t].TaskAffinity == MainThread ? mainReady : anyReady).push_back(t);
+	}
+
+	using Clock = std::chrono::steady_clock;
+	const Clock::time_point start = Clock::now();
+	auto nowMs = [&]() { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+
+	// Runs one task with the lock released, then releases its dependents.
+	auto runTask = [&](Task t, std::uint32_t thread, std::unique_lock<std::mutex>& lock)
+	{
+		lock.unlock();
+
+		TaskInfo& task = mTasks[t];
+		task.Thread = thread;
+		task.StartMs = nowMs();
+		std::exception_ptr taskError;
+		try
+		{
+			task.Fn();
+		}
+		catch(...)
+		{
+			taskError = std::current_exception();
+		}
+		task.EndMs = nowMs();
+
+		lock.lock();
+		remaining--;
+		if(taskError && !error)
+			error = taskError;
+
+		for(Task dependent : task.Dependents)
+		{
+			if(--mTasks[dependent].PendingDependencies == 0)
+				(mTasks[dependent].TaskAffinity == MainThread ? mainReady : anyReady).push_back(dependent);
+		}
+		wake.notify_all();
+	};
+
+	auto workerLoop = [&](std::uint32_t, std::uint32_t thread)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		for(;;)
+		{
+			wake.wait(lock, [&]() { return error || remaining == 0 || !anyReady.empty(); });
+			if(error || remaining == 0)
+				return;
+
+			Task t = anyReady.front();
+			anyReady.pop_front();
+			runTask(t, thread, lock);
+		}
+	};
+
+	if(pool.WorkerCount() > 0)
+		pool.Dispatch(pool.WorkerCount(), workerLoop);
+
+	// The calling thread runs the main-thread tasks and helps with the others meanwhile.
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		for(;;)
+		{
+			wake.wait(lock, [&]() { return error || remaining == 0 || !mainReady.empty() || !anyReady.empty(); });
+			if(error || remaining == 0)
+				break;
+
+			std::deque<Task>& queue = !mainReady.empty() ? mainReady : anyReady;
+			Task t = queue.front();
+			queue.pop_front();
+			runTask(t, 0, lock);
+		}
+	}
+
+	if(pool.WorkerCount() > 0)
+		pool.Wait();
+	mWallMs = nowMs();
+
+	if(error)
+		std::rethrow_exception(error);
+}
+
+void TaskGraph::ComputeCriticalPath(std::vector<double>& finishMs, std::vector<Task>& previous)const
+{
+	std::vector<Task> order;
+	TopologicalOrder(mTasks, order);
+
+	finishMs.assign(mTasks.size(), 0.0);
+	previous.assign(mTasks.size(), (Task)-1);
+
+	// Visiting in topological order, every task's chain is final before its dependents.
+	std::vector<double> startMs(mTasks.size(), 0.0);
+	for(Task t : order)
+	{
+		finishMs[t] = startMs[t] + (mTasks[t].EndMs - mTasks[t].StartMs);
+		for(Task dependent : mTasks[t].Dependents)
+		{
+			if(finishMs[t] > startMs[dependent] || previous[dependent] == (Task)-1)
+			{
+				startMs[dependent] = finishMs[t];
+				previous[dependent] = t;
+			}
+		}
+	}
+}
+
+double TaskGraph::CriticalPathMs()const
+{
+	std::vector<double> finishMs;
+	std::vector<Task> previous;
+	ComputeCriticalPath(finishMs, previous);
+
+	double longest = 0.0;
+	for(double ms : finishMs)
+		longest = ms > longest ? ms : longest;
+	return longest;
+}
+
+std::string TaskGraph::Report()const
+{
+	std::vector<double> finishMs;
+	std::vector<Task> previous;
+	ComputeCriticalPath(finishMs, previous);
+
+	double serialMs = 0.0;
+	Task last = 0;
+	for(Task t = 0; t < mTasks.size(); ++t)
+	{
+		serialMs += mTasks[t].EndMs - mTasks[t].StartMs;
+		if(finishMs[t] > finishMs[last])
+			last = t;
+	}
+
+	char line[256];
+	std::snprintf(line, sizeof(line), "Task graph: %u tasks, wall %.1f ms, serial %.1f ms, critical path %.1f ms\n",
+		(unsigned)mTasks.size(), mWallMs, serialMs, mTasks.empty() ? 0.0 : finishMs[last]);
+	std::string report = line;
+
+	report += "     start  duration  thread  task\n";
+	for(const TaskInfo& task : mTasks)
+	{
+		std::snprintf(line, sizeof(line), "  %8.1f  %8.1f  %6u  %s\n",
+			task.StartMs, task.EndMs - task.StartMs, task.Thread, task.Name.c_str());
+		report += line;
+	}
+
+	if(mTasks.empty())
+		return report;
+
+	// Walk the chain back from the task that finishes last.
+	std::vector<Task> path;
+	for(Task t = last; t != (Task)-1; t = previous[t])
+		path.push_back(t);
+
+	report += "  Critical path:";
+	for(auto it = path.rbegin(); it != path.rend(); ++it)
+	{
+		std::snprintf(line, sizeof(line), "%s %s (%.1f)", it == path.rbegin() ? "" : " ->",
+			mTasks[*it].Name.c_str(), mTasks[*it].EndMs - mTasks[*it].StartMs);
+		report += line;
+	}
+	report += "\n";
+
+	return report;
+}
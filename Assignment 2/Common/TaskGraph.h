@@ -0,0 +1,68 @@
+//***************************************************************************************
+// TaskGraph.h
+//
+// One-shot dependency graph of named tasks, run on a TaskPool.  Tasks that must stay on
+// the calling thread (anything recording into its command list, say) are marked
+// MainThread; the caller runs those and helps with the rest while the workers take
+// the other ready tasks.  Every task is timed, and Report lists the timeline and the
+// critical path: the dependency chain that bounded the wall time.
+//***************************************************************************************
+
+#pragma once
+
+#include "TaskPool.h"
+#include <string>
+
+class TaskGraph
+{
+public:
+	using Task = std::uint32_t;
+	using TaskCallback = std::function<void()>;
+
+	enum Affinity
+	{
+		AnyThread,
+		MainThread
+	};
+
+	TaskGraph() = default;
+	TaskGraph(const TaskGraph& rhs) = delete;
+	TaskGraph& operator=(const TaskGraph& rhs) = delete;
+
+	Task AddTask(const std::string& name, const TaskCallback& fn, Affinity affinity = AnyThread);
+
+	// task may not start before dependency has finished.
+	void AddDependency(Task task, Task dependency);
+
+	// Runs every task once and returns when all have finished.  The first exception
+	// thrown by a task stops new tasks from starting and is rethrown here.
+	void Run(TaskPool& pool);
+
+	double WallMs()const { return mWallMs; }
+	double CriticalPathMs()const;
+
+	std::string Report()const;
+
+private:
+	struct TaskInfo
+	{
+		std::string Name;
+		TaskCallback Fn;
+		Affinity TaskAffinity = AnyThread;
+		std::vector<Task> Dependents;
+		std::uint32_t DependencyCount = 0;
+
+		// Filled in by Run.
+		std::uint32_t PendingDependencies = 0;
+		double StartMs = 0.0;
+		double EndMs = 0.0;
+		std::uint32_t Thread = 0;
+	};
+
+	// Longest chain ending at each task, by measured duration, and the predecessor on it.
+	void ComputeCriticalPath(std::vector<double>& finishMs, std::vector<Task>& previous)const;
+
+private:
+	std::vector<TaskInfo> mTasks;
+	double mWallMs = 0.0;
+};
@@ -0,0 +1,143 @@
+//***************************************************************************************
+// TaskPool.cpp
+//***************************************************************************************
+
+#include "TaskPool.h"
+
+TaskPool::TaskPool(std::uint32_t workerCount)
+{
+	for(std::uint32_t i = 0; i < workerCount; ++i)
+		mWorkers.emplace_back(&TaskPool::WorkerMain, this, i + 1);
+}
+
+TaskPool::~TaskPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQuit = true;
+	}
+	mWake.notify_all();
+
+	for(auto& worker : mWorkers)
+		worker.join();
+}
+
+std::uint32_t TaskPool::DefaultWorkerCount()
+{
+	std::uint32_t hardware = std::thread::hardware_concurrency();
+	return hardware > 1 ? hardware - 1 : 0;
+}
+
+void TaskPool::ParallelFor(std::uint32_t count, const TaskCallback& fn)
+{
+	if(count == 0)
+		return;
+
+	if(mWorkers.empty() || count == 1)
+	{
+		for(std::uint32_t i = 0; i < count; ++i)
+			fn(i, 0);
+		return;
+	}
+
+	// fn outlives the job here, so the workers can call it in place instead of a copy.
+	Start(count, &fn);
+	RunIndices(0);
+	Wait();
+}
+
+void TaskPool::Dispatch(std::uint32_t count, const TaskCallback& fn)
+{
+	if(mWorkers.empty())
+	{
+		for(std::uint32_t i = 0; i < count; ++i)
+			fn(i, 0);
+		return;
+	}
+
+	mDispatchedTask = fn;
+	Start(count, &mDispatchedTask);
+}
+
+void TaskPool::Start(std::uint32_t count, const TaskCallback* fn)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mError = nullptr;
+		mTask = fn;
+		mCount = count;
+		mNext.store(0, std::memory_order_relaxed);
+		mBusyWorkers = (std::uint32_t)mWorkers.size();
+		mGeneration++;
+	}
+	mWake.notify_all();
+}
+
+void TaskPool::Wait()
+{
+	std::exception_ptr error;
+	{
+		// Workers may still be finishing the last indices they picked up.
+		std::unique_lock<std::mutex> lock(mMutex);
+		mDone.wait(lock, [this]() { return mBusyWorkers == 0; });
+		mTask = nullptr;
+		mDispatchedTask = nullptr;
+		error = mError;
+		mError = nullptr;
+	}
+
+	if(error)
+		std::rethrow_exception(error);
+}
+
+void TaskPool::WorkerMain(std::uint32_t thread)
+{
+	std::uint64_t seenGeneration = 0;
+
+	for(;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWake.wait(lock, [&]() { return mQuit || mGeneration != seenGeneration; });
+			if(mQuit)
+				return;
+			seenGeneration = mGeneration;
+		}
+
+		RunIndices(thread);
+
+		bool last = false;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			last = --mBusyWorkers == 0;
+		}
+		if(last)
+			mDone.notify_one();
+	}
+}
+
+void TaskPool::RunIndices(std::uint32_t thread)
+{
+	for(;;)
+	{
+		std::uint32_t index = mNext.fetch_add(1, std::memory_order_relaxed);
+		if(index >= mCount)
+			return;
+
+		RunTask(index, thread);
+	}
+}
+
+void TaskPool::RunTask(std::uint32_t index, std::uint32_t thread)
+{
+	try
+	{
+		(*mTask)(index, thread);
+	}
+	catch(...)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if(!mError)
+			mError = std::current_exception();
+	}
+}
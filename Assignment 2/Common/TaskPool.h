@@ -0,0 +1,75 @@
+//***************************************************************************************
+// TaskPool.h
+//
+// Fixed set of worker threads for fork/join work.  ParallelFor hands out indices from
+// a shared counter to the workers and the calling thread and returns once all of them
+// have run, so callers need no synchronization of their own beyond not sharing
+// per-index outputs.  The first exception thrown by a task is rethrown by ParallelFor.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class TaskPool
+{
+public:
+	// fn(index, thread): thread is 0 for the calling thread and 1..WorkerCount() for
+	// the workers, so it can select per-thread scratch state.
+	using TaskCallback = std::function<void(std::uint32_t index, std::uint32_t thread)>;
+
+	// workerCount == 0 runs everything on the calling thread.
+	explicit TaskPool(std::uint32_t workerCount);
+	TaskPool(const TaskPool& rhs) = delete;
+	TaskPool& operator=(const TaskPool& rhs) = delete;
+	~TaskPool();
+
+	// Worker count that leaves one hardware thread for the caller.
+	static std::uint32_t DefaultWorkerCount();
+
+	std::uint32_t WorkerCount()const { return (std::uint32_t)mWorkers.size(); }
+	std::uint32_t ThreadCount()const { return WorkerCount() + 1; }
+
+	// Runs fn for every index in [0, count) and blocks until all have finished.
+	// Not reentrant: fn must not call ParallelFor on the same pool.
+	void ParallelFor(std::uint32_t count, const TaskCallback& fn);
+
+	// Like ParallelFor, but only the workers run fn and the call returns at once, so the
+	// calling thread is free for work of its own until Wait.  One job at a time.  With no
+	// workers fn runs inline before Dispatch returns.
+	void Dispatch(std::uint32_t count, const TaskCallback& fn);
+	void Wait();
+
+private:
+	void Start(std::uint32_t count, const TaskCallback* fn);
+	void WorkerMain(std::uint32_t thread);
+	void RunIndices(std::uint32_t thread);
+	void RunTask(std::uint32_t index, std::uint32_t thread);
+
+private:
+	std::vector<std::thread> mWorkers;
+
+	std::mutex mMutex;
+	std::condition_variable mWake;
+	std::condition_variable mDone;
+
+	// Current job; valid while mGeneration is ahead of a worker's last seen value.
+	// ParallelFor points at the caller's callback; Dispatch returns before the job is
+	// done, so it keeps a copy in mDispatchedTask.
+	const TaskCallback* mTask = nullptr;
+	TaskCallback mDispatchedTask;
+	std::uint32_t mCount = 0;
+	std::atomic<std::uint32_t> mNext{ 0 };
+	std::uint32_t mBusyWorkers = 0;
+	std::uint64_t mGeneration = 0;
+	bool mQuit = false;
+
+	std::exception_ptr mError;
+};
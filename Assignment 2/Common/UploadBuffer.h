@@ -50,6 +50,24 @@ public:
         return mUploadBuffer.Get();
     }
 
+    // CPU view of the mapped memory; element i starts at i*ElementByteSize().
+    const BYTE* MappedData()const
+    {
+        return mMappedData;
+    }
+
+    // For filling elements in place.  The memory is write-combined: write it in order
+    // and never read it back.
+    BYTE* MappedData()
+    {
+        return mMappedData;
+    }
+
+    UINT ElementByteSize()const
+    {
+        return mElementByteSize;
+    }
+
     void CopyData(int elementIndex, const T& data)
     {
         memcpy(&mMappedData[elementIndex*mElementByteSize], &data, sizeof(T));
@@ -3,8 +3,16 @@
 //***************************************************************************************
 
 #include "d3dApp.h"
+#include "Profiler.h"
 #include <WindowsX.h>
 
+// timeBeginPeriod, for PacingSleep without a high-resolution timer.
+#pragma comment(lib, "winmm.lib")
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
 using Microsoft::WRL::ComPtr;
 using namespace std;
 using namespace DirectX;
@@ -24,7 +32,8 @@ D3DApp* D3DApp::GetApp()
 }
 
 D3DApp::D3DApp(HINSTANCE hInstance)
-:	mhAppInst(hInstance)
+:	mhAppInst(hInstance),
+	mFramePacer(FramePacer::ClockFunction(), [this](std::int64_t ns) { PacingSleep(ns); })
 {
     // Only one D3DApp can be constructed.
     assert(mApp == nullptr);
@@ -35,6 +44,11 @@ D3DApp::~D3DApp()
 {
 	if(md3dDevice != nullptr)
 		FlushCommandQueue();
+
+	if(mPacingTimer != nullptr)
+		CloseHandle(mPacingTimer);
+	if(mPacingTimerPeriod)
+		timeEndPeriod(1);
 }
 
 HINSTANCE D3DApp::AppInst()const
@@ -74,36 +88,93 @@ int D3DApp::Run()
 	MSG msg = {0};
  
 	mTimer.Reset();
+	Profiler::Get().SetThreadName("Main");
 
 	while(msg.message != WM_QUIT)
 	{
-		// If there are Window messages then process them.
-		if(PeekMessage( &msg, 0, 0, 0, PM_REMOVE ))
+		// Process every queued Window message before the next frame, so input arriving
+		// faster than the frame rate does not queue up behind it.
+		bool quit = false;
+		while(PeekMessage( &msg, 0, 0, 0, PM_REMOVE ))
 		{
+			if(msg.message == WM_QUIT)
+			{
+				quit = true;
+				break;
+			}
+
+			if((msg.message >= WM_KEYFIRST && msg.message <= WM_KEYLAST) ||
+				(msg.message >= WM_MOUSEFIRST && msg.message <= WM_MOUSELAST) ||
+				msg.message == WM_PAINT)
+				mFramePacer.Invalidate();
+
             TranslateMessage( &msg );
             DispatchMessage( &msg );
 		}
-		// Otherwise, do animation/game stuff.
-		else
-        {	
-			mTimer.Tick();
+		if(quit)
+			break;
 
-			if( !mAppPaused )
-			{
-				CalculateFrameStats();
-				Update(mTimer);	
-                Draw(mTimer);
-			}
-			else
-			{
-				Sleep(100);
-			}
-        }
+		if( mAppPaused )
+		{
+			// Wake for the message that unpauses us rather than polling.
+			MsgWaitForMultipleObjects(0, nullptr, FALSE, 100, QS_ALLINPUT);
+			continue;
+		}
+
+		// On demand with nothing to show: block until a message or the idle interval.
+		if(!mFramePacer.ShouldRender())
+		{
+			const std::int64_t timeoutNs = mFramePacer.IdleTimeoutNs();
+			const DWORD timeoutMs = timeoutNs < 0 ? INFINITE : (DWORD)((timeoutNs + 999999) / 1000000);
+			MsgWaitForMultipleObjects(0, nullptr, FALSE, timeoutMs, QS_ALLINPUT);
+			continue;
+		}
+
+		mFramePacer.WaitForNextFrame();
+		mTimer.Tick();
+
+		CalculateFrameStats();
+		{
+			PROFILE_ZONE("Frame");
+			Update(mTimer);	
+			Draw(mTimer);
+		}
+		mFramePacer.FrameRendered();
+
+		if(Profiler::IsEnabled())
+			Profiler::Get().Collect();
     }
 
 	return (int)msg.wParam;
 }
 
+void D3DApp::PacingSleep(std::int64_t ns)
+{
+	if(mPacingTimer == nullptr && !mPacingTimerPeriod)
+	{
+		mPacingTimer = CreateWaitableTimerExW(nullptr, nullptr,
+			CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+
+		// Before Windows 10 1803: Sleep, at the finest timer resolution available.
+		if(mPacingTimer == nullptr)
+			mPacingTimerPeriod = timeBeginPeriod(1) == TIMERR_NOERROR;
+	}
+
+	if(mPacingTimer != nullptr)
+	{
+		// Negative due times are relative, in 100 ns units.
+		LARGE_INTEGER dueTime;
+		dueTime.QuadPart = -(LONGLONG)(ns / 100);
+		if(SetWaitableTimer(mPacingTimer, &dueTime, 0, nullptr, nullptr, FALSE))
+		{
+			WaitForSingleObject(mPacingTimer, INFINITE);
+			return;
+		}
+	}
+
+	Sleep((DWORD)(ns / 1000000));
+}
+
 bool D3DApp::Initialize()
 {
 	if(!InitMainWindow())
@@ -232,6 +303,8 @@ void D3DApp::OnResize()
 	mScreenViewport.MaxDepth = 1.0f;
 
     mScissorRect = { 0, 0, mClientWidth, mClientHeight };
+
+	mFramePacer.Invalidate();
 }
  
 LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
@@ -251,6 +324,7 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		{
 			mAppPaused = false;
 			mTimer.Start();
+			mFramePacer.Invalidate();
 		}
 		return 0;
 
@@ -364,6 +438,16 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         }
         else if((int)wParam == VK_F2)
             Set4xMsaaState(!m4xMsaaState);
+        else if((int)wParam == VK_F3)
+            Profiler::Get().SetEnabled(!Profiler::IsEnabled());
+        else if((int)wParam == VK_F4)
+        {
+            // Dump what the profiler has gathered so far.
+            Profiler::Get().Collect();
+            ::OutputDebugStringA(Profiler::Get().Report().c_str());
+            if(!Profiler::Get().ExportChromeTrace("profile.json"))
+                ::OutputDebugStringA("Could not write profile.json\n");
+        }
 
         return 0;
 	}
@@ -603,28 +687,26 @@ void D3DApp::CalculateFrameStats()
 	// are appended to the window caption bar.
     
 	static int frameCnt = 0;
-	static float timeElapsed = 0.0f;
+	static double timeElapsed = 0.0;
 
 	frameCnt++;
 
 	// Compute averages over one second period.
-	if( (mTimer.TotalTime() - timeElapsed) >= 1.0f )
+	if( (mTimer.TotalSeconds() - timeElapsed) >= 1.0 )
 	{
 		float fps = (float)frameCnt; // fps = frameCnt / 1
 		float mspf = 1000.0f / fps;
 
-        wstring fpsStr = to_wstring(fps);
-        wstring mspfStr = to_wstring(mspf);
-
-        wstring windowText = mMainWndCaption +
-            L"    fps: " + fpsStr +
-            L"   mspf: " + mspfStr;
+        // Formatted in place rather than with wstring concatenation so the frame loop
+        // does not allocate.
+        wchar_t windowText[256];
+        swprintf_s(windowText, L"%s    fps: %f   mspf: %f", mMainWndCaption.c_str(), fps, mspf);
 
-        SetWindowText(mhMainWnd, windowText.c_str());
+        SetWindowText(mhMainWnd, windowText);
 		
 		// Reset for next average.
 		frameCnt = 0;
-		timeElapsed += 1.0f;
+		timeElapsed += 1.0;
 	}
 }
 
@@ -9,6 +9,7 @@
 
 #include "d3dUtil.h"
 #include "GameTimer.h"
+#include "FramePacer.h"
 
 // Link necessary d3d12 libraries.
 #pragma comment(lib,"d3dcompiler.lib")
@@ -66,6 +67,10 @@ protected:
 
 	void CalculateFrameStats();
 
+	// Sleep for FramePacer: a high-resolution waitable timer where Windows has one,
+	// otherwise Sleep at 1 ms timer resolution.
+	void PacingSleep(std::int64_t ns);
+
     void LogAdapters();
     void LogAdapterOutputs(IDXGIAdapter* adapter);
     void LogOutputDisplayModes(IDXGIOutput* output, DXGI_FORMAT format);
@@ -88,6 +93,11 @@ protected:
 
 	// Used to keep track of the delta-time and game time.
 	GameTimer mTimer;
+
+	// When Run renders frames; unlimited unless a derived class configures it.
+	FramePacer mFramePacer;
+	HANDLE mPacingTimer = nullptr;
+	bool mPacingTimerPeriod = false;    // timeBeginPeriod(1) in effect
 	
     Microsoft::WRL::ComPtr<IDXGIFactory4> mdxgiFactory;
     Microsoft::WRL::ComPtr<IDXGISwapChain> mSwapChain;
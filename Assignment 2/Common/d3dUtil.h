@@ -176,6 +176,10 @@ struct MeshGeometry
 	Microsoft::WRL::ComPtr<ID3D12Resource> IndexBufferUploader = nullptr;
 	Microsoft::WRL::ComPtr<ID3D12Resource> ColorBufferUploader = nullptr;
 
+	// Byte offsets of the vertex/index data inside the GPU buffers.  These are
+	// nonzero when the buffers are suballocations of a shared pool buffer.
+	UINT64 VertexBufferOffset = 0;
+	UINT64 IndexBufferOffset = 0;
 
 
 	// Data about the buffers.
@@ -197,7 +201,7 @@ struct MeshGeometry
 
 	{
 		D3D12_VERTEX_BUFFER_VIEW vbv;
-		vbv.BufferLocation = VertexBufferGPU->GetGPUVirtualAddress();
+		vbv.BufferLocation = VertexBufferGPU->GetGPUVirtualAddress() + VertexBufferOffset;
 		vbv.StrideInBytes = VertexByteStride;
 		vbv.SizeInBytes = VertexBufferByteSize;
 
@@ -208,7 +212,7 @@ struct MeshGeometry
 
 	{
 		D3D12_INDEX_BUFFER_VIEW ibv;
-		ibv.BufferLocation = IndexBufferGPU->GetGPUVirtualAddress();
+		ibv.BufferLocation = IndexBufferGPU->GetGPUVirtualAddress() + IndexBufferOffset;
 		ibv.Format = IndexFormat;
 		ibv.SizeInBytes = IndexBufferByteSize;
 
@@ -278,6 +282,9 @@ struct Material
 	// Index into SRV heap for normal texture.
 	int NormalSrvHeapIndex = -1;
 
+	// GPU handle of the diffuse SRV, resolved once the descriptors are built.
+	D3D12_GPU_DESCRIPTOR_HANDLE DiffuseSrvGpuHandle = {};
+
 	// Dirty flag indicating the material has changed and we need to update the constant buffer.
 	// Because we have a material constant buffer for each FrameResource, we have to apply the
 	// update to each FrameResource.  Thus, when we modify a material we should set 
@@ -0,0 +1,187 @@
+//***************************************************************************************
+// AssetDependenciesTests.cpp
+//
+// The asset graph of the demo's shaders and pipelines: a changed file affects the
+// assets built from it and everything downstream, once each and after everything it
+// depends on.  A shared include reaches every shader and through them every PSO;
+// a texture reaches nothing else.  Replacing an asset's files moves it in the graph.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "AssetDependencies.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace
+{
+	enum Kind : std::uint32_t { Texture, Shader, Pipeline };
+
+	typedef AssetDependencies::Asset Asset;
+
+	// Shaders built from Default1.hlsl and TreeSprite.hlsl, both including
+	// LightingUtil.hlsl, and the PSOs built from them.
+	struct DemoGraph
+	{
+		AssetDependencies Graph;
+		Asset StandardVS, OpaquePS, TreeVS, TreeGS, TreePS;
+		Asset OpaquePso, TransparentPso, TreePso;
+		Asset GrassTex;
+
+		DemoGraph()
+		{
+			StandardVS = Shader_("standardVS", "Shaders\\Default1.hlsl");
+			OpaquePS = Shader_("opaquePS", "Shaders\\Default1.hlsl");
+			TreeVS = Shader_("treeSpriteVS", "Shaders\\TreeSprite.hlsl");
+			TreeGS = Shader_("treeSpriteGS", "Shaders\\TreeSprite.hlsl");
+			TreePS = Shader_("treeSpritePS", "Shaders\\TreeSprite.hlsl");
+
+			OpaquePso = Graph.AddAsset("opaque", Pipeline);
+			Graph.AddDependency(OpaquePso, StandardVS);
+			Graph.AddDependency(OpaquePso, OpaquePS);
+
+			// Derived from the opaque PSO's description, so it follows it.
+			TransparentPso = Graph.AddAsset("transparent", Pipeline);
+			Graph.AddDependency(TransparentPso, OpaquePso);
+			Graph.AddDependency(TransparentPso, OpaquePS);
+
+			TreePso = Graph.AddAsset("treeSprites", Pipeline);
+			Graph.AddDependency(TreePso, TreeVS);
+			Graph.AddDependency(TreePso, TreeGS);
+			Graph.AddDependency(TreePso, TreePS);
+
+			GrassTex = Graph.AddAsset("grassTex", Texture);
+			Graph.SetFiles(GrassTex, { "Textures/grass.dds" });
+		}
+
+		Asset Shader_(const char* name, const char* source)
+		{
+			const Asset shader = Graph.AddAsset(name, Shader);
+			Graph.SetFiles(shader, { source, "Shaders/LightingUtil.hlsl" });
+			return shader;
+		}
+	};
+
+	std::size_t IndexOf(const std::vector<Asset>& assets, Asset asset)
+	{
+		return (std::size_t)(std::find(assets.begin(), assets.end(), asset) - assets.begin());
+	}
+
+	bool Contains(const std::vector<Asset>& assets, Asset asset)
+	{
+		return IndexOf(assets, asset) < assets.size();
+	}
+
+	// Every affected asset appears once and after each of its affected dependencies.
+	bool DependenciesFirst(const AssetDependencies& graph, const std::vector<Asset>& ordered)
+	{
+		for(std::size_t i = 0; i < ordered.size(); ++i)
+		{
+			if(IndexOf(ordered, ordered[i]) != i)
+				return false;
+			for(Asset dependency : graph.Dependencies(ordered[i]))
+			{
+				if(Contains(ordered, dependency) && IndexOf(ordered, dependency) > i)
+					return false;
+			}
+		}
+		return true;
+	}
+}
+
+TEST(SharedIncludeReachesEveryShaderThenItsPsos)
+{
+	DemoGraph demo;
+	const std::vector<Asset> affected = demo.Graph.Affected({ ".\\Shaders\\LightingUtil.hlsl" });
+
+	CHECK_EQUAL(affected.size(), 8u);
+	for(Asset shader : { demo.StandardVS, demo.OpaquePS, demo.TreeVS, demo.TreeGS, demo.TreePS })
+		CHECK(Contains(affected, shader));
+	for(Asset pso : { demo.OpaquePso, demo.TransparentPso, demo.TreePso })
+		CHECK(Contains(affected, pso));
+	CHECK(!Contains(affected, demo.GrassTex));
+	CHECK(DependenciesFirst(demo.Graph, affected));
+
+	// Spelled out for the chain: shaders, then the opaque PSO, then the one derived from it.
+	CHECK(IndexOf(affected, demo.StandardVS) < IndexOf(affected, demo.OpaquePso));
+	CHECK(IndexOf(affected, demo.OpaquePS) < IndexOf(affected, demo.OpaquePso));
+	CHECK(IndexOf(affected, demo.OpaquePso) < IndexOf(affected, demo.TransparentPso));
+	CHECK(IndexOf(affected, demo.TreeGS) < IndexOf(affected, demo.TreePso));
+}
+
+TEST(OneSourceReachesOnlyItsOwnAssets)
+{
+	DemoGraph demo;
+
+	const std::vector<Asset> tree = demo.Graph.Affected({ "Shaders/TreeSprite.hlsl" });
+	CHECK_EQUAL(tree.size(), 4u);
+	CHECK(Contains(tree, demo.TreePso));
+	CHECK(!Contains(tree, demo.OpaquePso));
+	CHECK(DependenciesFirst(demo.Graph, tree));
+	CHECK_EQUAL(tree.back(), demo.TreePso);
+
+	const std::vector<Asset> opaque = demo.Graph.Affected({ "Shaders/Default1.hlsl" });
+	CHECK_EQUAL(opaque.size(), 4u);
+	CHECK_EQUAL(opaque.back(), demo.TransparentPso);
+	CHECK(DependenciesFirst(demo.Graph, opaque));
+
+	// A texture has no dependents here; unknown files and no files affect nothing.
+	const std::vector<Asset> texture = demo.Graph.Affected({ "Textures\\grass.dds" });
+	REQUIRE(texture.size() == 1u);
+	CHECK_EQUAL(texture[0], demo.GrassTex);
+	CHECK(demo.Graph.Affected({ "Shaders/Unknown.hlsl" }).empty());
+	CHECK(demo.Graph.Affected({}).empty());
+
+	// Several files at once: each asset still once.
+	const std::vector<Asset> both = demo.Graph.Affected({ "Shaders/Default1.hlsl", "Shaders/LightingUtil.hlsl",
+		"Shaders/Default1.hlsl" });
+	CHECK_EQUAL(both.size(), 8u);
+	CHECK(DependenciesFirst(demo.Graph, both));
+}
+
+TEST(SetFilesReplacesTheSources)
+{
+	DemoGraph demo;
+
+	// The tree shaders stop including LightingUtil.hlsl.
+	for(Asset shader : { demo.TreeVS, demo.TreeGS, demo.TreePS })
+		demo.Graph.SetFiles(shader, { "Shaders/TreeSprite.hlsl", "Shaders/TreeSprite.hlsl" });
+
+	const std::vector<Asset> affected = demo.Graph.Affected({ "Shaders/LightingUtil.hlsl" });
+	CHECK_EQUAL(affected.size(), 4u);
+	CHECK(!Contains(affected, demo.TreeVS));
+	CHECK(!Contains(affected, demo.TreePso));
+
+	const std::vector<std::string> expected =
+	{
+		"Shaders/Default1.hlsl", "Shaders/LightingUtil.hlsl", "Shaders/TreeSprite.hlsl", "Textures/grass.dds"
+	};
+	CHECK(demo.Graph.Files() == expected);
+
+	// No sources left for the opaque shaders' include either.
+	demo.Graph.SetFiles(demo.StandardVS, { "Shaders/Default1.hlsl" });
+	demo.Graph.SetFiles(demo.OpaquePS, { "Shaders/Default1.hlsl" });
+	CHECK(demo.Graph.Affected({ "Shaders/LightingUtil.hlsl" }).empty());
+	CHECK_EQUAL(demo.Graph.Files().size(), 3u);
+}
+
+TEST(NamesKindsAndDuplicateDependencies)
+{
+	DemoGraph demo;
+	CHECK_EQUAL(demo.Graph.AssetCount(), 9u);
+	CHECK_EQUAL(demo.Graph.Find("treeSprites"), demo.TreePso);
+	CHECK(demo.Graph.Find("missing") == AssetDependencies::InvalidAsset);
+	CHECK_EQUAL(demo.Graph.Name(demo.OpaquePS), std::string("opaquePS"));
+	CHECK_EQUAL(demo.Graph.Kind(demo.OpaquePso), (std::uint32_t)Pipeline);
+
+	// Adding a dependency twice records it once.
+	demo.Graph.AddDependency(demo.OpaquePso, demo.StandardVS);
+	CHECK_EQUAL(demo.Graph.Dependencies(demo.OpaquePso).size(), 2u);
+
+	// A cycle is broken rather than looping: both assets are still ordered once.
+	demo.Graph.AddDependency(demo.StandardVS, demo.TransparentPso);
+	const std::vector<Asset> affected = demo.Graph.Affected({ "Shaders/Default1.hlsl" });
+	CHECK_EQUAL(affected.size(), 4u);
+	CHECK(Contains(affected, demo.StandardVS));
+	CHECK(Contains(affected, demo.TransparentPso));
+}
@@ -0,0 +1,224 @@
+//***************************************************************************************
+// BuddyAllocatorTests.cpp
+//
+// Block sizing and alignment, buddy merging, the statistics, and a fuzz run of random
+// allocations and frees against a byte-for-byte model of the range, defragmentation
+// included.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "BuddyAllocator.h"
+#include "Random.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+TEST(RoundsSizesToPowersOfTwo)
+{
+	BuddyAllocator allocator(1000, 48);
+	CHECK_EQUAL(allocator.Capacity(), 1024u);
+	CHECK_EQUAL(allocator.MinBlockSize(), 64u);
+
+	const std::uint64_t a = allocator.Allocate(1);
+	const std::uint64_t b = allocator.Allocate(65);
+	const std::uint64_t c = allocator.Allocate(200);
+	CHECK_EQUAL(allocator.BlockSize(a), 64u);
+	CHECK_EQUAL(allocator.BlockSize(b), 128u);
+	CHECK_EQUAL(allocator.BlockSize(c), 256u);
+	CHECK_EQUAL(allocator.BlockSize(12345), 0u);
+}
+
+TEST(BlocksAreNaturallyAligned)
+{
+	BuddyAllocator allocator(1 << 20, 256);
+
+	// Knock the range out of step first so alignment is not a given.
+	allocator.Allocate(256);
+	for(std::uint64_t size : { 300ull, 5000ull, 70000ull, 256ull })
+	{
+		const std::uint64_t offset = allocator.Allocate(size);
+		REQUIRE(offset != BuddyAllocator::InvalidOffset);
+		CHECK_EQUAL(offset % allocator.BlockSize(offset), 0u);
+	}
+
+	// An alignment above the size promotes the block to the alignment.
+	const std::uint64_t aligned = allocator.Allocate(256, 65536);
+	REQUIRE(aligned != BuddyAllocator::InvalidOffset);
+	CHECK_EQUAL(aligned % 65536, 0u);
+	CHECK_EQUAL(allocator.BlockSize(aligned), 65536u);
+}
+
+TEST(FailsWhenNoBlockIsLargeEnough)
+{
+	BuddyAllocator allocator(4096, 256);
+	CHECK(allocator.Allocate(8192) == BuddyAllocator::InvalidOffset);
+
+	const std::uint64_t half = allocator.Allocate(2048);
+	CHECK(half != BuddyAllocator::InvalidOffset);
+	CHECK(allocator.Allocate(2049) == BuddyAllocator::InvalidOffset);
+	CHECK(allocator.Allocate(2048) != BuddyAllocator::InvalidOffset);
+	CHECK(allocator.Allocate(1) == BuddyAllocator::InvalidOffset);
+}
+
+TEST(FreeMergesBuddiesBackIntoOneBlock)
+{
+	BuddyAllocator allocator(4096, 256);
+	std::uint64_t offsets[16];
+	for(std::uint64_t& offset : offsets)
+		offset = allocator.Allocate(256);
+	CHECK_EQUAL(allocator.GetStats().FreeBytes, 0u);
+
+	// Free every other block first: nothing can merge yet.
+	for(int i = 0; i < 16; i += 2)
+		allocator.Free(offsets[i]);
+	BuddyAllocator::Stats stats = allocator.GetStats();
+	CHECK_EQUAL(stats.LargestFreeBlock, 256u);
+	CHECK_EQUAL(stats.FreeBlockCount, 8u);
+	CHECK(stats.ExternalFragmentation() > 0.8f);
+
+	for(int i = 1; i < 16; i += 2)
+		allocator.Free(offsets[i]);
+	stats = allocator.GetStats();
+	CHECK(allocator.Empty());
+	CHECK_EQUAL(stats.LargestFreeBlock, 4096u);
+	CHECK_EQUAL(stats.FreeBlockCount, 1u);
+	CHECK_EQUAL(stats.ExternalFragmentation(), 0.0f);
+}
+
+TEST(StatsSeparateRequestedFromAllocatedBytes)
+{
+	BuddyAllocator allocator(1 << 16, 256);
+	allocator.Allocate(100);
+	allocator.Allocate(300);
+	const std::uint64_t big = allocator.Allocate(5000);
+
+	BuddyAllocator::Stats stats = allocator.GetStats();
+	CHECK_EQUAL(stats.AllocationCount, 3u);
+	CHECK_EQUAL(stats.RequestedBytes, 5400u);
+	CHECK_EQUAL(stats.AllocatedBytes, 256u + 512u + 8192u);
+	CHECK_EQUAL(stats.FreeBytes, stats.Capacity - stats.AllocatedBytes);
+
+	allocator.Free(big);
+	stats = allocator.GetStats();
+	CHECK_EQUAL(stats.RequestedBytes, 400u);
+	CHECK_EQUAL(stats.AllocatedBytes, 768u);
+}
+
+// Random allocations and frees; every live allocation owns a byte pattern in a model of
+// the range, so overlaps show up as corrupted patterns.  Defragment copies through the
+// callback like a GPU copy would.
+TEST(FuzzAgainstModel)
+{
+	const std::uint64_t capacity = 1 << 20;
+	BuddyAllocator allocator(capacity, 256);
+	std::vector<std::uint8_t> memory(capacity, 0);
+	std::map<std::uint64_t, std::uint64_t> live;  // offset -> requested size
+	std::map<std::uint64_t, std::uint8_t> tags;
+
+	auto fill = [&](std::uint64_t offset, std::uint64_t size, std::uint8_t tag)
+	{
+		std::memset(&memory[offset], tag, (std::size_t)size);
+	};
+	auto intact = [&](std::uint64_t offset, std::uint64_t size, std::uint8_t tag)
+	{
+		for(std::uint64_t i = 0; i < size; ++i)
+		{
+			if(memory[offset + i] != tag)
+				return false;
+		}
+		return true;
+	};
+
+	Pcg32 rng(76);
+	std::uint8_t nextTag = 1;
+	for(int round = 0; round < 4; ++round)
+	{
+		for(int op = 0; op < 20000; ++op)
+		{
+			if(live.empty() || rng.NextBounded(3) != 0)
+			{
+				const std::uint64_t size = 1 + rng.NextBounded(rng.NextBounded(8) == 0 ? 60000 : 3000);
+				const std::uint64_t offset = allocator.Allocate(size, 256);
+				if(offset == BuddyAllocator::InvalidOffset)
+					continue;
+
+				REQUIRE(offset + size <= capacity);
+				CHECK_EQUAL(offset % 256, 0u);
+
+				// Neither neighbour in offset order may reach into the new block.
+				auto next = live.lower_bound(offset);
+				if(next != live.end())
+					REQUIRE(offset + size <= next->first);
+				if(next != live.begin())
+				{
+					auto prev = std::prev(next);
+					REQUIRE(prev->first + prev->second <= offset);
+				}
+
+				live[offset] = size;
+				tags[offset] = nextTag;
+				fill(offset, size, nextTag);
+				nextTag = nextTag == 255 ? 1 : nextTag + 1;
+			}
+			else
+			{
+				auto it = live.begin();
+				std::advance(it, rng.NextBounded((std::uint32_t)live.size()));
+				REQUIRE(intact(it->first, it->second, tags[it->first]));
+				allocator.Free(it->first);
+				tags.erase(it->first);
+				live.erase(it);
+			}
+		}
+
+		const BuddyAllocator::Stats before = allocator.GetStats();
+		CHECK_EQUAL(before.AllocationCount, (std::uint32_t)live.size());
+
+		std::map<std::uint64_t, std::uint64_t> moved;
+		std::uint32_t callbacks = 0;
+		const std::uint32_t moves = allocator.Defragment([&](std::uint64_t from, std::uint64_t to, std::uint64_t size)
+		{
+			CHECK(to < from);
+			CHECK_EQUAL(live[from], size);
+			std::memmove(&memory[to], &memory[from], (std::size_t)size);
+			live[to] = size;
+			tags[to] = tags[from];
+			live.erase(from);
+			tags.erase(from);
+			callbacks++;
+		});
+		CHECK_EQUAL(moves, callbacks);
+
+		const BuddyAllocator::Stats after = allocator.GetStats();
+		CHECK_EQUAL(after.AllocationCount, before.AllocationCount);
+		CHECK_EQUAL(after.AllocatedBytes, before.AllocatedBytes);
+		CHECK(after.LargestFreeBlock >= before.LargestFreeBlock);
+
+		for(auto& e : live)
+		{
+			CHECK(allocator.BlockSize(e.first) >= e.second);
+			REQUIRE(intact(e.first, e.second, tags[e.first]));
+		}
+	}
+
+	for(auto& e : live)
+		allocator.Free(e.first);
+	CHECK(allocator.Empty());
+	CHECK_EQUAL(allocator.GetStats().LargestFreeBlock, capacity);
+}
+
+TEST(DefragmentRespectsMoveLimit)
+{
+	BuddyAllocator allocator(1 << 16, 256);
+	std::vector<std::uint64_t> offsets;
+	for(int i = 0; i < 64; ++i)
+		offsets.push_back(allocator.Allocate(256));
+	for(int i = 0; i < 60; ++i)
+		allocator.Free(offsets[i]);
+
+	std::uint32_t callbacks = 0;
+	CHECK_EQUAL(allocator.Defragment([&](std::uint64_t, std::uint64_t, std::uint64_t) { callbacks++; }, 2), 2u);
+	CHECK_EQUAL(callbacks, 2u);
+	CHECK_EQUAL(allocator.Defragment(nullptr), 2u);
+	CHECK_EQUAL(allocator.GetStats().LargestFreeBlock, 1u << 15);
+}
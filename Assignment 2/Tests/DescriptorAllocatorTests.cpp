@@ -0,0 +1,166 @@
+//***************************************************************************************
+// DescriptorAllocatorTests.cpp
+//
+// Persistent ranges (first fit, deferred recycling, merging), the per-frame transient
+// regions, and a fuzz run against a per-index ownership model.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "DescriptorAllocator.h"
+#include "Random.h"
+#include <deque>
+#include <vector>
+
+TEST(LaysOutPersistentThenPerFrameRegions)
+{
+	DescriptorAllocator allocator(100, 20, 3);
+	CHECK_EQUAL(allocator.Capacity(), 160u);
+	CHECK_EQUAL(allocator.PersistentCount(), 100u);
+
+	const DescriptorAllocator::Range textures = allocator.AllocatePersistent(10);
+	CHECK_EQUAL(textures.Start, 0u);
+	CHECK_EQUAL(textures.Count, 10u);
+	CHECK_EQUAL(allocator.AllocatePersistent(5).Start, 10u);
+	CHECK(!allocator.AllocatePersistent(86).IsValid());
+	CHECK(!allocator.AllocatePersistent(0).IsValid());
+
+	for(std::uint32_t frame = 0; frame < 3; ++frame)
+	{
+		allocator.BeginFrame(frame);
+		CHECK_EQUAL(allocator.AllocateTransient(4).Start, 100u + 20u * frame);
+		CHECK_EQUAL(allocator.AllocateTransient(16).Start, 104u + 20u * frame);
+		CHECK(!allocator.AllocateTransient(1).IsValid());
+	}
+}
+
+TEST(FreedRangesWaitForTheirFence)
+{
+	DescriptorAllocator allocator(16, 0, 1);
+	const DescriptorAllocator::Range a = allocator.AllocatePersistent(16);
+	allocator.Free(a, 5);
+
+	DescriptorAllocator::Stats stats = allocator.GetStats();
+	CHECK_EQUAL(stats.PersistentAllocated, 0u);
+	CHECK_EQUAL(stats.PendingFree, 16u);
+	CHECK(!allocator.AllocatePersistent(1).IsValid());
+
+	allocator.Retire(4);
+	CHECK(!allocator.AllocatePersistent(1).IsValid());
+
+	allocator.Retire(5);
+	stats = allocator.GetStats();
+	CHECK_EQUAL(stats.PendingFree, 0u);
+	CHECK_EQUAL(stats.LargestFreeRange, 16u);
+	CHECK_EQUAL(allocator.AllocatePersistent(16).Start, 0u);
+}
+
+TEST(NeighbouringFreesMerge)
+{
+	DescriptorAllocator allocator(30, 0, 1);
+	const DescriptorAllocator::Range a = allocator.AllocatePersistent(10);
+	const DescriptorAllocator::Range b = allocator.AllocatePersistent(10);
+	const DescriptorAllocator::Range c = allocator.AllocatePersistent(10);
+
+	allocator.Free(a, 1);
+	allocator.Free(c, 1);
+	allocator.Retire(1);
+	CHECK_EQUAL(allocator.GetStats().FreeRangeCount, 2u);
+	CHECK_EQUAL(allocator.GetStats().LargestFreeRange, 10u);
+	CHECK(!allocator.AllocatePersistent(11).IsValid());
+
+	allocator.Free(b, 2);
+	allocator.Retire(2);
+	CHECK_EQUAL(allocator.GetStats().FreeRangeCount, 1u);
+	CHECK_EQUAL(allocator.GetStats().LargestFreeRange, 30u);
+	CHECK_EQUAL(allocator.AllocatePersistent(30).Start, 0u);
+}
+
+TEST(TransientRegionRestartsEachFrame)
+{
+	DescriptorAllocator allocator(0, 8, 2);
+	allocator.BeginFrame(0);
+	allocator.AllocateTransient(6);
+	allocator.BeginFrame(1);
+	allocator.AllocateTransient(3);
+	CHECK_EQUAL(allocator.GetStats().TransientUsed, 3u);
+	CHECK_EQUAL(allocator.GetStats().PeakTransientUsed, 6u);
+
+	allocator.BeginFrame(0);
+	CHECK_EQUAL(allocator.GetStats().TransientUsed, 0u);
+	CHECK_EQUAL(allocator.AllocateTransient(8).Start, 0u);
+}
+
+TEST(FuzzAgainstOwnershipModel)
+{
+	const std::uint32_t persistent = 4096;
+	DescriptorAllocator allocator(persistent, 64, 3);
+	std::vector<int> owner(persistent, -1);
+	std::vector<DescriptorAllocator::Range> live;
+	std::deque<std::pair<DescriptorAllocator::Range, std::uint64_t>> pending;
+
+	Pcg32 rng(78);
+	std::uint64_t fence = 0;
+	std::uint64_t completed = 0;
+	int nextOwner = 0;
+	for(int op = 0; op < 50000; ++op)
+	{
+		const std::uint32_t choice = rng.NextBounded(8);
+		if(choice < 4)
+		{
+			const DescriptorAllocator::Range range = allocator.AllocatePersistent(1 + rng.NextBounded(40));
+			if(!range.IsValid())
+				continue;
+
+			REQUIRE(range.Start + range.Count <= persistent);
+			for(std::uint32_t i = range.Start; i < range.Start + range.Count; ++i)
+			{
+				REQUIRE(owner[i] == -1);
+				owner[i] = nextOwner;
+			}
+			nextOwner++;
+			live.push_back(range);
+		}
+		else if(choice < 6 && !live.empty())
+		{
+			const std::uint32_t pick = rng.NextBounded((std::uint32_t)live.size());
+			const DescriptorAllocator::Range range = live[pick];
+			live[pick] = live.back();
+			live.pop_back();
+
+			// Still owned until the fence passes; the model releases it on retire.
+			allocator.Free(range, fence + 1);
+			pending.emplace_back(range, fence + 1);
+		}
+		else if(choice == 6)
+		{
+			++fence;
+		}
+		else
+		{
+			completed = fence - rng.NextBounded((std::uint32_t)(fence - completed) + 1);
+			allocator.Retire(completed);
+			while(!pending.empty() && pending.front().second <= completed)
+			{
+				const DescriptorAllocator::Range& range = pending.front().first;
+				for(std::uint32_t i = range.Start; i < range.Start + range.Count; ++i)
+					owner[i] = -1;
+				pending.pop_front();
+			}
+		}
+
+		std::uint32_t liveCount = 0;
+		for(const DescriptorAllocator::Range& range : live)
+			liveCount += range.Count;
+		REQUIRE(allocator.GetStats().PersistentAllocated == liveCount);
+	}
+
+	for(const DescriptorAllocator::Range& range : live)
+		allocator.Free(range, fence + 1);
+	allocator.Retire(fence + 1);
+
+	const DescriptorAllocator::Stats stats = allocator.GetStats();
+	CHECK_EQUAL(stats.PersistentAllocated, 0u);
+	CHECK_EQUAL(stats.PendingFree, 0u);
+	CHECK_EQUAL(stats.FreeRangeCount, 1u);
+	CHECK_EQUAL(stats.LargestFreeRange, persistent);
+}
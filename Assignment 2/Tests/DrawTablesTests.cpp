@@ -0,0 +1,212 @@
+//***************************************************************************************
+// DrawTablesTests.cpp
+//
+// The draw tables against the shaders that read them.  The packed draw index must
+// round-trip at its limits and be undone by the decode the shaders actually use, the
+// limits must be enforced at scene build time, and ObjectData/MaterialData must have
+// the member offsets and sizes of the StructuredBuffer records declared in each shader.
+// A2_SHADER_DIR points at the demo's Shaders directory.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "DrawTables.h"
+#include <cstddef>
+#include <fstream>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	// (offset, size) of each member, in declaration order.
+	typedef std::vector<std::pair<std::size_t, std::size_t>> Layout;
+
+	const char* Shaders[] = { "Default1.hlsl", "TreeSprite.hlsl" };
+	const char* ObjectMaskPattern = "gDrawIndices\\s*&\\s*0x([0-9a-fA-F]+)";
+	const char* MaterialShiftPattern = "gDrawIndices\\s*>>\\s*(\\d+)";
+
+	std::string ReadShader(const char* name)
+	{
+		std::ifstream file(std::string(A2_SHADER_DIR) + "/" + name);
+		std::ostringstream text;
+		text << file.rdbuf();
+		return text.str();
+	}
+
+	// StructuredBuffer elements are packed tightly on 4-byte boundaries, with none of
+	// the 16-byte rules of constant buffers, so each member starts where the last ends.
+	Layout ShaderLayout(const std::string& source, const std::string& structName)
+	{
+		Layout layout;
+		std::smatch body;
+		if(!std::regex_search(source, body, std::regex("struct\\s+" + structName + "\\s*\\{([^}]*)\\}")))
+			return layout;
+
+		const std::regex member("(float4x4|float4|float3|float2|float|uint)\\s+\\w+\\s*;");
+		const std::string members = body[1].str();
+		std::size_t offset = 0;
+		for(std::sregex_iterator it(members.begin(), members.end(), member), end; it != end; ++it)
+		{
+			const std::string type = (*it)[1].str();
+			const std::size_t size = type == "float4x4" ? 64 : type == "float4" ? 16 :
+				type == "float3" ? 12 : type == "float2" ? 8 : 4;
+			layout.push_back({ offset, size });
+			offset += size;
+		}
+		return layout;
+	}
+
+	// The constants of every "gDrawIndices & mask" or "gDrawIndices >> shift" in a shader.
+	std::vector<std::uint32_t> DecodeConstants(const std::string& source, const char* pattern, int base)
+	{
+		std::vector<std::uint32_t> constants;
+		const std::regex decode(pattern);
+		for(std::sregex_iterator it(source.begin(), source.end(), decode), end; it != end; ++it)
+			constants.push_back((std::uint32_t)std::stoul((*it)[1].str(), nullptr, base));
+		return constants;
+	}
+
+	bool Throws(std::uint32_t objectIndex, std::uint32_t materialIndex)
+	{
+		try
+		{
+			CheckDrawIndices(objectIndex, materialIndex);
+		}
+		catch(const std::out_of_range&)
+		{
+			return true;
+		}
+		return false;
+	}
+}
+
+TEST(PackRoundTripsAtTheLimits)
+{
+	const std::uint32_t objects[] = { 0u, 1u, 4095u, MaxDrawObjectIndex };
+	const std::uint32_t materials[] = { 0u, 1u, 255u, MaxDrawMaterialIndex };
+	for(std::uint32_t object : objects)
+	{
+		for(std::uint32_t material : materials)
+		{
+			const std::uint32_t packed = PackDrawIndices(object, material);
+			CHECK_EQUAL(packed & MaxDrawObjectIndex, object);
+			CHECK_EQUAL(packed >> DrawMaterialShift, material);
+		}
+	}
+
+	CHECK_EQUAL(MaxDrawObjectIndex, 0xfffffu);
+	CHECK_EQUAL(MaxDrawMaterialIndex, 0xfffu);
+	CHECK_EQUAL(PackDrawIndices(0, 0), 0u);
+	CHECK_EQUAL(PackDrawIndices(MaxDrawObjectIndex, MaxDrawMaterialIndex), 0xffffffffu);
+	CHECK_EQUAL(PackDrawIndices(MaxDrawObjectIndex, 0), 0x000fffffu);
+	CHECK_EQUAL(PackDrawIndices(0, MaxDrawMaterialIndex), 0xfff00000u);
+}
+
+TEST(CheckThrowsPastTheLimits)
+{
+	CHECK(!Throws(0, 0));
+	CHECK(!Throws(MaxDrawObjectIndex, MaxDrawMaterialIndex));
+	CHECK(Throws(MaxDrawObjectIndex + 1, 0));
+	CHECK(Throws(0, MaxDrawMaterialIndex + 1));
+	CHECK(Throws(0xffffffffu, 0xffffffffu));
+
+	try
+	{
+		CheckDrawIndices(MaxDrawObjectIndex + 1, 0);
+	}
+	catch(const std::out_of_range& e)
+	{
+		CHECK_EQUAL(std::string(e.what()), std::string("Object index 1048576 exceeds the draw table limit of 1048575."));
+	}
+}
+
+TEST(ShaderDecodeInvertsThePack)
+{
+	// Default1.hlsl reads both tables; TreeSprite.hlsl only the material.
+	const std::string objectShader = ReadShader("Default1.hlsl");
+	REQUIRE(!objectShader.empty());
+	const std::vector<std::uint32_t> objectMasks = DecodeConstants(objectShader, ObjectMaskPattern, 16);
+	REQUIRE(!objectMasks.empty());
+
+	for(const char* name : Shaders)
+	{
+		const std::string source = ReadShader(name);
+		REQUIRE(!source.empty());
+		const std::vector<std::uint32_t> shifts = DecodeConstants(source, MaterialShiftPattern, 10);
+		REQUIRE(!shifts.empty());
+		for(std::uint32_t shift : shifts)
+			CHECK_EQUAL(shift, DrawMaterialShift);
+		for(std::uint32_t mask : DecodeConstants(source, ObjectMaskPattern, 16))
+			CHECK_EQUAL(mask, MaxDrawObjectIndex);
+	}
+
+	// Decode exactly as the shader does.
+	const std::uint32_t objectMask = objectMasks[0];
+	const std::uint32_t materialShift = DecodeConstants(objectShader, MaterialShiftPattern, 10)[0];
+	const std::uint32_t objects[] = { 0u, 77u, MaxDrawObjectIndex };
+	const std::uint32_t materials[] = { 0u, 9u, MaxDrawMaterialIndex };
+	for(std::uint32_t object : objects)
+	{
+		for(std::uint32_t material : materials)
+		{
+			const std::uint32_t packed = PackDrawIndices(object, material);
+			CHECK_EQUAL(packed & objectMask, object);
+			CHECK_EQUAL(packed >> materialShift, material);
+		}
+	}
+
+	// One past either limit does not survive the decode, which is why CheckDrawIndices
+	// rejects it: the object spills into the material field and the material falls off
+	// the top.
+	const std::uint32_t objectPastLimit = MaxDrawObjectIndex + 1;
+	CHECK_EQUAL(objectPastLimit & objectMask, 0u);
+	CHECK_EQUAL(objectPastLimit >> materialShift, 1u);
+	const std::uint32_t materialPastLimit = (MaxDrawMaterialIndex + 1) << DrawMaterialShift;
+	CHECK_EQUAL(materialPastLimit >> materialShift, 0u);
+}
+
+TEST(TablesMatchTheShaderLayouts)
+{
+	const Layout object =
+	{
+		{ offsetof(ObjectData, World), sizeof(ObjectData::World) },
+		{ offsetof(ObjectData, TexTransform), sizeof(ObjectData::TexTransform) },
+	};
+	const Layout material =
+	{
+		{ offsetof(MaterialData, DiffuseAlbedo), sizeof(MaterialData::DiffuseAlbedo) },
+		{ offsetof(MaterialData, FresnelR0), sizeof(MaterialData::FresnelR0) },
+		{ offsetof(MaterialData, Roughness), sizeof(MaterialData::Roughness) },
+		{ offsetof(MaterialData, MatTransform), sizeof(MaterialData::MatTransform) },
+		{ offsetof(MaterialData, DiffuseMapIndex), sizeof(MaterialData::DiffuseMapIndex) },
+		{ offsetof(MaterialData, MaterialPad0), sizeof(MaterialData::MaterialPad0) },
+		{ offsetof(MaterialData, MaterialPad1), sizeof(MaterialData::MaterialPad1) },
+		{ offsetof(MaterialData, MaterialPad2), sizeof(MaterialData::MaterialPad2) },
+	};
+
+	for(const char* name : Shaders)
+	{
+		const std::string source = ReadShader(name);
+		REQUIRE(!source.empty());
+
+		const Layout shaderObject = ShaderLayout(source, "ObjectData");
+		const Layout shaderMaterial = ShaderLayout(source, "MaterialData");
+		CHECK(shaderObject == object);
+		CHECK(shaderMaterial == material);
+
+		// The element stride is the end of the last member; the C++ records have no
+		// tail padding the shader would not skip.
+		REQUIRE(!shaderObject.empty() && !shaderMaterial.empty());
+		CHECK_EQUAL(shaderObject.back().first + shaderObject.back().second, sizeof(ObjectData));
+		CHECK_EQUAL(shaderMaterial.back().first + shaderMaterial.back().second, sizeof(MaterialData));
+	}
+
+	// A fresh material samples descriptor 0 with identity transforms.
+	const MaterialData defaults = MaterialData();
+	CHECK_EQUAL(defaults.DiffuseMapIndex, 0u);
+	CHECK_NEAR(defaults.MatTransform._11, 1.0f, 0.0f);
+	CHECK_NEAR(defaults.MatTransform._41, 0.0f, 0.0f);
+}
@@ -0,0 +1,247 @@
+//***************************************************************************************
+// FileWatcherTests.cpp
+//
+// FileWatcher on real files with a fake clock.  With inotify a write is reported once,
+// only after SettleNs without further events, a burst of writes and a save by rename
+// are one change, and files that are not watched are ignored.  The polling fallback
+// sees a change at the next poll interval and reports it after the same settle time,
+// and a file missing mid-save is picked up once it is back.  Files live in a scratch
+// directory under the working directory, removed when each case ends.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "FileWatcher.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const std::int64_t Ms = 1000000;
+
+	// Files written by a case, deleted with the directory when it ends.
+	class Scratch
+	{
+	public:
+		explicit Scratch(const std::string& name)
+		{
+#ifdef _WIN32
+			mRoot = name + "-" + std::to_string(_getpid()) + "/";
+			_mkdir(mRoot.c_str());
+#else
+			mRoot = name + "-" + std::to_string(getpid()) + "/";
+			mkdir(mRoot.c_str(), 0755);
+#endif
+		}
+
+		~Scratch()
+		{
+			for(const std::string& file : mFiles)
+				std::remove(file.c_str());
+#ifdef _WIN32
+			_rmdir(mRoot.c_str());
+#else
+			rmdir(mRoot.c_str());
+#endif
+		}
+
+		std::string Path(const std::string& relative)const { return mRoot + relative; }
+
+		void Write(const std::string& relative, const std::string& contents)
+		{
+			std::ofstream(Path(relative), std::ios::binary | std::ios::trunc) << contents;
+			Track(Path(relative));
+		}
+
+		// Saves the way many editors do: write a copy, then rename it over the original.
+		void WriteByRename(const std::string& relative, const std::string& contents)
+		{
+			Write(relative + ".tmp", contents);
+			std::remove(Path(relative).c_str());
+			std::rename(Path(relative + ".tmp").c_str(), Path(relative).c_str());
+		}
+
+		void Remove(const std::string& relative)
+		{
+			std::remove(Path(relative).c_str());
+		}
+
+	private:
+		void Track(const std::string& path)
+		{
+			if(std::find(mFiles.begin(), mFiles.end(), path) == mFiles.end())
+				mFiles.push_back(path);
+		}
+
+		std::string mRoot;
+		std::vector<std::string> mFiles;
+	};
+
+	struct FakeClock
+	{
+		std::int64_t Now = 50 * Ms;
+
+		FileWatcher::ClockFunction Clock()
+		{
+			return [this] { return Now; };
+		}
+	};
+
+	std::vector<std::string> Poll(FileWatcher& watcher)
+	{
+		std::vector<std::string> changed;
+		watcher.Poll(changed);
+		return changed;
+	}
+}
+
+TEST(NormalizesPaths)
+{
+	CHECK_EQUAL(FileWatcher::NormalizePath("Shaders\\Default1.hlsl"), std::string("Shaders/Default1.hlsl"));
+	CHECK_EQUAL(FileWatcher::NormalizePath("././Textures/one.dds"), std::string("Textures/one.dds"));
+	CHECK_EQUAL(FileWatcher::NormalizePath(".\\a\\b"), std::string("a/b"));
+	CHECK_EQUAL(FileWatcher::NormalizePath("../up/file"), std::string("../up/file"));
+}
+
+#ifdef __linux__
+TEST(NotificationsReportOnceAfterSettling)
+{
+	Scratch scratch("FileWatcherTests");
+	scratch.Write("shader.hlsl", "v1");
+	scratch.Write("other.hlsl", "v1");
+
+	FakeClock clock;
+	FileWatcher watcher(FileWatcher::Config(), clock.Clock());
+	REQUIRE(watcher.UsesNotifications());
+	REQUIRE(watcher.Watch("./" + scratch.Path("shader.hlsl")));
+	CHECK(watcher.Watch(scratch.Path("shader.hlsl")));
+	CHECK_EQUAL(watcher.WatchedCount(), 1u);
+	CHECK(Poll(watcher).empty());
+
+	// The event is stamped at the poll that reads it and reported 100 ms later.
+	scratch.Write("shader.hlsl", "v2");
+	CHECK(Poll(watcher).empty());
+	clock.Now += 99 * Ms;
+	CHECK(Poll(watcher).empty());
+	clock.Now += 1 * Ms;
+	const std::vector<std::string> changed = Poll(watcher);
+	REQUIRE(changed.size() == 1u);
+	CHECK_EQUAL(changed[0], scratch.Path("shader.hlsl"));
+
+	clock.Now += 500 * Ms;
+	CHECK(Poll(watcher).empty());
+
+	// A file in the same directory that is not watched is never reported.
+	scratch.Write("other.hlsl", "v2");
+	CHECK(Poll(watcher).empty());
+	clock.Now += 500 * Ms;
+	CHECK(Poll(watcher).empty());
+}
+
+TEST(NotificationsCoalesceABurstOfWrites)
+{
+	Scratch scratch("FileWatcherTests");
+	scratch.Write("texture.dds", "0");
+
+	FakeClock clock;
+	FileWatcher watcher(FileWatcher::Config(), clock.Clock());
+	REQUIRE(watcher.UsesNotifications());
+	REQUIRE(watcher.Watch(scratch.Path("texture.dds")));
+
+	// Five writes 60 ms apart: each restarts the settle time, so nothing is reported
+	// until 100 ms after the last, and then only once.
+	std::vector<std::string> changed;
+	for(int i = 1; i <= 5; ++i)
+	{
+		scratch.Write("texture.dds", std::string((std::size_t)i * 100, 'x'));
+		watcher.Poll(changed);
+		clock.Now += 60 * Ms;
+		watcher.Poll(changed);
+	}
+	CHECK(changed.empty());
+
+	clock.Now += 40 * Ms;
+	watcher.Poll(changed);
+	CHECK_EQUAL(changed.size(), 1u);
+	clock.Now += 1000 * Ms;
+	watcher.Poll(changed);
+	CHECK_EQUAL(changed.size(), 1u);
+
+	// A save by rename over the file is one change too.
+	changed.clear();
+	scratch.WriteByRename("texture.dds", "renamed");
+	watcher.Poll(changed);
+	clock.Now += 100 * Ms;
+	watcher.Poll(changed);
+	REQUIRE(changed.size() == 1u);
+	CHECK_EQUAL(changed[0], scratch.Path("texture.dds"));
+}
+#endif
+
+TEST(PollingFallbackComparesTimestamps)
+{
+	Scratch scratch("FileWatcherTests");
+	scratch.Write("mesh.txt", "1");
+
+	FileWatcher::Config config;
+	config.ForcePolling = true;
+	FakeClock clock;
+	FileWatcher watcher(config, clock.Clock());
+	CHECK(!watcher.UsesNotifications());
+	REQUIRE(watcher.Watch(scratch.Path("mesh.txt")));
+	CHECK(Poll(watcher).empty());
+
+	// The sizes differ, so the change shows even where timestamps are coarse.  It is
+	// not looked for until the 250 ms poll interval has passed.
+	scratch.Write("mesh.txt", "22");
+	clock.Now += 200 * Ms;
+	CHECK(Poll(watcher).empty());
+	clock.Now += 50 * Ms;
+	CHECK(Poll(watcher).empty());
+	clock.Now += 99 * Ms;
+	CHECK(Poll(watcher).empty());
+	clock.Now += 1 * Ms;
+	std::vector<std::string> changed = Poll(watcher);
+	REQUIRE(changed.size() == 1u);
+	CHECK_EQUAL(changed[0], scratch.Path("mesh.txt"));
+
+	// Unchanged: nothing more, however many polls.
+	for(int i = 0; i < 10; ++i)
+	{
+		clock.Now += 250 * Ms;
+		CHECK(Poll(watcher).empty());
+	}
+
+	// Missing mid-save is not a change; the file coming back is.
+	scratch.Remove("mesh.txt");
+	clock.Now += 250 * Ms;
+	CHECK(Poll(watcher).empty());
+	clock.Now += 250 * Ms;
+	CHECK(Poll(watcher).empty());
+	scratch.Write("mesh.txt", "333");
+	clock.Now += 250 * Ms;
+	CHECK(Poll(watcher).empty());
+	clock.Now += 100 * Ms;
+	CHECK_EQUAL(Poll(watcher).size(), 1u);
+}
+
+TEST(UnwatchableDirectoryIsRefused)
+{
+	// Only notifications need the directory up front; polling waits for the file.
+	FileWatcher watcher;
+	if(watcher.UsesNotifications())
+	{
+		CHECK(!watcher.Watch("FileWatcherTests-missing-directory/file.txt"));
+		CHECK_EQUAL(watcher.WatchedCount(), 0u);
+	}
+}
@@ -0,0 +1,346 @@
+//***************************************************************************************
+// FrameMetricsTests.cpp
+//
+// HdrHistogram precision and percentiles against a sorted reference, and FrameMetrics
+// driven by a virtual GPU timeline: a FrameFence whose waits advance a virtual clock,
+// so the fence wait, CPU time, frame time and input latency of every frame are known
+// exactly.  The CSV and JSON lines sinks are checked line by line, and MeasureHeadless
+// runs once against the real-time SimulatedGpu.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "FrameFence.h"
+#include "FrameMetrics.h"
+#include "HdrHistogram.h"
+#include "Random.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const std::int64_t NsPerMs = 1000000;
+
+	// A GPU on a virtual clock.  Batches run back to back; waiting for one moves the
+	// clock to its completion.
+	class VirtualGpu : public FrameFence
+	{
+	public:
+		// Waiting is const in the FrameFence interface but moves the clock.
+		mutable std::int64_t Now = 1000 * NsPerMs;
+
+		std::uint64_t Submit(double workMs)
+		{
+			std::int64_t start = std::max(Now, mCompletions.empty() ? Now : mCompletions.back());
+			mCompletions.push_back(start + (std::int64_t)(workMs * NsPerMs));
+			return mCompletions.size();
+		}
+
+		void Advance(double ms) { Now += (std::int64_t)(ms * NsPerMs); }
+
+		std::uint64_t CompletedValue()const override
+		{
+			return (std::uint64_t)(std::upper_bound(mCompletions.begin(), mCompletions.end(), Now) - mCompletions.begin());
+		}
+
+		double WaitForValue(std::uint64_t value)const override
+		{
+			if(value == 0 || value > mCompletions.size() || mCompletions[value - 1] <= Now)
+				return 0.0;
+
+			const std::int64_t waited = mCompletions[value - 1] - Now;
+			Now = mCompletions[value - 1];
+			return (double)waited / NsPerMs;
+		}
+
+	private:
+		std::vector<std::int64_t> mCompletions;
+	};
+
+	// The demo's frame: wait for the frame resource, CPU work, submit, Present.
+	void RunFrames(FrameMetrics& metrics, VirtualGpu& gpu, std::vector<std::uint64_t>& fences,
+		double cpuMs, double gpuMs, double presentMs, std::uint32_t frames)
+	{
+		const FrameFence& fence = gpu;
+		for(std::uint32_t i = 0; i < frames; ++i)
+		{
+			metrics.BeginFrame(gpu.Now);
+
+			std::uint64_t& frameFence = fences[metrics.FrameCount() % fences.size()];
+			if(fence.CompletedValue() < frameFence)
+				metrics.AddFenceWait(fence.WaitForValue(frameFence));
+
+			gpu.Advance(cpuMs);
+			frameFence = gpu.Submit(gpuMs);
+
+			gpu.Advance(presentMs);
+			metrics.AddPresent(presentMs);
+			metrics.EndFrame(gpu.Now);
+		}
+	}
+
+	std::vector<std::string> Lines(const std::string& text)
+	{
+		std::vector<std::string> lines;
+		std::istringstream in(text);
+		std::string line;
+		while(std::getline(in, line))
+			lines.push_back(line);
+		return lines;
+	}
+}
+
+TEST(HistogramIsExactForSmallValues)
+{
+	HdrHistogram h;
+	for(std::uint64_t v = 0; v < 128; ++v)
+	{
+		CHECK_EQUAL(HdrHistogram::BucketIndex(v), (std::uint32_t)v);
+		CHECK_EQUAL(HdrHistogram::BucketHighestValue((std::uint32_t)v), v);
+		h.Record(v);
+	}
+
+	CHECK_EQUAL(h.TotalCount(), 128u);
+	CHECK_EQUAL(h.Min(), 0u);
+	CHECK_EQUAL(h.Max(), 127u);
+	CHECK_NEAR(h.Mean(), 63.5, 1e-9);
+	CHECK_EQUAL(h.ValueAtPercentile(50.0), 63u);
+	CHECK_EQUAL(h.ValueAtPercentile(100.0), 127u);
+	CHECK_EQUAL(h.ValueAtPercentile(0.0), 0u);
+}
+
+TEST(HistogramBucketsKeepRelativePrecision)
+{
+	// Every value lands in a bucket whose highest value is at most 1/64 above it, and
+	// buckets are ordered like the values.
+	Pcg32 rng(88, 1);
+	std::uint64_t prevValue = 0;
+	std::uint32_t prevIndex = 0;
+	bool precise = true;
+	bool ordered = true;
+	for(int i = 0; i < 200000; ++i)
+	{
+		const std::uint32_t bits = rng.NextBounded(64);
+		std::uint64_t value = ((std::uint64_t)rng.Next() << 32 | rng.Next()) >> bits;
+		if(i % 2 == 0)
+			value = prevValue + rng.NextBounded(1000);
+
+		const std::uint32_t index = HdrHistogram::BucketIndex(value);
+		const std::uint64_t highest = HdrHistogram::BucketHighestValue(index);
+		precise = precise && highest >= value && (double)(highest - value) <= (double)value / 64.0;
+		ordered = ordered && (value < prevValue || index >= prevIndex);
+
+		prevValue = value;
+		prevIndex = index;
+	}
+	CHECK(precise);
+	CHECK(ordered);
+
+	CHECK_EQUAL(HdrHistogram::BucketHighestValue(HdrHistogram::BucketIndex(~0ull)), ~0ull);
+}
+
+TEST(PercentilesMatchSortedReference)
+{
+	Pcg32 rng(88, 2);
+	HdrHistogram h;
+	std::vector<std::uint64_t> values;
+
+	// Frame times in microseconds: mostly around 16 ms with a long tail of hitches.
+	for(int i = 0; i < 50000; ++i)
+	{
+		std::uint64_t us = 15000 + rng.NextBounded(3000);
+		if(rng.NextBounded(100) == 0)
+			us += rng.NextBounded(200000);
+		values.push_back(us);
+		h.Record(us);
+	}
+	std::sort(values.begin(), values.end());
+
+	bool within = true;
+	for(double percent : { 1.0, 10.0, 50.0, 90.0, 99.0, 99.9, 99.99, 100.0 })
+	{
+		const std::size_t rank = (std::size_t)std::ceil(percent / 100.0 * values.size());
+		const std::uint64_t exact = values[std::max<std::size_t>(rank, 1) - 1];
+		const std::uint64_t reported = h.ValueAtPercentile(percent);
+		within = within && reported >= exact && (double)(reported - exact) <= (double)exact / 64.0;
+	}
+	CHECK(within);
+	CHECK_EQUAL(h.Max(), values.back());
+	CHECK_EQUAL(h.ValueAtPercentile(100.0), values.back());
+}
+
+TEST(MergeEqualsRecordingEverything)
+{
+	Pcg32 rng(88, 3);
+	HdrHistogram a, b, all;
+	for(int i = 0; i < 10000; ++i)
+	{
+		const std::uint64_t v = rng.NextBounded(1u << 20);
+		(i % 3 == 0 ? a : b).Record(v, 2);
+		all.Record(v, 2);
+	}
+
+	a.Merge(b);
+	CHECK_EQUAL(a.TotalCount(), all.TotalCount());
+	CHECK_EQUAL(a.Min(), all.Min());
+	CHECK_EQUAL(a.Max(), all.Max());
+	CHECK_NEAR(a.Mean(), all.Mean(), 1e-6);
+	for(double percent : { 25.0, 50.0, 75.0, 99.0 })
+		CHECK_EQUAL(a.ValueAtPercentile(percent), all.ValueAtPercentile(percent));
+
+	a.Reset();
+	CHECK_EQUAL(a.TotalCount(), 0u);
+	CHECK_EQUAL(a.Min(), 0u);
+	CHECK_EQUAL(a.Max(), 0u);
+	CHECK_EQUAL(a.ValueAtPercentile(50.0), 0u);
+}
+
+TEST(GpuBoundFramesShowFenceWaits)
+{
+	// 4 ms of CPU and 1 ms of Present against 10 ms of GPU per frame, with three frame
+	// resources: once the GPU is three frames behind, each frame waits for the fence
+	// and runs at the GPU's 10 ms.
+	VirtualGpu gpu;
+	std::vector<std::uint64_t> fences(3, 0);
+	FrameMetrics metrics;
+	RunFrames(metrics, gpu, fences, 4.0, 10.0, 1.0, 100);
+
+	CHECK_EQUAL(metrics.FrameCount(), 100u);
+	CHECK_EQUAL(metrics.Histogram(FrameMetrics::FrameTime).TotalCount(), 99u);
+	CHECK_EQUAL(metrics.Histogram(FrameMetrics::InputToPresent).TotalCount(), 0u);
+
+	CHECK_NEAR(metrics.PercentileMs(FrameMetrics::CpuWork, 50.0), 4.0, 1e-9);
+	CHECK_NEAR(metrics.PercentileMs(FrameMetrics::Present, 99.0), 1.0, 1e-9);
+	CHECK_NEAR(metrics.PercentileMs(FrameMetrics::FrameTime, 50.0), 10.0, 1e-9);
+	CHECK_NEAR(metrics.PercentileMs(FrameMetrics::FenceWait, 50.0), 5.0, 1e-9);
+
+	// The first frames run ahead of the GPU without waiting.  Below the maximum,
+	// percentiles are reported to the histogram's 1/64 precision.
+	CHECK_EQUAL(metrics.Histogram(FrameMetrics::FenceWait).Min(), 0u);
+	CHECK_NEAR(metrics.PercentileMs(FrameMetrics::FrameTime, 1.0), 5.0, 5.0 / 64.0);
+
+	const FrameMetrics::Sample& last = metrics.LastSample();
+	CHECK_EQUAL(last.Frame, 99u);
+	CHECK_NEAR(last.Ms[FrameMetrics::FenceWait], 5.0, 1e-9);
+	CHECK_NEAR(last.Ms[FrameMetrics::CpuWork], 4.0, 1e-9);
+	CHECK(last.HasFrameTime);
+	CHECK(!last.HasInput);
+}
+
+TEST(CpuBoundFramesNeverWait)
+{
+	VirtualGpu gpu;
+	std::vector<std::uint64_t> fences(2, 0);
+	FrameMetrics metrics;
+	RunFrames(metrics, gpu, fences, 12.0, 5.0, 0.5, 50);
+
+	CHECK_EQUAL(metrics.Histogram(FrameMetrics::FenceWait).Max(), 0u);
+	CHECK_NEAR(metrics.PercentileMs(FrameMetrics::FrameTime, 99.9), 12.5, 1e-9);
+
+	std::string report = metrics.Report();
+	CHECK(report.find("Frame metrics over 50 frames") != std::string::npos);
+	CHECK(report.find("fence_wait_ms") != std::string::npos);
+}
+
+TEST(InputLatencyRunsFromOldestInput)
+{
+	VirtualGpu gpu;
+	FrameMetrics metrics;
+
+	metrics.BeginFrame(gpu.Now);
+	metrics.NoteInput(gpu.Now - 3 * NsPerMs);
+	metrics.NoteInput(gpu.Now - 7 * NsPerMs);
+	metrics.NoteInput(gpu.Now - 1 * NsPerMs);
+	metrics.NoteInput(0);
+	gpu.Advance(6.0);
+	metrics.EndFrame(gpu.Now);
+
+	CHECK(metrics.LastSample().HasInput);
+	CHECK_NEAR(metrics.LastSample().Ms[FrameMetrics::InputToPresent], 13.0, 1e-9);
+	CHECK(!metrics.LastSample().HasFrameTime);
+
+	// Input does not carry over to the next frame.
+	metrics.BeginFrame(gpu.Now);
+	gpu.Advance(6.0);
+	metrics.EndFrame(gpu.Now);
+	CHECK(!metrics.LastSample().HasInput);
+	CHECK_EQUAL(metrics.Histogram(FrameMetrics::InputToPresent).TotalCount(), 1u);
+
+	metrics.Reset();
+	CHECK_EQUAL(metrics.FrameCount(), 0u);
+	CHECK_EQUAL(metrics.Histogram(FrameMetrics::CpuWork).TotalCount(), 0u);
+}
+
+TEST(SinksWriteOneLinePerFrame)
+{
+	std::ostringstream csv, json;
+	CsvFrameMetricsSink csvSink(csv);
+	JsonLinesFrameMetricsSink jsonSink(json);
+	CHECK(csvSink.IsOpen());
+
+	VirtualGpu gpu;
+	FrameMetrics metrics;
+	metrics.SetSink(&csvSink);
+	metrics.BeginFrame(gpu.Now);
+	metrics.NoteInput(gpu.Now - 2 * NsPerMs);
+	gpu.Advance(3.0);
+	metrics.EndFrame(gpu.Now);
+
+	metrics.SetSink(&jsonSink);
+	metrics.BeginFrame(gpu.Now);
+	gpu.Advance(2.5);
+	metrics.EndFrame(gpu.Now);
+
+	std::vector<std::string> csvLines = Lines(csv.str());
+	REQUIRE(csvLines.size() == 2);
+	CHECK_EQUAL(csvLines[0], std::string("frame,frame_ms,cpu_ms,fence_wait_ms,present_ms,input_to_present_ms"));
+	CHECK_EQUAL(csvLines[1], std::string("0,,3.0000,0.0000,0.0000,5.0000"));
+
+	std::vector<std::string> jsonLines = Lines(json.str());
+	REQUIRE(jsonLines.size() == 1);
+	CHECK_EQUAL(jsonLines[0], std::string("{\"frame\":1,\"frame_ms\":2.5000,\"cpu_ms\":2.5000,"
+		"\"fence_wait_ms\":0.0000,\"present_ms\":0.0000,\"input_to_present_ms\":null}"));
+}
+
+TEST(OpenPicksTheFormatFromTheExtension)
+{
+	const std::string csvPath = "FrameMetricsTests.csv";
+	const std::string jsonPath = "FrameMetricsTests.jsonl";
+
+	FrameMetrics::Sample sample;
+	sample.Frame = 7;
+	{
+		std::unique_ptr<FrameMetricsSink> csv = FrameMetricsSink::Open(csvPath);
+		std::unique_ptr<FrameMetricsSink> json = FrameMetricsSink::Open(jsonPath);
+		REQUIRE(csv->IsOpen() && json->IsOpen());
+		csv->Write(sample);
+		json->Write(sample);
+	}
+
+	std::ifstream csvIn(csvPath), jsonIn(jsonPath);
+	std::string csvHeader, jsonLine;
+	std::getline(csvIn, csvHeader);
+	std::getline(jsonIn, jsonLine);
+	csvIn.close();
+	jsonIn.close();
+	std::remove(csvPath.c_str());
+	std::remove(jsonPath.c_str());
+
+	CHECK_EQUAL(csvHeader.substr(0, 6), std::string("frame,"));
+	CHECK_EQUAL(jsonLine.substr(0, 10), std::string("{\"frame\":7"));
+}
+
+TEST(MeasureHeadlessRunsOnSimulatedGpu)
+{
+	std::ostringstream lines;
+	JsonLinesFrameMetricsSink sink(lines);
+	const std::string report = FrameMetrics::MeasureHeadless(0.5, 2.0, 2, 20, &sink);
+
+	CHECK(report.find("Frame metrics over 20 frames") != std::string::npos);
+	CHECK_EQUAL(Lines(lines.str()).size(), 20u);
+}
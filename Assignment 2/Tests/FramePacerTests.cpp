@@ -0,0 +1,274 @@
+//***************************************************************************************
+// FramePacerTests.cpp
+//
+// The frame pacer against a fake clock: every clock read advances time a little and
+// every sleep wakes late, as OS sleeps do.  A target rate must hold its cadence with
+// little jitter, keep deadlines on the grid after a late frame and start over after a
+// stall instead of bursting.  On-demand pacing must render only after Invalidate, for
+// the settle frames, and at the idle interval.  Mode parsing and the report are
+// checked as well.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "FramePacer.h"
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	const std::int64_t Ms = 1000000;
+
+	// Time only moves when the pacer reads it, sleeps, or the test does work.
+	struct FakeClock
+	{
+		std::int64_t Now = 1000 * Ms;
+		std::int64_t ReadNs = 1000;          // each read costs 1 us
+		std::int64_t OversleepNs = Ms / 2;   // sleeps wake 0.5 ms late
+		std::uint64_t Sleeps = 0;
+
+		FramePacer::ClockFunction Clock()
+		{
+			return [this] { Now += ReadNs; return Now; };
+		}
+
+		FramePacer::SleepFunction Sleep()
+		{
+			return [this](std::int64_t ns) { Sleeps++; Now += ns + OversleepNs; };
+		}
+	};
+
+	FramePacer::Config Parsed(const char* mode)
+	{
+		FramePacer::Config config;
+		FramePacer::ParseMode(mode, config);
+		return config;
+	}
+
+	// Runs frames of workNs each (or per-frame work from the list) and returns the
+	// times at which WaitForNextFrame returned.
+	std::vector<std::int64_t> RunFrames(FramePacer& pacer, FakeClock& clock, const std::vector<std::int64_t>& workNs)
+	{
+		std::vector<std::int64_t> starts;
+		for(std::int64_t work : workNs)
+		{
+			pacer.WaitForNextFrame();
+			starts.push_back(clock.Now);
+			clock.Now += work;
+			pacer.FrameRendered();
+		}
+		return starts;
+	}
+}
+
+TEST(ParsesModes)
+{
+	FramePacer::Config config;
+	CHECK(FramePacer::ParseMode("ondemand", config));
+	CHECK(config.PacingMode == FramePacer::Mode::OnDemand);
+	CHECK(FramePacer::ParseMode("unlimited", config));
+	CHECK(config.PacingMode == FramePacer::Mode::Unlimited);
+	CHECK(FramePacer::ParseMode("144.5", config));
+	CHECK(config.PacingMode == FramePacer::Mode::TargetRate);
+	CHECK_NEAR(config.TargetHz, 144.5, 0.0);
+
+	// Rejected text leaves the config alone.
+	const char* bad[] = { "", "fast", "0", "-30", "60hz", "OnDemand" };
+	for(const char* text : bad)
+	{
+		CHECK(!FramePacer::ParseMode(text, config));
+		CHECK(config.PacingMode == FramePacer::Mode::TargetRate);
+		CHECK_NEAR(config.TargetHz, 144.5, 0.0);
+	}
+}
+
+TEST(TargetRateHoldsItsCadence)
+{
+	FakeClock clock;
+	FramePacer pacer(clock.Clock(), clock.Sleep());
+	pacer.SetConfig(Parsed("60"));
+
+	// 4 ms of work in a 16.67 ms period: the rest is slept, minus the spin margin
+	// that absorbs the late wake-up.
+	const std::vector<std::int64_t> starts = RunFrames(pacer, clock, std::vector<std::int64_t>(600, 4 * Ms));
+
+	const FramePacer::Stats& stats = pacer.GetStats();
+	CHECK_EQUAL(stats.Frames, 600u);
+	CHECK_EQUAL(stats.MissedDeadlines, 0u);
+	CHECK(stats.SleptNs > 0);
+	CHECK(stats.SpunNs > 0);
+	CHECK(clock.Sleeps >= 598u);
+
+	// Every interval is the period to within a few clock reads.
+	CHECK_EQUAL(stats.IntervalUs.TotalCount(), 599u);
+	CHECK(stats.JitterUs.Max() <= 5);
+	CHECK(stats.IntervalUs.Min() >= 16660 && stats.IntervalUs.Max() <= 16672);
+
+	// Frame starts stay on the grid of the first deadline; nothing drifts.
+	const std::int64_t period = 1000000000 / 60;
+	bool onGrid = true;
+	for(std::size_t i = 1; i < starts.size(); ++i)
+	{
+		const std::int64_t late = starts[i] - (starts[0] + (std::int64_t)i * period);
+		onGrid = onGrid && late >= 0 && late <= 5000;
+	}
+	CHECK(onGrid);
+}
+
+TEST(LateFrameKeepsTheGridAndStallRestartsIt)
+{
+	FakeClock clock;
+	FramePacer pacer(clock.Clock(), clock.Sleep());
+	pacer.SetConfig(Parsed("60"));
+	const std::int64_t period = 1000000000 / 60;
+
+	// Frame 10 overruns by 4 ms: its successor misses its deadline, and the one after
+	// is back on the original grid.
+	std::vector<std::int64_t> work(30, 4 * Ms);
+	work[10] = period + 4 * Ms;
+	std::vector<std::int64_t> starts = RunFrames(pacer, clock, work);
+	CHECK_EQUAL(pacer.GetStats().MissedDeadlines, 1u);
+	const std::int64_t drift = starts[20] - (starts[0] + 20 * period);
+	CHECK(drift >= 0 && drift <= 5000);
+
+	// A 100 ms stall is not made up with a burst: the next frames are a period apart.
+	work.assign(10, 4 * Ms);
+	work[0] = 100 * Ms;
+	starts = RunFrames(pacer, clock, work);
+	CHECK_EQUAL(pacer.GetStats().MissedDeadlines, 2u);
+	bool paced = true;
+	for(std::size_t i = 2; i < starts.size(); ++i)
+		paced = paced && starts[i] - starts[i - 1] >= period - 5000;
+	CHECK(paced);
+}
+
+TEST(UnlimitedNeverWaits)
+{
+	FakeClock clock;
+	FramePacer pacer(clock.Clock(), clock.Sleep());
+	pacer.SetConfig(Parsed("unlimited"));
+	CHECK(pacer.ShouldRender());
+	CHECK_EQUAL(pacer.IdleTimeoutNs(), 0);
+
+	RunFrames(pacer, clock, std::vector<std::int64_t>(50, 3 * Ms));
+	const FramePacer::Stats& stats = pacer.GetStats();
+	CHECK_EQUAL(clock.Sleeps, 0u);
+	CHECK_EQUAL(stats.Frames, 50u);
+	CHECK_EQUAL(stats.SleptNs + stats.SpunNs, 0);
+	CHECK_EQUAL(stats.JitterUs.TotalCount(), 0u);
+	CHECK(stats.IntervalUs.Max() <= 3002);
+	CHECK(pacer.ShouldRender());
+}
+
+TEST(OnDemandRendersOnlyWhenNeeded)
+{
+	FakeClock clock;
+	FramePacer pacer(clock.Clock(), clock.Sleep());
+	FramePacer::Config config = Parsed("ondemand");
+	config.SettleFrames = 3;
+	pacer.SetConfig(config);
+
+	// Without an idle interval the loop may block indefinitely.
+	CHECK_EQUAL(pacer.IdleTimeoutNs(), -1);
+
+	// A 10 ms tick of the message loop; returns the frames rendered.
+	auto tick = [&](int ticks)
+	{
+		int rendered = 0;
+		for(int i = 0; i < ticks; ++i)
+		{
+			if(pacer.ShouldRender())
+			{
+				pacer.WaitForNextFrame();
+				clock.Now += Ms;
+				pacer.FrameRendered();
+				rendered++;
+			}
+			clock.Now += 10 * Ms;
+		}
+		return rendered;
+	};
+
+	// SetConfig invalidates: one frame plus the settle frames, then nothing.
+	CHECK_EQUAL(tick(100), 4);
+	CHECK(!pacer.ShouldRender());
+	CHECK_EQUAL(tick(100), 0);
+
+	pacer.Invalidate();
+	CHECK(pacer.ShouldRender());
+	CHECK_EQUAL(tick(100), 4);
+
+	// An Invalidate while settling restarts the settle count.
+	pacer.Invalidate();
+	CHECK_EQUAL(tick(2), 2);
+	pacer.Invalidate();
+	CHECK_EQUAL(tick(100), 4);
+
+	// Another thread can invalidate.
+	std::thread input([&] { pacer.Invalidate(); });
+	input.join();
+	CHECK(pacer.ShouldRender());
+	CHECK_EQUAL(tick(100), 4);
+	CHECK_EQUAL(clock.Sleeps, 0u);
+}
+
+TEST(OnDemandIdleIntervalWakesTheLoop)
+{
+	FakeClock clock;
+	FramePacer pacer(clock.Clock(), clock.Sleep());
+	FramePacer::Config config = Parsed("ondemand");
+	config.SettleFrames = 0;
+	config.IdleIntervalNs = 250 * Ms;
+	pacer.SetConfig(config);
+
+	REQUIRE(pacer.ShouldRender());
+	pacer.FrameRendered();
+	CHECK(!pacer.ShouldRender());
+
+	// The timeout counts down to the idle frame.
+	const std::int64_t first = pacer.IdleTimeoutNs();
+	CHECK(first > 249 * Ms && first <= 250 * Ms);
+	clock.Now += 100 * Ms;
+	const std::int64_t second = pacer.IdleTimeoutNs();
+	CHECK(second > 149 * Ms && second <= 150 * Ms);
+	CHECK(!pacer.ShouldRender());
+
+	clock.Now += 150 * Ms;
+	CHECK(pacer.ShouldRender());
+	CHECK_EQUAL(pacer.IdleTimeoutNs(), 0);
+
+	// Over 10 s of 10 ms ticks: one frame per 250 ms.
+	int rendered = 0;
+	for(int i = 0; i < 1000; ++i)
+	{
+		if(pacer.ShouldRender())
+		{
+			pacer.FrameRendered();
+			rendered++;
+		}
+		clock.Now += 10 * Ms;
+	}
+	CHECK(rendered >= 39 && rendered <= 41);
+}
+
+TEST(ReportAndStats)
+{
+	FakeClock clock;
+	FramePacer pacer(clock.Clock(), clock.Sleep());
+	pacer.SetConfig(Parsed("30"));
+	RunFrames(pacer, clock, std::vector<std::int64_t>(20, 5 * Ms));
+
+	const std::string report = pacer.Report();
+	CHECK(report.find("Frame pacing (target rate, 30.0 Hz): 20 frames") != std::string::npos);
+	CHECK(report.find("interval p50 33.3") != std::string::npos);
+	CHECK(report.find("0 missed deadlines") != std::string::npos);
+
+	// SetConfig restarts the schedule but keeps the stats; ResetStats clears them.
+	pacer.SetConfig(Parsed("unlimited"));
+	CHECK_EQUAL(pacer.GetStats().Frames, 20u);
+	CHECK(pacer.Report().find("Frame pacing (unlimited): 20 frames") != std::string::npos);
+	CHECK(pacer.Report().find("jitter") == std::string::npos);
+	pacer.ResetStats();
+	CHECK_EQUAL(pacer.GetStats().Frames, 0u);
+	CHECK_EQUAL(pacer.GetStats().IntervalUs.TotalCount(), 0u);
+}
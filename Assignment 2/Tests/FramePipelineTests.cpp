@@ -0,0 +1,250 @@
+//***************************************************************************************
+// FramePipelineTests.cpp
+//
+// The simulation/render hand-off run headless against SimulatedGpu: packets arrive in
+// frame order in rotating slots, the producer never runs more than PacketCount frames
+// ahead or touches a slot the render thread holds, Stop unblocks both sides, and a
+// pipelined frame loop costs about max(simulate, render) instead of their sum.
+//
+// The stages sleep rather than spin, so the timing checks hold on a loaded machine
+// with few cores; they only assert bounds with wide margins.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "FramePipeline.h"
+#include "SimulatedGpu.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	double MsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	void SleepMs(double ms)
+	{
+		std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(ms));
+	}
+
+	// A frame loop of the demo's shape: simulate into a packet, then wait for the frame
+	// resource, record and submit.  Returns the wall time in milliseconds.
+	struct FrameLoop
+	{
+		double SimMs = 0.0;
+		double RenderMs = 0.0;
+		double GpuMs = 0.0;
+		std::uint32_t FrameResourceCount = 3;
+		std::uint32_t Frames = 0;
+
+		// Set if a frame resource was reused before the GPU finished with it.
+		bool ReusedEarly = false;
+
+		void Render(SimulatedGpu& gpu, std::vector<std::uint64_t>& fences, std::uint64_t frame)
+		{
+			std::uint64_t& fence = fences[frame % FrameResourceCount];
+			gpu.WaitForValue(fence);
+			if(gpu.CompletedValue() < fence)
+				ReusedEarly = true;
+
+			SleepMs(RenderMs);
+			fence = gpu.Submit(GpuMs);
+		}
+
+		double RunSerial()
+		{
+			SimulatedGpu gpu;
+			std::vector<std::uint64_t> fences(FrameResourceCount, 0);
+
+			const Clock::time_point start = Clock::now();
+			for(std::uint64_t frame = 0; frame < Frames; ++frame)
+			{
+				SleepMs(SimMs);
+				Render(gpu, fences, frame);
+			}
+			return MsSince(start);
+		}
+
+		double RunPipelined()
+		{
+			SimulatedGpu gpu;
+			std::vector<std::uint64_t> fences(FrameResourceCount, 0);
+			FramePipeline pipeline;
+
+			const Clock::time_point start = Clock::now();
+			pipeline.Start([&](std::uint32_t, std::uint64_t) { SleepMs(SimMs); });
+
+			std::uint32_t slot = 0;
+			std::uint64_t frame = 0;
+			for(std::uint32_t i = 0; i < Frames && pipeline.Acquire(slot, frame); ++i)
+			{
+				Render(gpu, fences, frame);
+				pipeline.Release();
+			}
+			const double ms = MsSince(start);
+
+			pipeline.Stop();
+			return ms;
+		}
+	};
+}
+
+TEST(PacketsArriveInFrameOrder)
+{
+	// The producer writes the frame number into its slot; the render thread must see
+	// every frame once, in order, in slot frame % PacketCount, and unchanged while it
+	// holds the slot.
+	std::uint64_t packets[FramePipeline::PacketCount] = {};
+	std::atomic<std::uint64_t> released{ 0 };
+	std::atomic<bool> ranAhead{ false };
+
+	FramePipeline pipeline;
+	pipeline.Start([&](std::uint32_t slot, std::uint64_t frame)
+	{
+		if(frame - released.load() >= FramePipeline::PacketCount)
+			ranAhead = true;
+		packets[slot] = frame;
+	});
+
+	bool inOrder = true;
+	bool slotsRotate = true;
+	bool unchanged = true;
+	for(std::uint64_t i = 0; i < 300; ++i)
+	{
+		std::uint32_t slot = 0;
+		std::uint64_t frame = 0;
+		REQUIRE(pipeline.Acquire(slot, frame));
+
+		inOrder = inOrder && frame == i;
+		slotsRotate = slotsRotate && slot == i % FramePipeline::PacketCount;
+		unchanged = unchanged && packets[slot] == frame;
+
+		// Give the producer time to run ahead; it must not overwrite this slot.
+		if(i % 50 == 0)
+			SleepMs(2.0);
+		unchanged = unchanged && packets[slot] == frame;
+
+		released.store(i + 1);
+		pipeline.Release();
+	}
+	pipeline.Stop();
+
+	CHECK(inOrder);
+	CHECK(slotsRotate);
+	CHECK(unchanged);
+	CHECK(!ranAhead);
+	CHECK_EQUAL(pipeline.GetStats().Frames, 300u);
+}
+
+TEST(ProducerWaitsWhenAllSlotsAreFull)
+{
+	std::atomic<std::uint64_t> produced{ 0 };
+
+	FramePipeline pipeline;
+	pipeline.Start([&](std::uint32_t, std::uint64_t) { produced++; });
+
+	// Nothing is consumed, so the producer fills every slot and then waits.
+	SleepMs(20.0);
+	CHECK_EQUAL(produced.load(), (std::uint64_t)FramePipeline::PacketCount);
+
+	std::uint32_t slot = 0;
+	std::uint64_t frame = 0;
+	REQUIRE(pipeline.Acquire(slot, frame));
+	pipeline.Release();
+	SleepMs(20.0);
+	CHECK_EQUAL(produced.load(), (std::uint64_t)FramePipeline::PacketCount + 1);
+
+	pipeline.Stop();
+	CHECK(pipeline.GetStats().ProducerWaitMs > 0.0);
+}
+
+TEST(StopUnblocksBothSides)
+{
+	FramePipeline pipeline;
+	std::uint32_t slot = 0;
+	std::uint64_t frame = 0;
+	CHECK(!pipeline.Acquire(slot, frame));
+
+	// A producer that never finishes a frame in time: Stop must not wait for the
+	// render thread, and a blocked Acquire must return.
+	pipeline.Start([&](std::uint32_t, std::uint64_t) { SleepMs(50.0); });
+	CHECK(pipeline.IsRunning());
+
+	std::thread stopper([&] { SleepMs(10.0); pipeline.Stop(); });
+	const Clock::time_point start = Clock::now();
+	const bool acquired = pipeline.Acquire(slot, frame);
+	const double waitedMs = MsSince(start);
+	stopper.join();
+	CHECK(!acquired);
+	CHECK(waitedMs < 45.0);
+
+	CHECK(!pipeline.IsRunning());
+	CHECK(!pipeline.Acquire(slot, frame));
+
+	// The pipeline can be started again.
+	std::uint64_t firstFrame = ~0ull;
+	pipeline.Start([&](std::uint32_t, std::uint64_t) {});
+	REQUIRE(pipeline.Acquire(slot, firstFrame));
+	pipeline.Release();
+	pipeline.Stop();
+	CHECK_EQUAL(firstFrame, 0u);
+}
+
+TEST(SimulatedGpuRunsBatchesBackToBack)
+{
+	SimulatedGpu gpu;
+	CHECK_EQUAL(gpu.CompletedValue(), 0u);
+	CHECK_NEAR(gpu.WaitForValue(0), 0.0, 0.0);
+
+	const Clock::time_point start = Clock::now();
+	const std::uint64_t first = gpu.Submit(20.0);
+	const std::uint64_t second = gpu.Submit(20.0);
+	CHECK_EQUAL(first, 1u);
+	CHECK_EQUAL(second, 2u);
+	CHECK(gpu.CompletedValue() < second);
+
+	// The second batch starts when the first ends.
+	gpu.WaitForValue(second);
+	CHECK(MsSince(start) >= 40.0);
+	CHECK_EQUAL(gpu.CompletedValue(), 2u);
+
+	// Values never submitted do not block.
+	CHECK_NEAR(gpu.WaitForValue(100), 0.0, 0.0);
+}
+
+TEST(PipelineOverlapsSimulationAndRendering)
+{
+	FrameLoop loop;
+	loop.SimMs = 6.0;
+	loop.RenderMs = 6.0;
+	loop.GpuMs = 3.0;
+	loop.Frames = 40;
+
+	// Serial frames cost sim + render = 12 ms, pipelined ones max(sim, render) = 6 ms.
+	const double serialMs = loop.RunSerial();
+	const double pipelinedMs = loop.RunPipelined();
+
+	CHECK(serialMs >= loop.Frames * (loop.SimMs + loop.RenderMs));
+	CHECK(pipelinedMs < 0.8 * serialMs);
+	CHECK(!loop.ReusedEarly);
+}
+
+TEST(GpuBoundLoopWaitsForFrameResources)
+{
+	FrameLoop loop;
+	loop.SimMs = 1.0;
+	loop.RenderMs = 1.0;
+	loop.GpuMs = 8.0;
+	loop.FrameResourceCount = 2;
+	loop.Frames = 20;
+
+	// The GPU sets the pace, and no frame resource is reused while still in flight.
+	const double pipelinedMs = loop.RunPipelined();
+	CHECK(pipelinedMs >= (loop.Frames - loop.FrameResourceCount) * loop.GpuMs);
+	CHECK(!loop.ReusedEarly);
+}
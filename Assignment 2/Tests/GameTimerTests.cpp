@@ -0,0 +1,161 @@
+//***************************************************************************************
+// GameTimerTests.cpp
+//
+// GameTimer against a fake clock run through three weeks of 16.6 ms frames with pauses
+// mixed in.  The tick totals must stay exact, the double and 32.32 fixed-point views
+// must agree with them, WrappedTime must stay inside its period, and Reset must forget
+// the paused time.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "GameTimer.h"
+#include "Random.h"
+#include <cmath>
+#include <cstdint>
+
+namespace
+{
+	const std::int64_t Ms = 1000000;
+	const std::int64_t FrameNs = 16600000;
+
+	struct FakeClock
+	{
+		std::int64_t Now = 987654321012345; // an arbitrary origin, as after a long boot
+
+		GameTimer::ClockFunction Clock()
+		{
+			return [this] { return Now; };
+		}
+	};
+
+	// The 32.32 value of ticks, built from the whole seconds and the fraction separately.
+	bool FixedMatches(std::int64_t fixed, std::int64_t ticks)
+	{
+		const std::int64_t seconds = ticks / GameTimer::TicksPerSecond;
+		const double fraction = (double)(ticks % GameTimer::TicksPerSecond) / GameTimer::TicksPerSecond;
+		const double fixedFraction = (double)(fixed & 0xffffffff) / 4294967296.0;
+		return (fixed >> 32) == seconds && std::fabs(fixedFraction - fraction) < 1.0 / 4294967296.0;
+	}
+}
+
+TEST(ThreeWeeksOfFramesWithPauses)
+{
+	FakeClock clock;
+	GameTimer timer(clock.Clock());
+	timer.Reset();
+
+	Pcg32 rng(86);
+	const double period = 6.283185307179586;
+	const std::int64_t frames = 3 * 7 * 24 * 3600 * (std::int64_t)1000 / 16 + 1; // > 3 weeks at 16.6 ms
+	std::int64_t expected = 0;
+	std::uint32_t pauses = 0;
+	bool exact = true;
+	bool precise = true;
+	bool fixed = true;
+	bool wrapped = true;
+
+	for(std::int64_t i = 0; i < frames; ++i)
+	{
+		// About every half hour of frames the game is paused for up to ten minutes; the
+		// frames ticked meanwhile must report no time.
+		if(i % 100000 == 99999)
+		{
+			timer.Stop();
+			const std::int64_t pause = (std::int64_t)rng.NextBounded(600000) * Ms;
+			clock.Now += pause / 2;
+			timer.Tick();
+			exact = exact && timer.DeltaTicks() == 0 && timer.TotalTicks() == expected;
+			clock.Now += pause - pause / 2;
+			timer.Start();
+			pauses++;
+		}
+
+		clock.Now += FrameNs;
+		timer.Tick();
+		expected += FrameNs;
+		exact = exact && timer.DeltaTicks() == FrameNs && timer.TotalTicks() == expected;
+
+		if(i % 4096 == 0)
+		{
+			precise = precise && std::fabs(timer.TotalSeconds() - (double)expected / GameTimer::TicksPerSecond) < 1e-6;
+			fixed = fixed && FixedMatches(timer.TotalTimeFixed(), expected);
+			const double phase = timer.WrappedTime(period);
+			wrapped = wrapped && phase >= 0.0 && phase < period;
+		}
+	}
+
+	CHECK(exact);
+	CHECK(precise);
+	CHECK(fixed);
+	CHECK(wrapped);
+	CHECK(pauses > 1000u);
+	CHECK(expected >= 21 * 24 * 3600 * GameTimer::TicksPerSecond);
+
+	// After three weeks the per-frame float is still the frame time, and the totals
+	// exclude every pause.
+	CHECK_NEAR(timer.DeltaTime(), 0.0166, 1e-8);
+	CHECK_NEAR(timer.DeltaSeconds(), 0.0166, 1e-15);
+	CHECK_EQUAL(timer.TotalTicks(), expected);
+	CHECK(FixedMatches(timer.TotalTimeFixed(), expected));
+	CHECK_NEAR(timer.TotalSeconds(), (double)expected / GameTimer::TicksPerSecond, 1e-6);
+	CHECK_NEAR(timer.WrappedTime(period),
+		(double)(expected % (std::int64_t)(period * GameTimer::TicksPerSecond)) / GameTimer::TicksPerSecond, 1e-12);
+
+	// Reset forgets the paused time: the next frame counts from zero.
+	timer.Reset();
+	CHECK_EQUAL(timer.TotalTicks(), 0);
+	clock.Now += FrameNs;
+	timer.Tick();
+	CHECK_EQUAL(timer.TotalTicks(), FrameNs);
+	CHECK_EQUAL(timer.DeltaTicks(), FrameNs);
+}
+
+TEST(StoppedTimerFreezes)
+{
+	FakeClock clock;
+	GameTimer timer(clock.Clock());
+	timer.Reset();
+	clock.Now += 5 * Ms;
+	timer.Tick();
+
+	// Stopping twice keeps the first stop time; starting twice adds the pause once.
+	timer.Stop();
+	clock.Now += 100 * Ms;
+	timer.Stop();
+	CHECK(timer.Stopped());
+	CHECK_EQUAL(timer.TotalTicks(), 5 * Ms);
+	clock.Now += 100 * Ms;
+	timer.Start();
+	timer.Start();
+	CHECK(!timer.Stopped());
+
+	clock.Now += 7 * Ms;
+	timer.Tick();
+	CHECK_EQUAL(timer.DeltaTicks(), 7 * Ms);
+	CHECK_EQUAL(timer.TotalTicks(), 12 * Ms);
+
+	// A clock that steps backwards gives a zero delta, not a negative one.
+	clock.Now -= 3 * Ms;
+	timer.Tick();
+	CHECK_EQUAL(timer.DeltaTicks(), 0);
+}
+
+TEST(FixedPointConversion)
+{
+	CHECK_EQUAL(GameTimer::TicksToFixed(0), 0);
+	CHECK_EQUAL(GameTimer::TicksToFixed(GameTimer::TicksPerSecond), (std::int64_t)1 << 32);
+	CHECK_EQUAL(GameTimer::TicksToFixed(GameTimer::TicksPerSecond / 2), (std::int64_t)1 << 31);
+	CHECK_EQUAL(GameTimer::TicksToFixed(-GameTimer::TicksPerSecond / 2), -((std::int64_t)1 << 31));
+
+	// Far beyond the ~2 s where ticks * 2^32 would overflow: a year, exactly.
+	const std::int64_t year = (std::int64_t)365 * 24 * 3600;
+	CHECK_EQUAL(GameTimer::TicksToFixed(year * GameTimer::TicksPerSecond), year << 32);
+	CHECK(FixedMatches(GameTimer::TicksToFixed(year * GameTimer::TicksPerSecond + 1), year * GameTimer::TicksPerSecond + 1));
+
+	// A non-positive period has no phase.
+	FakeClock clock;
+	GameTimer timer(clock.Clock());
+	timer.Reset();
+	CHECK_NEAR(timer.WrappedTime(0.0), 0.0, 0.0);
+	CHECK_NEAR(timer.WrappedTime(-1.0), 0.0, 0.0);
+}
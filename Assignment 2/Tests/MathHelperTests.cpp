@@ -0,0 +1,451 @@
+//***************************************************************************************
+// MathHelperTests.cpp
+//
+// MathHelper's random helpers: the thread generators are independent and reseedable,
+// and the unit vector fills give unit length, an even spread over the sphere (uniform
+// z and angle, by chi-square) and, for the Philox fill, the same vectors however the
+// array is split between workers.
+//
+// The batch kernels against DirectXMath one element at a time: bit-exact where the
+// header promises it, to float rounding for the SoA TRS build and against corner-based
+// AABBs.  Counts run past several tails of four, and in == out is allowed.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "MathHelper.h"
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Pearson's statistic for values in [lo, hi) over 64 equal buckets.
+	double ChiSquare64(const std::vector<float>& values, float lo, float hi)
+	{
+		std::vector<double> counts(64, 0.0);
+		for(float v : values)
+		{
+			int bucket = (int)((v - lo) / (hi - lo) * 64.0f);
+			bucket = bucket < 0 ? 0 : (bucket > 63 ? 63 : bucket);
+			counts[bucket] += 1.0;
+		}
+
+		const double expected = values.size() / 64.0;
+		double chi = 0.0;
+		for(double c : counts)
+			chi += (c - expected) * (c - expected) / expected;
+		return chi;
+	}
+
+	// The 0.1% critical value for 63 degrees of freedom.
+	const double ChiSquare63 = 103.4;
+
+	bool SameFloat3(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+
+	bool SameMatrix(const XMFLOAT4X4& a, const XMFLOAT4X4& b)
+	{
+		for(int r = 0; r < 4; ++r)
+		{
+			for(int c = 0; c < 4; ++c)
+			{
+				if(a.m[r][c] != b.m[r][c])
+					return false;
+			}
+		}
+		return true;
+	}
+
+	float MaxDifference(const XMFLOAT4X4& a, const XMFLOAT4X4& b)
+	{
+		float d = 0.0f;
+		for(int r = 0; r < 4; ++r)
+		{
+			for(int c = 0; c < 4; ++c)
+				d = std::fmax(d, std::fabs(a.m[r][c] - b.m[r][c]));
+		}
+		return d;
+	}
+
+	// Arrays of random kernel inputs.
+	struct Inputs
+	{
+		std::vector<XMFLOAT3> Points;
+		std::vector<XMFLOAT4X4> Matrices;
+		std::vector<XMFLOAT3> Scales;
+		std::vector<XMFLOAT4> Rotations;
+		std::vector<XMFLOAT3> Translations;
+		std::vector<BoundingBox> Boxes;
+
+		explicit Inputs(std::size_t count)
+		{
+			Pcg32 rng(count);
+			for(std::size_t i = 0; i < count; ++i)
+			{
+				Points.push_back(XMFLOAT3(rng.NextFloat(-50.0f, 50.0f), rng.NextFloat(-50.0f, 50.0f), rng.NextFloat(-50.0f, 50.0f)));
+				Scales.push_back(XMFLOAT3(rng.NextFloat(0.1f, 4.0f), rng.NextFloat(0.1f, 4.0f), rng.NextFloat(0.1f, 4.0f)));
+				Translations.push_back(XMFLOAT3(rng.NextFloat(-100.0f, 100.0f), rng.NextFloat(-100.0f, 100.0f), rng.NextFloat(-100.0f, 100.0f)));
+
+				XMFLOAT4 q;
+				XMStoreFloat4(&q, XMQuaternionNormalize(XMVectorSet(rng.NextFloat(-1.0f, 1.0f),
+					rng.NextFloat(-1.0f, 1.0f), rng.NextFloat(-1.0f, 1.0f), rng.NextFloat(-1.0f, 1.0f))));
+				Rotations.push_back(q);
+
+				XMFLOAT4X4 m;
+				for(int r = 0; r < 4; ++r)
+				{
+					for(int c = 0; c < 4; ++c)
+						m.m[r][c] = rng.NextFloat(-2.0f, 2.0f);
+				}
+				Matrices.push_back(m);
+
+				Boxes.push_back(BoundingBox(Points.back(), Scales.back()));
+			}
+		}
+	};
+
+	// An affine world matrix with rotation, non-uniform scale and translation, and a
+	// projective one whose w varies per point.
+	XMMATRIX AffineMatrix()
+	{
+		return XMMatrixScaling(1.5f, 0.5f, 2.0f) * XMMatrixRotationRollPitchYaw(0.3f, -1.1f, 2.0f) *
+			XMMatrixTranslation(4.0f, -7.0f, 12.0f);
+	}
+
+	XMMATRIX ProjectiveMatrix()
+	{
+		return XMMatrixLookAtLH(XMVectorSet(5.0f, 80.0f, -120.0f, 1.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) *
+			XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 1.0f, 1000.0f);
+	}
+
+	void Split(const std::vector<XMFLOAT3>& v, std::vector<float>& x, std::vector<float>& y, std::vector<float>& z)
+	{
+		x.clear();
+		y.clear();
+		z.clear();
+		for(const XMFLOAT3& p : v)
+		{
+			x.push_back(p.x);
+			y.push_back(p.y);
+			z.push_back(p.z);
+		}
+	}
+
+	MathHelper::Float3Arrays Arrays(std::vector<float>& x, std::vector<float>& y, std::vector<float>& z)
+	{
+		MathHelper::Float3Arrays a;
+		a.X = x.data();
+		a.Y = y.data();
+		a.Z = z.data();
+		return a;
+	}
+
+	const std::size_t Counts[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 33, 1000 };
+
+	bool SameVectors(const std::vector<XMFLOAT3>& a, const std::vector<XMFLOAT3>& b)
+	{
+		if(a.size() != b.size())
+			return false;
+		for(std::size_t i = 0; i < a.size(); ++i)
+		{
+			if(a[i].x != b[i].x || a[i].y != b[i].y || a[i].z != b[i].z)
+				return false;
+		}
+		return true;
+	}
+
+	// Unit length, mean near the origin, and uniform z and angle about z, which is what
+	// an even spread over the sphere means.
+	void CheckSpread(const std::vector<XMFLOAT3>& v)
+	{
+		std::vector<float> zs;
+		std::vector<float> angles;
+		double maxLengthError = 0.0;
+		double mean[3] = {};
+		for(const XMFLOAT3& p : v)
+		{
+			const double length = std::sqrt((double)p.x * p.x + (double)p.y * p.y + (double)p.z * p.z);
+			maxLengthError = std::fmax(maxLengthError, std::fabs(length - 1.0));
+			mean[0] += p.x;
+			mean[1] += p.y;
+			mean[2] += p.z;
+			zs.push_back(p.z);
+			angles.push_back(std::atan2(p.y, p.x));
+		}
+
+		CHECK(maxLengthError < 1e-5);
+		for(double m : mean)
+			CHECK(std::fabs(m / v.size()) < 0.01);
+		CHECK(ChiSquare64(zs, -1.0f, 1.0f) < ChiSquare63);
+		CHECK(ChiSquare64(angles, -XM_PI, XM_PI) < ChiSquare63);
+	}
+}
+
+TEST(ThreadGeneratorsAreIndependent)
+{
+	// A reseeded thread repeats its sequence, whatever other threads draw meanwhile.
+	MathHelper::SeedThreadRandom(5, 9);
+	std::vector<int> first;
+	for(int i = 0; i < 16; ++i)
+		first.push_back(MathHelper::Rand(0, 1000));
+
+	std::vector<int> other;
+	std::thread worker([&]
+	{
+		for(int i = 0; i < 16; ++i)
+			other.push_back(MathHelper::Rand(0, 1000));
+	});
+	worker.join();
+
+	MathHelper::SeedThreadRandom(5, 9);
+	std::vector<int> again;
+	for(int i = 0; i < 16; ++i)
+		again.push_back(MathHelper::Rand(0, 1000));
+
+	CHECK(first == again);
+	CHECK(first != other);
+
+	bool inRange = true;
+	for(int i = 0; i < 1000; ++i)
+	{
+		const float f = MathHelper::RandF(2.0f, 4.0f);
+		inRange = inRange && f >= 2.0f && f <= 4.0f && MathHelper::RandF() < 1.0f;
+	}
+	CHECK(inRange);
+}
+
+TEST(RandUnitVec3CoversTheSphere)
+{
+	MathHelper::SeedThreadRandom(17, 0);
+	std::vector<XMFLOAT3> v(100000);
+	for(XMFLOAT3& p : v)
+		XMStoreFloat3(&p, MathHelper::RandUnitVec3());
+	CheckSpread(v);
+
+	// Hemisphere vectors all face n.
+	const XMVECTOR n = XMVector3Normalize(XMVectorSet(1.0f, 2.0f, -1.0f, 0.0f));
+	bool facing = true;
+	for(int i = 0; i < 10000; ++i)
+		facing = facing && XMVectorGetX(XMVector3Dot(n, MathHelper::RandHemisphereUnitVec3(n))) >= 0.0f;
+	CHECK(facing);
+}
+
+TEST(FillUnitVec3CoversTheSphere)
+{
+	std::vector<XMFLOAT3> v(100003);
+
+	Xoshiro128x4 rng(31);
+	MathHelper::FillUnitVec3(rng, v.data(), v.size());
+	CheckSpread(v);
+
+	MathHelper::FillUnitVec3(31, 0, v.data(), v.size());
+	CheckSpread(v);
+}
+
+TEST(PhiloxUnitVectorsDoNotDependOnTheSplit)
+{
+	const std::uint64_t seed = 0x1234;
+	std::vector<XMFLOAT3> serial(1000);
+	MathHelper::FillUnitVec3(seed, 0, serial.data(), serial.size());
+
+	// Uneven parts, each filled as a worker would.
+	std::vector<XMFLOAT3> parts(serial.size());
+	const std::size_t sizes[] = { 1, 3, 64, 65, 130, 7 };
+	std::size_t begin = 0;
+	for(std::size_t i = 0; begin < parts.size(); ++i)
+	{
+		std::size_t count = sizes[i % 6];
+		count = count < parts.size() - begin ? count : parts.size() - begin;
+		MathHelper::FillUnitVec3(seed, begin, parts.data() + begin, count);
+		begin += count;
+	}
+	CHECK(SameVectors(serial, parts));
+
+	// Xoshiro fills repeat for a repeated seed.
+	std::vector<XMFLOAT3> a(333);
+	std::vector<XMFLOAT3> b(333);
+	Xoshiro128x4 ra(8);
+	Xoshiro128x4 rb(8);
+	MathHelper::FillUnitVec3(ra, a.data(), a.size());
+	MathHelper::FillUnitVec3(rb, b.data(), b.size());
+	CHECK(SameVectors(a, b));
+}
+
+TEST(PointKernelsMatchPerElementTransforms)
+{
+	const XMMATRIX matrices[] = { AffineMatrix(), ProjectiveMatrix() };
+	bool aos = true;
+	bool soa = true;
+	bool inPlace = true;
+
+	for(const XMMATRIX& m : matrices)
+	{
+		for(std::size_t count : Counts)
+		{
+			const Inputs in(count);
+			std::vector<XMFLOAT3> points(count);
+			std::vector<XMFLOAT3> normals(count);
+			MathHelper::TransformPoints(in.Points.data(), points.data(), count, m);
+			MathHelper::TransformNormals(in.Points.data(), normals.data(), count, m);
+
+			std::vector<float> x, y, z;
+			Split(in.Points, x, y, z);
+			std::vector<float> px(count), py(count), pz(count);
+			std::vector<float> nx(count), ny(count), nz(count);
+			MathHelper::TransformPoints(Arrays(x, y, z), Arrays(px, py, pz), count, m);
+			MathHelper::TransformNormals(Arrays(x, y, z), Arrays(nx, ny, nz), count, m);
+
+			for(std::size_t i = 0; i < count; ++i)
+			{
+				const XMVECTOR v = XMLoadFloat3(&in.Points[i]);
+				XMFLOAT3 point, normal;
+				XMStoreFloat3(&point, XMVector3TransformCoord(v, m));
+				XMStoreFloat3(&normal, XMVector3TransformNormal(v, m));
+
+				aos = aos && SameFloat3(points[i], point) && SameFloat3(normals[i], normal);
+				soa = soa && SameFloat3(XMFLOAT3(px[i], py[i], pz[i]), point) && SameFloat3(XMFLOAT3(nx[i], ny[i], nz[i]), normal);
+			}
+
+			// Transforming in place gives the same results.
+			std::vector<XMFLOAT3> same = in.Points;
+			MathHelper::TransformPoints(same.data(), same.data(), count, m);
+			MathHelper::TransformPoints(Arrays(x, y, z), Arrays(x, y, z), count, m);
+			for(std::size_t i = 0; i < count; ++i)
+				inPlace = inPlace && SameFloat3(same[i], points[i]) && SameFloat3(XMFLOAT3(x[i], y[i], z[i]), points[i]);
+		}
+	}
+
+	CHECK(aos);
+	CHECK(soa);
+	CHECK(inPlace);
+}
+
+TEST(AabbKernelsMatchEachOtherAndTheCorners)
+{
+	const XMMATRIX m = AffineMatrix();
+	const std::size_t count = 1000;
+	const Inputs in(count);
+
+	std::vector<BoundingBox> one(count);
+	std::vector<BoundingBox> perWorld(count);
+	std::vector<XMFLOAT4X4> worlds(count);
+	for(XMFLOAT4X4& w : worlds)
+		XMStoreFloat4x4(&w, m);
+	MathHelper::TransformAabbs(in.Boxes.data(), one.data(), count, m);
+	MathHelper::TransformAabbs(in.Boxes.data(), worlds.data(), perWorld.data(), count);
+
+	std::vector<XMFLOAT3> centers, extents;
+	for(const BoundingBox& b : in.Boxes)
+	{
+		centers.push_back(b.Center);
+		extents.push_back(b.Extents);
+	}
+	std::vector<float> cx, cy, cz, ex, ey, ez;
+	Split(centers, cx, cy, cz);
+	Split(extents, ex, ey, ez);
+	std::vector<float> ocx(count), ocy(count), ocz(count), oex(count), oey(count), oez(count);
+	MathHelper::TransformAabbs(Arrays(cx, cy, cz), Arrays(ex, ey, ez), Arrays(ocx, ocy, ocz), Arrays(oex, oey, oez), count, m);
+
+	bool same = true;
+	float cornerError = 0.0f;
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		same = same && SameFloat3(one[i].Center, perWorld[i].Center) && SameFloat3(one[i].Extents, perWorld[i].Extents);
+		same = same && SameFloat3(one[i].Center, XMFLOAT3(ocx[i], ocy[i], ocz[i]));
+		same = same && SameFloat3(one[i].Extents, XMFLOAT3(oex[i], oey[i], oez[i]));
+
+		// Arvo's box is the box of the eight transformed corners.
+		BoundingBox corners;
+		in.Boxes[i].Transform(corners, m);
+		const float d[6] = {
+			one[i].Center.x - corners.Center.x, one[i].Center.y - corners.Center.y, one[i].Center.z - corners.Center.z,
+			one[i].Extents.x - corners.Extents.x, one[i].Extents.y - corners.Extents.y, one[i].Extents.z - corners.Extents.z };
+		for(float e : d)
+			cornerError = std::fmax(cornerError, std::fabs(e));
+	}
+	CHECK(same);
+	CHECK(cornerError < 1e-3f);    // coordinates reach a few hundred
+}
+
+TEST(MatrixKernelsMatchDirectXMath)
+{
+	bool multiply = true;
+	bool multiplyOne = true;
+	bool transpose = true;
+	bool trs = true;
+	float soaError = 0.0f;
+
+	const XMMATRIX right = AffineMatrix();
+	for(std::size_t count : Counts)
+	{
+		const Inputs a(count);
+		const Inputs b(count + 1);
+
+		std::vector<XMFLOAT4X4> products(count);
+		std::vector<XMFLOAT4X4> byOne(count);
+		std::vector<XMFLOAT4X4> transposed(count);
+		MathHelper::MultiplyMatrices(a.Matrices.data(), b.Matrices.data(), products.data(), count);
+		MathHelper::MultiplyMatrices(a.Matrices.data(), right, byOne.data(), count);
+		MathHelper::TransposeMatrices(a.Matrices.data(), transposed.data(), count);
+
+		std::vector<XMFLOAT4X4> built(count);
+		std::vector<XMFLOAT4X4> builtSoa(count);
+		MathHelper::BuildTrsMatrices(a.Scales.data(), a.Rotations.data(), a.Translations.data(), built.data(), count);
+
+		std::vector<float> sx, sy, sz, tx, ty, tz;
+		Split(a.Scales, sx, sy, sz);
+		Split(a.Translations, tx, ty, tz);
+		std::vector<float> qx, qy, qz, qw;
+		for(const XMFLOAT4& q : a.Rotations)
+		{
+			qx.push_back(q.x);
+			qy.push_back(q.y);
+			qz.push_back(q.z);
+			qw.push_back(q.w);
+		}
+		MathHelper::Float4Arrays rotation;
+		rotation.X = qx.data();
+		rotation.Y = qy.data();
+		rotation.Z = qz.data();
+		rotation.W = qw.data();
+		MathHelper::BuildTrsMatrices(Arrays(sx, sy, sz), rotation, Arrays(tx, ty, tz), builtSoa.data(), count);
+
+		for(std::size_t i = 0; i < count; ++i)
+		{
+			const XMMATRIX ma = XMLoadFloat4x4(&a.Matrices[i]);
+			XMFLOAT4X4 expected;
+
+			XMStoreFloat4x4(&expected, XMMatrixMultiply(ma, XMLoadFloat4x4(&b.Matrices[i])));
+			multiply = multiply && SameMatrix(products[i], expected);
+
+			XMStoreFloat4x4(&expected, XMMatrixMultiply(ma, right));
+			multiplyOne = multiplyOne && SameMatrix(byOne[i], expected);
+
+			XMStoreFloat4x4(&expected, XMMatrixTranspose(ma));
+			transpose = transpose && SameMatrix(transposed[i], expected);
+
+			XMStoreFloat4x4(&expected,
+				XMMatrixScalingFromVector(XMLoadFloat3(&a.Scales[i])) *
+				XMMatrixRotationQuaternion(XMLoadFloat4(&a.Rotations[i])) *
+				XMMatrixTranslationFromVector(XMLoadFloat3(&a.Translations[i])));
+			trs = trs && SameMatrix(built[i], expected);
+			soaError = std::fmax(soaError, MaxDifference(builtSoa[i], expected));
+		}
+
+		// In place, as the constant buffer upload does.
+		std::vector<XMFLOAT4X4> same = a.Matrices;
+		MathHelper::TransposeMatrices(same.data(), same.data(), count);
+		for(std::size_t i = 0; i < count; ++i)
+			transpose = transpose && SameMatrix(same[i], transposed[i]);
+	}
+
+	CHECK(multiply);
+	CHECK(multiplyOne);
+	CHECK(transpose);
+	CHECK(trs);
+	CHECK(soaError < 1e-4f);    // translations reach 100, scales 4
+}
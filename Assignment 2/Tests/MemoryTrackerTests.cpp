@@ -0,0 +1,245 @@
+//***************************************************************************************
+// MemoryTrackerTests.cpp
+//
+// MemoryTracker's replacement operator new, so this executable links MemoryTracker.cpp
+// and nothing else may.  Bytes and blocks must be charged to the MemoryScope tag of
+// the allocating thread and returned on free from any thread.  A warmed-up frame loop
+// of the demo's shape (TaskPool, ParallelRecorder, a LinearArena draw list) must pass
+// FrameAllocationCheck, and a frame that allocates must fail it with the allocating
+// function named in the report.  Symbol names need the executable's symbols exported.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "MemoryTracker.h"
+#include "LinearArena.h"
+#include "ParallelRecorder.h"
+#include "TaskPool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Outside the anonymous namespace and never inlined, so the site report can name it.
+#if defined(_MSC_VER)
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+std::vector<int>* AllocateInFrame()
+{
+	return new std::vector<int>(64);
+}
+
+namespace
+{
+	const std::uint32_t ItemCount = 5000;
+
+	// Blocks stored here escape, so the compiler cannot elide their new/delete pair.
+	void* volatile gEscaped = nullptr;
+
+	// Per-item costs, draw list and ranges persist across frames; the frame itself only
+	// resets, refills and records them, as the demo's Draw does.
+	struct FrameLoop
+	{
+		TaskPool Pool{ 3 };
+		ParallelRecorder Recorder{ Pool };
+		LinearArena FrameArena;
+		std::vector<std::uint32_t> Costs;
+		std::vector<ParallelRecorder::Range> Ranges;
+		std::vector<float> Simulated;
+		ArenaVector<std::uint32_t>* DrawList = nullptr;
+		ParallelRecorder::RecordCallback Record;
+		TaskPool::TaskCallback Simulate;
+		std::uint64_t Draws = 0;
+
+		FrameLoop() : Costs(ItemCount, 1), Simulated(ItemCount, 0.0f)
+		{
+			Record = [this](CommandStream& stream, std::uint32_t begin, std::uint32_t end)
+			{
+				stream.Reset();
+				stream.SetPipeline(1);
+				for(std::uint32_t i = begin; i < end; ++i)
+				{
+					stream.SetRootConstant(1, (*DrawList)[i]);
+					stream.DrawIndexed(36, 1, 0, 0, 0);
+				}
+			};
+
+			// Per-item work with scratch temporaries on every pool thread.
+			Simulate = [this](std::uint32_t index, std::uint32_t)
+			{
+				ScratchScope scope;
+				ArenaVector<float> samples{ ArenaAllocator<float>(scope.Arena()) };
+				samples.reserve(8);
+				for(std::uint32_t i = 0; i < 8; ++i)
+					samples.push_back((float)(index + i));
+				Simulated[index] = samples[index % 8];
+			};
+
+			// Each thread's scratch arena gets its block on first use, and ParallelFor does
+			// not promise every thread an index during warm-up.  Hold each task until all
+			// have started, so every thread runs exactly one and touches its arena.
+			std::atomic<std::uint32_t> started{ 0 };
+			Pool.ParallelFor(Pool.ThreadCount(), [&started, this](std::uint32_t, std::uint32_t)
+			{
+				started.fetch_add(1);
+				while(started.load() < Pool.ThreadCount())
+					std::this_thread::yield();
+				ScratchScope scope;
+				scope.Arena().Allocate(1);
+			});
+		}
+
+		void Frame(std::uint64_t frame)
+		{
+			FrameArena.Reset();
+			ArenaVector<std::uint32_t> drawList{ ArenaAllocator<std::uint32_t>(FrameArena) };
+			drawList.reserve(ItemCount);
+			for(std::uint32_t i = 0; i < ItemCount; ++i)
+			{
+				if((i + frame) % 7 != 0)
+					drawList.push_back(i);
+			}
+			DrawList = &drawList;
+
+			Pool.ParallelFor(ItemCount, Simulate);
+
+			Ranges.clear();
+			ParallelRecorder::Partition(Costs, Pool.ThreadCount() * 2, 256, Ranges);
+			for(ParallelRecorder::Range& range : Ranges)
+				range.End = std::min(range.End, (std::uint32_t)drawList.size());
+			Recorder.Record(Ranges, Record);
+			Draws += drawList.size();
+			DrawList = nullptr;
+		}
+	};
+}
+
+TEST(ChargesBytesToTheScopeTag)
+{
+	const MemoryTracker::TagStats before = MemoryTracker::GetStats(MemoryTag::Geometry);
+	const MemoryTracker::TagStats wavesBefore = MemoryTracker::GetStats(MemoryTag::Waves);
+
+	std::unique_ptr<std::vector<char>> geometry;
+	std::unique_ptr<char[]> waves;
+	{
+		MemoryScope scope(MemoryTag::Geometry);
+		geometry.reset(new std::vector<char>(1000));
+		{
+			MemoryScope inner(MemoryTag::Waves);
+			waves.reset(new char[300]);
+			gEscaped = waves.get();
+		}
+		CHECK(MemoryTracker::CurrentTag() == MemoryTag::Geometry);
+	}
+	CHECK(MemoryTracker::CurrentTag() == MemoryTag::Untagged);
+
+	// The vector object and its 1000-byte buffer are both geometry.
+	const MemoryTracker::TagStats during = MemoryTracker::GetStats(MemoryTag::Geometry);
+	CHECK_EQUAL(during.CpuBytes - before.CpuBytes, (std::int64_t)(1000 + sizeof(std::vector<char>)));
+	CHECK_EQUAL(during.CpuBlocks - before.CpuBlocks, 2);
+	CHECK(during.CpuPeakBytes >= during.CpuBytes);
+	CHECK_EQUAL(MemoryTracker::GetStats(MemoryTag::Waves).CpuBytes - wavesBefore.CpuBytes, 300);
+
+	// Freed blocks go back to the tag they were charged to, wherever the scope is now.
+	{
+		MemoryScope scope(MemoryTag::Textures);
+		geometry.reset();
+		waves.reset();
+	}
+	const MemoryTracker::TagStats after = MemoryTracker::GetStats(MemoryTag::Geometry);
+	CHECK_EQUAL(after.CpuBytes, before.CpuBytes);
+	CHECK_EQUAL(after.CpuBlocks, before.CpuBlocks);
+	CHECK_EQUAL(after.CpuPeakBytes, during.CpuPeakBytes);
+	CHECK_EQUAL(MemoryTracker::GetStats(MemoryTag::Waves).CpuBytes, wavesBefore.CpuBytes);
+}
+
+TEST(ChargesAcrossThreads)
+{
+	const std::int64_t before = MemoryTracker::GetStats(MemoryTag::Cloth).CpuBytes;
+
+	// Allocated under a scope on one thread, freed on another.
+	char* block = nullptr;
+	std::thread worker([&]
+	{
+		MemoryScope scope(MemoryTag::Cloth);
+		block = new char[4096];
+	});
+	worker.join();
+	CHECK_EQUAL(MemoryTracker::GetStats(MemoryTag::Cloth).CpuBytes - before, 4096);
+
+	delete[] block;
+	CHECK_EQUAL(MemoryTracker::GetStats(MemoryTag::Cloth).CpuBytes, before);
+}
+
+TEST(GpuBytesAndReport)
+{
+	MemoryTracker::SetGpuBytes(MemoryTag::Textures, 3 << 20);
+	MemoryTracker::AddGpuBytes(MemoryTag::Textures, 1 << 20);
+	MemoryTracker::AddGpuBytes(MemoryTag::Textures, -(2 << 20));
+	CHECK_EQUAL(MemoryTracker::GetStats(MemoryTag::Textures).GpuBytes, 2 << 20);
+
+	CHECK_EQUAL(std::string(MemoryTracker::TagName(MemoryTag::UploadHeaps)), std::string("upload_heaps"));
+	CHECK_EQUAL(std::string(MemoryTracker::TagName(MemoryTag::Count)), std::string("unknown"));
+
+	const std::string report = MemoryTracker::Report();
+	CHECK(report.find("textures") != std::string::npos);
+	CHECK(report.find("gpu 2048") != std::string::npos);
+}
+
+TEST(SteadyStateFrameDoesNotAllocate)
+{
+	FrameLoop loop;
+	FrameAllocationCheck check(5);
+	for(std::uint64_t frame = 0; frame < 60; ++frame)
+	{
+		check.BeginFrame();
+		loop.Frame(frame);
+		check.EndFrame();
+	}
+
+	CHECK_EQUAL(check.FramesChecked(), 55u);
+	CHECK_EQUAL(check.Allocations(), 0u);
+	CHECK(check.Passed());
+	if(!check.Passed())
+		Test::Fail(__FILE__, __LINE__, check.Report());
+
+	// The frames did their work: every range recorded, and the draws add up.
+	CHECK(loop.Recorder.StreamCount() > 1);
+	CHECK(loop.Draws > 60u * (ItemCount - ItemCount / 6));
+}
+
+TEST(AllocatingFrameFailsWithItsCallSite)
+{
+	FrameLoop loop;
+	FrameAllocationCheck check(5);
+	std::vector<std::vector<int>*> leaked;
+	leaked.reserve(4);
+
+	std::uint64_t allocations = 0;
+	for(std::uint64_t frame = 0; frame < 20; ++frame)
+	{
+		check.BeginFrame();
+		loop.Frame(frame);
+		if(frame == 12)
+			leaked.push_back(AllocateInFrame());
+		allocations += check.EndFrame();
+	}
+
+	// One frame, two allocations: the vector object and its buffer.
+	CHECK(!check.Passed());
+	CHECK_EQUAL(check.FramesWithAllocations(), 1u);
+	CHECK_EQUAL(allocations, 2u);
+	CHECK_EQUAL(check.Allocations(), 2u);
+
+	const std::string report = check.Report();
+	CHECK(report.find("15 frames after 5 warm-up frames, 1 allocated (2 allocations)") != std::string::npos);
+	CHECK(report.find("allocations at:") != std::string::npos);
+	CHECK(report.find("AllocateInFrame") != std::string::npos);
+
+	for(std::vector<int>* v : leaked)
+		delete v;
+	MemoryTracker::ClearSites();
+}
@@ -0,0 +1,295 @@
+//***************************************************************************************
+// MetricsServerTests.cpp
+//
+// The metrics registry and server against a local client: the Prometheus text groups
+// series under one HELP/TYPE header, every request line gets the documented response,
+// and live scrapes over 127.0.0.1 TCP and a Unix domain socket see counters that a
+// writer thread keeps updating.  Stop must remove the socket file it created.
+//
+// The socket cases use a small POSIX client and are compiled out on Windows; Respond
+// covers the protocol there.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "MetricsServer.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	bool Contains(const std::string& text, const std::string& part)
+	{
+		return text.find(part) != std::string::npos;
+	}
+
+	// The value of the first series line of a "name{labels} value" response.
+	double SeriesValue(const std::string& lines)
+	{
+		const std::size_t space = lines.find(' ');
+		return space == std::string::npos ? -1.0 : std::strtod(lines.c_str() + space + 1, nullptr);
+	}
+
+	// A registry shaped like the demo's: a counter, a percentile gauge with two series
+	// registered apart from each other, and a labelled memory gauge.
+	struct Fixture
+	{
+		MetricsRegistry Registry;
+		MetricsRegistry::Metric* Frames = nullptr;
+
+		Fixture()
+		{
+			Frames = Registry.AddCounter("frames_total", "Frames presented.");
+			Registry.AddGauge("frame_ms", "Frame time percentile.", "quantile=\"0.99\"")->Set(16.5);
+			Registry.AddGauge("memory_bytes", "Memory by subsystem.", "subsystem=\"geometry\"")->Set(1024.0);
+			Registry.AddGauge("frame_ms", "", "quantile=\"0.5\"")->Set(16.25);
+		}
+	};
+
+#if !defined(_WIN32)
+	// Sends one request line and reads the response until the server closes.
+	std::string Exchange(int s, const std::string& request)
+	{
+		const std::string line = request + "\n";
+		if(send(s, line.data(), line.size(), MSG_NOSIGNAL) != (ssize_t)line.size())
+		{
+			close(s);
+			return std::string();
+		}
+
+		std::string response;
+		char buffer[4096];
+		ssize_t n = 0;
+		while((n = recv(s, buffer, sizeof(buffer), 0)) > 0)
+			response.append(buffer, (std::size_t)n);
+
+		close(s);
+		return response;
+	}
+
+	std::string RequestTcp(std::uint16_t port, const std::string& request)
+	{
+		const int s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if(s < 0)
+			return std::string();
+
+		sockaddr_in address;
+		std::memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = htons(port);
+		if(connect(s, (const sockaddr*)&address, sizeof(address)) != 0)
+		{
+			close(s);
+			return std::string();
+		}
+
+		return Exchange(s, request);
+	}
+
+	std::string RequestUnix(const std::string& path, const std::string& request)
+	{
+		const int s = socket(AF_UNIX, SOCK_STREAM, 0);
+		if(s < 0)
+			return std::string();
+
+		sockaddr_un address;
+		std::memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		std::memcpy(address.sun_path, path.c_str(), path.size());
+		if(connect(s, (const sockaddr*)&address, sizeof(address)) != 0)
+		{
+			close(s);
+			return std::string();
+		}
+
+		return Exchange(s, request);
+	}
+
+	bool FileExists(const std::string& path)
+	{
+		struct stat info;
+		return stat(path.c_str(), &info) == 0;
+	}
+#endif
+}
+
+TEST(PrometheusTextGroupsSeriesByName)
+{
+	Fixture f;
+	f.Frames->Add(3.0);
+
+	const std::string text = f.Registry.PrometheusText();
+	CHECK_EQUAL(text,
+		"# HELP frames_total Frames presented.\n"
+		"# TYPE frames_total counter\n"
+		"frames_total 3\n"
+		"# HELP frame_ms Frame time percentile.\n"
+		"# TYPE frame_ms gauge\n"
+		"frame_ms{quantile=\"0.99\"} 16.5\n"
+		"frame_ms{quantile=\"0.5\"} 16.25\n"
+		"# HELP memory_bytes Memory by subsystem.\n"
+		"# TYPE memory_bytes gauge\n"
+		"memory_bytes{subsystem=\"geometry\"} 1024\n");
+
+	CHECK_EQUAL(f.Registry.SeriesCount(), 4u);
+	CHECK_EQUAL(f.Registry.LineText("frame_ms"),
+		"frame_ms{quantile=\"0.99\"} 16.5\n"
+		"frame_ms{quantile=\"0.5\"} 16.25\n");
+}
+
+TEST(RegistryReturnsExistingSeries)
+{
+	MetricsRegistry registry;
+	MetricsRegistry::Metric* a = registry.AddCounter("draws_total", "Draws.", "pass=\"main\"");
+	MetricsRegistry::Metric* b = registry.AddCounter("draws_total", "Draws.", "pass=\"main\"");
+	MetricsRegistry::Metric* c = registry.AddCounter("draws_total", "Draws.", "pass=\"shadow\"");
+	CHECK(a == b);
+	CHECK(a != c);
+	CHECK_EQUAL(registry.SeriesCount(), 2u);
+
+	a->Add(2.5);
+	a->Add(0.5);
+	CHECK_NEAR(b->Value(), 3.0, 0.0);
+	CHECK_NEAR(c->Value(), 0.0, 0.0);
+
+	registry.AddGauge("nan_gauge", "")->Set(std::strtod("nan", nullptr));
+	registry.AddGauge("inf_gauge", "")->Set(std::strtod("-inf", nullptr));
+	CHECK_EQUAL(registry.LineText("nan_gauge"), "nan_gauge NaN\n");
+	CHECK_EQUAL(registry.LineText("inf_gauge"), "inf_gauge -Inf\n");
+}
+
+TEST(RespondAnswersEveryRequest)
+{
+	Fixture f;
+	const MetricsRegistry& r = f.Registry;
+
+	CHECK_EQUAL(MetricsServer::Respond(r, "metrics"), r.PrometheusText());
+	CHECK_EQUAL(MetricsServer::Respond(r, "list"), r.LineText());
+	CHECK_EQUAL(MetricsServer::Respond(r, "get memory_bytes"), "memory_bytes{subsystem=\"geometry\"} 1024\n");
+	CHECK_EQUAL(MetricsServer::Respond(r, "get missing"), "error: no series named 'missing'\n");
+	CHECK_EQUAL(MetricsServer::Respond(r, "get "), "error: no series named ''\n");
+	CHECK(Contains(MetricsServer::Respond(r, "bogus"), "error: unknown request"));
+
+	const std::string ok = MetricsServer::Respond(r, "GET /metrics HTTP/1.1");
+	CHECK_EQUAL(ok.compare(0, 17, "HTTP/1.0 200 OK\r\n"), 0);
+	CHECK(Contains(ok, "Content-Type: text/plain; version=0.0.4"));
+	CHECK(Contains(ok, "Content-Length: " + std::to_string(r.PrometheusText().size()) + "\r\n"));
+	CHECK(Contains(ok, "\r\n\r\n" + r.PrometheusText()));
+
+	const std::string missing = MetricsServer::Respond(r, "GET /other HTTP/1.1");
+	CHECK_EQUAL(missing.compare(0, 24, "HTTP/1.0 404 Not Found\r\n"), 0);
+	CHECK(Contains(missing, "\r\n\r\nnot found\n"));
+}
+
+#if !defined(_WIN32)
+
+TEST(TcpClientScrapesWhileCountersChange)
+{
+	Fixture f;
+	MetricsServer server(f.Registry);
+	REQUIRE(server.StartTcp(0));
+	CHECK(server.IsRunning());
+	REQUIRE(server.Port() != 0);
+
+	// A frame loop keeps counting while the client scrapes; every scrape must parse and
+	// see a counter that never goes backwards.
+	const int frames = 200000;
+	std::atomic<bool> done{ false };
+	std::thread writer([&]
+	{
+		for(int i = 0; i < frames; ++i)
+			f.Frames->Add(1.0);
+		done = true;
+	});
+
+	double last = 0.0;
+	bool parsed = true;
+	bool monotonic = true;
+	int scrapes = 0;
+	while(parsed && (!done.load() || scrapes < 3))
+	{
+		const std::string lines = RequestTcp(server.Port(), "get frames_total");
+		parsed = lines.compare(0, 13, "frames_total ") == 0;
+		const double value = SeriesValue(lines);
+		monotonic = monotonic && value >= last;
+		last = value;
+		++scrapes;
+	}
+	writer.join();
+
+	REQUIRE(parsed);
+	CHECK(monotonic);
+	CHECK_EQUAL(RequestTcp(server.Port(), "get frames_total"), "frames_total " + std::to_string(frames) + "\n");
+
+	// A scraper's request, headers and all.
+	const std::string http = RequestTcp(server.Port(), "GET /metrics HTTP/1.1\r\nHost: localhost\r\nAccept: */*\r\n");
+	CHECK_EQUAL(http.compare(0, 17, "HTTP/1.0 200 OK\r\n"), 0);
+	CHECK(Contains(http, "# TYPE frames_total counter\nframes_total " + std::to_string(frames) + "\n"));
+
+	CHECK(Contains(RequestTcp(server.Port(), "bogus"), "error: unknown request"));
+	CHECK_EQUAL(server.RequestsServed(), (std::uint64_t)scrapes + 3);
+
+	// The port is released on Stop and the server can start again.
+	server.Stop();
+	CHECK(!server.IsRunning());
+	CHECK_EQUAL(server.Port(), 0u);
+	REQUIRE(server.StartTcp(0));
+	CHECK_EQUAL(RequestTcp(server.Port(), "get memory_bytes"), "memory_bytes{subsystem=\"geometry\"} 1024\n");
+	server.Stop();
+}
+
+TEST(UnixClientScrapesAndStopRemovesSocket)
+{
+	Fixture f;
+	const std::string path = "MetricsServerTests-" + std::to_string(getpid()) + ".sock";
+
+	{
+		MetricsServer server(f.Registry);
+		REQUIRE(server.StartUnix(path));
+		CHECK(FileExists(path));
+
+		// A second server cannot start while the first one runs.
+		CHECK(!server.StartUnix(path));
+		CHECK(!server.StartTcp(0));
+
+		f.Frames->Add(7.0);
+		CHECK_EQUAL(RequestUnix(path, "get frames_total"), "frames_total 7\n");
+		CHECK_EQUAL(RequestUnix(path, "list"), f.Registry.LineText());
+		CHECK_EQUAL(RequestUnix(path, "metrics"), f.Registry.PrometheusText());
+		CHECK_EQUAL(server.RequestsServed(), 3u);
+
+		server.Stop();
+		CHECK(!FileExists(path));
+		CHECK(RequestUnix(path, "list").empty());
+
+		// A stale socket file from a crashed instance does not block the next one.
+		REQUIRE(server.StartUnix(path));
+		MetricsServer replacement(f.Registry);
+		REQUIRE(replacement.StartUnix(path));
+		CHECK_EQUAL(RequestUnix(path, "get frames_total"), "frames_total 7\n");
+		CHECK_EQUAL(replacement.RequestsServed(), 1u);
+		replacement.Stop();
+	}
+
+	// The destructor stops the first server, which finds its path already gone.
+	CHECK(!FileExists(path));
+
+	MetricsServer server(f.Registry);
+	CHECK(!server.StartUnix(""));
+	CHECK(!server.StartUnix(std::string(200, 'x')));
+	CHECK(!server.IsRunning());
+}
+
+#endif
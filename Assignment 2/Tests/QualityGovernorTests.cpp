@@ -0,0 +1,281 @@
+//***************************************************************************************
+// QualityGovernorTests.cpp
+//
+// The quality governor driven by synthetic cost curves instead of a clock: each knob
+// level adds a known number of milliseconds to a base load, with seeded noise.  The
+// governor must bring an over-budget load under budget and stay there without
+// oscillating, give up the cheapest quality first, learn the true costs from its own
+// changes, follow steps in the load both ways, and ignore rare spikes that stay above
+// the configured percentile.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "QualityGovernor.h"
+#include "Random.h"
+#include <cmath>
+#include <vector>
+
+namespace
+{
+	// Frame time = base + the sum of each knob's cost curve at its level, times noise.
+	struct Workload
+	{
+		double BaseMs = 8.0;
+		std::vector<double> MsPerLevel;      // linear part of each knob's curve
+		std::vector<double> MsPerLevelSq;    // quadratic part, for curves that steepen
+		double Noise = 0.03;                 // relative, uniform in [-Noise, Noise]
+		Pcg32 Rng{ 2024 };
+
+		double FrameMs(const QualityGovernor& governor)
+		{
+			double ms = BaseMs;
+			for(QualityGovernor::Knob k = 0; k < governor.KnobCount(); ++k)
+			{
+				const double level = governor.Level(k);
+				ms += MsPerLevel[k] * level;
+				if(k < MsPerLevelSq.size())
+					ms += MsPerLevelSq[k] * level * level;
+			}
+			return ms * (1.0 + Noise * (2.0 * Rng.NextFloat() - 1.0));
+		}
+
+		// Runs frames and returns the number of level changes made.
+		std::uint64_t Run(QualityGovernor& governor, std::uint32_t frames)
+		{
+			const std::uint64_t before = governor.Changes();
+			for(std::uint32_t i = 0; i < frames; ++i)
+				governor.Update(FrameMs(governor));
+			return governor.Changes() - before;
+		}
+
+		// The noise-free frame time at the governor's current levels.
+		double SteadyMs(const QualityGovernor& governor)
+		{
+			const double noise = Noise;
+			Noise = 0.0;
+			const double ms = FrameMs(governor);
+			Noise = noise;
+			return ms;
+		}
+	};
+
+	QualityGovernor::KnobDesc Knob(const char* name, std::int32_t maxLevel, std::int32_t level,
+		double costGuessMs, double priority = 1.0)
+	{
+		QualityGovernor::KnobDesc desc;
+		desc.Name = name;
+		desc.MinLevel = 0;
+		desc.MaxLevel = maxLevel;
+		desc.Level = level;
+		desc.CostMsPerLevel = costGuessMs;
+		desc.Priority = priority;
+		return desc;
+	}
+
+	QualityGovernor::Config FastConfig()
+	{
+		QualityGovernor::Config config;
+		config.WindowFrames = 20;
+		config.SettleFrames = 10;
+		return config;
+	}
+}
+
+TEST(ConvergesUnderBudgetAndStays)
+{
+	QualityGovernor governor(FastConfig());
+	governor.AddKnob(Knob("shadows", 4, 4, 0.5));
+	governor.AddKnob(Knob("draw distance", 8, 8, 0.5));
+
+	// At the top levels the load is 8 + 4*1.5 + 8*0.8 = 20.4 ms, over 16.7.
+	Workload load;
+	load.MsPerLevel = { 1.5, 0.8 };
+	load.Run(governor, 2000);
+
+	CHECK(load.SteadyMs(governor) * (1.0 + load.Noise) <= governor.GetConfig().BudgetMs);
+
+	// Settled: no more changes, and the load is not far below budget either.
+	CHECK_EQUAL(load.Run(governor, 3000), 0u);
+	CHECK(load.SteadyMs(governor) > governor.GetConfig().BudgetMs * (1.0 - governor.GetConfig().UnderBudget) * 0.9);
+}
+
+TEST(GivesUpTheCheapestQualityFirst)
+{
+	// Equal priorities and accurate guesses: a level of "expensive" saves 3 ms for the
+	// same quality a level of "cheap" saves 0.2 ms, so only "expensive" goes down.
+	QualityGovernor governor(FastConfig());
+	const QualityGovernor::Knob cheap = governor.AddKnob(Knob("cheap", 4, 4, 0.2));
+	const QualityGovernor::Knob expensive = governor.AddKnob(Knob("expensive", 4, 4, 3.0));
+
+	Workload load;
+	load.MsPerLevel = { 0.2, 3.0 };
+	load.Run(governor, 1000);
+	CHECK_EQUAL(governor.Level(cheap), 4);
+	CHECK(governor.Level(expensive) < 4);
+
+	// Priority overrides cost: a knob worth 20 times as much keeps its levels.
+	QualityGovernor weighted(FastConfig());
+	const QualityGovernor::Knob precious = weighted.AddKnob(Knob("precious", 4, 4, 3.0, 20.0));
+	const QualityGovernor::Knob filler = weighted.AddKnob(Knob("filler", 4, 4, 0.2, 1.0));
+
+	Workload heavy;
+	heavy.BaseMs = 15.0;
+	heavy.MsPerLevel = { 3.0, 0.2 };
+	heavy.Run(weighted, 1000);
+	CHECK_EQUAL(weighted.Level(filler), 0);
+	CHECK(weighted.Level(precious) < 4);
+}
+
+TEST(LearnsCostsFromItsOwnChanges)
+{
+	// Both guesses are 0.5 ms; the true costs are 2 ms and 0.1 ms per level.
+	QualityGovernor::Config config = FastConfig();
+	config.LearningRate = 0.5;
+	QualityGovernor governor(config);
+	const QualityGovernor::Knob costly = governor.AddKnob(Knob("costly", 6, 6, 0.5));
+	const QualityGovernor::Knob cheap = governor.AddKnob(Knob("cheap", 6, 6, 0.5));
+
+	// 22.6 ms: "costly" comes first on the tie and, once measured, stays the better
+	// knob to lower, so it goes down three levels.
+	Workload load;
+	load.BaseMs = 10.0;
+	load.MsPerLevel = { 2.0, 0.1 };
+	load.Noise = 0.0;
+	load.Run(governor, 3000);
+
+	CHECK_EQUAL(governor.Level(costly), 3);
+	CHECK_EQUAL(governor.Level(cheap), 6);
+	CHECK(load.SteadyMs(governor) <= governor.GetConfig().BudgetMs);
+
+	// Three 2 ms observations at rate 0.5 take the guess from 0.5 to 1.81; a knob that
+	// never moved keeps its guess.
+	CHECK_NEAR(governor.CostMs(costly), 1.8125, 1e-9);
+	CHECK_NEAR(governor.CostMs(cheap), 0.5, 0.0);
+}
+
+TEST(RaisesOnlyWhatFitsTheHeadroom)
+{
+	QualityGovernor governor(FastConfig());
+	const QualityGovernor::Knob big = governor.AddKnob(Knob("big", 4, 0, 6.0, 10.0));
+	const QualityGovernor::Knob small = governor.AddKnob(Knob("small", 4, 0, 1.0));
+
+	// 10 ms of a 16.7 ms budget: 6.7 ms of headroom fits one level of "big", which is
+	// worth more per millisecond than "small".  The 0.7 ms left fits neither.
+	Workload load;
+	load.BaseMs = 10.0;
+	load.MsPerLevel = { 6.0, 1.0 };
+	load.Noise = 0.0;
+	load.Run(governor, 2000);
+
+	CHECK_EQUAL(governor.Level(big), 1);
+	CHECK_EQUAL(governor.Level(small), 0);
+	CHECK(load.SteadyMs(governor) <= governor.GetConfig().BudgetMs);
+	CHECK(load.SteadyMs(governor) >= governor.GetConfig().BudgetMs * (1.0 - governor.GetConfig().UnderBudget));
+	CHECK_EQUAL(load.Run(governor, 2000), 0u);
+}
+
+TEST(FollowsStepsInTheLoad)
+{
+	QualityGovernor governor(FastConfig());
+	const QualityGovernor::Knob detail = governor.AddKnob(Knob("detail", 10, 5, 1.0));
+
+	// A steepening curve, so each level up costs more than the last.
+	Workload load;
+	load.BaseMs = 6.0;
+	load.MsPerLevel = { 0.5 };
+	load.MsPerLevelSq = { 0.1 };
+	load.Run(governor, 2000);
+	const std::int32_t calm = governor.Level(detail);
+	CHECK(load.SteadyMs(governor) <= governor.GetConfig().BudgetMs);
+
+	// A heavier scene: the level drops and the frame time comes back under budget.
+	load.BaseMs = 12.0;
+	load.Run(governor, 2000);
+	CHECK(governor.Level(detail) < calm);
+	CHECK(load.SteadyMs(governor) <= governor.GetConfig().BudgetMs);
+
+	// Back to the light scene: the level recovers.
+	load.BaseMs = 6.0;
+	load.Run(governor, 3000);
+	CHECK_EQUAL(governor.Level(detail), calm);
+}
+
+TEST(RareSpikesDoNotLowerQuality)
+{
+	// One frame in 25 takes 30 ms; the 90th percentile stays at 15 ms, inside the band.
+	QualityGovernor governor(FastConfig());
+	const QualityGovernor::Knob detail = governor.AddKnob(Knob("detail", 4, 2, 1.0));
+
+	std::uint64_t changes = 0;
+	for(std::uint32_t i = 0; i < 2000; ++i)
+		changes += governor.Update(i % 25 == 0 ? 30.0 : 15.0) ? 1 : 0;
+	CHECK_EQUAL(changes, 0u);
+	CHECK_EQUAL(governor.Level(detail), 2);
+
+	// As the p90 it reacts once one frame in five spikes.
+	for(std::uint32_t i = 0; i < 200; ++i)
+		governor.Update(i % 5 == 0 ? 30.0 : 15.0);
+	CHECK(governor.Level(detail) < 2);
+}
+
+TEST(DecidesOncePerSettledWindow)
+{
+	QualityGovernor::Config config;
+	config.WindowFrames = 30;
+	config.SettleFrames = 50;
+	QualityGovernor governor(config);
+	const QualityGovernor::Knob detail = governor.AddKnob(Knob("detail", 10, 10, 1.0));
+
+	// Far over budget, but nothing moves until max(settle, window) frames have run at
+	// the current levels, and then one level at a time.
+	std::vector<std::uint32_t> changeFrames;
+	for(std::uint32_t i = 1; i <= 200; ++i)
+	{
+		if(governor.Update(40.0))
+			changeFrames.push_back(i);
+	}
+	REQUIRE(changeFrames.size() == 4u);
+	CHECK_EQUAL(changeFrames[0], 50u);
+	CHECK_EQUAL(changeFrames[1], 100u);
+	CHECK_EQUAL(changeFrames[3], 200u);
+	CHECK_EQUAL(governor.Level(detail), 6);
+
+	// Nothing left to lower: the governor stops changing.
+	governor.SetLevel(detail, -5);
+	CHECK_EQUAL(governor.Level(detail), 0);
+	std::uint64_t changes = 0;
+	for(std::uint32_t i = 0; i < 500; ++i)
+		changes += governor.Update(40.0) ? 1 : 0;
+	CHECK_EQUAL(changes, 0u);
+}
+
+TEST(WindowStatisticsAndReport)
+{
+	QualityGovernor::Config config;
+	config.WindowFrames = 10;
+	config.Percentile = 90.0;
+	QualityGovernor governor(config);
+	governor.AddKnob(Knob("shadows", 3, 1, 0.75));
+
+	CHECK_NEAR(governor.WindowPercentileMs(), 0.0, 0.0);
+	CHECK_NEAR(governor.WindowMeanMs(), 0.0, 0.0);
+
+	// Frames 1..10 ms: the 90th percentile is the 9th smallest.
+	for(int i = 1; i <= 10; ++i)
+		governor.Update((double)i);
+	CHECK_NEAR(governor.WindowPercentileMs(), 9.0, 0.0);
+	CHECK_NEAR(governor.WindowMeanMs(), 5.5, 1e-12);
+
+	// The ring drops the oldest frame.
+	governor.Update(20.0);
+	CHECK_NEAR(governor.WindowPercentileMs(), 10.0, 0.0);
+	CHECK_NEAR(governor.WindowMeanMs(), 7.4, 1e-12);
+
+	governor.SetBudgetMs(33.3);
+	CHECK_NEAR(governor.GetConfig().BudgetMs, 33.3, 0.0);
+
+	const std::string report = governor.Report();
+	CHECK(report.find("budget 33.30 ms") != std::string::npos);
+	CHECK(report.find("shadows") != std::string::npos);
+	CHECK(report.find("level 1 [0, 3], 0.750 ms/level") != std::string::npos);
+}
@@ -0,0 +1,351 @@
+//***************************************************************************************
+// RandomTests.cpp
+//
+// The generators against published known-answer vectors and a scalar model: the batch
+// fills keep each lane's sequence however they are split, Philox fills match Float at
+// every index, and the outputs pass chi-square uniformity checks.  NextBounded must not
+// show the modulo bias the old rand() % n had.
+//
+// Seeds are fixed, so the statistical checks are deterministic; their thresholds are
+// the 0.1% critical values, so a correct generator passes with a wide margin.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "Random.h"
+#include <climits>
+#include <vector>
+
+namespace
+{
+	// xoshiro128+ one lane at a time, seeded the way Xoshiro128x4 documents.
+	class ScalarXoshiro
+	{
+	public:
+		explicit ScalarXoshiro(std::uint64_t seed)
+		{
+			std::uint64_t state = seed;
+			for(int lane = 0; lane < 4; ++lane)
+			{
+				const std::uint64_t a = SplitMix64(state);
+				const std::uint64_t b = SplitMix64(state);
+				mState[lane][0] = (std::uint32_t)a;
+				mState[lane][1] = (std::uint32_t)(a >> 32);
+				mState[lane][2] = (std::uint32_t)b;
+				mState[lane][3] = (std::uint32_t)(b >> 32);
+			}
+		}
+
+		std::uint32_t Next(int lane)
+		{
+			std::uint32_t* s = mState[lane];
+			const std::uint32_t result = s[0] + s[3];
+			const std::uint32_t t = s[1] << 9;
+			s[2] ^= s[0];
+			s[3] ^= s[1];
+			s[1] ^= s[2];
+			s[0] ^= s[3];
+			s[2] ^= t;
+			s[3] = (s[3] << 11) | (s[3] >> 21);
+			return result;
+		}
+
+	private:
+		std::uint32_t mState[4][4];
+	};
+
+	float ToFloat(std::uint32_t bits)
+	{
+		return (float)(bits >> 8) * (1.0f / 16777216.0f);
+	}
+
+	// Pearson's statistic for values in [0, 1) over bucketCount equal buckets.
+	double ChiSquare(const std::vector<float>& values, std::size_t bucketCount)
+	{
+		std::vector<double> counts(bucketCount, 0.0);
+		for(float v : values)
+			counts[(std::size_t)(v * bucketCount)] += 1.0;
+
+		const double expected = (double)values.size() / bucketCount;
+		double chi = 0.0;
+		for(double c : counts)
+			chi += (c - expected) * (c - expected) / expected;
+		return chi;
+	}
+
+	// The 0.1% critical value for 63 degrees of freedom (64 buckets).
+	const double ChiSquare63 = 103.4;
+
+	bool AllInRange(const std::vector<float>& values, float a, float b)
+	{
+		for(float v : values)
+		{
+			if(v < a || v > b)
+				return false;
+		}
+		return true;
+	}
+}
+
+TEST(Pcg32MatchesReference)
+{
+	// The first outputs of the reference implementation's demo (seed 42, stream 54).
+	Pcg32 rng(42, 54);
+	const std::uint32_t expected[] = { 0xa15c02b7, 0x7b47f409, 0xba1d3330, 0x83d2f293, 0xbfa4784b, 0xcbed606e };
+	for(std::uint32_t value : expected)
+		CHECK_EQUAL(rng.Next(), value);
+
+	// Streams with the same seed differ.
+	Pcg32 a(7, 1);
+	Pcg32 b(7, 2);
+	int same = 0;
+	for(int i = 0; i < 64; ++i)
+		same += a.Next() == b.Next() ? 1 : 0;
+	CHECK(same < 2);
+}
+
+TEST(PhiloxMatchesKnownAnswers)
+{
+	// Philox4x32-10 known-answer vectors from Random123.
+	const std::uint32_t zeroCounter[4] = { 0, 0, 0, 0 };
+	const std::uint32_t zeroKey[2] = { 0, 0 };
+	Philox4x32::Block block = Philox4x32::Generate(zeroCounter, zeroKey);
+	CHECK_EQUAL(block.Word[0], 0x6627e8d5u);
+	CHECK_EQUAL(block.Word[1], 0xe169c58du);
+	CHECK_EQUAL(block.Word[2], 0xbc57ac4cu);
+	CHECK_EQUAL(block.Word[3], 0x9b00dbd8u);
+
+	const std::uint32_t onesCounter[4] = { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff };
+	const std::uint32_t onesKey[2] = { 0xffffffff, 0xffffffff };
+	block = Philox4x32::Generate(onesCounter, onesKey);
+	CHECK_EQUAL(block.Word[0], 0x408f276du);
+	CHECK_EQUAL(block.Word[1], 0x41c83b0eu);
+	CHECK_EQUAL(block.Word[2], 0xa20bc7c6u);
+	CHECK_EQUAL(block.Word[3], 0x6d5451fdu);
+
+	const std::uint32_t piCounter[4] = { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 };
+	const std::uint32_t piKey[2] = { 0xa4093822, 0x299f31d0 };
+	block = Philox4x32::Generate(piCounter, piKey);
+	CHECK_EQUAL(block.Word[0], 0xd16cfe09u);
+	CHECK_EQUAL(block.Word[1], 0x94fdccebu);
+	CHECK_EQUAL(block.Word[2], 0x5001e420u);
+	CHECK_EQUAL(block.Word[3], 0x24126ea1u);
+
+	// The 64-bit overload puts the counter in the low words and zeroes the rest.
+	const std::uint64_t counter = 0x0123456789abcdefull;
+	const std::uint64_t key = 0xfedcba9876543210ull;
+	const std::uint32_t c[4] = { 0x89abcdef, 0x01234567, 0, 0 };
+	const std::uint32_t k[2] = { 0x76543210, 0xfedcba98 };
+	const Philox4x32::Block wide = Philox4x32::Generate(counter, key);
+	const Philox4x32::Block words = Philox4x32::Generate(c, k);
+	for(int w = 0; w < 4; ++w)
+		CHECK_EQUAL(wide.Word[w], words.Word[w]);
+
+	for(std::uint64_t index = 0; index < 8; ++index)
+		CHECK_EQUAL(Philox4x32::Uint32(key, (counter << 2) + index), Philox4x32::Generate(counter + index / 4, key).Word[index % 4]);
+}
+
+TEST(XoshiroFillsKeepLaneOrder)
+{
+	const std::uint64_t seed = 0x5eed;
+
+	// out[4i + lane] is the ith value of that lane, across calls of any size.
+	Xoshiro128x4 rng(seed);
+	ScalarXoshiro model(seed);
+	bool matches = true;
+	const std::size_t sizes[] = { 4, 64, 16, 128, 8, 200 };
+	for(std::size_t size : sizes)
+	{
+		std::vector<std::uint32_t> out(size);
+		rng.FillUint32(out.data(), size);
+		for(std::size_t i = 0; i < size; ++i)
+			matches = matches && out[i] == model.Next((int)(i % 4));
+	}
+	CHECK(matches);
+
+	// A count that is not a multiple of 4 uses up its whole last group.
+	Xoshiro128x4 partial(seed);
+	ScalarXoshiro partialModel(seed);
+	std::uint32_t head[6];
+	std::uint32_t next[4];
+	partial.FillUint32(head, 6);
+	partial.FillUint32(next, 4);
+	for(int i = 0; i < 8; ++i)
+	{
+		const std::uint32_t value = partialModel.Next(i % 4);
+		if(i < 6)
+			CHECK_EQUAL(head[i], value);
+	}
+	for(int lane = 0; lane < 4; ++lane)
+		CHECK_EQUAL(next[lane], partialModel.Next(lane));
+}
+
+TEST(XoshiroFloatsFollowTheIntegers)
+{
+	// FillFloats and FillRange convert the same integers FillUint32 would produce, in
+	// chunks that must not change the sequence.
+	const std::size_t count = 1000;
+	Xoshiro128x4 ints(99);
+	Xoshiro128x4 floats(99);
+	Xoshiro128x4 range(99);
+
+	std::vector<std::uint32_t> bits(count);
+	std::vector<float> unit(count);
+	std::vector<float> mapped(count);
+	ints.FillUint32(bits.data(), count);
+	floats.FillFloats(unit.data(), count);
+	range.FillRange(mapped.data(), count, -2.0f, 6.0f);
+
+	bool exact = true;
+	bool mappedExact = true;
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		exact = exact && unit[i] == ToFloat(bits[i]);
+		mappedExact = mappedExact && mapped[i] == -2.0f + unit[i] * 8.0f;
+	}
+	CHECK(exact);
+	CHECK(mappedExact);
+	CHECK(AllInRange(unit, 0.0f, 0.99999995f));
+	CHECK(AllInRange(mapped, -2.0f, 6.0f));
+}
+
+TEST(PhiloxFillsMatchFloatAtEveryIndex)
+{
+	const std::uint64_t seed = 0xabcdef12345ull;
+
+	// Every alignment of the first index against a block and every tail length, so the
+	// leading, four-block SSE, whole-block and trailing paths all run.
+	bool matches = true;
+	std::vector<float> out(80);
+	for(std::uint64_t first = 0; first < 8; ++first)
+	{
+		for(std::size_t count = 0; count <= out.size(); ++count)
+		{
+			Philox4x32::FillFloats(seed, first, out.data(), count);
+			for(std::size_t i = 0; i < count; ++i)
+				matches = matches && out[i] == Philox4x32::Float(seed, first + i);
+		}
+	}
+	CHECK(matches);
+
+	// Counters above 32 bits carry into the second word.
+	const std::uint64_t high = (1ull << 34) - 6;
+	Philox4x32::FillFloats(seed, high, out.data(), out.size());
+	for(std::size_t i = 0; i < out.size(); ++i)
+		matches = matches && out[i] == Philox4x32::Float(seed, high + i);
+	CHECK(matches);
+
+	// Workers filling disjoint parts reproduce one serial fill.
+	std::vector<float> serial(1000);
+	std::vector<float> parts(1000);
+	Philox4x32::FillRange(seed, 0, serial.data(), serial.size(), 1.0f, 3.0f);
+	for(std::size_t begin = 0; begin < parts.size(); begin += 137)
+	{
+		const std::size_t count = parts.size() - begin < 137 ? parts.size() - begin : 137;
+		Philox4x32::FillRange(seed, begin, parts.data() + begin, count, 1.0f, 3.0f);
+	}
+	CHECK(serial == parts);
+	CHECK(AllInRange(serial, 1.0f, 3.0f));
+}
+
+TEST(OutputsAreUniform)
+{
+	const std::size_t count = 1 << 18;
+	std::vector<float> values(count);
+
+	Pcg32 pcg(12345);
+	for(float& v : values)
+		v = pcg.NextFloat();
+	CHECK(ChiSquare(values, 64) < ChiSquare63);
+
+	Xoshiro128x4 xoshiro(12345);
+	xoshiro.FillFloats(values.data(), count);
+	CHECK(ChiSquare(values, 64) < ChiSquare63);
+
+	// Each lane on its own, so a broken lane cannot hide behind the other three.
+	for(int lane = 0; lane < 4; ++lane)
+	{
+		std::vector<float> laneValues;
+		for(std::size_t i = (std::size_t)lane; i < count; i += 4)
+			laneValues.push_back(values[i]);
+		CHECK(ChiSquare(laneValues, 64) < ChiSquare63);
+	}
+
+	Philox4x32::FillFloats(12345, 0, values.data(), count);
+	CHECK(ChiSquare(values, 64) < ChiSquare63);
+
+	// Consecutive seeds are the case a counter-based generator must get right.
+	for(std::size_t i = 0; i < count; ++i)
+		values[i] = Philox4x32::Float(i, 0);
+	CHECK(ChiSquare(values, 64) < ChiSquare63);
+}
+
+TEST(BoundedIntegersAreUnbiased)
+{
+	// With bound 3 * 2^30, rand() % bound would put half the results below 2^30 instead
+	// of a third.
+	Pcg32 rng(2024);
+	const std::uint32_t bound = 3u << 30;
+	const int samples = 300000;
+	int low = 0;
+	bool inRange = true;
+	for(int i = 0; i < samples; ++i)
+	{
+		const std::uint32_t v = rng.NextBounded(bound);
+		inRange = inRange && v < bound;
+		low += v < (1u << 30) ? 1 : 0;
+	}
+	CHECK(inRange);
+	CHECK_NEAR((double)low / samples, 1.0 / 3.0, 0.005);
+
+	// Small bounds hit every value equally often.
+	const std::uint32_t dice = 6;
+	const int rolls = 600000;
+	std::vector<double> counts(dice, 0.0);
+	for(int i = 0; i < rolls; ++i)
+		counts[rng.NextBounded(dice)] += 1.0;
+	double chi = 0.0;
+	for(double c : counts)
+		chi += (c - rolls / dice) * (c - rolls / dice) / (rolls / dice);
+	CHECK(chi < 20.5);    // 0.1% critical value for 5 degrees of freedom
+
+	CHECK_EQUAL(rng.NextBounded(1), 0u);
+}
+
+TEST(IntRangesAreInclusive)
+{
+	Pcg32 rng(77);
+	bool seen[7] = {};
+	bool inRange = true;
+	for(int i = 0; i < 1000; ++i)
+	{
+		const int v = rng.NextInt(-3, 3);
+		inRange = inRange && v >= -3 && v <= 3;
+		if(v >= -3 && v <= 3)
+			seen[v + 3] = true;
+	}
+	CHECK(inRange);
+	for(bool s : seen)
+		CHECK(s);
+
+	CHECK_EQUAL(rng.NextInt(5, 5), 5);
+
+	// The full int range must not overflow the range computation.
+	bool negative = false;
+	bool positive = false;
+	for(int i = 0; i < 64; ++i)
+	{
+		const int v = rng.NextInt(INT_MIN, INT_MAX);
+		negative = negative || v < 0;
+		positive = positive || v > 0;
+	}
+	CHECK(negative);
+	CHECK(positive);
+
+	bool floatsInRange = true;
+	for(int i = 0; i < 1000; ++i)
+	{
+		const float f = rng.NextFloat(-1.0f, 1.0f);
+		floatsInRange = floatsInRange && f >= -1.0f && f <= 1.0f;
+	}
+	CHECK(floatsInRange);
+}
@@ -0,0 +1,435 @@
+//***************************************************************************************
+// RenderGraphTests.cpp
+//
+// Compile() on hand-built frames: culling of passes nobody consumes, the transitions
+// and their batching, merged read states, and transient placement with the aliasing
+// report.  A fuzz run compiles random graphs and replays the barriers against a state
+// model, checking that every access finds its resource in the right state, that
+// transients end the frame in the state the next one starts from, and that transients
+// alive at the same time never share memory.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "Random.h"
+#include "RenderGraph.h"
+#include <string>
+#include <vector>
+
+namespace
+{
+	typedef RenderGraph RG;
+
+	struct RecordedBatch
+	{
+		std::vector<RG::Barrier> Barriers;
+	};
+
+	std::vector<RecordedBatch> ExecuteAndRecord(const RG& graph)
+	{
+		std::vector<RecordedBatch> batches;
+		graph.Execute([&](const RG::Barrier* barriers, std::uint32_t count)
+		{
+			RecordedBatch batch;
+			batch.Barriers.assign(barriers, barriers + count);
+			batches.push_back(batch);
+		});
+		return batches;
+	}
+
+	bool HasTransition(const RecordedBatch& batch, RG::Resource target, std::uint32_t before, std::uint32_t after)
+	{
+		for(auto& b : batch.Barriers)
+		{
+			if(b.BarrierType == RG::Barrier::Transition && b.Target == target &&
+				b.StateBefore == before && b.StateAfter == after)
+				return true;
+		}
+		return false;
+	}
+
+	bool HasAliasing(const RecordedBatch& batch, RG::Resource target, RG::Resource aliasBefore)
+	{
+		for(auto& b : batch.Barriers)
+		{
+			if(b.BarrierType == RG::Barrier::Aliasing && b.Target == target && b.AliasBefore == aliasBefore)
+				return true;
+		}
+		return false;
+	}
+
+	// Shadow -> Scene -> Blur -> Tonemap into the back buffer, plus a debug pass whose
+	// output nobody reads.
+	struct PostChain
+	{
+		RG Graph;
+		RG::Resource BackBuffer, Depth, Shadow, Hdr, Blur, Unused;
+		RG::Pass ShadowPass, ScenePass, DebugPass, BlurPass, TonemapPass;
+		std::vector<std::string> Ran;
+
+		PostChain()
+		{
+			BackBuffer = Graph.ImportResource("BackBuffer", RG::StatePresent, RG::StatePresent);
+			Depth = Graph.ImportResource("Depth", RG::StateDepthWrite, RG::StateDepthWrite);
+			Shadow = Graph.CreateTransient("Shadow", 16 << 20, 65536);
+			Hdr = Graph.CreateTransient("HDR", 32 << 20, 65536);
+			Blur = Graph.CreateTransient("Blur", 8 << 20, 65536);
+			Unused = Graph.CreateTransient("Unused", 4 << 20, 65536);
+
+			ShadowPass = Graph.AddPass("Shadow", [this] { Ran.push_back("Shadow"); });
+			Graph.Write(ShadowPass, Shadow, RG::StateDepthWrite);
+
+			ScenePass = Graph.AddPass("Scene", [this] { Ran.push_back("Scene"); });
+			Graph.Read(ScenePass, Shadow, RG::StateShaderResource);
+			Graph.Write(ScenePass, Hdr, RG::StateRenderTarget);
+			Graph.Write(ScenePass, Depth, RG::StateDepthWrite);
+
+			DebugPass = Graph.AddPass("Debug", [this] { Ran.push_back("Debug"); });
+			Graph.Write(DebugPass, Unused, RG::StateRenderTarget);
+
+			BlurPass = Graph.AddPass("Blur", [this] { Ran.push_back("Blur"); });
+			Graph.Read(BlurPass, Hdr, RG::StateShaderResource);
+			Graph.Write(BlurPass, Blur, RG::StateRenderTarget);
+
+			TonemapPass = Graph.AddPass("Tonemap", [this] { Ran.push_back("Tonemap"); });
+			Graph.Read(TonemapPass, Hdr, RG::StateShaderResource);
+			Graph.Read(TonemapPass, Blur, RG::StateShaderResource);
+			Graph.Write(TonemapPass, BackBuffer, RG::StateRenderTarget);
+		}
+	};
+}
+
+TEST(CullsPassesWhoseOutputsAreNeverRead)
+{
+	PostChain chain;
+	chain.Graph.Compile();
+
+	CHECK(chain.Graph.IsCulled(chain.DebugPass));
+	CHECK(!chain.Graph.IsCulled(chain.ShadowPass));
+	CHECK(!chain.Graph.IsCulled(chain.TonemapPass));
+	CHECK_EQUAL(chain.Graph.GetStats().PassCount, 5u);
+	CHECK_EQUAL(chain.Graph.GetStats().CulledPassCount, 1u);
+
+	chain.Graph.Execute(nullptr);
+	REQUIRE(chain.Ran.size() == 4);
+	CHECK_EQUAL(chain.Ran[0], std::string("Shadow"));
+	CHECK_EQUAL(chain.Ran[1], std::string("Scene"));
+	CHECK_EQUAL(chain.Ran[2], std::string("Blur"));
+	CHECK_EQUAL(chain.Ran[3], std::string("Tonemap"));
+}
+
+TEST(CullingFollowsChainsAndKeepsSideEffects)
+{
+	RG graph;
+	RG::Resource a = graph.CreateTransient("A", 1024, 256);
+	RG::Resource b = graph.CreateTransient("B", 1024, 256);
+	RG::Resource c = graph.CreateTransient("C", 1024, 256);
+
+	// produceA -> consumeA writes B, which nobody reads: the whole chain goes.
+	RG::Pass produceA = graph.AddPass("ProduceA", nullptr);
+	graph.Write(produceA, a, RG::StateRenderTarget);
+	RG::Pass consumeA = graph.AddPass("ConsumeA", nullptr);
+	graph.Read(consumeA, a, RG::StateShaderResource);
+	graph.Write(consumeA, b, RG::StateRenderTarget);
+
+	// C is read only by a side-effect pass, which keeps its producer alive.
+	RG::Pass produceC = graph.AddPass("ProduceC", nullptr);
+	graph.Write(produceC, c, RG::StateUnorderedAccess);
+	RG::Pass readback = graph.AddPass("Readback", nullptr, true);
+	graph.Read(readback, c, RG::StateCopySource);
+
+	graph.Compile();
+
+	CHECK(graph.IsCulled(produceA));
+	CHECK(graph.IsCulled(consumeA));
+	CHECK(!graph.IsCulled(produceC));
+	CHECK(!graph.IsCulled(readback));
+	CHECK_EQUAL(graph.GetStats().CulledPassCount, 2u);
+
+	// Culled passes hold no transient memory.
+	CHECK_EQUAL(graph.GetStats().TransientCount, 1u);
+	CHECK_EQUAL(graph.TransientHeapSize(), 1024u);
+}
+
+TEST(TransitionsAreBatchedPerPass)
+{
+	PostChain chain;
+	chain.Graph.Compile();
+
+	std::vector<RecordedBatch> batches = ExecuteAndRecord(chain.Graph);
+
+	// One batch per surviving pass plus the return of the imports to their final state.
+	REQUIRE(batches.size() == 5);
+	CHECK_EQUAL(chain.Graph.GetStats().BarrierBatchCount, 5u);
+
+	std::uint32_t total = 0;
+	for(auto& batch : batches)
+		total += (std::uint32_t)batch.Barriers.size();
+	CHECK_EQUAL(chain.Graph.GetStats().BarrierCount, total);
+
+	// Transients start each frame in the state of their last use.
+	CHECK_EQUAL(chain.Graph.InitialState(chain.Shadow), (std::uint32_t)RG::StateShaderResource);
+	CHECK(HasTransition(batches[0], chain.Shadow, RG::StateShaderResource, RG::StateDepthWrite));
+
+	CHECK(HasTransition(batches[1], chain.Shadow, RG::StateDepthWrite, RG::StateShaderResource));
+	CHECK(HasTransition(batches[1], chain.Hdr, RG::StateShaderResource, RG::StateRenderTarget));
+
+	// Depth stays in its declared state, so it needs no transition at all.
+	for(auto& batch : batches)
+	{
+		for(auto& b : batch.Barriers)
+			CHECK(b.BarrierType != RG::Barrier::Transition || b.Target != chain.Depth);
+	}
+
+	CHECK(HasTransition(batches[3], chain.BackBuffer, RG::StatePresent, RG::StateRenderTarget));
+	REQUIRE(batches[4].Barriers.size() == 1);
+	CHECK(HasTransition(batches[4], chain.BackBuffer, RG::StateRenderTarget, RG::StatePresent));
+}
+
+TEST(ConsecutiveReadsShareOneTransition)
+{
+	RG graph;
+	RG::Resource target = graph.CreateTransient("Target", 4096, 256);
+	RG::Resource out = graph.ImportResource("Out", RG::StateCopyDest, RG::StateCopyDest);
+
+	RG::Pass draw = graph.AddPass("Draw", nullptr);
+	graph.Write(draw, target, RG::StateRenderTarget);
+	RG::Pass sample = graph.AddPass("Sample", nullptr);
+	graph.Read(sample, target, RG::StateShaderResource);
+	graph.Write(sample, out, RG::StateCopyDest);
+	RG::Pass copy = graph.AddPass("Copy", nullptr);
+	graph.Read(copy, target, RG::StateCopySource);
+	graph.Write(copy, out, RG::StateCopyDest);
+
+	graph.Compile();
+	std::vector<RecordedBatch> batches = ExecuteAndRecord(graph);
+
+	// The sample pass moves the target straight into both read states, and the copy
+	// pass finds it already readable.
+	std::uint32_t combined = RG::StateShaderResource | RG::StateCopySource;
+	REQUIRE(batches.size() == 2);
+	CHECK(HasTransition(batches[1], target, RG::StateRenderTarget, combined));
+	CHECK_EQUAL(batches[1].Barriers.size(), 1u);
+	CHECK_EQUAL(graph.InitialState(target), combined);
+}
+
+TEST(AliasingReportCountsSharedMemory)
+{
+	PostChain chain;
+	chain.Graph.Compile();
+	const RG& graph = chain.Graph;
+
+	// HDR lives through the whole chain and takes the bottom of the heap.  Shadow dies
+	// before Blur is born, so Blur reuses Shadow's memory.
+	CHECK_EQUAL(graph.TransientOffset(chain.Hdr), 0u);
+	CHECK_EQUAL(graph.TransientOffset(chain.Shadow), 32u << 20);
+	CHECK_EQUAL(graph.TransientOffset(chain.Blur), 32u << 20);
+	CHECK_EQUAL(graph.TransientHeapSize(), 48u << 20);
+
+	RG::Stats stats = graph.GetStats();
+	CHECK_EQUAL(stats.TransientCount, 3u);
+	CHECK_EQUAL(stats.TransientBytes, 56u << 20);
+	CHECK_EQUAL(stats.AliasedTransientBytes, 48u << 20);
+	CHECK_NEAR(stats.AliasingSavings(), 1.0 - 48.0 / 56.0, 1e-6);
+
+	std::vector<RecordedBatch> batches = ExecuteAndRecord(graph);
+	REQUIRE(batches.size() == 5);
+	CHECK(HasAliasing(batches[0], chain.Shadow, RG::InvalidResource));
+	CHECK(HasAliasing(batches[2], chain.Blur, chain.Shadow));
+
+	std::string report = graph.Report();
+	CHECK(report.find("4/5 passes") != std::string::npos);
+	CHECK(report.find("pass Debug (culled)") != std::string::npos);
+	CHECK(report.find("57344 KB unaliased, 49152 KB aliased (14% saved)") != std::string::npos);
+}
+
+TEST(ResetForgetsEverything)
+{
+	PostChain chain;
+	chain.Graph.Compile();
+	chain.Graph.Reset();
+
+	CHECK_EQUAL(chain.Graph.ResourceCount(), 0u);
+	CHECK_EQUAL(chain.Graph.TransientHeapSize(), 0u);
+	CHECK_EQUAL(chain.Graph.GetStats().PassCount, 0u);
+	CHECK_NEAR(chain.Graph.GetStats().AliasingSavings(), 0.0, 0.0);
+}
+
+TEST(FuzzBarriersAgainstStateModel)
+{
+	const std::uint32_t writeStates[] = { RG::StateRenderTarget, RG::StateDepthWrite, RG::StateUnorderedAccess, RG::StateCopyDest };
+	const std::uint32_t readStates[] = { RG::StateShaderResource, RG::StateDepthRead, RG::StateCopySource, RG::StateVertexBuffer };
+
+	Pcg32 rng(80, 1);
+	for(int round = 0; round < 500; ++round)
+	{
+		RG graph;
+		std::uint32_t importCount = 1 + rng.NextBounded(3);
+		std::uint32_t transientCount = 1 + rng.NextBounded(8);
+		std::uint32_t passCount = 1 + rng.NextBounded(12);
+
+		std::vector<std::uint32_t> importFinal;
+		std::vector<std::uint64_t> sizes, alignments;
+		for(std::uint32_t i = 0; i < importCount; ++i)
+		{
+			std::uint32_t state = rng.NextBounded(2) ? RG::StatePresent : RG::StateCopyDest;
+			importFinal.push_back(rng.NextBounded(3) ? state : RG::StateUndefined);
+			graph.ImportResource("Import" + std::to_string(i), state, importFinal.back());
+			sizes.push_back(0);
+			alignments.push_back(1);
+		}
+		for(std::uint32_t i = 0; i < transientCount; ++i)
+		{
+			sizes.push_back(256 * (1 + rng.NextBounded(64)));
+			alignments.push_back(256u << rng.NextBounded(3));
+			graph.CreateTransient("Transient" + std::to_string(i), sizes.back(), alignments.back());
+		}
+
+		// Accesses as declared: states[pass][resource], zero if the pass doesn't use it.
+		std::uint32_t resourceCount = graph.ResourceCount();
+		std::vector<std::vector<std::uint32_t>> states(passCount, std::vector<std::uint32_t>(resourceCount, 0));
+		std::vector<std::vector<bool>> writes(passCount, std::vector<bool>(resourceCount, false));
+		std::vector<std::uint32_t> ran;
+
+		for(std::uint32_t p = 0; p < passCount; ++p)
+		{
+			RG::Pass pass = graph.AddPass("Pass" + std::to_string(p), [&ran, p] { ran.push_back(p); }, rng.NextBounded(8) == 0);
+			std::uint32_t accessCount = 1 + rng.NextBounded(4);
+			for(std::uint32_t a = 0; a < accessCount; ++a)
+			{
+				RG::Resource r = rng.NextBounded(resourceCount);
+				if(writes[p][r])
+					continue;
+
+				if(states[p][r] == 0 && rng.NextBounded(2) == 0)
+				{
+					states[p][r] = writeStates[rng.NextBounded(4)];
+					writes[p][r] = true;
+					graph.Write(pass, r, states[p][r]);
+				}
+				else
+				{
+					std::uint32_t state = readStates[rng.NextBounded(4)];
+					states[p][r] |= state;
+					graph.Read(pass, r, state);
+				}
+			}
+		}
+
+		graph.Compile();
+
+		// Replay the barriers.  A batch arrives before its pass runs, so the passes that
+		// ran since the previous batch are checked before the batch is applied.
+		std::vector<std::uint32_t> current(resourceCount);
+		for(RG::Resource r = 0; r < resourceCount; ++r)
+			current[r] = graph.InitialState(r);
+
+		std::vector<bool> placed(resourceCount, false);
+		bool statesMatch = true;
+		bool placedBeforeUse = true;
+		std::size_t checked = 0;
+
+		auto checkRanPasses = [&]
+		{
+			for(; checked < ran.size(); ++checked)
+			{
+				std::uint32_t p = ran[checked];
+				for(RG::Resource r = 0; r < resourceCount; ++r)
+				{
+					std::uint32_t required = states[p][r];
+					if(required == 0)
+						continue;
+					if(graph.IsTransient(r) && !placed[r])
+						placedBeforeUse = false;
+
+					bool readable = (current[r] & ~(std::uint32_t)RG::ReadOnlyStates) == 0 && (current[r] & required) == required;
+					if(writes[p][r] ? current[r] != required : !readable)
+						statesMatch = false;
+				}
+			}
+		};
+
+		graph.Execute([&](const RG::Barrier* barriers, std::uint32_t count)
+		{
+			checkRanPasses();
+			for(std::uint32_t i = 0; i < count; ++i)
+			{
+				const RG::Barrier& b = barriers[i];
+				if(b.BarrierType == RG::Barrier::Aliasing)
+				{
+					placed[b.Target] = true;
+					continue;
+				}
+				if(b.StateBefore != current[b.Target] || b.StateBefore == b.StateAfter)
+					statesMatch = false;
+				current[b.Target] = b.StateAfter;
+			}
+		});
+		checkRanPasses();
+		CHECK(statesMatch);
+		CHECK(placedBeforeUse);
+
+		// Exactly the surviving passes ran, in order.
+		std::vector<std::uint32_t> expectedRan;
+		for(std::uint32_t p = 0; p < passCount; ++p)
+		{
+			if(!graph.IsCulled(p))
+				expectedRan.push_back(p);
+		}
+		CHECK(ran == expectedRan);
+
+		// Imports end the frame in their final state, and transients in the state the
+		// next frame expects them in.
+		for(RG::Resource r = 0; r < importCount; ++r)
+		{
+			if(importFinal[r] != RG::StateUndefined)
+				CHECK_EQUAL(current[r], importFinal[r]);
+		}
+		for(RG::Resource r = importCount; r < resourceCount; ++r)
+		{
+			if(placed[r])
+				CHECK_EQUAL(current[r], graph.InitialState(r));
+		}
+
+		// Live ranges over the surviving passes.
+		std::vector<std::uint32_t> first(resourceCount, ~0u), last(resourceCount, 0);
+		for(std::uint32_t p : expectedRan)
+		{
+			for(RG::Resource r = 0; r < resourceCount; ++r)
+			{
+				if(states[p][r] == 0)
+					continue;
+				if(first[r] == ~0u)
+					first[r] = p;
+				last[r] = p;
+			}
+		}
+
+		std::uint64_t unaliasedBytes = 0;
+		std::uint32_t liveTransients = 0;
+		for(RG::Resource a = importCount; a < resourceCount; ++a)
+		{
+			if(first[a] == ~0u)
+				continue;
+
+			std::uint64_t offset = graph.TransientOffset(a);
+			CHECK_EQUAL(offset % alignments[a], 0u);
+			CHECK(offset + sizes[a] <= graph.TransientHeapSize());
+			unaliasedBytes += (sizes[a] + alignments[a] - 1) / alignments[a] * alignments[a];
+			liveTransients++;
+
+			for(RG::Resource b = a + 1; b < resourceCount; ++b)
+			{
+				if(first[b] == ~0u || first[a] > last[b] || first[b] > last[a])
+					continue;
+
+				std::uint64_t other = graph.TransientOffset(b);
+				CHECK(offset + sizes[a] <= other || other + sizes[b] <= offset);
+			}
+		}
+
+		RG::Stats stats = graph.GetStats();
+		CHECK_EQUAL(stats.TransientCount, liveTransients);
+		CHECK_EQUAL(stats.TransientBytes, unaliasedBytes);
+		CHECK_EQUAL(stats.AliasedTransientBytes, graph.TransientHeapSize());
+	}
+}
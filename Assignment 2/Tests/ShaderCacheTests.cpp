@@ -0,0 +1,367 @@
+//***************************************************************************************
+// ShaderCacheTests.cpp
+//
+// The shader cache with a stand-in compiler that turns a request into fake bytecode:
+// misses compile and store, hits load without compiling, every part of a request and
+// every file in the include graph feeds the key, compile failures store nothing, and
+// ResolveAll compiles misses in parallel.  Sources and entries live in a scratch
+// directory under the working directory, removed when each case ends.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "ShaderCache.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// Files written by a case, deleted with their directories when it ends.
+	class Scratch
+	{
+	public:
+		explicit Scratch(const std::string& name)
+		{
+#ifdef _WIN32
+			mRoot = name + "-" + std::to_string(_getpid()) + "/";
+#else
+			mRoot = name + "-" + std::to_string(getpid()) + "/";
+#endif
+			MakeDirectory(mRoot);
+		}
+
+		~Scratch()
+		{
+			for(auto it = mFiles.rbegin(); it != mFiles.rend(); ++it)
+				std::remove(it->c_str());
+			for(auto it = mDirectories.rbegin(); it != mDirectories.rend(); ++it)
+				RemoveDirectory(*it);
+		}
+
+		std::string Path(const std::string& relative)const { return mRoot + relative; }
+
+		void MakeDirectory(const std::string& path)
+		{
+#ifdef _WIN32
+			_mkdir(path.c_str());
+#else
+			mkdir(path.c_str(), 0755);
+#endif
+			mDirectories.push_back(path);
+		}
+
+		void Write(const std::string& relative, const std::string& contents)
+		{
+			std::ofstream(Path(relative), std::ios::binary | std::ios::trunc) << contents;
+			Track(Path(relative));
+		}
+
+		void Track(const std::string& path)
+		{
+			if(std::find(mFiles.begin(), mFiles.end(), path) == mFiles.end())
+				mFiles.push_back(path);
+		}
+
+	private:
+		static void RemoveDirectory(const std::string& path)
+		{
+#ifdef _WIN32
+			_rmdir(path.c_str());
+#else
+			rmdir(path.c_str());
+#endif
+		}
+
+	private:
+		std::string mRoot;
+		std::vector<std::string> mFiles;
+		std::vector<std::string> mDirectories;
+	};
+
+	bool FileExists(const std::string& path)
+	{
+		return (bool)std::ifstream(path, std::ios::binary);
+	}
+
+	std::string ReadFile(const std::string& path)
+	{
+		std::ifstream fin(path, std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+	}
+
+	// "Compiles" a request into its entry point and target, and counts the calls.
+	// Entry point "Broken" fails the way a syntax error would.
+	struct StandInCompiler
+	{
+		std::atomic<int> Calls{ 0 };
+		std::atomic<int> Running{ 0 };
+		std::atomic<int> MaxRunning{ 0 };
+		double Milliseconds = 0.0;
+
+		ShaderCache::CompileCallback Callback()
+		{
+			return [this](const ShaderCache::Request& request, std::vector<std::uint8_t>& bytecode, std::string& errors)
+			{
+				Calls++;
+				int running = ++Running;
+				int seen = MaxRunning.load();
+				while(running > seen && !MaxRunning.compare_exchange_weak(seen, running))
+				{
+				}
+
+				if(Milliseconds > 0.0)
+					std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(Milliseconds));
+				Running--;
+
+				if(request.EntryPoint == "Broken")
+				{
+					errors = request.File + "(3,1): error X3000: syntax error";
+					return false;
+				}
+
+				const std::string text = "DXBC " + request.EntryPoint + " " + request.Target;
+				bytecode.assign(text.begin(), text.end());
+				return true;
+			};
+		}
+	};
+
+	// Shaders/Default.hlsl includes Lighting.hlsl, which includes Common/Constants.hlsl.
+	// The cache directory is made here too so the scratch removes it.
+	void WriteShaders(Scratch& scratch)
+	{
+		scratch.MakeDirectory(scratch.Path("Cache"));
+		scratch.MakeDirectory(scratch.Path("Shaders"));
+		scratch.MakeDirectory(scratch.Path("Shaders/Common"));
+		scratch.Write("Shaders/Common/Constants.hlsl", "#define MaxLights 16\n");
+		scratch.Write("Shaders/Lighting.hlsl", "#include \"Common/Constants.hlsl\"\nfloat3 Light();\n");
+		scratch.Write("Shaders/Default.hlsl", "  #  include \"Lighting.hlsl\"\n#include <angled.h>\nfloat4 VS() : SV_Position;\n");
+	}
+
+	ShaderCache::Request VertexShader(const Scratch& scratch)
+	{
+		ShaderCache::Request request;
+		request.File = scratch.Path("Shaders/Default.hlsl");
+		request.EntryPoint = "VS";
+		request.Target = "vs_5_1";
+		return request;
+	}
+}
+
+TEST(MissCompilesThenHitLoads)
+{
+	Scratch scratch("ShaderCacheMiss");
+	WriteShaders(scratch);
+	StandInCompiler compiler;
+
+	std::string entry;
+	{
+		ShaderCache cache(scratch.Path("Cache"), compiler.Callback());
+		entry = cache.Resolve(VertexShader(scratch));
+		scratch.Track(entry);
+
+		CHECK_EQUAL(compiler.Calls.load(), 1);
+		CHECK_EQUAL(ReadFile(entry), std::string("DXBC VS vs_5_1"));
+		CHECK_EQUAL(cache.GetStats().Misses, 1u);
+		CHECK_EQUAL(cache.GetStats().Hits, 0u);
+
+		// No temporary file is left next to the entry.
+		CHECK(!FileExists(entry + ".tmp"));
+	}
+
+	// A later run finds the entry on disk.
+	ShaderCache cache(scratch.Path("Cache"), compiler.Callback());
+	CHECK_EQUAL(cache.Resolve(VertexShader(scratch)), entry);
+	CHECK_EQUAL(compiler.Calls.load(), 1);
+	CHECK_EQUAL(cache.GetStats().Hits, 1u);
+	CHECK_EQUAL(cache.GetStats().Misses, 0u);
+	CHECK(cache.StatsString().find("1 hits, 0 misses") != std::string::npos);
+}
+
+TEST(KeyCoversEveryPartOfTheRequest)
+{
+	Scratch scratch("ShaderCacheKey");
+	WriteShaders(scratch);
+	scratch.Write("Shaders/Other.hlsl", "  #  include \"Lighting.hlsl\"\n#include <angled.h>\nfloat4 VS() : SV_Position;\n");
+	StandInCompiler compiler;
+	ShaderCache cache(scratch.Path("Cache"), compiler.Callback());
+
+	const ShaderCache::Request base = VertexShader(scratch);
+	const std::uint64_t baseKey = cache.Key(base);
+	CHECK_EQUAL(cache.Key(base), baseKey);
+
+	std::vector<ShaderCache::Request> variants(8, base);
+	variants[0].EntryPoint = "PS";
+	variants[1].Target = "vs_5_0";
+	variants[2].Flags = 1;
+	variants[3].Defines = { { "BINDLESS", "1" } };
+	variants[4].Defines = { { "BINDLESS", "0" } };
+	variants[5].Defines = { { "AB", "C" } };
+	variants[6].Defines = { { "A", "BC" } };
+	variants[7].File = scratch.Path("Shaders/Other.hlsl");
+
+	// Every variant differs from the base and from each other, even Other.hlsl with
+	// the same contents as Default.hlsl.
+	std::vector<std::uint64_t> keys(1, baseKey);
+	for(const ShaderCache::Request& variant : variants)
+		keys.push_back(cache.Key(variant));
+	std::sort(keys.begin(), keys.end());
+	CHECK(std::adjacent_find(keys.begin(), keys.end()) == keys.end());
+
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.cso", (unsigned long long)baseKey);
+	CHECK_EQUAL(cache.EntryPath(baseKey), scratch.Path("Cache/") + name);
+}
+
+TEST(EditingAnIncludeInvalidatesTheEntry)
+{
+	Scratch scratch("ShaderCacheInclude");
+	WriteShaders(scratch);
+	StandInCompiler compiler;
+
+	std::uint64_t before = 0;
+	{
+		ShaderCache cache(scratch.Path("Cache"), compiler.Callback());
+		scratch.Track(cache.Resolve(VertexShader(scratch)));
+		before = cache.Key(VertexShader(scratch));
+
+		// Source hashes are remembered until InvalidateSources.
+		scratch.Write("Shaders/Common/Constants.hlsl", "#define MaxLights 32\n");
+		CHECK_EQUAL(cache.Key(VertexShader(scratch)), before);
+
+		cache.InvalidateSources();
+		CHECK(cache.Key(VertexShader(scratch)) != before);
+	}
+
+	// A new run sees the edit two includes down as a miss.
+	ShaderCache cache(scratch.Path("Cache"), compiler.Callback());
+	scratch.Track(cache.Resolve(VertexShader(scratch)));
+	CHECK_EQUAL(compiler.Calls.load(), 2);
+	CHECK_EQUAL(cache.GetStats().Misses, 1u);
+
+	// Putting the old contents back finds the old entry again.
+	scratch.Write("Shaders/Common/Constants.hlsl", "#define MaxLights 16\n");
+	cache.InvalidateSources();
+	CHECK_EQUAL(cache.Key(VertexShader(scratch)), before);
+	cache.Resolve(VertexShader(scratch));
+	CHECK_EQUAL(compiler.Calls.load(), 2);
+}
+
+TEST(SourceFilesFollowsIncludesOnce)
+{
+	Scratch scratch("ShaderCacheSources");
+	WriteShaders(scratch);
+
+	// An include cycle must terminate, and each file is listed once.
+	scratch.Write("Shaders/A.hlsl", "#include \"B.hlsl\"\n#include \"Lighting.hlsl\"\n");
+	scratch.Write("Shaders/B.hlsl", "#include \"A.hlsl\"\n#include \"Lighting.hlsl\"\n");
+
+	StandInCompiler compiler;
+	ShaderCache cache(scratch.Path("Cache"), compiler.Callback());
+
+	std::vector<std::string> files = cache.SourceFiles(VertexShader(scratch));
+	REQUIRE(files.size() == 3);
+	CHECK_EQUAL(files[0], scratch.Path("Shaders/Default.hlsl"));
+	CHECK_EQUAL(files[1], scratch.Path("Shaders/Lighting.hlsl"));
+	CHECK_EQUAL(files[2], scratch.Path("Shaders/Common/Constants.hlsl"));
+
+	ShaderCache::Request cyclic = VertexShader(scratch);
+	cyclic.File = scratch.Path("Shaders/A.hlsl");
+	files = cache.SourceFiles(cyclic);
+	CHECK_EQUAL(files.size(), 4u);
+	cache.Key(cyclic);
+}
+
+TEST(FailuresThrowAndStoreNothing)
+{
+	Scratch scratch("ShaderCacheFailure");
+	WriteShaders(scratch);
+	StandInCompiler compiler;
+	ShaderCache cache(scratch.Path("Cache"), compiler.Callback());
+
+	ShaderCache::Request broken = VertexShader(scratch);
+	broken.EntryPoint = "Broken";
+
+	std::string message;
+	try
+	{
+		cache.Resolve(broken);
+	}
+	catch(const std::runtime_error& e)
+	{
+		message = e.what();
+	}
+	CHECK(message.find("error X3000: syntax error") != std::string::npos);
+	CHECK(!FileExists(cache.EntryPath(cache.Key(broken))));
+	CHECK_EQUAL(cache.GetStats().Misses, 0u);
+
+	// A missing include is reported before anything compiles.
+	scratch.Write("Shaders/Missing.hlsl", "#include \"NotThere.hlsl\"\n");
+	ShaderCache::Request missing = VertexShader(scratch);
+	missing.File = scratch.Path("Shaders/Missing.hlsl");
+
+	bool threw = false;
+	try
+	{
+		cache.Resolve(missing);
+	}
+	catch(const std::runtime_error&)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+	CHECK_EQUAL(compiler.Calls.load(), 1);
+}
+
+TEST(ResolveAllCompilesMissesInParallel)
+{
+	Scratch scratch("ShaderCacheParallel");
+	WriteShaders(scratch);
+	StandInCompiler compiler;
+	compiler.Milliseconds = 20.0;
+
+	std::vector<ShaderCache::Request> requests;
+	for(int i = 0; i < 8; ++i)
+	{
+		ShaderCache::Request request = VertexShader(scratch);
+		request.Defines = { { "VARIANT", std::to_string(i) } };
+		requests.push_back(request);
+	}
+
+	TaskPool pool(3);
+	std::vector<std::string> paths;
+	{
+		ShaderCache cache(scratch.Path("Cache"), compiler.Callback());
+		paths = cache.ResolveAll(requests, pool);
+		for(const std::string& path : paths)
+			scratch.Track(path);
+
+		CHECK_EQUAL(cache.GetStats().Misses, 8u);
+		CHECK(compiler.MaxRunning.load() > 1);
+
+		// Paths come back in request order.
+		REQUIRE(paths.size() == requests.size());
+		for(std::size_t i = 0; i < requests.size(); ++i)
+			CHECK_EQUAL(paths[i], cache.EntryPath(cache.Key(requests[i])));
+	}
+
+	ShaderCache cache(scratch.Path("Cache"), compiler.Callback());
+	CHECK(cache.ResolveAll(requests, pool) == paths);
+	CHECK_EQUAL(cache.GetStats().Hits, 8u);
+	CHECK_EQUAL(compiler.Calls.load(), 8);
+}
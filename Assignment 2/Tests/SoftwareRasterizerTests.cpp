@@ -0,0 +1,488 @@
+//***************************************************************************************
+// SoftwareRasterizerTests.cpp
+//
+// The software rasterizer and command backend against golden images in Tests/Golden:
+// overlapping gradient triangles with a depth test across partial tiles, perspective
+// geometry clipped by the near plane, and a box replayed from a CommandStream through
+// SoftwareCommandBackend.  Alongside the images, the invariants the header promises:
+// shared edges are drawn once, the image does not depend on the thread count, and
+// culling and clipping are counted.
+//
+// A mismatch writes <name>.actual.ppm to the working directory for diffing.  After an
+// intended change to the output, run with A2_UPDATE_GOLDEN=1 to rewrite the images.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "GeometryGenerator.h"
+#include "Random.h"
+#include "SoftwareCommandBackend.h"
+#include "SoftwareRasterizer.h"
+#include "TaskPool.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	typedef SoftwareRasterizer::ShadedVertex ShadedVertex;
+
+	const float Black[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	const float Gray[4] = { 0.2f, 0.2f, 0.25f, 1.0f };
+
+	// Varyings 0-2 are the colour.
+	class ColorShader : public SoftwareRasterizer::PixelShader
+	{
+	public:
+		void Shade(const float* varyings, float rgba[4])const override
+		{
+			rgba[0] = varyings[0];
+			rgba[1] = varyings[1];
+			rgba[2] = varyings[2];
+			rgba[3] = 1.0f;
+		}
+	};
+
+	ShadedVertex Vertex(float x, float y, float z, float w, float r, float g, float b)
+	{
+		ShadedVertex v = {};
+		v.PosH = XMFLOAT4(x, y, z, w);
+		v.Varyings[0] = r;
+		v.Varyings[1] = g;
+		v.Varyings[2] = b;
+		return v;
+	}
+
+	// A vertex at screen position (sx, sy) in pixels, for a width x height target.
+	ShadedVertex ScreenVertex(float sx, float sy, float z, std::uint32_t width, std::uint32_t height)
+	{
+		return Vertex(2.0f * sx / width - 1.0f, 1.0f - 2.0f * sy / height, z, 1.0f, 1.0f, 1.0f, 1.0f);
+	}
+
+	// A world-space point through view * projection, coloured.
+	ShadedVertex Project(FXMVECTOR p, CXMMATRIX viewProj, float r, float g, float b)
+	{
+		XMFLOAT4 h;
+		XMStoreFloat4(&h, XMVector4Transform(XMVectorSetW(p, 1.0f), viewProj));
+		return Vertex(h.x, h.y, h.z, h.w, r, g, b);
+	}
+
+	XMMATRIX ViewProj(float width, float height)
+	{
+		return XMMatrixLookAtLH(XMVectorSet(0.0f, 2.0f, -6.0f, 1.0f), XMVectorSet(0.0f, 0.5f, 0.0f, 1.0f),
+			XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) * XMMatrixPerspectiveFovLH(0.3f * XM_PI, width / height, 0.5f, 50.0f);
+	}
+
+	struct Image
+	{
+		std::uint32_t Width = 0;
+		std::uint32_t Height = 0;
+		std::vector<std::uint8_t> Rgb;
+	};
+
+	bool ReadPpm(const std::string& path, Image& image)
+	{
+		std::ifstream file(path, std::ios::binary);
+		std::string magic;
+		std::uint32_t maxValue = 0;
+		if(!(file >> magic >> image.Width >> image.Height >> maxValue) || magic != "P6" || maxValue != 255)
+			return false;
+		file.get();
+
+		image.Rgb.resize((std::size_t)image.Width * image.Height * 3);
+		file.read((char*)image.Rgb.data(), image.Rgb.size());
+		return (bool)file;
+	}
+
+	Image Capture(const SoftwareRasterizer& r)
+	{
+		Image image;
+		image.Width = r.Width();
+		image.Height = r.Height();
+		for(std::uint32_t y = 0; y < r.Height(); ++y)
+		{
+			for(std::uint32_t x = 0; x < r.Width(); ++x)
+			{
+				const std::uint32_t p = r.Pixels()[(std::size_t)y * r.Pitch() + x];
+				image.Rgb.push_back((std::uint8_t)(p & 0xff));
+				image.Rgb.push_back((std::uint8_t)((p >> 8) & 0xff));
+				image.Rgb.push_back((std::uint8_t)((p >> 16) & 0xff));
+			}
+		}
+		return image;
+	}
+
+	// Compares the rendered image with Tests/Golden/<name>.ppm.  A channel may be off
+	// by one for rounding in another math library; anything more is a mismatch.
+	bool MatchesGolden(const SoftwareRasterizer& r, const std::string& name)
+	{
+		const std::string golden = std::string(A2_GOLDEN_DIR) + "/" + name + ".ppm";
+		const char* update = std::getenv("A2_UPDATE_GOLDEN");
+		if(update != nullptr && update[0] != '\0' && update[0] != '0')
+			return r.WritePpm(golden);
+
+		Image expected;
+		if(!ReadPpm(golden, expected))
+		{
+			std::printf("  cannot read %s\n", golden.c_str());
+			return false;
+		}
+
+		const Image actual = Capture(r);
+		std::size_t mismatched = 0;
+		if(expected.Width != actual.Width || expected.Height != actual.Height)
+			mismatched = actual.Rgb.size() / 3;
+		else
+		{
+			for(std::size_t i = 0; i < actual.Rgb.size(); i += 3)
+			{
+				for(std::size_t c = 0; c < 3; ++c)
+				{
+					if(std::abs((int)actual.Rgb[i + c] - (int)expected.Rgb[i + c]) > 1)
+					{
+						mismatched++;
+						break;
+					}
+				}
+			}
+		}
+
+		if(mismatched > 0)
+		{
+			std::printf("  %s: %zu pixels differ; wrote %s.actual.ppm\n", name.c_str(), mismatched, name.c_str());
+			r.WritePpm(name + ".actual.ppm");
+		}
+		return mismatched == 0;
+	}
+
+	// Overlapping triangles with per-vertex colours: two of them pass through each
+	// other in depth, and one has different w at each vertex so its colours are only
+	// right with perspective-correct interpolation.  150 x 100 leaves partial tiles
+	// and a row pitch wider than the image.
+	void DrawGradients(SoftwareRasterizer& r, TaskPool* pool)
+	{
+		static const ColorShader shader;
+		r.BeginFrame(150, 100, Gray);
+
+		r.SubmitTriangle(Vertex(-0.9f, 0.9f, 0.2f, 1.0f, 1, 0, 0), Vertex(0.6f, 0.7f, 0.8f, 1.0f, 0, 1, 0),
+			Vertex(-0.6f, -0.9f, 0.5f, 1.0f, 0, 0, 1), 3, &shader, SoftwareRasterizer::CullMode::None);
+		r.SubmitTriangle(Vertex(-0.8f, -0.2f, 0.9f, 1.0f, 1, 1, 0), Vertex(0.9f, 0.8f, 0.1f, 1.0f, 0, 1, 1),
+			Vertex(0.7f, -0.8f, 0.4f, 1.0f, 1, 0, 1), 3, &shader, SoftwareRasterizer::CullMode::None);
+		r.SubmitTriangle(Vertex(0.1f * 4.0f, -0.1f * 4.0f, 0.05f * 4.0f, 4.0f, 1, 1, 1),
+			Vertex(0.95f, -0.1f, 0.05f, 1.0f, 0, 0, 0), Vertex(0.3f * 0.5f, -0.95f * 0.5f, 0.05f * 0.5f, 0.5f, 1, 0.5f, 0),
+			3, &shader, SoftwareRasterizer::CullMode::None);
+
+		r.Resolve(pool);
+	}
+
+	// A floor running from behind the camera into the distance and a wall standing on
+	// it; the floor's near triangles are clipped by the near plane.
+	void DrawPerspective(SoftwareRasterizer& r, TaskPool* pool)
+	{
+		static const ColorShader shader;
+		const std::uint32_t width = 160;
+		const std::uint32_t height = 120;
+		const XMMATRIX viewProj = ViewProj((float)width, (float)height);
+		r.BeginFrame(width, height, Black);
+
+		// A checkerboard floor, one quad per cell, clockwise from above.
+		for(int z = -8; z < 12; ++z)
+		{
+			for(int x = -6; x < 6; ++x)
+			{
+				const float c = ((x + z) & 1) ? 0.9f : 0.3f;
+				const ShadedVertex a = Project(XMVectorSet((float)x, 0.0f, (float)z, 1.0f), viewProj, c, c, c);
+				const ShadedVertex b = Project(XMVectorSet((float)x, 0.0f, (float)z + 1, 1.0f), viewProj, c, c, c);
+				const ShadedVertex d = Project(XMVectorSet((float)x + 1, 0.0f, (float)z + 1, 1.0f), viewProj, c, c, c);
+				const ShadedVertex e = Project(XMVectorSet((float)x + 1, 0.0f, (float)z, 1.0f), viewProj, c, c, c);
+				r.SubmitTriangle(a, b, d, 3, &shader, SoftwareRasterizer::CullMode::Back);
+				r.SubmitTriangle(a, d, e, 3, &shader, SoftwareRasterizer::CullMode::Back);
+			}
+		}
+
+		// A wall facing the camera, half sunk into the floor.
+		const ShadedVertex w0 = Project(XMVectorSet(-1.5f, -0.5f, 2.0f, 1.0f), viewProj, 1, 0, 0);
+		const ShadedVertex w1 = Project(XMVectorSet(-1.5f, 1.5f, 2.5f, 1.0f), viewProj, 0, 1, 0);
+		const ShadedVertex w2 = Project(XMVectorSet(1.5f, 1.5f, 3.0f, 1.0f), viewProj, 0, 0, 1);
+		const ShadedVertex w3 = Project(XMVectorSet(1.5f, -0.5f, 2.5f, 1.0f), viewProj, 1, 1, 0);
+		r.SubmitTriangle(w0, w1, w2, 3, &shader, SoftwareRasterizer::CullMode::Back);
+		r.SubmitTriangle(w0, w2, w3, 3, &shader, SoftwareRasterizer::CullMode::Back);
+
+		r.Resolve(pool);
+	}
+
+	// Position and normal, as the box is laid out in its vertex buffer.
+	struct BoxVertex
+	{
+		XMFLOAT3 Position;
+		XMFLOAT3 Normal;
+	};
+
+	// Transforms by the matrix bound as root CBV 0 and colours by normal.
+	class BoxProgram : public SoftwareCommandBackend::DrawProgram
+	{
+	public:
+		bool Draw(const SoftwareCommandBackend::DrawState& draw, SoftwareRasterizer& r) override
+		{
+			if(draw.VertexStride != sizeof(BoxVertex) || draw.RootAddresses[0] == nullptr ||
+				draw.RootSizes[0] < sizeof(XMFLOAT4X4))
+				return false;
+
+			const XMMATRIX m = XMLoadFloat4x4(static_cast<const XMFLOAT4X4*>(draw.RootAddresses[0]));
+			for(std::uint32_t i = 0; i < draw.IndexCount; i += 3)
+			{
+				ShadedVertex v[3];
+				for(std::uint32_t k = 0; k < 3; ++k)
+				{
+					const BoxVertex& in = *reinterpret_cast<const BoxVertex*>(draw.Vertices + draw.Index(i + k) * draw.VertexStride);
+					v[k] = Project(XMLoadFloat3(&in.Position), m,
+						0.5f + 0.5f * in.Normal.x, 0.5f + 0.5f * in.Normal.y, 0.5f + 0.5f * in.Normal.z);
+				}
+				r.SubmitTriangle(v[0], v[1], v[2], 3, &mShader, SoftwareRasterizer::CullMode::Back);
+			}
+			return true;
+		}
+
+	private:
+		ColorShader mShader;
+	};
+
+	// 8 x 4 triangles from a fan around (cx, cy), covering the pixel rectangle
+	// [x0, x1) x [y0, y1).
+	void SubmitFan(SoftwareRasterizer& r, const SoftwareRasterizer::PixelShader* shader,
+		float x0, float y0, float x1, float y1, float cx, float cy)
+	{
+		const std::uint32_t w = r.Width();
+		const std::uint32_t h = r.Height();
+		const ShadedVertex center = ScreenVertex(cx, cy, 0.5f, w, h);
+
+		// The rectangle's outline, clockwise on screen, with two points per side.
+		std::vector<XMFLOAT2> outline;
+		for(int i = 0; i < 2; ++i)
+			outline.push_back(XMFLOAT2(x0 + (x1 - x0) * i / 2.0f, y0));
+		for(int i = 0; i < 2; ++i)
+			outline.push_back(XMFLOAT2(x1, y0 + (y1 - y0) * i / 2.0f));
+		for(int i = 0; i < 2; ++i)
+			outline.push_back(XMFLOAT2(x1 - (x1 - x0) * i / 2.0f, y1));
+		for(int i = 0; i < 2; ++i)
+			outline.push_back(XMFLOAT2(x0, y1 - (y1 - y0) * i / 2.0f));
+
+		for(std::size_t i = 0; i < outline.size(); ++i)
+		{
+			const XMFLOAT2& a = outline[i];
+			const XMFLOAT2& b = outline[(i + 1) % outline.size()];
+			r.SubmitTriangle(center, ScreenVertex(a.x, a.y, 0.5f, w, h), ScreenVertex(b.x, b.y, 0.5f, w, h),
+				3, shader, SoftwareRasterizer::CullMode::Back);
+		}
+	}
+}
+
+TEST(GradientTrianglesMatchGolden)
+{
+	SoftwareRasterizer r;
+	DrawGradients(r, nullptr);
+	CHECK(MatchesGolden(r, "SoftwareRasterizerGradients"));
+	CHECK_EQUAL(r.GetStats().TrianglesSubmitted, 3u);
+	CHECK_EQUAL(r.GetStats().TrianglesRasterized, 3u);
+}
+
+TEST(ClippedPerspectiveSceneMatchesGolden)
+{
+	SoftwareRasterizer r;
+	DrawPerspective(r, nullptr);
+	CHECK(MatchesGolden(r, "SoftwareRasterizerPerspective"));
+
+	// Rows of floor behind the camera are dropped, and the ones crossing the near
+	// plane come back as fans, so more triangles are binned than the visible cells
+	// alone would give.
+	const SoftwareRasterizer::Stats& stats = r.GetStats();
+	CHECK_EQUAL(stats.TrianglesSubmitted, 20u * 12u * 2u + 2u);
+	CHECK(stats.TrianglesCulled > 0);
+	CHECK(stats.TrianglesRasterized > 0);
+	CHECK(stats.PixelsShaded > 0);
+}
+
+TEST(CommandStreamBoxMatchesGolden)
+{
+	GeometryGenerator geometry;
+	GeometryGenerator::MeshData box = geometry.CreateBox(2.0f, 2.0f, 2.0f, 0);
+
+	std::vector<BoxVertex> vertices;
+	for(const GeometryGenerator::Vertex& v : box.Vertices)
+		vertices.push_back(BoxVertex{ v.Position, v.Normal });
+	const std::vector<std::uint16_t>& indices = box.GetIndices16();
+
+	const std::uint32_t width = 128;
+	const std::uint32_t height = 96;
+	XMFLOAT4X4 world[2];
+	XMStoreFloat4x4(&world[0], XMMatrixRotationRollPitchYaw(0.4f, 0.7f, 0.0f) * XMMatrixTranslation(-1.2f, 0.8f, 1.0f) *
+		ViewProj((float)width, (float)height));
+	XMStoreFloat4x4(&world[1], XMMatrixScaling(0.6f, 1.2f, 0.6f) * XMMatrixRotationY(-0.5f) *
+		XMMatrixTranslation(1.3f, 0.6f, 0.0f) * ViewProj((float)width, (float)height));
+
+	const std::uint64_t vertexAddress = 0x10000;
+	const std::uint64_t indexAddress = 0x20000;
+	const std::uint64_t constantsAddress = 0x30000;
+	const std::uint32_t vertexBytes = (std::uint32_t)(vertices.size() * sizeof(BoxVertex));
+	const std::uint32_t indexBytes = (std::uint32_t)(indices.size() * sizeof(std::uint16_t));
+
+	// Both boxes, then a line list and an unmapped constant buffer, which are skipped.
+	CommandStream stream;
+	stream.SetPipeline(1);
+	stream.SetPrimitiveTopology(SoftwareCommandBackend::TriangleListTopology);
+	stream.SetVertexBuffer(vertexAddress, vertexBytes, sizeof(BoxVertex));
+	stream.SetIndexBuffer(indexAddress, indexBytes, 57);    // DXGI_FORMAT_R16_UINT
+	for(std::uint32_t i = 0; i < 2; ++i)
+	{
+		stream.SetRootCbv(0, constantsAddress + i * sizeof(XMFLOAT4X4));
+		stream.DrawIndexed((std::uint32_t)indices.size(), 1, 0, 0, 0);
+	}
+	stream.SetRootCbv(0, 0x90000);
+	stream.DrawIndexed((std::uint32_t)indices.size(), 1, 0, 0, 0);
+	stream.SetPrimitiveTopology(2);    // D3D_PRIMITIVE_TOPOLOGY_LINELIST
+	stream.DrawIndexed(6, 1, 0, 0, 0);
+
+	SoftwareRasterizer r;
+	SoftwareCommandBackend backend(r);
+	backend.MapMemory(vertexAddress, vertices.data(), vertexBytes);
+	backend.MapMemory(indexAddress, indices.data(), indexBytes);
+	backend.MapMemory(constantsAddress, world, sizeof(world));
+
+	BoxProgram program;
+	r.BeginFrame(width, height, Gray);
+	REQUIRE(backend.Execute(stream, program));
+	r.Resolve(nullptr);
+	CHECK(MatchesGolden(r, "SoftwareRasterizerBoxes"));
+
+	const SoftwareCommandBackend::Stats& stats = backend.GetStats();
+	CHECK_EQUAL(stats.Draws, 2u);
+	CHECK_EQUAL(stats.Triangles, 2u * indices.size() / 3);
+	CHECK_EQUAL(stats.SkippedByProgram, 1u);
+	CHECK_EQUAL(stats.SkippedTopology, 1u);
+
+	// Back faces of closed boxes are culled: at most half the triangles are drawn.
+	CHECK(r.GetStats().TrianglesRasterized <= r.GetStats().TrianglesSubmitted / 2);
+}
+
+TEST(SharedEdgesAreDrawnOnce)
+{
+	// A fan around a pixel-center point, with outline points on pixel corners: every
+	// pixel inside the rectangle belongs to exactly one triangle, so the number of
+	// shaded pixels is the rectangle's area.
+	static const ColorShader shader;
+	SoftwareRasterizer r;
+	r.BeginFrame(130, 70, Black);
+	SubmitFan(r, &shader, 16.0f, 8.0f, 80.0f, 56.0f, 40.5f, 30.5f);
+	SubmitFan(r, &shader, 80.0f, 8.0f, 120.0f, 56.0f, 99.0f, 31.0f);
+	r.Resolve(nullptr);
+
+	CHECK_EQUAL(r.GetStats().TrianglesRasterized, 16u);
+	CHECK_EQUAL(r.GetStats().PixelsShaded, (std::uint64_t)(120 - 16) * (56 - 8));
+
+	// Exactly the rectangle is white.
+	bool exact = true;
+	for(std::uint32_t y = 0; y < r.Height(); ++y)
+	{
+		for(std::uint32_t x = 0; x < r.Width(); ++x)
+		{
+			const bool inside = x >= 16 && x < 120 && y >= 8 && y < 56;
+			const std::uint32_t p = r.Pixels()[(std::size_t)y * r.Pitch() + x] & 0xffffff;
+			exact = exact && p == (inside ? 0xffffffu : 0u);
+		}
+	}
+	CHECK(exact);
+}
+
+TEST(ImageDoesNotDependOnThreadCount)
+{
+	// A soup of overlapping triangles, the worst case for ordering within a tile.
+	static const ColorShader shader;
+	Pcg32 rng(96);
+	std::vector<ShadedVertex> soup;
+	for(int i = 0; i < 3 * 600; ++i)
+	{
+		const float w = rng.NextFloat(0.5f, 3.0f);
+		soup.push_back(Vertex(rng.NextFloat(-1.2f, 1.2f) * w, rng.NextFloat(-1.2f, 1.2f) * w, rng.NextFloat(0.0f, 1.0f) * w, w,
+			rng.NextFloat(), rng.NextFloat(), rng.NextFloat()));
+	}
+
+	SoftwareRasterizer serial;
+	SoftwareRasterizer parallel;
+	TaskPool pool(4);
+	SoftwareRasterizer* targets[2] = { &serial, &parallel };
+	for(SoftwareRasterizer* r : targets)
+	{
+		r->BeginFrame(300, 200, Gray);
+		for(std::size_t i = 0; i < soup.size(); i += 3)
+			r->SubmitTriangle(soup[i], soup[i + 1], soup[i + 2], 3, &shader, SoftwareRasterizer::CullMode::None);
+		r->Resolve(r == &parallel ? &pool : nullptr);
+	}
+
+	bool same = true;
+	for(std::size_t i = 0; i < (std::size_t)serial.Pitch() * serial.Height(); ++i)
+		same = same && serial.Pixels()[i] == parallel.Pixels()[i];
+	CHECK(same);
+	CHECK_EQUAL(serial.GetStats().PixelsShaded, parallel.GetStats().PixelsShaded);
+
+	// The golden scenes too.
+	DrawPerspective(serial, nullptr);
+	DrawPerspective(parallel, &pool);
+	same = true;
+	for(std::size_t i = 0; i < (std::size_t)serial.Pitch() * serial.Height(); ++i)
+		same = same && serial.Pixels()[i] == parallel.Pixels()[i];
+	CHECK(same);
+}
+
+TEST(CullingClippingAndDepth)
+{
+	static const ColorShader shader;
+	SoftwareRasterizer r;
+	r.BeginFrame(64, 64, Black);
+
+	// Clockwise on screen faces the viewer; the same triangle reversed is culled only
+	// with CullMode::Back.
+	const ShadedVertex a = Vertex(-0.5f, 0.5f, 0.5f, 1.0f, 1, 0, 0);
+	const ShadedVertex b = Vertex(0.5f, 0.5f, 0.5f, 1.0f, 1, 0, 0);
+	const ShadedVertex c = Vertex(0.0f, -0.5f, 0.5f, 1.0f, 1, 0, 0);
+	r.SubmitTriangle(a, b, c, 3, &shader, SoftwareRasterizer::CullMode::Back);
+	r.SubmitTriangle(a, c, b, 3, &shader, SoftwareRasterizer::CullMode::Back);
+	CHECK_EQUAL(r.GetStats().TrianglesRasterized, 1u);
+	CHECK_EQUAL(r.GetStats().TrianglesCulled, 1u);
+
+	// Entirely behind the near plane, and degenerate.
+	r.SubmitTriangle(Vertex(-1, 1, -0.5f, 1, 0, 0, 0), Vertex(1, 1, -0.1f, 1, 0, 0, 0), Vertex(0, -1, -0.2f, 1, 0, 0, 0),
+		3, &shader, SoftwareRasterizer::CullMode::None);
+	r.SubmitTriangle(a, a, b, 3, &shader, SoftwareRasterizer::CullMode::None);
+	CHECK_EQUAL(r.GetStats().TrianglesCulled, 3u);
+
+	// One vertex behind the near plane leaves a quad, drawn as two triangles.
+	r.SubmitTriangle(Vertex(-0.8f, 0.8f, 0.5f, 1, 0, 0, 0), Vertex(0.8f, 0.8f, 0.5f, 1, 0, 0, 0),
+		Vertex(0.0f, -0.8f, -0.5f, 1, 0, 0, 0), 3, &shader, SoftwareRasterizer::CullMode::None);
+	CHECK_EQUAL(r.GetStats().TrianglesRasterized, 3u);
+	r.Resolve(nullptr);
+
+	// Depth is LESS: a triangle at the same depth submitted later does not replace the
+	// first, a nearer one does.
+	const ShadedVertex g0 = Vertex(-0.5f, 0.5f, 0.5f, 1.0f, 0, 1, 0);
+	const ShadedVertex g1 = Vertex(0.5f, 0.5f, 0.5f, 1.0f, 0, 1, 0);
+	const ShadedVertex g2 = Vertex(0.0f, -0.5f, 0.5f, 1.0f, 0, 1, 0);
+	const ShadedVertex n0 = Vertex(-0.5f, 0.5f, 0.25f, 1.0f, 0, 0, 1);
+	const ShadedVertex n1 = Vertex(0.5f, 0.5f, 0.25f, 1.0f, 0, 0, 1);
+	const ShadedVertex n2 = Vertex(0.0f, -0.5f, 0.25f, 1.0f, 0, 0, 1);
+	const std::size_t center = (std::size_t)32 * r.Pitch() + 32;
+
+	r.BeginFrame(64, 64, Black);
+	r.SubmitTriangle(a, b, c, 3, &shader, SoftwareRasterizer::CullMode::None);
+	r.SubmitTriangle(g0, g1, g2, 3, &shader, SoftwareRasterizer::CullMode::None);
+	r.Resolve(nullptr);
+	CHECK_EQUAL(r.Pixels()[center] & 0xffffff, 0x0000ffu);
+
+	r.BeginFrame(64, 64, Black);
+	r.SubmitTriangle(a, b, c, 3, &shader, SoftwareRasterizer::CullMode::None);
+	r.SubmitTriangle(n0, n1, n2, 3, &shader, SoftwareRasterizer::CullMode::None);
+	r.Resolve(nullptr);
+	CHECK_EQUAL(r.Pixels()[center] & 0xffffff, 0xff0000u);
+}
@@ -0,0 +1,207 @@
+//***************************************************************************************
+// StagingRingTests.cpp
+//
+// The staging ring driven by a fake fence: space comes back only when the fence that
+// covers it completes, wrapping keeps allocations contiguous, and the peak and
+// steady-state byte counts match a known frame pattern.  A fuzz run checks that no two
+// live allocations ever overlap.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "FrameFence.h"
+#include "Random.h"
+#include "StagingRing.h"
+#include <deque>
+#include <vector>
+
+namespace
+{
+	// A GPU timeline the test moves by hand: Signal queues a value, Complete marks
+	// everything up to a value as done.
+	class FakeFence : public FrameFence
+	{
+	public:
+		std::uint64_t Signal() { return ++mSignaled; }
+		void Complete(std::uint64_t value) { mCompleted = value < mSignaled ? value : mSignaled; }
+
+		std::uint64_t CompletedValue()const override { return mCompleted; }
+
+		double WaitForValue(std::uint64_t value)const override
+		{
+			if(mCompleted < value)
+				mCompleted = value;
+			return 0.0;
+		}
+
+	private:
+		std::uint64_t mSignaled = 0;
+		mutable std::uint64_t mCompleted = 0;
+	};
+
+	struct LiveAllocation
+	{
+		std::uint64_t Offset;
+		std::uint64_t Size;
+		std::uint64_t Fence;
+	};
+
+	bool Overlaps(const LiveAllocation& a, std::uint64_t offset, std::uint64_t size)
+	{
+		return offset < a.Offset + a.Size && a.Offset < offset + size;
+	}
+}
+
+TEST(HonoursAlignmentAndBounds)
+{
+	StagingRing ring(4096);
+	CHECK_EQUAL(ring.Allocate(3), 0u);
+	CHECK_EQUAL(ring.Allocate(16, 256), 256u);
+	CHECK_EQUAL(ring.Allocate(1, 512), 512u);
+	CHECK(ring.Allocate(0) == StagingRing::InvalidOffset);
+	CHECK(ring.Allocate(4097) == StagingRing::InvalidOffset);
+
+	// Padding counts as used.
+	CHECK_EQUAL(ring.GetStats().UsedBytes, 513u);
+	CHECK_EQUAL(ring.GetStats().TotalAllocatedBytes, 20u);
+}
+
+TEST(SpaceReturnsOnlyWhenItsFenceCompletes)
+{
+	FakeFence fence;
+	StagingRing ring(1024);
+
+	CHECK_EQUAL(ring.Allocate(512), 0u);
+	ring.Submit(fence.Signal());
+	CHECK_EQUAL(ring.Allocate(512), 512u);
+	ring.Submit(fence.Signal());
+	CHECK(ring.Allocate(1) == StagingRing::InvalidOffset);
+
+	ring.Retire(fence.CompletedValue());
+	CHECK(ring.Allocate(1) == StagingRing::InvalidOffset);
+	CHECK_EQUAL(ring.GetStats().SpansInFlight, 2u);
+
+	fence.Complete(1);
+	ring.Retire(fence.CompletedValue());
+	CHECK_EQUAL(ring.GetStats().SpansInFlight, 1u);
+	CHECK_EQUAL(ring.GetStats().LastRetiredFence, 1u);
+	CHECK_EQUAL(ring.Allocate(512), 0u);
+
+	// Unsubmitted bytes are never retired, whatever the fence says.
+	fence.Complete(2);
+	ring.Retire(100);
+	CHECK(ring.HasPending());
+	CHECK_EQUAL(ring.GetStats().UsedBytes, 512u);
+	CHECK(ring.Allocate(1024) == StagingRing::InvalidOffset);
+}
+
+TEST(WrapSkipsTheTailAndReturnsItOnRetire)
+{
+	FakeFence fence;
+	StagingRing ring(1000);
+
+	ring.Allocate(400);
+	ring.Submit(fence.Signal());
+	ring.Allocate(400);
+	ring.Submit(fence.Signal());
+	fence.Complete(1);
+	ring.Retire(fence.CompletedValue());
+
+	// 200 bytes left at the end, too few, so the allocation wraps to the front and the
+	// skipped tail is charged to it.
+	CHECK_EQUAL(ring.Allocate(300), 0u);
+	CHECK_EQUAL(ring.GetStats().UsedBytes, 400u + 200u + 300u);
+	CHECK(ring.Allocate(200) == StagingRing::InvalidOffset);
+	CHECK_EQUAL(ring.Allocate(100), 300u);
+	ring.Submit(fence.Signal());
+
+	fence.Complete(3);
+	ring.Retire(fence.CompletedValue());
+	CHECK_EQUAL(ring.GetStats().UsedBytes, 0u);
+	CHECK_EQUAL(ring.Allocate(1000), 0u);
+}
+
+// Every frame uploads 100 bytes and the GPU runs two frames behind, so three frames of
+// data are live at the peak and the ring settles there.
+TEST(PeakAndSteadyStateFollowTheFenceLag)
+{
+	FakeFence fence;
+	StagingRing ring(1 << 16);
+
+	for(int frame = 0; frame < 50; ++frame)
+	{
+		REQUIRE(ring.Allocate(100) != StagingRing::InvalidOffset);
+		const std::uint64_t value = fence.Signal();
+		ring.Submit(value);
+		if(value > 2)
+			fence.Complete(value - 2);
+		ring.Retire(fence.CompletedValue());
+	}
+
+	const StagingRing::Stats stats = ring.GetStats();
+	CHECK_EQUAL(stats.PeakUsedBytes, 300u);
+	CHECK_EQUAL(stats.UsedBytes, 200u);
+	CHECK_EQUAL(stats.SpansInFlight, 2u);
+	CHECK_EQUAL(stats.TotalAllocatedBytes, 5000u);
+
+	fence.WaitForValue(50);
+	ring.Retire(fence.CompletedValue());
+	CHECK_EQUAL(ring.GetStats().UsedBytes, 0u);
+	CHECK_EQUAL(ring.GetStats().PeakUsedBytes, 300u);
+}
+
+TEST(FuzzAgainstFakeFence)
+{
+	const std::uint64_t capacity = 1 << 16;
+	FakeFence fence;
+	StagingRing ring(capacity);
+	std::vector<LiveAllocation> pending;
+	std::deque<LiveAllocation> inFlight;
+
+	Pcg32 rng(77);
+	for(int op = 0; op < 200000; ++op)
+	{
+		const std::uint32_t choice = rng.NextBounded(10);
+		if(choice < 6)
+		{
+			const std::uint64_t size = 1 + rng.NextBounded(9000);
+			const std::uint64_t alignment = 1ull << rng.NextBounded(9);
+			const std::uint64_t offset = ring.Allocate(size, alignment);
+			if(offset == StagingRing::InvalidOffset)
+				continue;
+
+			REQUIRE(offset % alignment == 0);
+			REQUIRE(offset + size <= capacity);
+			for(const LiveAllocation& a : pending)
+				REQUIRE(!Overlaps(a, offset, size));
+			for(const LiveAllocation& a : inFlight)
+				REQUIRE(!Overlaps(a, offset, size));
+			pending.push_back({ offset, size, 0 });
+		}
+		else if(choice < 8)
+		{
+			const std::uint64_t value = fence.Signal();
+			ring.Submit(value);
+			for(LiveAllocation& a : pending)
+			{
+				a.Fence = value;
+				inFlight.push_back(a);
+			}
+			pending.clear();
+		}
+		else
+		{
+			fence.Complete(fence.CompletedValue() + 1 + rng.NextBounded(3));
+			ring.Retire(fence.CompletedValue());
+			while(!inFlight.empty() && inFlight.front().Fence <= fence.CompletedValue())
+				inFlight.pop_front();
+		}
+
+		REQUIRE(ring.GetStats().UsedBytes <= capacity);
+	}
+
+	ring.Submit(fence.Signal());
+	fence.WaitForValue(fence.Signal());
+	ring.Retire(fence.CompletedValue());
+	CHECK_EQUAL(ring.GetStats().UsedBytes, 0u);
+	CHECK_EQUAL(ring.GetStats().SpansInFlight, 0u);
+}
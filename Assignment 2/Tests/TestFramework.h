@@ -0,0 +1,60 @@
+//***************************************************************************************
+// TestFramework.h
+//
+// Minimal unit test registry for the Linux test targets.  TEST(Name) defines a case and
+// registers it; CHECK and friends record a failure and carry on, REQUIRE ends the case.
+// TestMain.cpp runs every case, or only those whose name contains argv[1].
+//***************************************************************************************
+
+#pragma once
+
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace Test
+{
+	struct Case
+	{
+		const char* Name;
+		void (*Body)();
+	};
+
+	std::vector<Case>& Cases();
+	void Fail(const char* file, int line, const std::string& message);
+
+	// Thrown by REQUIRE to leave the current case.
+	struct Abort {};
+
+	struct Registrar
+	{
+		Registrar(const char* name, void (*body)()) { Cases().push_back({ name, body }); }
+	};
+
+	template<typename A, typename B>
+	std::string Describe(const char* expression, const A& a, const B& b)
+	{
+		std::ostringstream oss;
+		oss << expression << " (" << a << " vs " << b << ")";
+		return oss.str();
+	}
+}
+
+#define TEST(name) \
+	static void name(); \
+	static Test::Registrar name##Registrar(#name, &name); \
+	static void name()
+
+#define CHECK(cond) \
+	do { if(!(cond)) Test::Fail(__FILE__, __LINE__, #cond); } while(false)
+
+#define CHECK_EQUAL(a, b) \
+	do { if(!((a) == (b))) Test::Fail(__FILE__, __LINE__, Test::Describe(#a " == " #b, (a), (b))); } while(false)
+
+#define CHECK_NEAR(a, b, tolerance) \
+	do { if(!(std::fabs((double)(a) - (double)(b)) <= (double)(tolerance))) \
+		Test::Fail(__FILE__, __LINE__, Test::Describe(#a " ~= " #b, (a), (b))); } while(false)
+
+#define REQUIRE(cond) \
+	do { if(!(cond)) { Test::Fail(__FILE__, __LINE__, #cond); throw Test::Abort(); } } while(false)
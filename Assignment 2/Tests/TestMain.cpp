@@ -0,0 +1,59 @@
+//***************************************************************************************
+// TestMain.cpp
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+namespace
+{
+	int gFailures = 0;
+}
+
+std::vector<Test::Case>& Test::Cases()
+{
+	static std::vector<Case> cases;
+	return cases;
+}
+
+void Test::Fail(const char* file, int line, const std::string& message)
+{
+	std::printf("  %s:%d: %s\n", file, line, message.c_str());
+	gFailures++;
+}
+
+int main(int argc, char** argv)
+{
+	const char* filter = argc > 1 ? argv[1] : "";
+
+	int failedCases = 0;
+	int ran = 0;
+	for(const Test::Case& c : Test::Cases())
+	{
+		if(std::strstr(c.Name, filter) == nullptr)
+			continue;
+
+		const int failuresBefore = gFailures;
+		try
+		{
+			c.Body();
+		}
+		catch(const Test::Abort&)
+		{
+		}
+		catch(const std::exception& e)
+		{
+			Test::Fail(__FILE__, __LINE__, std::string("unexpected exception: ") + e.what());
+		}
+
+		const bool passed = gFailures == failuresBefore;
+		std::printf("[%s] %s\n", passed ? " OK " : "FAIL", c.Name);
+		failedCases += passed ? 0 : 1;
+		ran++;
+	}
+
+	std::printf("%d of %d cases passed\n", ran - failedCases, ran);
+	return failedCases == 0 ? 0 : 1;
+}
@@ -0,0 +1,91 @@
+//***************************************************************************************
+// CommonBenchmarks.cpp
+//
+// Runs the Common benchmark suite (RunCommonBenchmarks) without the demo or a device,
+// so results from two builds or two machines can be compared from the command line.
+// The D3D-only cases stay in the demo's A2_BENCH_JSON mode.
+//
+//   CommonBenchmarks [filter] [--json file] [--batch-ms ms] [--samples n]
+//
+// filter keeps the cases whose name contains it, e.g. "MathHelper::" or "Cull".
+// --batch-ms and --samples trade accuracy for run time; the defaults are the runner's.
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "CommonBenchmarks.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace
+{
+	struct Options
+	{
+		std::string Filter;
+		std::string JsonPath;
+		double BatchMs = 5.0;
+		std::uint32_t Samples = 7;
+	};
+
+	bool ParseOptions(int argc, char** argv, Options& options)
+	{
+		bool haveFilter = false;
+		for(int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			const bool hasValue = i + 1 < argc;
+
+			if(arg == "--json" && hasValue)
+				options.JsonPath = argv[++i];
+			else if(arg == "--batch-ms" && hasValue)
+				options.BatchMs = std::strtod(argv[++i], nullptr);
+			else if(arg == "--samples" && hasValue)
+				options.Samples = (std::uint32_t)std::strtoul(argv[++i], nullptr, 10);
+			else if(!haveFilter && !arg.empty() && arg[0] != '-')
+			{
+				options.Filter = arg;
+				haveFilter = true;
+			}
+			else
+			{
+				std::fprintf(stderr, "Unknown or incomplete option '%s'.\n", arg.c_str());
+				return false;
+			}
+		}
+
+		if(options.BatchMs <= 0.0 || options.Samples == 0)
+		{
+			std::fprintf(stderr, "--batch-ms and --samples must be positive.\n");
+			return false;
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if(!ParseOptions(argc, argv, options))
+	{
+		std::fprintf(stderr, "usage: CommonBenchmarks [filter] [--json file] [--batch-ms ms] [--samples n]\n");
+		return 2;
+	}
+
+	BenchmarkRunner runner(options.BatchMs, options.Samples);
+	runner.SetFilter(options.Filter);
+	RunCommonBenchmarks(runner);
+
+	if(runner.Results().empty())
+	{
+		std::fprintf(stderr, "No benchmark matches '%s'.\n", options.Filter.c_str());
+		return 1;
+	}
+
+	std::printf("%s", runner.Report().c_str());
+	if(!options.JsonPath.empty() && !runner.ExportJson(options.JsonPath))
+	{
+		std::fprintf(stderr, "Could not write %s.\n", options.JsonPath.c_str());
+		return 1;
+	}
+	return 0;
+}
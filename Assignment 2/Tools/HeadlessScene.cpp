@@ -0,0 +1,460 @@
+//***************************************************************************************
+// HeadlessScene.cpp
+//
+// The demo's per-frame CPU path over a generated stress scene, with no device: object
+// constants, culling against the camera, sorting, the scene draw list, and recording
+// of the list into CommandStreams on a TaskPool, which NullCommandBackend validates
+// and counts.  Streams are recorded the way ShapesApp::RecordSceneRange and
+// DrawRenderItem record them.  GPU addresses are made up but fixed, so a recording
+// depends only on the options, and the --dump output of two builds can be diffed.
+//
+//   HeadlessScene [--items N] [--layout maze|forest|instanced|mixed] [--seed S]
+//                 [--frames F] [--ranges R] [--threads T] [--dump file]
+//                 [--check] [--benchmark [filter]] [--json file]
+//
+// --check records every frame twice, with one thread and with T, and fails if the
+// streams differ or any draw is invalid.  --benchmark times each stage of a frame.
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "CommandStream.h"
+#include "DrawTables.h"
+#include "GeometryGenerator.h"
+#include "MathHelper.h"
+#include "NullCommandBackend.h"
+#include "ParallelRecorder.h"
+#include "StressScene.h"
+#include "TaskPool.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// D3D12 enum values the demo records, spelled out so this builds without D3D.
+	const std::uint32_t TopologyTriangleList = 4;  // D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST
+	const std::uint32_t FormatR16Uint = 57;        // DXGI_FORMAT_R16_UINT
+	const std::uint32_t VertexStride = 32;         // the demo's Vertex: position, normal, uv
+
+	// Same split threshold as the demo.
+	const std::uint32_t MinDrawsPerRecordRange = 256;
+
+	// Stand-ins for the ids and GPU addresses the device would hand out.
+	const std::uint32_t RootSignatureId = 1;
+	const std::uint32_t OpaquePipelineId = 1;
+	const std::uint64_t SrvHeapStart = 0x00001000ull;
+	const std::uint64_t PassCbAddress = 0x10000000ull;
+	const std::uint64_t MaterialBufferAddress = 0x20000000ull;
+	const std::uint64_t ObjectBufferAddress = 0x30000000ull;
+	const std::uint64_t VertexBufferAddress = 0x40000000ull;
+	const std::uint64_t IndexBufferAddress = 0x50000000ull;
+
+	struct Options
+	{
+		std::uint32_t Items = 100000;
+		StressLayout Layout = StressLayout::Mixed;
+		std::uint64_t Seed = 1;
+		std::uint32_t Frames = 4;
+		std::uint32_t Ranges = 4;
+		std::uint32_t Threads = 0;
+		std::string DumpPath;
+		bool Check = false;
+		bool Benchmark = false;
+		std::string BenchmarkFilter;
+		std::string JsonPath;
+	};
+
+	struct Submesh
+	{
+		std::uint32_t IndexCount = 0;
+		std::uint32_t StartIndex = 0;
+		std::int32_t BaseVertex = 0;
+	};
+
+	// The stress scene's meshes packed into one vertex and one index buffer, as the
+	// demo's shapeGeo holds them.
+	struct SceneGeometry
+	{
+		std::vector<Submesh> Submeshes;
+		std::uint32_t VertexBytes = 0;
+		std::uint32_t IndexBytes = 0;
+	};
+
+	struct SceneDraw
+	{
+		std::uint32_t Item = 0;
+		std::uint32_t Pipeline = 0;
+	};
+
+	// One frame's worth of CPU state, reused from frame to frame.
+	struct FrameState
+	{
+		std::vector<XMFLOAT4X4> ObjectConstants;
+		std::vector<std::uint32_t> Visible;
+		std::uint32_t VisibleCount = 0;
+		std::vector<SceneDraw> Draws;
+		std::vector<std::uint32_t> DrawCosts;
+		std::vector<ParallelRecorder::Range> Ranges;
+	};
+
+	bool ParseOptions(int argc, char** argv, Options& options)
+	{
+		for(int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			const bool hasValue = i + 1 < argc;
+
+			if(arg == "--items" && hasValue)
+				options.Items = (std::uint32_t)std::strtoul(argv[++i], nullptr, 10);
+			else if(arg == "--layout" && hasValue)
+			{
+				if(!ParseStressLayout(argv[++i], options.Layout))
+				{
+					std::fprintf(stderr, "Unknown layout '%s'.\n", argv[i]);
+					return false;
+				}
+			}
+			else if(arg == "--seed" && hasValue)
+				options.Seed = std::strtoull(argv[++i], nullptr, 10);
+			else if(arg == "--frames" && hasValue)
+				options.Frames = (std::uint32_t)std::strtoul(argv[++i], nullptr, 10);
+			else if(arg == "--ranges" && hasValue)
+				options.Ranges = std::max(1u, (std::uint32_t)std::strtoul(argv[++i], nullptr, 10));
+			else if(arg == "--threads" && hasValue)
+				options.Threads = (std::uint32_t)std::strtoul(argv[++i], nullptr, 10);
+			else if(arg == "--dump" && hasValue)
+				options.DumpPath = argv[++i];
+			else if(arg == "--json" && hasValue)
+				options.JsonPath = argv[++i];
+			else if(arg == "--check")
+				options.Check = true;
+			else if(arg == "--benchmark")
+			{
+				options.Benchmark = true;
+				if(hasValue && argv[i + 1][0] != '-')
+					options.BenchmarkFilter = argv[++i];
+			}
+			else
+			{
+				std::fprintf(stderr, "Unknown or incomplete option '%s'.\n", arg.c_str());
+				return false;
+			}
+		}
+
+		if(options.Items == 0 || options.Items > MaxDrawObjectIndex + 1)
+		{
+			std::fprintf(stderr, "--items must be between 1 and %u.\n", MaxDrawObjectIndex + 1);
+			return false;
+		}
+
+		return true;
+	}
+
+	void BuildSceneGeometry(StressSceneDesc& desc, SceneGeometry& geometry)
+	{
+		// The maze layout builds its walls from mesh 0, so the box goes first.
+		GeometryGenerator geoGen;
+		const GeometryGenerator::MeshData meshes[] =
+		{
+			geoGen.CreateBox(1.0f, 1.0f, 1.0f, 0),
+			geoGen.CreateCylinder(0.5f, 0.5f, 3.0f, 20, 20),
+			geoGen.CreateSphere(0.5f, 20, 20),
+			geoGen.CreateGeosphere(0.5f, 2),
+		};
+
+		std::uint32_t vertexCount = 0;
+		std::uint32_t indexCount = 0;
+		for(const GeometryGenerator::MeshData& mesh : meshes)
+		{
+			BoundingBox bounds;
+			BoundingBox::CreateFromPoints(bounds, mesh.Vertices.size(), &mesh.Vertices[0].Position, sizeof(GeometryGenerator::Vertex));
+			desc.MeshBounds.push_back(bounds);
+
+			Submesh submesh;
+			submesh.IndexCount = (std::uint32_t)mesh.Indices32.size();
+			submesh.StartIndex = indexCount;
+			submesh.BaseVertex = (std::int32_t)vertexCount;
+			geometry.Submeshes.push_back(submesh);
+
+			vertexCount += (std::uint32_t)mesh.Vertices.size();
+			indexCount += (std::uint32_t)mesh.Indices32.size();
+		}
+
+		geometry.VertexBytes = vertexCount * VertexStride;
+		geometry.IndexBytes = indexCount * (std::uint32_t)sizeof(std::uint16_t);
+	}
+
+	// The camera stands at the edge of the world and turns a little every frame.
+	BoundingFrustum FrameFrustum(const StressSceneDesc& desc, std::uint32_t frame)
+	{
+		BoundingFrustum frustum;
+		BoundingFrustum::CreateFromMatrix(frustum, XMMatrixPerspectiveFovLH(0.25f * MathHelper::Pi, 1.5f, 1.0f, 1000.0f));
+		frustum.Origin = XMFLOAT3(0.0f, 10.0f, -0.5f * desc.WorldSize);
+		XMStoreFloat4(&frustum.Orientation, XMQuaternionRotationRollPitchYaw(0.0f, 0.05f * (float)frame - 0.1f, 0.0f));
+		return frustum;
+	}
+
+	void UpdateConstants(const StressScene& scene, FrameState& state)
+	{
+		// Stress items never move, so after the first frames the demo uploads none of
+		// them; this is the worst case, where every item is dirty.
+		StressSceneUpdateConstants(scene, state.ObjectConstants.data());
+	}
+
+	void CullAndSort(const StressScene& scene, const BoundingFrustum& frustum, FrameState& state)
+	{
+		state.VisibleCount = StressSceneCull(scene, frustum, state.Visible.data());
+		StressSceneSort(scene, state.Visible.data(), state.VisibleCount);
+	}
+
+	// As ShapesApp::BuildSceneDrawList, for the opaque layer the stress items live in.
+	void BuildSceneDrawList(FrameState& state)
+	{
+		state.Draws.clear();
+		state.DrawCosts.clear();
+
+		std::uint32_t prevPipeline = ~0u;
+		for(std::uint32_t i = 0; i < state.VisibleCount; ++i)
+		{
+			SceneDraw draw;
+			draw.Item = state.Visible[i];
+			draw.Pipeline = OpaquePipelineId;
+			state.Draws.push_back(draw);
+
+			// Every item shares one geometry, so only the first draw binds buffers.
+			std::uint32_t cost = 2;
+			if(i == 0)
+				cost += 2;
+			if(draw.Pipeline != prevPipeline)
+				cost += 1;
+			state.DrawCosts.push_back(cost);
+
+			prevPipeline = draw.Pipeline;
+		}
+	}
+
+	// As ShapesApp::RecordSceneRange and DrawRenderItem with bindless textures.
+	void RecordSceneRange(const StressScene& scene, const SceneGeometry& geometry, const FrameState& state,
+		CommandStream& stream, std::uint32_t begin, std::uint32_t end)
+	{
+		stream.Reset();
+
+		stream.SetRootSignature(RootSignatureId);
+		stream.SetRootTable(0, SrvHeapStart);
+		stream.SetRootCbv(2, PassCbAddress);
+		stream.SetRootSrv(3, MaterialBufferAddress);
+		stream.SetRootSrv(4, ObjectBufferAddress);
+
+		for(std::uint32_t i = begin; i < end; ++i)
+		{
+			const std::uint32_t item = state.Draws[i].Item;
+			const Submesh& submesh = geometry.Submeshes[scene.Meshes[item]];
+
+			stream.SetPipeline(state.Draws[i].Pipeline);
+			stream.SetVertexBuffer(VertexBufferAddress, geometry.VertexBytes, VertexStride);
+			stream.SetIndexBuffer(IndexBufferAddress, geometry.IndexBytes, FormatR16Uint);
+			stream.SetPrimitiveTopology(TopologyTriangleList);
+			stream.SetRootConstant(1, PackDrawIndices(item, scene.Materials[item]));
+			stream.DrawIndexed(submesh.IndexCount, 1, submesh.StartIndex, submesh.BaseVertex, 0);
+		}
+	}
+
+	void RecordFrame(const StressScene& scene, const SceneGeometry& geometry, std::uint32_t rangeCount,
+		ParallelRecorder& recorder, FrameState& state)
+	{
+		ParallelRecorder::Partition(state.DrawCosts, rangeCount, MinDrawsPerRecordRange, state.Ranges);
+		recorder.Record(state.Ranges, [&](CommandStream& stream, std::uint32_t begin, std::uint32_t end)
+		{
+			RecordSceneRange(scene, geometry, state, stream, begin, end);
+		});
+	}
+
+	// Validates and counts every stream of the frame; false if any draw is invalid.
+	bool ValidateFrame(const ParallelRecorder& recorder, NullCommandBackend& backend)
+	{
+		bool valid = true;
+		for(std::uint32_t i = 0; i < recorder.StreamCount(); ++i)
+			valid = backend.Execute(recorder.GetStream(i)) && valid;
+		return valid;
+	}
+
+	std::uint64_t FrameHash(const ParallelRecorder& recorder)
+	{
+		// FNV-1a over the stream hashes in range order.
+		std::uint64_t hash = 14695981039346656037ull;
+		for(std::uint32_t i = 0; i < recorder.StreamCount(); ++i)
+		{
+			hash ^= recorder.GetStream(i).Hash();
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	std::string HexString(std::uint64_t value)
+	{
+		std::ostringstream out;
+		out << std::hex << value;
+		return out.str();
+	}
+
+	void RunBenchmarks(const Options& options, const StressScene& scene, const StressSceneDesc& desc,
+		const SceneGeometry& geometry, TaskPool& pool)
+	{
+		BenchmarkRunner runner;
+		runner.SetFilter(options.BenchmarkFilter);
+
+		ParallelRecorder recorder(pool);
+		FrameState state;
+		state.ObjectConstants.resize(scene.ItemCount());
+		state.Visible.resize(scene.ItemCount());
+
+		const BoundingFrustum frustum = FrameFrustum(desc, 0);
+		const std::uint64_t items = scene.ItemCount();
+
+		runner.Run("HeadlessScene::UpdateConstants", items, [&]()
+		{
+			UpdateConstants(scene, state);
+		});
+		runner.Run("HeadlessScene::CullAndSort", items, [&]()
+		{
+			CullAndSort(scene, frustum, state);
+		});
+		CullAndSort(scene, frustum, state);
+		runner.Run("HeadlessScene::BuildDrawList", state.VisibleCount, [&]()
+		{
+			BuildSceneDrawList(state);
+		});
+		BuildSceneDrawList(state);
+		runner.Run("HeadlessScene::Record", state.VisibleCount, [&]()
+		{
+			RecordFrame(scene, geometry, options.Ranges, recorder, state);
+		});
+
+		// Update and the draw-list build together, as one frame of the demo.
+		NullCommandBackend backend;
+		runner.Run("HeadlessScene::Frame", items, [&]()
+		{
+			UpdateConstants(scene, state);
+			CullAndSort(scene, frustum, state);
+			BuildSceneDrawList(state);
+			RecordFrame(scene, geometry, options.Ranges, recorder, state);
+			ValidateFrame(recorder, backend);
+		});
+
+		std::printf("%s", runner.Report().c_str());
+		if(!options.JsonPath.empty() && !runner.ExportJson(options.JsonPath))
+			std::fprintf(stderr, "Could not write %s.\n", options.JsonPath.c_str());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if(!ParseOptions(argc, argv, options))
+		return 2;
+
+	const std::uint32_t threads = options.Threads > 0 ? options.Threads :
+		std::max(1u, std::thread::hardware_concurrency());
+	TaskPool pool(threads - 1);
+
+	StressSceneDesc desc;
+	desc.ItemCount = options.Items;
+	desc.Layout = options.Layout;
+	desc.MaterialCount = 16;
+	desc.Seed = options.Seed;
+
+	SceneGeometry geometry;
+	BuildSceneGeometry(desc, geometry);
+
+	StressScene scene;
+	GenerateStressScene(desc, scene);
+
+	if(options.Benchmark)
+	{
+		RunBenchmarks(options, scene, desc, geometry, pool);
+		return 0;
+	}
+
+	std::ofstream dump;
+	if(!options.DumpPath.empty())
+	{
+		dump.open(options.DumpPath);
+		if(!dump)
+		{
+			std::fprintf(stderr, "Could not write %s.\n", options.DumpPath.c_str());
+			return 2;
+		}
+		dump << "# HeadlessScene items " << options.Items << " seed " << options.Seed
+			<< " ranges " << options.Ranges << "\n";
+	}
+
+	// With --check, a single-threaded recorder replays every frame for comparison.
+	TaskPool serialPool(0);
+	ParallelRecorder recorder(pool);
+	ParallelRecorder serialRecorder(serialPool);
+
+	FrameState state;
+	state.ObjectConstants.resize(scene.ItemCount());
+	state.Visible.resize(scene.ItemCount());
+
+	bool ok = true;
+	NullCommandBackend backend;
+	for(std::uint32_t frame = 0; frame < options.Frames; ++frame)
+	{
+		UpdateConstants(scene, state);
+		CullAndSort(scene, FrameFrustum(desc, frame), state);
+		BuildSceneDrawList(state);
+		RecordFrame(scene, geometry, options.Ranges, recorder, state);
+
+		backend.ResetStats();
+		const bool valid = ValidateFrame(recorder, backend);
+		const std::uint64_t hash = FrameHash(recorder);
+
+		std::printf("frame %u: %u of %u items visible, %u streams, hash %s\n", frame, state.VisibleCount,
+			scene.ItemCount(), recorder.StreamCount(), HexString(hash).c_str());
+		std::printf("  %s\n", backend.StatsString().c_str());
+
+		if(!valid)
+		{
+			std::printf("  invalid stream: %s\n", backend.FirstError().c_str());
+			ok = false;
+		}
+		if(backend.GetStats().Draws != state.VisibleCount)
+		{
+			std::printf("  %u draws recorded for %u visible items\n", backend.GetStats().Draws, state.VisibleCount);
+			ok = false;
+		}
+
+		if(options.Check)
+		{
+			RecordFrame(scene, geometry, options.Ranges, serialRecorder, state);
+			if(FrameHash(serialRecorder) != hash)
+			{
+				std::printf("  recording on one thread gave hash %s\n", HexString(FrameHash(serialRecorder)).c_str());
+				ok = false;
+			}
+		}
+
+		if(dump.is_open())
+		{
+			dump << "frame " << frame << " hash " << HexString(hash) << "\n";
+			for(std::uint32_t i = 0; i < recorder.StreamCount(); ++i)
+			{
+				dump << "stream " << i << " draws " << state.Ranges[i].Begin << "-" << state.Ranges[i].End << "\n";
+				dump << recorder.GetStream(i).Dump();
+			}
+		}
+	}
+
+	return ok ? 0 : 1;
+}
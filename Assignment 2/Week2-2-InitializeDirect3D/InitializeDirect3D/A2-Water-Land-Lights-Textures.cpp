@@ -18,7 +18,30 @@
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
+#include "../../Common/GpuBufferPool.h"
+#include "../../Common/StagingManager.h"
+#include "../../Common/DescriptorHeap.h"
+#include "../../Common/RenderGraphD3D12.h"
+#include "../../Common/CommandStreamD3D12.h"
+#include "../../Common/NullCommandBackend.h"
+#include "../../Common/ParallelRecorder.h"
+#include "../../Common/FramePipeline.h"
+#include "../../Common/TaskGraph.h"
+#include "../../Common/ShaderCacheD3D12.h"
+#include "../../Common/Profiler.h"
+#include "../../Common/FrameMetrics.h"
+#include "../../Common/FrameFenceD3D12.h"
+#include "../../Common/MetricsServer.h"
+#include "../../Common/MemoryTracker.h"
+#include "../../Common/LinearArena.h"
+#include "../../Common/CommonBenchmarks.h"
+#include "../../Common/StressScene.h"
+#include "../../Common/QualityGovernor.h"
+#include "../../Common/FileWatcher.h"
+#include "../../Common/AssetDependencies.h"
+#include "../../Common/ClothSystem.h"
 #include "FrameResource.h"
+#include "SoftwareShading.h"
 #include "Waves.h"
 
 using Microsoft::WRL::ComPtr;
@@ -30,6 +53,21 @@ using namespace DirectX::PackedVector;
 
 const int gNumFrameResources = 3;
 
+// Scene draw lists shorter than this per thread are recorded serially.
+const std::uint32_t gMinDrawsPerRecordRange = 256;
+
+// CBV/SRV/UAV heap layout: long-lived texture SRVs, then a scratch region per frame resource.
+const UINT gMaxTextureSrvs = 256;
+const UINT gTransientSrvsPerFrame = 64;
+
+// Flags hang from the top of poles this tall.
+const float gFlagPoleHeight = 9.0f;
+
+// The cloth solver writes its vertices straight into the cloth vertex buffers.
+static_assert(sizeof(ClothSystem::Vertex) == sizeof(Vertex) &&
+	offsetof(ClothSystem::Vertex, Normal) == offsetof(Vertex, Normal) &&
+	offsetof(ClothSystem::Vertex, TexC) == offsetof(Vertex, TexC), "ClothSystem::Vertex no longer matches Vertex.");
+
 // Lightweight structure stores parameters to draw a shape.  This will
 // vary from app-to-app.
 struct RenderItem
@@ -49,7 +87,8 @@ struct RenderItem
 	// NumFramesDirty = gNumFrameResources so that each frame resource gets the update.
 	int NumFramesDirty = gNumFrameResources;
 
-	// Index into GPU constant buffer corresponding to the ObjectCB for this render item.
+	// Index into the ObjectBuffer of each FrameResource for this render item.  At most
+	// MaxDrawObjectIndex; BuildRenderItems checks every item.
 	UINT ObjCBIndex = -1;
 
 	MeshGeometry* Geo = nullptr;
@@ -64,6 +103,11 @@ struct RenderItem
 	int BaseVertexLocation = 0;
 
 	BoundingBox Bounds;
+
+	// World-space sphere for the draw-distance cull.  Items with a zero radius are
+	// always drawn.
+	BoundingSphere CullSphere = BoundingSphere(XMFLOAT3(0.0f, 0.0f, 0.0f), 0.0f);
+
 	//step1: An invisible render-item will not be drawn.
 	bool Visible = true;
 };
@@ -75,10 +119,28 @@ enum class RenderLayer : int
 	Transparent,
 	AlphaTested,
 	AlphaTestedTreeSprites,
+	Cloth,
 	Highlight,
 	Count
 };
 
+// Everything the render stage needs from one simulated frame.  Written only by the
+// simulation stage and read only by the render stage once handed over.
+struct FramePacket
+{
+	PassConstants Pass;
+
+	// Only the objects and materials whose data changed.  A change rides along in
+	// gNumFrameResources consecutive packets so every frame resource receives it.
+	std::vector<std::pair<UINT, ObjectData>> ObjectUpdates;
+	std::vector<std::pair<UINT, MaterialData>> MaterialUpdates;
+
+	std::vector<Vertex> WaveVertices;
+
+	// When the oldest input this frame reflects arrived (GameTimer::SteadyClockNow), or 0.
+	std::int64_t InputTime = 0;
+};
+
 class ShapesApp : public D3DApp
 {
 public:
@@ -88,6 +150,7 @@ public:
 	~ShapesApp();
 
 	virtual bool Initialize()override;
+	virtual LRESULT MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)override;
 
 private:
 
@@ -99,13 +162,16 @@ private:
 	virtual void OnMouseUp(WPARAM btnState, int x, int y)override;
 	virtual void OnMouseMove(WPARAM btnState, int x, int y)override;
 
-	void OnKeyboardInput(const GameTimer& gt);
+	bool OnKeyboardInput(const GameTimer& gt);
 	void UpdateCamera(const GameTimer& gt);
 	void AnimateMaterials(const GameTimer& gt);
-	void UpdateObjectCBs(const GameTimer& gt);
-	void UpdateMaterialCBs(const GameTimer& gt);
-	void UpdateMainPassCB(const GameTimer& gt);
-	void UpdateWaves(const GameTimer& gt);
+	void UpdateObjectBuffer(FramePacket& packet);
+	void UpdateMaterialBuffer(FramePacket& packet);
+	void UpdateMainPassCB(const GameTimer& gt, FramePacket& packet);
+	void UpdateWaves(const GameTimer& gt, FramePacket& packet);
+	void Simulate(const GameTimer& gt, FramePacket& packet);
+	std::int64_t ApplySimInput();
+	void UploadFramePacket(const FramePacket& packet);
 
 	// Texture Step1
 	void LoadTextures();
@@ -121,12 +187,42 @@ private:
 	// Tree Step1
 	void BuildTreeSpritesGeometry();
 	void BuildWavesGeometry();
+	void BuildCloth();
+	void BuildClothGeometry();
+	void UpdateCloth(const GameTimer& gt);
 	void BuildPSOs();
 	void BuildFrameResources();
 	void BuildMaterials();
 	void BuildRenderItems();
+	void BuildStressItems();
+	void BuildRenderGraph();
+	void BuildStartupTasks(TaskGraph& graph);
 	void CreateItem(const char* item, XMMATRIX p, XMMATRIX q, XMMATRIX r, UINT ObjIndex, const char* material);
-	void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
+	void BuildRecordCommandLists();
+	void BuildSceneDrawList();
+	void DrawRenderItem(CommandStream& stream, const RenderItem* ri);
+	void BuildMetrics();
+	void PublishMetrics();
+	void AccountGpuMemory();
+	void BuildAllocationCheck();
+	void EndAllocationCheckFrame();
+	void BuildQualityGovernor();
+	void BuildFramePacing();
+	void BuildHotReload();
+	void ReloadChangedAssets();
+	bool ReloadTexture(const std::string& name);
+	void CheckMaterialTexture(const Material& mat)const;
+	bool ReloadPSO(const std::string& name);
+	void ResolveScenePipelines();
+	void AddPSO(const std::string& name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+		const char* vs, const char* gs, const char* ps);
+	ComPtr<ID3D12PipelineState> CreatePSO(PsoBuild& build);
+	void UpdateQualityGovernor();
+	void ApplyQualityLevels();
+	void DrawScenePass(ID3D12GraphicsCommandList* cmdList);
+	void SetSceneTargets(ID3D12GraphicsCommandList* cmdList);
+	void RecordSceneRange(CommandStream& stream, std::uint32_t begin, std::uint32_t end);
+	void RenderSoftwareFrame();
 
 	// Texture Step2-2
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> GetStaticSamplers();
@@ -144,17 +240,161 @@ private:
 	FrameResource* mCurrFrameResource = nullptr;
 	int mCurrFrameResourceIndex = 0;
 
-	UINT mCbvSrvDescriptorSize = 0;
-
 	ComPtr<ID3D12RootSignature> mRootSignature = nullptr;
 
-	ComPtr<ID3D12DescriptorHeap> mSrvDescriptorHeap = nullptr;
+	std::unique_ptr<DescriptorHeap> mSrvHeap;
+
+	// SRVs of all loaded textures, in one contiguous persistent range, and each
+	// texture's slot in it.
+	DescriptorHeap::Range mTextureSrvs;
+	std::unordered_map<std::string, UINT> mTextureSrvSlots;
+
+	// Bindless: the whole texture region is bound once per frame and the shaders index
+	// it with the material's DiffuseMapIndex.  Otherwise each draw binds its own SRV.
+	// Cleared in Initialize on resource binding tier 1, whose tables hold at most 128
+	// SRVs, fewer than the gMaxTextureSrvs the bindless table spans.
+	bool mBindlessTextures = true;
+
+	// Vertex/index buffers of all static geometry are suballocated from here.
+	std::unique_ptr<GpuBufferPool> mGeometryPool;
+
+	// Batches buffer uploads and holds upload heaps until the GPU is done with them.
+	std::unique_ptr<StagingManager> mStaging;
+
+	// Passes and resource transitions of a frame.  The graph is static, so it is compiled
+	// once; the back buffer and depth buffer are rebound every frame.
+	RenderGraph mRenderGraph;
+	std::unique_ptr<RenderGraphD3D12> mRenderGraphBackend;
+	RenderGraph::Resource mBackBufferResource = RenderGraph::InvalidResource;
+	RenderGraph::Resource mDepthResource = RenderGraph::InvalidResource;
+
+	// Scene draws are recorded into API-neutral streams and then replayed on command
+	// lists.  PSOs and the root signature are referred to by registered id.
+	CommandStreamD3D12 mStreamBackend;
+	std::unordered_map<std::string, std::uint32_t> mPipelineIds;
+	std::uint32_t mRootSignatureId = 0;
+
+	// The pipelines the frame loop uses, resolved by ResolveScenePipelines so that no
+	// frame looks one up by name.  Without a wireframe PSO, wireframe mode draws opaque.
+	std::uint32_t mOpaquePipeline = 0;
+	std::uint32_t mWireframePipeline = 0;
+	std::uint32_t mClothPipeline = 0;
+	std::uint32_t mTreeSpritesPipeline = 0;
+	std::uint32_t mHighlightPipeline = 0;
+	ID3D12PipelineState* mOpaquePso = nullptr;
+	ID3D12PipelineState* mWireframePso = nullptr;
+
+	// Every scene draw in submission order with its PSO, and its estimated command count
+	// for balancing the recording ranges.  The draw list is rebuilt every frame in the
+	// current frame resource's arena.
+	struct SceneDraw
+	{
+		RenderItem* Item = nullptr;
+		std::uint32_t Pipeline = 0;
+	};
+	ArenaVector<SceneDraw> mSceneDraws;
+	std::vector<std::uint32_t> mSceneDrawCosts;
+
+	// Long draw lists are cut into ranges recorded on the task pool, each range into its
+	// own command list.  The lists are submitted in range order.
+	std::unique_ptr<TaskPool> mTaskPool;
+	std::unique_ptr<ParallelRecorder> mSceneRecorder;
+	std::vector<ParallelRecorder::Range> mSceneRanges;
+	std::vector<ComPtr<ID3D12GraphicsCommandList>> mRecordCmdLists;
+	ComPtr<ID3D12GraphicsCommandList> mPostCmdList;
+	std::vector<ID3D12CommandList*> mSubmitLists;
 
 	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeometries;
 	std::unordered_map<std::string, std::unique_ptr<Material>> mMaterials;
 	std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures;
 	std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
 
+	// Every shader mShaders holds, as a cache request.  Bytecode comes from the on-disk
+	// cache and is only compiled when a source, include, define or flag changed.
+	std::vector<std::pair<std::string, ShaderCache::Request>> mShaderRequests;
+	std::unique_ptr<ShaderCacheD3D12> mShaderCache;
+
+	// Frame timing split into CPU work, fence waits, Present and input latency.  F5
+	// starts and stops writing every frame to frame_metrics.csv.
+	std::unique_ptr<FrameFenceD3D12> mFrameFence;
+	FrameMetrics mFrameMetrics;
+	std::unique_ptr<FrameMetricsSink> mFrameMetricsSink;
+
+	// Counters for scraping.  The server only starts when A2_METRICS_PORT names a
+	// localhost TCP port; the series are updated either way.
+	MetricsRegistry mMetrics;
+	std::unique_ptr<MetricsServer> mMetricsServer;
+	struct AppMetrics
+	{
+		MetricsRegistry::Metric* Frames = nullptr;
+		MetricsRegistry::Metric* FramePercentiles[FrameMetrics::MetricCount][3] = {};
+		MetricsRegistry::Metric* WaveUpdateMs = nullptr;
+		MetricsRegistry::Metric* WaveUpdateSeconds = nullptr;
+		MetricsRegistry::Metric* ClothUpdateMs = nullptr;
+		MetricsRegistry::Metric* ClothUpdateSeconds = nullptr;
+		MetricsRegistry::Metric* SceneDraws = nullptr;
+		MetricsRegistry::Metric* SceneCommands = nullptr;
+		MetricsRegistry::Metric* StateChanges = nullptr;
+		MetricsRegistry::Metric* RedundantCommands = nullptr;
+		MetricsRegistry::Metric* RenderItems = nullptr;
+		MetricsRegistry::Metric* CulledRatio = nullptr;
+		MetricsRegistry::Metric* MemoryBytes[(int)MemoryTag::Count][2] = {};    // cpu, gpu
+		MetricsRegistry::Metric* FrameAllocations = nullptr;
+	};
+	AppMetrics mAppMetrics;
+
+	// Counts heap allocations in frames after warm-up.  Always on in debug builds; in
+	// release A2_ALLOC_CHECK_FRAMES=N turns it on, and after N checked frames the app
+	// quits with exit code 1 if any of them allocated (0 otherwise).
+	std::unique_ptr<FrameAllocationCheck> mAllocationCheck;
+	std::uint64_t mAllocationCheckFrames = 0;
+
+	// A2_SOFTWARE_FRAME=path also renders the first frame's scene streams on the CPU and
+	// writes the image to path, for looking at frames without a usable GPU.  Cleared
+	// once the frame is written.
+	std::string mSoftwareFramePath;
+
+	// A2_HOT_RELOAD=1 watches the texture, model and shader files and rebuilds what an
+	// edit affects between frames, down to the PSOs built from an edited shader.
+	// Reloading frames allocate, so they show up in the allocation check.
+	enum AssetKind : std::uint32_t
+	{
+		TextureAsset,
+		GeometryAsset,
+		ShaderAsset,
+		PipelineAsset
+	};
+	std::unique_ptr<FileWatcher> mAssetWatcher;
+	AssetDependencies mAssetDependencies;
+	std::vector<std::string> mChangedFiles;
+
+	// Replaced PSOs, kept until the fence of the last frame that may use them.
+	std::deque<std::pair<UINT64, ComPtr<ID3D12PipelineState>>> mRetiredPSOs;
+
+	// The skull's pool buffers, freed when the model is reloaded.
+	GpuBufferPool::Allocation mSkullBuffers[2];
+
+	// A2_FRAME_BUDGET_MS=ms turns on the quality governor, which trades the workloads
+	// below against frame time.  The simulation stage reads its two settings through
+	// atomics; the render stage owns the rest.
+	enum QualityKnob : QualityGovernor::Knob
+	{
+		WaveRateKnob = 0,        // wave simulation every 8, 4, 2 or 1 frames
+		TreeDensityKnob,         // a quarter to all of the tree sprites
+		LocalLightsKnob,         // 0 to 8 point and spot lights
+		DrawDistanceKnob,        // cull distance for items with a CullSphere
+		ClothIterationsKnob,     // 2, 4 or 6 cloth solver iterations per step
+		QualityKnobCount
+	};
+	std::unique_ptr<QualityGovernor> mQualityGovernor;
+	MetricsRegistry::Metric* mQualityLevelMetrics[QualityKnobCount] = {};
+	std::atomic<std::uint32_t> mWaveUpdateInterval{ 1 };
+	std::atomic<std::uint32_t> mActiveLocalLights{ 8 };
+	float mDrawDistance = MathHelper::Infinity;
+	XMFLOAT3 mRenderEyePosW = { 0.0f, 0.0f, 0.0f };
+	RenderItem* mTreeSpritesRitem = nullptr;
+	UINT mTreeSpriteIndexCount = 0;
+
 	RenderItem* mWavesRitem = nullptr;
 
 	std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
@@ -165,6 +405,17 @@ private:
 	//ComPtr<ID3D12PipelineState> mOpaquePSO = nullptr;
 	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> mPSOs;
 
+	// What each PSO was created from, so it can be recreated with rebuilt shaders.  The
+	// stages are filled in from mShaders by name at creation.
+	struct PsoBuild
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC Desc;
+		std::string VS;
+		std::string GS;
+		std::string PS;
+	};
+	std::unordered_map<std::string, PsoBuild> mPsoBuilds;
+
 	// List of all the render items.
 	std::vector<std::unique_ptr<RenderItem>> mAllRitems;
 
@@ -174,10 +425,35 @@ private:
 
 	std::unique_ptr<Waves> mWaves;
 
+	// A2_FLAGS flags along the front of the maze, all in one vertex buffer and one
+	// draw, and the base of each one's pole.
+	std::unique_ptr<ClothSystem> mCloth;
+	std::vector<XMFLOAT3> mFlagPoles;
+	RenderItem* mClothRitem = nullptr;
+
 	// Render items divided by PSO.
 	//std::vector<RenderItem*> mOpaqueRitems;
 
-	PassConstants mMainPassCB;
+	// The simulation stage runs one frame ahead on its own thread and hands frames to
+	// Update through these packets.  Camera, materials, collision and waves belong to
+	// the simulation stage while it runs.
+	std::array<FramePacket, FramePipeline::PacketCount> mFramePackets;
+	FramePipeline mFramePipeline;
+	GameTimer mSimTimer;
+	bool mPipelinedFrames = true;
+
+	// Input gathered on the window thread for the simulation stage.  Taken once per
+	// simulated frame, never by the packet hand-off.
+	struct SimInput
+	{
+		float LookDx = 0.0f;
+		float LookDy = 0.0f;
+		float AspectRatio = 0.0f;
+		bool Collide = false;
+		std::int64_t InputTime = 0;     // first camera input since last taken
+	};
+	std::mutex mSimInputMutex;
+	SimInput mSimInput;
 
 	bool mIsWireframe = false;
 
@@ -199,6 +475,53 @@ private:
 	RenderItem* mPickedRitem = nullptr;
 };
 
+// Runs the Common benchmarks plus the cases that need the D3D headers and writes the
+// results to path as JSON.  Returns the process exit code.
+static int RunBenchmarks(const std::string& path)
+{
+	BenchmarkRunner runner;
+
+	char filter[256];
+	if (GetEnvironmentVariableA("A2_BENCH_FILTER", filter, sizeof(filter)) > 0)
+		runner.SetFilter(filter);
+
+	RunCommonBenchmarks(runner);
+
+	const std::uint64_t calls = 1024;
+	Camera camera;
+	camera.SetLens(0.25f * MathHelper::Pi, 1.5f, 1.0f, 1000.0f);
+	runner.Run("Camera::Walk+UpdateViewMatrix", calls, [&]()
+	{
+		for (std::uint64_t i = 0; i < calls; ++i)
+		{
+			camera.Walk(0.01f);
+			camera.UpdateViewMatrix();
+		}
+		DoNotOptimize(camera.GetView4x4f());
+	});
+
+	runner.Run("Camera::Pitch+UpdateViewMatrix", calls, [&]()
+	{
+		for (std::uint64_t i = 0; i < calls; ++i)
+		{
+			camera.Pitch((i & 1) ? 0.01f : -0.01f);
+			camera.UpdateViewMatrix();
+		}
+		DoNotOptimize(camera.GetView4x4f());
+	});
+
+	runner.Run("d3dUtil::CalcConstantBufferByteSize", calls, [&]()
+	{
+		UINT sum = 0;
+		for (std::uint64_t i = 0; i < calls; ++i)
+			sum += d3dUtil::CalcConstantBufferByteSize((UINT)i * 16);
+		DoNotOptimize(sum);
+	});
+
+	::OutputDebugStringA(runner.Report().c_str());
+	return runner.ExportJson(path) ? 0 : 1;
+}
+
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
 	PSTR cmdLine, int showCmd)
 {
@@ -207,6 +530,11 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif
 
+	// A2_BENCH_JSON=<file> runs the benchmarks instead of the demo.
+	char benchPath[MAX_PATH];
+	if (GetEnvironmentVariableA("A2_BENCH_JSON", benchPath, sizeof(benchPath)) > 0 && benchPath[0] != '\0')
+		return RunBenchmarks(benchPath);
+
 	try
 	{
 		ShapesApp theApp(hInstance);
@@ -220,6 +548,12 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
 		MessageBox(nullptr, e.ToString().c_str(), L"HR Failed", MB_OK);
 		return 0;
 	}
+	catch (std::exception& e)
+	{
+		// Shader cache and task graph errors, e.g. a shader that does not compile.
+		MessageBoxA(nullptr, e.what(), "Failed", MB_OK);
+		return 0;
+	}
 }
 
 ShapesApp::ShapesApp(HINSTANCE hInstance)
@@ -229,18 +563,32 @@ ShapesApp::ShapesApp(HINSTANCE hInstance)
 
 ShapesApp::~ShapesApp()
 {
+	mFramePipeline.Stop();
+	OutputDebugStringA(mFramePipeline.StatsString().c_str());
+	OutputDebugStringA(mFrameMetrics.Report().c_str());
+	OutputDebugStringA(mFramePacer.Report().c_str());
+	if (mCloth != nullptr)
+		OutputDebugStringA(mCloth->StatsString().c_str());
+	OutputDebugStringA(MemoryTracker::Report().c_str());
+	if (mAllocationCheck != nullptr)
+		OutputDebugStringA(mAllocationCheck->Report().c_str());
+
 	if (md3dDevice != nullptr)
 		FlushCommandQueue();
 }
 void ShapesApp::CreateItem(const char* item, XMMATRIX p, XMMATRIX q, XMMATRIX r, UINT ObjIndex, const char* material)
 {
 	auto RightWall = std::make_unique<RenderItem>();
-	DirectX::XMStoreFloat4x4(&RightWall->World, p * q * r);
+	const XMMATRIX world = p * q * r;
+	DirectX::XMStoreFloat4x4(&RightWall->World, world);
 	RightWall->ObjCBIndex = ObjIndex;
 	RightWall->Mat = mMaterials[material].get();// "Wood"
 	RightWall->Geo = mGeometries["shapeGeo"].get();
 	RightWall->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_LINELIST;
 	RightWall->Bounds = RightWall->Geo->DrawArgs[item].Bounds;
+	BoundingBox worldBounds;
+	RightWall->Bounds.Transform(worldBounds, world);
+	BoundingSphere::CreateFromBoundingBox(RightWall->CullSphere, worldBounds);
 	RightWall->IndexCount = RightWall->Geo->DrawArgs[item].IndexCount;
 	RightWall->StartIndexLocation = RightWall->Geo->DrawArgs[item].StartIndexLocation;
 	RightWall->BaseVertexLocation = RightWall->Geo->DrawArgs[item].BaseVertexLocation;
@@ -257,31 +605,47 @@ bool ShapesApp::Initialize()
 	// Reset the command list to prep for initialization commands.
 	ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
 
-	// Get the increment size of a descriptor in this heap type.  This is hardware specific, 
-	// so we have to query this information.
-	mCbvSrvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+	ThrowIfFailed(md3dDevice->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options)));
+	if (options.ResourceBindingTier == D3D12_RESOURCE_BINDING_TIER_1 && mBindlessTextures)
+	{
+		mBindlessTextures = false;
+		::OutputDebugStringA("Resource binding tier 1: binding textures per draw instead of bindless.\n");
+	}
+
+	// Every persistent slot starts out as a null SRV, so the bindless table has no
+	// uninitialized descriptors in the slots no texture uses.
+	mSrvHeap = std::make_unique<DescriptorHeap>(md3dDevice.Get(),
+		gMaxTextureSrvs, gTransientSrvsPerFrame, gNumFrameResources);
 
-	mWaves = std::make_unique<Waves>(128, 128, 1.0f, 0.03f, 4.0f, 0.2f);
+	{
+		MemoryScope memory(MemoryTag::Waves);
+		mWaves = std::make_unique<Waves>(128, 128, 1.0f, 0.03f, 4.0f, 0.2f);
+	}
+	BuildCloth();
+	mGeometryPool = std::make_unique<GpuBufferPool>(md3dDevice.Get());
+	mStaging = std::make_unique<StagingManager>(md3dDevice.Get());
+	mRenderGraphBackend = std::make_unique<RenderGraphD3D12>(md3dDevice.Get());
+	mTaskPool = std::make_unique<TaskPool>(TaskPool::DefaultWorkerCount());
+	mSceneRecorder = std::make_unique<ParallelRecorder>(*mTaskPool);
+	mShaderCache = std::make_unique<ShaderCacheD3D12>("ShaderCache");
+	mFrameFence = std::make_unique<FrameFenceD3D12>(mFence.Get());
+	BuildMetrics();
 	
 
-	// Texture Step3
-	LoadTextures();
-	BuildRootSignature();
-	// Texture Step4
-	BuildDescriptorHeaps();
-	BuildShadersAndInputLayout();
-	BuildShapeGeometry();
-	BuildSkullGeometry();
-	BuildWavesGeometry();
-	BuildLandGeometry();
-	// Tree Step2
-	BuildTreeSpritesGeometry();
-	BuildMaterials();
-	BuildRenderItems();
-	BuildFrameResources();
-	BuildPSOs();
+	// The build steps run as a dependency graph on the task pool; see BuildStartupTasks.
+	TaskGraph startup;
+	BuildStartupTasks(startup);
+	startup.Run(*mTaskPool);
+	::OutputDebugStringA(startup.Report().c_str());
+	::OutputDebugStringA(mShaderCache->Cache().StatsString().c_str());
 	//SimpleCollision();
 
+	OutputDebugString(mGeometryPool->StatsString().c_str());
+
+	// Record all the queued geometry uploads as one batch.
+	mStaging->Flush(mCommandList.Get());
+
 	// Execute the initialization commands.
 	ThrowIfFailed(mCommandList->Close());
 	ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
@@ -290,9 +654,113 @@ bool ShapesApp::Initialize()
 	// Wait until initialization is complete.
 	FlushCommandQueue();
 
+	// The upload heaps are no longer referenced by the GPU.
+	mStaging->Submit(mCurrentFence);
+	mStaging->Retire(mFence->GetCompletedValue());
+	OutputDebugString(mStaging->StatsString().c_str());
+	OutputDebugString(mSrvHeap->StatsString().c_str());
+
+	AccountGpuMemory();
+	::OutputDebugStringA(MemoryTracker::Report().c_str());
+	BuildAllocationCheck();
+	BuildQualityGovernor();
+	BuildFramePacing();
+	BuildHotReload();
+
+	char softwareFrame[MAX_PATH] = {};
+	if (GetEnvironmentVariableA("A2_SOFTWARE_FRAME", softwareFrame, sizeof(softwareFrame)) > 0)
+		mSoftwareFramePath = softwareFrame;
+
+#if defined(DEBUG) || defined(_DEBUG)
+	// The frame resources are idle until the first Update; borrow one so the recorded
+	// root arguments have buffers to point at.
+	mCurrFrameResource = mFrameResources[0].get();
+	BuildSceneDrawList();
+	::OutputDebugStringA(mSceneRecorder->MeasureScaling(mSceneDrawCosts,
+		[this](CommandStream& stream, std::uint32_t begin, std::uint32_t end) { RecordSceneRange(stream, begin, end); },
+		10).c_str());
+#endif
+
+	if (mPipelinedFrames)
+	{
+		mSimTimer.Reset();
+		mFramePipeline.Start([this](std::uint32_t slot, std::uint64_t frame)
+		{
+			if (frame == 0)
+				Profiler::Get().SetThreadName("Simulation");
+
+			mSimTimer.Tick();
+			Simulate(mSimTimer, mFramePackets[slot]);
+		});
+	}
+
 	return true;
 }
 
+// Initialize's build steps and what each one reads.  Steps that record into
+// mCommandList or go through the staging manager and geometry pool stay on this
+// thread; the rest are CPU work or free-threaded device calls and may run anywhere.
+void ShapesApp::BuildStartupTasks(TaskGraph& graph)
+{
+	const auto main = TaskGraph::MainThread;
+
+	// Texture Step3
+	auto textures = graph.AddTask("LoadTextures", [this]() { LoadTextures(); }, main);
+	auto rootSignature = graph.AddTask("BuildRootSignature", [this]() { BuildRootSignature(); });
+	// Texture Step4
+	auto heaps = graph.AddTask("BuildDescriptorHeaps", [this]() { BuildDescriptorHeaps(); });
+
+	// Only declares the shaders; each one is then loaded or compiled by its own task.
+	BuildShadersAndInputLayout();
+	std::vector<TaskGraph::Task> shaders;
+	for (auto& e : mShaderRequests)
+	{
+		ComPtr<ID3DBlob>& blob = mShaders[e.first];
+		const ShaderCache::Request& request = e.second;
+		shaders.push_back(graph.AddTask("LoadShader " + e.first,
+			[this, &blob, &request]()
+			{
+				MemoryScope memory(MemoryTag::Shaders);
+				blob = mShaderCache->Load(request);
+			}));
+	}
+
+	const TaskGraph::Task geometry[] =
+	{
+		graph.AddTask("BuildShapeGeometry", [this]() { BuildShapeGeometry(); }, main),
+		graph.AddTask("BuildSkullGeometry", [this]() { BuildSkullGeometry(); }, main),
+		graph.AddTask("BuildWavesGeometry", [this]() { BuildWavesGeometry(); }, main),
+		graph.AddTask("BuildClothGeometry", [this]() { BuildClothGeometry(); }, main),
+		graph.AddTask("BuildLandGeometry", [this]() { BuildLandGeometry(); }, main),
+		// Tree Step2
+		graph.AddTask("BuildTreeSpritesGeometry", [this]() { BuildTreeSpritesGeometry(); }, main),
+	};
+
+	auto materials = graph.AddTask("BuildMaterials", [this]() { BuildMaterials(); });
+	auto renderItems = graph.AddTask("BuildRenderItems", [this]() { BuildRenderItems(); });
+	auto frameResources = graph.AddTask("BuildFrameResources", [this]() { BuildFrameResources(); });
+	auto recordLists = graph.AddTask("BuildRecordCommandLists", [this]() { BuildRecordCommandLists(); });
+	auto psos = graph.AddTask("BuildPSOs", [this]() { BuildPSOs(); });
+	graph.AddTask("BuildRenderGraph", [this]() { BuildRenderGraph(); });
+
+	// SRVs need the texture resources; materials resolve their SRV handles.
+	graph.AddDependency(heaps, textures);
+	graph.AddDependency(materials, heaps);
+
+	// Render items point at geometry and materials.
+	for (auto g : geometry)
+		graph.AddDependency(renderItems, g);
+	graph.AddDependency(renderItems, materials);
+
+	// Buffers are sized by the item and material counts.
+	graph.AddDependency(frameResources, renderItems);
+	graph.AddDependency(recordLists, frameResources);
+
+	for (auto shader : shaders)
+		graph.AddDependency(psos, shader);
+	graph.AddDependency(psos, rootSignature);
+}
+
 void ShapesApp::OnResize()
 {
 	D3DApp::OnResize();
@@ -300,7 +768,9 @@ void ShapesApp::OnResize()
 
 	//When the window is resized, we no longer rebuild the projection matrix explicitly,
 	//and instead delegate the work to the Camera class with SetLens
-	mCamera.SetLens(0.25f * MathHelper::Pi, AspectRatio(), 1.0f, 1000.0f);
+	// The camera belongs to the simulation stage, which calls SetLens on its next frame.
+	std::lock_guard<std::mutex> lock(mSimInputMutex);
+	mSimInput.AspectRatio = AspectRatio();
 
 	// The window resized, so update the aspect ratio and recompute the projection matrix.
 	//XMMATRIX P = XMMatrixPerspectiveFovLH(0.25f * MathHelper::Pi, AspectRatio(), 1.0f, 1000.0f);
@@ -309,9 +779,17 @@ void ShapesApp::OnResize()
 
 void ShapesApp::Update(const GameTimer& gt)
 {
-	OnKeyboardInput(gt);
-	//UpdateCamera(gt);
-	//MazeCollision(mClientWidth *0.5f, mClientHeight * 0.5f);
+	PROFILE_ZONE("Update");
+	mFrameMetrics.BeginFrame(GameTimer::SteadyClockNow());
+	if (mAllocationCheck != nullptr)
+		mAllocationCheck->BeginFrame();
+
+	// Take the next simulated frame, or simulate one here when not pipelined.
+	std::uint32_t packetSlot = 0;
+	std::uint64_t packetFrame = 0;
+	const bool pipelined = mFramePipeline.Acquire(packetSlot, packetFrame);
+	if (!pipelined)
+		Simulate(gt, mFramePackets[packetSlot]);
 
 	// Cycle through the circular frame resource array.
 	mCurrFrameResourceIndex = (mCurrFrameResourceIndex + 1) % gNumFrameResources;
@@ -319,92 +797,161 @@ void ShapesApp::Update(const GameTimer& gt)
 
 	// Has the GPU finished processing the commands of the current frame resource?
 	// If not, wait until the GPU has completed commands up to this fence point.
-	if (mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
+	if (mCurrFrameResource->Fence != 0 && mFrameFence->CompletedValue() < mCurrFrameResource->Fence)
 	{
-		HANDLE eventHandle = CreateEventEx(nullptr, nullptr, false, EVENT_ALL_ACCESS);
-		ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-		WaitForSingleObject(eventHandle, INFINITE);
-		CloseHandle(eventHandle);
+		PROFILE_ZONE("WaitForFrameResource");
+		mFrameMetrics.AddFenceWait(mFrameFence->WaitForValue(mCurrFrameResource->Fence));
 	}
 
-	
+	// Nothing built in this frame resource's arena gNumFrameResources frames ago is
+	// still in use.
+	mCurrFrameResource->Arena.Reset();
+
+	// Release staging memory and descriptors the GPU has finished with, and recycle
+	// this frame resource's transient descriptors.
+	mStaging->Retire(mFence->GetCompletedValue());
+	mSrvHeap->Retire(mFence->GetCompletedValue());
+	mSrvHeap->BeginFrame(mCurrFrameResourceIndex);
+	while (!mRetiredPSOs.empty() && mRetiredPSOs.front().first <= mFence->GetCompletedValue())
+		mRetiredPSOs.pop_front();
+
+	UploadFramePacket(mFramePackets[packetSlot]);
+	mFrameMetrics.NoteInput(mFramePackets[packetSlot].InputTime);
+
+	// The packet has been copied out, so the simulation can reuse its slot.
+	if (pipelined)
+		mFramePipeline.Release();
+
+	UpdateCloth(gt);
+}
+
+// Simulation stage: advances input, camera, materials and waves by one frame and
+// writes the results into packet.  Touches no GPU objects.
+void ShapesApp::Simulate(const GameTimer& gt, FramePacket& packet)
+{
+	PROFILE_ZONE("Simulate");
+
+	packet.InputTime = ApplySimInput();
+	if (OnKeyboardInput(gt) && packet.InputTime == 0)
+		packet.InputTime = GameTimer::SteadyClockNow();
+
+	// The camera moved: keep on-demand pacing rendering while keys are held.
+	if (packet.InputTime != 0)
+		mFramePacer.Invalidate();
+	//UpdateCamera(gt);
+	//MazeCollision(mClientWidth *0.5f, mClientHeight * 0.5f);
 
 	AnimateMaterials(gt);
-	UpdateObjectCBs(gt);
-	UpdateMaterialCBs(gt);
-	UpdateMainPassCB(gt);
-	UpdateWaves(gt);
+	UpdateObjectBuffer(packet);
+	UpdateMaterialBuffer(packet);
+	UpdateMainPassCB(gt, packet);
+	UpdateWaves(gt, packet);
 	SimpleCollision();
 }
 
-void ShapesApp::Draw(const GameTimer& gt)
+// Returns when the oldest of the applied inputs arrived, or 0 if there were none.
+std::int64_t ShapesApp::ApplySimInput()
 {
-	auto cmdListAlloc = mCurrFrameResource->CmdListAlloc;
-
-	// Reuse the memory associated with command recording.
-	// We can only reset when the associated command lists have finished execution on the GPU.
-	ThrowIfFailed(cmdListAlloc->Reset());
+	SimInput input;
+	{
+		std::lock_guard<std::mutex> lock(mSimInputMutex);
+		input = mSimInput;
+		mSimInput = SimInput();
+	}
 
-	// A command list can be reset after it has been added to the command queue via ExecuteCommandList.
-	// Reusing the command list reuses memory.
-	//ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mOpaquePSO.Get()));
+	if (input.AspectRatio > 0.0f)
+		mCamera.SetLens(0.25f * MathHelper::Pi, input.AspectRatio, 1.0f, 1000.0f);
 
-	if (mIsWireframe)
+	if (input.LookDx != 0.0f || input.LookDy != 0.0f)
 	{
-		ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["opaque_wireframe"].Get()));
+		mCamera.Pitch(input.LookDy);
+		mCamera.RotateY(input.LookDx);
 	}
-	else
+
+	if (input.Collide)
 	{
-		ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["opaque"].Get()));
+		//step4
+		//MazeCollision(x,y);
+		SimpleCollision();
 	}
 
-	mCommandList->RSSetViewports(1, &mScreenViewport);
-	mCommandList->RSSetScissorRects(1, &mScissorRect);
+	return input.InputTime;
+}
 
-	// Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
+// Render stage: copies a simulated frame into the current frame resource.
+void ShapesApp::UploadFramePacket(const FramePacket& packet)
+{
+	PROFILE_ZONE("UploadFramePacket");
 
-	// Clear the back buffer and depth buffer.
-	mCommandList->ClearRenderTargetView(CurrentBackBufferView(), Colors::Black, 0, nullptr);
-	mCommandList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
+	auto currObjectBuffer = mCurrFrameResource->ObjectBuffer.get();
+	for (auto& update : packet.ObjectUpdates)
+		currObjectBuffer->CopyData(update.first, update.second);
 
-	// Specify the buffers we are going to render to.
-	mCommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
+	auto currMaterialBuffer = mCurrFrameResource->MaterialBuffer.get();
+	for (auto& update : packet.MaterialUpdates)
+		currMaterialBuffer->CopyData(update.first, update.second);
 
-	// Texture Step5
-	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvDescriptorHeap.Get() };
-	mCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+	// The window size belongs to the render stage.
+	PassConstants pass = packet.Pass;
+	mRenderEyePosW = pass.EyePosW;
+	pass.RenderTargetSize = XMFLOAT2((float)mClientWidth, (float)mClientHeight);
+	pass.InvRenderTargetSize = XMFLOAT2(1.0f / mClientWidth, 1.0f / mClientHeight);
+	mCurrFrameResource->PassCB->CopyData(0, pass);
+
+	// Update the wave vertex buffer with the new solution.
+	auto currWavesVB = mCurrFrameResource->WavesVB.get();
+	for (size_t i = 0; i < packet.WaveVertices.size(); ++i)
+		currWavesVB->CopyData((int)i, packet.WaveVertices[i]);
 
-	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
+	// Set the dynamic VB of the wave renderitem to the current frame VB.
+	mWavesRitem->Geo->VertexBufferGPU = currWavesVB->Resource();
+}
 
-	auto passCB = mCurrFrameResource->PassCB->Resource();
-	mCommandList->SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
-	
-	// Tree step29
-	//DrawRenderItems(mCommandList.Get(), mOpaqueRitems);
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
+void ShapesApp::Draw(const GameTimer& gt)
+{
+	PROFILE_ZONE("Draw");
 
-	// Tree step13
-	mCommandList->SetPipelineState(mPSOs["treeSprites"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::AlphaTestedTreeSprites]);
+	auto cmdListAlloc = mCurrFrameResource->CmdListAlloc;
+
+	// Reuse the memory associated with command recording.
+	// We can only reset when the associated command lists have finished execution on the GPU.
+	ThrowIfFailed(cmdListAlloc->Reset());
+
+	// A command list can be reset after it has been added to the command queue via ExecuteCommandList.
+	// Reusing the command list reuses memory.
+	//ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mOpaquePSO.Get()));
+
+	ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mIsWireframe ? mWireframePso : mOpaquePso));
 
-	mCommandList->SetPipelineState(mPSOs["highlight"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Highlight]);
+	// Edited assets are swapped in before anything is recorded; reloaded textures
+	// record their copies here.
+	ReloadChangedAssets();
 
-	// Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+	// Any buffer uploads queued since the last frame go in before the draws.
+	mStaging->Flush(mCommandList.Get());
+
+	// The graph records the back buffer transitions around the scene pass.  A parallel
+	// scene pass closes mCommandList and continues the graph on mPostCmdList.
+	mSubmitLists.clear();
+	mRenderGraphBackend->SetResource(mBackBufferResource, CurrentBackBuffer());
+	mRenderGraphBackend->SetResource(mDepthResource, mDepthStencilBuffer.Get());
+	mRenderGraphBackend->Execute(mRenderGraph, mCommandList.Get());
 
 	// Done recording commands.
-	ThrowIfFailed(mCommandList->Close());
+	auto lastCmdList = mRenderGraphBackend->CommandList();
+	ThrowIfFailed(lastCmdList->Close());
+	mSubmitLists.push_back(lastCmdList);
 
-	// Add the command list to the queue for execution.
-	ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
-	mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+	// Add the command lists to the queue for execution, in recording order.
+	mCommandQueue->ExecuteCommandLists((UINT)mSubmitLists.size(), mSubmitLists.data());
 
 	// Swap the back and front buffers
-	ThrowIfFailed(mSwapChain->Present(0, 0));
+	{
+		PROFILE_ZONE("Present");
+		const std::int64_t presentStart = GameTimer::SteadyClockNow();
+		ThrowIfFailed(mSwapChain->Present(0, 0));
+		mFrameMetrics.AddPresent((GameTimer::SteadyClockNow() - presentStart) * 1.0e-6);
+	}
 	mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
 
 	// Advance the fence value to mark commands up to this fence point.
@@ -414,6 +961,37 @@ void ShapesApp::Draw(const GameTimer& gt)
 	// Because we are on the GPU timeline, the new fence point won't be 
 	// set until the GPU finishes processing all the commands prior to this Signal().
 	mCommandQueue->Signal(mFence.Get(), mCurrentFence);
+	mStaging->Submit(mCurrentFence);
+
+	mFrameMetrics.EndFrame(GameTimer::SteadyClockNow());
+	UpdateQualityGovernor();
+	PublishMetrics();
+	EndAllocationCheckFrame();
+}
+
+LRESULT ShapesApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
+	if (msg == WM_KEYUP && (int)wParam == VK_F5)
+	{
+		if (mFrameMetricsSink == nullptr)
+		{
+			mFrameMetricsSink = FrameMetricsSink::Open("frame_metrics.csv");
+			if (!mFrameMetricsSink->IsOpen())
+			{
+				::OutputDebugStringA("Could not open frame_metrics.csv\n");
+				mFrameMetricsSink.reset();
+			}
+		}
+		else
+		{
+			mFrameMetricsSink.reset();
+		}
+
+		mFrameMetrics.SetSink(mFrameMetricsSink.get());
+		return 0;
+	}
+
+	return D3DApp::MsgProc(hwnd, msg, wParam, lParam);
 }
 
 void ShapesApp::OnMouseDown(WPARAM btnState, int x, int y)
@@ -427,9 +1005,10 @@ void ShapesApp::OnMouseDown(WPARAM btnState, int x, int y)
 	}
 	else if ((btnState & MK_RBUTTON) != 0)
 	{
-		//step4
-		//MazeCollision(x,y);
-		SimpleCollision();
+		std::lock_guard<std::mutex> lock(mSimInputMutex);
+		mSimInput.Collide = true;
+		if (mSimInput.InputTime == 0)
+			mSimInput.InputTime = GameTimer::SteadyClockNow();
 	}
 }
 
@@ -452,17 +1031,23 @@ void ShapesApp::OnMouseMove(WPARAM btnState, int x, int y)
 		//mTheta += dx;
 		//mPhi += dy;
 
-		mCamera.Pitch(dy);
-		mCamera.RotateY(dx);
+		std::lock_guard<std::mutex> lock(mSimInputMutex);
+		mSimInput.LookDx += dx;
+		mSimInput.LookDy += dy;
+		if (mSimInput.InputTime == 0)
+			mSimInput.InputTime = GameTimer::SteadyClockNow();
 	}
 
 	mLastMousePos.x = x;
 	mLastMousePos.y = y;
 }
 
-void ShapesApp::OnKeyboardInput(const GameTimer& gt)
+// Returns true if a movement key is down, so the frame counts as carrying input.
+bool ShapesApp::OnKeyboardInput(const GameTimer& gt)
 {
 	const float dt = gt.DeltaTime();
+	const bool moving = ((GetAsyncKeyState('W') | GetAsyncKeyState('S') |
+		GetAsyncKeyState('A') | GetAsyncKeyState('D')) & 0x8000) != 0;
 
 	//GetAsyncKeyState returns a short (2 bytes)
 	if (GetAsyncKeyState('W') & 0x8000) //most significant bit (MSB) is 1 when key is pressed (1000 000 000 000)
@@ -483,6 +1068,7 @@ void ShapesApp::OnKeyboardInput(const GameTimer& gt)
 		mCamera.Strafe(10.0f * dt);
 
 	mCamera.UpdateViewMatrix();
+	return moving;
 }
 
 void ShapesApp::AnimateMaterials(const GameTimer& gt)
@@ -490,20 +1076,11 @@ void ShapesApp::AnimateMaterials(const GameTimer& gt)
 	// Scroll the water material texture coordinates.
 	auto waterMat = mMaterials["eight"].get();
 
-	float& tu = waterMat->MatTransform(3, 0);
-	float& tv = waterMat->MatTransform(3, 1);
-
-	tu += 0.1f * gt.DeltaTime();
-	tv += 0.02f * gt.DeltaTime();
-
-	if (tu >= 1.0f)
-		tu -= 1.0f;
-
-	if (tv >= 1.0f)
-		tv -= 1.0f;
-
-	waterMat->MatTransform(3, 0) = tu;
-	waterMat->MatTransform(3, 1) = tv;
+	// Derived from the wrapped total time rather than accumulated per frame, so the
+	// offset neither drifts nor loses precision over a long session.  The periods
+	// (10 s and 50 s) are one full scroll at 0.1 and 0.02 units per second.
+	waterMat->MatTransform(3, 0) = (float)(gt.WrappedTime(10.0) * 0.1);
+	waterMat->MatTransform(3, 1) = (float)(gt.WrappedTime(50.0) * 0.02);
 
 	// Material has changed, so need to update cbuffer.
 	waterMat->NumFramesDirty = gNumFrameResources;
@@ -511,23 +1088,25 @@ void ShapesApp::AnimateMaterials(const GameTimer& gt)
 }
 
 
-void ShapesApp::UpdateObjectCBs(const GameTimer& gt)
+void ShapesApp::UpdateObjectBuffer(FramePacket& packet)
 {
-	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
+	PROFILE_ZONE("UpdateObjectBuffer");
+
+	packet.ObjectUpdates.clear();
 	for (auto& e : mAllRitems)
 	{
-		// Only update the cbuffer data if the constants have changed.  
+		// Only update the buffer data if the object has changed.  
 		// This needs to be tracked per frame resource.
 		if (e->NumFramesDirty > 0)
 		{
 			XMMATRIX world = DirectX::XMLoadFloat4x4(&e->World);
 			XMMATRIX texTransform = DirectX::XMLoadFloat4x4(&e->TexTransform);
 
-			ObjectConstants objConstants;
-			DirectX::XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
-			DirectX::XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
+			ObjectData objData;
+			DirectX::XMStoreFloat4x4(&objData.World, XMMatrixTranspose(world));
+			DirectX::XMStoreFloat4x4(&objData.TexTransform, XMMatrixTranspose(texTransform));
 
-			currObjectCB->CopyData(e->ObjCBIndex, objConstants);
+			packet.ObjectUpdates.emplace_back(e->ObjCBIndex, objData);
 
 			// Next FrameResource need to be updated too.
 			e->NumFramesDirty--;
@@ -535,25 +1114,26 @@ void ShapesApp::UpdateObjectCBs(const GameTimer& gt)
 	}
 }
 
-void ShapesApp::UpdateMaterialCBs(const GameTimer& gt)
+void ShapesApp::UpdateMaterialBuffer(FramePacket& packet)
 {
-	auto currMaterialCB = mCurrFrameResource->MaterialCB.get();
+	packet.MaterialUpdates.clear();
 	for (auto& e : mMaterials)
 	{
-		// Only update the cbuffer data if the constants have changed.  If the cbuffer
+		// Only update the buffer data if the material has changed.  If the material
 		// data changes, it needs to be updated for each FrameResource.
 		Material* mat = e.second.get();
 		if (mat->NumFramesDirty > 0)
 		{
 			XMMATRIX matTransform = DirectX::XMLoadFloat4x4(&mat->MatTransform);
 
-			MaterialConstants matConstants;
-			matConstants.DiffuseAlbedo = mat->DiffuseAlbedo;
-			matConstants.FresnelR0 = mat->FresnelR0;
-			matConstants.Roughness = mat->Roughness;
-			DirectX::XMStoreFloat4x4(&matConstants.MatTransform, XMMatrixTranspose(matTransform));
+			MaterialData matData;
+			matData.DiffuseAlbedo = mat->DiffuseAlbedo;
+			matData.FresnelR0 = mat->FresnelR0;
+			matData.Roughness = mat->Roughness;
+			DirectX::XMStoreFloat4x4(&matData.MatTransform, XMMatrixTranspose(matTransform));
+			matData.DiffuseMapIndex = mTextureSrvs.Start + mat->DiffuseSrvHeapIndex;
 
-			currMaterialCB->CopyData(mat->MatCBIndex, matConstants);
+			packet.MaterialUpdates.emplace_back(mat->MatCBIndex, matData);
 
 			// Next FrameResource need to be updated too.
 			mat->NumFramesDirty--;
@@ -561,8 +1141,10 @@ void ShapesApp::UpdateMaterialCBs(const GameTimer& gt)
 	}
 }
 
-void ShapesApp::UpdateMainPassCB(const GameTimer& gt)
+void ShapesApp::UpdateMainPassCB(const GameTimer& gt, FramePacket& packet)
 {
+	PassConstants& pass = packet.Pass;
+
 	XMMATRIX view = mCamera.GetView();
 	XMMATRIX proj = mCamera.GetProj();
 
@@ -571,81 +1153,89 @@ void ShapesApp::UpdateMainPassCB(const GameTimer& gt)
 	XMMATRIX invProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
 	XMMATRIX invViewProj = XMMatrixInverse(&XMMatrixDeterminant(viewProj), viewProj);
 
-	DirectX::XMStoreFloat4x4(&mMainPassCB.View, XMMatrixTranspose(view));
-	DirectX::XMStoreFloat4x4(&mMainPassCB.InvView, XMMatrixTranspose(invView));
-	DirectX::XMStoreFloat4x4(&mMainPassCB.Proj, XMMatrixTranspose(proj));
-	DirectX::XMStoreFloat4x4(&mMainPassCB.InvProj, XMMatrixTranspose(invProj));
-	DirectX::XMStoreFloat4x4(&mMainPassCB.ViewProj, XMMatrixTranspose(viewProj));
-	DirectX::XMStoreFloat4x4(&mMainPassCB.InvViewProj, XMMatrixTranspose(invViewProj));
-	mMainPassCB.EyePosW = mCamera.GetPosition3f();
-	mMainPassCB.RenderTargetSize = XMFLOAT2((float)mClientWidth, (float)mClientHeight);
-	mMainPassCB.InvRenderTargetSize = XMFLOAT2(1.0f / mClientWidth, 1.0f / mClientHeight);
-	mMainPassCB.NearZ = 1.0f;
-	mMainPassCB.FarZ = 1000.0f;
-	mMainPassCB.TotalTime = gt.TotalTime();
-	mMainPassCB.DeltaTime = gt.DeltaTime();
-	mMainPassCB.AmbientLight = { 1.0f, 0.3f, 1.9f, 0.8f };
-	mMainPassCB.Lights[0].Direction = { 0.57735f, -0.57735f, 0.57735f };
-	mMainPassCB.Lights[0].Strength = { 0.6f, 0.6f, 0.6f };
-	mMainPassCB.Lights[1].Direction = { -0.57735f, -0.57735f, 0.57735f };
-	mMainPassCB.Lights[1].Strength = { 0.3f, 0.3f, 0.3f };
-	mMainPassCB.Lights[2].Direction = { 0.0f, -0.707f, -0.707f };
-	mMainPassCB.Lights[2].Strength = { 0.15f, 0.15f, 0.15f };
+	DirectX::XMStoreFloat4x4(&pass.View, XMMatrixTranspose(view));
+	DirectX::XMStoreFloat4x4(&pass.InvView, XMMatrixTranspose(invView));
+	DirectX::XMStoreFloat4x4(&pass.Proj, XMMatrixTranspose(proj));
+	DirectX::XMStoreFloat4x4(&pass.InvProj, XMMatrixTranspose(invProj));
+	DirectX::XMStoreFloat4x4(&pass.ViewProj, XMMatrixTranspose(viewProj));
+	DirectX::XMStoreFloat4x4(&pass.InvViewProj, XMMatrixTranspose(invViewProj));
+	pass.EyePosW = mCamera.GetPosition3f();
+	pass.NearZ = 1.0f;
+	pass.FarZ = 1000.0f;
+	// Shaders only need a phase; wrapping keeps sub-millisecond resolution in the float.
+	pass.TotalTime = (float)gt.WrappedTime(3600.0);
+	pass.DeltaTime = gt.DeltaTime();
+	pass.AmbientLight = { 1.0f, 0.3f, 1.9f, 0.8f };
+	pass.Lights[0].Direction = { 0.57735f, -0.57735f, 0.57735f };
+	pass.Lights[0].Strength = { 0.6f, 0.6f, 0.6f };
+	pass.Lights[1].Direction = { -0.57735f, -0.57735f, 0.57735f };
+	pass.Lights[1].Strength = { 0.3f, 0.3f, 0.3f };
+	pass.Lights[2].Direction = { 0.0f, -0.707f, -0.707f };
+	pass.Lights[2].Strength = { 0.15f, 0.15f, 0.15f };
 
 	// Light Step2 
 // (Step 1 in Default.hlsl) (Adding a point light)
-	mMainPassCB.Lights[3].Position = { -10.0f, 0.0f, 4.0f };
-	mMainPassCB.Lights[3].Strength = { 2.0f, 2.0f, 0.0f };
+	pass.Lights[3].Position = { -10.0f, 0.0f, 4.0f };
+	pass.Lights[3].Strength = { 2.0f, 2.0f, 0.0f };
 
 
 	// (Adding a Spot light)
 	// Top down forward
-	mMainPassCB.Lights[4].Position = { -10.0f, 8.0f, 3.0f };
-	mMainPassCB.Lights[4].Strength = { 18.0f, 0.0f, 0.0f };
-	mMainPassCB.Lights[4].SpotPower = 18.0f;
-	mMainPassCB.Lights[4].Direction = { 0.0f, -1.0f, 0.0f };
+	pass.Lights[4].Position = { -10.0f, 8.0f, 3.0f };
+	pass.Lights[4].Strength = { 18.0f, 0.0f, 0.0f };
+	pass.Lights[4].SpotPower = 18.0f;
+	pass.Lights[4].Direction = { 0.0f, -1.0f, 0.0f };
 
 	// Top down back
-	mMainPassCB.Lights[5].Position = { -10.0f, 4.0f, -11.0f };
-	mMainPassCB.Lights[5].Strength = { 18.0f, 18.0f, 18.0f };
-	mMainPassCB.Lights[5].SpotPower = 18.0f;
-	mMainPassCB.Lights[5].Direction = { 0.0f, 0.0f, 1.0f };
+	pass.Lights[5].Position = { -10.0f, 4.0f, -11.0f };
+	pass.Lights[5].Strength = { 18.0f, 18.0f, 18.0f };
+	pass.Lights[5].SpotPower = 18.0f;
+	pass.Lights[5].Direction = { 0.0f, 0.0f, 1.0f };
 
 	// Left right forward
-	mMainPassCB.Lights[6].Position = { -18.0f, 3.0f, 2.0f };
-	mMainPassCB.Lights[6].Strength = { 18.0f, 18.0f, 18.0f };
-	mMainPassCB.Lights[6].SpotPower = 6.0f;
-	mMainPassCB.Lights[6].Direction = { 1.0f, 0.0f, 0.0f };
+	pass.Lights[6].Position = { -18.0f, 3.0f, 2.0f };
+	pass.Lights[6].Strength = { 18.0f, 18.0f, 18.0f };
+	pass.Lights[6].SpotPower = 6.0f;
+	pass.Lights[6].Direction = { 1.0f, 0.0f, 0.0f };
 
 	// Left right back
-	mMainPassCB.Lights[7].Position = { -18.0f, 3.0f, 10.0f };
-	mMainPassCB.Lights[7].Strength = { 18.0f, 18.0f, 18.0f };
-	mMainPassCB.Lights[7].SpotPower = 6.0f;
-	mMainPassCB.Lights[7].Direction = { 1.0f, 0.0f, 0.0f };
+	pass.Lights[7].Position = { -18.0f, 3.0f, 10.0f };
+	pass.Lights[7].Strength = { 18.0f, 18.0f, 18.0f };
+	pass.Lights[7].SpotPower = 6.0f;
+	pass.Lights[7].Direction = { 1.0f, 0.0f, 0.0f };
 
 	// right left forward
-	mMainPassCB.Lights[8].Position = { -2.0f, 3.0f, 2.0f };
-	mMainPassCB.Lights[8].Strength = { 18.0f, 18.0f, 18.0f };
-	mMainPassCB.Lights[8].SpotPower = 6.0f;
-	mMainPassCB.Lights[8].Direction = { -1.0f, 0.0f, 0.0f };
+	pass.Lights[8].Position = { -2.0f, 3.0f, 2.0f };
+	pass.Lights[8].Strength = { 18.0f, 18.0f, 18.0f };
+	pass.Lights[8].SpotPower = 6.0f;
+	pass.Lights[8].Direction = { -1.0f, 0.0f, 0.0f };
 
 	// right left back
-	mMainPassCB.Lights[9].Position = { -2.0f, 3.0f, 10.0f };
-	mMainPassCB.Lights[9].Strength = { 18.0f, 18.0f, 18.0f };
-	mMainPassCB.Lights[9].SpotPower = 6.0f;
-	mMainPassCB.Lights[9].Direction = { -1.0f, 0.0f, 0.0f };
-
-	auto currPassCB = mCurrFrameResource->PassCB.get();
-	currPassCB->CopyData(0, mMainPassCB);
+	pass.Lights[9].Position = { -2.0f, 3.0f, 10.0f };
+	pass.Lights[9].Strength = { 18.0f, 18.0f, 18.0f };
+	pass.Lights[9].SpotPower = 6.0f;
+	pass.Lights[9].Direction = { -1.0f, 0.0f, 0.0f };
+
+	// Point and spot lights past the quality governor's count are switched off; a zero
+	// range also lets the shader skip them.
+	const int localLights = 2 + 6;
+	for (int i = 3 + (int)mActiveLocalLights.load(std::memory_order_relaxed); i < 3 + localLights; ++i)
+	{
+		pass.Lights[i].Strength = { 0.0f, 0.0f, 0.0f };
+		pass.Lights[i].FalloffEnd = 0.0f;
+	}
 }
 
-void ShapesApp::UpdateWaves(const GameTimer& gt)
+void ShapesApp::UpdateWaves(const GameTimer& gt, FramePacket& packet)
 {
+	PROFILE_ZONE("UpdateWaves");
+
 	// Every quarter second, generate a random wave.
-	static float t_base = 0.0f;
-	if ((mTimer.TotalTime() - t_base) >= 0.25f)
+	static std::int64_t t_base = 0;
+	const std::int64_t wavePeriod = GameTimer::TicksPerSecond / 4;
+	if ((gt.TotalTicks() - t_base) >= wavePeriod)
 	{
-		t_base += 0.25f;
+		t_base += wavePeriod;
 
 		int i = MathHelper::Rand(4, mWaves->RowCount() - 5);
 		int j = MathHelper::Rand(4, mWaves->ColumnCount() - 5);
@@ -655,11 +1245,25 @@ void ShapesApp::UpdateWaves(const GameTimer& gt)
 		mWaves->Disturb(i, j, r);
 	}
 
-	// Update the wave simulation.
-	mWaves->Update(gt.DeltaTime());
+	// Update the wave simulation, every frame unless the quality governor has thinned
+	// it out.  Skipped frames' time is handed to the next update.
+	static std::uint32_t skippedFrames = 0;
+	static float skippedTime = 0.0f;
+	skippedTime += gt.DeltaTime();
+	if (++skippedFrames >= mWaveUpdateInterval.load(std::memory_order_relaxed))
+	{
+		const std::int64_t waveStart = GameTimer::SteadyClockNow();
+		mWaves->Update(skippedTime);
+		const double waveMs = (GameTimer::SteadyClockNow() - waveStart) * 1.0e-6;
+		mAppMetrics.WaveUpdateMs->Set(waveMs);
+		mAppMetrics.WaveUpdateSeconds->Add(waveMs * 1.0e-3);
+
+		skippedFrames = 0;
+		skippedTime = 0.0f;
+	}
 
-	// Update the wave vertex buffer with the new solution.
-	auto currWavesVB = mCurrFrameResource->WavesVB.get();
+	// The render stage copies these into the frame's wave vertex buffer.
+	packet.WaveVertices.resize(mWaves->VertexCount());
 	for (int i = 0; i < mWaves->VertexCount(); ++i)
 	{
 		Vertex v;
@@ -672,16 +1276,34 @@ void ShapesApp::UpdateWaves(const GameTimer& gt)
 		v.TexC.x = 0.5f + v.Pos.x / mWaves->Width();
 		v.TexC.y = 0.5f - v.Pos.z / mWaves->Depth();
 
-		currWavesVB->CopyData(i, v);
+		packet.WaveVertices[i] = v;
 	}
+}
 
-	// Set the dynamic VB of the wave renderitem to the current frame VB.
-	mWavesRitem->Geo->VertexBufferGPU = currWavesVB->Resource();
+// Steps the flags on the render thread, where the frame resource is, and has the
+// solver write them straight into its cloth vertex buffer.  The GPU finished with
+// that buffer before the frame resource came around again.
+void ShapesApp::UpdateCloth(const GameTimer& gt)
+{
+	if (mClothRitem == nullptr)
+		return;
+
+	PROFILE_ZONE("UpdateCloth");
+
+	auto currClothVB = mCurrFrameResource->ClothVB.get();
+	mCloth->Update(gt.DeltaTime(), mTaskPool.get(), reinterpret_cast<ClothSystem::Vertex*>(currClothVB->MappedData()));
+	mClothRitem->Geo->VertexBufferGPU = currClothVB->Resource();
+
+	const double clothMs = mCloth->GetStats().LastUpdateMs;
+	mAppMetrics.ClothUpdateMs->Set(clothMs);
+	mAppMetrics.ClothUpdateSeconds->Add(clothMs * 1.0e-3);
 }
 
 // Textures Step6
 void ShapesApp::LoadTextures()
 {
+	MemoryScope memory(MemoryTag::Textures);
+
 	auto oneTex = std::make_unique<Texture>();
 	oneTex->Name = "oneTex";
 	oneTex->Filename = L"../../MyTextures/one.dds";
@@ -766,27 +1388,49 @@ void ShapesApp::LoadTextures()
 	mTextures[eightTex->Name] = std::move(eightTex);
 	mTextures[nineTex->Name] = std::move(nineTex);
 	mTextures[tenTex->Name] = std::move(tenTex);
+
+	// The DDS loader records its copies on mCommandList; hand the upload heaps to the
+	// staging manager so they are released once the initialization fence completes.
+	for (auto& e : mTextures)
+	{
+		mStaging->DeferRelease(e.second->UploadHeap);
+		e.second->UploadHeap = nullptr;
+	}
 }
 
 void ShapesApp::BuildRootSignature()
 {
 	// Textures Step7
 	CD3DX12_DESCRIPTOR_RANGE texTable;
-	texTable.Init(
-		D3D12_DESCRIPTOR_RANGE_TYPE_SRV,
-		1,  // number of descriptors
-		0); // register t0
+	if (mBindlessTextures)
+	{
+		// The whole persistent region of the heap, starting at descriptor 0.
+		texTable.Init(
+			D3D12_DESCRIPTOR_RANGE_TYPE_SRV,
+			gMaxTextureSrvs,
+			0,  // register t0
+			1); // space1
+	}
+	else
+	{
+		texTable.Init(
+			D3D12_DESCRIPTOR_RANGE_TYPE_SRV,
+			1,  // number of descriptors
+			0); // register t0
+	}
 
 	// Root parameter can be a table, root descriptor or root constants.
 	// Textures Step8
-	CD3DX12_ROOT_PARAMETER slotRootParameter[4];
+	CD3DX12_ROOT_PARAMETER slotRootParameter[5];
 
-	// Create root CBV.
 	// Textures Step9
+	// Per draw only the packed object/material index changes (one 32-bit constant).
+	// The object and material tables are bound once per frame as structured buffers.
 	slotRootParameter[0].InitAsDescriptorTable(1, &texTable, D3D12_SHADER_VISIBILITY_PIXEL);
-	slotRootParameter[1].InitAsConstantBufferView(0);
+	slotRootParameter[1].InitAsConstants(1, 0);
 	slotRootParameter[2].InitAsConstantBufferView(1);
-	slotRootParameter[3].InitAsConstantBufferView(2);
+	slotRootParameter[3].InitAsShaderResourceView(1, 2);
+	slotRootParameter[4].InitAsShaderResourceView(0, 2);
 
 	// Textures Step10
 	auto staticSamplers = GetStaticSamplers();
@@ -794,7 +1438,7 @@ void ShapesApp::BuildRootSignature()
 	// A root signature is an array of root parameters.
 	// Textures Step11
 	//CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(3, slotRootParameter, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
-	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(4, slotRootParameter,
+	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(5, slotRootParameter,
 		(UINT)staticSamplers.size(), staticSamplers.data(),
 		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
@@ -817,116 +1461,43 @@ void ShapesApp::BuildRootSignature()
 		IID_PPV_ARGS(mRootSignature.GetAddressOf())));
 }
 
-// Texture Step12
-void ShapesApp::BuildDescriptorHeaps()
+void ShapesApp::BuildRenderGraph()
 {
-	//
-	// Create the SRV heap.
-	//
-	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
+	// One logical back buffer; the current swap chain buffer is bound to it each frame.
+	mBackBufferResource = mRenderGraph.ImportResource("BackBuffer",
+		RenderGraph::StatePresent, RenderGraph::StatePresent);
+	mDepthResource = mRenderGraph.ImportResource("DepthStencil",
+		RenderGraph::StateDepthWrite, RenderGraph::StateDepthWrite);
 
-	// Add texture Step3
-	// Tree Step10
-	//srvHeapDesc.NumDescriptors = 3;
-	srvHeapDesc.NumDescriptors = 10;
+	auto scenePass = mRenderGraph.AddPass("Scene", [this]() { DrawScenePass(mRenderGraphBackend->CommandList()); });
+	mRenderGraph.Write(scenePass, mBackBufferResource, RenderGraph::StateRenderTarget);
+	mRenderGraph.Write(scenePass, mDepthResource, RenderGraph::StateDepthWrite);
 
-	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&mSrvDescriptorHeap)));
+	mRenderGraph.Compile();
+	mRenderGraphBackend->Realize(mRenderGraph);
 
-	//
-	// Fill out the heap with actual descriptors.
-	//
-	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-
-
-	// Add texture Step4
-	auto oneTex = mTextures["oneTex"]->Resource;
-	auto twoTex = mTextures["twoTex"]->Resource;
-	auto threeTex = mTextures["threeTex"]->Resource;
-	auto fourTex = mTextures["fourTex"]->Resource;
-	// Tree step11
-	auto treeArrayTex = mTextures["treeArrayTex"]->Resource;
-	auto sixTex = mTextures["sixTex"]->Resource;
-	auto sevenTex = mTextures["sevenTex"]->Resource;
-	auto eightTex = mTextures["eightTex"]->Resource;
-	auto nineTex = mTextures["nineTex"]->Resource;
-	auto tenTex = mTextures["tenTex"]->Resource;
-
-
-
-	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.Format = oneTex->GetDesc().Format;
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	srvDesc.Texture2D.MipLevels = oneTex->GetDesc().MipLevels;
-	srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-	md3dDevice->CreateShaderResourceView(oneTex.Get(), &srvDesc, hDescriptor);
-
-	// Add texture Step5
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	srvDesc.Format = twoTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = twoTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(twoTex.Get(), &srvDesc, hDescriptor);
-
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	srvDesc.Format = threeTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = threeTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(threeTex.Get(), &srvDesc, hDescriptor);
-
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	srvDesc.Format = fourTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = fourTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(fourTex.Get(), &srvDesc, hDescriptor);
-
-
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	srvDesc.Format = sixTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = sixTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(sixTex.Get(), &srvDesc, hDescriptor);
-
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	srvDesc.Format = sevenTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = sevenTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(sevenTex.Get(), &srvDesc, hDescriptor);
-
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	srvDesc.Format = eightTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = eightTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(eightTex.Get(), &srvDesc, hDescriptor);
-
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	srvDesc.Format = nineTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = nineTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(nineTex.Get(), &srvDesc, hDescriptor);
-
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	srvDesc.Format = tenTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = tenTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(tenTex.Get(), &srvDesc, hDescriptor);
+	::OutputDebugStringA(mRenderGraph.Report().c_str());
+}
 
-	// Tree step12
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	//srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	auto desc = treeArrayTex->GetDesc();
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
-	srvDesc.Format = treeArrayTex->GetDesc().Format;
-	srvDesc.Texture2DArray.MostDetailedMip = 0;
-	srvDesc.Texture2DArray.MipLevels = -1;
-	srvDesc.Texture2DArray.FirstArraySlice = 0;
-	srvDesc.Texture2DArray.ArraySize = treeArrayTex->GetDesc().DepthOrArraySize;
-	md3dDevice->CreateShaderResourceView(treeArrayTex.Get(), &srvDesc, hDescriptor);
+// Texture Step12
+void ShapesApp::BuildDescriptorHeaps()
+{
+	MemoryScope memory(MemoryTag::Textures);
 
+	// Slot order within the range is what the materials' DiffuseSrvHeapIndex refers to:
+	// one to four, then the tree sprites' array, then six to ten.
+	const std::string textureNames[] =
+	{
+		"oneTex", "twoTex", "threeTex", "fourTex", "treeArrayTex",
+		"sixTex", "sevenTex", "eightTex", "nineTex", "tenTex"
+	};
 
+	mTextureSrvs = mSrvHeap->AllocatePersistent(_countof(textureNames));
+	for (UINT i = 0; i < _countof(textureNames); ++i)
+	{
+		mSrvHeap->CreateTextureSrv(mTextures[textureNames[i]]->Resource.Get(), mTextureSrvs.Start + i);
+		mTextureSrvSlots[textureNames[i]] = i;
+	}
 }
 
 void ShapesApp::BuildShadersAndInputLayout()
@@ -937,8 +1508,26 @@ void ShapesApp::BuildShadersAndInputLayout()
 		NULL, NULL
 	};
 
-	mShaders["standardVS"] = d3dUtil::CompileShader(L"Shaders\\Default1.hlsl", nullptr, "VS", "vs_5_1");
-	mShaders["opaquePS"] = d3dUtil::CompileShader(L"Shaders\\Default1.hlsl", nullptr, "PS", "ps_5_1");
+	const D3D_SHADER_MACRO bindlessDefines[] =
+	{
+		"BINDLESS", "1",
+		NULL, NULL
+	};
+
+	const D3D_SHADER_MACRO alphaTestBindlessDefines[] =
+	{
+		"ALPHA_TEST", "1",
+		"BINDLESS", "1",
+		NULL, NULL
+	};
+
+	const D3D_SHADER_MACRO* defines = mBindlessTextures ? bindlessDefines : nullptr;
+	const D3D_SHADER_MACRO* treeDefines = mBindlessTextures ? bindlessDefines : nullptr;
+	const D3D_SHADER_MACRO* treePSDefines = mBindlessTextures ? alphaTestBindlessDefines : alphaTestDefines;
+
+	mShaderRequests.clear();
+	mShaderRequests.emplace_back("standardVS", ShaderCacheD3D12::MakeRequest(L"Shaders\\Default1.hlsl", defines, "VS", "vs_5_1"));
+	mShaderRequests.emplace_back("opaquePS", ShaderCacheD3D12::MakeRequest(L"Shaders\\Default1.hlsl", defines, "PS", "ps_5_1"));
 	//mShaders["alphaTestedPS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", alphaTestDefines, "PS", "ps_5_1");
 
 	mInputLayout =
@@ -949,9 +1538,9 @@ void ShapesApp::BuildShadersAndInputLayout()
 	};
 
 	// Tree Step6
-	mShaders["treeSpriteVS"] = d3dUtil::CompileShader(L"Shaders\\TreeSprite.hlsl", nullptr, "VS", "vs_5_1");
-	mShaders["treeSpriteGS"] = d3dUtil::CompileShader(L"Shaders\\TreeSprite.hlsl", nullptr, "GS", "gs_5_1");
-	mShaders["treeSpritePS"] = d3dUtil::CompileShader(L"Shaders\\TreeSprite.hlsl", alphaTestDefines, "PS", "ps_5_1");
+	mShaderRequests.emplace_back("treeSpriteVS", ShaderCacheD3D12::MakeRequest(L"Shaders\\TreeSprite.hlsl", treeDefines, "VS", "vs_5_1"));
+	mShaderRequests.emplace_back("treeSpriteGS", ShaderCacheD3D12::MakeRequest(L"Shaders\\TreeSprite.hlsl", treeDefines, "GS", "gs_5_1"));
+	mShaderRequests.emplace_back("treeSpritePS", ShaderCacheD3D12::MakeRequest(L"Shaders\\TreeSprite.hlsl", treePSDefines, "PS", "ps_5_1"));
 
 	mTreeSpriteInputLayout =
 	{
@@ -962,6 +1551,8 @@ void ShapesApp::BuildShadersAndInputLayout()
 
 void ShapesApp::BuildLandGeometry()
 {
+	MemoryScope memory(MemoryTag::Geometry);
+
 	GeometryGenerator geoGen;
 	GeometryGenerator::MeshData grid = geoGen.CreateGrid(50.0f, 190.0f, 100, 100);
 
@@ -971,7 +1562,8 @@ void ShapesApp::BuildLandGeometry()
 	// sandy looking beaches, grassy low hills, and snow mountain peaks.
 	//
 
-	std::vector<Vertex> vertices(grid.Vertices.size());
+	ScratchScope scratch;
+	ArenaVector<Vertex> vertices(grid.Vertices.size(), ArenaAllocator<Vertex>(scratch.Arena()));
 	for (size_t i = 1; i < grid.Vertices.size(); ++i)
 	{
 		auto& p = grid.Vertices[i].Position;
@@ -983,7 +1575,7 @@ void ShapesApp::BuildLandGeometry()
 
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
 
-	std::vector<std::uint16_t> indices = grid.GetIndices16();
+	const std::vector<std::uint16_t>& indices = grid.GetIndices16();
 	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
 
 	auto geo = std::make_unique<MeshGeometry>();
@@ -995,11 +1587,13 @@ void ShapesApp::BuildLandGeometry()
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
+	auto vbAlloc = mGeometryPool->CreateBuffer(*mStaging, vertices.data(), vbByteSize);
+	geo->VertexBufferGPU = vbAlloc.Resource;
+	geo->VertexBufferOffset = vbAlloc.Offset;
 
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	auto ibAlloc = mGeometryPool->CreateBuffer(*mStaging, indices.data(), ibByteSize);
+	geo->IndexBufferGPU = ibAlloc.Resource;
+	geo->IndexBufferOffset = ibAlloc.Offset;
 
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
@@ -1018,7 +1612,10 @@ void ShapesApp::BuildLandGeometry()
 
 void ShapesApp::BuildWavesGeometry()
 {
-	std::vector<std::uint16_t> indices(3 * mWaves->TriangleCount()); // 3 indices per face
+	MemoryScope memory(MemoryTag::Waves);
+
+	ScratchScope scratch;
+	ArenaVector<std::uint16_t> indices(3 * mWaves->TriangleCount(), ArenaAllocator<std::uint16_t>(scratch.Arena())); // 3 indices per face
 	assert(mWaves->VertexCount() < 0x0000ffff);
 
 	// Iterate over each quad.
@@ -1054,8 +1651,9 @@ void ShapesApp::BuildWavesGeometry()
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	auto ibAlloc = mGeometryPool->CreateBuffer(*mStaging, indices.data(), ibByteSize);
+	geo->IndexBufferGPU = ibAlloc.Resource;
+	geo->IndexBufferOffset = ibAlloc.Offset;
 
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
@@ -1072,43 +1670,111 @@ void ShapesApp::BuildWavesGeometry()
 	mGeometries["waterGeo"] = std::move(geo);
 }
 
-
-void ShapesApp::BuildShapeGeometry()
+// A2_FLAGS=N hangs N flags in rows of eight in front of the maze, 8 by default and
+// none for 0.
+void ShapesApp::BuildCloth()
 {
-	// Geometry Step1
-	GeometryGenerator geoGen;
-	GeometryGenerator::MeshData box = geoGen.CreateBox(1.0f, 1.0f, 1.0f, 3);
-	GeometryGenerator::MeshData box2 = geoGen.CreateBox(1.0f, 1.0f, 1.0f, 3);
-	GeometryGenerator::MeshData cylinder = geoGen.CreateCylinder(0.5f, 0.5f, 3.0, 20, 20);
-	GeometryGenerator::MeshData cylinder2 = geoGen.CreateCylinder(0.5f, 0.5f, 3.0, 20, 20);
-	GeometryGenerator::MeshData cone = geoGen.CreateCone(1.f, 1.f, 40, 6);
-	GeometryGenerator::MeshData wedge = geoGen.CreateWedge(1, 1, 1, 0);
-	GeometryGenerator::MeshData diamond = geoGen.CreateDiamond(1, 2, 1, 0);
+	MemoryScope memory(MemoryTag::Cloth);
 
+	std::uint32_t flagCount = 8;
+	char value[32];
+	if (GetEnvironmentVariableA("A2_FLAGS", value, sizeof(value)) > 0)
+		flagCount = (std::uint32_t)std::strtoul(value, nullptr, 10);
 
-	// Geometry Step2
-	UINT boxVertexOffset = 0;
-	UINT box2VertexOffset = (UINT)box.Vertices.size();
-	UINT cylinderVertexOffset = box2VertexOffset + (UINT)box2.Vertices.size();
-	UINT cylinder2VertexOffset = cylinderVertexOffset + (UINT)cylinder.Vertices.size();
-	UINT coneVertexOffset = cylinder2VertexOffset + (UINT)cylinder2.Vertices.size();
-	UINT wedgeVertexOffset = coneVertexOffset + (UINT)cone.Vertices.size();
-	UINT diamondVertexOffset = wedgeVertexOffset + (UINT)wedge.Vertices.size();
+	mCloth = std::make_unique<ClothSystem>();
+	mFlagPoles.reserve(flagCount);
+	for (std::uint32_t i = 0; i < flagCount; ++i)
+	{
+		const XMFLOAT3 pole(15.0f + 10.0f * (i % 8), 4.2f, -96.0f - 5.0f * (i / 8));
 
+		ClothSystem::ClothDesc desc;
+		desc.Origin = XMFLOAT3(pole.x, pole.y + gFlagPoleHeight, pole.z);
+		mCloth->AddCloth(desc);
+		mFlagPoles.push_back(pole);
+	}
+}
 
-	// Geometry Step3
-	UINT boxIndexOffset = 0;
-	UINT box2IndexOffset = (UINT)box.Indices32.size();
-	UINT cylinderIndexOffset = box2IndexOffset + (UINT)box2.Indices32.size();
-	UINT cylinder2IndexOffset = cylinderIndexOffset + (UINT)cylinder.Indices32.size();
-	UINT coneIndexOffset = cylinder2IndexOffset + (UINT)cylinder2.Indices32.size();
-	UINT wedgeIndexOffset = coneIndexOffset + (UINT)cone.Indices32.size();
-	UINT diamondIndexOffset = wedgeIndexOffset + (UINT)wedge.Indices32.size();
+void ShapesApp::BuildClothGeometry()
+{
+	MemoryScope memory(MemoryTag::Cloth);
 
+	if (mCloth->ClothCount() == 0)
+		return;
 
-	// Geometry Step4
-	SubmeshGeometry boxSubmesh;
-	boxSubmesh.IndexCount = (UINT)box.Indices32.size();
+	std::vector<std::uint32_t> indices;
+	mCloth->BuildIndices(indices);
+
+	UINT vbByteSize = mCloth->VertexCount() * sizeof(Vertex);
+	UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint32_t);
+
+	auto geo = std::make_unique<MeshGeometry>();
+	geo->Name = "clothGeo";
+
+	// Set dynamically.
+	geo->VertexBufferCPU = nullptr;
+	geo->VertexBufferGPU = nullptr;
+
+	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
+	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+
+	auto ibAlloc = mGeometryPool->CreateBuffer(*mStaging, indices.data(), ibByteSize);
+	geo->IndexBufferGPU = ibAlloc.Resource;
+	geo->IndexBufferOffset = ibAlloc.Offset;
+
+	geo->VertexByteStride = sizeof(Vertex);
+	geo->VertexBufferByteSize = vbByteSize;
+	geo->IndexFormat = DXGI_FORMAT_R32_UINT;
+	geo->IndexBufferByteSize = ibByteSize;
+
+	SubmeshGeometry submesh;
+	submesh.IndexCount = (UINT)indices.size();
+	submesh.StartIndexLocation = 0;
+	submesh.BaseVertexLocation = 0;
+
+	geo->DrawArgs["flags"] = submesh;
+
+	mGeometries["clothGeo"] = std::move(geo);
+}
+
+
+void ShapesApp::BuildShapeGeometry()
+{
+	MemoryScope memory(MemoryTag::Geometry);
+
+	// Geometry Step1
+	GeometryGenerator geoGen;
+	GeometryGenerator::MeshData box = geoGen.CreateBox(1.0f, 1.0f, 1.0f, 3);
+	GeometryGenerator::MeshData box2 = geoGen.CreateBox(1.0f, 1.0f, 1.0f, 3);
+	GeometryGenerator::MeshData cylinder = geoGen.CreateCylinder(0.5f, 0.5f, 3.0, 20, 20);
+	GeometryGenerator::MeshData cylinder2 = geoGen.CreateCylinder(0.5f, 0.5f, 3.0, 20, 20);
+	GeometryGenerator::MeshData cone = geoGen.CreateCone(1.f, 1.f, 40, 6);
+	GeometryGenerator::MeshData wedge = geoGen.CreateWedge(1, 1, 1, 0);
+	GeometryGenerator::MeshData diamond = geoGen.CreateDiamond(1, 2, 1, 0);
+
+
+	// Geometry Step2
+	UINT boxVertexOffset = 0;
+	UINT box2VertexOffset = (UINT)box.Vertices.size();
+	UINT cylinderVertexOffset = box2VertexOffset + (UINT)box2.Vertices.size();
+	UINT cylinder2VertexOffset = cylinderVertexOffset + (UINT)cylinder.Vertices.size();
+	UINT coneVertexOffset = cylinder2VertexOffset + (UINT)cylinder2.Vertices.size();
+	UINT wedgeVertexOffset = coneVertexOffset + (UINT)cone.Vertices.size();
+	UINT diamondVertexOffset = wedgeVertexOffset + (UINT)wedge.Vertices.size();
+
+
+	// Geometry Step3
+	UINT boxIndexOffset = 0;
+	UINT box2IndexOffset = (UINT)box.Indices32.size();
+	UINT cylinderIndexOffset = box2IndexOffset + (UINT)box2.Indices32.size();
+	UINT cylinder2IndexOffset = cylinderIndexOffset + (UINT)cylinder.Indices32.size();
+	UINT coneIndexOffset = cylinder2IndexOffset + (UINT)cylinder2.Indices32.size();
+	UINT wedgeIndexOffset = coneIndexOffset + (UINT)cone.Indices32.size();
+	UINT diamondIndexOffset = wedgeIndexOffset + (UINT)wedge.Indices32.size();
+
+
+	// Geometry Step4
+	SubmeshGeometry boxSubmesh;
+	boxSubmesh.IndexCount = (UINT)box.Indices32.size();
 	boxSubmesh.StartIndexLocation = boxIndexOffset;
 	boxSubmesh.BaseVertexLocation = boxVertexOffset;
 
@@ -1153,7 +1819,8 @@ void ShapesApp::BuildShapeGeometry()
 	XMVECTOR vMax = DirectX::XMLoadFloat3(&vMaxf3);
 
 	// Geometry Step6
-	std::vector<Vertex> vertices(totalVertexCount);
+	ScratchScope scratch;
+	ArenaVector<Vertex> vertices(totalVertexCount, ArenaAllocator<Vertex>(scratch.Arena()));
 	UINT k = 0;
 	for (UINT i = 0; i < box.Vertices.size(); ++i, ++k)
 	{
@@ -1286,7 +1953,9 @@ void ShapesApp::BuildShapeGeometry()
 	diamondSubmesh.Bounds = boundsDiamond;
 
 	// Geometry Step7
-	std::vector<std::uint16_t> indices;
+	ArenaVector<std::uint16_t> indices(ArenaAllocator<std::uint16_t>(scratch.Arena()));
+	indices.reserve(box.Indices32.size() + box2.Indices32.size() + cylinder.Indices32.size() + cylinder2.Indices32.size() +
+		cone.Indices32.size() + wedge.Indices32.size() + diamond.Indices32.size());
 	indices.insert(indices.end(), std::begin(box.GetIndices16()), std::end(box.GetIndices16()));
 	indices.insert(indices.end(), std::begin(box2.GetIndices16()), std::end(box2.GetIndices16()));
 	indices.insert(indices.end(), std::begin(cylinder.GetIndices16()), std::end(cylinder.GetIndices16()));
@@ -1308,11 +1977,13 @@ void ShapesApp::BuildShapeGeometry()
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
+	auto vbAlloc = mGeometryPool->CreateBuffer(*mStaging, vertices.data(), vbByteSize);
+	geo->VertexBufferGPU = vbAlloc.Resource;
+	geo->VertexBufferOffset = vbAlloc.Offset;
 
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	auto ibAlloc = mGeometryPool->CreateBuffer(*mStaging, indices.data(), ibByteSize);
+	geo->IndexBufferGPU = ibAlloc.Resource;
+	geo->IndexBufferOffset = ibAlloc.Offset;
 
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
@@ -1336,6 +2007,8 @@ void ShapesApp::BuildShapeGeometry()
 
 void ShapesApp::BuildSkullGeometry()
 {
+	MemoryScope memory(MemoryTag::Geometry);
+
 	std::ifstream fin("Models/skull.txt");
 
 	if (!fin)
@@ -1352,7 +2025,8 @@ void ShapesApp::BuildSkullGeometry()
 	fin >> ignore >> tcount;
 	fin >> ignore >> ignore >> ignore >> ignore;
 
-	std::vector<Vertex> vertices(vcount);
+	ScratchScope scratch;
+	ArenaVector<Vertex> vertices(vcount, ArenaAllocator<Vertex>(scratch.Arena()));
 	for (UINT i = 0; i < vcount; ++i)
 	{
 		fin >> vertices[i].Pos.x >> vertices[i].Pos.y >> vertices[i].Pos.z;
@@ -1383,7 +2057,7 @@ void ShapesApp::BuildSkullGeometry()
 	fin >> ignore;
 	fin >> ignore;
 
-	std::vector<std::int32_t> indices(3 * tcount);
+	ArenaVector<std::int32_t> indices(3 * tcount, ArenaAllocator<std::int32_t>(scratch.Arena()));
 	for (UINT i = 0; i < tcount; ++i)
 	{
 		fin >> indices[i * 3 + 0] >> indices[i * 3 + 1] >> indices[i * 3 + 2];
@@ -1408,11 +2082,13 @@ void ShapesApp::BuildSkullGeometry()
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
+	auto vbAlloc = mGeometryPool->CreateBuffer(*mStaging, vertices.data(), vbByteSize);
+	geo->VertexBufferGPU = vbAlloc.Resource;
+	geo->VertexBufferOffset = vbAlloc.Offset;
 
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	auto ibAlloc = mGeometryPool->CreateBuffer(*mStaging, indices.data(), ibByteSize);
+	geo->IndexBufferGPU = ibAlloc.Resource;
+	geo->IndexBufferOffset = ibAlloc.Offset;
 
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
@@ -1426,12 +2102,28 @@ void ShapesApp::BuildSkullGeometry()
 
 	geo->DrawArgs["skull"] = submesh;
 
-	mGeometries[geo->Name] = std::move(geo);
+	// A reload rebuilds the geometry in place so render items keep pointing at it.  The
+	// caller has waited for the GPU to finish with the old buffers.
+	std::unique_ptr<MeshGeometry>& existing = mGeometries[geo->Name];
+	if (existing != nullptr)
+	{
+		mGeometryPool->Free(mSkullBuffers[0]);
+		mGeometryPool->Free(mSkullBuffers[1]);
+		*existing = std::move(*geo);
+	}
+	else
+	{
+		existing = std::move(geo);
+	}
+	mSkullBuffers[0] = vbAlloc;
+	mSkullBuffers[1] = ibAlloc;
 }
 
 // Tree Step3
 void ShapesApp::BuildTreeSpritesGeometry()
 {
+	MemoryScope memory(MemoryTag::Geometry);
+
 	//step4  (step5 and 6 are in TreeSprite.hlsl)
 	struct TreeSpriteVertex
 	{
@@ -1475,11 +2167,13 @@ void ShapesApp::BuildTreeSpritesGeometry()
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
+	auto vbAlloc = mGeometryPool->CreateBuffer(*mStaging, vertices.data(), vbByteSize);
+	geo->VertexBufferGPU = vbAlloc.Resource;
+	geo->VertexBufferOffset = vbAlloc.Offset;
 
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	auto ibAlloc = mGeometryPool->CreateBuffer(*mStaging, indices.data(), ibByteSize);
+	geo->IndexBufferGPU = ibAlloc.Resource;
+	geo->IndexBufferOffset = ibAlloc.Offset;
 
 	geo->VertexByteStride = sizeof(TreeSpriteVertex);
 	geo->VertexBufferByteSize = vbByteSize;
@@ -1498,6 +2192,8 @@ void ShapesApp::BuildTreeSpritesGeometry()
 
 void ShapesApp::BuildPSOs()
 {
+	MemoryScope memory(MemoryTag::Shaders);
+
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC opaquePsoDesc;
 
 	//
@@ -1528,7 +2224,14 @@ void ShapesApp::BuildPSOs()
 	opaquePsoDesc.SampleDesc.Quality = m4xMsaaState ? (m4xMsaaQuality - 1) : 0;
 	opaquePsoDesc.DSVFormat = mDepthStencilFormat;
 	//ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&opaquePsoDesc, IID_PPV_ARGS(&mOpaquePSO)));
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&opaquePsoDesc, IID_PPV_ARGS(&mPSOs["opaque"])));
+	AddPSO("opaque", opaquePsoDesc, "standardVS", nullptr, "opaquePS");
+
+	//
+	// PSO for cloth, which is seen from both sides.
+	//
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC clothPsoDesc = opaquePsoDesc;
+	clothPsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+	AddPSO("cloth", clothPsoDesc, "standardVS", nullptr, "opaquePS");
 	//
 	// PSO for transparent objects
 	//
@@ -1547,7 +2250,7 @@ void ShapesApp::BuildPSOs()
 	transparencyBlendDesc.LogicOp = D3D12_LOGIC_OP_NOOP;
 	transparencyBlendDesc.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
 	transparentPsoDesc.BlendState.RenderTarget[0] = transparencyBlendDesc;
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&transparentPsoDesc, IID_PPV_ARGS(&mPSOs["transparent"])));
+	AddPSO("transparent", transparentPsoDesc, "standardVS", nullptr, "opaquePS");
 
 	
 
@@ -1591,7 +2294,7 @@ void ShapesApp::BuildPSOs()
 	treeSpritePsoDesc.InputLayout = { mTreeSpriteInputLayout.data(), (UINT)mTreeSpriteInputLayout.size() };
 	treeSpritePsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
 
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&treeSpritePsoDesc, IID_PPV_ARGS(&mPSOs["treeSprites"])));
+	AddPSO("treeSprites", treeSpritePsoDesc, "treeSpriteVS", "treeSpriteGS", "treeSpritePS");
 	// PSO for highlight objects
 	//
 
@@ -1603,20 +2306,109 @@ void ShapesApp::BuildPSOs()
 	// depth test the 2nd time we try and draw it.
 	highlightPsoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS_EQUAL;
 	highlightPsoDesc.BlendState.RenderTarget[0] = transparencyBlendDesc;
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&highlightPsoDesc, IID_PPV_ARGS(&mPSOs["highlight"])));
+	AddPSO("highlight", highlightPsoDesc, "standardVS", nullptr, "opaquePS");
+
+	// Register in name order so the ids, and with them recorded streams, are stable
+	// from run to run.
+	std::vector<std::string> psoNames;
+	for (auto& e : mPSOs)
+		psoNames.push_back(e.first);
+	std::sort(psoNames.begin(), psoNames.end());
+
+	for (auto& name : psoNames)
+		mPipelineIds[name] = mStreamBackend.RegisterPipeline(mPSOs[name].Get());
+	mRootSignatureId = mStreamBackend.RegisterRootSignature(mRootSignature.Get());
+
+	ResolveScenePipelines();
+}
+
+void ShapesApp::ResolveScenePipelines()
+{
+	mOpaquePipeline = mPipelineIds.at("opaque");
+	mClothPipeline = mPipelineIds.at("cloth");
+	mTreeSpritesPipeline = mPipelineIds.at("treeSprites");
+	mHighlightPipeline = mPipelineIds.at("highlight");
+	mOpaquePso = mPSOs.at("opaque").Get();
+
+	auto wireframe = mPSOs.find("opaque_wireframe");
+	const bool hasWireframe = wireframe != mPSOs.end() && wireframe->second != nullptr;
+	mWireframePipeline = hasWireframe ? mPipelineIds.at("opaque_wireframe") : mOpaquePipeline;
+	mWireframePso = hasWireframe ? wireframe->second.Get() : mOpaquePso;
+}
+
+void ShapesApp::AddPSO(const std::string& name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+	const char* vs, const char* gs, const char* ps)
+{
+	PsoBuild& build = mPsoBuilds[name];
+	build.Desc = desc;
+	build.VS = vs != nullptr ? vs : "";
+	build.GS = gs != nullptr ? gs : "";
+	build.PS = ps != nullptr ? ps : "";
+	mPSOs[name] = CreatePSO(build);
+}
+
+ComPtr<ID3D12PipelineState> ShapesApp::CreatePSO(PsoBuild& build)
+{
+	auto bytecode = [this](const std::string& shader)
+	{
+		D3D12_SHADER_BYTECODE stage = {};
+		if (!shader.empty())
+		{
+			ID3DBlob* blob = mShaders[shader].Get();
+			stage = { blob->GetBufferPointer(), blob->GetBufferSize() };
+		}
+		return stage;
+	};
+	build.Desc.VS = bytecode(build.VS);
+	build.Desc.GS = bytecode(build.GS);
+	build.Desc.PS = bytecode(build.PS);
+
+	ComPtr<ID3D12PipelineState> pso;
+	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&build.Desc, IID_PPV_ARGS(&pso)));
+	return pso;
 }
 
 void ShapesApp::BuildFrameResources()
 {
+	MemoryScope memory(MemoryTag::FrameResources);
+
 	for (int i = 0; i < gNumFrameResources; ++i)
 	{
 		mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(),
-			1, (UINT)mAllRitems.size(), (UINT)mMaterials.size(), mWaves->VertexCount()));
+			1, (UINT)mAllRitems.size(), (UINT)mMaterials.size(), mWaves->VertexCount(),
+			std::max<UINT>(1, mCloth->VertexCount()), mTaskPool->ThreadCount()));
+	}
+
+	// Draws recorded before the first UpdateCloth need a buffer to point at.
+	if (mClothRitem != nullptr)
+		mClothRitem->Geo->VertexBufferGPU = mFrameResources[0]->ClothVB->Resource();
+}
+
+void ShapesApp::BuildRecordCommandLists()
+{
+	MemoryScope memory(MemoryTag::FrameResources);
+
+	// Lists are created open; close them so Draw can Reset them like mCommandList.
+	mRecordCmdLists.resize(mTaskPool->ThreadCount());
+	for (UINT i = 0; i < mTaskPool->ThreadCount(); ++i)
+	{
+		ThrowIfFailed(md3dDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT,
+			mFrameResources[0]->RecordCmdListAllocs[i].Get(), nullptr,
+			IID_PPV_ARGS(mRecordCmdLists[i].GetAddressOf())));
+		mRecordCmdLists[i]->Close();
 	}
+
+	ThrowIfFailed(md3dDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT,
+		mFrameResources[0]->PostCmdListAlloc.Get(), nullptr,
+		IID_PPV_ARGS(mPostCmdList.GetAddressOf())));
+	mPostCmdList->Close();
 }
 
 void ShapesApp::BuildMaterials()
 {
+	MemoryScope memory(MemoryTag::RenderItems);
+
+	// MatCBIndex is the material's row in the material table, at most MaxDrawMaterialIndex.
 	auto one = std::make_unique<Material>();
 	one->Name = "one";
 	one->MatCBIndex = 0;
@@ -1711,11 +2503,32 @@ void ShapesApp::BuildMaterials()
 	mMaterials["eight"] = std::move(eight);
 	mMaterials["nine"] = std::move(nine);
 	mMaterials["ten"] = std::move(ten);
+
+	// Resolve the SRV handles once instead of per draw.
+	for (auto& e : mMaterials)
+	{
+		Material* mat = e.second.get();
+		CheckMaterialTexture(*mat);
+		mat->DiffuseSrvGpuHandle = mSrvHeap->GpuHandle(mTextureSrvs.Start + mat->DiffuseSrvHeapIndex);
+	}
+}
+
+// The shaders index the texture range with DiffuseSrvHeapIndex unchecked, so a material
+// pointing past the loaded textures would read another range's descriptors.
+void ShapesApp::CheckMaterialTexture(const Material& mat)const
+{
+	if (mat.DiffuseSrvHeapIndex < 0 || (UINT)mat.DiffuseSrvHeapIndex >= mTextureSrvs.Count)
+		throw std::out_of_range("Material " + mat.Name + " uses texture slot " +
+			std::to_string(mat.DiffuseSrvHeapIndex) + " but only " +
+			std::to_string(mTextureSrvs.Count) + " textures are loaded.");
 }
 
 // Geometry Step9
 void ShapesApp::BuildRenderItems()
 {
+	MemoryScope memory(MemoryTag::RenderItems);
+
+	// ObjCBIndex is the item's row in the object table, at most MaxDrawObjectIndex.
 	// Base 1
 	auto boxRitem = std::make_unique<RenderItem>();
 	XMStoreFloat4x4(&boxRitem->World, XMMatrixScaling(210.0f, 0.4f, 210.0f) * XMMatrixTranslation(35.0f, 0.4f, -40.0f));
@@ -2001,6 +2814,8 @@ void ShapesApp::BuildRenderItems()
 	treeSpritesRitem->StartIndexLocation = treeSpritesRitem->Geo->DrawArgs["points"].StartIndexLocation;
 	treeSpritesRitem->BaseVertexLocation = treeSpritesRitem->Geo->DrawArgs["points"].BaseVertexLocation;
 
+	mTreeSpritesRitem = treeSpritesRitem.get();
+	mTreeSpriteIndexCount = treeSpritesRitem->IndexCount;
 	mRitemLayer[(int)RenderLayer::AlphaTestedTreeSprites].push_back(treeSpritesRitem.get());
 	mAllRitems.push_back(std::move(treeSpritesRitem));
 
@@ -2349,45 +3164,377 @@ void ShapesApp::BuildRenderItems()
 	mRitemLayer[(int)RenderLayer::Highlight].push_back(pickedRitem.get());
 	mAllRitems.push_back(std::move(pickedRitem));
 
+	// Flags, one item for all of them, and their poles.
+	if (mCloth->ClothCount() > 0)
+	{
+		auto clothRitem = std::make_unique<RenderItem>();
+		clothRitem->ObjCBIndex = (UINT)mAllRitems.size();
+		clothRitem->Mat = mMaterials["four"].get();
+		clothRitem->Geo = mGeometries["clothGeo"].get();
+		clothRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		clothRitem->IndexCount = clothRitem->Geo->DrawArgs["flags"].IndexCount;
+		clothRitem->StartIndexLocation = clothRitem->Geo->DrawArgs["flags"].StartIndexLocation;
+		clothRitem->BaseVertexLocation = clothRitem->Geo->DrawArgs["flags"].BaseVertexLocation;
+		mClothRitem = clothRitem.get();
+		mRitemLayer[(int)RenderLayer::Cloth].push_back(clothRitem.get());
+		mAllRitems.push_back(std::move(clothRitem));
+
+		MeshGeometry* shapeGeo = mGeometries["shapeGeo"].get();
+		const SubmeshGeometry& cylinder = shapeGeo->DrawArgs["cylinder"];
+		for (const XMFLOAT3& pole : mFlagPoles)
+		{
+			auto poleRitem = std::make_unique<RenderItem>();
+			const XMMATRIX world = XMMatrixScaling(0.3f, gFlagPoleHeight / 3.0f, 0.3f) *
+				XMMatrixTranslation(pole.x, pole.y + 0.5f * gFlagPoleHeight, pole.z);
+			XMStoreFloat4x4(&poleRitem->World, world);
+			poleRitem->ObjCBIndex = (UINT)mAllRitems.size();
+			poleRitem->Mat = mMaterials["three"].get();
+			poleRitem->Geo = shapeGeo;
+			poleRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+			poleRitem->IndexCount = cylinder.IndexCount;
+			poleRitem->StartIndexLocation = cylinder.StartIndexLocation;
+			poleRitem->BaseVertexLocation = cylinder.BaseVertexLocation;
+			cylinder.Bounds.Transform(poleRitem->Bounds, world);
+			BoundingSphere::CreateFromBoundingBox(poleRitem->CullSphere, poleRitem->Bounds);
+			mRitemLayer[(int)RenderLayer::Opaque].push_back(poleRitem.get());
+			mAllRitems.push_back(std::move(poleRitem));
+		}
+	}
+
+	BuildStressItems();
+
+	// Draws address the object and material tables through one packed root constant.
+	for (const auto& ri : mAllRitems)
+		CheckDrawIndices(ri->ObjCBIndex, (UINT)ri->Mat->MatCBIndex);
+
 	// All the render items are opaque.
 	// Tree Step28
 	/*for (auto& e : mAllRitems)
 		mOpaqueRitems.push_back(e.get());*/
 }
 
-void ShapesApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
+// A2_STRESS_ITEMS=N adds N generated items to the scene for scaling tests, laid out by
+// A2_STRESS_LAYOUT (maze, forest, instanced or mixed; mixed by default) and shaded with
+// A2_STRESS_MATERIALS tinted copies of the demo's materials (16 by default).
+void ShapesApp::BuildStressItems()
 {
-	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
-	UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
+	char value[64];
+	if (GetEnvironmentVariableA("A2_STRESS_ITEMS", value, sizeof(value)) == 0 || value[0] == '\0')
+		return;
 
-	auto objectCB = mCurrFrameResource->ObjectCB->Resource();
-	auto matCB = mCurrFrameResource->MaterialCB->Resource();
+	StressSceneDesc desc;
+	const unsigned long long itemCount = std::strtoull(value, nullptr, 10);
+	if (GetEnvironmentVariableA("A2_STRESS_LAYOUT", value, sizeof(value)) > 0 && !ParseStressLayout(value, desc.Layout))
+		::OutputDebugStringA("A2_STRESS_LAYOUT: unknown layout, using mixed\n");
+
+	std::uint32_t materialCount = 16;
+	if (GetEnvironmentVariableA("A2_STRESS_MATERIALS", value, sizeof(value)) > 0)
+		materialCount = std::max<std::uint32_t>(1, (std::uint32_t)std::strtoul(value, nullptr, 10));
+
+	// Every item and material must fit in a draw's packed root constant.  Reject an
+	// oversized request here rather than after building a scene that cannot be drawn.
+	const std::uint64_t maxItems = (std::uint64_t)MaxDrawObjectIndex + 1 - mAllRitems.size();
+	const std::uint64_t maxMaterials = (std::uint64_t)MaxDrawMaterialIndex + 1 - mMaterials.size();
+	if (itemCount > maxItems)
+		throw std::out_of_range("A2_STRESS_ITEMS=" + std::to_string(itemCount) +
+			" is more than the " + std::to_string(maxItems) + " items the draw tables have room for.");
+	if (materialCount > maxMaterials)
+		throw std::out_of_range("A2_STRESS_MATERIALS=" + std::to_string(materialCount) +
+			" is more than the " + std::to_string(maxMaterials) + " materials the draw tables have room for.");
+	desc.ItemCount = (std::uint32_t)itemCount;
+
+	// The maze layout builds its walls from mesh 0, so the box goes first.
+	MeshGeometry* geo = mGeometries["shapeGeo"].get();
+	const char* meshNames[] = { "box", "cylinder", "cone", "wedge", "diamond" };
+	for (const char* name : meshNames)
+		desc.MeshBounds.push_back(geo->DrawArgs[name].Bounds);
+
+	// Variants of the existing materials in name order, so a run is repeatable.
+	std::vector<Material*> bases;
+	for (auto& e : mMaterials)
+		bases.push_back(e.second.get());
+	std::sort(bases.begin(), bases.end(), [](const Material* a, const Material* b) { return a->Name < b->Name; });
 
-	// For each render item...
-	for (size_t i = 0; i < ritems.size(); ++i)
+	Pcg32 rng(desc.Seed);
+	std::vector<Material*> materials;
+	for (std::uint32_t i = 0; i < materialCount; ++i)
 	{
-		auto ri = ritems[i];
+		auto mat = std::make_unique<Material>(*bases[i % bases.size()]);
+		mat->Name = "stress" + std::to_string(i);
+		mat->MatCBIndex = (int)mMaterials.size(); // at most MaxDrawMaterialIndex, checked above
+		CheckMaterialTexture(*mat);
+		mat->NumFramesDirty = gNumFrameResources;
+		mat->DiffuseAlbedo.x *= rng.NextFloat(0.5f, 1.0f);
+		mat->DiffuseAlbedo.y *= rng.NextFloat(0.5f, 1.0f);
+		mat->DiffuseAlbedo.z *= rng.NextFloat(0.5f, 1.0f);
+		materials.push_back(mat.get());
+		mMaterials[mat->Name] = std::move(mat);
+	}
+	desc.MaterialCount = materialCount;
+
+	StressScene scene;
+	GenerateStressScene(desc, scene);
 
-		cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
-		cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
-		cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
+	auto& opaque = mRitemLayer[(int)RenderLayer::Opaque];
+	mAllRitems.reserve(mAllRitems.size() + scene.ItemCount());
+	opaque.reserve(opaque.size() + scene.ItemCount());
+	for (std::uint32_t i = 0; i < scene.ItemCount(); ++i)
+	{
+		const SubmeshGeometry& submesh = geo->DrawArgs[meshNames[scene.Meshes[i]]];
+
+		auto ri = std::make_unique<RenderItem>();
+		ri->World = scene.Worlds[i];
+		ri->ObjCBIndex = (UINT)mAllRitems.size(); // at most MaxDrawObjectIndex, checked above
+		ri->Geo = geo;
+		ri->Mat = materials[scene.Materials[i]];
+		ri->IndexCount = submesh.IndexCount;
+		ri->StartIndexLocation = submesh.StartIndexLocation;
+		ri->BaseVertexLocation = submesh.BaseVertexLocation;
+		ri->Bounds = scene.WorldBounds[i];
+		BoundingSphere::CreateFromBoundingBox(ri->CullSphere, scene.WorldBounds[i]);
+		opaque.push_back(ri.get());
+		mAllRitems.push_back(std::move(ri));
+	}
+
+	::OutputDebugStringA(("Stress scene: " + std::to_string(scene.ItemCount()) + " items, " +
+		std::to_string(materialCount) + " materials\n").c_str());
+}
+
+// Clears the targets and records the scene.  The render graph has already put the
+// back buffer and depth buffer in the right states.
+void ShapesApp::DrawScenePass(ID3D12GraphicsCommandList* cmdList)
+{
+	PROFILE_ZONE("DrawScenePass");
+
+	// Clear the back buffer and depth buffer.
+	cmdList->ClearRenderTargetView(CurrentBackBufferView(), Colors::Black, 0, nullptr);
+	cmdList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
+
+	BuildSceneDrawList();
+	ParallelRecorder::Partition(mSceneDrawCosts, mTaskPool->ThreadCount(), gMinDrawsPerRecordRange, mSceneRanges);
+
+	auto record = [this](CommandStream& stream, std::uint32_t begin, std::uint32_t end)
+	{
+		RecordSceneRange(stream, begin, end);
+	};
+
+	if (mSceneRanges.size() <= 1)
+	{
+		SetSceneTargets(cmdList);
+		mSceneRecorder->Record(mSceneRanges, record, [&](const CommandStream& stream, std::uint32_t)
+		{
+			mStreamBackend.Execute(stream, cmdList);
+		});
+	}
+	else
+	{
+		// Each range is recorded and translated on one thread, into its own list.
+		mSceneRecorder->Record(mSceneRanges, record, [this](const CommandStream& stream, std::uint32_t range)
+		{
+			auto alloc = mCurrFrameResource->RecordCmdListAllocs[range].Get();
+			auto rangeCmdList = mRecordCmdLists[range].Get();
+
+			ThrowIfFailed(alloc->Reset());
+			ThrowIfFailed(rangeCmdList->Reset(alloc, nullptr));
+			SetSceneTargets(rangeCmdList);
+			mStreamBackend.Execute(stream, rangeCmdList);
+			ThrowIfFailed(rangeCmdList->Close());
+		});
+
+		// The clears and barriers before this pass go first, then the ranges in order,
+		// then whatever the graph records after the pass.
+		ThrowIfFailed(cmdList->Close());
+		mSubmitLists.push_back(cmdList);
+		for (std::uint32_t i = 0; i < mSceneRecorder->StreamCount(); ++i)
+			mSubmitLists.push_back(mRecordCmdLists[i].Get());
+
+		ThrowIfFailed(mCurrFrameResource->PostCmdListAlloc->Reset());
+		ThrowIfFailed(mPostCmdList->Reset(mCurrFrameResource->PostCmdListAlloc.Get(), nullptr));
+		mRenderGraphBackend->SetCommandList(mPostCmdList.Get());
+	}
+
+#if defined(DEBUG) || defined(_DEBUG)
+	// Catch draws recorded without the state they need before the debug layer does.
+	for (std::uint32_t i = 0; i < mSceneRecorder->StreamCount(); ++i)
+	{
+		NullCommandBackend validator;
+		if (!validator.Execute(mSceneRecorder->GetStream(i)))
+			::OutputDebugStringA(("Scene stream " + std::to_string(i) + ": " + validator.FirstError() + "\n").c_str());
+	}
+#endif
 
-		// Textures Step18
-		CD3DX12_GPU_DESCRIPTOR_HANDLE tex(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-		tex.Offset(ri->Mat->DiffuseSrvHeapIndex, mCbvSrvDescriptorSize);
+	if (!mSoftwareFramePath.empty())
+	{
+		RenderSoftwareFrame();
+		mSoftwareFramePath.clear();
+	}
+}
+
+// Replays this frame's scene streams through the software rasterizer.  The streams
+// carry GPU addresses, so every buffer they bind is mapped to its CPU copy first:
+// meshes to their system-memory blobs, the per-frame buffers to their mapped upload
+// heaps, which already hold this frame's data.
+void ShapesApp::RenderSoftwareFrame()
+{
+	PROFILE_ZONE("RenderSoftwareFrame");
+
+	SoftwareRasterizer rasterizer;
+	SoftwareCommandBackend backend(rasterizer);
+
+	for (auto& e : mGeometries)
+	{
+		const MeshGeometry* geo = e.second.get();
+		if (geo->VertexBufferCPU != nullptr)
+			backend.MapMemory(geo->VertexBufferView().BufferLocation, geo->VertexBufferCPU->GetBufferPointer(), geo->VertexBufferByteSize);
+		if (geo->IndexBufferCPU != nullptr)
+			backend.MapMemory(geo->IndexBufferView().BufferLocation, geo->IndexBufferCPU->GetBufferPointer(), geo->IndexBufferByteSize);
+	}
+
+	auto mapUploadBuffer = [&backend](auto& buffer)
+	{
+		backend.MapMemory(buffer->Resource()->GetGPUVirtualAddress(), buffer->MappedData(), buffer->Resource()->GetDesc().Width);
+	};
+	mapUploadBuffer(mCurrFrameResource->WavesVB);
+	mapUploadBuffer(mCurrFrameResource->ClothVB);
+	mapUploadBuffer(mCurrFrameResource->PassCB);
+	mapUploadBuffer(mCurrFrameResource->MaterialBuffer);
+	mapUploadBuffer(mCurrFrameResource->ObjectBuffer);
+
+	// Only the opaque pass runs Default1; tree sprites (points), the two-sided cloth
+	// and the blended highlight are skipped and show up in the backend's stats.
+	DefaultSoftwareProgram program({ mOpaquePipeline });
+
+	const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	rasterizer.BeginFrame((std::uint32_t)mClientWidth, (std::uint32_t)mClientHeight, clearColor);
+	for (std::uint32_t i = 0; i < mSceneRecorder->StreamCount(); ++i)
+	{
+		if (!backend.Execute(mSceneRecorder->GetStream(i), program))
+			::OutputDebugStringA(("Software frame: scene stream " + std::to_string(i) + " is corrupt\n").c_str());
+	}
+	rasterizer.Resolve(mTaskPool.get());
+
+	const bool written = rasterizer.WritePpm(mSoftwareFramePath);
+	::OutputDebugStringA(("Software frame " + std::string(written ? "written to " : "could not be written to ") +
+		mSoftwareFramePath + "\n  " + backend.StatsString() + "\n  " + rasterizer.StatsString() + "\n").c_str());
+}
+
+// State every scene command list needs before its first draw.
+void ShapesApp::SetSceneTargets(ID3D12GraphicsCommandList* cmdList)
+{
+	cmdList->RSSetViewports(1, &mScreenViewport);
+	cmdList->RSSetScissorRects(1, &mScissorRect);
+
+	// Specify the buffers we are going to render to.
+	cmdList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
+
+	// Texture Step5
+	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvHeap->Heap() };
+	cmdList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+}
+
+// Flattens the scene layers into one draw list in submission order.  Costs count the
+// commands each draw is expected to emit, so ranges balance recording work rather
+// than draw counts.
+void ShapesApp::BuildSceneDrawList()
+{
+	mSceneDrawCosts.clear();
+
+	// Tree step29, step13
+	const std::pair<RenderLayer, std::uint32_t> layers[] =
+	{
+		{ RenderLayer::Opaque, mIsWireframe ? mWireframePipeline : mOpaquePipeline },
+		{ RenderLayer::Cloth, mClothPipeline },
+		{ RenderLayer::AlphaTestedTreeSprites, mTreeSpritesPipeline },
+		{ RenderLayer::Highlight, mHighlightPipeline },
+	};
+
+	std::size_t drawCount = 0;
+	for (auto& layer : layers)
+		drawCount += mRitemLayer[(int)layer.first].size();
+
+	mSceneDraws = ArenaVector<SceneDraw>(ArenaAllocator<SceneDraw>(mCurrFrameResource->Arena));
+	mSceneDraws.reserve(drawCount);
+
+	const MeshGeometry* prevGeo = nullptr;
+	std::uint32_t prevPipeline = ~0u;
+	for (auto& layer : layers)
+	{
+		for (auto ri : mRitemLayer[(int)layer.first])
+		{
+			if (ri->CullSphere.Radius > 0.0f && mDrawDistance < MathHelper::Infinity)
+			{
+				const float distance = XMVectorGetX(XMVector3Length(
+					XMVectorSubtract(XMLoadFloat3(&ri->CullSphere.Center), XMLoadFloat3(&mRenderEyePosW))));
+				if (distance - ri->CullSphere.Radius > mDrawDistance)
+					continue;
+			}
+
+			SceneDraw draw;
+			draw.Item = ri;
+			draw.Pipeline = layer.second;
+			mSceneDraws.push_back(draw);
+
+			std::uint32_t cost = 2;
+			if (ri->Geo != prevGeo)
+				cost += 2;
+			if (layer.second != prevPipeline)
+				cost += 1;
+			mSceneDrawCosts.push_back(cost);
+
+			prevGeo = ri->Geo;
+			prevPipeline = layer.second;
+		}
+	}
+}
+
+// Records mSceneDraws[begin, end) with all the root state it needs, so ranges can be
+// recorded on any thread and in any order.  Only reads state that is fixed while the
+// frame records.
+void ShapesApp::RecordSceneRange(CommandStream& stream, std::uint32_t begin, std::uint32_t end)
+{
+	PROFILE_ZONE("RecordSceneRange");
+
+	stream.Reset();
+
+	stream.SetRootSignature(mRootSignatureId);
+
+	// One table covering every texture; materials pick theirs by index.
+	if (mBindlessTextures)
+		stream.SetRootTable(0, mSrvHeap->GpuHandle(0).ptr);
+
+	auto passCB = mCurrFrameResource->PassCB->Resource();
+	stream.SetRootCbv(2, passCB->GetGPUVirtualAddress());
 
-		D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex * objCBByteSize;
-		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + ri->Mat->MatCBIndex * matCBByteSize;
+	auto matBuffer = mCurrFrameResource->MaterialBuffer->Resource();
+	stream.SetRootSrv(3, matBuffer->GetGPUVirtualAddress());
 
-		// Textures Step19
-		cmdList->SetGraphicsRootDescriptorTable(0, tex);
-		cmdList->SetGraphicsRootConstantBufferView(1, objCBAddress);
-		cmdList->SetGraphicsRootConstantBufferView(3, matCBAddress);
+	auto objectBuffer = mCurrFrameResource->ObjectBuffer->Resource();
+	stream.SetRootSrv(4, objectBuffer->GetGPUVirtualAddress());
 
-		cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+	for (std::uint32_t i = begin; i < end; ++i)
+	{
+		stream.SetPipeline(mSceneDraws[i].Pipeline);
+		DrawRenderItem(stream, mSceneDraws[i].Item);
 	}
 }
 
+void ShapesApp::DrawRenderItem(CommandStream& stream, const RenderItem* ri)
+{
+	// Items sharing a mesh only bind it once; the stream drops the repeats.
+	auto vbv = ri->Geo->VertexBufferView();
+	auto ibv = ri->Geo->IndexBufferView();
+	stream.SetVertexBuffer(vbv.BufferLocation, vbv.SizeInBytes, vbv.StrideInBytes);
+	stream.SetIndexBuffer(ibv.BufferLocation, ibv.SizeInBytes, ibv.Format);
+	stream.SetPrimitiveTopology(ri->PrimitiveType);
+
+	// Textures Step19
+	if (!mBindlessTextures)
+		stream.SetRootTable(0, ri->Mat->DiffuseSrvGpuHandle.ptr);
+	stream.SetRootConstant(1, PackDrawIndices(ri->ObjCBIndex, ri->Mat->MatCBIndex));
+
+	stream.DrawIndexed(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+}
+
 // Texture Step20
 std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> ShapesApp::GetStaticSamplers()
 {
@@ -2467,6 +3614,8 @@ XMFLOAT3 ShapesApp::GetHillsNormal(float x, float z)const
 
 void ShapesApp::MazeCollision(int sx, int sy)
 {
+	PROFILE_ZONE("MazeCollision");
+
 	XMFLOAT4X4 P = mCamera.GetProj4x4f();   ////XMMatrixPerspectiveFovLH(mFovY, mAspect, mNearZ, mFarZ);
 
 
@@ -2582,6 +3731,8 @@ void ShapesApp::MazeCollision(int sx, int sy)
 
 void ShapesApp::SimpleCollision()
 {
+	PROFILE_ZONE("SimpleCollision");
+
 	/*BoundingBox cameraBounds;
 	cameraBounds.Center = mCamera.GetPosition3f();
 	cameraBounds.Extents = XMFLOAT3(mCamera.GetPosition3f().x + 2.0f, mCamera.GetPosition3f().y + 2.0f, mCamera.GetPosition3f().z + 2.0f);
@@ -2596,7 +3747,7 @@ void ShapesApp::SimpleCollision()
 		}
 	}*/
 
-	auto items = mRitemLayer[(int)RenderLayer::Opaque];
+	const auto& items = mRitemLayer[(int)RenderLayer::Opaque];
 	for (auto renderItem : items)
 	{
 		float distance = 1.0f;
@@ -2611,3 +3762,508 @@ void ShapesApp::SimpleCollision()
 	}
 }
 
+void ShapesApp::BuildMetrics()
+{
+	mAppMetrics.Frames = mMetrics.AddCounter("a2_frames_total", "Frames presented.");
+
+	const char* quantiles[3] = { "0.5", "0.9", "0.99" };
+	for (std::uint32_t m = 0; m < FrameMetrics::MetricCount; ++m)
+	{
+		for (int q = 0; q < 3; ++q)
+		{
+			mAppMetrics.FramePercentiles[m][q] = mMetrics.AddGauge("a2_frame_milliseconds",
+				"Frame timing percentiles since startup, by component.",
+				std::string("component=\"") + FrameMetrics::MetricName((FrameMetrics::Metric)m) +
+				"\",quantile=\"" + quantiles[q] + "\"");
+		}
+	}
+
+	mAppMetrics.WaveUpdateMs = mMetrics.AddGauge("a2_wave_update_milliseconds", "Time of the last Waves::Update.");
+	mAppMetrics.WaveUpdateSeconds = mMetrics.AddCounter("a2_wave_update_seconds_total", "Time spent in Waves::Update.");
+	mAppMetrics.ClothUpdateMs = mMetrics.AddGauge("a2_cloth_update_milliseconds", "Time of the last ClothSystem::Update.");
+	mAppMetrics.ClothUpdateSeconds = mMetrics.AddCounter("a2_cloth_update_seconds_total", "Time spent in ClothSystem::Update.");
+	mAppMetrics.SceneDraws = mMetrics.AddGauge("a2_scene_draws", "Draw calls in the last scene pass.");
+	mAppMetrics.SceneCommands = mMetrics.AddGauge("a2_scene_commands", "Commands recorded in the last scene pass.");
+	mAppMetrics.StateChanges = mMetrics.AddGauge("a2_scene_state_changes", "Binding commands recorded in the last scene pass.");
+	mAppMetrics.RedundantCommands = mMetrics.AddGauge("a2_scene_redundant_commands", "Binding commands dropped as redundant in the last scene pass.");
+	mAppMetrics.RenderItems = mMetrics.AddGauge("a2_render_items", "Render items that exist.");
+	mAppMetrics.CulledRatio = mMetrics.AddGauge("a2_render_items_culled_ratio", "Fraction of render items not drawn in the last scene pass.");
+	mAppMetrics.FrameAllocations = mMetrics.AddGauge("a2_frame_allocations", "Heap allocations in the last checked frame.");
+
+	const char* kinds[2] = { "cpu", "gpu" };
+	for (int t = 0; t < (int)MemoryTag::Count; ++t)
+	{
+		for (int k = 0; k < 2; ++k)
+		{
+			mAppMetrics.MemoryBytes[t][k] = mMetrics.AddGauge("a2_memory_bytes",
+				"Memory by subsystem; cpu is C++ heap, gpu is committed resources.",
+				std::string("subsystem=\"") + MemoryTracker::TagName((MemoryTag)t) + "\",kind=\"" + kinds[k] + "\"");
+		}
+	}
+
+	char port[16] = {};
+	if (GetEnvironmentVariableA("A2_METRICS_PORT", port, sizeof(port)) > 0 && port[0] != '\0')
+	{
+		mMetricsServer = std::make_unique<MetricsServer>(mMetrics);
+		if (mMetricsServer->StartTcp((std::uint16_t)std::strtoul(port, nullptr, 10)))
+			::OutputDebugStringA(("Metrics on 127.0.0.1:" + std::to_string(mMetricsServer->Port()) + "\n").c_str());
+		else
+			::OutputDebugStringA("Could not start the metrics server\n");
+	}
+}
+
+// Copies this frame's numbers into the registry.  Only atomic stores; a scrape never
+// holds the frame up.
+void ShapesApp::PublishMetrics()
+{
+	mAppMetrics.Frames->Add(1.0);
+
+	std::uint32_t commands = 0;
+	std::uint32_t redundant = 0;
+	for (std::uint32_t i = 0; i < mSceneRecorder->StreamCount(); ++i)
+	{
+		commands += mSceneRecorder->GetStream(i).CommandCount();
+		redundant += mSceneRecorder->GetStream(i).RedundantCommandsSkipped();
+	}
+
+	const double draws = (double)mSceneDraws.size();
+	mAppMetrics.SceneDraws->Set(draws);
+	mAppMetrics.SceneCommands->Set(commands);
+	mAppMetrics.StateChanges->Set(commands - draws);
+	mAppMetrics.RedundantCommands->Set(redundant);
+	mAppMetrics.RenderItems->Set((double)mAllRitems.size());
+	mAppMetrics.CulledRatio->Set(mAllRitems.empty() ? 0.0 : 1.0 - draws / mAllRitems.size());
+
+	// Percentiles walk the histograms, so refresh them about once a second.
+	if (mFrameMetrics.FrameCount() % 60 != 1)
+		return;
+
+	const double percents[3] = { 50.0, 90.0, 99.0 };
+	for (std::uint32_t m = 0; m < FrameMetrics::MetricCount; ++m)
+	{
+		for (int q = 0; q < 3; ++q)
+			mAppMetrics.FramePercentiles[m][q]->Set(mFrameMetrics.PercentileMs((FrameMetrics::Metric)m, percents[q]));
+	}
+
+	// The pool and staging heaps grow and shrink while running; the rest is fixed.
+	auto staging = mStaging->GetStats();
+	MemoryTracker::SetGpuBytes(MemoryTag::Geometry, (std::int64_t)mGeometryPool->GetStats().ReservedBytes);
+	MemoryTracker::SetGpuBytes(MemoryTag::UploadHeaps, (std::int64_t)(staging.Ring.Capacity + staging.DeferredBytes));
+
+	for (int t = 0; t < (int)MemoryTag::Count; ++t)
+	{
+		auto stats = MemoryTracker::GetStats((MemoryTag)t);
+		mAppMetrics.MemoryBytes[t][0]->Set((double)stats.CpuBytes);
+		mAppMetrics.MemoryBytes[t][1]->Set((double)stats.GpuBytes);
+	}
+}
+
+// GPU memory of the resources created at startup, charged to the subsystem that owns
+// them.  Geometry and upload heaps change at run time and are refreshed by
+// PublishMetrics.
+void ShapesApp::AccountGpuMemory()
+{
+	std::int64_t textureBytes = 0;
+	for (auto& e : mTextures)
+	{
+		auto desc = e.second->Resource->GetDesc();
+		textureBytes += (std::int64_t)md3dDevice->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+	}
+	MemoryTracker::SetGpuBytes(MemoryTag::Textures, textureBytes);
+
+	std::int64_t frameBytes = 0;
+	for (auto& frame : mFrameResources)
+	{
+		frameBytes += (std::int64_t)frame->PassCB->Resource()->GetDesc().Width;
+		frameBytes += (std::int64_t)frame->MaterialBuffer->Resource()->GetDesc().Width;
+		frameBytes += (std::int64_t)frame->ObjectBuffer->Resource()->GetDesc().Width;
+		frameBytes += (std::int64_t)frame->WavesVB->Resource()->GetDesc().Width;
+		frameBytes += (std::int64_t)frame->ClothVB->Resource()->GetDesc().Width;
+	}
+	MemoryTracker::SetGpuBytes(MemoryTag::FrameResources, frameBytes);
+
+	auto staging = mStaging->GetStats();
+	MemoryTracker::SetGpuBytes(MemoryTag::Geometry, (std::int64_t)mGeometryPool->GetStats().ReservedBytes);
+	MemoryTracker::SetGpuBytes(MemoryTag::UploadHeaps, (std::int64_t)(staging.Ring.Capacity + staging.DeferredBytes));
+}
+
+void ShapesApp::BuildAllocationCheck()
+{
+	// Long enough for the staging ring, descriptor ranges and per-frame vectors to reach
+	// their steady-state sizes.
+	const std::uint32_t warmupFrames = 120;
+
+	char frames[16] = {};
+	if (GetEnvironmentVariableA("A2_ALLOC_CHECK_FRAMES", frames, sizeof(frames)) > 0 && frames[0] != '\0')
+		mAllocationCheckFrames = std::strtoull(frames, nullptr, 10);
+
+#if defined(DEBUG) || defined(_DEBUG)
+	const bool check = true;
+#else
+	const bool check = mAllocationCheckFrames > 0;
+#endif
+	if (check)
+		mAllocationCheck = std::make_unique<FrameAllocationCheck>(warmupFrames);
+}
+
+void ShapesApp::BuildQualityGovernor()
+{
+	char budget[32] = {};
+	if (GetEnvironmentVariableA("A2_FRAME_BUDGET_MS", budget, sizeof(budget)) == 0 || budget[0] == '\0')
+		return;
+
+	QualityGovernor::Config config;
+	config.BudgetMs = std::strtod(budget, nullptr);
+	if (!(config.BudgetMs > 0.0))
+	{
+		::OutputDebugStringA("A2_FRAME_BUDGET_MS must be a positive number of milliseconds\n");
+		return;
+	}
+
+	// Everything starts at full quality.  Trees and lights are what players notice
+	// most, so they are given up last; the costs are only first guesses.
+	struct KnobInit { QualityKnob Knob; const char* Name; std::int32_t Min; std::int32_t Max; double CostMs; double Priority; };
+	const KnobInit knobs[QualityKnobCount] =
+	{
+		{ WaveRateKnob, "wave_rate", 0, 3, 0.3, 1.0 },
+		{ TreeDensityKnob, "tree_density", 1, 4, 0.2, 2.0 },
+		{ LocalLightsKnob, "local_lights", 0, 8, 0.1, 1.5 },
+		{ DrawDistanceKnob, "draw_distance", 0, 4, 0.5, 1.0 },
+		{ ClothIterationsKnob, "cloth_iterations", 1, 3, 0.1, 0.5 },
+	};
+
+	mQualityGovernor = std::make_unique<QualityGovernor>(config);
+	for (const KnobInit& k : knobs)
+	{
+		QualityGovernor::KnobDesc desc;
+		desc.Name = k.Name;
+		desc.MinLevel = k.Min;
+		desc.MaxLevel = k.Max;
+		desc.Level = k.Max;
+		desc.CostMsPerLevel = k.CostMs;
+		desc.Priority = k.Priority;
+		const QualityGovernor::Knob knob = mQualityGovernor->AddKnob(desc);
+		assert(knob == k.Knob);
+
+		mQualityLevelMetrics[knob] = mMetrics.AddGauge("a2_quality_level",
+			"Level of each workload the quality governor scales; higher is better quality.",
+			std::string("knob=\"") + k.Name + "\"");
+	}
+
+	ApplyQualityLevels();
+}
+
+// A2_PACING=Hz renders at a fixed rate; A2_PACING=ondemand renders only after input
+// or a camera change, and otherwise once a second.
+void ShapesApp::BuildFramePacing()
+{
+	char pacing[32] = {};
+	if (GetEnvironmentVariableA("A2_PACING", pacing, sizeof(pacing)) == 0 || pacing[0] == '\0')
+		return;
+
+	FramePacer::Config config;
+	if (!FramePacer::ParseMode(pacing, config))
+	{
+		::OutputDebugStringA("A2_PACING must be unlimited, ondemand or a rate in Hz\n");
+		return;
+	}
+
+	// The waves keep moving without input; show them at a low rate.
+	if (config.PacingMode == FramePacer::Mode::OnDemand)
+		config.IdleIntervalNs = GameTimer::TicksPerSecond;
+	mFramePacer.SetConfig(config);
+
+	// Paced frame times include the wait for the next frame, so the governor would
+	// read them as load.
+	if (mQualityGovernor != nullptr && config.PacingMode != FramePacer::Mode::Unlimited)
+	{
+		::OutputDebugStringA("A2_FRAME_BUDGET_MS is ignored while A2_PACING paces frames\n");
+		mQualityGovernor.reset();
+	}
+}
+
+void ShapesApp::BuildHotReload()
+{
+	char hotReload[8] = {};
+	if (GetEnvironmentVariableA("A2_HOT_RELOAD", hotReload, sizeof(hotReload)) == 0 || hotReload[0] != '1')
+		return;
+
+	for (auto& e : mTextures)
+	{
+		char file[MAX_PATH];
+		WideCharToMultiByte(CP_ACP, 0, e.second->Filename.c_str(), -1, file, MAX_PATH, nullptr, nullptr);
+		mAssetDependencies.SetFiles(mAssetDependencies.AddAsset(e.first, TextureAsset), { file });
+	}
+
+	mAssetDependencies.SetFiles(mAssetDependencies.AddAsset("skullGeo", GeometryAsset), { "Models/skull.txt" });
+
+	for (auto& e : mShaderRequests)
+	{
+		mAssetDependencies.SetFiles(mAssetDependencies.AddAsset(e.first, ShaderAsset),
+			mShaderCache->Cache().SourceFiles(e.second));
+	}
+
+	for (auto& e : mPsoBuilds)
+	{
+		const AssetDependencies::Asset pso = mAssetDependencies.AddAsset(e.first, PipelineAsset);
+		for (const std::string* shader : { &e.second.VS, &e.second.GS, &e.second.PS })
+		{
+			if (!shader->empty())
+				mAssetDependencies.AddDependency(pso, mAssetDependencies.Find(*shader));
+		}
+	}
+
+	mAssetWatcher = std::make_unique<FileWatcher>();
+	for (const std::string& file : mAssetDependencies.Files())
+	{
+		if (!mAssetWatcher->Watch(file))
+			::OutputDebugStringA(("Hot reload cannot watch " + file + "\n").c_str());
+	}
+
+	char line[128];
+	std::snprintf(line, sizeof(line), "Hot reload: %u assets from %u files, %s\n",
+		mAssetDependencies.AssetCount(), (unsigned)mAssetWatcher->WatchedCount(),
+		mAssetWatcher->UsesNotifications() ? "notifications" : "polling");
+	::OutputDebugStringA(line);
+}
+
+// Rebuilds what the files changed since the last check affect, each asset after the
+// ones it is built from.  An asset that fails to rebuild keeps its old version, and
+// nothing is rebuilt from it.
+void ShapesApp::ReloadChangedAssets()
+{
+	if (mAssetWatcher == nullptr)
+		return;
+
+	mAssetWatcher->Poll(mChangedFiles);
+	if (mChangedFiles.empty())
+		return;
+
+	PROFILE_ZONE("ReloadAssets");
+	const std::int64_t start = GameTimer::SteadyClockNow();
+	const std::vector<AssetDependencies::Asset> affected = mAssetDependencies.Affected(mChangedFiles);
+	mChangedFiles.clear();
+
+	// Textures and geometry are replaced in place, keeping their descriptors and the
+	// views render items hold, so the frames in flight must be done with them first.
+	// Shader edits alone do not wait.
+	std::vector<AssetDependencies::Asset> shaders;
+	bool waitForGpu = false;
+	for (AssetDependencies::Asset asset : affected)
+	{
+		const std::uint32_t kind = mAssetDependencies.Kind(asset);
+		if (kind == ShaderAsset)
+			shaders.push_back(asset);
+		waitForGpu |= kind == TextureAsset || kind == GeometryAsset;
+	}
+	if (waitForGpu)
+		FlushCommandQueue();
+
+	auto requestOf = [this](const std::string& name) -> const ShaderCache::Request&
+	{
+		return std::find_if(mShaderRequests.begin(), mShaderRequests.end(),
+			[&name](const std::pair<std::string, ShaderCache::Request>& e) { return e.first == name; })->second;
+	};
+
+	// Compile the affected shaders in parallel before touching anything.
+	std::vector<ComPtr<ID3DBlob>> bytecode(shaders.size());
+	std::vector<std::string> errors(shaders.size());
+	if (!shaders.empty())
+	{
+		mShaderCache->Cache().InvalidateSources();
+		mTaskPool->ParallelFor((std::uint32_t)shaders.size(), [&](std::uint32_t i, std::uint32_t)
+		{
+			const std::string& name = mAssetDependencies.Name(shaders[i]);
+			try
+			{
+				bytecode[i] = mShaderCache->Load(requestOf(name));
+			}
+			catch (const std::exception& e)
+			{
+				errors[i] = e.what();
+			}
+			catch (const DxException&)
+			{
+				errors[i] = "cannot load the bytecode of " + name;
+			}
+		});
+	}
+
+	std::vector<bool> failed(mAssetDependencies.AssetCount(), false);
+	std::uint32_t rebuilt = 0;
+	for (AssetDependencies::Asset asset : affected)
+	{
+		const std::string& name = mAssetDependencies.Name(asset);
+		for (AssetDependencies::Asset dependency : mAssetDependencies.Dependencies(asset))
+			failed[asset] = failed[asset] || failed[dependency];
+		if (failed[asset])
+			continue;
+
+		switch (mAssetDependencies.Kind(asset))
+		{
+		case TextureAsset:
+			failed[asset] = !ReloadTexture(name);
+			break;
+
+		case GeometryAsset:
+			BuildSkullGeometry();
+			break;
+
+		case ShaderAsset:
+		{
+			const std::size_t i = std::find(shaders.begin(), shaders.end(), asset) - shaders.begin();
+			if (!errors[i].empty())
+			{
+				::OutputDebugStringA((errors[i] + "\n").c_str());
+				failed[asset] = true;
+				break;
+			}
+			mShaders[name] = bytecode[i];
+
+			// The edit may have changed what the shader includes.
+			std::vector<std::string> files = mShaderCache->Cache().SourceFiles(requestOf(name));
+			for (const std::string& file : files)
+				mAssetWatcher->Watch(file);
+			mAssetDependencies.SetFiles(asset, files);
+			break;
+		}
+
+		case PipelineAsset:
+			failed[asset] = !ReloadPSO(name);
+			break;
+		}
+
+		if (!failed[asset])
+			rebuilt++;
+	}
+
+	char line[128];
+	std::snprintf(line, sizeof(line), "Hot reload: rebuilt %u of %u affected assets in %.1f ms%s\n",
+		rebuilt, (unsigned)affected.size(), (GameTimer::SteadyClockNow() - start) * 1.0e-6,
+		waitForGpu ? " (waited for the GPU)" : "");
+	::OutputDebugStringA(line);
+
+	mFramePacer.Invalidate();
+}
+
+bool ShapesApp::ReloadTexture(const std::string& name)
+{
+	auto slot = mTextureSrvSlots.find(name);
+	if (slot == mTextureSrvSlots.end())
+	{
+		::OutputDebugStringA(("Hot reload: " + name + " has no descriptor slot\n").c_str());
+		return false;
+	}
+	assert(slot->second < mTextureSrvs.Count);
+	Texture& texture = *mTextures[name];
+
+	// The copy is recorded on this frame's command list, ahead of its draws.
+	ComPtr<ID3D12Resource> resource;
+	ComPtr<ID3D12Resource> uploadHeap;
+	if (FAILED(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(), mCommandList.Get(),
+		texture.Filename.c_str(), resource, uploadHeap)))
+	{
+		::OutputDebugStringW((L"Hot reload cannot load " + texture.Filename + L"\n").c_str());
+		return false;
+	}
+
+	// The materials sampling this slot declare it as a 2D texture or a 2D array, so a
+	// reload must not turn one into the other.
+	const bool wasArray = texture.Resource->GetDesc().DepthOrArraySize > 1;
+	if ((resource->GetDesc().DepthOrArraySize > 1) != wasArray)
+	{
+		::OutputDebugStringW((L"Hot reload: " + texture.Filename +
+			(wasArray ? L" is no longer a texture array\n" : L" became a texture array\n")).c_str());
+		mStaging->DeferRelease(uploadHeap);
+		mStaging->DeferRelease(resource);
+		return false;
+	}
+
+	// The GPU is idle, so the old texture and its descriptor can go at once.
+	texture.Resource = resource;
+	mSrvHeap->CreateTextureSrv(resource.Get(), mTextureSrvs.Start + slot->second);
+	mStaging->DeferRelease(uploadHeap);
+	return true;
+}
+
+bool ShapesApp::ReloadPSO(const std::string& name)
+{
+	ComPtr<ID3D12PipelineState> pso;
+	try
+	{
+		pso = CreatePSO(mPsoBuilds[name]);
+	}
+	catch (const DxException& e)
+	{
+		::OutputDebugStringW((e.ToString() + L"\n").c_str());
+		return false;
+	}
+
+	// The command list of the frame being recorded may already use the old PSO, so it
+	// is kept until that frame's fence.
+	mRetiredPSOs.emplace_back(mCurrentFence + 1, std::move(mPSOs[name]));
+	mPSOs[name] = pso;
+	mStreamBackend.ReplacePipeline(mPipelineIds[name], pso.Get());
+	ResolveScenePipelines();
+	return true;
+}
+
+void ShapesApp::UpdateQualityGovernor()
+{
+	if (mQualityGovernor == nullptr || !mFrameMetrics.LastSample().HasFrameTime)
+		return;
+
+	if (mQualityGovernor->Update(mFrameMetrics.LastSample().Ms[FrameMetrics::FrameTime]))
+	{
+		ApplyQualityLevels();
+#if defined(DEBUG) || defined(_DEBUG)
+		::OutputDebugStringA(mQualityGovernor->Report().c_str());
+#endif
+	}
+}
+
+// Turns the governor's levels into settings.  Runs on the render thread between
+// frames, so nothing is recording while the tree sprite item changes.
+void ShapesApp::ApplyQualityLevels()
+{
+	const QualityGovernor& governor = *mQualityGovernor;
+
+	mWaveUpdateInterval.store(8u >> governor.Level(WaveRateKnob), std::memory_order_relaxed);
+
+	mTreeSpritesRitem->IndexCount = std::max<UINT>(1, mTreeSpriteIndexCount * governor.Level(TreeDensityKnob) / 4);
+
+	mActiveLocalLights.store((std::uint32_t)governor.Level(LocalLightsKnob), std::memory_order_relaxed);
+
+	const float drawDistances[5] = { 150.0f, 250.0f, 400.0f, 600.0f, MathHelper::Infinity };
+	mDrawDistance = drawDistances[governor.Level(DrawDistanceKnob)];
+
+	mCloth->SetIterations(2 * (std::uint32_t)governor.Level(ClothIterationsKnob));
+
+	for (QualityGovernor::Knob k = 0; k < QualityKnobCount; ++k)
+		mQualityLevelMetrics[k]->Set((double)governor.Level(k));
+}
+
+void ShapesApp::EndAllocationCheckFrame()
+{
+	if (mAllocationCheck == nullptr)
+		return;
+
+	const std::uint64_t allocations = mAllocationCheck->EndFrame();
+	if (mAllocationCheck->FramesChecked() == 0)
+		return;
+
+	mAppMetrics.FrameAllocations->Set((double)allocations);
+
+#if defined(DEBUG) || defined(_DEBUG)
+	// Report the first frame that allocates while the call sites are fresh.
+	if (allocations > 0 && mAllocationCheck->FramesWithAllocations() == 1)
+		::OutputDebugStringA(mAllocationCheck->Report().c_str());
+#endif
+
+	if (mAllocationCheckFrames > 0 && mAllocationCheck->FramesChecked() == mAllocationCheckFrames)
+	{
+		::OutputDebugStringA(mAllocationCheck->Report().c_str());
+		PostQuitMessage(mAllocationCheck->Passed() ? 0 : 1);
+	}
+}
+
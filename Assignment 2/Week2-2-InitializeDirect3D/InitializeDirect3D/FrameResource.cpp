@@ -1,17 +1,31 @@
 #include "FrameResource.h"
 
-FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT waveVertCount)
+FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT waveVertCount,
+    UINT clothVertCount, UINT recordThreadCount)
 {
     ThrowIfFailed(device->CreateCommandAllocator(
         D3D12_COMMAND_LIST_TYPE_DIRECT,
         IID_PPV_ARGS(CmdListAlloc.GetAddressOf())));
 
+    RecordCmdListAllocs.resize(recordThreadCount);
+    for (auto& alloc : RecordCmdListAllocs)
+    {
+        ThrowIfFailed(device->CreateCommandAllocator(
+            D3D12_COMMAND_LIST_TYPE_DIRECT,
+            IID_PPV_ARGS(alloc.GetAddressOf())));
+    }
+
+    ThrowIfFailed(device->CreateCommandAllocator(
+        D3D12_COMMAND_LIST_TYPE_DIRECT,
+        IID_PPV_ARGS(PostCmdListAlloc.GetAddressOf())));
+
     //  FrameCB = std::make_unique<UploadBuffer<FrameConstants>>(device, 1, true);
     PassCB = std::make_unique<UploadBuffer<PassConstants>>(device, passCount, true);
-    MaterialCB = std::make_unique<UploadBuffer<MaterialConstants>>(device, materialCount, true);
-    ObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, true);
+    MaterialBuffer = std::make_unique<UploadBuffer<MaterialData>>(device, materialCount, false);
+    ObjectBuffer = std::make_unique<UploadBuffer<ObjectData>>(device, objectCount, false);
 
     WavesVB = std::make_unique<UploadBuffer<Vertex>>(device, waveVertCount, false);
+    ClothVB = std::make_unique<UploadBuffer<Vertex>>(device, clothVertCount, false);
 }
 
 FrameResource::~FrameResource()
@@ -3,12 +3,8 @@
 #include "../../Common/d3dUtil.h"
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
-
-struct ObjectConstants
-{
-    DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4();
-    DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
-};
+#include "../../Common/LinearArena.h"
+#include "../../Common/DrawTables.h"
 
 struct PassConstants
 {
@@ -56,7 +52,8 @@ struct FrameResource
 {
 public:
 
-    FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT waveVertCount);
+    FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT waveVertCount,
+        UINT clothVertCount, UINT recordThreadCount);
     FrameResource(const FrameResource& rhs) = delete;
     FrameResource& operator=(const FrameResource& rhs) = delete;
     ~FrameResource();
@@ -65,15 +62,27 @@ public:
     // So each frame needs their own allocator.
     Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CmdListAlloc;
 
+    // One allocator per recording thread for the scene command lists, and one for the
+    // commands after the scene pass.  Allocators are not free-threaded.
+    std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> RecordCmdListAllocs;
+    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> PostCmdListAlloc;
+
     // We cannot update a cbuffer until the GPU is done processing the commands
     // that reference it.  So each frame needs their own cbuffers.
    // std::unique_ptr<UploadBuffer<FrameConstants>> FrameCB = nullptr;
     std::unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
-    std::unique_ptr<UploadBuffer<MaterialConstants>> MaterialCB = nullptr;
-    std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB = nullptr;
+    std::unique_ptr<UploadBuffer<MaterialData>> MaterialBuffer = nullptr;
+    std::unique_ptr<UploadBuffer<ObjectData>> ObjectBuffer = nullptr;
 
     std::unique_ptr<UploadBuffer<Vertex>> WavesVB = nullptr;
 
+    // Written in place by the cloth solver each frame.
+    std::unique_ptr<UploadBuffer<Vertex>> ClothVB = nullptr;
+
+    // CPU data that lives for one frame, such as the scene draw list.  Reset when the
+    // frame resource is reused, after its fence has been reached.
+    LinearArena Arena;
+
     // Fence value to mark commands up to this fence point.  This lets us
     // check if these frame resources are still in use by the GPU.
     UINT64 Fence = 0;
@@ -22,7 +22,12 @@
 #include "LightingUtil.hlsl"
 
 // Texture Step21
+#ifdef BINDLESS
+// Every texture SRV in the heap; the material selects one with its DiffuseMapIndex.
+Texture2D gDiffuseMaps[] : register(t0, space1);
+#else
 Texture2D gDiffuseMap : register(t0);
+#endif
 
 // Texture Step22
 SamplerState gsamPointWrap : register(s0);
@@ -32,16 +37,34 @@ SamplerState gsamLinearClamp : register(s3);
 SamplerState gsamAnisotropicWrap : register(s4);
 SamplerState gsamAnisotropicClamp : register(s5);
 
-// Constant data that varies per frame.
+// Per-draw root constant: object index in the low 20 bits, material index in the high 12.
+cbuffer cbDrawIndices : register(b0)
+{
+    uint gDrawIndices;
+};
 
-cbuffer cbPerObject : register(b0)
+struct ObjectData
 {
-    float4x4 gWorld;
-    
-    // Texture Step23
-    float4x4 gTexTransform;
+    float4x4 World;
+    float4x4 TexTransform;
+};
+
+struct MaterialData
+{
+    float4   DiffuseAlbedo;
+    float3   FresnelR0;
+    float    Roughness;
+    float4x4 MatTransform;
+    uint     DiffuseMapIndex;
+    uint     MatPad0;
+    uint     MatPad1;
+    uint     MatPad2;
 };
 
+// Every object and every material of the scene, indexed with gDrawIndices.
+StructuredBuffer<ObjectData> gObjectData : register(t0, space2);
+StructuredBuffer<MaterialData> gMaterialData : register(t1, space2);
+
 // Constant data that varies per material.
 cbuffer cbPass : register(b1)
 {
@@ -67,14 +90,6 @@ cbuffer cbPass : register(b1)
     // are spot lights for a maximum of MaxLights per object.
     Light gLights[MaxLights];
 };
- 
-cbuffer cbMaterial : register(b2)
-{
-    float4 gDiffuseAlbedo;
-    float3 gFresnelR0;
-    float gRoughness;
-    float4x4 gMatTransform;
-};
 
 struct VertexIn
 {
@@ -96,29 +111,38 @@ struct VertexOut
 VertexOut VS(VertexIn vin)
 {
 	VertexOut vout = (VertexOut)0.0f;
+
+    ObjectData objData = gObjectData[gDrawIndices & 0xfffff];
+    MaterialData matData = gMaterialData[gDrawIndices >> 20];
 	
     // Transform to world space.
-    float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+    float4 posW = mul(float4(vin.PosL, 1.0f), objData.World);
     vout.PosW = posW.xyz;
 
     // Assumes nonuniform scaling; otherwise, need to use inverse-transpose of world matrix.
-    vout.NormalW = mul(vin.NormalL, (float3x3)gWorld);
+    vout.NormalW = mul(vin.NormalL, (float3x3)objData.World);
 
     // Transform to homogeneous clip space.
     vout.PosH = mul(posW, gViewProj);
     
     // Texture Step26
     // Output vertex attributes for interpolation across triangle.
-    float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), gTexTransform);
-    vout.TexC = mul(texC, gMatTransform).xy;
+    float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), objData.TexTransform);
+    vout.TexC = mul(texC, matData.MatTransform).xy;
 
     return vout;
 }
 
 float4 PS(VertexOut pin) : SV_Target
 {
+    MaterialData matData = gMaterialData[gDrawIndices >> 20];
+
     // Texture Step27
-    float4 diffuseAlbedo = gDiffuseMap.Sample(gsamAnisotropicWrap, pin.TexC) * gDiffuseAlbedo;
+#ifdef BINDLESS
+    float4 diffuseAlbedo = gDiffuseMaps[matData.DiffuseMapIndex].Sample(gsamAnisotropicWrap, pin.TexC) * matData.DiffuseAlbedo;
+#else
+    float4 diffuseAlbedo = gDiffuseMap.Sample(gsamAnisotropicWrap, pin.TexC) * matData.DiffuseAlbedo;
+#endif
 	
     // Interpolating normal can unnormalize it, so renormalize it.
     pin.NormalW = normalize(pin.NormalW);
@@ -130,10 +154,10 @@ float4 PS(VertexOut pin) : SV_Target
     // Texture Step28
     float4 ambient = gAmbientLight * diffuseAlbedo;
 
-    const float shininess = 1.0f - gRoughness;
+    const float shininess = 1.0f - matData.Roughness;
     
     // Texture Step29
-    Material mat = { diffuseAlbedo, gFresnelR0, shininess };
+    Material mat = { diffuseAlbedo, matData.FresnelR0, shininess };
     float3 shadowFactor = 1.0f;
     float4 directLight = ComputeLighting(gLights, mat, pin.PosW, 
         pin.NormalW, toEyeW, shadowFactor);
@@ -18,7 +18,12 @@
 // Include structures and functions for lighting.
 #include "LightingUtil.hlsl"
 //step5
+#ifdef BINDLESS
+// Same table as Default1.hlsl, viewed as texture arrays.
+Texture2DArray gTreeMapArrays[] : register(t0, space1);
+#else
 Texture2DArray gTreeMapArray : register(t0);
+#endif
 
 //you can use dynamic indexing as well. Pay attention how we changed the sampler!
 //Texture2D gTreeMapArray[3] : register(t0);
@@ -31,13 +36,34 @@ SamplerState gsamLinearClamp      : register(s3);
 SamplerState gsamAnisotropicWrap  : register(s4);
 SamplerState gsamAnisotropicClamp : register(s5);
 
-// Constant data that varies per frame.
-cbuffer cbPerObject : register(b0)
+// Per-draw root constant: object index in the low 20 bits, material index in the high 12.
+cbuffer cbDrawIndices : register(b0)
+{
+    uint gDrawIndices;
+};
+
+struct ObjectData
+{
+    float4x4 World;
+    float4x4 TexTransform;
+};
+
+struct MaterialData
 {
-    float4x4 gWorld;
-	float4x4 gTexTransform;
+    float4   DiffuseAlbedo;
+    float3   FresnelR0;
+    float    Roughness;
+    float4x4 MatTransform;
+    uint     DiffuseMapIndex;
+    uint     MatPad0;
+    uint     MatPad1;
+    uint     MatPad2;
 };
 
+// Every object and every material of the scene, indexed with gDrawIndices.
+StructuredBuffer<ObjectData> gObjectData : register(t0, space2);
+StructuredBuffer<MaterialData> gMaterialData : register(t1, space2);
+
 // Constant data that varies per material.
 cbuffer cbPass : register(b1)
 {
@@ -69,14 +95,6 @@ cbuffer cbPass : register(b1)
     Light gLights[MaxLights];
 };
 
-cbuffer cbMaterial : register(b2)
-{
-	float4   gDiffuseAlbedo;
-    float3   gFresnelR0;
-    float    gRoughness;
-	float4x4 gMatTransform;
-};
- 
 struct VertexIn
 {
 	float3 PosW  : POSITION;
@@ -170,8 +188,14 @@ void GS(point VertexOut gin[1], //PrimitiveType InputVertexType InputName[NumEle
 //step6
 float4 PS(GeoOut pin) : SV_Target
 {
+    MaterialData matData = gMaterialData[gDrawIndices >> 20];
+
 	float3 uvw = float3(pin.TexC, pin.PrimID%3);
-    float4 diffuseAlbedo = gTreeMapArray.Sample(gsamAnisotropicWrap, uvw) * gDiffuseAlbedo;
+#ifdef BINDLESS
+    float4 diffuseAlbedo = gTreeMapArrays[matData.DiffuseMapIndex].Sample(gsamAnisotropicWrap, uvw) * matData.DiffuseAlbedo;
+#else
+    float4 diffuseAlbedo = gTreeMapArray.Sample(gsamAnisotropicWrap, uvw) * matData.DiffuseAlbedo;
+#endif
 
     //using dynamic indexing
     //float4 diffuseAlbedo = gTreeMapArray[pin.PrimID % 3].Sample(gsamAnisotropicWrap, pin.TexC) * gDiffuseAlbedo;
@@ -195,8 +219,8 @@ float4 PS(GeoOut pin) : SV_Target
     // Light terms.
     float4 ambient = gAmbientLight*diffuseAlbedo;
 
-    const float shininess = 1.0f - gRoughness;
-    Material mat = { diffuseAlbedo, gFresnelR0, shininess };
+    const float shininess = 1.0f - matData.Roughness;
+    Material mat = { diffuseAlbedo, matData.FresnelR0, shininess };
     float3 shadowFactor = 1.0f;
     float4 directLight = ComputeLighting(gLights, mat, pin.PosW,
         pin.NormalW, toEyeW, shadowFactor);
@@ -0,0 +1,232 @@
+//***************************************************************************************
+// SoftwareShading.cpp
+//***************************************************************************************
+
+#include "SoftwareShading.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+    // Varyings: PosW in 0-2, NormalW in 3-5, TexC in 6-7.
+    const std::uint32_t VaryingCount = 8;
+
+    // The buffers hold transposed matrices for the shaders' column-major packing.
+    XMMATRIX LoadShaderMatrix(const XMFLOAT4X4& m)
+    {
+        return XMMatrixTranspose(XMLoadFloat4x4(&m));
+    }
+
+    // The LightingUtil.hlsl functions, with the same names and order of operations.
+    float CalcAttenuation(float d, float falloffStart, float falloffEnd)
+    {
+        // Linear falloff.
+        return MathHelper::Clamp((falloffEnd - d) / (falloffEnd - falloffStart), 0.0f, 1.0f);
+    }
+
+    XMVECTOR SchlickFresnel(FXMVECTOR R0, FXMVECTOR normal, FXMVECTOR lightVec)
+    {
+        const float cosIncidentAngle = MathHelper::Clamp(XMVectorGetX(XMVector3Dot(normal, lightVec)), 0.0f, 1.0f);
+
+        const float f0 = 1.0f - cosIncidentAngle;
+        return XMVectorMultiplyAdd(XMVectorSubtract(XMVectorReplicate(1.0f), R0),
+            XMVectorReplicate(f0 * f0 * f0 * f0 * f0), R0);
+    }
+
+    XMVECTOR BlinnPhong(FXMVECTOR lightStrength, FXMVECTOR lightVec, FXMVECTOR normal, GXMVECTOR toEye,
+        HXMVECTOR diffuseAlbedo, HXMVECTOR fresnelR0, float shininess)
+    {
+        const float m = shininess * 256.0f;
+        XMVECTOR halfVec = XMVector3Normalize(XMVectorAdd(toEye, lightVec));
+
+        const float roughnessFactor = (m + 8.0f) * std::pow(std::max(XMVectorGetX(XMVector3Dot(halfVec, normal)), 0.0f), m) / 8.0f;
+        XMVECTOR specAlbedo = XMVectorScale(SchlickFresnel(fresnelR0, halfVec, lightVec), roughnessFactor);
+
+        // LDR rendering: bring the specular back into [0, 1].
+        specAlbedo = XMVectorDivide(specAlbedo, XMVectorAdd(specAlbedo, XMVectorReplicate(1.0f)));
+
+        return XMVectorMultiply(XMVectorAdd(diffuseAlbedo, specAlbedo), lightStrength);
+    }
+
+    // Shared by point and spot lights; returns false past the light's range.
+    bool PointLightStrength(const Light& L, FXMVECTOR pos, FXMVECTOR normal, XMVECTOR& lightVec, XMVECTOR& strength)
+    {
+        lightVec = XMVectorSubtract(XMLoadFloat3(&L.Position), pos);
+
+        const float d = XMVectorGetX(XMVector3Length(lightVec));
+        if (d > L.FalloffEnd)
+            return false;
+
+        lightVec = XMVectorScale(lightVec, 1.0f / d);
+
+        const float ndotl = std::max(XMVectorGetX(XMVector3Dot(lightVec, normal)), 0.0f);
+        strength = XMVectorScale(XMLoadFloat3(&L.Strength), ndotl * CalcAttenuation(d, L.FalloffStart, L.FalloffEnd));
+        return true;
+    }
+}
+
+DefaultSoftwareProgram::DefaultSoftwareProgram(std::vector<std::uint32_t> pipelines)
+    : mPipelines(std::move(pipelines))
+{
+}
+
+void DefaultSoftwareProgram::Reset()
+{
+    mShaders.clear();
+}
+
+bool DefaultSoftwareProgram::Draw(const SoftwareCommandBackend::DrawState& draw, SoftwareRasterizer& rasterizer)
+{
+    if (std::find(mPipelines.begin(), mPipelines.end(), draw.Pipeline) == mPipelines.end())
+        return false;
+
+    if (draw.VertexStride != sizeof(Vertex) ||
+        draw.RootAddresses[2] == nullptr || draw.RootSizes[2] < sizeof(PassConstants) ||
+        draw.RootAddresses[3] == nullptr || draw.RootAddresses[4] == nullptr)
+        return false;
+
+    const UINT drawIndices = draw.RootConstants[1][0];
+    const UINT objectIndex = drawIndices & MaxDrawObjectIndex;
+    const UINT materialIndex = drawIndices >> DrawMaterialShift;
+    if ((objectIndex + 1) * sizeof(ObjectData) > draw.RootSizes[4] ||
+        (materialIndex + 1) * sizeof(MaterialData) > draw.RootSizes[3])
+        return false;
+
+    const PassConstants* pass = static_cast<const PassConstants*>(draw.RootAddresses[2]);
+    const ObjectData& obj = static_cast<const ObjectData*>(draw.RootAddresses[4])[objectIndex];
+    const MaterialData& mat = static_cast<const MaterialData*>(draw.RootAddresses[3])[materialIndex];
+
+    mShaders.emplace_back(pass, mat);
+    const PixelShader* shader = &mShaders.back();
+
+    if (mVertexCache.size() < draw.VertexCount)
+    {
+        mVertexCache.resize(draw.VertexCount);
+        mVertexStamps.resize(draw.VertexCount, mDrawStamp);
+    }
+
+    // Restarting the stamps keeps an old stamp from matching after wrap-around.
+    if (++mDrawStamp == 0)
+    {
+        std::fill(mVertexStamps.begin(), mVertexStamps.end(), 0u);
+        mDrawStamp = 1;
+    }
+
+    const SoftwareRasterizer::ShadedVertex* v[3];
+    for (std::uint32_t i = 0; i < draw.IndexCount; ++i)
+    {
+        const std::uint32_t index = draw.Index(i);
+        if (mVertexStamps[index] != mDrawStamp)
+        {
+            const Vertex& vin = *reinterpret_cast<const Vertex*>(draw.Vertices + (std::size_t)index * draw.VertexStride);
+            ShadeVertex(vin, obj, mat, *pass, mVertexCache[index]);
+            mVertexStamps[index] = mDrawStamp;
+        }
+
+        v[i % 3] = &mVertexCache[index];
+        if (i % 3 == 2)
+            rasterizer.SubmitTriangle(*v[0], *v[1], *v[2], VaryingCount, shader, SoftwareRasterizer::CullMode::Back);
+    }
+
+    return true;
+}
+
+void DefaultSoftwareProgram::ShadeVertex(const Vertex& vin, const ObjectData& obj, const MaterialData& mat,
+    const PassConstants& pass, SoftwareRasterizer::ShadedVertex& vout)const
+{
+    XMMATRIX world = LoadShaderMatrix(obj.World);
+
+    // Transform to world space.
+    XMVECTOR posW = XMVector3Transform(XMLoadFloat3(&vin.Pos), world);
+    XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&vout.Varyings[0]), posW);
+
+    // Assumes nonuniform scaling; otherwise, need to use inverse-transpose of world matrix.
+    XMVECTOR normalW = XMVector3TransformNormal(XMLoadFloat3(&vin.Normal), world);
+    XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&vout.Varyings[3]), normalW);
+
+    // Transform to homogeneous clip space.
+    XMStoreFloat4(&vout.PosH, XMVector4Transform(posW, LoadShaderMatrix(pass.ViewProj)));
+
+    XMVECTOR texC = XMVectorSet(vin.TexC.x, vin.TexC.y, 0.0f, 1.0f);
+    texC = XMVector4Transform(texC, LoadShaderMatrix(obj.TexTransform));
+    texC = XMVector4Transform(texC, LoadShaderMatrix(mat.MatTransform));
+    XMStoreFloat2(reinterpret_cast<XMFLOAT2*>(&vout.Varyings[6]), texC);
+}
+
+DefaultSoftwareProgram::PixelShader::PixelShader(const PassConstants* pass, const MaterialData& material)
+    : mPass(pass),
+    mDiffuseAlbedo(material.DiffuseAlbedo),
+    mFresnelR0(material.FresnelR0),
+    mShininess(1.0f - material.Roughness)
+{
+}
+
+void DefaultSoftwareProgram::PixelShader::Shade(const float* varyings, float rgba[4])const
+{
+    // The diffuse map would be sampled here; without one it reads as white.
+    XMVECTOR diffuseAlbedo = XMLoadFloat4(&mDiffuseAlbedo);
+    XMVECTOR fresnelR0 = XMLoadFloat3(&mFresnelR0);
+
+    XMVECTOR posW = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&varyings[0]));
+
+    // Interpolating normal can unnormalize it, so renormalize it.
+    XMVECTOR normalW = XMVector3Normalize(XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&varyings[3])));
+
+    // Vector from point being lit to eye.
+    XMVECTOR toEyeW = XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&mPass->EyePosW), posW));
+
+    // Indirect lighting.
+    XMVECTOR litColor = XMVectorMultiply(XMLoadFloat4(&mPass->AmbientLight), diffuseAlbedo);
+
+    XMVECTOR directLight = XMVectorZero();
+    int i = 0;
+    for (; i < NumDirLights; ++i)
+    {
+        const Light& L = mPass->Lights[i];
+
+        // The light vector aims opposite the direction the light rays travel.
+        XMVECTOR lightVec = XMVectorNegate(XMLoadFloat3(&L.Direction));
+
+        const float ndotl = std::max(XMVectorGetX(XMVector3Dot(lightVec, normalW)), 0.0f);
+        XMVECTOR strength = XMVectorScale(XMLoadFloat3(&L.Strength), ndotl);
+        directLight = XMVectorAdd(directLight,
+            BlinnPhong(strength, lightVec, normalW, toEyeW, diffuseAlbedo, fresnelR0, mShininess));
+    }
+
+    for (; i < NumDirLights + NumPointLights; ++i)
+    {
+        XMVECTOR lightVec, strength;
+        if (PointLightStrength(mPass->Lights[i], posW, normalW, lightVec, strength))
+        {
+            directLight = XMVectorAdd(directLight,
+                BlinnPhong(strength, lightVec, normalW, toEyeW, diffuseAlbedo, fresnelR0, mShininess));
+        }
+    }
+
+    for (; i < NumDirLights + NumPointLights + NumSpotLights; ++i)
+    {
+        const Light& L = mPass->Lights[i];
+
+        XMVECTOR lightVec, strength;
+        if (PointLightStrength(L, posW, normalW, lightVec, strength))
+        {
+            const float cosAngle = std::max(XMVectorGetX(XMVector3Dot(XMVectorNegate(lightVec), XMLoadFloat3(&L.Direction))), 0.0f);
+            strength = XMVectorScale(strength, std::pow(cosAngle, L.SpotPower));
+            directLight = XMVectorAdd(directLight,
+                BlinnPhong(strength, lightVec, normalW, toEyeW, diffuseAlbedo, fresnelR0, mShininess));
+        }
+    }
+
+    // Direct light contributes no alpha; alpha comes from the diffuse material.
+    litColor = XMVectorAdd(litColor, XMVectorSetW(directLight, 0.0f));
+    litColor = XMVectorSetW(litColor, mDiffuseAlbedo.w);
+
+    XMFLOAT4 color;
+    XMStoreFloat4(&color, litColor);
+    rgba[0] = color.x;
+    rgba[1] = color.y;
+    rgba[2] = color.z;
+    rgba[3] = color.w;
+}
@@ -0,0 +1,61 @@
+//***************************************************************************************
+// SoftwareShading.h
+//
+// CPU port of Shaders\Default1.hlsl and LightingUtil.hlsl for the software backend.
+// Reads the same root layout the scene streams bind: the packed draw indices in
+// parameter 1, the pass constants in 2, the material buffer in 3 and the object
+// buffer in 4.  Textures are not sampled (there is no CPU texture decode), so the
+// diffuse map reads as white and surfaces show their material albedo.
+//***************************************************************************************
+
+#pragma once
+
+#include "../../Common/SoftwareCommandBackend.h"
+#include "FrameResource.h"
+#include <deque>
+
+class DefaultSoftwareProgram : public SoftwareCommandBackend::DrawProgram
+{
+public:
+    // Light counts Default1.hlsl is compiled with.
+    static const int NumDirLights = 3;
+    static const int NumPointLights = 2;
+    static const int NumSpotLights = 6;
+
+    // Pipelines listed here are drawn; any other is declined.
+    explicit DefaultSoftwareProgram(std::vector<std::uint32_t> pipelines);
+
+    // Drops the per-draw shaders of the last frame.  Call after Resolve.
+    void Reset();
+
+    bool Draw(const SoftwareCommandBackend::DrawState& draw, SoftwareRasterizer& rasterizer) override;
+
+private:
+    class PixelShader : public SoftwareRasterizer::PixelShader
+    {
+    public:
+        PixelShader(const PassConstants* pass, const MaterialData& material);
+
+        void Shade(const float* varyings, float rgba[4])const override;
+
+    private:
+        const PassConstants* mPass;
+        DirectX::XMFLOAT4 mDiffuseAlbedo;
+        DirectX::XMFLOAT3 mFresnelR0;
+        float mShininess;
+    };
+
+    void ShadeVertex(const Vertex& vin, const ObjectData& obj, const MaterialData& mat,
+        const PassConstants& pass, SoftwareRasterizer::ShadedVertex& vout)const;
+
+private:
+    std::vector<std::uint32_t> mPipelines;
+
+    // Shaders stay alive until Reset, since tiles shade after every draw is submitted.
+    std::deque<PixelShader> mShaders;
+
+    // Vertices shaded by the current draw; a stamp equal to mDrawStamp marks a hit.
+    std::vector<SoftwareRasterizer::ShadedVertex> mVertexCache;
+    std::vector<std::uint32_t> mVertexStamps;
+    std::uint32_t mDrawStamp = 0;
+};
@@ -3,6 +3,7 @@
 //***************************************************************************************
 
 #include "Waves.h"
+#include "../../Common/Profiler.h"
 #include <ppl.h>
 #include <algorithm>
 #include <vector>
@@ -87,6 +88,8 @@ float Waves::Depth()const
 
 void Waves::Update(float dt)
 {
+	PROFILE_ZONE("Waves::Update");
+
 	static float t = 0;
 
 	// Accumulate time.